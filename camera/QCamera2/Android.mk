@@ -12,6 +12,10 @@ LOCAL_SRC_FILES := \
         util/QCameraQueue.cpp \
         util/QCameraDisplay.cpp \
         util/QCameraCommon.cpp \
+        util/QCameraExifBuilder.cpp \
+        util/QCameraFrameTracer.cpp \
+        util/QCameraFrameDumper.cpp \
+        util/QCameraTaskGraph.cpp \
         QCamera2Hal.cpp \
         QCamera2Factory.cpp
 
@@ -24,7 +28,9 @@ LOCAL_SRC_FILES += \
         HAL3/QCamera3VendorTags.cpp \
         HAL3/QCamera3PostProc.cpp \
         HAL3/QCamera3CropRegionMapper.cpp \
-        HAL3/QCamera3StreamMem.cpp
+        HAL3/QCamera3StreamMem.cpp \
+        HAL3/QCamera3ReprocMeta.cpp \
+        HAL3/QCamera3PPJoin.cpp
 
 LOCAL_CFLAGS := -Wall -Wextra -Werror -Wno-unused-parameter -Wno-unused-variable -Wno-compound-token-split-by-macro
 
@@ -39,13 +45,16 @@ LOCAL_SRC_FILES += \
         HAL/QCameraMuxer.cpp \
         HAL/QCameraMem.cpp \
         HAL/QCameraStateMachine.cpp \
+        HAL/QCameraEvtBundlePool.cpp \
         HAL/QCameraChannel.cpp \
         HAL/QCameraStream.cpp \
         HAL/QCameraPostProc.cpp \
         HAL/QCamera2HWICallbacks.cpp \
+        HAL/QCameraCbNotifier.cpp \
         HAL/QCameraParameters.cpp \
         HAL/QCameraParametersIntf.cpp \
-        HAL/QCameraThermalAdapter.cpp
+        HAL/QCameraThermalAdapter.cpp \
+        HAL/QCameraPowerGovernor.cpp
 endif
 
 # System header file path prefix
@@ -136,6 +145,12 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
 include $(BUILD_SHARED_LIBRARY)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_dump_extract
+LOCAL_SRC_FILES := util/qcamera_dump_extract.cpp
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := camera_common_headers
 LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/stack/common
@@ -1711,8 +1711,10 @@ QCamera2HardwareInterface::QCamera2HardwareInterface(uint32_t cameraId)
     memset(&mJpegHandle, 0, sizeof(mJpegHandle));
     memset(&mJpegMpoHandle, 0, sizeof(mJpegMpoHandle));
 
-    mDeferredWorkThread.launch(deferredWorkRoutine, this);
-    mDeferredWorkThread.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, FALSE, FALSE);
+    char defWorkers[PROPERTY_VALUE_MAX];
+    property_get("persist.camera.defwork.threads", defWorkers, "3");
+    mDeferredWork.init((uint32_t)atoi(defWorkers), execDeferredWork,
+            releaseDeferredWork, this, "CAM_defrdWrk");
     m_perfLock.lock_init();
 
     pthread_mutex_init(&mGrallocLock, NULL);
@@ -1749,8 +1751,7 @@ QCamera2HardwareInterface::~QCamera2HardwareInterface()
 {
     LOGH("E");
 
-    mDeferredWorkThread.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, TRUE, TRUE);
-    mDeferredWorkThread.exit();
+    mDeferredWork.deinit();
 
     if (mMetadataMem != NULL) {
         delete mMetadataMem;
@@ -1832,6 +1833,7 @@ int QCamera2HardwareInterface::openCamera(struct hw_device_t **hw_device)
         if (m_thermalAdapter.init(this) != 0) {
           LOGW("Init thermal adapter failed");
         }
+        m_powerGovernor.init();
     }
     else
         *hw_device = NULL;
@@ -3492,6 +3494,7 @@ int QCamera2HardwareInterface::startPreview()
 
     m_perfLock.lock_acq();
 
+    m_powerGovernor.reset();
     updateThermalLevel((void *)&mThermalLevel);
 
     setDisplayFrameSkip();
@@ -3574,6 +3577,7 @@ int QCamera2HardwareInterface::stopPreview()
 
     // Disable power Hint for preview
     m_perfLock.powerHint(POWER_HINT_VIDEO_ENCODE, false);
+    m_perfLock.lock_acq_level(QCAMERA_PERF_LEVEL_NONE, 0);
 
     m_perfLock.lock_acq();
 
@@ -5910,6 +5914,7 @@ int QCamera2HardwareInterface::dump(int fd)
     dprintf(fd, "StoreMetaDataInFrame: %d \n", mStoreMetaDataInFrame);
     dprintf(fd, "\n Configuration: %s", mParameters.dump().string());
     dprintf(fd, "\n State Information: %s", m_stateMachine.dump().string());
+    dprintf(fd, "\n Callback Lanes: %s", m_cbNotifier.dump().string());
     dprintf(fd, "\n Camera HAL information End \n");
 
     /* send UPDATE_DEBUG_LEVEL to the backend so that they can read the
@@ -8862,7 +8867,11 @@ int QCamera2HardwareInterface::recalcFPSRange(int &minFPS, int &maxFPS,
         cam_fps_range_t &adjustedRange, bool bRecordingHint)
 {
     enum msm_vfe_frame_skip_pattern skipPattern;
-    calcThermalLevel(mThermalLevel,
+    qcamera_thermal_level_enum_t level = mThermalLevel;
+    if (m_powerGovernor.isEnabled()) {
+        level = m_powerGovernor.getDecision().fpsLevel;
+    }
+    calcThermalLevel(level,
                      minFPS,
                      maxFPS,
                      minVideoFPS,
@@ -8913,10 +8922,23 @@ int QCamera2HardwareInterface::updateThermalLevel(void *thermal_level)
         maxVideoFPS = maxFPS;
     }
 
+    mThermalLevel = level;
+    if (m_powerGovernor.isEnabled()) {
+        // The governor may run ahead of the thermal engine and lags behind
+        // it on the way down, its step decides what gets applied
+        m_powerGovernor.setThermalLevel(level);
+        qcamera_power_decision_t decision = m_powerGovernor.getDecision();
+        level = decision.fpsLevel;
+        m_perfLock.lock_acq_level(decision.perfLevel,
+                (int32_t)m_powerGovernor.getPerfHoldMs());
+        if (mParameters.setPowerDenoise(decision.tnrOff, decision.wnrOff) != NO_ERROR) {
+            LOGW("Failed to apply power governor denoise step %d", decision.step);
+        }
+    }
+
     value = mParameters.getRecordingHintValue();
     calcThermalLevel(level, minFPS, maxFPS, minVideoFPS, maxVideoFPS,
             adjustedRange, skipPattern, value );
-    mThermalLevel = level;
 
     if (thermalMode == QCAMERA_THERMAL_ADJUST_FPS)
         ret = mParameters.adjustPreviewFpsRange(&adjustedRange);
@@ -8925,6 +8947,25 @@ int QCamera2HardwareInterface::updateThermalLevel(void *thermal_level)
     else
         LOGW("Incorrect thermal mode %d", thermalMode);
 
+    if (m_powerGovernor.isEnabled() &&
+            level >= QCAMERA_THERMAL_NO_ADJUSTMENT &&
+            level <= QCAMERA_THERMAL_MAX_ADJUSTMENT) {
+        // Deadline is the slowest rate preview may legitimately run at
+        nsecs_t interval = 0;
+        uint32_t skip = 0;
+        if (thermalMode != QCAMERA_THERMAL_ADJUST_FRAMESKIP || skipPattern == NO_SKIP) {
+            skip = 1;
+        } else if (skipPattern == EVERY_2FRAME) {
+            skip = 2;
+        } else if (skipPattern == EVERY_4FRAME) {
+            skip = 4;
+        }
+        if ((skip > 0) && (adjustedRange.min_fps >= 1.0f)) {
+            interval = (nsecs_t)(1000000000.0f / adjustedRange.min_fps) * skip;
+        }
+        m_powerGovernor.setFrameInterval(interval);
+    }
+
     return ret;
 
 }
@@ -9312,29 +9353,7 @@ QCameraExif *QCamera2HardwareInterface::getExifData()
 
 #ifdef ENABLE_MODEL_INFO_EXIF
 
-    char value[PROPERTY_VALUE_MAX];
-    if (property_get("persist.sys.exif.make", value, "") > 0 ||
-            property_get("ro.product.manufacturer", value, "QCOM-AA") > 0) {
-        exif->addEntry(EXIFTAGID_MAKE,
-                EXIF_ASCII, strlen(value) + 1, (void *)value);
-    } else {
-        LOGW("getExifMaker failed");
-    }
-
-    if (property_get("persist.sys.exif.model", value, "") > 0 ||
-            property_get("ro.product.model", value, "QCAM-AA") > 0) {
-        exif->addEntry(EXIFTAGID_MODEL,
-                EXIF_ASCII, strlen(value) + 1, (void *)value);
-    } else {
-        LOGW("getExifModel failed");
-    }
-
-    if (property_get("ro.build.description", value, "QCAM-AA") > 0) {
-        exif->addEntry(EXIFTAGID_SOFTWARE, EXIF_ASCII,
-                (uint32_t)(strlen(value) + 1), (void *)value);
-    } else {
-        LOGW("getExifSoftware failed");
-    }
+    exif->addModelInfoEntries(true);
 
 #endif
 
@@ -9578,365 +9597,365 @@ bool QCamera2HardwareInterface::needFDMetadata(qcamera_ch_type_enum_t channel_ty
 }
 
 /*===========================================================================
- * FUNCTION   : deferredWorkRoutine
+ * FUNCTION   : runDeferredWork
  *
- * DESCRIPTION: data process routine that executes deferred tasks
+ * DESCRIPTION: executes one deferred task. Called from a deferred work
+ *              thread, or from a thread waiting on the task.
  *
  * PARAMETERS :
- *   @data    : user data ptr (QCamera2HardwareInterface)
+ *   @dw      : deferred work
  *
- * RETURN     : None
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
  *==========================================================================*/
-void *QCamera2HardwareInterface::deferredWorkRoutine(void *obj)
+int32_t QCamera2HardwareInterface::runDeferredWork(DefWork *dw)
 {
-    int running = 1;
-    int ret;
-    uint8_t is_active = FALSE;
-    int32_t job_status = 0;
+    static const char *kWorkNames[CMD_DEF_MAX] = {
+        "Camera:DefAllocBuff",
+        "Camera:DefPProcStart",
+        "Camera:DefPProcInit",
+        "Camera:DefMetadataAlloc",
+        "Camera:DefJpegSession",
+        "Camera:DefParamAlloc",
+        "Camera:DefParamInit",
+        "Camera:DefGeneric",
+    };
+    int32_t job_status = NO_ERROR;
 
-    QCamera2HardwareInterface *pme = (QCamera2HardwareInterface *)obj;
-    QCameraCmdThread *cmdThread = &pme->mDeferredWorkThread;
-    cmdThread->setName("CAM_defrdWrk");
-
-    do {
-        do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
-            if (ret != 0 && errno != EINVAL) {
-                LOGE("cam_sem_wait error (%s)",
-                         strerror(errno));
-                return NULL;
-            }
-        } while (ret != 0);
-
-        // we got notified about new cmd avail in cmd queue
-        camera_cmd_type_t cmd = cmdThread->getCmd();
-        LOGD("cmd: %d", cmd);
-        switch (cmd) {
-        case CAMERA_CMD_TYPE_START_DATA_PROC:
-            LOGH("start data proc");
-            is_active = TRUE;
-            break;
-        case CAMERA_CMD_TYPE_STOP_DATA_PROC:
-            LOGH("stop data proc");
-            is_active = FALSE;
-            // signal cmd is completed
-            cam_sem_post(&cmdThread->sync_sem);
-            break;
-        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
-            {
-                DefWork *dw =
-                    reinterpret_cast<DefWork *>(pme->mCmdQueue.dequeue());
-
-                if ( NULL == dw ) {
-                    LOGE("Invalid deferred work");
-                    break;
-                }
-
-                switch( dw->cmd ) {
-                case CMD_DEF_ALLOCATE_BUFF:
-                    {
-                        QCameraChannel * pChannel = dw->args.allocArgs.ch;
-
-                        if ( NULL == pChannel ) {
-                            LOGE("Invalid deferred work channel");
-                            job_status = BAD_VALUE;
-                            break;
-                        }
+    KPI_ATRACE_BEGIN((dw->cmd < CMD_DEF_MAX) ? kWorkNames[dw->cmd] : "Camera:DefWork");
+    switch( dw->cmd ) {
+    case CMD_DEF_ALLOCATE_BUFF:
+        {
+            QCameraChannel * pChannel = dw->args.allocArgs.ch;
 
-                        cam_stream_type_t streamType = dw->args.allocArgs.type;
-                        LOGH("Deferred buffer allocation started for stream type: %d",
-                                 streamType);
+            if ( NULL == pChannel ) {
+                LOGE("Invalid deferred work channel");
+                job_status = BAD_VALUE;
+                break;
+            }
 
-                        uint32_t iNumOfStreams = pChannel->getNumOfStreams();
-                        QCameraStream *pStream = NULL;
-                        for ( uint32_t i = 0; i < iNumOfStreams; ++i) {
-                            pStream = pChannel->getStreamByIndex(i);
+            cam_stream_type_t streamType = dw->args.allocArgs.type;
+            LOGH("Deferred buffer allocation started for stream type: %d",
+                     streamType);
 
-                            if ( NULL == pStream ) {
-                                job_status = BAD_VALUE;
-                                break;
-                            }
+            uint32_t iNumOfStreams = pChannel->getNumOfStreams();
+            QCameraStream *pStream = NULL;
+            for ( uint32_t i = 0; i < iNumOfStreams; ++i) {
+                pStream = pChannel->getStreamByIndex(i);
 
-                            if ( pStream->isTypeOf(streamType)) {
-                                if ( pStream->allocateBuffers() ) {
-                                    LOGE("Error allocating buffers !!!");
-                                    job_status =  NO_MEMORY;
-                                    pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                            CAMERA_ERROR_UNKNOWN, 0);
-                                }
-                                break;
-                            }
-                        }
-                    }
+                if ( NULL == pStream ) {
+                    job_status = BAD_VALUE;
                     break;
-                case CMD_DEF_PPROC_START:
-                    {
-                        int32_t ret = pme->getDefJobStatus(pme->mInitPProcJob);
-                        if (ret != NO_ERROR) {
-                            job_status = ret;
-                            LOGE("PPROC Start failed");
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
-                        QCameraChannel * pChannel = dw->args.pprocArgs;
-                        assert(pChannel);
-
-                        if (pme->m_postprocessor.start(pChannel) != NO_ERROR) {
-                            LOGE("cannot start postprocessor");
-                            job_status = BAD_VALUE;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                        }
-                    }
-                    break;
-                case CMD_DEF_METADATA_ALLOC:
-                    {
-                        int32_t ret = pme->getDefJobStatus(pme->mParamAllocJob);
-                        if (ret != NO_ERROR) {
-                            job_status = ret;
-                            LOGE("Metadata alloc failed");
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
-                        pme->mMetadataMem = new QCameraMetadataStreamMemory(
-                                QCAMERA_ION_USE_CACHE);
-
-                        if (pme->mMetadataMem == NULL) {
-                            LOGE("Unable to allocate metadata buffers");
-                            job_status = BAD_VALUE;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                        } else {
-                            int32_t rc = pme->mMetadataMem->allocate(
-                                    dw->args.metadataAllocArgs.bufferCnt,
-                                    dw->args.metadataAllocArgs.size,
-                                    NON_SECURE);
-                            if (rc < 0) {
-                                delete pme->mMetadataMem;
-                                pme->mMetadataMem = NULL;
-                            }
-                        }
-                     }
-                     break;
-                case CMD_DEF_CREATE_JPEG_SESSION:
-                    {
-                        QCameraChannel * pChannel = dw->args.pprocArgs;
-                        assert(pChannel);
-
-                        int32_t ret = pme->getDefJobStatus(pme->mReprocJob);
-                        if (ret != NO_ERROR) {
-                            job_status = ret;
-                            LOGE("Jpeg create failed");
-                            break;
-                        }
+                }
 
-                        if (pme->m_postprocessor.createJpegSession(pChannel)
-                            != NO_ERROR) {
-                            LOGE("cannot create JPEG session");
-                            job_status = UNKNOWN_ERROR;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                        }
+                if ( pStream->isTypeOf(streamType)) {
+                    if ( pStream->allocateBuffers() ) {
+                        LOGE("Error allocating buffers !!!");
+                        job_status =  NO_MEMORY;
+                        sendEvtNotify(CAMERA_MSG_ERROR,
+                                CAMERA_ERROR_UNKNOWN, 0);
                     }
                     break;
-                case CMD_DEF_PPROC_INIT:
-                    {
-                        int32_t rc = NO_ERROR;
-
-                        jpeg_encode_callback_t jpegEvtHandle =
-                                dw->args.pprocInitArgs.jpeg_cb;
-                        void* user_data = dw->args.pprocInitArgs.user_data;
-                        QCameraPostProcessor *postProcessor =
-                                &(pme->m_postprocessor);
-                        uint32_t cameraId = pme->mCameraId;
-                        cam_capability_t *capability =
-                                gCamCapability[cameraId];
-                        cam_padding_info_t padding_info;
-                        cam_padding_info_t& cam_capability_padding_info =
-                                capability->padding_info;
-
-                        if(!pme->mJpegClientHandle) {
-                            rc = pme->initJpegHandle();
-                            if (rc != NO_ERROR) {
-                                LOGE("Error!! creating JPEG handle failed");
-                                job_status = UNKNOWN_ERROR;
-                                pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                        CAMERA_ERROR_UNKNOWN, 0);
-                                break;
-                            }
-                        }
-                        LOGH("mJpegClientHandle : %d", pme->mJpegClientHandle);
-
-                        rc = postProcessor->setJpegHandle(&pme->mJpegHandle,
-                                &pme->mJpegMpoHandle,
-                                pme->mJpegClientHandle);
-                        if (rc != 0) {
-                            LOGE("Error!! set JPEG handle failed");
-                            job_status = UNKNOWN_ERROR;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
+                }
+            }
+        }
+        break;
+    case CMD_DEF_PPROC_START:
+        {
+            int32_t ret = getDefJobStatus(mInitPProcJob);
+            if (ret != NO_ERROR) {
+                job_status = ret;
+                LOGE("PPROC Start failed");
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
+            QCameraChannel * pChannel = dw->args.pprocArgs;
+            assert(pChannel);
 
-                        /* get max pic size for jpeg work buf calculation*/
-                        rc = postProcessor->init(jpegEvtHandle, user_data);
+            if (m_postprocessor.start(pChannel) != NO_ERROR) {
+                LOGE("cannot start postprocessor");
+                job_status = BAD_VALUE;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+            }
+        }
+        break;
+    case CMD_DEF_METADATA_ALLOC:
+        {
+            int32_t ret = getDefJobStatus(mParamAllocJob);
+            if (ret != NO_ERROR) {
+                job_status = ret;
+                LOGE("Metadata alloc failed");
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
+            mMetadataMem = new QCameraMetadataStreamMemory(
+                    QCAMERA_ION_USE_CACHE);
 
-                        if (rc != NO_ERROR) {
-                            LOGE("cannot init postprocessor");
-                            job_status = UNKNOWN_ERROR;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
+            if (mMetadataMem == NULL) {
+                LOGE("Unable to allocate metadata buffers");
+                job_status = BAD_VALUE;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+            } else {
+                int32_t rc = mMetadataMem->allocate(
+                        dw->args.metadataAllocArgs.bufferCnt,
+                        dw->args.metadataAllocArgs.size,
+                        NON_SECURE);
+                if (rc < 0) {
+                    delete mMetadataMem;
+                    mMetadataMem = NULL;
+                }
+            }
+         }
+         break;
+    case CMD_DEF_CREATE_JPEG_SESSION:
+        {
+            QCameraChannel * pChannel = dw->args.pprocArgs;
+            assert(pChannel);
 
-                        // update padding info from jpeg
-                        postProcessor->getJpegPaddingReq(padding_info);
-                        if (cam_capability_padding_info.width_padding <
-                                padding_info.width_padding) {
-                            cam_capability_padding_info.width_padding =
-                                    padding_info.width_padding;
-                        }
-                        if (cam_capability_padding_info.height_padding <
-                                padding_info.height_padding) {
-                            cam_capability_padding_info.height_padding =
-                                    padding_info.height_padding;
-                        }
-                        if (cam_capability_padding_info.plane_padding !=
-                                padding_info.plane_padding) {
-                            cam_capability_padding_info.plane_padding =
-                                    mm_stream_calc_lcm(
-                                    cam_capability_padding_info.plane_padding,
-                                    padding_info.plane_padding);
-                        }
-                        if (cam_capability_padding_info.offset_info.offset_x
-                                != padding_info.offset_info.offset_x) {
-                            cam_capability_padding_info.offset_info.offset_x =
-                                    mm_stream_calc_lcm (
-                                    cam_capability_padding_info.offset_info.offset_x,
-                                    padding_info.offset_info.offset_x);
-                        }
-                        if (cam_capability_padding_info.offset_info.offset_y
-                                != padding_info.offset_info.offset_y) {
-                            cam_capability_padding_info.offset_info.offset_y =
-                            mm_stream_calc_lcm (
-                                    cam_capability_padding_info.offset_info.offset_y,
-                                    padding_info.offset_info.offset_y);
-                        }
-                    }
-                    break;
-                case CMD_DEF_PARAM_ALLOC:
-                    {
-                        int32_t rc = pme->mParameters.allocate();
-                        // notify routine would not be initialized by this time.
-                        // So, just update error job status
-                        if (rc != NO_ERROR) {
-                            job_status = rc;
-                            LOGE("Param allocation failed");
-                            break;
-                        }
-                    }
+            int32_t ret = getDefJobStatus(mReprocJob);
+            if (ret != NO_ERROR) {
+                job_status = ret;
+                LOGE("Jpeg create failed");
+                break;
+            }
+
+            if (m_postprocessor.createJpegSession(pChannel)
+                != NO_ERROR) {
+                LOGE("cannot create JPEG session");
+                job_status = UNKNOWN_ERROR;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+            }
+        }
+        break;
+    case CMD_DEF_PPROC_INIT:
+        {
+            int32_t rc = NO_ERROR;
+
+            jpeg_encode_callback_t jpegEvtHandle =
+                    dw->args.pprocInitArgs.jpeg_cb;
+            void* user_data = dw->args.pprocInitArgs.user_data;
+            QCameraPostProcessor *postProcessor =
+                    &(m_postprocessor);
+            uint32_t cameraId = mCameraId;
+            cam_capability_t *capability =
+                    gCamCapability[cameraId];
+            cam_padding_info_t padding_info;
+            cam_padding_info_t& cam_capability_padding_info =
+                    capability->padding_info;
+
+            if(!mJpegClientHandle) {
+                rc = initJpegHandle();
+                if (rc != NO_ERROR) {
+                    LOGE("Error!! creating JPEG handle failed");
+                    job_status = UNKNOWN_ERROR;
+                    sendEvtNotify(CAMERA_MSG_ERROR,
+                            CAMERA_ERROR_UNKNOWN, 0);
                     break;
-                case CMD_DEF_PARAM_INIT:
-                    {
-                        int32_t rc = pme->getDefJobStatus(pme->mParamAllocJob);
-                        if (rc != NO_ERROR) {
-                            job_status = rc;
-                            LOGE("Param init failed");
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
+                }
+            }
+            LOGH("mJpegClientHandle : %d", mJpegClientHandle);
 
-                        uint32_t camId = pme->mCameraId;
-                        cam_capability_t * cap = gCamCapability[camId];
+            rc = postProcessor->setJpegHandle(&mJpegHandle,
+                    &mJpegMpoHandle,
+                    mJpegClientHandle);
+            if (rc != 0) {
+                LOGE("Error!! set JPEG handle failed");
+                job_status = UNKNOWN_ERROR;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
 
-                        if (pme->mCameraHandle == NULL) {
-                            LOGE("Camera handle is null");
-                            job_status = BAD_VALUE;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
+            /* get max pic size for jpeg work buf calculation*/
+            rc = postProcessor->init(jpegEvtHandle, user_data);
 
-                        // Now PostProc need calibration data as initialization
-                        // time for jpeg_open and calibration data is a
-                        // get param for now, so params needs to be initialized
-                        // before postproc init
-                        rc = pme->mParameters.init(cap,
-                                pme->mCameraHandle,
-                                pme);
-                        if (rc != 0) {
-                            job_status = UNKNOWN_ERROR;
-                            LOGE("Parameter Initialization failed");
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
+            if (rc != NO_ERROR) {
+                LOGE("cannot init postprocessor");
+                job_status = UNKNOWN_ERROR;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
 
-                        // Get related cam calibration only in
-                        // dual camera mode
-                        if (pme->getRelatedCamSyncInfo()->sync_control ==
-                                CAM_SYNC_RELATED_SENSORS_ON) {
-                            rc = pme->mParameters.getRelatedCamCalibration(
-                                &(pme->mJpegMetadata.otp_calibration_data));
-                            LOGD("Dumping Calibration Data Version Id %f rc %d",
-                                    pme->mJpegMetadata.otp_calibration_data.calibration_format_version,
-                                    rc);
-                            if (rc != 0) {
-                                job_status = UNKNOWN_ERROR;
-                                LOGE("getRelatedCamCalibration failed");
-                                pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                        CAMERA_ERROR_UNKNOWN, 0);
-                                break;
-                            }
-                            pme->m_bRelCamCalibValid = true;
-                        }
+            // update padding info from jpeg
+            postProcessor->getJpegPaddingReq(padding_info);
+            if (cam_capability_padding_info.width_padding <
+                    padding_info.width_padding) {
+                cam_capability_padding_info.width_padding =
+                        padding_info.width_padding;
+            }
+            if (cam_capability_padding_info.height_padding <
+                    padding_info.height_padding) {
+                cam_capability_padding_info.height_padding =
+                        padding_info.height_padding;
+            }
+            if (cam_capability_padding_info.plane_padding !=
+                    padding_info.plane_padding) {
+                cam_capability_padding_info.plane_padding =
+                        mm_stream_calc_lcm(
+                        cam_capability_padding_info.plane_padding,
+                        padding_info.plane_padding);
+            }
+            if (cam_capability_padding_info.offset_info.offset_x
+                    != padding_info.offset_info.offset_x) {
+                cam_capability_padding_info.offset_info.offset_x =
+                        mm_stream_calc_lcm (
+                        cam_capability_padding_info.offset_info.offset_x,
+                        padding_info.offset_info.offset_x);
+            }
+            if (cam_capability_padding_info.offset_info.offset_y
+                    != padding_info.offset_info.offset_y) {
+                cam_capability_padding_info.offset_info.offset_y =
+                mm_stream_calc_lcm (
+                        cam_capability_padding_info.offset_info.offset_y,
+                        padding_info.offset_info.offset_y);
+            }
+        }
+        break;
+    case CMD_DEF_PARAM_ALLOC:
+        {
+            int32_t rc = mParameters.allocate();
+            // notify routine would not be initialized by this time.
+            // So, just update error job status
+            if (rc != NO_ERROR) {
+                job_status = rc;
+                LOGE("Param allocation failed");
+                break;
+            }
+        }
+        break;
+    case CMD_DEF_PARAM_INIT:
+        {
+            int32_t rc = getDefJobStatus(mParamAllocJob);
+            if (rc != NO_ERROR) {
+                job_status = rc;
+                LOGE("Param init failed");
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
 
-                        pme->mJpegMetadata.sensor_mount_angle =
-                            cap->sensor_mount_angle;
-                        pme->mJpegMetadata.default_sensor_flip = FLIP_NONE;
-
-                        pme->mParameters.setMinPpMask(
-                            cap->qcom_supported_feature_mask);
-                        pme->mExifParams.debug_params =
-                                (mm_jpeg_debug_exif_params_t *)
-                                malloc(sizeof(mm_jpeg_debug_exif_params_t));
-                        if (!pme->mExifParams.debug_params) {
-                            LOGE("Out of Memory. Allocation failed for "
-                                    "3A debug exif params");
-                            job_status = NO_MEMORY;
-                            pme->sendEvtNotify(CAMERA_MSG_ERROR,
-                                    CAMERA_ERROR_UNKNOWN, 0);
-                            break;
-                        }
-                        memset(pme->mExifParams.debug_params, 0,
-                                sizeof(mm_jpeg_debug_exif_params_t));
-                    }
-                    break;
-                case CMD_DEF_GENERIC:
-                    {
-                        BackgroundTask *bgTask = dw->args.genericArgs;
-                        job_status = bgTask->bgFunction(bgTask->bgArgs);
-                    }
+            uint32_t camId = mCameraId;
+            cam_capability_t * cap = gCamCapability[camId];
+
+            if (mCameraHandle == NULL) {
+                LOGE("Camera handle is null");
+                job_status = BAD_VALUE;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
+
+            // Now PostProc need calibration data as initialization
+            // time for jpeg_open and calibration data is a
+            // get param for now, so params needs to be initialized
+            // before postproc init
+            rc = mParameters.init(cap,
+                    mCameraHandle,
+                    this);
+            if (rc != 0) {
+                job_status = UNKNOWN_ERROR;
+                LOGE("Parameter Initialization failed");
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
+            }
+
+            // Get related cam calibration only in
+            // dual camera mode
+            if (getRelatedCamSyncInfo()->sync_control ==
+                    CAM_SYNC_RELATED_SENSORS_ON) {
+                rc = mParameters.getRelatedCamCalibration(
+                    &(mJpegMetadata.otp_calibration_data));
+                LOGD("Dumping Calibration Data Version Id %f rc %d",
+                        mJpegMetadata.otp_calibration_data.calibration_format_version,
+                        rc);
+                if (rc != 0) {
+                    job_status = UNKNOWN_ERROR;
+                    LOGE("getRelatedCamCalibration failed");
+                    sendEvtNotify(CAMERA_MSG_ERROR,
+                            CAMERA_ERROR_UNKNOWN, 0);
                     break;
-                default:
-                    LOGE("Incorrect command : %d", dw->cmd);
                 }
-
-                pme->dequeueDeferredWork(dw, job_status);
+                m_bRelCamCalibValid = true;
+            }
+
+            mJpegMetadata.sensor_mount_angle =
+                cap->sensor_mount_angle;
+            mJpegMetadata.default_sensor_flip = FLIP_NONE;
+
+            mParameters.setMinPpMask(
+                cap->qcom_supported_feature_mask);
+            mExifParams.debug_params =
+                    (mm_jpeg_debug_exif_params_t *)
+                    malloc(sizeof(mm_jpeg_debug_exif_params_t));
+            if (!mExifParams.debug_params) {
+                LOGE("Out of Memory. Allocation failed for "
+                        "3A debug exif params");
+                job_status = NO_MEMORY;
+                sendEvtNotify(CAMERA_MSG_ERROR,
+                        CAMERA_ERROR_UNKNOWN, 0);
+                break;
             }
-            break;
-        case CAMERA_CMD_TYPE_EXIT:
-            running = 0;
-            break;
-        default:
-            break;
+            memset(mExifParams.debug_params, 0,
+                    sizeof(mm_jpeg_debug_exif_params_t));
         }
-    } while (running);
+        break;
+    case CMD_DEF_GENERIC:
+        {
+            BackgroundTask *bgTask = dw->args.genericArgs;
+            job_status = bgTask->bgFunction(bgTask->bgArgs);
+        }
+        break;
+    default:
+        LOGE("Incorrect command : %d", dw->cmd);
+    }
+    KPI_ATRACE_END();
 
-    return NULL;
+    dequeueDeferredWork(dw, job_status);
+    return job_status;
+}
+
+/*===========================================================================
+ * FUNCTION   : execDeferredWork
+ *
+ * DESCRIPTION: deferred work executor entry point
+ *
+ * PARAMETERS :
+ *   @task    : deferred work (DefWork)
+ *   @obj     : user data ptr (QCamera2HardwareInterface)
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera2HardwareInterface::execDeferredWork(void *task, void *obj)
+{
+    QCamera2HardwareInterface *pme = (QCamera2HardwareInterface *)obj;
+    return pme->runDeferredWork(reinterpret_cast<DefWork *>(task));
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseDeferredWork
+ *
+ * DESCRIPTION: drops a deferred task that never ran
+ *
+ * PARAMETERS :
+ *   @task    : deferred work (DefWork)
+ *   @obj     : user data ptr (QCamera2HardwareInterface)
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera2HardwareInterface::releaseDeferredWork(void *task, void *obj)
+{
+    QCamera2HardwareInterface *pme = (QCamera2HardwareInterface *)obj;
+    pme->dequeueDeferredWork(reinterpret_cast<DefWork *>(task), NO_INIT);
 }
 
 /*===========================================================================
@@ -9954,6 +9973,29 @@ void *QCamera2HardwareInterface::deferredWorkRoutine(void *obj)
 uint32_t QCamera2HardwareInterface::queueDeferredWork(DeferredWorkCmd cmd,
                                                       DeferWorkArgs args)
 {
+    // Jobs without a dependency here may run concurrently. Stream
+    // background tasks order themselves through waitForBackgroundTask.
+    uint32_t deps[QCAMERA_TASK_MAX_DEPS];
+    uint32_t numDeps = 0;
+    switch (cmd) {
+    case CMD_DEF_PPROC_START:
+        deps[numDeps++] = mInitPProcJob;
+        break;
+    case CMD_DEF_CREATE_JPEG_SESSION:
+        deps[numDeps++] = mReprocJob;
+        break;
+    case CMD_DEF_METADATA_ALLOC:
+    case CMD_DEF_PARAM_INIT:
+        deps[numDeps++] = mParamAllocJob;
+        break;
+    case CMD_DEF_PPROC_INIT:
+        // jpeg open needs the max picture size and calibration data
+        deps[numDeps++] = mParamInitJob;
+        break;
+    default:
+        break;
+    }
+
     Mutex::Autolock l(mDefLock);
     for (int32_t i = 0; i < MAX_ONGOING_JOBS; ++i) {
         if (mDefOngoingJobs[i].mDefJobId == 0) {
@@ -9962,21 +10004,19 @@ uint32_t QCamera2HardwareInterface::queueDeferredWork(DeferredWorkCmd cmd,
                 LOGE("out of memory.");
                 return 0;
             }
-            if (mCmdQueue.enqueue(dw)) {
-                mDefOngoingJobs[i].mDefJobId = sNextJobId++;
-                mDefOngoingJobs[i].mDefJobStatus = 0;
-                if (sNextJobId == 0) { // handle overflow
-                    sNextJobId = 1;
-                }
-                mDeferredWorkThread.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB,
-                        FALSE,
-                        FALSE);
-                return mDefOngoingJobs[i].mDefJobId;
-            } else {
-                LOGD("Command queue not active! cmd = %d", cmd);
+            // claim the slot first, the job can finish before submit returns
+            mDefOngoingJobs[i].mDefJobId = sNextJobId++;
+            mDefOngoingJobs[i].mDefJobStatus = 0;
+            if (sNextJobId == 0) { // handle overflow
+                sNextJobId = 1;
+            }
+            if (mDeferredWork.submit(dw->id, dw, deps, numDeps) != NO_ERROR) {
+                LOGD("Deferred work not active! cmd = %d", cmd);
+                mDefOngoingJobs[i].mDefJobId = 0;
                 delete dw;
                 return 0;
             }
+            return mDefOngoingJobs[i].mDefJobId;
         }
     }
     return 0;
@@ -10220,13 +10260,16 @@ bool QCamera2HardwareInterface::checkDeferredWork(uint32_t &job_id)
  *==========================================================================*/
 int32_t QCamera2HardwareInterface::waitDeferredWork(uint32_t &job_id)
 {
-    Mutex::Autolock l(mDefLock);
-
     if (job_id == 0) {
         LOGD("Invalid job id %d", job_id);
         return NO_ERROR;
     }
 
+    // runs the job here if no deferred work thread has picked it up yet
+    KPI_ATRACE_CALL();
+    mDeferredWork.wait(job_id);
+
+    Mutex::Autolock l(mDefLock);
     while (checkDeferredWork(job_id) == true ) {
         mDefCond.waitRelative(mDefLock, CAMERA_DEFERRED_THREAD_TIMEOUT);
     }
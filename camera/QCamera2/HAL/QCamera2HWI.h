@@ -45,9 +45,11 @@
 #include "QCameraParametersIntf.h"
 #include "QCameraPerf.h"
 #include "QCameraPostProc.h"
+#include "QCameraPowerGovernor.h"
 #include "QCameraQueue.h"
 #include "QCameraStream.h"
 #include "QCameraStateMachine.h"
+#include "QCameraTaskGraph.h"
 #include "QCameraThermalAdapter.h"
 
 #ifdef TARGET_TS_MAKEUP
@@ -137,8 +139,25 @@ typedef struct {
     void                    *cookie;     // release callback cookie
     camera_release_callback  release_cb; // release callback
     uint32_t                 frame_index;  // frame index for the buffer
+    int64_t                  enqueue_ts; // set by QCameraCbNotifier
 } qcamera_callback_argm_t;
 
+/* Callback lanes of QCameraCbNotifier, served highest (lowest value) first */
+typedef enum {
+    QCAMERA_CB_LANE_CONTROL,     // notify callbacks, e.g. shutter, focus, error
+    QCAMERA_CB_LANE_SNAPSHOT,    // JPEG and other non preview data callbacks
+    QCAMERA_CB_LANE_VIDEO,       // video timestamp callbacks
+    QCAMERA_CB_LANE_PREVIEW,     // preview frames, only the latest is kept
+    QCAMERA_CB_LANE_MAX
+} qcamera_cb_lane_t;
+
+typedef struct {
+    uint32_t dispatched;         // callbacks taken by the notify thread
+    uint32_t superseded;         // preview frames replaced by a newer one
+    int64_t total_delay_ns;      // summed enqueue to dispatch delay
+    int64_t max_delay_ns;        // worst enqueue to dispatch delay
+} qcamera_cb_lane_stats_t;
+
 class QCameraCbNotifier {
 public:
     QCameraCbNotifier(QCamera2HardwareInterface *parent) :
@@ -149,8 +168,15 @@ public:
                           mJpegCb(NULL),
                           mJpegCallbackCookie(NULL),
                           mParent (parent),
-                          mDataQ(releaseNotifications, this),
-                          mActive(false){}
+                          mNotifyQ(releaseNotifications, this),
+                          mSnapshotQ(releaseNotifications, this),
+                          mVideoQ(releaseNotifications, this),
+                          mPreviewSlot(NULL),
+                          mActive(false)
+    {
+        pthread_mutex_init(&mLaneLock, NULL);
+        memset(mLaneStats, 0, sizeof(mLaneStats));
+    }
 
     virtual ~QCameraCbNotifier();
 
@@ -171,7 +197,13 @@ public:
     static bool matchTimestampNotifications(void *data, void *user_data);
     virtual int32_t flushPreviewNotifications();
     virtual int32_t flushVideoNotifications();
+    void getLaneStats(qcamera_cb_lane_stats_t *stats);
+    String8 dump();
 private:
+    static qcamera_cb_lane_t getLane(const qcamera_callback_argm_t &cbArgs);
+    QCameraQueue *getLaneQ(qcamera_cb_lane_t lane);
+    qcamera_callback_argm_t *dequeueNextCallback();
+    void flushPreviewSlot();
 
     camera_notify_callback         mNotifyCb;
     camera_data_callback           mDataCb;
@@ -181,7 +213,12 @@ private:
     void                          *mJpegCallbackCookie;
     QCamera2HardwareInterface     *mParent;
 
-    QCameraQueue     mDataQ;
+    QCameraQueue     mNotifyQ;      // QCAMERA_CB_LANE_CONTROL
+    QCameraQueue     mSnapshotQ;    // QCAMERA_CB_LANE_SNAPSHOT
+    QCameraQueue     mVideoQ;       // QCAMERA_CB_LANE_VIDEO
+    qcamera_callback_argm_t *mPreviewSlot; // QCAMERA_CB_LANE_PREVIEW
+    pthread_mutex_t  mLaneLock;     // preview slot and lane stats
+    qcamera_cb_lane_stats_t mLaneStats[QCAMERA_CB_LANE_MAX];
     QCameraCmdThread mProcTh;
     bool             mActive;
 };
@@ -599,6 +636,7 @@ private:
     QCameraThermalAdapter &m_thermalAdapter;
     QCameraCbNotifier m_cbNotifier;
     QCameraPerfLock m_perfLock;
+    QCameraPowerGovernor m_powerGovernor;
     pthread_mutex_t m_lock;
     pthread_cond_t m_cond;
     api_result_list *m_apiResultList;
@@ -722,8 +760,9 @@ private:
         DeferWorkArgs args;
     };
 
-    QCameraCmdThread      mDeferredWorkThread;
-    QCameraQueue          mCmdQueue;
+    // deferred work runs on a small worker pool, ordered by the
+    // dependencies declared in queueDeferredWork
+    QCameraTaskGraph      mDeferredWork;
 
     Mutex                 mDefLock;
     Condition             mDefCond;
@@ -732,7 +771,9 @@ private:
                                DeferWorkArgs args);
     uint32_t dequeueDeferredWork(DefWork* dw, int32_t jobStatus);
     int32_t waitDeferredWork(uint32_t &job_id);
-    static void *deferredWorkRoutine(void *obj);
+    int32_t runDeferredWork(DefWork *dw);
+    static int32_t execDeferredWork(void *task, void *obj);
+    static void releaseDeferredWork(void *task, void *obj);
     bool checkDeferredWork(uint32_t &job_id);
     int32_t getDefJobStatus(uint32_t &job_id);
 
@@ -39,6 +39,7 @@
 
 // Camera dependencies
 #include "QCamera2HWI.h"
+#include "QCameraFrameDumper.h"
 #include "QCameraTrace.h"
 
 extern "C" {
@@ -811,6 +812,19 @@ void QCamera2HardwareInterface::preview_stream_cb_routine(mm_camera_super_buf_t
         return;
     }
 
+    qcamera_power_evt_t pwrEvt = pme->m_powerGovernor.onFrame(
+            nsecs_t(frame->ts.tv_sec) * 1000000000LL + frame->ts.tv_nsec);
+    if (QCAMERA_PWR_EVT_NONE != pwrEvt) {
+        // Renew or drop the boost right away, other steps are applied
+        // from the state machine thread like a thermal event
+        qcamera_power_decision_t decision = pme->m_powerGovernor.getDecision();
+        pme->m_perfLock.lock_acq_level(decision.perfLevel,
+                (int32_t)pme->m_powerGovernor.getPerfHoldMs());
+        if (QCAMERA_PWR_EVT_CHANGED == pwrEvt) {
+            pme->processAPI(QCAMERA_SM_EVT_THERMAL_NOTIFY, (void *)&pme->mThermalLevel);
+        }
+    }
+
     // For instant capture and for instant AEC, keep track of the frame counter.
     // This count will be used to check against the corresponding bound values.
     if (pme->mParameters.isInstantAECEnabled() ||
@@ -2059,48 +2073,31 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
         pme->dumpMetadataToFile(stream,frame,(char *)"Video");
     }
 
+    // All internal events of this frame go to the state machine in one
+    // pooled bundle, see QCameraStateMachine::procEvtBundle
+    qcamera_sm_internal_evt_bundle_t *evtBundle = pme->m_stateMachine.getEvtBundle();
+    if (NULL == evtBundle) {
+        LOGE("No memory for qcamera_sm_internal_evt_bundle_t");
+    }
+
     IF_META_AVAILABLE(cam_hist_stats_t, stats_data, CAM_INTF_META_HISTOGRAM, pMetaData) {
         // process histogram statistics info
-        qcamera_sm_internal_evt_payload_t *payload =
-            (qcamera_sm_internal_evt_payload_t *)
-                malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_HISTOGRAM_STATS;
-            payload->stats_data = *stats_data;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt histogram failed");
-                free(payload);
-                payload = NULL;
-
-            }
-        } else {
-            LOGE("No memory for histogram qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->stats_data = *stats_data;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_HISTOGRAM_STATS);
         }
     }
 
     IF_META_AVAILABLE(cam_face_detection_data_t, detection_data,
             CAM_INTF_META_FACE_DETECTION, pMetaData) {
 
-        cam_faces_data_t faces_data;
-        pme->fillFacesData(faces_data, pMetaData);
-        faces_data.detection_data.fd_type = QCAMERA_FD_PREVIEW; //HARD CODE here before MCT can support
-
-        qcamera_sm_internal_evt_payload_t *payload = (qcamera_sm_internal_evt_payload_t *)
-            malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT;
-            payload->faces_data = faces_data;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt face detection failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for face detect qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            cam_faces_data_t &faces_data = evtBundle->faces_data;
+            pme->fillFacesData(faces_data, pMetaData);
+            faces_data.detection_data.fd_type = QCAMERA_FD_PREVIEW; //HARD CODE here before MCT can support
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT);
         }
     }
 
@@ -2133,43 +2130,35 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
         if ((pme->m_currentFocusState != (*afState)) || forceAFUpdate) {
             cam_af_state_t prevFocusState = pme->m_currentFocusState;
             pme->m_currentFocusState = (cam_af_state_t)(*afState);
-            qcamera_sm_internal_evt_payload_t *payload = (qcamera_sm_internal_evt_payload_t *)
-                    malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-            if (NULL != payload) {
-                memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-                payload->evt_type = QCAMERA_INTERNAL_EVT_FOCUS_UPDATE;
-                payload->focus_data.focus_state = (cam_af_state_t)(*afState);
+            if (NULL != evtBundle) {
+                cam_auto_focus_data_t &focus_data = evtBundle->focus_data;
+                memset(&focus_data, 0, sizeof(cam_auto_focus_data_t));
+                focus_data.focus_state = (cam_af_state_t)(*afState);
                 //Need to flush ZSL Q only if we are transitioning from scanning state
                 //to focused/not focused state.
-                payload->focus_data.flush_info.needFlush =
+                focus_data.flush_info.needFlush =
                         ((prevFocusState == CAM_AF_STATE_PASSIVE_SCAN) ||
                         (prevFocusState == CAM_AF_STATE_ACTIVE_SCAN)) &&
                         ((pme->m_currentFocusState == CAM_AF_STATE_FOCUSED_LOCKED) ||
                         (pme->m_currentFocusState == CAM_AF_STATE_NOT_FOCUSED_LOCKED));
-                payload->focus_data.flush_info.focused_frame_idx = frame->frame_idx;
+                focus_data.flush_info.focused_frame_idx = frame->frame_idx;
 
                 IF_META_AVAILABLE(float, focusDistance,
                         CAM_INTF_META_LENS_FOCUS_DISTANCE, pMetaData) {
-                    payload->focus_data.focus_dist.
+                    focus_data.focus_dist.
                     focus_distance[CAM_FOCUS_DISTANCE_OPTIMAL_INDEX] = *focusDistance;
                 }
                 IF_META_AVAILABLE(float, focusRange, CAM_INTF_META_LENS_FOCUS_RANGE, pMetaData) {
-                    payload->focus_data.focus_dist.
+                    focus_data.focus_dist.
                             focus_distance[CAM_FOCUS_DISTANCE_NEAR_INDEX] = focusRange[0];
-                    payload->focus_data.focus_dist.
+                    focus_data.focus_dist.
                             focus_distance[CAM_FOCUS_DISTANCE_FAR_INDEX] = focusRange[1];
                 }
                 IF_META_AVAILABLE(uint32_t, focusMode, CAM_INTF_PARM_FOCUS_MODE, pMetaData) {
-                    payload->focus_data.focus_mode = (cam_focus_mode_type)(*focusMode);
+                    focus_data.focus_mode = (cam_focus_mode_type)(*focusMode);
                 }
-                int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-                if (rc != NO_ERROR) {
-                    LOGW("processEvt focus failed");
-                    free(payload);
-                    payload = NULL;
-                }
-            } else {
-                LOGE("No memory for focus qcamera_sm_internal_evt_payload_t");
+                evtBundle->evt_mask |=
+                        QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FOCUS_UPDATE);
             }
         }
     }
@@ -2178,42 +2167,20 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
         if (crop_data->num_of_streams > MAX_NUM_STREAMS) {
             LOGE("Invalid num_of_streams %d in crop_data",
                 crop_data->num_of_streams);
-        } else {
-            qcamera_sm_internal_evt_payload_t *payload =
-                (qcamera_sm_internal_evt_payload_t *)
-                    malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-            if (NULL != payload) {
-                memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-                payload->evt_type = QCAMERA_INTERNAL_EVT_CROP_INFO;
-                payload->crop_data = *crop_data;
-                int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-                if (rc != NO_ERROR) {
-                    LOGE("processEvt crop info failed");
-                    free(payload);
-                    payload = NULL;
-                }
-            } else {
-                LOGE("No memory for prep_snapshot qcamera_sm_internal_evt_payload_t");
-            }
+        } else if (NULL != evtBundle) {
+            evtBundle->crop_data = *crop_data;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_CROP_INFO);
         }
     }
 
     IF_META_AVAILABLE(int32_t, prep_snapshot_done_state,
             CAM_INTF_META_PREP_SNAPSHOT_DONE, pMetaData) {
-        qcamera_sm_internal_evt_payload_t *payload =
-        (qcamera_sm_internal_evt_payload_t *)malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_PREP_SNAPSHOT_DONE;
-            payload->prep_snapshot_state = (cam_prep_snapshot_state_t)*prep_snapshot_done_state;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt prep_snapshot failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for prep_snapshot qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->prep_snapshot_state =
+                    (cam_prep_snapshot_state_t)*prep_snapshot_done_state;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_PREP_SNAPSHOT_DONE);
         }
     }
 
@@ -2222,62 +2189,28 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
         LOGH("hdr_scene_data: %d %f\n",
                 hdr_scene_data->is_hdr_scene, hdr_scene_data->hdr_confidence);
         //Handle this HDR meta data only if capture is not in process
-        if (!pme->m_stateMachine.isCaptureRunning()) {
-            qcamera_sm_internal_evt_payload_t *payload =
-                    (qcamera_sm_internal_evt_payload_t *)
-                    malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-            if (NULL != payload) {
-                memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-                payload->evt_type = QCAMERA_INTERNAL_EVT_HDR_UPDATE;
-                payload->hdr_data = *hdr_scene_data;
-                int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-                if (rc != NO_ERROR) {
-                    LOGW("processEvt hdr update failed");
-                    free(payload);
-                    payload = NULL;
-                }
-            } else {
-                LOGE("No memory for hdr update qcamera_sm_internal_evt_payload_t");
-            }
+        if (!pme->m_stateMachine.isCaptureRunning() && (NULL != evtBundle)) {
+            evtBundle->hdr_data = *hdr_scene_data;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_HDR_UPDATE);
         }
     }
 
     IF_META_AVAILABLE(cam_asd_decision_t, cam_asd_info,
             CAM_INTF_META_ASD_SCENE_INFO, pMetaData) {
-        qcamera_sm_internal_evt_payload_t *payload =
-            (qcamera_sm_internal_evt_payload_t *)malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_ASD_UPDATE;
-            payload->asd_data = (cam_asd_decision_t)*cam_asd_info;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt asd_update failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for asd_update qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->asd_data = (cam_asd_decision_t)*cam_asd_info;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_ASD_UPDATE);
         }
     }
 
     IF_META_AVAILABLE(cam_awb_params_t, awb_params, CAM_INTF_META_AWB_INFO, pMetaData) {
         LOGH(", metadata for awb params.");
-        qcamera_sm_internal_evt_payload_t *payload =
-                (qcamera_sm_internal_evt_payload_t *)
-                malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_AWB_UPDATE;
-            payload->awb_data = *awb_params;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt awb_update failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for awb_update qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->awb_data = *awb_params;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_AWB_UPDATE);
         }
     }
 
@@ -2298,21 +2231,10 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
         pme->mExifParams.cam_3a_params_valid = TRUE;
         pme->mFlashNeeded = ae_params->flash_needed;
         pme->mExifParams.cam_3a_params.brightness = (float) pme->mParameters.getBrightness();
-        qcamera_sm_internal_evt_payload_t *payload =
-                (qcamera_sm_internal_evt_payload_t *)
-                malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_AE_UPDATE;
-            payload->ae_data = *ae_params;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt ae_update failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for ae_update qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->ae_data = *ae_params;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_AE_UPDATE);
         }
     }
 
@@ -2389,21 +2311,10 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
     }
 
     IF_META_AVAILABLE(uint32_t, led_mode, CAM_INTF_META_LED_MODE_OVERRIDE, pMetaData) {
-        qcamera_sm_internal_evt_payload_t *payload =
-                (qcamera_sm_internal_evt_payload_t *)
-                malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_LED_MODE_OVERRIDE;
-            payload->led_data = (cam_flash_mode_t)*led_mode;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt led mode override failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for focus qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->led_data = (cam_flash_mode_t)*led_mode;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_LED_MODE_OVERRIDE);
         }
     }
 
@@ -2419,21 +2330,19 @@ void QCamera2HardwareInterface::metadata_stream_cb_routine(mm_camera_super_buf_t
 
     IF_META_AVAILABLE(cam_focus_pos_info_t, cur_pos_info,
             CAM_INTF_META_FOCUS_POSITION, pMetaData) {
-        qcamera_sm_internal_evt_payload_t *payload =
-            (qcamera_sm_internal_evt_payload_t *)malloc(sizeof(qcamera_sm_internal_evt_payload_t));
-        if (NULL != payload) {
-            memset(payload, 0, sizeof(qcamera_sm_internal_evt_payload_t));
-            payload->evt_type = QCAMERA_INTERNAL_EVT_FOCUS_POS_UPDATE;
-            payload->focus_pos = *cur_pos_info;
-            int32_t rc = pme->processEvt(QCAMERA_SM_EVT_EVT_INTERNAL, payload);
-            if (rc != NO_ERROR) {
-                LOGW("processEvt focus_pos_update failed");
-                free(payload);
-                payload = NULL;
-            }
-        } else {
-            LOGE("No memory for focus_pos_update qcamera_sm_internal_evt_payload_t");
+        if (NULL != evtBundle) {
+            evtBundle->focus_pos = *cur_pos_info;
+            evtBundle->evt_mask |=
+                    QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FOCUS_POS_UPDATE);
+        }
+    }
+
+    if (NULL != evtBundle) {
+        int32_t rc = pme->m_stateMachine.procEvtBundle(evtBundle);
+        if (rc != NO_ERROR) {
+            LOGW("procEvtBundle failed");
         }
+        evtBundle = NULL;
     }
 
     if (pme->mParameters.getLowLightCapture()) {
@@ -2795,21 +2704,25 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                                 QCAMERA_DUMP_FRM_LOCATION "%Y%m%d%H%M%S", timeinfo);
                     }
                     String8 filePath(timeBuf);
+                    const char *tag = NULL;
                     switch (dump_type) {
                     case QCAMERA_DUMP_FRM_PREVIEW:
                         {
+                            tag = "p";
                             snprintf(buf, sizeof(buf), "%dp_%dx%d_%d_%d.yuv",
                                     dumpFrmCnt, dim.width, dim.height, frame->frame_idx, mCameraId);
                         }
                         break;
                     case QCAMERA_DUMP_FRM_THUMBNAIL:
                         {
+                            tag = "t";
                             snprintf(buf, sizeof(buf), "%dt_%dx%d_%d_%d.yuv",
                                     dumpFrmCnt, dim.width, dim.height, frame->frame_idx, mCameraId);
                         }
                         break;
                     case QCAMERA_DUMP_FRM_SNAPSHOT:
                         {
+                            tag = "s";
                             if (!mParameters.isPostProcScaling()) {
                                 mParameters.getStreamDimension(CAM_STREAM_TYPE_SNAPSHOT, dim);
                             } else {
@@ -2828,6 +2741,7 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                         break;
                     case QCAMERA_DUMP_FRM_INPUT_REPROCESS:
                         {
+                            tag = "ir";
                             stream->getFrameDimension(dim);
                             if (misc != NULL) {
                                 snprintf(buf, sizeof(buf), "%dir_%dx%d_%d_%s_%d.yuv",
@@ -2842,12 +2756,14 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                         break;
                     case QCAMERA_DUMP_FRM_VIDEO:
                         {
+                            tag = "v";
                             snprintf(buf, sizeof(buf), "%dv_%dx%d_%d_%d.yuv",
                                     dumpFrmCnt, dim.width, dim.height, frame->frame_idx, mCameraId);
                         }
                         break;
                     case QCAMERA_DUMP_FRM_RAW:
                         {
+                            tag = "r";
                             mParameters.getStreamDimension(CAM_STREAM_TYPE_RAW, dim);
                             snprintf(buf, sizeof(buf), "%dr_%dx%d_%d_%d.raw",
                                     dumpFrmCnt, dim.width, dim.height, frame->frame_idx, mCameraId);
@@ -2855,6 +2771,7 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                         break;
                     case QCAMERA_DUMP_FRM_JPEG:
                         {
+                            tag = "j";
                             mParameters.getStreamDimension(CAM_STREAM_TYPE_SNAPSHOT, dim);
                             snprintf(buf, sizeof(buf), "%dj_%dx%d_%d_%d.yuv",
                                     dumpFrmCnt, dim.width, dim.height, frame->frame_idx, mCameraId);
@@ -2866,6 +2783,27 @@ void QCamera2HardwareInterface::dumpFrameToFile(QCameraStream *stream,
                         return;
                     }
 
+                    // Internal RAW events hand the file path to the backend
+                    // so they keep writing a file of their own.
+                    if (!m_bIntRawEvtPending &&
+                            QCameraFrameDumper::getInstance()->isEnabled()) {
+                        qcamera_dump_desc_t desc;
+                        memset(&desc, 0, sizeof(desc));
+                        desc.cameraId = mCameraId;
+                        desc.dumpType = dump_type;
+                        desc.streamType = stream->getMyType();
+                        desc.format = CAM_FORMAT_MAX;
+                        stream->getFormat(desc.format);
+                        desc.dim = dim;
+                        desc.tag = tag;
+                        desc.misc = misc;
+                        QCameraFrameDumper::getInstance()->dumpFrame(desc, frame, offset);
+                        dumpFrmCnt++;
+                        stream->mDumpSkipCnt++;
+                        stream->mDumpFrame = dumpFrmCnt;
+                        return;
+                    }
+
                     filePath.append(buf);
                     int file_fd = open(filePath.string(), O_RDWR | O_CREAT, 0777);
                     ssize_t written_len = 0;
@@ -3028,506 +2966,4 @@ void QCamera2HardwareInterface::fillFacesData(cam_faces_data_t &faces_data,
     }
 }
 
-/*===========================================================================
- * FUNCTION   : ~QCameraCbNotifier
- *
- * DESCRIPTION: Destructor for exiting the callback context.
- *
- * PARAMETERS : None
- *
- * RETURN     : None
- *==========================================================================*/
-QCameraCbNotifier::~QCameraCbNotifier()
-{
-}
-
-/*===========================================================================
- * FUNCTION   : exit
- *
- * DESCRIPTION: exit notify thread.
- *
- * PARAMETERS : None
- *
- * RETURN     : None
- *==========================================================================*/
-void QCameraCbNotifier::exit()
-{
-    mActive = false;
-    mProcTh.exit();
-}
-
-/*===========================================================================
- * FUNCTION   : releaseNotifications
- *
- * DESCRIPTION: callback for releasing data stored in the callback queue.
- *
- * PARAMETERS :
- *   @data      : data to be released
- *   @user_data : context data
- *
- * RETURN     : None
- *==========================================================================*/
-void QCameraCbNotifier::releaseNotifications(void *data, void *user_data)
-{
-    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
-
-    if ( ( NULL != arg ) && ( NULL != user_data ) ) {
-        if ( arg->release_cb ) {
-            arg->release_cb(arg->user_data, arg->cookie, FAILED_TRANSACTION);
-        }
-    }
-}
-
-/*===========================================================================
- * FUNCTION   : matchSnapshotNotifications
- *
- * DESCRIPTION: matches snapshot data callbacks
- *
- * PARAMETERS :
- *   @data      : data to match
- *   @user_data : context data
- *
- * RETURN     : bool match
- *              true - match found
- *              false- match not found
- *==========================================================================*/
-bool QCameraCbNotifier::matchSnapshotNotifications(void *data,
-                                                   void */*user_data*/)
-{
-    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
-    if ( NULL != arg ) {
-        if ( QCAMERA_DATA_SNAPSHOT_CALLBACK == arg->cb_type ) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-/*===========================================================================
- * FUNCTION   : matchPreviewNotifications
- *
- * DESCRIPTION: matches preview data callbacks
- *
- * PARAMETERS :
- *   @data      : data to match
- *   @user_data : context data
- *
- * RETURN     : bool match
- *              true - match found
- *              false- match not found
- *==========================================================================*/
-bool QCameraCbNotifier::matchPreviewNotifications(void *data,
-        void */*user_data*/)
-{
-    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
-    if (NULL != arg) {
-        if ((QCAMERA_DATA_CALLBACK == arg->cb_type) &&
-                (CAMERA_MSG_PREVIEW_FRAME == arg->msg_type)) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-/*===========================================================================
- * FUNCTION   : matchTimestampNotifications
- *
- * DESCRIPTION: matches timestamp data callbacks
- *
- * PARAMETERS :
- *   @data      : data to match
- *   @user_data : context data
- *
- * RETURN     : bool match
- *              true - match found
- *              false- match not found
- *==========================================================================*/
-bool QCameraCbNotifier::matchTimestampNotifications(void *data,
-        void */*user_data*/)
-{
-    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
-    if (NULL != arg) {
-        if ((QCAMERA_DATA_TIMESTAMP_CALLBACK == arg->cb_type) &&
-                (CAMERA_MSG_VIDEO_FRAME == arg->msg_type)) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-/*===========================================================================
- * FUNCTION   : cbNotifyRoutine
- *
- * DESCRIPTION: callback thread which interfaces with the upper layers
- *              given input commands.
- *
- * PARAMETERS :
- *   @data    : context data
- *
- * RETURN     : None
- *==========================================================================*/
-void * QCameraCbNotifier::cbNotifyRoutine(void * data)
-{
-    int running = 1;
-    int ret;
-    QCameraCbNotifier *pme = (QCameraCbNotifier *)data;
-    QCameraCmdThread *cmdThread = &pme->mProcTh;
-    cmdThread->setName("CAM_cbNotify");
-    uint8_t isSnapshotActive = FALSE;
-    bool longShotEnabled = false;
-    uint32_t numOfSnapshotExpected = 0;
-    uint32_t numOfSnapshotRcvd = 0;
-    int32_t cbStatus = NO_ERROR;
-
-    LOGD("E");
-    do {
-        do {
-            ret = cam_sem_wait(&cmdThread->cmd_sem);
-            if (ret != 0 && errno != EINVAL) {
-                LOGD("cam_sem_wait error (%s)",
-                            strerror(errno));
-                return NULL;
-            }
-        } while (ret != 0);
-
-        camera_cmd_type_t cmd = cmdThread->getCmd();
-        LOGD("get cmd %d", cmd);
-        switch (cmd) {
-        case CAMERA_CMD_TYPE_START_DATA_PROC:
-            {
-                isSnapshotActive = TRUE;
-                numOfSnapshotExpected = pme->mParent->numOfSnapshotsExpected();
-                longShotEnabled = pme->mParent->isLongshotEnabled();
-                LOGD("Num Snapshots Expected = %d",
-                       numOfSnapshotExpected);
-                numOfSnapshotRcvd = 0;
-            }
-            break;
-        case CAMERA_CMD_TYPE_STOP_DATA_PROC:
-            {
-                pme->mDataQ.flushNodes(matchSnapshotNotifications);
-                isSnapshotActive = FALSE;
-
-                numOfSnapshotExpected = 0;
-                numOfSnapshotRcvd = 0;
-            }
-            break;
-        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
-            {
-                qcamera_callback_argm_t *cb =
-                    (qcamera_callback_argm_t *)pme->mDataQ.dequeue();
-                cbStatus = NO_ERROR;
-                if (NULL != cb) {
-                    LOGD("cb type %d received",
-                              cb->cb_type);
-
-                    if (pme->mParent->msgTypeEnabledWithLock(cb->msg_type)) {
-                        switch (cb->cb_type) {
-                        case QCAMERA_NOTIFY_CALLBACK:
-                            {
-                                if (cb->msg_type == CAMERA_MSG_FOCUS) {
-                                    KPI_ATRACE_INT("Camera:AutoFocus", 0);
-                                    LOGH("[KPI Perf] : PROFILE_SENDING_FOCUS_EVT_TO APP");
-                                }
-                                if (pme->mNotifyCb) {
-                                    pme->mNotifyCb(cb->msg_type,
-                                                  cb->ext1,
-                                                  cb->ext2,
-                                                  pme->mCallbackCookie);
-                                } else {
-                                    LOGW("notify callback not set!");
-                                }
-                                if (cb->release_cb) {
-                                    cb->release_cb(cb->user_data, cb->cookie,
-                                            cbStatus);
-                                }
-                            }
-                            break;
-                        case QCAMERA_DATA_CALLBACK:
-                            {
-                                if (pme->mDataCb) {
-                                    pme->mDataCb(cb->msg_type,
-                                                 cb->data,
-                                                 cb->index,
-                                                 cb->metadata,
-                                                 pme->mCallbackCookie);
-                                } else {
-                                    LOGW("data callback not set!");
-                                }
-                                if (cb->release_cb) {
-                                    cb->release_cb(cb->user_data, cb->cookie,
-                                            cbStatus);
-                                }
-                            }
-                            break;
-                        case QCAMERA_DATA_TIMESTAMP_CALLBACK:
-                            {
-                                if(pme->mDataCbTimestamp) {
-                                    pme->mDataCbTimestamp(cb->timestamp,
-                                                          cb->msg_type,
-                                                          cb->data,
-                                                          cb->index,
-                                                          pme->mCallbackCookie);
-                                } else {
-                                    LOGE("Timestamp data callback not set!");
-                                }
-                                if (cb->release_cb) {
-                                    cb->release_cb(cb->user_data, cb->cookie,
-                                            cbStatus);
-                                }
-                            }
-                            break;
-                        case QCAMERA_DATA_SNAPSHOT_CALLBACK:
-                            {
-                                if (TRUE == isSnapshotActive && pme->mDataCb ) {
-                                    if (!longShotEnabled) {
-                                        numOfSnapshotRcvd++;
-                                        LOGI("Num Snapshots Received = %d Expected = %d",
-                                                numOfSnapshotRcvd, numOfSnapshotExpected);
-                                        if (numOfSnapshotExpected > 0 &&
-                                           (numOfSnapshotExpected == numOfSnapshotRcvd)) {
-                                            LOGI("Received all snapshots");
-                                            // notify HWI that snapshot is done
-                                            pme->mParent->processSyncEvt(QCAMERA_SM_EVT_SNAPSHOT_DONE,
-                                                                         NULL);
-                                        }
-                                    }
-                                    if (pme->mJpegCb) {
-                                        LOGI("Calling JPEG Callback!! for camera %d"
-                                                "release_data %p",
-                                                "frame_idx %d",
-                                                 pme->mParent->getCameraId(),
-                                                cb->user_data,
-                                                cb->frame_index);
-                                        pme->mJpegCb(cb->msg_type, cb->data,
-                                                cb->index, cb->metadata,
-                                                pme->mJpegCallbackCookie,
-                                                cb->frame_index, cb->release_cb,
-                                                cb->cookie, cb->user_data);
-                                        // incase of non-null Jpeg cb we transfer
-                                        // ownership of buffer to muxer. hence
-                                        // release_cb should not be called
-                                        // muxer will release after its done with
-                                        // processing the buffer
-                                    } else if(pme->mDataCb){
-                                        pme->mDataCb(cb->msg_type, cb->data, cb->index,
-                                                cb->metadata, pme->mCallbackCookie);
-                                        if (cb->release_cb) {
-                                            cb->release_cb(cb->user_data, cb->cookie,
-                                                    cbStatus);
-                                        }
-                                    }
-                                }
-                            }
-                            break;
-                        default:
-                            {
-                                LOGE("invalid cb type %d",
-                                          cb->cb_type);
-                                cbStatus = BAD_VALUE;
-                                if (cb->release_cb) {
-                                    cb->release_cb(cb->user_data, cb->cookie,
-                                            cbStatus);
-                                }
-                            }
-                            break;
-                        };
-                    } else {
-                        LOGW("cb message type %d not enabled!",
-                                  cb->msg_type);
-                        cbStatus = INVALID_OPERATION;
-                        if (cb->release_cb) {
-                            cb->release_cb(cb->user_data, cb->cookie, cbStatus);
-                        }
-                    }
-                    delete cb;
-                } else {
-                    LOGW("invalid cb type passed");
-                }
-            }
-            break;
-        case CAMERA_CMD_TYPE_EXIT:
-            {
-                running = 0;
-                pme->mDataQ.flush();
-            }
-            break;
-        default:
-            break;
-        }
-    } while (running);
-    LOGD("X");
-
-    return NULL;
-}
-
-/*===========================================================================
- * FUNCTION   : notifyCallback
- *
- * DESCRIPTION: Enqueus pending callback notifications for the upper layers.
- *
- * PARAMETERS :
- *   @cbArgs  : callback arguments
- *
- * RETURN     : int32_t type of status
- *              NO_ERROR  -- success
- *              none-zero failure code
- *==========================================================================*/
-int32_t QCameraCbNotifier::notifyCallback(qcamera_callback_argm_t &cbArgs)
-{
-    if (!mActive) {
-        LOGE("notify thread is not active");
-        return UNKNOWN_ERROR;
-    }
-
-    qcamera_callback_argm_t *cbArg = new qcamera_callback_argm_t();
-    if (NULL == cbArg) {
-        LOGE("no mem for qcamera_callback_argm_t");
-        return NO_MEMORY;
-    }
-    memset(cbArg, 0, sizeof(qcamera_callback_argm_t));
-    *cbArg = cbArgs;
-
-    if (mDataQ.enqueue((void *)cbArg)) {
-        return mProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
-    } else {
-        LOGE("Error adding cb data into queue");
-        delete cbArg;
-        return UNKNOWN_ERROR;
-    }
-}
-
-/*===========================================================================
- * FUNCTION   : setCallbacks
- *
- * DESCRIPTION: Initializes the callback functions, which would be used for
- *              communication with the upper layers and launches the callback
- *              context in which the callbacks will occur.
- *
- * PARAMETERS :
- *   @notifyCb          : notification callback
- *   @dataCb            : data callback
- *   @dataCbTimestamp   : data with timestamp callback
- *   @callbackCookie    : callback context data
- *
- * RETURN     : None
- *==========================================================================*/
-void QCameraCbNotifier::setCallbacks(camera_notify_callback notifyCb,
-                                     camera_data_callback dataCb,
-                                     camera_data_timestamp_callback dataCbTimestamp,
-                                     void *callbackCookie)
-{
-    if ( ( NULL == mNotifyCb ) &&
-         ( NULL == mDataCb ) &&
-         ( NULL == mDataCbTimestamp ) &&
-         ( NULL == mCallbackCookie ) ) {
-        mNotifyCb = notifyCb;
-        mDataCb = dataCb;
-        mDataCbTimestamp = dataCbTimestamp;
-        mCallbackCookie = callbackCookie;
-        mActive = true;
-        mProcTh.launch(cbNotifyRoutine, this);
-    } else {
-        LOGE("Camera callback notifier already initialized!");
-    }
-}
-
-/*===========================================================================
- * FUNCTION   : setJpegCallBacks
- *
- * DESCRIPTION: Initializes the JPEG callback function, which would be used for
- *              communication with the upper layers and launches the callback
- *              context in which the callbacks will occur.
- *
- * PARAMETERS :
- *   @jpegCb          : notification callback
- *   @callbackCookie    : callback context data
- *
- * RETURN     : None
- *==========================================================================*/
-void QCameraCbNotifier::setJpegCallBacks(
-        jpeg_data_callback jpegCb, void *callbackCookie)
-{
-    LOGH("Setting JPEG Callback notifier");
-    mJpegCb        = jpegCb;
-    mJpegCallbackCookie  = callbackCookie;
-}
-
-/*===========================================================================
- * FUNCTION   : flushPreviewNotifications
- *
- * DESCRIPTION: flush all pending preview notifications
- *              from the notifier queue
- *
- * PARAMETERS : None
- *
- * RETURN     : int32_t type of status
- *              NO_ERROR  -- success
- *              none-zero failure code
- *==========================================================================*/
-int32_t QCameraCbNotifier::flushPreviewNotifications()
-{
-    if (!mActive) {
-        LOGE("notify thread is not active");
-        return UNKNOWN_ERROR;
-    }
-    mDataQ.flushNodes(matchPreviewNotifications);
-    return NO_ERROR;
-}
-
-/*===========================================================================
- * FUNCTION   : flushVideoNotifications
- *
- * DESCRIPTION: flush all pending video notifications
- *              from the notifier queue
- *
- * PARAMETERS : None
- *
- * RETURN     : int32_t type of status
- *              NO_ERROR  -- success
- *              none-zero failure code
- *==========================================================================*/
-int32_t QCameraCbNotifier::flushVideoNotifications()
-{
-    if (!mActive) {
-        LOGE("notify thread is not active");
-        return UNKNOWN_ERROR;
-    }
-    mDataQ.flushNodes(matchTimestampNotifications);
-    return NO_ERROR;
-}
-
-/*===========================================================================
- * FUNCTION   : startSnapshots
- *
- * DESCRIPTION: Enables snapshot mode
- *
- * PARAMETERS : None
- *
- * RETURN     : int32_t type of status
- *              NO_ERROR  -- success
- *              none-zero failure code
- *==========================================================================*/
-int32_t QCameraCbNotifier::startSnapshots()
-{
-    return mProcTh.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, FALSE, TRUE);
-}
-
-/*===========================================================================
- * FUNCTION   : stopSnapshots
- *
- * DESCRIPTION: Disables snapshot processing mode
- *
- * PARAMETERS : None
- *
- * RETURN     : None
- *==========================================================================*/
-void QCameraCbNotifier::stopSnapshots()
-{
-    mProcTh.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, FALSE, TRUE);
-}
-
 }; // namespace qcamera
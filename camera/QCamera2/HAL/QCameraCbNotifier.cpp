@@ -0,0 +1,742 @@
+/* Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#define LOG_TAG "QCamera2HWI"
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCamera2HWI.h"
+#include "QCameraTrace.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+namespace qcamera {
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraCbNotifier
+ *
+ * DESCRIPTION: Destructor for exiting the callback context.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraCbNotifier::~QCameraCbNotifier()
+{
+    flushPreviewSlot();
+    pthread_mutex_destroy(&mLaneLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : exit
+ *
+ * DESCRIPTION: exit notify thread.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::exit()
+{
+    mActive = false;
+    mProcTh.exit();
+}
+
+/*===========================================================================
+ * FUNCTION   : getLane
+ *
+ * DESCRIPTION: picks the lane a callback is queued on.
+ *
+ * PARAMETERS :
+ *   @cbArgs  : callback arguments
+ *
+ * RETURN     : lane of the callback
+ *==========================================================================*/
+qcamera_cb_lane_t QCameraCbNotifier::getLane(const qcamera_callback_argm_t &cbArgs)
+{
+    switch (cbArgs.cb_type) {
+    case QCAMERA_NOTIFY_CALLBACK:
+        return QCAMERA_CB_LANE_CONTROL;
+    case QCAMERA_DATA_TIMESTAMP_CALLBACK:
+        return QCAMERA_CB_LANE_VIDEO;
+    case QCAMERA_DATA_CALLBACK:
+        if (CAMERA_MSG_PREVIEW_FRAME == cbArgs.msg_type) {
+            return QCAMERA_CB_LANE_PREVIEW;
+        }
+        // raw, postview and metadata callbacks keep their order relative
+        // to the compressed image
+        return QCAMERA_CB_LANE_SNAPSHOT;
+    case QCAMERA_DATA_SNAPSHOT_CALLBACK:
+    default:
+        return QCAMERA_CB_LANE_SNAPSHOT;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getLaneQ
+ *
+ * DESCRIPTION: returns the queue of a lane.
+ *
+ * PARAMETERS :
+ *   @lane    : callback lane
+ *
+ * RETURN     : queue of the lane, NULL for the preview lane which only has
+ *              a single slot
+ *==========================================================================*/
+QCameraQueue *QCameraCbNotifier::getLaneQ(qcamera_cb_lane_t lane)
+{
+    switch (lane) {
+    case QCAMERA_CB_LANE_CONTROL:
+        return &mNotifyQ;
+    case QCAMERA_CB_LANE_SNAPSHOT:
+        return &mSnapshotQ;
+    case QCAMERA_CB_LANE_VIDEO:
+        return &mVideoQ;
+    default:
+        return NULL;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : dequeueNextCallback
+ *
+ * DESCRIPTION: takes the oldest callback of the highest priority lane that
+ *              has one and accounts for its queueing delay.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : callback to dispatch, NULL if all lanes are empty
+ *==========================================================================*/
+qcamera_callback_argm_t *QCameraCbNotifier::dequeueNextCallback()
+{
+    qcamera_callback_argm_t *cb = NULL;
+    uint32_t lane = 0;
+
+    for (lane = 0; lane < QCAMERA_CB_LANE_PREVIEW; lane++) {
+        cb = (qcamera_callback_argm_t *)
+                getLaneQ((qcamera_cb_lane_t)lane)->dequeue();
+        if (NULL != cb) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&mLaneLock);
+    if (NULL == cb) {
+        cb = mPreviewSlot;
+        mPreviewSlot = NULL;
+        lane = QCAMERA_CB_LANE_PREVIEW;
+    }
+    if (NULL != cb) {
+        qcamera_cb_lane_stats_t &stats = mLaneStats[lane];
+        int64_t delay = systemTime() - cb->enqueue_ts;
+        stats.dispatched++;
+        stats.total_delay_ns += delay;
+        if (delay > stats.max_delay_ns) {
+            stats.max_delay_ns = delay;
+        }
+    }
+    pthread_mutex_unlock(&mLaneLock);
+
+    return cb;
+}
+
+/*===========================================================================
+ * FUNCTION   : flushPreviewSlot
+ *
+ * DESCRIPTION: releases the preview frame waiting in the preview lane.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::flushPreviewSlot()
+{
+    pthread_mutex_lock(&mLaneLock);
+    qcamera_callback_argm_t *cb = mPreviewSlot;
+    mPreviewSlot = NULL;
+    pthread_mutex_unlock(&mLaneLock);
+
+    if (NULL != cb) {
+        releaseNotifications(cb, this);
+        delete cb;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseNotifications
+ *
+ * DESCRIPTION: callback for releasing data stored in the callback queue.
+ *
+ * PARAMETERS :
+ *   @data      : data to be released
+ *   @user_data : context data
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::releaseNotifications(void *data, void *user_data)
+{
+    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
+
+    if ( ( NULL != arg ) && ( NULL != user_data ) ) {
+        if ( arg->release_cb ) {
+            arg->release_cb(arg->user_data, arg->cookie, FAILED_TRANSACTION);
+        }
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : matchSnapshotNotifications
+ *
+ * DESCRIPTION: matches snapshot data callbacks
+ *
+ * PARAMETERS :
+ *   @data      : data to match
+ *   @user_data : context data
+ *
+ * RETURN     : bool match
+ *              true - match found
+ *              false- match not found
+ *==========================================================================*/
+bool QCameraCbNotifier::matchSnapshotNotifications(void *data,
+                                                   void */*user_data*/)
+{
+    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
+    if ( NULL != arg ) {
+        if ( QCAMERA_DATA_SNAPSHOT_CALLBACK == arg->cb_type ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*===========================================================================
+ * FUNCTION   : matchPreviewNotifications
+ *
+ * DESCRIPTION: matches preview data callbacks
+ *
+ * PARAMETERS :
+ *   @data      : data to match
+ *   @user_data : context data
+ *
+ * RETURN     : bool match
+ *              true - match found
+ *              false- match not found
+ *==========================================================================*/
+bool QCameraCbNotifier::matchPreviewNotifications(void *data,
+        void */*user_data*/)
+{
+    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
+    if (NULL != arg) {
+        if ((QCAMERA_DATA_CALLBACK == arg->cb_type) &&
+                (CAMERA_MSG_PREVIEW_FRAME == arg->msg_type)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*===========================================================================
+ * FUNCTION   : matchTimestampNotifications
+ *
+ * DESCRIPTION: matches timestamp data callbacks
+ *
+ * PARAMETERS :
+ *   @data      : data to match
+ *   @user_data : context data
+ *
+ * RETURN     : bool match
+ *              true - match found
+ *              false- match not found
+ *==========================================================================*/
+bool QCameraCbNotifier::matchTimestampNotifications(void *data,
+        void */*user_data*/)
+{
+    qcamera_callback_argm_t *arg = ( qcamera_callback_argm_t * ) data;
+    if (NULL != arg) {
+        if ((QCAMERA_DATA_TIMESTAMP_CALLBACK == arg->cb_type) &&
+                (CAMERA_MSG_VIDEO_FRAME == arg->msg_type)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*===========================================================================
+ * FUNCTION   : cbNotifyRoutine
+ *
+ * DESCRIPTION: callback thread which interfaces with the upper layers
+ *              given input commands.
+ *
+ * PARAMETERS :
+ *   @data    : context data
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void * QCameraCbNotifier::cbNotifyRoutine(void * data)
+{
+    int running = 1;
+    int ret;
+    QCameraCbNotifier *pme = (QCameraCbNotifier *)data;
+    QCameraCmdThread *cmdThread = &pme->mProcTh;
+    cmdThread->setName("CAM_cbNotify");
+    uint8_t isSnapshotActive = FALSE;
+    bool longShotEnabled = false;
+    uint32_t numOfSnapshotExpected = 0;
+    uint32_t numOfSnapshotRcvd = 0;
+    int32_t cbStatus = NO_ERROR;
+
+    LOGD("E");
+    do {
+        do {
+            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            if (ret != 0 && errno != EINVAL) {
+                LOGD("cam_sem_wait error (%s)",
+                            strerror(errno));
+                return NULL;
+            }
+        } while (ret != 0);
+
+        camera_cmd_type_t cmd = cmdThread->getCmd();
+        LOGD("get cmd %d", cmd);
+        switch (cmd) {
+        case CAMERA_CMD_TYPE_START_DATA_PROC:
+            {
+                isSnapshotActive = TRUE;
+                numOfSnapshotExpected = pme->mParent->numOfSnapshotsExpected();
+                longShotEnabled = pme->mParent->isLongshotEnabled();
+                LOGD("Num Snapshots Expected = %d",
+                       numOfSnapshotExpected);
+                numOfSnapshotRcvd = 0;
+            }
+            break;
+        case CAMERA_CMD_TYPE_STOP_DATA_PROC:
+            {
+                pme->mSnapshotQ.flushNodes(matchSnapshotNotifications);
+                isSnapshotActive = FALSE;
+
+                numOfSnapshotExpected = 0;
+                numOfSnapshotRcvd = 0;
+            }
+            break;
+        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
+            {
+                // A superseded or flushed preview frame leaves a job
+                // without a callback behind, which is simply skipped
+                qcamera_callback_argm_t *cb = pme->dequeueNextCallback();
+                cbStatus = NO_ERROR;
+                if (NULL != cb) {
+                    LOGD("cb type %d received",
+                              cb->cb_type);
+
+                    if (pme->mParent->msgTypeEnabledWithLock(cb->msg_type)) {
+                        switch (cb->cb_type) {
+                        case QCAMERA_NOTIFY_CALLBACK:
+                            {
+                                if (cb->msg_type == CAMERA_MSG_FOCUS) {
+                                    KPI_ATRACE_INT("Camera:AutoFocus", 0);
+                                    LOGH("[KPI Perf] : PROFILE_SENDING_FOCUS_EVT_TO APP");
+                                }
+                                if (pme->mNotifyCb) {
+                                    pme->mNotifyCb(cb->msg_type,
+                                                  cb->ext1,
+                                                  cb->ext2,
+                                                  pme->mCallbackCookie);
+                                } else {
+                                    LOGW("notify callback not set!");
+                                }
+                                if (cb->release_cb) {
+                                    cb->release_cb(cb->user_data, cb->cookie,
+                                            cbStatus);
+                                }
+                            }
+                            break;
+                        case QCAMERA_DATA_CALLBACK:
+                            {
+                                if (pme->mDataCb) {
+                                    pme->mDataCb(cb->msg_type,
+                                                 cb->data,
+                                                 cb->index,
+                                                 cb->metadata,
+                                                 pme->mCallbackCookie);
+                                } else {
+                                    LOGW("data callback not set!");
+                                }
+                                if (cb->release_cb) {
+                                    cb->release_cb(cb->user_data, cb->cookie,
+                                            cbStatus);
+                                }
+                            }
+                            break;
+                        case QCAMERA_DATA_TIMESTAMP_CALLBACK:
+                            {
+                                if(pme->mDataCbTimestamp) {
+                                    pme->mDataCbTimestamp(cb->timestamp,
+                                                          cb->msg_type,
+                                                          cb->data,
+                                                          cb->index,
+                                                          pme->mCallbackCookie);
+                                } else {
+                                    LOGE("Timestamp data callback not set!");
+                                }
+                                if (cb->release_cb) {
+                                    cb->release_cb(cb->user_data, cb->cookie,
+                                            cbStatus);
+                                }
+                            }
+                            break;
+                        case QCAMERA_DATA_SNAPSHOT_CALLBACK:
+                            {
+                                if (TRUE == isSnapshotActive && pme->mDataCb ) {
+                                    if (!longShotEnabled) {
+                                        numOfSnapshotRcvd++;
+                                        LOGI("Num Snapshots Received = %d Expected = %d",
+                                                numOfSnapshotRcvd, numOfSnapshotExpected);
+                                        if (numOfSnapshotExpected > 0 &&
+                                           (numOfSnapshotExpected == numOfSnapshotRcvd)) {
+                                            LOGI("Received all snapshots");
+                                            // notify HWI that snapshot is done
+                                            pme->mParent->processSyncEvt(QCAMERA_SM_EVT_SNAPSHOT_DONE,
+                                                                         NULL);
+                                        }
+                                    }
+                                    if (pme->mJpegCb) {
+                                        LOGI("Calling JPEG Callback!! for camera %d"
+                                                "release_data %p",
+                                                "frame_idx %d",
+                                                 pme->mParent->getCameraId(),
+                                                cb->user_data,
+                                                cb->frame_index);
+                                        pme->mJpegCb(cb->msg_type, cb->data,
+                                                cb->index, cb->metadata,
+                                                pme->mJpegCallbackCookie,
+                                                cb->frame_index, cb->release_cb,
+                                                cb->cookie, cb->user_data);
+                                        // incase of non-null Jpeg cb we transfer
+                                        // ownership of buffer to muxer. hence
+                                        // release_cb should not be called
+                                        // muxer will release after its done with
+                                        // processing the buffer
+                                    } else if(pme->mDataCb){
+                                        pme->mDataCb(cb->msg_type, cb->data, cb->index,
+                                                cb->metadata, pme->mCallbackCookie);
+                                        if (cb->release_cb) {
+                                            cb->release_cb(cb->user_data, cb->cookie,
+                                                    cbStatus);
+                                        }
+                                    }
+                                }
+                            }
+                            break;
+                        default:
+                            {
+                                LOGE("invalid cb type %d",
+                                          cb->cb_type);
+                                cbStatus = BAD_VALUE;
+                                if (cb->release_cb) {
+                                    cb->release_cb(cb->user_data, cb->cookie,
+                                            cbStatus);
+                                }
+                            }
+                            break;
+                        };
+                    } else {
+                        LOGW("cb message type %d not enabled!",
+                                  cb->msg_type);
+                        cbStatus = INVALID_OPERATION;
+                        if (cb->release_cb) {
+                            cb->release_cb(cb->user_data, cb->cookie, cbStatus);
+                        }
+                    }
+                    delete cb;
+                } else {
+                    LOGD("no pending callback");
+                }
+            }
+            break;
+        case CAMERA_CMD_TYPE_EXIT:
+            {
+                running = 0;
+                pme->mNotifyQ.flush();
+                pme->mSnapshotQ.flush();
+                pme->mVideoQ.flush();
+                pme->flushPreviewSlot();
+            }
+            break;
+        default:
+            break;
+        }
+    } while (running);
+    LOGD("X");
+
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : notifyCallback
+ *
+ * DESCRIPTION: Enqueus pending callback notifications for the upper layers.
+ *
+ * PARAMETERS :
+ *   @cbArgs  : callback arguments
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraCbNotifier::notifyCallback(qcamera_callback_argm_t &cbArgs)
+{
+    if (!mActive) {
+        LOGE("notify thread is not active");
+        return UNKNOWN_ERROR;
+    }
+
+    qcamera_callback_argm_t *cbArg = new qcamera_callback_argm_t();
+    if (NULL == cbArg) {
+        LOGE("no mem for qcamera_callback_argm_t");
+        return NO_MEMORY;
+    }
+    memset(cbArg, 0, sizeof(qcamera_callback_argm_t));
+    *cbArg = cbArgs;
+    cbArg->enqueue_ts = systemTime();
+
+    qcamera_cb_lane_t lane = getLane(cbArgs);
+    if (QCAMERA_CB_LANE_PREVIEW == lane) {
+        // Latest wins: a frame the app has not been handed yet is worthless
+        // once a newer one arrives, release it right away
+        pthread_mutex_lock(&mLaneLock);
+        qcamera_callback_argm_t *superseded = mPreviewSlot;
+        mPreviewSlot = cbArg;
+        if (NULL != superseded) {
+            mLaneStats[QCAMERA_CB_LANE_PREVIEW].superseded++;
+        }
+        pthread_mutex_unlock(&mLaneLock);
+
+        if (NULL != superseded) {
+            releaseNotifications(superseded, this);
+            delete superseded;
+            return NO_ERROR;
+        }
+        return mProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+    }
+
+    if (getLaneQ(lane)->enqueue((void *)cbArg)) {
+        return mProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+    } else {
+        LOGE("Error adding cb data into queue");
+        delete cbArg;
+        return UNKNOWN_ERROR;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getLaneStats
+ *
+ * DESCRIPTION: returns the queueing statistics of all callback lanes.
+ *
+ * PARAMETERS :
+ *   @stats   : array of QCAMERA_CB_LANE_MAX entries to fill
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::getLaneStats(qcamera_cb_lane_stats_t *stats)
+{
+    pthread_mutex_lock(&mLaneLock);
+    memcpy(stats, mLaneStats, sizeof(mLaneStats));
+    pthread_mutex_unlock(&mLaneLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : dump
+ *
+ * DESCRIPTION: dumps the queueing latency of the callback lanes.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : string with one line per lane
+ *==========================================================================*/
+String8 QCameraCbNotifier::dump()
+{
+    static const char *laneNames[QCAMERA_CB_LANE_MAX] = {
+        "control", "snapshot", "video", "preview" };
+    qcamera_cb_lane_stats_t stats[QCAMERA_CB_LANE_MAX];
+    String8 str("\n");
+    char s[128];
+
+    getLaneStats(stats);
+    for (uint32_t i = 0; i < QCAMERA_CB_LANE_MAX; i++) {
+        int64_t avgUs = stats[i].dispatched ?
+                (stats[i].total_delay_ns / stats[i].dispatched) / 1000 : 0;
+        snprintf(s, 128, "%s: dispatched %u superseded %u avg %lld us max %lld us\n",
+                laneNames[i], stats[i].dispatched, stats[i].superseded,
+                (long long)avgUs, (long long)(stats[i].max_delay_ns / 1000));
+        str += s;
+    }
+    return str;
+}
+
+/*===========================================================================
+ * FUNCTION   : setCallbacks
+ *
+ * DESCRIPTION: Initializes the callback functions, which would be used for
+ *              communication with the upper layers and launches the callback
+ *              context in which the callbacks will occur.
+ *
+ * PARAMETERS :
+ *   @notifyCb          : notification callback
+ *   @dataCb            : data callback
+ *   @dataCbTimestamp   : data with timestamp callback
+ *   @callbackCookie    : callback context data
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::setCallbacks(camera_notify_callback notifyCb,
+                                     camera_data_callback dataCb,
+                                     camera_data_timestamp_callback dataCbTimestamp,
+                                     void *callbackCookie)
+{
+    if ( ( NULL == mNotifyCb ) &&
+         ( NULL == mDataCb ) &&
+         ( NULL == mDataCbTimestamp ) &&
+         ( NULL == mCallbackCookie ) ) {
+        mNotifyCb = notifyCb;
+        mDataCb = dataCb;
+        mDataCbTimestamp = dataCbTimestamp;
+        mCallbackCookie = callbackCookie;
+        mActive = true;
+        mProcTh.launch(cbNotifyRoutine, this);
+    } else {
+        LOGE("Camera callback notifier already initialized!");
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : setJpegCallBacks
+ *
+ * DESCRIPTION: Initializes the JPEG callback function, which would be used for
+ *              communication with the upper layers and launches the callback
+ *              context in which the callbacks will occur.
+ *
+ * PARAMETERS :
+ *   @jpegCb          : notification callback
+ *   @callbackCookie    : callback context data
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::setJpegCallBacks(
+        jpeg_data_callback jpegCb, void *callbackCookie)
+{
+    LOGH("Setting JPEG Callback notifier");
+    mJpegCb        = jpegCb;
+    mJpegCallbackCookie  = callbackCookie;
+}
+
+/*===========================================================================
+ * FUNCTION   : flushPreviewNotifications
+ *
+ * DESCRIPTION: flush all pending preview notifications
+ *              from the notifier queue
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraCbNotifier::flushPreviewNotifications()
+{
+    if (!mActive) {
+        LOGE("notify thread is not active");
+        return UNKNOWN_ERROR;
+    }
+    flushPreviewSlot();
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : flushVideoNotifications
+ *
+ * DESCRIPTION: flush all pending video notifications
+ *              from the notifier queue
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraCbNotifier::flushVideoNotifications()
+{
+    if (!mActive) {
+        LOGE("notify thread is not active");
+        return UNKNOWN_ERROR;
+    }
+    mVideoQ.flushNodes(matchTimestampNotifications);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : startSnapshots
+ *
+ * DESCRIPTION: Enables snapshot mode
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraCbNotifier::startSnapshots()
+{
+    return mProcTh.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, FALSE, TRUE);
+}
+
+/*===========================================================================
+ * FUNCTION   : stopSnapshots
+ *
+ * DESCRIPTION: Disables snapshot processing mode
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCbNotifier::stopSnapshots()
+{
+    mProcTh.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, FALSE, TRUE);
+}
+
+}; // namespace qcamera
@@ -0,0 +1,333 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_TAG "QCameraStateMachine"
+
+// System dependencies
+#include <utils/Errors.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Camera dependencies
+#include "QCameraStateMachine.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+/*===========================================================================
+ * FUNCTION   : QCameraEvtBundlePool
+ *
+ * DESCRIPTION: constructor of QCameraEvtBundlePool, preallocates
+ *              QCAMERA_SM_EVT_BUNDLE_POOL_SIZE bundles.
+ *
+ * PARAMETERS :
+ *   @queue   : queue bundles are posted to
+ *   @sem     : semaphore posted along with a queued bundle
+ *
+ * RETURN     : none
+ *==========================================================================*/
+QCameraEvtBundlePool::QCameraEvtBundlePool(QCameraQueue *queue,
+        cam_semaphore_t *sem) :
+    m_queue(queue),
+    m_sem(sem),
+    m_free(NULL),
+    m_pending(NULL)
+{
+    pthread_mutex_init(&m_lock, NULL);
+    memset(&m_stats, 0, sizeof(m_stats));
+    for (uint32_t i = 0; i < QCAMERA_SM_EVT_BUNDLE_POOL_SIZE; i++) {
+        qcamera_sm_evt_bundle_entry_t *entry = (qcamera_sm_evt_bundle_entry_t *)
+                malloc(sizeof(qcamera_sm_evt_bundle_entry_t));
+        if (NULL == entry) {
+            LOGE("No memory for evt bundle pool");
+            break;
+        }
+        entry->pooled = true;
+        entry->next = m_free;
+        m_free = entry;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraEvtBundlePool
+ *
+ * DESCRIPTION: destructor of QCameraEvtBundlePool. Bundles still in the
+ *              queue have to be taken and released before.
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+QCameraEvtBundlePool::~QCameraEvtBundlePool()
+{
+    while (m_free != NULL) {
+        qcamera_sm_evt_bundle_entry_t *entry = m_free;
+        m_free = entry->next;
+        free(entry);
+    }
+    pthread_mutex_destroy(&m_lock);
+}
+
+/*===========================================================================
+ * FUNCTION   : getEntry
+ *
+ * DESCRIPTION: get the pool entry a bundle is embedded in.
+ *
+ * PARAMETERS :
+ *   @bundle  : bundle from get
+ *
+ * RETURN     : ptr to the entry
+ *==========================================================================*/
+qcamera_sm_evt_bundle_entry_t *QCameraEvtBundlePool::getEntry(
+        qcamera_sm_internal_evt_bundle_t *bundle)
+{
+    return (qcamera_sm_evt_bundle_entry_t *)
+            ((uint8_t *)bundle - offsetof(qcamera_sm_evt_bundle_entry_t, bundle));
+}
+
+/*===========================================================================
+ * FUNCTION   : get
+ *
+ * DESCRIPTION: get an empty internal event bundle to be filled from one
+ *              metadata frame and passed to post.
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : ptr to the bundle, NULL if out of memory
+ *==========================================================================*/
+qcamera_sm_internal_evt_bundle_t *QCameraEvtBundlePool::get()
+{
+    pthread_mutex_lock(&m_lock);
+    qcamera_sm_evt_bundle_entry_t *entry = m_free;
+    if (entry != NULL) {
+        m_free = entry->next;
+    } else {
+        m_stats.heapAllocs++;
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    if (entry == NULL) {
+        // Every pooled bundle is in flight, only happens when the state
+        // machine thread lags behind more than the merging can absorb
+        entry = (qcamera_sm_evt_bundle_entry_t *)
+                malloc(sizeof(qcamera_sm_evt_bundle_entry_t));
+        if (entry == NULL) {
+            LOGE("No memory for qcamera_sm_evt_bundle_entry_t");
+            return NULL;
+        }
+        entry->pooled = false;
+    }
+    entry->next = NULL;
+    entry->bundle.evt_mask = 0;
+    return &entry->bundle;
+}
+
+/*===========================================================================
+ * FUNCTION   : release
+ *
+ * DESCRIPTION: return a bundle to the pool.
+ *
+ * PARAMETERS :
+ *   @bundle  : bundle from get or take
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraEvtBundlePool::release(qcamera_sm_internal_evt_bundle_t *bundle)
+{
+    qcamera_sm_evt_bundle_entry_t *entry = getEntry(bundle);
+
+    if (!entry->pooled) {
+        free(entry);
+        return;
+    }
+    pthread_mutex_lock(&m_lock);
+    entry->next = m_free;
+    m_free = entry;
+    pthread_mutex_unlock(&m_lock);
+}
+
+/*===========================================================================
+ * FUNCTION   : post
+ *
+ * DESCRIPTION: queue the internal events of one metadata frame. If the
+ *              bundle of an earlier frame is still waiting in the queue,
+ *              the new payloads replace the older ones in it instead, so a
+ *              lagging state machine only sees the newest values. Focus
+ *              updates and prepare snapshot done are transitions and are
+ *              never overwritten; the bundle is queued on its own then.
+ *
+ * PARAMETERS :
+ *   @bundle  : bundle from get, ownership is passed in
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraEvtBundlePool::post(qcamera_sm_internal_evt_bundle_t *bundle)
+{
+    const uint32_t noMergeMask =
+            QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FOCUS_UPDATE) |
+            QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_PREP_SNAPSHOT_DONE);
+    qcamera_sm_evt_bundle_entry_t *entry = getEntry(bundle);
+
+    if (bundle->evt_mask == 0) {
+        release(bundle);
+        return NO_ERROR;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    if ((m_pending != NULL) &&
+            !(m_pending->bundle.evt_mask & bundle->evt_mask & noMergeMask)) {
+        merge(&m_pending->bundle, bundle);
+        m_stats.coalesced++;
+        pthread_mutex_unlock(&m_lock);
+        release(bundle);
+        return NO_ERROR;
+    }
+
+    memset(&entry->node, 0, sizeof(qcamera_sm_cmd_t));
+    entry->node.cmd = QCAMERA_SM_CMD_TYPE_EVT_BUNDLE;
+    entry->node.evt = QCAMERA_SM_EVT_EVT_INTERNAL;
+    entry->node.evt_payload = entry;
+    if (m_queue->enqueue((void *)&entry->node)) {
+        m_pending = entry;
+        m_stats.posted++;
+        pthread_mutex_unlock(&m_lock);
+        cam_sem_post(m_sem);
+        return NO_ERROR;
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    LOGE("EVENT enqueue failed for evt bundle");
+    release(bundle);
+    return UNKNOWN_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : take
+ *
+ * DESCRIPTION: take the bundle of a node dequeued from the queue. Later
+ *              posts no longer merge into it.
+ *
+ * PARAMETERS :
+ *   @node    : QCAMERA_SM_CMD_TYPE_EVT_BUNDLE node
+ *
+ * RETURN     : bundle to be dispatched and released
+ *==========================================================================*/
+qcamera_sm_internal_evt_bundle_t *QCameraEvtBundlePool::take(qcamera_sm_cmd_t *node)
+{
+    qcamera_sm_evt_bundle_entry_t *entry =
+            (qcamera_sm_evt_bundle_entry_t *)node->evt_payload;
+
+    pthread_mutex_lock(&m_lock);
+    if (m_pending == entry) {
+        m_pending = NULL;
+    }
+    pthread_mutex_unlock(&m_lock);
+    return &entry->bundle;
+}
+
+/*===========================================================================
+ * FUNCTION   : getStats
+ *
+ * DESCRIPTION: get the posting statistics of the pool.
+ *
+ * PARAMETERS :
+ *   @stats   : stats to fill
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraEvtBundlePool::getStats(qcamera_sm_evt_bundle_stats_t *stats)
+{
+    pthread_mutex_lock(&m_lock);
+    *stats = m_stats;
+    pthread_mutex_unlock(&m_lock);
+}
+
+/*===========================================================================
+ * FUNCTION   : merge
+ *
+ * DESCRIPTION: copy the valid payloads of a newer bundle over a queued one.
+ *
+ * PARAMETERS :
+ *   @dst     : queued bundle
+ *   @src     : newer bundle
+ *
+ * RETURN     : none
+ *
+ * NOTE       : called with m_lock held
+ *==========================================================================*/
+void QCameraEvtBundlePool::merge(qcamera_sm_internal_evt_bundle_t *dst,
+        const qcamera_sm_internal_evt_bundle_t *src)
+{
+    uint32_t mask = src->evt_mask;
+
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_HISTOGRAM_STATS)) {
+        dst->stats_data = src->stats_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT)) {
+        dst->faces_data = src->faces_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FOCUS_UPDATE)) {
+        dst->focus_data = src->focus_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_CROP_INFO)) {
+        dst->crop_data = src->crop_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_PREP_SNAPSHOT_DONE)) {
+        dst->prep_snapshot_state = src->prep_snapshot_state;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_HDR_UPDATE)) {
+        dst->hdr_data = src->hdr_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_ASD_UPDATE)) {
+        dst->asd_data = src->asd_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_AWB_UPDATE)) {
+        dst->awb_data = src->awb_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_AE_UPDATE)) {
+        dst->ae_data = src->ae_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_LED_MODE_OVERRIDE)) {
+        dst->led_data = src->led_data;
+    }
+    if (mask & QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FOCUS_POS_UPDATE)) {
+        dst->focus_pos = src->focus_pos;
+    }
+    dst->evt_mask |= mask;
+}
+
+}; // namespace qcamera
@@ -1914,15 +1914,12 @@ int QCameraGrallocMemory::displayBuffer(uint32_t index)
     int stride = 0;
     err = mWindow->dequeue_buffer(mWindow, &buffer_handle, &stride);
     if (err == NO_ERROR && buffer_handle != NULL) {
-        int i;
         LOGD("dequed buf hdl =%p", *buffer_handle);
-        for(i = 0; i < mMappableBuffers; i++) {
-            if(mBufferHandle[i] == buffer_handle) {
-                LOGD("Found buffer in idx:%d", i);
-                mLocalFlag[i] = BUFFER_OWNED;
-                dequeuedIdx = i;
-                break;
-            }
+        ssize_t mapIdx = mHandleIndexMap.indexOfKey(buffer_handle);
+        if (0 <= mapIdx) {
+            dequeuedIdx = mHandleIndexMap.valueAt(mapIdx);
+            LOGD("Found buffer in idx:%d", dequeuedIdx);
+            mLocalFlag[dequeuedIdx] = BUFFER_OWNED;
         }
 
         if ((dequeuedIdx == BAD_INDEX) && (mMappableBuffers < mBufferCount)) {
@@ -1962,6 +1959,7 @@ int QCameraGrallocMemory::displayBuffer(uint32_t index)
                     (size_t)mPrivateHandle[dequeuedIdx]->size;
             mMemInfo[dequeuedIdx].handle = ion_info_fd.handle;
 
+            mHandleIndexMap.add(buffer_handle, dequeuedIdx);
             mMappableBuffers++;
         }
     } else {
@@ -2030,15 +2028,12 @@ int32_t QCameraGrallocMemory::dequeueBuffer()
     dequeuedIdx = BAD_INDEX;
     err = mWindow->dequeue_buffer(mWindow, &buffer_handle, &stride);
     if ((err == NO_ERROR) && (buffer_handle != NULL)) {
-        int i;
         LOGD("dequed buf hdl =%p", *buffer_handle);
-        for(i = 0; i < mMappableBuffers; i++) {
-            if(mBufferHandle[i] == buffer_handle) {
-                LOGD("Found buffer in idx:%d", i);
-                mLocalFlag[i] = BUFFER_OWNED;
-                dequeuedIdx = i;
-                break;
-            }
+        ssize_t mapIdx = mHandleIndexMap.indexOfKey(buffer_handle);
+        if (0 <= mapIdx) {
+            dequeuedIdx = mHandleIndexMap.valueAt(mapIdx);
+            LOGD("Found buffer in idx:%d", dequeuedIdx);
+            mLocalFlag[dequeuedIdx] = BUFFER_OWNED;
         }
 
         if ((dequeuedIdx == BAD_INDEX) &&
@@ -2083,6 +2078,7 @@ int32_t QCameraGrallocMemory::dequeueBuffer()
                     (size_t)mPrivateHandle[dequeuedIdx]->size;
             mMemInfo[dequeuedIdx].handle = ion_info_fd.handle;
 
+            mHandleIndexMap.add(buffer_handle, dequeuedIdx);
             mMappableBuffers++;
         }
     } else {
@@ -2168,6 +2164,7 @@ int QCameraGrallocMemory::allocate(uint8_t count, size_t /*size*/,
         mMappableBuffers = count;
     }
 
+    mHandleIndexMap.clear();
     //Allocate cnt number of buffers from native window
     for (int cnt = 0; cnt < mMappableBuffers; cnt++) {
         int stride;
@@ -2272,6 +2269,7 @@ int QCameraGrallocMemory::allocate(uint8_t count, size_t /*size*/,
         mMemInfo[cnt].fd = mPrivateHandle[cnt]->fd;
         mMemInfo[cnt].size = (size_t)mPrivateHandle[cnt]->size;
         mMemInfo[cnt].handle = ion_info_fd.handle;
+        mHandleIndexMap.add(mBufferHandle[cnt], cnt);
     }
 
     //Cancel min_undequeued_buffer buffers back to the window
@@ -2283,6 +2281,7 @@ int QCameraGrallocMemory::allocate(uint8_t count, size_t /*size*/,
 end:
     if (ret != NO_ERROR) {
         mMappableBuffers = 0;
+        mHandleIndexMap.clear();
     }
     LOGD("X ");
     ATRACE_END();
@@ -2345,6 +2344,7 @@ void QCameraGrallocMemory::deallocate()
     }
     mBufferCount = 0;
     mMappableBuffers = 0;
+    mHandleIndexMap.clear();
     LOGD("X ",__FUNCTION__);
 }
 
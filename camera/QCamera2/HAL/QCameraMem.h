@@ -32,6 +32,7 @@
 
 // System dependencies
 #include <linux/msm_ion.h>
+#include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/List.h>
 
@@ -308,6 +309,8 @@ private:
     int mMinUndequeuedBuffers;
     enum ColorSpace_t mColorSpace;
     uint8_t mMappableBuffers;
+    // buffer handle to index of the buffers mapped so far
+    KeyedVector<buffer_handle_t *, int> mHandleIndexMap;
     pthread_mutex_t mLock;
     uint8_t mEnqueuedBuffers;
 };
@@ -922,6 +922,8 @@ QCameraParameters::QCameraParameters()
       m_bTNRPreviewOn(false),
       m_bTNRVideoOn(false),
       m_bTNRSnapshotOn(false),
+      m_bPowerTnrOff(false),
+      m_bPowerWnrOff(false),
       m_bInited(false),
       m_nRetroBurstNum(0),
       m_nBurstLEDOnPeriod(100),
@@ -1000,6 +1002,11 @@ QCameraParameters::QCameraParameters()
     property_get("persist.camera.ltmforseemore", value, "1");
     m_bLtmForSeeMoreEnabled = atoi(value);
 
+    memset(value, 0, sizeof(value));
+    property_get("persist.camera.param.incremental", value, "1");
+    m_bIncrementalUpdate = atoi(value) > 0 ? true : false;
+    m_nParamVersion = 0;
+
     memset(&m_LiveSnapshotSize, 0, sizeof(m_LiveSnapshotSize));
     memset(&m_default_fps_range, 0, sizeof(m_default_fps_range));
     memset(&m_hfrFpsRange, 0, sizeof(m_hfrFpsRange));
@@ -1056,6 +1063,8 @@ QCameraParameters::QCameraParameters(const String8 &params)
     m_bTNRPreviewOn(false),
     m_bTNRVideoOn(false),
     m_bTNRSnapshotOn(false),
+    m_bPowerTnrOff(false),
+    m_bPowerWnrOff(false),
     m_bInited(false),
     m_nRetroBurstNum(0),
     m_nBurstLEDOnPeriod(100),
@@ -1122,6 +1131,8 @@ QCameraParameters::QCameraParameters(const String8 &params)
     mBufBatchCnt = 0;
     mVideoBatchSize = 0;
     m_bOEMFeatEnabled = isOEMFeat1PropEnabled();
+    m_bIncrementalUpdate = false;
+    m_nParamVersion = 0;
 }
 
 /*===========================================================================
@@ -4355,6 +4366,7 @@ int32_t QCameraParameters::setZslMode(const QCameraParameters& params)
 int32_t QCameraParameters::setZslMode(bool value)
 {
     int32_t rc = NO_ERROR;
+    m_nParamVersion++;
     if(m_bForceZslMode) {
         if (!m_bZslMode) {
             // Force ZSL mode to ON
@@ -4582,6 +4594,9 @@ int32_t QCameraParameters::setTemporalDenoise(const QCameraParameters& params)
     if ((m_bTNRVideoOn != prev_video_tnr)
             || (m_bTNRPreviewOn != prev_preview_tnr)
             || (prev_snap_tnr != m_bTNRSnapshotOn)) {
+        if (m_bPowerTnrOff) {
+            temp.denoise_enable = 0;
+        }
         LOGD("TNR enabled = %d, plates = %d",
                 temp.denoise_enable, temp.process_plates);
         if (ADD_SET_PARAM_ENTRY_TO_BATCH(m_pParamBuf,
@@ -5045,6 +5060,155 @@ int32_t QCameraParameters::checkFeatureConcurrency()
     return rc;
 }
 
+/*===========================================================================
+ * Handlers which only read their own keys and compare them against the
+ * committed values. If every key changed by the app is listed here, only
+ * these handlers and their dependents are run instead of the full update.
+ * Any key not listed is assumed to affect everything and forces a full
+ * update.
+ *==========================================================================*/
+const QCameraParameters::QCameraParamHandler
+        QCameraParameters::INCREMENTAL_PARAM_HANDLERS[] = {
+    { KEY_ZOOM,                     &QCameraParameters::setZoom,
+            QCAMERA_PARAM_DEP_ADV_CAPTURE },
+    { KEY_QC_BRIGHTNESS,            &QCameraParameters::setBrightness,           0 },
+    { KEY_QC_SHARPNESS,             &QCameraParameters::setSharpness,            0 },
+    { KEY_QC_SATURATION,            &QCameraParameters::setSaturation,           0 },
+    { KEY_QC_CONTRAST,              &QCameraParameters::setContrast,             0 },
+    { KEY_QC_SCE_FACTOR,            &QCameraParameters::setSkinToneEnhancement,  0 },
+    { KEY_EXPOSURE_COMPENSATION,    &QCameraParameters::setExposureCompensation, 0 },
+    { KEY_AUTO_EXPOSURE_LOCK,       &QCameraParameters::setAecLock,              0 },
+    { KEY_AUTO_WHITEBALANCE_LOCK,   &QCameraParameters::setAwbLock,              0 },
+    { KEY_FOCUS_AREAS,              &QCameraParameters::setFocusAreas,           0 },
+    { KEY_METERING_AREAS,           &QCameraParameters::setMeteringAreas,        0 },
+    { KEY_ROTATION,                 &QCameraParameters::setRotation,             0 },
+    { KEY_JPEG_QUALITY,             &QCameraParameters::setJpegQuality,          0 },
+    { KEY_JPEG_THUMBNAIL_QUALITY,   &QCameraParameters::setJpegQuality,          0 },
+    { KEY_GPS_PROCESSING_METHOD,    &QCameraParameters::setGpsLocation,          0 },
+    { KEY_GPS_LATITUDE,             &QCameraParameters::setGpsLocation,          0 },
+    { KEY_QC_GPS_LATITUDE_REF,      &QCameraParameters::setGpsLocation,          0 },
+    { KEY_GPS_LONGITUDE,            &QCameraParameters::setGpsLocation,          0 },
+    { KEY_QC_GPS_LONGITUDE_REF,     &QCameraParameters::setGpsLocation,          0 },
+    { KEY_GPS_ALTITUDE,             &QCameraParameters::setGpsLocation,          0 },
+    { KEY_QC_GPS_ALTITUDE_REF,      &QCameraParameters::setGpsLocation,          0 },
+    { KEY_QC_GPS_STATUS,            &QCameraParameters::setGpsLocation,          0 },
+    { KEY_GPS_TIMESTAMP,            &QCameraParameters::setGpsLocation,          0 },
+};
+
+/*===========================================================================
+ * FUNCTION   : parseParamMap
+ *
+ * DESCRIPTION: split a flattened parameter string into a key/value map
+ *
+ * PARAMETERS :
+ *   @str     : flattened parameters "key1=value1;key2=value2"
+ *   @map     : [output] key/value map
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraParameters::parseParamMap(const String8 &str,
+        DefaultKeyedVector<String8,String8> &map)
+{
+    const char *a = str.string();
+    const char *b;
+
+    map.clear();
+    for (;;) {
+        // Find the bounds of the key name.
+        b = strchr(a, '=');
+        if (b == NULL) {
+            break;
+        }
+        String8 k(a, (size_t)(b - a));
+
+        // Find the value.
+        a = b + 1;
+        b = strchr(a, ';');
+        if (b == NULL) {
+            // If there's no semicolon, this is the last item.
+            map.replaceValueFor(k, String8(a));
+            break;
+        }
+        map.replaceValueFor(k, String8(a, (size_t)(b - a)));
+        a = b + 1;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getChangedParamHandlers
+ *
+ * DESCRIPTION: diff the parameters set by app against the committed ones
+ *              and collect the handlers of the changed keys
+ *
+ * PARAMETERS :
+ *   @appParams  : parameters set by app
+ *   @handlers   : [output] handlers to run, at least as many entries as
+ *                 INCREMENTAL_PARAM_HANDLERS
+ *   @handlerCnt : [output] number of handlers to run
+ *   @dependents : [output] mask of QCAMERA_PARAM_DEP_* to revalidate
+ *
+ * RETURN     : true  -- the changes can be applied incrementally
+ *              false -- a full parameter update is required
+ *==========================================================================*/
+bool QCameraParameters::getChangedParamHandlers(
+        const DefaultKeyedVector<String8,String8> &appParams,
+        const QCameraParamHandler **handlers, size_t &handlerCnt,
+        uint32_t &dependents)
+{
+    const size_t tableCnt = PARAM_MAP_SIZE(INCREMENTAL_PARAM_HANDLERS);
+
+    handlerCnt = 0;
+    dependents = 0;
+
+    if (!m_bIncrementalUpdate || m_lastAppParams.isEmpty()) {
+        return false;
+    }
+
+    // A key dropped by the app has to be handled by a full update
+    if (appParams.size() < m_lastAppParams.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < m_lastAppParams.size(); i++) {
+        if (appParams.indexOfKey(m_lastAppParams.keyAt(i)) < 0) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < appParams.size(); i++) {
+        const String8 &key = appParams.keyAt(i);
+        const String8 &value = appParams.valueAt(i);
+        const char *committed = get(key.string());
+        if ((committed != NULL) && (value == committed)) {
+            continue;
+        }
+
+        size_t j;
+        for (j = 0; j < tableCnt; j++) {
+            if (!strcmp(key.string(), INCREMENTAL_PARAM_HANDLERS[j].key)) {
+                break;
+            }
+        }
+        if (j == tableCnt) {
+            LOGD("%s changed, full parameter update needed", key.string());
+            return false;
+        }
+
+        const QCameraParamHandler *entry = &INCREMENTAL_PARAM_HANDLERS[j];
+        size_t k;
+        for (k = 0; k < handlerCnt; k++) {
+            if (handlers[k]->handler == entry->handler) {
+                break;
+            }
+        }
+        if (k == handlerCnt) {
+            handlers[handlerCnt++] = entry;
+        }
+        dependents |= entry->dependents;
+    }
+
+    return true;
+}
+
 /*===========================================================================
  * FUNCTION   : updateParameters
  *
@@ -5065,10 +5229,30 @@ int32_t QCameraParameters::updateParameters(const String8& p,
     int32_t rc;
     m_bNeedRestart = false;
     QCameraParameters params(p);
+    DefaultKeyedVector<String8,String8> appParams;
+    const QCameraParamHandler *handlers[PARAM_MAP_SIZE(INCREMENTAL_PARAM_HANDLERS)];
+    size_t handlerCnt = 0;
+    uint32_t dependents = 0;
+    bool incremental;
+
+    parseParamMap(p, appParams);
+    incremental = getChangedParamHandlers(appParams, handlers, handlerCnt,
+            dependents);
 
     if(initBatchUpdate(m_pParamBuf) < 0 ) {
         LOGE("Failed to initialize group update table");
-        rc = BAD_TYPE;
+        final_rc = BAD_TYPE;
+        goto UPDATE_PARAM_DONE;
+    }
+
+    if (incremental) {
+        LOGD("Applying %zu changed parameter handlers", handlerCnt);
+        for (size_t i = 0; i < handlerCnt; i++) {
+            if ((rc = (this->*(handlers[i]->handler))(params))) final_rc = rc;
+        }
+        if (dependents & QCAMERA_PARAM_DEP_ADV_CAPTURE) {
+            if ((rc = setAdvancedCaptureMode()))        final_rc = rc;
+        }
         goto UPDATE_PARAM_DONE;
     }
 
@@ -5168,6 +5352,13 @@ int32_t QCameraParameters::updateParameters(const String8& p,
 #endif
     if ((rc = setAdvancedCaptureMode()))                final_rc = rc;
 UPDATE_PARAM_DONE:
+    m_nParamVersion++;
+    // Only a clean update becomes the base for diffing the next one
+    if (final_rc == NO_ERROR) {
+        m_lastAppParams = appParams;
+    } else {
+        m_lastAppParams.clear();
+    }
     needRestart = m_bNeedRestart;
     return final_rc;
 }
@@ -5201,6 +5392,7 @@ int32_t QCameraParameters::commitParameters()
  *==========================================================================*/
 int32_t QCameraParameters::initDefaultParameters()
 {
+    m_nParamVersion++;
     if(initBatchUpdate(m_pParamBuf) < 0 ) {
         LOGE("Failed to initialize group update table");
         return BAD_TYPE;
@@ -6249,6 +6441,7 @@ TRANS_INIT_DONE:
  *==========================================================================*/
 void QCameraParameters::deinit()
 {
+    m_nParamVersion++;
     if (NULL != m_pParamHeap) {
         m_pParamHeap->deallocate();
         delete m_pParamHeap;
@@ -6287,6 +6480,7 @@ void QCameraParameters::deinit()
 
     m_AdjustFPS = NULL;
     m_tempMap.clear();
+    m_lastAppParams.clear();
     m_pCamOpsTbl = NULL;
     m_AdjustFPS = NULL;
 
@@ -9819,6 +10013,9 @@ int32_t QCameraParameters::setWaveletDenoise(const char *wnrStr)
             if (m_bWNROn) {
                 temp.process_plates = getDenoiseProcessPlate(CAM_INTF_PARM_WAVELET_DENOISE);
             }
+            if (m_bPowerWnrOff) {
+                temp.denoise_enable = 0;
+            }
             LOGD("Denoise enable=%d, plates=%d",
                    temp.denoise_enable, temp.process_plates);
             if (ADD_SET_PARAM_ENTRY_TO_BATCH(m_pParamBuf, CAM_INTF_PARM_WAVELET_DENOISE, temp)) {
@@ -9912,10 +10109,48 @@ int32_t QCameraParameters::getStreamRotation(cam_stream_type_t streamType,
                                             cam_pp_feature_config_t &featureConfig,
                                             cam_dimension_t &dim)
 {
-    int32_t ret = NO_ERROR;
+    return applyStreamRotation(streamType, getVideoRotation(), featureConfig, dim);
+}
+
+/*===========================================================================
+ * FUNCTION   : getVideoRotation
+ *
+ * DESCRIPTION: get video rotation configured by user
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : rotation in degrees,
+ *              NAME_NOT_FOUND if not set
+ *==========================================================================*/
+int QCameraParameters::getVideoRotation()
+{
     const char *str = get(KEY_QC_VIDEO_ROTATION);
-    int rotationParam = lookupAttr(VIDEO_ROTATION_MODES_MAP,
+    return lookupAttr(VIDEO_ROTATION_MODES_MAP,
             PARAM_MAP_SIZE(VIDEO_ROTATION_MODES_MAP), str);
+}
+
+/*===========================================================================
+ * FUNCTION   : applyStreamRotation
+ *
+ * DESCRIPTION: apply video rotation to the stream feature config
+ *
+ * PARAMETERS :
+ *   @streamType    : stream type
+ *   @videoRotation : video rotation from getVideoRotation
+ *   @featureConfig : stream feature configuration
+ *   @dim           : stream dimension, swapped for 90/270 rotation
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraParameters::applyStreamRotation(cam_stream_type_t streamType,
+                                            int videoRotation,
+                                            cam_pp_feature_config_t &featureConfig,
+                                            cam_dimension_t &dim)
+{
+    int32_t ret = NO_ERROR;
+    int rotationParam = videoRotation;
     featureConfig.rotation = ROTATE_0;
     int swapDim = 0;
     switch (streamType) {
@@ -10734,6 +10969,7 @@ void QCameraParameters::setJpegRotation(int rotation) {
     if (rotation == 0 || rotation == 90 ||
             rotation == 180 || rotation == 270) {
         mJpegRotation = (uint32_t)rotation;
+        m_nParamVersion++;
     }
 }
 
@@ -11485,6 +11721,82 @@ int32_t QCameraParameters::setFrameSkip(enum msm_vfe_frame_skip_pattern pattern)
     return rc;
 }
 
+/*===========================================================================
+ * FUNCTION   : setPowerDenoise
+ *
+ * DESCRIPTION: hold temporal and wavelet denoise off for the power governor.
+ *              The user settings are kept and come back once released.
+ *
+ * PARAMETERS :
+ *   @tnrOff : hold TNR off
+ *   @wnrOff : hold WNR off
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraParameters::setPowerDenoise(bool tnrOff, bool wnrOff)
+{
+    int32_t rc = NO_ERROR;
+    bool tnrChanged = (tnrOff != m_bPowerTnrOff) &&
+            ((m_pCapability->qcom_supported_feature_mask & CAM_QCOM_FEATURE_CPP_TNR) != 0);
+    bool wnrChanged = (wnrOff != m_bPowerWnrOff) &&
+            ((m_pCapability->qcom_supported_feature_mask & CAM_QCOM_FEATURE_DENOISE2D) != 0);
+
+    m_bPowerTnrOff = tnrOff;
+    m_bPowerWnrOff = wnrOff;
+    if (!tnrChanged && !wnrChanged) {
+        return NO_ERROR;
+    }
+
+    if ( m_pParamBuf == NULL ) {
+        return NO_INIT;
+    }
+
+    if(initBatchUpdate(m_pParamBuf) < 0 ) {
+        LOGE("Failed to initialize group update table");
+        return BAD_TYPE;
+    }
+
+    if (tnrChanged) {
+        cam_denoise_param_t temp;
+        memset(&temp, 0, sizeof(temp));
+        if (!tnrOff && (m_bTNRVideoOn || m_bTNRPreviewOn || m_bTNRSnapshotOn)) {
+            temp.denoise_enable = 1;
+            temp.process_plates = getDenoiseProcessPlate(
+                    CAM_INTF_PARM_TEMPORAL_DENOISE);
+        }
+        if (ADD_SET_PARAM_ENTRY_TO_BATCH(m_pParamBuf,
+                CAM_INTF_PARM_TEMPORAL_DENOISE, temp)) {
+            LOGE("Failed to update table");
+            return BAD_VALUE;
+        }
+    }
+
+    if (wnrChanged) {
+        cam_denoise_param_t temp;
+        memset(&temp, 0, sizeof(temp));
+        if (!wnrOff && m_bWNROn) {
+            temp.denoise_enable = 1;
+            temp.process_plates = getDenoiseProcessPlate(CAM_INTF_PARM_WAVELET_DENOISE);
+        }
+        if (ADD_SET_PARAM_ENTRY_TO_BATCH(m_pParamBuf,
+                CAM_INTF_PARM_WAVELET_DENOISE, temp)) {
+            LOGE("Failed to update table");
+            return BAD_VALUE;
+        }
+    }
+
+    LOGH("TNR %s, WNR %s by power governor", tnrOff ? "held off" : "released",
+            wnrOff ? "held off" : "released");
+    rc = commitSetBatch();
+    if (rc != NO_ERROR) {
+        LOGE("Failed to set denoise parm");
+    }
+
+    return rc;
+}
+
 /*===========================================================================
  * FUNCTION   : updateRAW
  *
@@ -12149,6 +12461,7 @@ int32_t QCameraParameters::updateParamEntry(const char *key, const char *value)
  *==========================================================================*/
 int32_t QCameraParameters::commitParamChanges()
 {
+    m_nParamVersion++;
     size_t size = m_tempMap.size();
     for (size_t i = 0; i < size; i++) {
         String8 k, v;
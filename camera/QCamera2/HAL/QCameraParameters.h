@@ -58,6 +58,10 @@ static const char ExifUndefinedPrefix[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 #define QCAMERA_MAX_EXP_TIME_LEVEL3      1000
 #define QCAMERA_MAX_EXP_TIME_LEVEL4      10000
 
+// Steps of the full parameter update that depend on other parameters and
+// have to be revalidated when a parameter they depend on changes
+#define QCAMERA_PARAM_DEP_ADV_CAPTURE    (1U << 0)
+
 class QCameraParameters: private CameraParameters
 {
 
@@ -645,6 +649,11 @@ public:
     int32_t getStreamRotation(cam_stream_type_t streamType,
                                cam_pp_feature_config_t &featureConfig,
                                cam_dimension_t &dim);
+    static int32_t applyStreamRotation(cam_stream_type_t streamType,
+                               int videoRotation,
+                               cam_pp_feature_config_t &featureConfig,
+                               cam_dimension_t &dim);
+    int getVideoRotation();
     int32_t getStreamFormat(cam_stream_type_t streamType,
                              cam_format_t &format);
     int32_t getStreamDimension(cam_stream_type_t streamType,
@@ -707,6 +716,7 @@ public:
     int32_t setHistogram(bool enabled);
     int32_t setFaceDetection(bool enabled, bool initCommit);
     int32_t setFrameSkip(enum msm_vfe_frame_skip_pattern pattern);
+    int32_t setPowerDenoise(bool tnrOff, bool wnrOff);
     qcamera_thermal_mode getThermalMode() {return m_ThermalMode;};
     int32_t updateRecordingHintValue(int32_t value);
     int32_t setHDRAEBracket(cam_exp_bracketing_t hdrBracket);
@@ -835,6 +845,8 @@ public:
             { return m_captureFrameConfig; };
     void setJpegRotation(int rotation);
     uint32_t getJpegRotation() { return mJpegRotation;};
+    // bumped whenever parameter values may have changed
+    uint32_t getParamVersion() { return m_nParamVersion;};
 
     void setLowLightLevel(cam_low_light_mode_t value)
             { m_LowLightLevel = value; };
@@ -1069,8 +1081,24 @@ private:
     // ops to tempororily update parameter entries and commit
     int32_t updateParamEntry(const char *key, const char *value);
     int32_t commitParamChanges();
+
+    // ops for applying only the parameters changed by the app
+    typedef int32_t (QCameraParameters::*paramHandler)(const QCameraParameters&);
+    typedef struct {
+        const char *key;
+        paramHandler handler;
+        uint32_t dependents;    // mask of QCAMERA_PARAM_DEP_* to revalidate
+    } QCameraParamHandler;
+    static void parseParamMap(const String8 &str,
+            DefaultKeyedVector<String8,String8> &map);
+    bool getChangedParamHandlers(const DefaultKeyedVector<String8,String8> &appParams,
+            const QCameraParamHandler **handlers, size_t &handlerCnt,
+            uint32_t &dependents);
     void updateViewAngles();
 
+    // Handlers that can be run on their own when only their keys change
+    static const QCameraParamHandler INCREMENTAL_PARAM_HANDLERS[];
+
     // Map from strings to values
     static const cam_dimension_t THUMBNAIL_SIZES_MAP[];
     static const QCameraMap<cam_auto_exposure_mode_type> AUTO_EXPOSURE_MAP[];
@@ -1142,6 +1170,8 @@ private:
     bool m_bTNRPreviewOn;
     bool m_bTNRVideoOn;
     bool m_bTNRSnapshotOn;
+    bool m_bPowerTnrOff;            // TNR held off by the power governor
+    bool m_bPowerWnrOff;            // WNR held off by the power governor
     bool m_bInited;
     int m_nRetroBurstNum;
     int m_nBurstLEDOnPeriod;
@@ -1171,6 +1201,9 @@ private:
     bool m_bHDR1xExtraBufferNeeded;     // if extra frame with exposure compensation 0 during HDR is needed
     bool m_bHDROutputCropEnabled;     // if HDR output frame need to be scaled to user resolution
     DefaultKeyedVector<String8,String8> m_tempMap; // map for temororily store parameters to be set
+    DefaultKeyedVector<String8,String8> m_lastAppParams; // last parameters set by app
+    bool m_bIncrementalUpdate; // if only changed parameters are applied
+    uint32_t m_nParamVersion;
     cam_fps_range_t m_default_fps_range;
     bool m_bAFBracketingOn;
     bool m_bReFocusOn;
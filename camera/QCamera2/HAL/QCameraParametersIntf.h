@@ -34,6 +34,7 @@
 #include <utils/Mutex.h>
 #include "cam_intf.h"
 #include "cam_types.h"
+#include "QCameraSeqSnapshot.h"
 #include "QCameraThermalAdapter.h"
 
 extern "C" {
@@ -58,6 +59,19 @@ public:
 
 class QCameraParameters;
 
+// Copy of the parameters queried per frame by the data callback threads
+typedef struct {
+    bool zslMode;
+    bool noDisplayMode;
+    bool recordingHint;
+    bool fpsDebugEnabled;
+    int previewMinFps;
+    int previewMaxFps;
+    int videoRotation;
+    uint32_t jpegRotation;
+    int flipMode[CAM_STREAM_TYPE_MAX];
+} QCameraParamSnapshot;
+
 class QCameraParametersIntf
 {
 public:
@@ -147,6 +161,7 @@ public:
     int32_t setHistogram(bool enabled);
     int32_t setFaceDetection(bool enabled, bool initCommit);
     int32_t setFrameSkip(enum msm_vfe_frame_skip_pattern pattern);
+    int32_t setPowerDenoise(bool tnrOff, bool wnrOff);
     qcamera_thermal_mode getThermalMode();
     int32_t updateRecordingHintValue(int32_t value);
     int32_t setHDRAEBracket(cam_exp_bracketing_t hdrBracket);
@@ -299,8 +314,25 @@ public:
         cam_feature_mask_t featureMask,
         cam_analysis_info_t *pAnalysisInfo);
 private:
+    // Holds mLock for a call into mImpl, republishing the snapshot on
+    // release if the call changed any parameter
+    class WriteLock {
+    public:
+        WriteLock(QCameraParametersIntf *intf) : mIntf(intf)
+                { mIntf->mLock.lock(); };
+        ~WriteLock() { mIntf->publishSnapshotLocked(); mIntf->mLock.unlock(); };
+    private:
+        QCameraParametersIntf *mIntf;
+    };
+
+    void publishSnapshotLocked();
+    bool readSnapshot(QCameraParamSnapshot &snapshot) const;
+
     QCameraParameters *mImpl;
     mutable Mutex mLock;
+
+    QCameraSeqSnapshot<QCameraParamSnapshot> mSnapshot;
+    uint32_t mSnapshotVersion;
 };
 
 }; // namespace qcamera
@@ -32,6 +32,7 @@
 
 // Camera dependencies
 #include "QCamera2HWI.h"
+#include "QCameraExifBuilder.h"
 
 extern "C" {
 #include "mm_camera_interface.h"
@@ -105,22 +106,11 @@ typedef struct {
 } qcamera_data_argm_t;
 
 #define MAX_EXIF_TABLE_ENTRIES 17
-class QCameraExif
+class QCameraExif : public QCameraExifBuilder
 {
 public:
-    QCameraExif();
-    virtual ~QCameraExif();
-
-    int32_t addEntry(exif_tag_id_t tagid,
-                     exif_tag_type_t type,
-                     uint32_t count,
-                     void *data);
-    uint32_t getNumOfEntries() {return m_nNumEntries;};
-    QEXIF_INFO_DATA *getEntries() {return m_Entries;};
-
-private:
-    QEXIF_INFO_DATA m_Entries[MAX_EXIF_TABLE_ENTRIES];  // exif tags for JPEG encoder
-    uint32_t  m_nNumEntries;                            // number of valid entries
+    QCameraExif() : QCameraExifBuilder(MAX_EXIF_TABLE_ENTRIES) {};
+    virtual ~QCameraExif() {};
 };
 
 class QCameraPostProcessor
@@ -0,0 +1,398 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_TAG "QCameraPowerGovernor"
+
+// System dependencies
+#include <stdlib.h>
+#include <time.h>
+#include <cutils/properties.h>
+
+// Camera dependencies
+#include "QCameraPowerGovernor.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+#define QCAMERA_PWR_LOAD_EWMA_WEIGHT 0.5f
+
+/*===========================================================================
+ * FUNCTION   : QCameraPowerGovernor
+ *
+ * DESCRIPTION: constructor of QCameraPowerGovernor
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraPowerGovernor::QCameraPowerGovernor() :
+    mEnabled(false),
+    mEpochMs(1000),
+    mLoadHighPct(150),
+    mLoadLowPct(80),
+    mMissPct(5),
+    mHoldEpochs(5),
+    mHorizonEpochs(3),
+    mThermalLevel(QCAMERA_THERMAL_NO_ADJUSTMENT),
+    mStep(QCAMERA_PWR_STEP_NOMINAL),
+    mFrameInterval(0),
+    mLastFrameTs(0),
+    mEpochStart(0),
+    mEpochCpuStart(0),
+    mFrames(0),
+    mMissed(0),
+    mLoadValid(false),
+    mLoadAvg(0.0f),
+    mPrevLoadAvg(0.0f),
+    mMissing(false),
+    mMissingHard(false),
+    mQuietEpochs(0)
+{
+    updateDecisionLocked();
+}
+
+/*===========================================================================
+ * FUNCTION   : init
+ *
+ * DESCRIPTION: read the governor tunables. With persist.camera.pwrgov.enable
+ *              set to 0 thermal levels are applied as they come, as before.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraPowerGovernor::init()
+{
+    char prop[PROPERTY_VALUE_MAX];
+
+    Mutex::Autolock l(mLock);
+    property_get("persist.camera.pwrgov.enable", prop, "1");
+    mEnabled = (atoi(prop) > 0);
+    property_get("persist.camera.pwrgov.epoch_ms", prop, "1000");
+    mEpochMs = (uint32_t)atoi(prop);
+    if (mEpochMs < 100) {
+        mEpochMs = 100;
+    }
+    property_get("persist.camera.pwrgov.load_hi", prop, "150");
+    mLoadHighPct = (uint32_t)atoi(prop);
+    property_get("persist.camera.pwrgov.load_lo", prop, "80");
+    mLoadLowPct = (uint32_t)atoi(prop);
+    property_get("persist.camera.pwrgov.miss_pct", prop, "5");
+    mMissPct = (uint32_t)atoi(prop);
+    property_get("persist.camera.pwrgov.hold", prop, "5");
+    mHoldEpochs = (uint32_t)atoi(prop);
+    property_get("persist.camera.pwrgov.horizon", prop, "3");
+    mHorizonEpochs = (uint32_t)atoi(prop);
+
+    LOGH("enabled %d epoch %u ms load %u/%u%% miss %u%% hold %u horizon %u",
+            mEnabled, mEpochMs, mLoadHighPct, mLoadLowPct, mMissPct,
+            mHoldEpochs, mHorizonEpochs);
+}
+
+/*===========================================================================
+ * FUNCTION   : reset
+ *
+ * DESCRIPTION: start over at the thermal floor, called when preview starts
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraPowerGovernor::reset()
+{
+    Mutex::Autolock l(mLock);
+    mStep = thermalFloor(mThermalLevel);
+    mFrameInterval = 0;
+    mLastFrameTs = 0;
+    mEpochStart = 0;
+    mFrames = 0;
+    mMissed = 0;
+    mLoadValid = false;
+    mMissing = false;
+    mMissingHard = false;
+    mQuietEpochs = 0;
+    updateDecisionLocked();
+}
+
+/*===========================================================================
+ * FUNCTION   : setFrameInterval
+ *
+ * DESCRIPTION: set the preview frame interval that deadlines are checked
+ *              against. 0 takes the interval from the next two frames.
+ *
+ * PARAMETERS :
+ *   @interval : expected interval between preview frames in ns
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraPowerGovernor::setFrameInterval(nsecs_t interval)
+{
+    Mutex::Autolock l(mLock);
+    mFrameInterval = interval;
+    // the gap across a rate change is not a miss
+    mLastFrameTs = 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : setThermalLevel
+ *
+ * DESCRIPTION: take a new thermal engine level. A higher level applies at
+ *              once, a lower one only lowers the floor that the governor
+ *              steps down to.
+ *
+ * PARAMETERS :
+ *   @level : thermal level
+ *
+ * RETURN     : true if the decision changed
+ *==========================================================================*/
+bool QCameraPowerGovernor::setThermalLevel(qcamera_thermal_level_enum_t level)
+{
+    Mutex::Autolock l(mLock);
+    qcamera_power_decision_t prev = mDecision;
+
+    mThermalLevel = level;
+    qcamera_power_step_t floor = thermalFloor(level);
+    if (mStep < floor) {
+        mStep = floor;
+        mQuietEpochs = 0;
+    }
+    updateDecisionLocked();
+
+    return (prev.step != mDecision.step) ||
+            (prev.perfLevel != mDecision.perfLevel) ||
+            (prev.fpsLevel != mDecision.fpsLevel);
+}
+
+/*===========================================================================
+ * FUNCTION   : onFrame
+ *
+ * DESCRIPTION: account one preview frame and close the epoch once it is
+ *              long enough. Frames arriving more than 1.5 intervals after
+ *              the previous one count the frames in between as missed.
+ *
+ * PARAMETERS :
+ *   @frameTs : frame timestamp in ns
+ *
+ * RETURN     : qcamera_power_evt_t
+ *==========================================================================*/
+qcamera_power_evt_t QCameraPowerGovernor::onFrame(nsecs_t frameTs)
+{
+    if (!mEnabled) {
+        return QCAMERA_PWR_EVT_NONE;
+    }
+
+    Mutex::Autolock l(mLock);
+    if ((mLastFrameTs > 0) && (frameTs > mLastFrameTs)) {
+        nsecs_t delta = frameTs - mLastFrameTs;
+        if (0 == mFrameInterval) {
+            mFrameInterval = delta;
+        } else if (delta * 2 > mFrameInterval * 3) {
+            mMissed += (uint32_t)((delta + mFrameInterval / 2) / mFrameInterval) - 1;
+        }
+    }
+    mLastFrameTs = frameTs;
+    mFrames++;
+
+    if (0 == mEpochStart) {
+        mEpochStart = frameTs;
+        mEpochCpuStart = processCpuTime();
+        return QCAMERA_PWR_EVT_NONE;
+    }
+    if ((frameTs - mEpochStart) < ms2ns(mEpochMs)) {
+        return QCAMERA_PWR_EVT_NONE;
+    }
+
+    qcamera_power_decision_t prev = mDecision;
+    evaluateLocked(frameTs);
+    if ((prev.step != mDecision.step) ||
+            (prev.perfLevel != mDecision.perfLevel) ||
+            (prev.fpsLevel != mDecision.fpsLevel)) {
+        return QCAMERA_PWR_EVT_CHANGED;
+    }
+    return QCAMERA_PWR_EVT_EPOCH;
+}
+
+/*===========================================================================
+ * FUNCTION   : getDecision
+ *
+ * DESCRIPTION: return the actions of the current step
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : qcamera_power_decision_t
+ *==========================================================================*/
+qcamera_power_decision_t QCameraPowerGovernor::getDecision()
+{
+    Mutex::Autolock l(mLock);
+    return mDecision;
+}
+
+/*===========================================================================
+ * FUNCTION   : thermalFloor
+ *
+ * DESCRIPTION: lowest step allowed at a thermal level
+ *
+ * PARAMETERS :
+ *   @level : thermal level
+ *
+ * RETURN     : qcamera_power_step_t
+ *==========================================================================*/
+qcamera_power_step_t QCameraPowerGovernor::thermalFloor(
+        qcamera_thermal_level_enum_t level)
+{
+    switch (level) {
+    case QCAMERA_THERMAL_SLIGHT_ADJUSTMENT:
+        return QCAMERA_PWR_STEP_SLIGHT;
+    case QCAMERA_THERMAL_BIG_ADJUSTMENT:
+        return QCAMERA_PWR_STEP_BIG;
+    case QCAMERA_THERMAL_MAX_ADJUSTMENT:
+    case QCAMERA_THERMAL_SHUTDOWN:
+        return QCAMERA_PWR_STEP_MAX;
+    case QCAMERA_THERMAL_NO_ADJUSTMENT:
+    default:
+        return QCAMERA_PWR_STEP_NOMINAL;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : processCpuTime
+ *
+ * DESCRIPTION: CPU time consumed by all threads of the process
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : time in ns
+ *==========================================================================*/
+nsecs_t QCameraPowerGovernor::processCpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return nsecs_t(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+/*===========================================================================
+ * FUNCTION   : evaluateLocked
+ *
+ * DESCRIPTION: close an epoch. The CPU load is smoothed and extrapolated
+ *              over the horizon; a predicted load above the high mark, or
+ *              misses while boosting is no longer allowed, climb one step.
+ *              Stepping down needs mHoldEpochs quiet epochs in a row and
+ *              never goes below the thermal floor.
+ *
+ * PARAMETERS :
+ *   @now : timestamp of the frame closing the epoch
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraPowerGovernor::evaluateLocked(nsecs_t now)
+{
+    nsecs_t cpuNow = processCpuTime();
+    float load = (float)(cpuNow - mEpochCpuStart) / (float)(now - mEpochStart);
+    uint32_t total = mFrames + mMissed;
+    uint32_t missPct = (total > 0) ? (mMissed * 100 / total) : 0;
+
+    if (mLoadValid) {
+        mPrevLoadAvg = mLoadAvg;
+        mLoadAvg += QCAMERA_PWR_LOAD_EWMA_WEIGHT * (load - mLoadAvg);
+    } else {
+        mPrevLoadAvg = mLoadAvg = load;
+        mLoadValid = true;
+    }
+    float predicted = mLoadAvg + (mLoadAvg - mPrevLoadAvg) * (float)mHorizonEpochs;
+
+    mMissing = (missPct > mMissPct);
+    mMissingHard = (missPct > 2 * mMissPct);
+    bool hot = (predicted * 100.0f > (float)mLoadHighPct);
+    bool quiet = !mMissing && (mLoadAvg * 100.0f < (float)mLoadLowPct);
+
+    if ((hot || (mMissing && (mStep > QCAMERA_PWR_STEP_NOMINAL))) &&
+            (mStep < QCAMERA_PWR_STEP_NO_WNR)) {
+        mStep = (qcamera_power_step_t)(mStep + 1);
+        mQuietEpochs = 0;
+    } else if (quiet) {
+        if ((++mQuietEpochs >= mHoldEpochs) &&
+                (mStep > thermalFloor(mThermalLevel))) {
+            mStep = (qcamera_power_step_t)(mStep - 1);
+            mQuietEpochs = 0;
+        }
+    } else {
+        mQuietEpochs = 0;
+    }
+
+    LOGD("load %.2f avg %.2f predicted %.2f, %u frames %u missed, step %d",
+            load, mLoadAvg, predicted, mFrames, mMissed, mStep);
+
+    mEpochStart = now;
+    mEpochCpuStart = cpuNow;
+    mFrames = 0;
+    mMissed = 0;
+    updateDecisionLocked();
+}
+
+/*===========================================================================
+ * FUNCTION   : updateDecisionLocked
+ *
+ * DESCRIPTION: derive the actions of the current step
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraPowerGovernor::updateDecisionLocked()
+{
+    mDecision.step = mStep;
+    mDecision.perfLevel = QCAMERA_PERF_LEVEL_NONE;
+    if ((QCAMERA_PWR_STEP_NOMINAL == mStep) && mMissing) {
+        mDecision.perfLevel = mMissingHard ?
+                QCAMERA_PERF_LEVEL_HIGH : QCAMERA_PERF_LEVEL_LOW;
+    }
+    mDecision.tnrOff = (mStep >= QCAMERA_PWR_STEP_NO_TNR);
+    mDecision.wnrOff = (mStep >= QCAMERA_PWR_STEP_NO_WNR);
+
+    if (((int)mThermalLevel < (int)QCAMERA_THERMAL_NO_ADJUSTMENT) ||
+            (mThermalLevel > QCAMERA_THERMAL_MAX_ADJUSTMENT)) {
+        // shutdown or unknown, handled by the thermal path as is
+        mDecision.fpsLevel = mThermalLevel;
+    } else if (mStep >= QCAMERA_PWR_STEP_MAX) {
+        mDecision.fpsLevel = QCAMERA_THERMAL_MAX_ADJUSTMENT;
+    } else if (mStep >= QCAMERA_PWR_STEP_BIG) {
+        mDecision.fpsLevel = QCAMERA_THERMAL_BIG_ADJUSTMENT;
+    } else if (mStep >= QCAMERA_PWR_STEP_SLIGHT) {
+        mDecision.fpsLevel = QCAMERA_THERMAL_SLIGHT_ADJUSTMENT;
+    } else {
+        mDecision.fpsLevel = QCAMERA_THERMAL_NO_ADJUSTMENT;
+    }
+}
+
+}; // namespace qcamera
@@ -0,0 +1,122 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_POWER_GOVERNOR_H__
+#define __QCAMERA_POWER_GOVERNOR_H__
+
+// System dependencies
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+
+// Camera dependencies
+#include "QCameraPerf.h"
+#include "QCameraThermalAdapter.h"
+
+namespace qcamera {
+
+/* Degradation steps, each one includes the ones below it. The thermal
+ * engine level sets the lowest step allowed; on top of that the governor
+ * climbs ahead of the engine when the predicted CPU load or the preview
+ * deadline misses call for it, and only steps down again after a run of
+ * quiet epochs. Without a thermal request it stops at NO_WNR, fps and
+ * frameskip stay with the thermal engine. */
+typedef enum {
+    QCAMERA_PWR_STEP_NOMINAL = 0,   // full quality, perf boost on misses
+    QCAMERA_PWR_STEP_NO_BOOST,      // perf boost withheld
+    QCAMERA_PWR_STEP_NO_TNR,        // temporal denoise off
+    QCAMERA_PWR_STEP_NO_WNR,        // wavelet denoise off
+    QCAMERA_PWR_STEP_SLIGHT,        // QCAMERA_THERMAL_SLIGHT_ADJUSTMENT fps
+    QCAMERA_PWR_STEP_BIG,           // QCAMERA_THERMAL_BIG_ADJUSTMENT fps
+    QCAMERA_PWR_STEP_MAX,           // QCAMERA_THERMAL_MAX_ADJUSTMENT fps
+} qcamera_power_step_t;
+
+typedef struct {
+    qcamera_power_step_t step;
+    qcamera_perf_level_t perfLevel;
+    qcamera_thermal_level_enum_t fpsLevel;  // level to adjust fps/frameskip by
+    bool tnrOff;
+    bool wnrOff;
+} qcamera_power_decision_t;
+
+typedef enum {
+    QCAMERA_PWR_EVT_NONE = 0,   // frame accounted
+    QCAMERA_PWR_EVT_EPOCH,      // epoch closed, decision unchanged
+    QCAMERA_PWR_EVT_CHANGED,    // epoch closed, decision changed
+} qcamera_power_evt_t;
+
+class QCameraPowerGovernor
+{
+public:
+    QCameraPowerGovernor();
+
+    void init();
+    bool isEnabled() const { return mEnabled; }
+    uint32_t getPerfHoldMs() const { return mEpochMs * 2; }
+    void reset();
+    void setFrameInterval(nsecs_t interval);
+    bool setThermalLevel(qcamera_thermal_level_enum_t level);
+    qcamera_power_evt_t onFrame(nsecs_t frameTs);
+    qcamera_power_decision_t getDecision();
+
+private:
+    static qcamera_power_step_t thermalFloor(qcamera_thermal_level_enum_t level);
+    static nsecs_t processCpuTime();
+    void evaluateLocked(nsecs_t now);
+    void updateDecisionLocked();
+
+    Mutex mLock;
+    bool mEnabled;
+    // tunables, persist.camera.pwrgov.*
+    uint32_t mEpochMs;
+    uint32_t mLoadHighPct;      // predicted load to climb at, % of one core
+    uint32_t mLoadLowPct;       // load to count an epoch as quiet
+    uint32_t mMissPct;          // deadline misses to react to, % of frames
+    uint32_t mHoldEpochs;       // quiet epochs before stepping down
+    uint32_t mHorizonEpochs;    // epochs the load trend is extrapolated
+    // state
+    qcamera_thermal_level_enum_t mThermalLevel;
+    qcamera_power_step_t mStep;
+    qcamera_power_decision_t mDecision;
+    nsecs_t mFrameInterval;
+    nsecs_t mLastFrameTs;
+    nsecs_t mEpochStart;
+    nsecs_t mEpochCpuStart;
+    uint32_t mFrames;
+    uint32_t mMissed;
+    bool mLoadValid;
+    float mLoadAvg;
+    float mPrevLoadAvg;
+    bool mMissing;
+    bool mMissingHard;
+    uint32_t mQuietEpochs;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_POWER_GOVERNOR_H__ */
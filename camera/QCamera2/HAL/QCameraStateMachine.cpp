@@ -31,6 +31,7 @@
 
 // System dependencies
 #include <utils/Errors.h>
+#include <stddef.h>
 #include <stdio.h>
 
 // Camera dependencies
@@ -91,6 +92,17 @@ void *QCameraStateMachine::smEvtProcRoutine(void *data)
                 free(node->evt_payload);
                 node->evt_payload = NULL;
                 break;
+            case QCAMERA_SM_CMD_TYPE_EVT_BUNDLE:
+                {
+                    // node is embedded in the bundle entry, which goes back
+                    // to the pool instead of being freed
+                    qcamera_sm_internal_evt_bundle_t *bundle =
+                            pme->m_evtBundles.take(node);
+                    pme->dispatchEvtBundle(bundle);
+                    pme->m_evtBundles.release(bundle);
+                    node = NULL;
+                }
+                break;
             case QCAMERA_SM_CMD_TYPE_EXIT:
                 running = 0;
                 break;
@@ -117,11 +129,13 @@ void *QCameraStateMachine::smEvtProcRoutine(void *data)
  *==========================================================================*/
 QCameraStateMachine::QCameraStateMachine(QCamera2HardwareInterface *ctrl) :
     api_queue(),
-    evt_queue()
+    evt_queue(),
+    m_evtBundles(&evt_queue, &cmd_sem)
 {
     m_parent = ctrl;
     m_state = QCAMERA_SM_STATE_PREVIEW_STOPPED;
     cmd_pid = 0;
+
     cam_sem_init(&cmd_sem, 0);
     pthread_create(&cmd_pid,
                    NULL,
@@ -145,6 +159,18 @@ QCameraStateMachine::QCameraStateMachine(QCamera2HardwareInterface *ctrl) :
  *==========================================================================*/
 QCameraStateMachine::~QCameraStateMachine()
 {
+    // Bundles still queued are part of the pool, take them back before the
+    // queue frees its nodes
+    qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)evt_queue.dequeue();
+    while (node != NULL) {
+        if (node->cmd == QCAMERA_SM_CMD_TYPE_EVT_BUNDLE) {
+            m_evtBundles.release(m_evtBundles.take(node));
+        } else {
+            free(node->evt_payload);
+            free(node);
+        }
+        node = (qcamera_sm_cmd_t *)evt_queue.dequeue();
+    }
     cam_sem_destroy(&cmd_sem);
 }
 
@@ -282,6 +308,115 @@ int32_t QCameraStateMachine::procEvt(qcamera_sm_evt_enum_t evt,
     }
 }
 
+/*===========================================================================
+ * FUNCTION   : getEvtBundle
+ *
+ * DESCRIPTION: get an empty internal event bundle to be filled from one
+ *              metadata frame and passed to procEvtBundle.
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : ptr to the bundle, NULL if out of memory
+ *==========================================================================*/
+qcamera_sm_internal_evt_bundle_t *QCameraStateMachine::getEvtBundle()
+{
+    return m_evtBundles.get();
+}
+
+/*===========================================================================
+ * FUNCTION   : procEvtBundle
+ *
+ * DESCRIPTION: queue the internal events of one metadata frame, merged into
+ *              the bundle of an earlier frame if that one is still waiting,
+ *              see QCameraEvtBundlePool::post.
+ *
+ * PARAMETERS :
+ *   @bundle  : bundle from getEvtBundle, ownership is passed in
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraStateMachine::procEvtBundle(qcamera_sm_internal_evt_bundle_t *bundle)
+{
+    return m_evtBundles.post(bundle);
+}
+
+/*===========================================================================
+ * FUNCTION   : dispatchEvtBundle
+ *
+ * DESCRIPTION: run the payloads of a bundle through the state machine as
+ *              QCAMERA_SM_EVT_EVT_INTERNAL events, in the order the metadata
+ *              callback used to post them.
+ *
+ * PARAMETERS :
+ *   @bundle  : bundle to process
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraStateMachine::dispatchEvtBundle(qcamera_sm_internal_evt_bundle_t *bundle)
+{
+    static const qcamera_internal_evt_type_t order[] = {
+        QCAMERA_INTERNAL_EVT_HISTOGRAM_STATS,
+        QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT,
+        QCAMERA_INTERNAL_EVT_FOCUS_UPDATE,
+        QCAMERA_INTERNAL_EVT_CROP_INFO,
+        QCAMERA_INTERNAL_EVT_PREP_SNAPSHOT_DONE,
+        QCAMERA_INTERNAL_EVT_HDR_UPDATE,
+        QCAMERA_INTERNAL_EVT_ASD_UPDATE,
+        QCAMERA_INTERNAL_EVT_AWB_UPDATE,
+        QCAMERA_INTERNAL_EVT_AE_UPDATE,
+        QCAMERA_INTERNAL_EVT_LED_MODE_OVERRIDE,
+        QCAMERA_INTERNAL_EVT_FOCUS_POS_UPDATE,
+    };
+    qcamera_sm_internal_evt_payload_t payload;
+
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        if (!(bundle->evt_mask & QCAMERA_INTERNAL_EVT_BIT(order[i]))) {
+            continue;
+        }
+        payload.evt_type = order[i];
+        switch (order[i]) {
+        case QCAMERA_INTERNAL_EVT_HISTOGRAM_STATS:
+            payload.stats_data = bundle->stats_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT:
+            payload.faces_data = bundle->faces_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_FOCUS_UPDATE:
+            payload.focus_data = bundle->focus_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_CROP_INFO:
+            payload.crop_data = bundle->crop_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_PREP_SNAPSHOT_DONE:
+            payload.prep_snapshot_state = bundle->prep_snapshot_state;
+            break;
+        case QCAMERA_INTERNAL_EVT_HDR_UPDATE:
+            payload.hdr_data = bundle->hdr_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_ASD_UPDATE:
+            payload.asd_data = bundle->asd_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_AWB_UPDATE:
+            payload.awb_data = bundle->awb_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_AE_UPDATE:
+            payload.ae_data = bundle->ae_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_LED_MODE_OVERRIDE:
+            payload.led_data = bundle->led_data;
+            break;
+        case QCAMERA_INTERNAL_EVT_FOCUS_POS_UPDATE:
+            payload.focus_pos = bundle->focus_pos;
+            break;
+        default:
+            break;
+        }
+        stateMachine(QCAMERA_SM_EVT_EVT_INTERNAL, &payload);
+    }
+}
+
 /*===========================================================================
  * FUNCTION   : stateMachine
  *
@@ -3874,6 +4009,12 @@ String8 QCameraStateMachine::dump()
     }
     str += s;
 
+    qcamera_sm_evt_bundle_stats_t bundleStats;
+    m_evtBundles.getStats(&bundleStats);
+    snprintf(s, 128, "Evt bundles posted: %u coalesced: %u heap allocs: %u\n",
+            bundleStats.posted, bundleStats.coalesced, bundleStats.heapAllocs);
+    str += s;
+
     return str;
 }
 
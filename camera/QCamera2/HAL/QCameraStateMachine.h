@@ -183,6 +183,85 @@ typedef struct {
     };
 } qcamera_sm_internal_evt_payload_t;
 
+// Number of preallocated per-frame internal event bundles
+#define QCAMERA_SM_EVT_BUNDLE_POOL_SIZE 4
+
+#define QCAMERA_INTERNAL_EVT_BIT(evt_type) (1U << (evt_type))
+
+/* Bundle of the internal events derived from one metadata frame. Only the
+ * payloads flagged in evt_mask are valid. Bundles come from the pool of the
+ * state machine (getEvtBundle) and are handed back with procEvtBundle. */
+typedef struct {
+    uint32_t evt_mask;                      // QCAMERA_INTERNAL_EVT_BIT of valid payloads
+    cam_hist_stats_t stats_data;
+    cam_faces_data_t faces_data;
+    cam_auto_focus_data_t focus_data;
+    cam_crop_data_t crop_data;
+    cam_prep_snapshot_state_t prep_snapshot_state;
+    cam_asd_hdr_scene_data_t hdr_data;
+    cam_asd_decision_t asd_data;
+    cam_awb_params_t awb_data;
+    cam_3a_params_t ae_data;
+    cam_flash_mode_t led_data;
+    cam_focus_pos_info_t focus_pos;
+} qcamera_sm_internal_evt_bundle_t;
+
+typedef enum
+{
+    QCAMERA_SM_CMD_TYPE_API,                   // cmd from API
+    QCAMERA_SM_CMD_TYPE_EVT,                   // cmd from mm-camera-interface/mm-jpeg-interface event
+    QCAMERA_SM_CMD_TYPE_EVT_BUNDLE,            // per-frame internal evt bundle
+    QCAMERA_SM_CMD_TYPE_EXIT,                  // cmd for exiting statemachine cmdThread
+    QCAMERA_SM_CMD_TYPE_MAX
+} qcamera_sm_cmd_type_t;
+
+typedef struct {
+    qcamera_sm_cmd_type_t cmd;                  // cmd type (where it comes from)
+    qcamera_sm_evt_enum_t evt;                  // event type
+    void *evt_payload;                          // ptr to payload
+} qcamera_sm_cmd_t;
+
+typedef struct evt_bundle_entry {
+    qcamera_sm_cmd_t node;                      // evt_queue node
+    qcamera_sm_internal_evt_bundle_t bundle;
+    bool pooled;                                // false if allocated on pool shortage
+    struct evt_bundle_entry *next;              // free list link
+} qcamera_sm_evt_bundle_entry_t;
+
+typedef struct {
+    uint32_t posted;                            // bundles queued
+    uint32_t coalesced;                         // bundles merged into a queued one
+    uint32_t heapAllocs;                        // bundles allocated on pool shortage
+} qcamera_sm_evt_bundle_stats_t;
+
+/* Pool of the internal event bundles and the coalescing of them into the
+ * event queue of the state machine. Bundles are posted from the metadata
+ * callback and taken back by the state machine thread once dequeued. */
+class QCameraEvtBundlePool
+{
+public:
+    QCameraEvtBundlePool(QCameraQueue *queue, cam_semaphore_t *sem);
+    virtual ~QCameraEvtBundlePool();
+    qcamera_sm_internal_evt_bundle_t *get();
+    int32_t post(qcamera_sm_internal_evt_bundle_t *bundle);
+    qcamera_sm_internal_evt_bundle_t *take(qcamera_sm_cmd_t *node);
+    void release(qcamera_sm_internal_evt_bundle_t *bundle);
+    void getStats(qcamera_sm_evt_bundle_stats_t *stats);
+    static void merge(qcamera_sm_internal_evt_bundle_t *dst,
+            const qcamera_sm_internal_evt_bundle_t *src);
+
+private:
+    static qcamera_sm_evt_bundle_entry_t *getEntry(
+            qcamera_sm_internal_evt_bundle_t *bundle);
+
+    QCameraQueue *m_queue;                    // evt_queue of the state machine
+    cam_semaphore_t *m_sem;                   // cmd_sem of the state machine
+    pthread_mutex_t m_lock;                   // free list, pending bundle and stats
+    qcamera_sm_evt_bundle_entry_t *m_free;    // free list of pooled bundles
+    qcamera_sm_evt_bundle_entry_t *m_pending; // queued bundle not yet dequeued
+    qcamera_sm_evt_bundle_stats_t m_stats;
+};
+
 class QCameraStateMachine
 {
 public:
@@ -190,6 +269,8 @@ public:
     virtual ~QCameraStateMachine();
     int32_t procAPI(qcamera_sm_evt_enum_t evt, void *api_payload);
     int32_t procEvt(qcamera_sm_evt_enum_t evt, void *evt_payload);
+    qcamera_sm_internal_evt_bundle_t *getEvtBundle();
+    int32_t procEvtBundle(qcamera_sm_internal_evt_bundle_t *bundle);
 
     bool isPreviewRunning(); // check if preview is running
     bool isPreviewReady(); // check if preview is ready
@@ -215,20 +296,6 @@ private:
         QCAMERA_SM_STATE_PREVIEW_PIC_TAKING        // taking ZSL/live snapshot (recording stopped but preview running)
     } qcamera_state_enum_t;
 
-    typedef enum
-    {
-        QCAMERA_SM_CMD_TYPE_API,                   // cmd from API
-        QCAMERA_SM_CMD_TYPE_EVT,                   // cmd from mm-camera-interface/mm-jpeg-interface event
-        QCAMERA_SM_CMD_TYPE_EXIT,                  // cmd for exiting statemachine cmdThread
-        QCAMERA_SM_CMD_TYPE_MAX
-    } qcamera_sm_cmd_type_t;
-
-    typedef struct {
-        qcamera_sm_cmd_type_t cmd;                  // cmd type (where it comes from)
-        qcamera_sm_evt_enum_t evt;                  // event type
-        void *evt_payload;                          // ptr to payload
-    } qcamera_sm_cmd_t;
-
     int32_t stateMachine(qcamera_sm_evt_enum_t evt, void *payload);
     int32_t procEvtPreviewStoppedState(qcamera_sm_evt_enum_t evt, void *payload);
     int32_t procEvtPreviewReadyState(qcamera_sm_evt_enum_t evt, void *payload);
@@ -243,6 +310,7 @@ private:
     static void *smEvtProcRoutine(void *data);
 
     int32_t applyDelayedMsgs();
+    void dispatchEvtBundle(qcamera_sm_internal_evt_bundle_t *bundle);
 
     QCamera2HardwareInterface *m_parent;  // ptr to HWI
     qcamera_state_enum_t m_state;         // statemachine state
@@ -256,6 +324,8 @@ private:
     int32_t m_DelayedMsgs;
     bool m_RestoreZSL;
     bool m_bPreviewCallbackNeeded;
+
+    QCameraEvtBundlePool m_evtBundles;    // per-frame internal evt bundles
 };
 
 }; // namespace qcamera
@@ -865,6 +865,11 @@ int32_t QCameraStream::start()
 {
     int32_t rc = 0;
     mDataQ.init();
+
+    char prop[PROPERTY_VALUE_MAX];
+    memset(prop, 0, sizeof(prop));
+    property_get("persist.camera.cmd.coalesce", prop, "0");
+    mProcTh.setCoalesceNextJob(atoi(prop) > 0);
     rc = mProcTh.launch(dataProcRoutine, this);
     if (rc == NO_ERROR) {
         m_bActive = true;
@@ -1114,17 +1119,21 @@ void *QCameraStream::dataProcRoutine(void *data)
         case CAMERA_CMD_TYPE_DO_NEXT_JOB:
             {
                 LOGH("Do next job");
-                mm_camera_super_buf_t *frame =
-                    (mm_camera_super_buf_t *)pme->mDataQ.dequeue();
-                if (NULL != frame) {
-                    if (pme->mDataCB != NULL) {
-                        pme->mDataCB(frame, pme, pme->mUserData);
-                    } else {
-                        // no data cb routine, return buf here
-                        pme->bufDone(frame->bufs[0]->buf_idx);
-                        free(frame);
+                // with coalescing one DO_NEXT_JOB may stand for many frames
+                bool drain = cmdThread->getCoalesceNextJob();
+                mm_camera_super_buf_t *frame = NULL;
+                do {
+                    frame = (mm_camera_super_buf_t *)pme->mDataQ.dequeue();
+                    if (NULL != frame) {
+                        if (pme->mDataCB != NULL) {
+                            pme->mDataCB(frame, pme, pme->mUserData);
+                        } else {
+                            // no data cb routine, return buf here
+                            pme->bufDone(frame->bufs[0]->buf_idx);
+                            free(frame);
+                        }
                     }
-                }
+                } while (drain && (NULL != frame));
             }
             break;
         case CAMERA_CMD_TYPE_EXIT:
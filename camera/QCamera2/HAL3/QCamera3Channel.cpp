@@ -44,6 +44,9 @@
 // Camera dependencies
 #include "QCamera3Channel.h"
 #include "QCamera3HWI.h"
+#include "QCameraBufferMaps.h"
+#include "QCameraFrameDumper.h"
+#include "QCameraFrameTracer.h"
 #include "QCameraTrace.h"
 #include "QCameraFormat.h"
 extern "C" {
@@ -525,24 +528,30 @@ void QCamera3Channel::dumpYUV(mm_camera_buf_def_t *frame, cam_dimension_t dim,
                 * If you feel that the image would have been rotated during reprocess
                 * then swap the dimensions while opening the file
                 * */
+                const char *tag = NULL;
                 switch (dump_type) {
                     case QCAMERA_DUMP_FRM_PREVIEW:
+                        tag = "p";
                         snprintf(buf, sizeof(buf), QCAMERA_DUMP_FRM_LOCATION"p_%d_%d_%dx%d.yuv",
                             counter, frame->frame_idx, dim.width, dim.height);
                     break;
                     case QCAMERA_DUMP_FRM_VIDEO:
+                        tag = "v";
                         snprintf(buf, sizeof(buf), QCAMERA_DUMP_FRM_LOCATION"v_%d_%d_%dx%d.yuv",
                             counter, frame->frame_idx, dim.width, dim.height);
                     break;
                     case QCAMERA_DUMP_FRM_SNAPSHOT:
+                        tag = "s";
                         snprintf(buf, sizeof(buf), QCAMERA_DUMP_FRM_LOCATION"s_%d_%d_%dx%d.yuv",
                             counter, frame->frame_idx, dim.width, dim.height);
                     break;
                     case QCAMERA_DUMP_FRM_INPUT_REPROCESS:
+                        tag = "ir";
                         snprintf(buf, sizeof(buf), QCAMERA_DUMP_FRM_LOCATION"ir_%d_%d_%dx%d.yuv",
                             counter, frame->frame_idx, dim.width, dim.height);
                     break;
                     case QCAMERA_DUMP_FRM_CALLBACK:
+                        tag = "c";
                         snprintf(buf, sizeof(buf), QCAMERA_DUMP_FRM_LOCATION"c_%d_%d_%dx%d.yuv",
                             counter, frame->frame_idx, dim.width, dim.height);
                     break;
@@ -551,6 +560,25 @@ void QCamera3Channel::dumpYUV(mm_camera_buf_def_t *frame, cam_dimension_t dim,
                     break;
                 }
                 counter++;
+                if ((tag != NULL) && QCameraFrameDumper::getInstance()->isEnabled()) {
+                    QCamera3Stream *stream = getStreamByIndex(0);
+                    qcamera_dump_desc_t desc;
+                    memset(&desc, 0, sizeof(desc));
+                    desc.cameraId = ((QCamera3HardwareInterface *)mUserData)->getCameraId();
+                    desc.dumpType = dump_type;
+                    desc.format = CAM_FORMAT_MAX;
+                    desc.streamType = CAM_STREAM_TYPE_DEFAULT;
+                    // the input reprocess frame does not belong to our stream
+                    if ((stream != NULL) && (dump_type != QCAMERA_DUMP_FRM_INPUT_REPROCESS)) {
+                        desc.streamType = stream->getMyType();
+                        stream->getFormat(desc.format);
+                    }
+                    desc.dim = dim;
+                    desc.tag = tag;
+                    QCameraFrameDumper::getInstance()->dumpFrame(desc, frame, offset);
+                    mDumpFrmCnt++;
+                    return;
+                }
                 int file_fd = open(buf, O_RDWR | O_CREAT, 0777);
                 ssize_t written_len = 0;
                 if (file_fd >= 0) {
@@ -1012,7 +1040,12 @@ int32_t QCamera3ProcessingChannel::request(buffer_handle_t *buffer,
             return rc;
         }
         LOGH("Post-process started");
-        m_postprocessor.processData(src_frame);
+        rc = m_postprocessor.processData(src_frame);
+        if (NO_ERROR != rc) {
+            LOGE("Error %d while scheduling framework reprocess", rc);
+            free(src_frame);
+            return rc;
+        }
     } else {
         //need to fill output buffer with new data and return
         if(!m_bIsActive) {
@@ -1079,11 +1112,8 @@ int32_t QCamera3ProcessingChannel::initialize(__unused cam_is_type_t isType)
     rc = mOfflineMetaMemory.allocateAll(sizeof(metadata_buffer_t));
     if (rc == NO_ERROR) {
         Mutex::Autolock lock(mFreeOfflineMetaBuffersLock);
-        mFreeOfflineMetaBuffersList.clear();
-        for (uint32_t i = 0; i < mNumBuffers + (MAX_REPROCESS_PIPELINE_STAGES - 1);
-                i++) {
-            mFreeOfflineMetaBuffersList.push_back(i);
-        }
+        mFreeOfflineMetaBuffers.setAll(
+                mNumBuffers + (MAX_REPROCESS_PIPELINE_STAGES - 1));
     } else {
         LOGE("Could not allocate offline meta buffers for input reprocess");
     }
@@ -1185,41 +1215,161 @@ int32_t QCamera3ProcessingChannel::setFwkInputPPData(qcamera_fwk_input_pp_data_t
     }
     dumpYUV(&src_frame->input_buffer, reproc_cfg->input_stream_dim,
             reproc_cfg->input_stream_plane_info.plane_info, QCAMERA_DUMP_FRM_INPUT_REPROCESS);
+
+    mm_camera_buf_def_t meta_buf;
+    QCamera3ReprocMetaPool *pool = getReprocMetaPool();
+    if ((NULL != pool) && pool->isShared(metadata)) {
+        // Settings were translated into a shared ion slot, map it as is
+        cam_dimension_t dim = {sizeof(metadata_buffer_t), 1};
+        cam_stream_buf_plane_info_t meta_planes;
+        rc = mm_stream_calc_offset_metadata(&dim, &mPaddingInfo, &meta_planes);
+        if (rc != 0) {
+            LOGE("Metadata stream plane info calculation failed!");
+            return rc;
+        }
+        rc = pool->ref(metadata, meta_planes.plane_info, meta_buf);
+        if (NO_ERROR != rc) {
+            return rc;
+        }
+    } else {
+        rc = getOfflineMetaBuffer(frameNumber, meta_buf);
+        if (NO_ERROR != rc) {
+            return rc;
+        }
+        QCamera3ReprocMetaPool::copyMeta((metadata_buffer_t *)meta_buf.buffer,
+                metadata);
+    }
+    src_frame->metadata_buffer = meta_buf;
+    src_frame->reproc_config = *reproc_cfg;
+    src_frame->output_buffer = output_buffer;
+    src_frame->frameNumber = frameNumber;
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : getOfflineMetaBuffer
+ *
+ * DESCRIPTION: take a private offline metadata buffer for a request
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *   @meta_buf    : output buffer definition
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3ProcessingChannel::getOfflineMetaBuffer(uint32_t frameNumber,
+        mm_camera_buf_def_t &meta_buf)
+{
     cam_dimension_t dim = {sizeof(metadata_buffer_t), 1};
     cam_stream_buf_plane_info_t meta_planes;
-    rc = mm_stream_calc_offset_metadata(&dim, &mPaddingInfo, &meta_planes);
+    int32_t rc = mm_stream_calc_offset_metadata(&dim, &mPaddingInfo, &meta_planes);
     if (rc != 0) {
         LOGE("Metadata stream plane info calculation failed!");
         return rc;
     }
-    uint32_t metaBufIdx;
+
+    int32_t metaBufIdx;
     {
         Mutex::Autolock lock(mFreeOfflineMetaBuffersLock);
-        if (mFreeOfflineMetaBuffersList.empty()) {
-            LOGE("mFreeOfflineMetaBuffersList is null. Fatal");
+        metaBufIdx = mFreeOfflineMetaBuffers.get();
+        if (metaBufIdx < 0) {
+            LOGE("No free offline meta buffer. Fatal");
             return BAD_VALUE;
         }
+        LOGD("taking %d, free offline meta buffers %d", metaBufIdx,
+                mFreeOfflineMetaBuffers.size());
+    }
+
+    mOfflineMetaMemory.markFrameNumber((uint32_t)metaBufIdx, frameNumber);
 
-        metaBufIdx = *(mFreeOfflineMetaBuffersList.begin());
-        mFreeOfflineMetaBuffersList.erase(mFreeOfflineMetaBuffersList.begin());
-        LOGD("erasing %d, mFreeOfflineMetaBuffersList.size %d", metaBufIdx,
-                mFreeOfflineMetaBuffersList.size());
+    rc = mOfflineMetaMemory.getBufDef(meta_planes.plane_info, meta_buf,
+            (uint32_t)metaBufIdx);
+    if (NO_ERROR != rc) {
+        mOfflineMetaMemory.markFrameNumber((uint32_t)metaBufIdx, -1);
+        Mutex::Autolock lock(mFreeOfflineMetaBuffersLock);
+        mFreeOfflineMetaBuffers.put((uint32_t)metaBufIdx);
     }
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : privatizeOfflineMeta
+ *
+ * DESCRIPTION: copy-on-write of shared reprocess metadata. Called before a
+ *              reprocess channel overrides entries of the frame metadata;
+ *              the sole holder of a shared slot writes in place, otherwise
+ *              the slot is copied into a private offline meta buffer.
+ *
+ * PARAMETERS :
+ *   @frame   : framework input frame to be reprocessed
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3ProcessingChannel::privatizeOfflineMeta(
+        qcamera_fwk_input_pp_data_t *frame)
+{
+    QCamera3ReprocMetaPool *pool = getReprocMetaPool();
+    metadata_buffer_t *shared = (metadata_buffer_t *)frame->metadata_buffer.buffer;
 
-    mOfflineMetaMemory.markFrameNumber(metaBufIdx, frameNumber);
+    if ((NULL == pool) || (pool->getRefCount(shared) <= 1)) {
+        return NO_ERROR;
+    }
 
     mm_camera_buf_def_t meta_buf;
-    cam_frame_len_offset_t offset = meta_planes.plane_info;
-    rc = mOfflineMetaMemory.getBufDef(offset, meta_buf, metaBufIdx);
+    int32_t rc = getOfflineMetaBuffer(frame->frameNumber, meta_buf);
     if (NO_ERROR != rc) {
         return rc;
     }
-    memcpy(meta_buf.buffer, metadata, sizeof(metadata_buffer_t));
-    src_frame->metadata_buffer = meta_buf;
-    src_frame->reproc_config = *reproc_cfg;
-    src_frame->output_buffer = output_buffer;
-    src_frame->frameNumber = frameNumber;
-    return rc;
+    QCamera3ReprocMetaPool::copyMeta((metadata_buffer_t *)meta_buf.buffer, shared);
+    pool->unref(shared);
+    frame->metadata_buffer = meta_buf;
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseOfflineMeta
+ *
+ * DESCRIPTION: release the reprocess metadata held for a request, either
+ *              the private offline meta buffer or the shared slot reference
+ *
+ * PARAMETERS :
+ *   @resultFrameNumber : frame number of the request
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ProcessingChannel::releaseOfflineMeta(uint32_t resultFrameNumber)
+{
+    int32_t metaBufIndex =
+            mOfflineMetaMemory.getHeapBufferIndex(resultFrameNumber);
+    if (0 <= metaBufIndex) {
+        mOfflineMetaMemory.markFrameNumber((uint32_t)metaBufIndex, -1);
+        Mutex::Autolock lock(mFreeOfflineMetaBuffersLock);
+        mFreeOfflineMetaBuffers.put((uint32_t)metaBufIndex);
+    } else if (NULL != getReprocMetaPool()) {
+        getReprocMetaPool()->unrefFrame(resultFrameNumber);
+    } else {
+        LOGW("Could not find offline meta buffer, resultFrameNumber %d",
+                resultFrameNumber);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getReprocMetaPool
+ *
+ * DESCRIPTION: shared reprocess metadata pool of the camera session
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : pool pointer, NULL if not available
+ *==========================================================================*/
+QCamera3ReprocMetaPool *QCamera3ProcessingChannel::getReprocMetaPool()
+{
+    QCamera3HardwareInterface *hw = (QCamera3HardwareInterface *)mUserData;
+    return (NULL != hw) ? hw->getReprocMetaPool() : NULL;
 }
 
 /*===========================================================================
@@ -1316,10 +1466,7 @@ void QCamera3ProcessingChannel::putStreamBufs()
     /* Reclaim all the offline metabuffers and push them to free list */
     {
         Mutex::Autolock lock(mFreeOfflineMetaBuffersLock);
-        mFreeOfflineMetaBuffersList.clear();
-        for (uint32_t i = 0; i < mOfflineMetaMemory.getCnt(); i++) {
-            mFreeOfflineMetaBuffersList.push_back(i);
-        }
+        mFreeOfflineMetaBuffers.setAll(mOfflineMetaMemory.getCnt());
     }
 }
 
@@ -1376,15 +1523,18 @@ void QCamera3ProcessingChannel::startPostProc(const reprocess_config_t &config)
  *
  * DESCRIPTION: queue the reprocess metadata to the postprocessor
  *
- * PARAMETERS : metadata : the metadata corresponding to the pp frame
+ * PARAMETERS :
+ *   @metadata    : the metadata corresponding to the pp frame
+ *   @frameNumber : frame number of the request
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
  *              none-zero failure code
  *==========================================================================*/
-int32_t QCamera3ProcessingChannel::queueReprocMetadata(mm_camera_super_buf_t *metadata)
+int32_t QCamera3ProcessingChannel::queueReprocMetadata(mm_camera_super_buf_t *metadata,
+        uint32_t frameNumber)
 {
-    return m_postprocessor.processPPMetadata(metadata);
+    return m_postprocessor.processPPMetadata(metadata, frameNumber);
 }
 
 /*===========================================================================
@@ -1600,27 +1750,70 @@ void QCamera3ProcessingChannel::reprocessCbRoutine(buffer_handle_t *resultBuffer
  * PARAMETERS :
  * @resultBuffer      : buffer containing the data
  * @resultFrameNumber : frame number on which the buffer was requested
+ * @status            : buffer status, an error is notified to the
+ *                      framework before the buffer is returned
  *
  * RETURN     : NONE
  *
  *
  *==========================================================================*/
 void QCamera3ProcessingChannel::issueChannelCb(buffer_handle_t *resultBuffer,
-        uint32_t resultFrameNumber)
+        uint32_t resultFrameNumber, camera3_buffer_status_t status)
 {
     camera3_stream_buffer_t result;
     //Use below data to issue framework callback
     result.stream = mCamera3Stream;
     result.buffer = resultBuffer;
-    result.status = CAMERA3_BUFFER_STATUS_OK;
+    result.status = status;
     result.acquire_fence = -1;
     result.release_fence = -1;
 
+    if (CAMERA3_BUFFER_STATUS_ERROR == status) {
+        QCamera3HardwareInterface* hal_obj = (QCamera3HardwareInterface*)mUserData;
+        hal_obj->notifyError(resultFrameNumber, CAMERA3_MSG_ERROR_BUFFER,
+                mCamera3Stream);
+        mChannelCbBufErr(this, resultFrameNumber, status, mUserData);
+    }
+
     if (mChannelCB) {
         mChannelCB(NULL, &result, resultFrameNumber, false, mUserData);
     }
 }
 
+/*===========================================================================
+ * FUNCTION   : returnDroppedRequest
+ *
+ * DESCRIPTION: return the output buffer of a request the postprocessor
+ *              dropped before reprocess, with an error
+ *
+ * PARAMETERS :
+ * @frameNumber : frame number of the dropped request
+ * @input       : its input frame, NULL if it never came. Owned by the
+ *                channel on return.
+ *
+ * RETURN     : NONE
+ *==========================================================================*/
+void QCamera3ProcessingChannel::returnDroppedRequest(uint32_t frameNumber,
+        mm_camera_super_buf_t *input)
+{
+    if (NULL != input) {
+        bufDone(input);
+        free(input);
+    }
+
+    int32_t bufIdx = mMemory.getBufferIndex(frameNumber);
+    if (bufIdx < 0) {
+        LOGE("No pending buffer for dropped frame %u", frameNumber);
+        return;
+    }
+
+    buffer_handle_t *resultBuffer =
+            (buffer_handle_t *)mMemory.getBufferHandle((uint32_t)bufIdx);
+    mMemory.markFrameNumber((uint32_t)bufIdx, -1);
+    LOGE("Returning dropped frame %u with error", frameNumber);
+    issueChannelCb(resultBuffer, frameNumber, CAMERA3_BUFFER_STATUS_ERROR);
+}
+
 /*===========================================================================
  * FUNCTION   : showDebugFPS
  *
@@ -1695,15 +1888,7 @@ int32_t QCamera3ProcessingChannel::releaseOfflineMemory(uint32_t resultFrameNumb
         LOGE("Failed to unregister offline input buffer");
     }
 
-    int32_t metaBufIndex =
-            mOfflineMetaMemory.getHeapBufferIndex(resultFrameNumber);
-    if (0 <= metaBufIndex) {
-        Mutex::Autolock lock(mFreeOfflineMetaBuffersLock);
-        mFreeOfflineMetaBuffersList.push_back((uint32_t)metaBufIndex);
-    } else {
-        LOGW("Could not find offline meta buffer, resultFrameNumber %d",
-                resultFrameNumber);
-    }
+    releaseOfflineMeta(resultFrameNumber);
 
     return rc;
 }
@@ -2202,6 +2387,20 @@ void QCamera3RawChannel::dumpRawSnapshot(mm_camera_buf_def_t *frame)
        cam_frame_len_offset_t offset;
        memset(&offset, 0, sizeof(cam_frame_len_offset_t));
        stream->getFrameOffset(offset);
+       if (QCameraFrameDumper::getInstance()->isEnabled()) {
+           qcamera_dump_desc_t desc;
+           memset(&desc, 0, sizeof(desc));
+           desc.cameraId = ((QCamera3HardwareInterface *)mUserData)->getCameraId();
+           desc.dumpType = QCAMERA_DUMP_FRM_RAW;
+           desc.streamType = stream->getMyType();
+           desc.format = CAM_FORMAT_MAX;
+           stream->getFormat(desc.format);
+           desc.dim.width = offset.mp[0].stride;
+           desc.dim.height = offset.mp[0].scanline;
+           desc.tag = "r";
+           QCameraFrameDumper::getInstance()->dumpLinear(desc, frame, frame->frame_len);
+           return;
+       }
        snprintf(buf, sizeof(buf), QCAMERA_DUMP_FRM_LOCATION"r_%d_%dx%d.raw",
                 frame->frame_idx, offset.mp[0].stride, offset.mp[0].scanline);
 
@@ -2404,6 +2603,20 @@ void QCamera3RawDumpChannel::dumpRawSnapshot(mm_camera_buf_def_t *frame)
         memset(&offset, 0, sizeof(cam_frame_len_offset_t));
         stream->getFrameOffset(offset);
 
+        if (QCameraFrameDumper::getInstance()->isEnabled()) {
+            qcamera_dump_desc_t desc;
+            memset(&desc, 0, sizeof(desc));
+            desc.cameraId = ((QCamera3HardwareInterface *)mUserData)->getCameraId();
+            desc.dumpType = QCAMERA_DUMP_FRM_RAW;
+            desc.streamType = stream->getMyType();
+            desc.format = CAM_FORMAT_MAX;
+            stream->getFormat(desc.format);
+            desc.dim = dim;
+            desc.tag = "r";
+            QCameraFrameDumper::getInstance()->dumpLinear(desc, frame, offset.frame_len);
+            return;
+        }
+
         gettimeofday(&tv, NULL);
         timeinfo = localtime_r(&tv.tv_sec, &timeinfo_data);
 
@@ -2955,6 +3168,67 @@ void QCamera3YUVChannel::reprocessCbRoutine(buffer_handle_t *resultBuffer,
 
 }
 
+/*===========================================================================
+ * FUNCTION   : returnDroppedRequest
+ *
+ * DESCRIPTION: return the output buffer of a request the postprocessor
+ *              dropped before offline postprocessing, with an error. Its
+ *              heap buffer is recycled as handleOfflinePpCallback does and
+ *              the buffers held back behind the request are returned after
+ *              it.
+ *
+ * PARAMETERS :
+ * @frameNumber : frame number of the dropped request
+ * @input       : its input frame, NULL if it never came. Owned by the
+ *                channel on return.
+ *
+ * RETURN     : NONE
+ *==========================================================================*/
+void QCamera3YUVChannel::returnDroppedRequest(uint32_t frameNumber,
+        mm_camera_super_buf_t *input)
+{
+    Vector<mm_camera_super_buf_t *> pendingCbs;
+    buffer_handle_t *resultBuffer = NULL;
+
+    {
+        Mutex::Autolock lock(mOfflinePpLock);
+        if (NULL != input) {
+            uint32_t bufferIndex = input->bufs[0]->buf_idx;
+            mMemory.markFrameNumber(bufferIndex, -1);
+            mFreeHeapBufferList.push_back(bufferIndex);
+            free(input);
+        }
+
+        List<PpInfo>::iterator ppInfo;
+        for (ppInfo = mOfflinePpInfoList.begin();
+                ppInfo != mOfflinePpInfoList.end(); ppInfo++) {
+            if (ppInfo->frameNumber == frameNumber) {
+                break;
+            }
+        }
+        if ((ppInfo == mOfflinePpInfoList.end()) || !ppInfo->offlinePpFlag) {
+            LOGE("No offline postprocessing pending for dropped frame %u",
+                    frameNumber);
+            return;
+        }
+        resultBuffer = ppInfo->output;
+        mOfflinePpInfoList.erase(ppInfo);
+
+        mm_camera_super_buf_t* super_frame;
+        while((super_frame = getNextPendingCbBuffer())) {
+            pendingCbs.push_back(super_frame);
+        }
+    }
+
+    LOGE("Returning dropped frame %u with error", frameNumber);
+    issueChannelCb(resultBuffer, frameNumber, CAMERA3_BUFFER_STATUS_ERROR);
+
+    for (size_t i = 0; i < pendingCbs.size(); i++) {
+        QCamera3ProcessingChannel::streamCbRoutine(
+                pendingCbs[i], mStreams[0]);
+    }
+}
+
 /*===========================================================================
  * FUNCTION   : needsFramePostprocessing
  *
@@ -3176,6 +3450,9 @@ void QCamera3PicChannel::jpegEvtHandle(jpeg_job_status_t status,
             resultBuffer =
                     (buffer_handle_t *)obj->mMemory.getBufferHandle(bufIdx);
             int32_t resultFrameNumber = obj->mMemory.getFrameNumber(bufIdx);
+            QCameraFrameTracer::getInstance()->record(
+                    ((QCamera3HardwareInterface *)obj->mUserData)->getCameraId(),
+                    (uint32_t)resultFrameNumber, QCAMERA_FRAME_STAGE_JPEG);
             int32_t rc = obj->mMemory.unregisterBuffer(bufIdx);
             if (NO_ERROR != rc) {
                 LOGE("Error %d unregistering stream buffer %d",
@@ -3243,15 +3520,7 @@ void QCamera3PicChannel::jpegEvtHandle(jpeg_job_status_t status,
                 }
 
                 /* unregister offline meta buffer */
-                int32_t metaBufIndex =
-                        obj->mOfflineMetaMemory.getHeapBufferIndex((uint32_t)resultFrameNumber);
-                if (0 <= metaBufIndex) {
-                    Mutex::Autolock lock(obj->mFreeOfflineMetaBuffersLock);
-                    obj->mFreeOfflineMetaBuffersList.push_back((uint32_t)metaBufIndex);
-                } else {
-                    LOGE("could not find the input meta buf index, frame number %d",
-                             resultFrameNumber);
-                }
+                obj->releaseOfflineMeta((uint32_t)resultFrameNumber);
             }
             obj->m_postprocessor.releaseOfflineBuffers(false);
             obj->m_postprocessor.releaseJpegJobData(job);
@@ -3453,7 +3722,7 @@ int32_t QCamera3PicChannel::request(buffer_handle_t *buffer,
     startPostProc(reproc_cfg);
 
     // Queue jpeg settings
-    rc = queueJpegSetting((uint32_t)index, metadata);
+    rc = queueJpegSetting((uint32_t)index, frameNumber, metadata);
 
     if (pInputBuffer == NULL) {
         Mutex::Autolock lock(mFreeBuffersLock);
@@ -3490,7 +3759,12 @@ int32_t QCamera3PicChannel::request(buffer_handle_t *buffer,
             return rc;
         }
         LOGH("Post-process started");
-        m_postprocessor.processData(src_frame);
+        rc = m_postprocessor.processData(src_frame);
+        if (NO_ERROR != rc) {
+            LOGE("Error %d while scheduling framework reprocess", rc);
+            free(src_frame);
+            return rc;
+        }
     }
     return rc;
 }
@@ -3605,7 +3879,8 @@ void QCamera3PicChannel::streamCbRoutine(mm_camera_super_buf_t *super_frame,
                 CAMERA3_BUFFER_STATUS_ERROR, mUserData);
     }
 
-    m_postprocessor.processData(frame);
+    m_postprocessor.processData(frame, NULL,
+            (uint32_t)mYuvMemory->getFrameNumber(frameIndex));
     free(super_frame);
     return;
 }
@@ -3632,7 +3907,8 @@ void QCamera3PicChannel::putStreamBufs()
     mFreeBufferList.clear();
 }
 
-int32_t QCamera3PicChannel::queueJpegSetting(uint32_t index, metadata_buffer_t *metadata)
+int32_t QCamera3PicChannel::queueJpegSetting(uint32_t index, uint32_t frameNumber,
+        metadata_buffer_t *metadata)
 {
     QCamera3HardwareInterface* hal_obj = (QCamera3HardwareInterface*)mUserData;
     jpeg_settings_t *settings =
@@ -3702,7 +3978,7 @@ int32_t QCamera3PicChannel::queueJpegSetting(uint32_t index, metadata_buffer_t *
         }
     }
 
-    return m_postprocessor.processJpegSettingData(settings);
+    return m_postprocessor.processJpegSettingData(settings, frameNumber);
 }
 
 
@@ -3764,6 +4040,45 @@ int32_t QCamera3PicChannel::timeoutFrame(uint32_t frameNumber)
     return NO_ERROR;
 }
 
+/*===========================================================================
+ * FUNCTION   : returnDroppedRequest
+ *
+ * DESCRIPTION: return the jpeg buffer of a request the postprocessor dropped
+ *              before reprocess, with an error. Its snapshot buffer goes
+ *              back to the free list as in jpegEvtHandle.
+ *
+ * PARAMETERS :
+ * @frameNumber : frame number of the dropped request
+ * @input       : its input frame, NULL if it never came. Owned by the
+ *                channel on return.
+ *
+ * RETURN     : NONE
+ *==========================================================================*/
+void QCamera3PicChannel::returnDroppedRequest(uint32_t frameNumber,
+        mm_camera_super_buf_t *input)
+{
+    if (NULL != input) {
+        Mutex::Autolock lock(mFreeBuffersLock);
+        mFreeBufferList.push_back(input->bufs[0]->buf_idx);
+        free(input);
+    }
+
+    int32_t bufIdx = mMemory.getBufferIndex(frameNumber);
+    if (bufIdx < 0) {
+        LOGE("No pending jpeg buffer for dropped frame %u", frameNumber);
+        return;
+    }
+
+    buffer_handle_t *resultBuffer =
+            (buffer_handle_t *)mMemory.getBufferHandle((uint32_t)bufIdx);
+    int32_t rc = mMemory.unregisterBuffer((uint32_t)bufIdx);
+    if (NO_ERROR != rc) {
+        LOGE("Error %d unregistering stream buffer %d", rc, bufIdx);
+    }
+    LOGE("Returning dropped frame %u with error", frameNumber);
+    issueChannelCb(resultBuffer, frameNumber, CAMERA3_BUFFER_STATUS_ERROR);
+}
+
 /*===========================================================================
  * FUNCTION   : QCamera3ReprocessChannel
  *
@@ -3955,7 +4270,7 @@ void QCamera3ReprocessChannel::streamCbRoutine(mm_camera_super_buf_t *super_fram
         if (mChannelCB) {
             mChannelCB(NULL, NULL, resultFrameNumber, true, mUserData);
         }
-        obj->m_postprocessor.processPPData(frame);
+        obj->m_postprocessor.processPPData(frame, resultFrameNumber);
     } else {
         buffer_handle_t *resultBuffer;
         frameIndex = (uint8_t)super_frame->bufs[0]->buf_idx;
@@ -4067,7 +4382,7 @@ void QCamera3ReprocessChannel::putStreamBufs()
        mMemory->deallocate();
        delete mMemory;
        mMemory = NULL;
-       mFreeBufferList.clear();
+       mFreeBuffers.clear();
    } else {
        mGrallocMemory.unregisterBuffers();
    }
@@ -4285,7 +4600,7 @@ int32_t QCamera3ReprocessChannel::bufDone(mm_camera_super_buf_t *recvd_frame)
     if (recvd_frame && recvd_frame->num_bufs == 1) {
         Mutex::Autolock lock(mFreeBuffersLock);
         uint32_t buf_idx = recvd_frame->bufs[0]->buf_idx;
-        mFreeBufferList.push_back(buf_idx);
+        mFreeBuffers.put(buf_idx);
 
     } else {
         LOGE("Fatal. Not supposed to be here");
@@ -4445,6 +4760,16 @@ int32_t QCamera3ReprocessChannel::overrideFwkMetadata(
         LOGE("No metadata available");
         return BAD_VALUE;
     }
+
+    // Entries below are overridden per reprocess stream, so stop sharing
+    // the request metadata with other output channels first
+    if (NULL != m_pSrcChannel) {
+        int32_t rc = m_pSrcChannel->privatizeOfflineMeta(frame);
+        if (NO_ERROR != rc) {
+            LOGE("Failed to take private copy of reprocess metadata %d", rc);
+            return rc;
+        }
+    }
     metadata_buffer_t *meta = (metadata_buffer_t *) frame->metadata_buffer.buffer;
 
     // Not doing rotation at all for YUV to YUV reprocess
@@ -4598,7 +4923,8 @@ int32_t QCamera3ReprocessChannel::overrideFwkMetadata(
     } else if (mReprocessType == REPROCESS_TYPE_JPEG) {
         Mutex::Autolock lock(mFreeBuffersLock);
         uint32_t bufIdx;
-        if (mFreeBufferList.empty()) {
+        int32_t freeIdx = mFreeBuffers.get();
+        if (freeIdx < 0) {
             rc = mMemory->allocateOne(mFrameLen);
             if (rc < 0) {
                 LOGE("Failed allocating heap buffer. Fatal");
@@ -4607,8 +4933,7 @@ int32_t QCamera3ReprocessChannel::overrideFwkMetadata(
                 bufIdx = (uint32_t)rc;
             }
         } else {
-            bufIdx = *(mFreeBufferList.begin());
-            mFreeBufferList.erase(mFreeBufferList.begin());
+            bufIdx = (uint32_t)freeIdx;
         }
 
         mMemory->markFrameNumber(bufIdx, frame->frameNumber);
@@ -4625,19 +4950,6 @@ int32_t QCamera3ReprocessChannel::overrideFwkMetadata(
        mOfflineBuffersIndex = -1;
     }
     uint32_t buf_idx = (uint32_t)(mOfflineBuffersIndex + 1);
-    rc = pStream->mapBuf(
-            CAM_MAPPING_BUF_TYPE_OFFLINE_INPUT_BUF,
-            buf_idx, -1,
-            frame->input_buffer.fd, frame->input_buffer.frame_len);
-    if (NO_ERROR == rc) {
-        mappedBuffer.index = buf_idx;
-        mappedBuffer.stream = pStream;
-        mappedBuffer.type = CAM_MAPPING_BUF_TYPE_OFFLINE_INPUT_BUF;
-        Mutex::Autolock lock(mOfflineBuffersLock);
-        mOfflineBuffers.push_back(mappedBuffer);
-        mOfflineBuffersIndex = (int32_t)buf_idx;
-        LOGD("Mapped buffer with index %d", mOfflineBuffersIndex);
-    }
 
     max_idx = (int32_t) ((mNumBuffers * 2) - 1);
     //loop back the indices if max burst count reached
@@ -4645,18 +4957,41 @@ int32_t QCamera3ReprocessChannel::overrideFwkMetadata(
        mOfflineMetaIndex = (int32_t) (mNumBuffers - 1);
     }
     uint32_t meta_buf_idx = (uint32_t)(mOfflineMetaIndex + 1);
-    rc |= pStream->mapBuf(
-            CAM_MAPPING_BUF_TYPE_OFFLINE_META_BUF,
-            meta_buf_idx, -1,
+
+    // Map input and metadata in one round trip to the server
+    QCameraBufferMaps bufferMaps;
+    rc = bufferMaps.enqueue(CAM_MAPPING_BUF_TYPE_OFFLINE_INPUT_BUF,
+            pStream->getMyHandle(), buf_idx, -1, 0 /*cookie*/,
+            frame->input_buffer.fd, frame->input_buffer.frame_len);
+    rc |= bufferMaps.enqueue(CAM_MAPPING_BUF_TYPE_OFFLINE_META_BUF,
+            pStream->getMyHandle(), meta_buf_idx, -1, 0 /*cookie*/,
             frame->metadata_buffer.fd, frame->metadata_buffer.frame_len);
     if (NO_ERROR == rc) {
-        mappedBuffer.index = meta_buf_idx;
+        cam_buf_map_type_list bufMapList;
+        rc = bufferMaps.getCamBufMapList(bufMapList);
+        if (NO_ERROR == rc) {
+            rc = pStream->mapBufs(bufMapList);
+        }
+    }
+    if (NO_ERROR == rc) {
+        mappedBuffer.index = buf_idx;
         mappedBuffer.stream = pStream;
+        mappedBuffer.type = CAM_MAPPING_BUF_TYPE_OFFLINE_INPUT_BUF;
+        {
+            Mutex::Autolock lock(mOfflineBuffersLock);
+            mOfflineBuffers.push_back(mappedBuffer);
+            mOfflineBuffersIndex = (int32_t)buf_idx;
+        }
+        LOGD("Mapped buffer with index %d", buf_idx);
+
+        mappedBuffer.index = meta_buf_idx;
         mappedBuffer.type = CAM_MAPPING_BUF_TYPE_OFFLINE_META_BUF;
-        Mutex::Autolock lock(mOfflineMetaBuffersLock);
-        mOfflineMetaBuffers.push_back(mappedBuffer);
-        mOfflineMetaIndex = (int32_t)meta_buf_idx;
-        LOGD("Mapped meta buffer with index %d", mOfflineMetaIndex);
+        {
+            Mutex::Autolock lock(mOfflineMetaBuffersLock);
+            mOfflineMetaBuffers.push_back(mappedBuffer);
+            mOfflineMetaIndex = (int32_t)meta_buf_idx;
+        }
+        LOGD("Mapped meta buffer with index %d", meta_buf_idx);
     }
 
     if (rc == NO_ERROR) {
@@ -43,6 +43,7 @@
 #include "QCamera3HALHeader.h"
 #include "QCamera3Mem.h"
 #include "QCamera3PostProc.h"
+#include "QCamera3ReprocMeta.h"
 #include "QCamera3Stream.h"
 #include "QCamera3StreamMem.h"
 
@@ -214,7 +215,8 @@ public:
     virtual void reprocessCbRoutine(buffer_handle_t *resultBuffer,
             uint32_t resultFrameNumber);
 
-    int32_t queueReprocMetadata(mm_camera_super_buf_t *metadata);
+    int32_t queueReprocMetadata(mm_camera_super_buf_t *metadata,
+            uint32_t frameNumber);
     int32_t metadataBufDone(mm_camera_super_buf_t *recvd_frame);
     int32_t translateStreamTypeAndFormat(camera3_stream_t *stream,
             cam_stream_type_t &streamType,
@@ -229,10 +231,13 @@ public:
             metadata_buffer_t *metadata,
             buffer_handle_t *output_buffer,
             uint32_t frameNumber);
+    int32_t privatizeOfflineMeta(qcamera_fwk_input_pp_data_t *frame);
     int32_t checkStreamCbErrors(mm_camera_super_buf_t *super_frame,
             QCamera3Stream *stream);
     int32_t getStreamSize(cam_dimension_t &dim);
     virtual int32_t timeoutFrame(uint32_t frameNumber);
+    virtual void returnDroppedRequest(uint32_t frameNumber,
+            mm_camera_super_buf_t *input);
 
     QCamera3PostProcessor m_postprocessor; // post processor
     void showDebugFPS(int32_t streamType);
@@ -245,8 +250,13 @@ protected:
     bool isWNREnabled() {return m_bWNROn;};
     void startPostProc(const reprocess_config_t &reproc_cfg);
     void issueChannelCb(buffer_handle_t *resultBuffer,
-            uint32_t resultFrameNumber);
+            uint32_t resultFrameNumber,
+            camera3_buffer_status_t status = CAMERA3_BUFFER_STATUS_OK);
     int32_t releaseOfflineMemory(uint32_t resultFrameNumber);
+    int32_t getOfflineMetaBuffer(uint32_t frameNumber,
+            mm_camera_buf_def_t &meta_buf);
+    void releaseOfflineMeta(uint32_t resultFrameNumber);
+    QCamera3ReprocMetaPool *getReprocMetaPool();
 
     QCamera3StreamMem mMemory; //output buffer allocated by fwk
     camera3_stream_t *mCamera3Stream;
@@ -263,7 +273,7 @@ protected:
     mm_camera_super_buf_t *mMetaFrame;
     QCamera3StreamMem mOfflineMemory;      //reprocessing input buffer
     QCamera3StreamMem mOfflineMetaMemory; //reprocessing metadata buffer
-    List<uint32_t> mFreeOfflineMetaBuffersList;
+    QCamera3BufIdxMask mFreeOfflineMetaBuffers;
     Mutex mFreeOfflineMetaBuffersLock;
     android::List<mm_camera_super_buf_t *> mOutOfSequenceBuffers;
 
@@ -443,6 +453,8 @@ public:
     virtual void putStreamBufs();
     virtual void reprocessCbRoutine(buffer_handle_t *resultBuffer,
         uint32_t resultFrameNumber);
+    virtual void returnDroppedRequest(uint32_t frameNumber,
+            mm_camera_super_buf_t *input);
 
 private:
     typedef struct {
@@ -510,6 +522,8 @@ public:
     virtual void putStreamBufs();
     virtual reprocess_type_t getReprocessType();
     virtual int32_t timeoutFrame(uint32_t frameNumber);
+    virtual void returnDroppedRequest(uint32_t frameNumber,
+            mm_camera_super_buf_t *input);
 
     QCamera3Exif *getExifData(metadata_buffer_t *metadata,
             jpeg_settings_t *jpeg_settings);
@@ -523,7 +537,8 @@ public:
             void *userdata);
 
 private:
-    int32_t queueJpegSetting(uint32_t out_buf_index, metadata_buffer_t *metadata);
+    int32_t queueJpegSetting(uint32_t out_buf_index, uint32_t frameNumber,
+            metadata_buffer_t *metadata);
 
 public:
     cam_dimension_t m_max_pic_dim;
@@ -603,7 +618,7 @@ private:
     int32_t mOfflineMetaIndex;
     uint32_t mFrameLen;
     Mutex mFreeBuffersLock; // Lock for free heap buffers
-    List<int32_t> mFreeBufferList; // Free heap buffers list
+    QCamera3BufIdxMask mFreeBuffers; // Free heap buffers
     reprocess_type_t mReprocessType;
     uint32_t mSrcStreamHandles[MAX_STREAM_NUM_IN_BUNDLE];
     QCamera3ProcessingChannel *m_pSrcChannel; // ptr to source channel for reprocess
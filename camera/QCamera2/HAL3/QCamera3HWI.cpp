@@ -53,6 +53,7 @@
 #include "util/QCameraFlash.h"
 #include "QCamera3HWI.h"
 #include "QCamera3VendorTags.h"
+#include "QCameraFrameTracer.h"
 #include "QCameraTrace.h"
 
 extern "C" {
@@ -89,6 +90,8 @@ namespace qcamera {
 #define PREVIEW_FPS_FOR_HFR    (30)
 #define DEFAULT_VIDEO_FPS      (30.0)
 #define MAX_HFR_BATCH_SIZE     (8)
+/* Regular sessions may batch video requests from this fixed FPS on */
+#define MIN_FPS_FOR_VIDEO_BATCH (60)
 #define REGIONS_TUPLE_COUNT    5
 #define HDR_PLUS_PERF_TIME_OUT  (7000) // milliseconds
 // Set a threshold for detection of missing buffers //seconds
@@ -368,6 +371,12 @@ QCamera3HardwareInterface::QCamera3HardwareInterface(uint32_t cameraId,
       mHFRVideoFps(DEFAULT_VIDEO_FPS),
       mOpMode(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE),
       mFirstFrameNumberInBatch(0),
+      mLastFrameNumberInBatch(0),
+      mVideoBatchSize(0),
+      mVideoBatchProp(0),
+      mStreamConfigReusable(false),
+      mStreamConfigReused(false),
+      mStreamReuseProp(true),
       mNeedSensorRestart(false),
       mMinInFlightRequests(MIN_INFLIGHT_REQUESTS),
       mMaxInFlightRequests(MAX_INFLIGHT_REQUESTS),
@@ -440,6 +449,16 @@ QCamera3HardwareInterface::QCamera3HardwareInterface(uint32_t cameraId,
     property_get("persist.camera.avtimer.debug", prop, "0");
     m_debug_avtimer = (uint8_t)atoi(prop);
 
+    // Requests per batch for regular >= 60fps recording, 0 disables
+    memset(prop, 0, sizeof(prop));
+    property_get("persist.camera.video.batch", prop, "0");
+    mVideoBatchProp = (uint8_t)MIN(atoi(prop), MAX_HFR_BATCH_SIZE);
+
+    // Keep channels across configureStreams with an identical stream set
+    memset(prop, 0, sizeof(prop));
+    property_get("persist.camera.stream.reuse", prop, "1");
+    mStreamReuseProp = (atoi(prop) != 0);
+
     //Load and read GPU library.
     lib_surface_utils = NULL;
     LINK_get_surface_pixel_alignment = NULL;
@@ -1431,6 +1450,7 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
         return BAD_VALUE;
     }
 
+    bool reuseStreams = isStreamConfigReusable(streamList);
     mOpMode = streamList->operation_mode;
     LOGD("mOpMode: %d", mOpMode);
 
@@ -1447,8 +1467,10 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
 
     if (mRawDumpChannel) {
         mRawDumpChannel->stop();
-        delete mRawDumpChannel;
-        mRawDumpChannel = NULL;
+        if (!reuseStreams) {
+            delete mRawDumpChannel;
+            mRawDumpChannel = NULL;
+        }
     }
 
     if (mSupportChannel)
@@ -1751,6 +1773,32 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
         return rc;
     }
 
+    if (reuseStreams) {
+        /* Same streams as the last configuration: keep the stopped channels,
+         * their buffers and the jpeg session, and restart them with the
+         * next request like flush does */
+        for (List<stream_info_t*>::iterator it = mStreamInfo.begin();
+                it != mStreamInfo.end(); it++) {
+            (*it)->status = VALID;
+            (*it)->stream->usage = (*it)->usage;
+            (*it)->stream->max_buffers = (*it)->max_buffers;
+        }
+        LOGH("Reusing channels of %d streams", streamList->num_streams);
+        KPI_ATRACE_INT("Camera:StreamReuse", 1);
+        // Channels not started yet are still set up by the next request
+        if (mState == STARTED) {
+            mStreamConfigReused = true;
+        }
+
+        resetPendingRequests();
+        mState = CONFIGURED;
+        pthread_mutex_unlock(&mMutex);
+        return rc;
+    }
+    mStreamConfigReusable = false;
+    mStreamConfigReused = false;
+    KPI_ATRACE_INT("Camera:StreamReuse", 0);
+
     camera3_stream_t *zslStream = NULL; //Only use this for size and not actual handle!
     for (size_t i = 0; i < streamList->num_streams; i++) {
         camera3_stream_t *newStream = streamList->streams[i];
@@ -1787,6 +1835,9 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
             stream_info->stream = newStream;
             stream_info->status = VALID;
             stream_info->channel = NULL;
+            stream_info->consumer_usage = 0;
+            stream_info->usage = 0;
+            stream_info->max_buffers = 0;
             mStreamInfo.push_back(stream_info);
         }
         /* Covers Opaque ZSL and API1 F/W ZSL */
@@ -1839,6 +1890,13 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
         delete mMetadataChannel;
         mMetadataChannel = NULL;
     }
+
+    // Channels holding shared reprocess metadata are gone by now
+    if (inputStream != NULL) {
+        mReprocMetaPool.reset();
+    } else {
+        mReprocMetaPool.deinit();
+    }
     if (mSupportChannel) {
         delete mSupportChannel;
         mSupportChannel = NULL;
@@ -2230,6 +2288,9 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
                     it != mStreamInfo.end(); it++) {
                 if ((*it)->stream == newStream) {
                     (*it)->channel = (QCamera3ProcessingChannel*) newStream->priv;
+                    (*it)->consumer_usage = stream_usage;
+                    (*it)->usage = newStream->usage;
+                    (*it)->max_buffers = newStream->max_buffers;
                     break;
                 }
             }
@@ -2397,6 +2458,86 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
     mStreamConfigInfo.buffer_info.max_buffers =
             m_bIs4KVideo ? 0 : MAX_INFLIGHT_REQUESTS;
 
+    resetPendingRequests();
+
+    /* Reprocess and batched sessions are rebuilt every time: the reprocess
+     * metadata pool and the batch size of the channels are set up per
+     * configuration */
+    mStreamConfigReusable = (inputStream == NULL) && (zslStream == NULL) &&
+            (mOpMode != CAMERA3_STREAM_CONFIGURATION_CONSTRAINED_HIGH_SPEED_MODE) &&
+            !(m_bIsVideo && mVideoBatchProp);
+
+    // Update state
+    mState = CONFIGURED;
+
+    pthread_mutex_unlock(&mMutex);
+
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : isStreamConfigReusable
+ *
+ * DESCRIPTION: Check whether the channels of the last stream configuration
+ *              can serve a new one. That is the case if the new list has
+ *              exactly the same output stream objects with the same consumer
+ *              usage, in the same operation mode.
+ *
+ * PARAMETERS :
+ *   @streamList : streams to be configured
+ *
+ * RETURN     : true if configureStreams may keep the existing channels
+ *
+ *==========================================================================*/
+bool QCamera3HardwareInterface::isStreamConfigReusable(
+        camera3_stream_configuration_t *streamList)
+{
+    if (!mStreamReuseProp || !mStreamConfigReusable ||
+            (mMetadataChannel == NULL) ||
+            ((mState != CONFIGURED) && (mState != STARTED)) ||
+            (streamList->operation_mode != mOpMode) ||
+            (streamList->num_streams != mStreamInfo.size())) {
+        return false;
+    }
+
+    for (size_t i = 0; i < streamList->num_streams; i++) {
+        camera3_stream_t *newStream = streamList->streams[i];
+        bool found = false;
+        for (List<stream_info_t*>::iterator it = mStreamInfo.begin();
+                it != mStreamInfo.end(); it++) {
+            if ((*it)->stream != newStream) {
+                continue;
+            }
+            /* The framework either resets usage to the consumer usage or
+             * hands back what the HAL set last time */
+            found = ((*it)->status == VALID) && ((*it)->channel != NULL) &&
+                    (newStream->priv == (*it)->channel) &&
+                    (newStream->stream_type == CAMERA3_STREAM_OUTPUT) &&
+                    ((newStream->usage == (*it)->consumer_usage) ||
+                    (newStream->usage == (*it)->usage));
+            break;
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : resetPendingRequests
+ *
+ * DESCRIPTION: Drop the pending request and buffer bookkeeping and rederive
+ *              the frame durations after a stream configuration.
+ *              Called with mMutex held.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *
+ *==========================================================================*/
+void QCamera3HardwareInterface::resetPendingRequests()
+{
     /* Initialize mPendingRequestInfo and mPendingBuffersMap */
     for (pendingRequestIterator i = mPendingRequestsList.begin();
             i != mPendingRequestsList.end();) {
@@ -2414,13 +2555,6 @@ int QCamera3HardwareInterface::configureStreamsPerfLocked(
     mCurJpegMeta.clear();
     //Get min frame duration for this streams configuration
     deriveMinFrameDuration();
-
-    // Update state
-    mState = CONFIGURED;
-
-    pthread_mutex_unlock(&mMutex);
-
-    return rc;
 }
 
 /*===========================================================================
@@ -2722,6 +2856,56 @@ int32_t QCamera3HardwareInterface::handlePendingReprocResults(uint32_t frame_num
     return NO_ERROR;
 }
 
+/*===========================================================================
+ * FUNCTION   : queuePartialBatch
+ *
+ * DESCRIPTION: Send the video batch collected so far to the backend before it
+ *              is full. Used in regular session batching when the next
+ *              request can not share the settings of the batch. mParameters
+ *              still holds the settings of the batch at this point.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : NO_ERROR on success
+ *              Error codes on failure
+ *
+ * NOTE       : Called with mMutex held
+ *==========================================================================*/
+int32_t QCamera3HardwareInterface::queuePartialBatch()
+{
+    int32_t rc = NO_ERROR;
+
+    LOGD("frm: %d - %d vidBufTobeQd: %d", mFirstFrameNumberInBatch,
+            mLastFrameNumberInBatch, mToBeQueuedVidBufs);
+    for (List<stream_info_t *>::iterator it = mStreamInfo.begin();
+            it != mStreamInfo.end(); it++) {
+        QCamera3Channel *channel = (QCamera3Channel *)(*it)->stream->priv;
+        if ((1U << CAM_STREAM_TYPE_VIDEO) == channel->getStreamTypeMask()) {
+            rc = channel->queueBatchBuf();
+            if (rc != NO_ERROR) {
+                LOGE("queueBatchBuf failed %d", rc);
+                return rc;
+            }
+        }
+    }
+
+    if (ADD_SET_PARAM_ENTRY_TO_BATCH(mParameters, CAM_INTF_META_STREAM_ID,
+            mBatchedStreamsArray)) {
+        LOGE("Failed to set stream type mask in the parameters");
+        return BAD_VALUE;
+    }
+    rc = mCameraHandle->ops->set_parms(mCameraHandle->camera_handle,
+            mParameters);
+    if (rc < 0) {
+        LOGE("set_parms failed");
+    }
+
+    mToBeQueuedVidBufs = 0;
+    mPendingBatchMap.add(mLastFrameNumberInBatch, mFirstFrameNumberInBatch);
+    memset(&mBatchedStreamsArray, 0, sizeof(cam_stream_ID_t));
+    return rc;
+}
+
 /*===========================================================================
  * FUNCTION   : handleBatchMetadata
  *
@@ -2885,13 +3069,13 @@ void QCamera3HardwareInterface::handleBatchMetadata(
 }
 
 void QCamera3HardwareInterface::notifyError(uint32_t frameNumber,
-        camera3_error_msg_code_t errorCode)
+        camera3_error_msg_code_t errorCode, camera3_stream_t *errorStream)
 {
     camera3_notify_msg_t notify_msg;
     memset(&notify_msg, 0, sizeof(camera3_notify_msg_t));
     notify_msg.type = CAMERA3_MSG_ERROR;
     notify_msg.message.error.error_code = errorCode;
-    notify_msg.message.error.error_stream = NULL;
+    notify_msg.message.error.error_stream = errorStream;
     notify_msg.message.error.frame_number = frameNumber;
     mCallbackOps->notify(mCallbackOps, &notify_msg);
 
@@ -2969,6 +3153,16 @@ void QCamera3HardwareInterface::handleMetadataWithLock(
     urgent_frame_number =       *p_urgent_frame_number;
     currentSysTime =            systemTime(CLOCK_MONOTONIC);
 
+    if (frame_number_valid) {
+        QCameraFrameTracer *tracer = QCameraFrameTracer::getInstance();
+        if (timeOffset != 0) {
+            tracer->record(mCameraId, frame_number,
+                    QCAMERA_FRAME_STAGE_SENSOR, capture_time);
+        }
+        tracer->record(mCameraId, frame_number, QCAMERA_FRAME_STAGE_METADATA,
+                currentSysTime);
+    }
+
     // Detect if buffers from any requests are overdue
     for (auto &req : mPendingBuffersMap.mPendingBuffersInRequest) {
         if ( (currentSysTime - req.timestamp) >
@@ -3139,7 +3333,7 @@ void QCamera3HardwareInterface::handleMetadataWithLock(
                     internalPproc = true;
                     QCamera3ProcessingChannel *channel =
                             (QCamera3ProcessingChannel *)iter->stream->priv;
-                    channel->queueReprocMetadata(metadata_buf);
+                    channel->queueReprocMetadata(metadata_buf, i->frame_number);
                     break;
                 }
             }
@@ -3388,6 +3582,8 @@ void QCamera3HardwareInterface::handleBufferWithLock(
         handleBuffersDuringFlushLock(buffer);
         return;
     }
+    QCameraFrameTracer::getInstance()->record(mCameraId, frame_number,
+            QCAMERA_FRAME_STAGE_BUFFER);
     //not in flush
     // If the frame number doesn't exist in the pending request list,
     // directly send the buffer to the frameworks, and update pending buffers map
@@ -3560,14 +3756,18 @@ int QCamera3HardwareInterface::processCaptureRequest(
         return rc;
     }
 
+    QCameraFrameTracer::getInstance()->record(mCameraId,
+            request->frame_number, QCAMERA_FRAME_STAGE_REQUEST);
+
     meta = request->settings;
 
     // For first capture request, send capture intent, and
     // stream on all streams
     if (mState == CONFIGURED) {
         // send an unconfigure to the backend so that the isp
-        // resources are deallocated
-        if (!mFirstConfiguration) {
+        // resources are deallocated. Kept channels keep their
+        // backend configuration, as after a flush
+        if (!mFirstConfiguration && !mStreamConfigReused) {
             cam_stream_size_info_t stream_config_info;
             int32_t hal_version = CAM_HAL_V3;
             memset(&stream_config_info, 0, sizeof(cam_stream_size_info_t));
@@ -3635,8 +3835,10 @@ int QCamera3HardwareInterface::processCaptureRequest(
             }
         }
 
-        ADD_SET_PARAM_ENTRY_TO_BATCH(mParameters,
-                CAM_INTF_META_STREAM_INFO, mStreamConfigInfo);
+        if (!mStreamConfigReused) {
+            ADD_SET_PARAM_ENTRY_TO_BATCH(mParameters,
+                    CAM_INTF_META_STREAM_INFO, mStreamConfigInfo);
+        }
 
         int32_t tintless_value = 1;
         ADD_SET_PARAM_ENTRY_TO_BATCH(mParameters,
@@ -3676,6 +3878,7 @@ int QCamera3HardwareInterface::processCaptureRequest(
         /* Set fps and hfr mode while sending meta stream info so that sensor
          * can configure appropriate streaming mode */
         mHFRVideoFps = DEFAULT_VIDEO_FPS;
+        mVideoBatchSize = 0;
         mMinInFlightRequests = MIN_INFLIGHT_REQUESTS;
         mMaxInFlightRequests = MAX_INFLIGHT_REQUESTS;
         if (meta.exists(ANDROID_CONTROL_AE_TARGET_FPS_RANGE)) {
@@ -3778,7 +3981,7 @@ int QCamera3HardwareInterface::processCaptureRequest(
             }
         }
 
-        if (mRawDumpChannel) {
+        if (mRawDumpChannel && !mStreamConfigReused) {
             rc = mRawDumpChannel->initialize(IS_TYPE_NONE);
             if (rc != NO_ERROR) {
                 LOGE("Error: Raw Dump Channel init failed");
@@ -3786,7 +3989,7 @@ int QCamera3HardwareInterface::processCaptureRequest(
                 goto error_exit;
             }
         }
-        if (mSupportChannel) {
+        if (mSupportChannel && !mStreamConfigReused) {
             rc = mSupportChannel->initialize(IS_TYPE_NONE);
             if (rc < 0) {
                 LOGE("Support channel initialization failed");
@@ -3794,7 +3997,7 @@ int QCamera3HardwareInterface::processCaptureRequest(
                 goto error_exit;
             }
         }
-        if (mAnalysisChannel) {
+        if (mAnalysisChannel && !mStreamConfigReused) {
             rc = mAnalysisChannel->initialize(IS_TYPE_NONE);
             if (rc < 0) {
                 LOGE("Analysis channel initialization failed");
@@ -3976,6 +4179,7 @@ no_error:
         mWokenUpByDaemon = false;
         mPendingLiveRequest = 0;
         mFirstConfiguration = false;
+        mStreamConfigReused = false;
         enablePowerHint();
     }
 
@@ -4054,6 +4258,42 @@ no_error:
         streamsArray.stream_request[streamsArray.num_streams++].buf_index = CAM_FREERUN_IDX;
     }
 
+    /* Regular session batching only groups video requests that share the
+     * settings of the first one, see queuePartialBatch. A snapshot goes out
+     * in a batch of its own. Other streams are not batched and keep their
+     * buffer index, which a batch carries once per stream: a stream already
+     * in the batch closes it. */
+    bool closeBatch = false;
+    if (mVideoBatchSize) {
+        bool streamInBatch = false;
+        for (size_t i = 0; (i < request->num_output_buffers) && !streamInBatch;
+                i++) {
+            QCamera3Channel *channel =
+                    (QCamera3Channel *)request->output_buffers[i].stream->priv;
+            if ((1U << CAM_STREAM_TYPE_VIDEO) == channel->getStreamTypeMask()) {
+                continue;
+            }
+            uint32_t streamId = channel->getStreamID(channel->getStreamTypeMask());
+            for (uint32_t m = 0; m < mBatchedStreamsArray.num_streams; m++) {
+                if (mBatchedStreamsArray.stream_request[m].streamID == streamId) {
+                    streamInBatch = true;
+                    break;
+                }
+            }
+        }
+        if (mToBeQueuedVidBufs && ((request->settings != NULL) ||
+                blob_request || !isVidBufRequested || streamInBatch ||
+                (request->input_buffer != NULL))) {
+            rc = queuePartialBatch();
+            if (rc != NO_ERROR) {
+                LOGE("Failed to queue partial batch");
+                pthread_mutex_unlock(&mMutex);
+                return rc;
+            }
+        }
+        closeBatch = (blob_request != 0);
+    }
+
     if(request->input_buffer == NULL) {
         /* Parse the settings:
          * - For every request in NORMAL MODE
@@ -4082,6 +4322,7 @@ no_error:
                 //start of the batch
                 mFirstFrameNumberInBatch = request->frame_number;
             }
+            mLastFrameNumberInBatch = request->frame_number;
             if(ADD_SET_PARAM_ENTRY_TO_BATCH(mParameters,
                 CAM_INTF_META_FRAME_NUMBER, request->frame_number)) {
                 LOGE("Failed to set the frame number in the parameters");
@@ -4197,11 +4438,23 @@ no_error:
     // Notify metadata channel we receive a request
     mMetadataChannel->request(NULL, frameNumber, indexUsed);
 
+    metadata_buffer_t *reprocMeta = &mReprocMeta;
     if(request->input_buffer != NULL){
         LOGD("Input request, frame_number %d", frameNumber);
-        rc = setReprocParameters(request, &mReprocMeta, snapshotStreamId);
+        // Translate straight into a shared slot which the output channels
+        // map without copying; fall back to the scratch buffer if none is free
+        if (NO_ERROR == mReprocMetaPool.init()) {
+            metadata_buffer_t *sharedMeta = mReprocMetaPool.acquire(frameNumber);
+            if (NULL != sharedMeta) {
+                reprocMeta = sharedMeta;
+            }
+        }
+        rc = setReprocParameters(request, reprocMeta, snapshotStreamId);
         if (NO_ERROR != rc) {
             LOGE("fail to set reproc parameters");
+            if (reprocMeta != &mReprocMeta) {
+                mReprocMetaPool.unref(reprocMeta);
+            }
             pthread_mutex_unlock(&mMutex);
             return rc;
         }
@@ -4224,9 +4477,12 @@ no_error:
                       output.buffer, request->input_buffer, frameNumber);
             if(request->input_buffer != NULL){
                 rc = channel->request(output.buffer, frameNumber,
-                        pInputBuffer, &mReprocMeta, indexUsed);
+                        pInputBuffer, reprocMeta, indexUsed);
                 if (rc < 0) {
                     LOGE("Fail to request on picture channel");
+                    if (reprocMeta != &mReprocMeta) {
+                        mReprocMetaPool.unref(reprocMeta);
+                    }
                     pthread_mutex_unlock(&mMutex);
                     return rc;
                 }
@@ -4242,6 +4498,9 @@ no_error:
                 }
                 if (rc < 0) {
                     LOGE("Fail to request on picture channel");
+                    if (reprocMeta != &mReprocMeta) {
+                        mReprocMetaPool.unref(reprocMeta);
+                    }
                     pthread_mutex_unlock(&mMutex);
                     return rc;
                 }
@@ -4270,9 +4529,12 @@ no_error:
             QCamera3YUVChannel *yuvChannel = (QCamera3YUVChannel *)channel;
             rc = yuvChannel->request(output.buffer, frameNumber,
                     pInputBuffer,
-                    (pInputBuffer ? &mReprocMeta : mParameters), needMetadata, indexUsed);
+                    (pInputBuffer ? reprocMeta : mParameters), needMetadata, indexUsed);
             if (rc < 0) {
                 LOGE("Fail to request on YUV channel");
+                if (reprocMeta != &mReprocMeta) {
+                    mReprocMetaPool.unref(reprocMeta);
+                }
                 pthread_mutex_unlock(&mMutex);
                 return rc;
             }
@@ -4308,7 +4570,12 @@ no_error:
             uint32_t j = 0;
             for (j = 0; j < streamsArray.num_streams; j++) {
                 if (streamsArray.stream_request[j].streamID == streamId) {
-                    if (mOpMode == CAMERA3_STREAM_CONFIGURATION_CONSTRAINED_HIGH_SPEED_MODE)
+                    /* Batched streams only carry the first buffer index of
+                     * a batch, let the backend pick the queued buffers. In a
+                     * regular session only the video stream is batched */
+                    if ((mOpMode == CAMERA3_STREAM_CONFIGURATION_CONSTRAINED_HIGH_SPEED_MODE) ||
+                            (mBatchSize && ((1U << CAM_STREAM_TYPE_VIDEO) ==
+                            channel->getStreamTypeMask())))
                         streamsArray.stream_request[j].buf_index = CAM_FREERUN_IDX;
                     else
                         streamsArray.stream_request[j].buf_index = indexUsed;
@@ -4323,12 +4590,15 @@ no_error:
             if (((1U << CAM_STREAM_TYPE_VIDEO) == channel->getStreamTypeMask())
                     && mBatchSize) {
                 mToBeQueuedVidBufs++;
-                if (mToBeQueuedVidBufs == mBatchSize) {
+                if ((mToBeQueuedVidBufs == mBatchSize) || closeBatch) {
                     channel->queueBatchBuf();
                 }
             }
             if (rc < 0) {
                 LOGE("request failed");
+                if (reprocMeta != &mReprocMeta) {
+                    mReprocMetaPool.unref(reprocMeta);
+                }
                 pthread_mutex_unlock(&mMutex);
                 return rc;
             }
@@ -4336,6 +4606,11 @@ no_error:
         pendingBufferIter++;
     }
 
+    // Output channels took their own references on the shared settings
+    if (reprocMeta != &mReprocMeta) {
+        mReprocMetaPool.unref(reprocMeta);
+    }
+
     //If 2 streams have need_metadata set to true, fail the request, unless
     //we copy/reference count the metadata buffer
     if (streams_need_metadata > 1) {
@@ -4351,14 +4626,15 @@ no_error:
          * - For every request in HFR mode during preview only case
          * - Once every batch in HFR mode during video recording
          */
+        bool batchReady = mBatchSize && isVidBufRequested &&
+                ((mToBeQueuedVidBufs == mBatchSize) || closeBatch);
         if (!mBatchSize ||
-           (mBatchSize && !isVidBufRequested) ||
-           (mBatchSize && isVidBufRequested && (mToBeQueuedVidBufs == mBatchSize))) {
+           (mBatchSize && !isVidBufRequested) || batchReady) {
             LOGD("set_parms  batchSz: %d IsVidBufReq: %d vidBufTobeQd: %d ",
                      mBatchSize, isVidBufRequested,
                     mToBeQueuedVidBufs);
 
-            if(mBatchSize && isVidBufRequested && (mToBeQueuedVidBufs == mBatchSize)) {
+            if (batchReady) {
                 for (uint32_t k = 0; k < streamsArray.num_streams; k++) {
                     uint32_t m = 0;
                     for (m = 0; m < mBatchedStreamsArray.num_streams; m++) {
@@ -4393,7 +4669,7 @@ no_error:
             mToBeQueuedVidBufs = 0;
             mPendingBatchMap.add(frameNumber, mFirstFrameNumberInBatch);
             memset(&mBatchedStreamsArray, 0, sizeof(cam_stream_ID_t));
-        } else if (mBatchSize && isVidBufRequested && (mToBeQueuedVidBufs != mBatchSize)) {
+        } else if (mBatchSize && isVidBufRequested) {
             for (uint32_t k = 0; k < streamsArray.num_streams; k++) {
                 uint32_t m = 0;
                 for (m = 0; m < mBatchedStreamsArray.num_streams; m++) {
@@ -4508,6 +4784,22 @@ void QCamera3HardwareInterface::dump(int fd)
     }
     dprintf(fd, "-------+-----------\n");
 
+    QCameraFrameTracer::getInstance()->dump(fd, mCameraId);
+
+    char prop[PROPERTY_VALUE_MAX];
+    property_get("persist.camera.frame.trace.export", prop, "0");
+    if (atoi(prop) > 0) {
+        char path[QCAMERA_MAX_FILEPATH_LENGTH];
+        snprintf(path, sizeof(path), QCAMERA_DUMP_FRM_LOCATION
+                "frame_trace_%u.bin", mCameraId);
+        int trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (trace_fd >= 0) {
+            QCameraFrameTracer::getInstance()->exportBinary(trace_fd);
+            close(trace_fd);
+            dprintf(fd, "Frame trace exported to %s\n", path);
+        }
+    }
+
     dprintf(fd, "\n Camera HAL3 information End \n");
 
     /* use dumpsys media.camera as trigger to send update debug level event */
@@ -9029,6 +9321,26 @@ int32_t QCamera3HardwareInterface::setHalFpsRange(const CameraMetadata &settings
         if (ADD_SET_PARAM_ENTRY_TO_BATCH(hal_metadata, CAM_INTF_PARM_HFR, hfrMode)) {
             return BAD_VALUE;
         }
+
+        /* Opt-in batching of regular recording sessions. The first request
+         * decides whether the video channel runs in batch mode, which then
+         * lasts for the session. The fps must be fixed for the timestamps of
+         * a batch to be interpolated, so later requests re-derive the batch:
+         * a range that no longer qualifies sends every request in a batch of
+         * its own. A partial batch was already queued when the new settings
+         * came in, see processCaptureRequest. */
+        bool batchable = mVideoBatchProp && m_bIsVideo &&
+                (fps_range.min_fps == fps_range.max_fps) &&
+                (fps_range.max_fps >= MIN_FPS_FOR_VIDEO_BATCH);
+        if ((mState == CONFIGURED) && batchable) {
+            mVideoBatchSize = mVideoBatchProp;
+        }
+        if (mVideoBatchSize) {
+            mHFRVideoFps = fps_range.max_fps;
+            mBatchSize = batchable ? mVideoBatchSize : 1;
+            LOGH("video batching at %f fps, batchSize: %d",
+                    mHFRVideoFps, mBatchSize);
+        }
     }
     if (ADD_SET_PARAM_ENTRY_TO_BATCH(hal_metadata, CAM_INTF_PARM_FPS_RANGE, fps_range)) {
         return BAD_VALUE;
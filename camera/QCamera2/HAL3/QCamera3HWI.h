@@ -91,6 +91,10 @@ typedef struct {
     stream_status_t status;
     int registered;
     QCamera3ProcessingChannel *channel;
+    // Usage from the framework, and usage/max_buffers set by the HAL
+    uint32_t consumer_usage;
+    uint32_t usage;
+    uint32_t max_buffers;
 } stream_info_t;
 
 typedef struct {
@@ -235,6 +239,8 @@ public:
     bool isMainCamera() {return mIsMainCamera;}
     uint32_t getSensorMountAngle();
     const cam_related_system_calibration_data_t *getRelatedCalibrationData();
+    uint32_t getCameraId() const {return mCameraId;}
+    QCamera3ReprocMetaPool *getReprocMetaPool() {return &mReprocMetaPool;}
 
     template <typename fwkType, typename halType> struct QCameraMap {
         fwkType fwk_name;
@@ -299,6 +305,7 @@ private:
     void handleMetadataWithLock(mm_camera_super_buf_t *metadata_buf,
             bool free_and_bufdone_meta_buf,
             bool firstMetadataInBatch);
+    int32_t queuePartialBatch();
     void handleBatchMetadata(mm_camera_super_buf_t *metadata_buf,
             bool free_and_bufdone_meta_buf);
     void handleBufferWithLock(camera3_stream_buffer_t *buffer,
@@ -310,6 +317,8 @@ private:
     static void getLogLevel();
 
     void cleanAndSortStreamInfo();
+    bool isStreamConfigReusable(camera3_stream_configuration_t *streamList);
+    void resetPendingRequests();
     void extractJpegMetadata(CameraMetadata& jpegMetadata,
             const camera3_capture_request_t *request);
 
@@ -337,7 +346,8 @@ private:
     int32_t stopAllChannels();
     int32_t notifyErrorForPendingRequests();
     void notifyError(uint32_t frameNumber,
-            camera3_error_msg_code_t errorCode);
+            camera3_error_msg_code_t errorCode,
+            camera3_stream_t *errorStream = NULL);
     int32_t getReprocessibleOutputStreamId(uint32_t &id);
     int32_t handleCameraDeviceError();
 
@@ -477,6 +487,7 @@ private:
     uint8_t mCaptureIntent;
     uint8_t mCacMode;
     metadata_buffer_t mReprocMeta; //scratch meta buffer
+    QCamera3ReprocMetaPool mReprocMetaPool; //shared reprocess settings
     /* 0: Not batch, non-zero: Number of image buffers in a batch */
     uint8_t mBatchSize;
     // Used only in batch mode
@@ -487,6 +498,18 @@ public:
     uint8_t mOpMode;
 private:
     uint32_t mFirstFrameNumberInBatch;
+    uint32_t mLastFrameNumberInBatch;
+    // Batch size of a regular (non HFR) recording session, 0 if not batched
+    uint8_t mVideoBatchSize;
+    // persist.camera.video.batch
+    uint8_t mVideoBatchProp;
+    // Channels of the last configureStreams may be kept by the next one
+    bool mStreamConfigReusable;
+    // Channels were kept by the last configureStreams; backend still has
+    // their stream info
+    bool mStreamConfigReused;
+    // persist.camera.stream.reuse
+    bool mStreamReuseProp;
     camera3_stream_t mDummyBatchStream;
     bool mNeedSensorRestart;
     uint32_t mMinInFlightRequests;
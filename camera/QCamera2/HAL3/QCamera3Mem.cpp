@@ -744,11 +744,17 @@ int QCamera3HeapMemory::getMatchBufIndex(void * /*object*/)
  * RETURN     : none
  *==========================================================================*/
 QCamera3GrallocMemory::QCamera3GrallocMemory(uint32_t startIdx)
-        : QCamera3Memory(), mStartIdx(startIdx)
+        : QCamera3Memory(), mFreeSlotMask(0), mStartIdx(startIdx)
 {
+    static_assert(MM_CAMERA_MAX_NUM_FRAMES <= 64,
+            "free slot mask too small for MM_CAMERA_MAX_NUM_FRAMES");
+
     for (int i = 0; i < MM_CAMERA_MAX_NUM_FRAMES; i ++) {
         mBufferHandle[i] = NULL;
         mPrivateHandle[i] = NULL;
+        if ((uint32_t)i >= mStartIdx) {
+            mFreeSlotMask |= (1ULL << i);
+        }
     }
 }
 
@@ -847,12 +853,18 @@ int QCamera3GrallocMemory::registerBuffer(buffer_handle_t *buffer,
     if (vaddr == MAP_FAILED) {
         mMemInfo[idx].handle = 0;
         ret = NO_MEMORY;
-    } else {
-        mPtr[idx] = vaddr;
-        mBufferCount++;
+        goto end;
     }
+    mPtr[idx] = vaddr;
+    mBufferCount++;
+    mFreeSlotMask &= ~(1ULL << idx);
+    mHandleIndexMap.add(buffer, (uint32_t)idx);
 
 end:
+    if (NO_ERROR != ret) {
+        mBufferHandle[idx] = NULL;
+        mPrivateHandle[idx] = NULL;
+    }
     LOGD("X ");
     return ret;
 }
@@ -883,6 +895,11 @@ int32_t QCamera3GrallocMemory::unregisterBufferLocked(size_t idx)
     close(mMemInfo[idx].main_ion_fd);
     memset(&mMemInfo[idx], 0, sizeof(struct QCamera3MemInfo));
     mMemInfo[idx].main_ion_fd = -1;
+
+    mHandleIndexMap.removeItem(mBufferHandle[idx]);
+    removeFrameNumberLocked((uint32_t)idx);
+    mFreeSlotMask |= (1ULL << idx);
+
     mBufferHandle[idx] = NULL;
     mPrivateHandle[idx] = NULL;
     mCurrentFrameNumbers[idx] = -1;
@@ -891,6 +908,29 @@ int32_t QCamera3GrallocMemory::unregisterBufferLocked(size_t idx)
     return NO_ERROR;
 }
 
+/*===========================================================================
+ * FUNCTION   : removeFrameNumberLocked
+ *
+ * DESCRIPTION: Drop the frame number lookup entry of a buffer. Note 'mLock'
+ *              needs to be acquired before calling this method.
+ *
+ * PARAMETERS :
+ *   @idx     : index of the buffer
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCamera3GrallocMemory::removeFrameNumberLocked(uint32_t idx)
+{
+    if (-1 == mCurrentFrameNumbers[idx]) {
+        return;
+    }
+
+    ssize_t mapIdx = mFrameNumberMap.indexOfKey(mCurrentFrameNumbers[idx]);
+    if ((0 <= mapIdx) && (mFrameNumberMap.valueAt(mapIdx) == idx)) {
+        mFrameNumberMap.removeItemsAt(mapIdx);
+    }
+}
+
 /*===========================================================================
  * FUNCTION   : unregisterBuffer
  *
@@ -999,7 +1039,12 @@ int32_t QCamera3GrallocMemory::markFrameNumber(uint32_t index, uint32_t frameNum
         return BAD_INDEX;
     }
 
+    removeFrameNumberLocked(index);
     mCurrentFrameNumbers[index] = (int32_t)frameNumber;
+    // -1 releases the buffer from its request, it is not looked up
+    if (-1 != mCurrentFrameNumbers[index]) {
+        mFrameNumberMap.replaceValueFor((int32_t)frameNumber, index);
+    }
 
     return NO_ERROR;
 }
@@ -1054,24 +1099,15 @@ int32_t QCamera3GrallocMemory::getFrameNumber(uint32_t index)
  *==========================================================================*/
 int32_t QCamera3GrallocMemory::getOldestFrameNumber(uint32_t &bufIndex)
 {
-    int32_t oldest = INT_MAX;
-    bool empty = true;
-    for (uint32_t index = mStartIdx;
-            index < MM_CAMERA_MAX_NUM_FRAMES; index++) {
-        if (mMemInfo[index].handle) {
-            if ((empty) ||
-                (!empty && oldest > mCurrentFrameNumbers[index]
-                && mCurrentFrameNumbers[index] != -1)) {
-                oldest = mCurrentFrameNumbers[index];
-                bufIndex = index;
-            }
-            empty = false;
-        }
-    }
-    if (empty)
+    Mutex::Autolock lock(mLock);
+
+    // mFrameNumberMap is sorted by frame number
+    if (mFrameNumberMap.isEmpty()) {
         return -1;
-    else
-        return oldest;
+    }
+
+    bufIndex = mFrameNumberMap.valueAt(0);
+    return mFrameNumberMap.keyAt(0);
 }
 
 
@@ -1090,13 +1126,13 @@ int32_t QCamera3GrallocMemory::getOldestFrameNumber(uint32_t &bufIndex)
  *==========================================================================*/
 int32_t QCamera3GrallocMemory::getBufferIndex(uint32_t frameNumber)
 {
-    for (uint32_t index = mStartIdx;
-            index < MM_CAMERA_MAX_NUM_FRAMES; index++) {
-        if (mMemInfo[index].handle &&
-                mCurrentFrameNumbers[index] == (int32_t)frameNumber)
-            return (int32_t)index;
+    Mutex::Autolock lock(mLock);
+
+    ssize_t mapIdx = mFrameNumberMap.indexOfKey((int32_t)frameNumber);
+    if (0 > mapIdx) {
+        return -1;
     }
-    return -1;
+    return (int32_t)mFrameNumberMap.valueAt(mapIdx);
 }
 
 /*===========================================================================
@@ -1142,19 +1178,16 @@ int QCamera3GrallocMemory::getMatchBufIndex(void *object)
 {
     Mutex::Autolock lock(mLock);
 
-    int index = -1;
     buffer_handle_t *key = (buffer_handle_t*) object;
     if (!key) {
         return BAD_VALUE;
     }
-    for (uint32_t i = mStartIdx; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
-        if (mBufferHandle[i] == key) {
-            index = (int)i;
-            break;
-        }
-    }
 
-    return index;
+    ssize_t mapIdx = mHandleIndexMap.indexOfKey(key);
+    if (0 > mapIdx) {
+        return -1;
+    }
+    return (int)mHandleIndexMap.valueAt(mapIdx);
 }
 
 /*===========================================================================
@@ -1178,11 +1211,8 @@ int QCamera3GrallocMemory::getFreeIndexLocked()
         return index;
     }
 
-    for (size_t i = mStartIdx; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
-        if (0 == mMemInfo[i].handle) {
-            index = i;
-            break;
-        }
+    if (0 != mFreeSlotMask) {
+        index = __builtin_ctzll(mFreeSlotMask);
     }
 
     return index;
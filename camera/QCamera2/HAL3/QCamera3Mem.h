@@ -32,6 +32,7 @@
 
 // System dependencies
 #include <linux/msm_ion.h>
+#include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 
 // Camera dependencies
@@ -152,9 +153,18 @@ protected:
 private:
     int32_t unregisterBufferLocked(size_t idx);
     int32_t getFreeIndexLocked();
+    void removeFrameNumberLocked(uint32_t idx);
+
     buffer_handle_t *mBufferHandle[MM_CAMERA_MAX_NUM_FRAMES];
     struct private_handle_t *mPrivateHandle[MM_CAMERA_MAX_NUM_FRAMES];
 
+    // Lookup tables kept in sync with mBufferHandle and mCurrentFrameNumbers
+    // so that per-request lookups do not scan every slot
+    KeyedVector<buffer_handle_t *, uint32_t> mHandleIndexMap;
+    KeyedVector<int32_t, uint32_t> mFrameNumberMap;
+    // Bit i set if slot i is free
+    uint64_t mFreeSlotMask;
+
     uint32_t mStartIdx;
 };
 };
@@ -0,0 +1,270 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#define LOG_TAG "QCamera3PPJoin"
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+
+// Camera dependencies
+#include "QCamera3PPJoin.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+/*===========================================================================
+ * FUNCTION   : QCamera3PPJoinTable
+ *
+ * DESCRIPTION: constructor of QCamera3PPJoinTable
+ *
+ * PARAMETERS :
+ *   @release  : returns the buffers of an entry that is dropped or flushed
+ *   @userData : user data passed to release
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCamera3PPJoinTable::QCamera3PPJoinTable(qcamera_pp_join_release_t release,
+        void *userData) :
+        mRelease(release),
+        mUserData(userData)
+{
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCamera3PPJoinTable
+ *
+ * DESCRIPTION: destructor of QCamera3PPJoinTable
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCamera3PPJoinTable::~QCamera3PPJoinTable()
+{
+    flush();
+}
+
+/*===========================================================================
+ * FUNCTION   : getEntry
+ *
+ * DESCRIPTION: find the entry of a request, adding an empty one if there is
+ *              none. The oldest entry is dropped when the table is full.
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *
+ * RETURN     : entry of the request, valid until the table is next changed
+ *==========================================================================*/
+qcamera_hal3_pp_join_t &QCamera3PPJoinTable::getEntry(uint32_t frameNumber)
+{
+    ssize_t idx = mTable.indexOfKey(frameNumber);
+    if (idx >= 0) {
+        return mTable.editValueAt(idx);
+    }
+
+    if (mTable.size() >= MAX_HAL3_PP_JOIN_ENTRIES) {
+        LOGE("join table full, dropping request %u", mTable.keyAt(0));
+        drop(mTable.keyAt(0), mTable.editValueAt(0));
+        mTable.removeItemsAt(0);
+    }
+
+    qcamera_hal3_pp_join_t entry;
+    memset(&entry, 0, sizeof(entry));
+    idx = mTable.add(frameNumber, entry);
+    return mTable.editValueAt(idx);
+}
+
+/*===========================================================================
+ * FUNCTION   : join
+ *
+ * DESCRIPTION: move a request to the reprocess queue once both its input
+ *              frame and metadata are present. Frames and metadata each
+ *              arrive in frame number order, so older requests still missing
+ *              one of them never complete and are dropped. The oldest queued
+ *              request is dropped when the queue is full.
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *   @readyQ      : reprocess input queue
+ *
+ * RETURN     : true if the request was queued
+ *==========================================================================*/
+bool QCamera3PPJoinTable::join(uint32_t frameNumber, QCameraQueue &readyQ)
+{
+    ssize_t idx = mTable.indexOfKey(frameNumber);
+    if (idx < 0) {
+        return false;
+    }
+    const qcamera_hal3_pp_join_t &entry = mTable.valueAt(idx);
+    if ((NULL == entry.pp_buffer) || (NULL == entry.metadata)) {
+        LOGD("request %u waiting for %s", frameNumber,
+                (NULL == entry.pp_buffer) ? "frame" : "metadata");
+        return false;
+    }
+
+    qcamera_hal3_pp_join_t *input =
+            (qcamera_hal3_pp_join_t *)malloc(sizeof(qcamera_hal3_pp_join_t));
+    if (NULL == input) {
+        LOGE("no mem for qcamera_hal3_pp_join_t");
+        drop(frameNumber, mTable.editValueAt(idx));
+        mTable.removeItemsAt(idx);
+        return false;
+    }
+    *input = entry;
+    mTable.removeItemsAt(idx);
+
+    for (size_t i = 0; (i < mTable.size()) && (mTable.keyAt(i) < frameNumber);) {
+        qcamera_hal3_pp_join_t &stale = mTable.editValueAt(i);
+        if ((NULL == stale.pp_buffer) && (NULL == stale.metadata)) {
+            // settings only, may still be used by a framework reprocess
+            i++;
+            continue;
+        }
+        LOGE("request %u never got its %s, dropping it", mTable.keyAt(i),
+                (NULL == stale.pp_buffer) ? "frame" : "metadata");
+        drop(mTable.keyAt(i), stale);
+        mTable.removeItemsAt(i);
+    }
+
+    if ((uint32_t)readyQ.getCurrentSize() >= MAX_HAL3_PP_INPUT_DEPTH) {
+        qcamera_hal3_pp_join_t *oldest = (qcamera_hal3_pp_join_t *)readyQ.dequeue();
+        if (NULL != oldest) {
+            LOGE("reprocess input queue full, dropping request %u",
+                    oldest->pp_buffer->frameNumber);
+            drop(oldest->pp_buffer->frameNumber, *oldest);
+            free(oldest);
+        }
+    }
+
+    if (!readyQ.enqueue((void *)input)) {
+        // postproc stopping, its flush fails the pending requests
+        mRelease(*input, mUserData);
+        free(input);
+        return false;
+    }
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : takeJpegSettings
+ *
+ * DESCRIPTION: remove the jpeg settings of a request from the table
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *
+ * RETURN     : ptr to the jpeg settings, NULL if not found
+ *==========================================================================*/
+jpeg_settings_t *QCamera3PPJoinTable::takeJpegSettings(uint32_t frameNumber)
+{
+    ssize_t idx = mTable.indexOfKey(frameNumber);
+    if (idx < 0) {
+        return NULL;
+    }
+
+    qcamera_hal3_pp_join_t &entry = mTable.editValueAt(idx);
+    jpeg_settings_t *jpeg_settings = entry.jpeg_settings;
+    entry.jpeg_settings = NULL;
+    if ((NULL == entry.pp_buffer) && (NULL == entry.metadata)) {
+        mTable.removeItemsAt(idx);
+    }
+    return jpeg_settings;
+}
+
+/*===========================================================================
+ * FUNCTION   : takeDropped
+ *
+ * DESCRIPTION: hand over the requests dropped since the last call. The
+ *              owner fails them and recycles or frees their input frames.
+ *
+ * PARAMETERS :
+ *   @dropped : appended with the dropped requests
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3PPJoinTable::takeDropped(Vector<qcamera_hal3_pp_dropped_t> &dropped)
+{
+    dropped.appendVector(mDropped);
+    mDropped.clear();
+}
+
+/*===========================================================================
+ * FUNCTION   : flush
+ *
+ * DESCRIPTION: release all requests still waiting in the table. They are not
+ *              reported as dropped, flush returns their buffers.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3PPJoinTable::flush()
+{
+    for (size_t i = 0; i < mTable.size(); i++) {
+        mRelease(mTable.editValueAt(i), mUserData);
+    }
+    mTable.clear();
+}
+
+/*===========================================================================
+ * FUNCTION   : drop
+ *
+ * DESCRIPTION: release a request that can no longer complete, keeping its
+ *              input frame for the owner. Entries holding only jpeg settings
+ *              are not reported, their frame and metadata may still come and
+ *              join.
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *   @entry       : its join entry
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3PPJoinTable::drop(uint32_t frameNumber, qcamera_hal3_pp_join_t &entry)
+{
+    if ((NULL != entry.pp_buffer) || (NULL != entry.metadata)) {
+        qcamera_hal3_pp_dropped_t dropped;
+        dropped.frameNumber = frameNumber;
+        dropped.input = NULL;
+        if (NULL != entry.pp_buffer) {
+            dropped.input = entry.pp_buffer->input;
+            entry.pp_buffer->input = NULL;
+        }
+        mDropped.push_back(dropped);
+    }
+    mRelease(entry, mUserData);
+}
+
+}; // namespace qcamera
@@ -0,0 +1,111 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef __QCAMERA3PPJOIN_H__
+#define __QCAMERA3PPJOIN_H__
+
+// System dependencies
+#include <utils/KeyedVector.h>
+#include <utils/Vector.h>
+
+// Camera dependencies
+#include "QCamera3HALHeader.h"
+#include "QCameraQueue.h"
+
+extern "C" {
+#include "mm_camera_interface.h"
+}
+
+namespace qcamera {
+
+typedef struct {
+    mm_camera_super_buf_t *input;
+    buffer_handle_t *output;
+    uint32_t frameNumber;
+} qcamera_hal3_pp_buffer_t;
+
+/* Inputs of one request gathered by frame number before reprocess */
+typedef struct {
+    qcamera_hal3_pp_buffer_t *pp_buffer;    // NULL until the frame arrives
+    mm_camera_super_buf_t *metadata;        // NULL until the metadata arrives
+    jpeg_settings_t *jpeg_settings;         // NULL if not a jpeg request
+} qcamera_hal3_pp_join_t;
+
+/* Request dropped by the join stage */
+typedef struct {
+    uint32_t frameNumber;
+    mm_camera_super_buf_t *input;           // NULL if the frame never came
+} qcamera_hal3_pp_dropped_t;
+
+// Partially joined requests kept before the oldest one is dropped
+#define MAX_HAL3_PP_JOIN_ENTRIES (MAX_INFLIGHT_REQUESTS * 2)
+// Joined or framework inputs queued for reprocess, per queue
+#define MAX_HAL3_PP_INPUT_DEPTH MAX_INFLIGHT_REQUESTS
+
+/* Returns the buffers held by a join entry, the entry is cleared after */
+typedef void (*qcamera_pp_join_release_t)(qcamera_hal3_pp_join_t &entry,
+        void *user_data);
+
+/* Join stage of QCamera3PostProcessor. Gathers the frame, metadata and jpeg
+ * settings of a request by frame number and queues the request for
+ * reprocess once frame and metadata are both present. Not thread safe, the
+ * postprocessor calls it with mReprocJobLock held.
+ *
+ * A request is dropped when the table is full, when a newer request joins
+ * first or when the reprocess queue is full. Its metadata and settings are
+ * released at once; its frame number and input frame are kept until
+ * takeDropped(), so that the owner can fail the request and recycle the
+ * frame with the channel from a thread that holds no HWI lock. */
+class QCamera3PPJoinTable {
+public:
+    QCamera3PPJoinTable(qcamera_pp_join_release_t release, void *userData);
+    virtual ~QCamera3PPJoinTable();
+
+    qcamera_hal3_pp_join_t &getEntry(uint32_t frameNumber);
+    bool join(uint32_t frameNumber, QCameraQueue &readyQ);
+    jpeg_settings_t *takeJpegSettings(uint32_t frameNumber);
+    void takeDropped(android::Vector<qcamera_hal3_pp_dropped_t> &dropped);
+    bool hasDropped() const {return !mDropped.isEmpty();};
+    void flush();
+    size_t size() const {return mTable.size();};
+
+private:
+    void drop(uint32_t frameNumber, qcamera_hal3_pp_join_t &entry);
+
+    qcamera_pp_join_release_t mRelease;
+    void *mUserData;
+    // frame number -> inputs still waiting for their counterpart
+    android::KeyedVector<uint32_t, qcamera_hal3_pp_join_t> mTable;
+    // requests dropped since the last takeDropped()
+    android::Vector<qcamera_hal3_pp_dropped_t> mDropped;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA3PPJOIN_H__ */
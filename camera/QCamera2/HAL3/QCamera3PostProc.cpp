@@ -34,6 +34,7 @@
 
 // System dependencies
 #include <stdio.h>
+#include <stdlib.h>
 
 // Camera dependencies
 #include "QCamera3Channel.h"
@@ -83,8 +84,9 @@ QCamera3PostProcessor::QCamera3PostProcessor(QCamera3ProcessingChannel* ch_ctrl)
       m_ongoingPPQ(releaseOngoingPPData, this),
       m_inputJpegQ(releaseJpegData, this),
       m_ongoingJpegQ(releaseJpegData, this),
-      m_inputMetaQ(releaseMetadata, this),
-      m_jpegSettingsQ(NULL, this)
+      mMaxInflightReproc(DEFAULT_HAL3_REPROC_INFLIGHT),
+      m_joinTable(releaseJoinEntry, this),
+      m_bPPActive(false)
 {
     memset(&mJpegHandle, 0, sizeof(mJpegHandle));
     memset(&mJpegMetadata, 0, sizeof(mJpegMetadata));
@@ -120,8 +122,17 @@ QCamera3PostProcessor::~QCamera3PostProcessor()
 int32_t QCamera3PostProcessor::init(QCamera3StreamMem *memory)
 {
     ATRACE_CALL();
+    char prop[PROPERTY_VALUE_MAX];
     mOutputMem = memory;
+
+    memset(prop, 0, sizeof(prop));
+    property_get("persist.camera.reproc.inflight", prop, "4");
+    int inflight = atoi(prop);
+    mMaxInflightReproc = (inflight > 0) ? (uint32_t)inflight :
+            DEFAULT_HAL3_REPROC_INFLIGHT;
+
     m_dataProcTh.launch(dataProcessRoutine, this);
+    m_jpegProcTh.launch(jpegProcessRoutine, this);
 
     return NO_ERROR;
 }
@@ -141,6 +152,7 @@ int32_t QCamera3PostProcessor::deinit()
 {
     int rc = NO_ERROR;
     m_dataProcTh.exit();
+    m_jpegProcTh.exit();
 
     if (m_pReprocChannel != NULL) {
         m_pReprocChannel->stop();
@@ -257,8 +269,13 @@ int32_t QCamera3PostProcessor::start(const reprocess_config_t &config)
             }
         }
     }
+    m_jpegProcTh.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, TRUE, FALSE);
     m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, TRUE, FALSE);
 
+    pthread_mutex_lock(&mReprocJobLock);
+    m_bPPActive = true;
+    pthread_mutex_unlock(&mReprocJobLock);
+
     return rc;
 }
 
@@ -305,7 +322,13 @@ int32_t QCamera3PostProcessor::flush()
  *==========================================================================*/
 int32_t QCamera3PostProcessor::stop()
 {
+    pthread_mutex_lock(&mReprocJobLock);
+    m_bPPActive = false;
+    pthread_mutex_unlock(&mReprocJobLock);
+
+    // stop reprocess first so no new jpeg jobs show up during encode stop
     m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, TRUE, TRUE);
+    m_jpegProcTh.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, TRUE, TRUE);
 
     if (m_pReprocChannel != NULL) {
         m_pReprocChannel->stop();
@@ -544,51 +567,63 @@ on_error:
     return ret;
 }
 
-int32_t QCamera3PostProcessor::processData(mm_camera_super_buf_t *input) {
-    return processData(input, NULL, 0);
-}
-
 /*===========================================================================
  * FUNCTION   : processData
  *
- * DESCRIPTION: enqueue data into dataProc thread
+ * DESCRIPTION: hand an input frame to the join stage, it is queued for
+ *              reprocess once the metadata of the same request is received
  *
  * PARAMETERS :
- *   @frame   : process input frame
- *   @output  : process output frame
+ *   @input       : process input frame
+ *   @output      : process output frame
+ *   @frameNumber : frame number of the request
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
  *              none-zero failure code
- *
- * NOTE       : depends on if offline reprocess is needed, received frame will
- *              be sent to either input queue of postprocess or jpeg encoding
  *==========================================================================*/
 int32_t QCamera3PostProcessor::processData(mm_camera_super_buf_t *input,
         buffer_handle_t *output, uint32_t frameNumber)
 {
-    LOGD("E");
-    pthread_mutex_lock(&mReprocJobLock);
-
-    // enqueue to post proc input queue
+    LOGD("E frame %u", frameNumber);
     qcamera_hal3_pp_buffer_t *pp_buffer = (qcamera_hal3_pp_buffer_t *)malloc(
             sizeof(qcamera_hal3_pp_buffer_t));
     if (NULL == pp_buffer) {
         LOGE("out of memory");
+        releaseSuperBuf(input);
+        free(input);
         return NO_MEMORY;
     }
     memset(pp_buffer, 0, sizeof(*pp_buffer));
     pp_buffer->input = input;
     pp_buffer->output = output;
     pp_buffer->frameNumber = frameNumber;
-    m_inputPPQ.enqueue((void *)pp_buffer);
-    if (!(m_inputMetaQ.isEmpty())) {
-        LOGD("meta queue is not empty, do next job");
-        m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
-    } else
-        LOGD("metadata queue is empty");
+
+    pthread_mutex_lock(&mReprocJobLock);
+    if (!m_bPPActive) {
+        pthread_mutex_unlock(&mReprocJobLock);
+        LOGH("postproc not active, return frame %u", frameNumber);
+        releaseSuperBuf(input);
+        free(input);
+        free(pp_buffer);
+        return NO_INIT;
+    }
+
+    qcamera_hal3_pp_join_t &entry = m_joinTable.getEntry(frameNumber);
+    if (NULL != entry.pp_buffer) {
+        LOGE("frame %u received twice, dropping the older one", frameNumber);
+        releaseSuperBuf(entry.pp_buffer->input);
+        free(entry.pp_buffer->input);
+        free(entry.pp_buffer);
+    }
+    entry.pp_buffer = pp_buffer;
+    bool queued = m_joinTable.join(frameNumber, m_inputPPQ);
+    bool dropped = m_joinTable.hasDropped();
     pthread_mutex_unlock(&mReprocJobLock);
 
+    if (queued || dropped) {
+        m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+    }
     return NO_ERROR;
 }
 
@@ -656,13 +691,22 @@ int32_t QCamera3PostProcessor::processData(qcamera_fwk_input_pp_data_t *frame)
     if (needsReprocess(frame)) {
         ATRACE_INT("Camera:Reprocess", 1);
         LOGH("scheduling framework reprocess");
-        pthread_mutex_lock(&mReprocJobLock);
+        if ((uint32_t)m_inputFWKPPQ.getCurrentSize() >= MAX_HAL3_PP_INPUT_DEPTH) {
+            LOGE("framework reprocess queue full, rejecting frame %u",
+                    frame->frameNumber);
+            return -ENOSPC;
+        }
         // enqueu to post proc input queue
-        m_inputFWKPPQ.enqueue((void *)frame);
+        if (!m_inputFWKPPQ.enqueue((void *)frame)) {
+            LOGE("postproc not active, rejecting frame %u", frame->frameNumber);
+            return NO_INIT;
+        }
         m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
-        pthread_mutex_unlock(&mReprocJobLock);
     } else {
-        jpeg_settings_t *jpeg_settings = (jpeg_settings_t *)m_jpegSettingsQ.dequeue();
+        pthread_mutex_lock(&mReprocJobLock);
+        jpeg_settings_t *jpeg_settings =
+                m_joinTable.takeJpegSettings(frame->frameNumber);
+        pthread_mutex_unlock(&mReprocJobLock);
 
         if (jpeg_settings == NULL) {
             LOGE("Cannot find jpeg settings");
@@ -685,7 +729,7 @@ int32_t QCamera3PostProcessor::processData(qcamera_fwk_input_pp_data_t *frame)
 
         // enqueu to jpeg input queue
         m_inputJpegQ.enqueue((void *)jpeg_job);
-        m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+        m_jpegProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
     }
 
     return NO_ERROR;
@@ -694,39 +738,57 @@ int32_t QCamera3PostProcessor::processData(qcamera_fwk_input_pp_data_t *frame)
 /*===========================================================================
  * FUNCTION   : processPPMetadata
  *
- * DESCRIPTION: enqueue data into dataProc thread
+ * DESCRIPTION: hand reprocess metadata to the join stage, it is queued for
+ *              reprocess once the input frame of the same request is received
  *
  * PARAMETERS :
- *   @frame   : process metadata frame received from pic channel
+ *   @reproc_meta : process metadata frame received from pic channel
+ *   @frameNumber : frame number of the request
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
  *              none-zero failure code
  *
  *==========================================================================*/
-int32_t QCamera3PostProcessor::processPPMetadata(mm_camera_super_buf_t *reproc_meta)
+int32_t QCamera3PostProcessor::processPPMetadata(mm_camera_super_buf_t *reproc_meta,
+        uint32_t frameNumber)
 {
-    LOGD("E");
+    LOGD("E frame %u", frameNumber);
     pthread_mutex_lock(&mReprocJobLock);
-    // enqueue to metadata input queue
-    m_inputMetaQ.enqueue((void *)reproc_meta);
-    if (!(m_inputPPQ.isEmpty())) {
-       LOGD("pp queue is not empty, do next job");
-       m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
-    } else {
-       LOGD("pp queue is empty, not calling do next job");
+    if (!m_bPPActive) {
+        pthread_mutex_unlock(&mReprocJobLock);
+        LOGH("postproc not active, return metadata %u", frameNumber);
+        m_parent->metadataBufDone(reproc_meta);
+        free(reproc_meta);
+        return NO_INIT;
+    }
+
+    qcamera_hal3_pp_join_t &entry = m_joinTable.getEntry(frameNumber);
+    if (NULL != entry.metadata) {
+        LOGE("metadata %u received twice, dropping the older one", frameNumber);
+        m_parent->metadataBufDone(entry.metadata);
+        free(entry.metadata);
     }
+    entry.metadata = reproc_meta;
+    bool queued = m_joinTable.join(frameNumber, m_inputPPQ);
+    bool dropped = m_joinTable.hasDropped();
     pthread_mutex_unlock(&mReprocJobLock);
+
+    if (queued || dropped) {
+        m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+    }
     return NO_ERROR;
 }
 
 /*===========================================================================
  * FUNCTION   : processJpegSettingData
  *
- * DESCRIPTION: enqueue jpegSetting into dataProc thread
+ * DESCRIPTION: store jpeg settings until the request is reprocessed or
+ *              encoded
  *
  * PARAMETERS :
  *   @jpeg_settings : jpeg settings data received from pic channel
+ *   @frameNumber   : frame number of the request
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
@@ -734,13 +796,117 @@ int32_t QCamera3PostProcessor::processPPMetadata(mm_camera_super_buf_t *reproc_m
  *
  *==========================================================================*/
 int32_t QCamera3PostProcessor::processJpegSettingData(
-        jpeg_settings_t *jpeg_settings)
+        jpeg_settings_t *jpeg_settings, uint32_t frameNumber)
 {
     if (!jpeg_settings) {
         LOGE("invalid jpeg settings pointer");
         return -EINVAL;
     }
-    return m_jpegSettingsQ.enqueue((void *)jpeg_settings);
+
+    pthread_mutex_lock(&mReprocJobLock);
+    if (!m_bPPActive) {
+        pthread_mutex_unlock(&mReprocJobLock);
+        LOGE("postproc not active, drop jpeg settings %u", frameNumber);
+        free(jpeg_settings);
+        return NO_INIT;
+    }
+
+    qcamera_hal3_pp_join_t &entry = m_joinTable.getEntry(frameNumber);
+    if (NULL != entry.jpeg_settings) {
+        LOGE("jpeg settings %u received twice, dropping the older one",
+                frameNumber);
+        free(entry.jpeg_settings);
+    }
+    entry.jpeg_settings = jpeg_settings;
+    bool dropped = m_joinTable.hasDropped();
+    pthread_mutex_unlock(&mReprocJobLock);
+
+    if (dropped) {
+        m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+    }
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseJoinData
+ *
+ * DESCRIPTION: return the buffers held by a join entry
+ *
+ * PARAMETERS :
+ *   @entry   : join entry, cleared on return
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3PostProcessor::releaseJoinData(qcamera_hal3_pp_join_t &entry)
+{
+    if (NULL != entry.pp_buffer) {
+        if (NULL != entry.pp_buffer->input) {
+            releaseSuperBuf(entry.pp_buffer->input);
+            free(entry.pp_buffer->input);
+        }
+        free(entry.pp_buffer);
+    }
+    if (NULL != entry.metadata) {
+        m_parent->metadataBufDone(entry.metadata);
+        free(entry.metadata);
+    }
+    if (NULL != entry.jpeg_settings) {
+        free(entry.jpeg_settings);
+    }
+    memset(&entry, 0, sizeof(entry));
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseJoinEntry
+ *
+ * DESCRIPTION: join table callback returning the buffers of a dropped or
+ *              flushed request
+ *
+ * PARAMETERS :
+ *   @entry     : join entry, cleared on return
+ *   @user_data : ptr to the postprocessor
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3PostProcessor::releaseJoinEntry(qcamera_hal3_pp_join_t &entry,
+        void *user_data)
+{
+    QCamera3PostProcessor *pme = (QCamera3PostProcessor *)user_data;
+    if (NULL != pme) {
+        pme->releaseJoinData(entry);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : returnDroppedRequests
+ *
+ * DESCRIPTION: have the channel fail the requests the join stage dropped
+ *              and take back their input frames. Runs on the data proc
+ *              thread: frames and metadata are joined with the HWI lock
+ *              held, which the channel callbacks take.
+ *
+ * PARAMETERS :
+ *   @active : false when stopping, the inputs are then released and the
+ *             requests left to the HWI flush
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3PostProcessor::returnDroppedRequests(bool active)
+{
+    android::Vector<qcamera_hal3_pp_dropped_t> dropped;
+    pthread_mutex_lock(&mReprocJobLock);
+    m_joinTable.takeDropped(dropped);
+    pthread_mutex_unlock(&mReprocJobLock);
+
+    for (size_t i = 0; i < dropped.size(); i++) {
+        if (active) {
+            m_parent->returnDroppedRequest(dropped[i].frameNumber,
+                    dropped[i].input);
+        } else if (NULL != dropped[i].input) {
+            releaseSuperBuf(dropped[i].input);
+            free(dropped[i].input);
+        }
+    }
 }
 
 /*===========================================================================
@@ -749,7 +915,8 @@ int32_t QCamera3PostProcessor::processJpegSettingData(
  * DESCRIPTION: process received frame after reprocess.
  *
  * PARAMETERS :
- *   @frame   : received frame from reprocess channel.
+ *   @frame       : received frame from reprocess channel.
+ *   @frameNumber : frame number of the request
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
@@ -757,9 +924,10 @@ int32_t QCamera3PostProcessor::processJpegSettingData(
  *
  * NOTE       : The frame after reprocess need to send to jpeg encoding.
  *==========================================================================*/
-int32_t QCamera3PostProcessor::processPPData(mm_camera_super_buf_t *frame)
+int32_t QCamera3PostProcessor::processPPData(mm_camera_super_buf_t *frame,
+        uint32_t frameNumber)
 {
-    qcamera_hal3_pp_data_t *job = (qcamera_hal3_pp_data_t *)m_ongoingPPQ.dequeue();
+    qcamera_hal3_pp_data_t *job = dequeueOngoingPPJob(frameNumber);
     ATRACE_INT("Camera:Reprocess", 0);
     if (job == NULL || ((NULL == job->src_frame) && (NULL == job->fwk_src_frame))) {
         LOGE("Cannot find reprocess job");
@@ -795,9 +963,15 @@ int32_t QCamera3PostProcessor::processPPData(mm_camera_super_buf_t *frame)
     free(job);
 
     // enqueu reprocessed frame to jpeg input queue
-    m_inputJpegQ.enqueue((void *)jpeg_job);
+    if (!m_inputJpegQ.enqueue((void *)jpeg_job)) {
+        LOGE("jpeg stage stopped, dropping frame %u", frameNumber);
+        releaseJpegJobData(jpeg_job);
+        free(jpeg_job);
+        return NO_INIT;
+    }
 
-    // wait up data proc thread
+    // wake up jpeg thread, and reprocess thread as a reprocess slot is free
+    m_jpegProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
     m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
 
     return NO_ERROR;
@@ -814,20 +988,51 @@ int32_t QCamera3PostProcessor::processPPData(mm_camera_super_buf_t *frame)
  * RETURN     : ptr to a pp job struct. NULL if not found.
  *==========================================================================*/
 qcamera_hal3_pp_data_t *QCamera3PostProcessor::dequeuePPJob(uint32_t frameNumber) {
-    qcamera_hal3_pp_data_t *pp_job = NULL;
-    pp_job = (qcamera_hal3_pp_data_t *)m_ongoingPPQ.dequeue();
+    return dequeueOngoingPPJob(frameNumber);
+}
 
+/*===========================================================================
+ * FUNCTION   : dequeueOngoingPPJob
+ *
+ * DESCRIPTION: remove a postprocessing job from ongoing pp queue by frame
+ *              number
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number for the pp job
+ *
+ * RETURN     : ptr to a pp job struct. NULL if no job matches.
+ *==========================================================================*/
+qcamera_hal3_pp_data_t *QCamera3PostProcessor::dequeueOngoingPPJob(
+        uint32_t frameNumber)
+{
+    qcamera_hal3_pp_data_t *pp_job = (qcamera_hal3_pp_data_t *)
+            m_ongoingPPQ.dequeue(matchPPFrameNumber, (void *)&frameNumber);
     if (pp_job == NULL) {
-        LOGE("Fatal: ongoing PP queue is empty");
-        return NULL;
-    }
-    if (pp_job->fwk_src_frame &&
-            (pp_job->fwk_src_frame->frameNumber != frameNumber)) {
-        LOGE("head of pp queue doesn't match requested frame number");
+        LOGE("no pp job for frame %u, %d jobs ongoing", frameNumber,
+                m_ongoingPPQ.getCurrentSize());
     }
     return pp_job;
 }
 
+/*===========================================================================
+ * FUNCTION   : matchPPFrameNumber
+ *
+ * DESCRIPTION: match function for ongoing pp jobs by frame number
+ *
+ * PARAMETERS :
+ *   @data       : ptr to a pp job struct
+ *   @user_data  : not used
+ *   @match_data : ptr to the frame number
+ *
+ * RETURN     : true if the job belongs to the frame number
+ *==========================================================================*/
+bool QCamera3PostProcessor::matchPPFrameNumber(void *data, void *,
+        void *match_data)
+{
+    qcamera_hal3_pp_data_t *pp_job = (qcamera_hal3_pp_data_t *)data;
+    return pp_job->frameNumber == *((uint32_t *)match_data);
+}
+
 /*===========================================================================
  * FUNCTION   : findJpegJobByJobId
  *
@@ -837,10 +1042,6 @@ qcamera_hal3_pp_data_t *QCamera3PostProcessor::dequeuePPJob(uint32_t frameNumber
  *   @jobId   : job Id of the job
  *
  * RETURN     : ptr to a jpeg job struct. NULL if not found.
- *
- * NOTE       : Currently only one job is sending to mm-jpeg-interface for jpeg
- *              encoding. Therefore simply dequeue from the ongoing Jpeg Queue
- *              will serve the purpose to find the jpeg job.
  *==========================================================================*/
 qcamera_hal3_jpeg_data_t *QCamera3PostProcessor::findJpegJobByJobId(uint32_t jobId)
 {
@@ -850,53 +1051,50 @@ qcamera_hal3_jpeg_data_t *QCamera3PostProcessor::findJpegJobByJobId(uint32_t job
         return NULL;
     }
 
-    // currely only one jpeg job ongoing, so simply dequeue the head
-    job = (qcamera_hal3_jpeg_data_t *)m_ongoingJpegQ.dequeue();
+    job = (qcamera_hal3_jpeg_data_t *)m_ongoingJpegQ.dequeue(matchJpegJobId,
+            (void *)&jobId);
+    if (job == NULL) {
+        // the callback may race with storing the ID returned by start_job
+        job = (qcamera_hal3_jpeg_data_t *)m_ongoingJpegQ.dequeue();
+        LOGW("no ongoing jpeg job %u, using the oldest one", jobId);
+    }
     return job;
 }
 
 /*===========================================================================
- * FUNCTION   : releasePPInputData
+ * FUNCTION   : matchJpegJobId
  *
- * DESCRIPTION: callback function to release post process input data node
+ * DESCRIPTION: match function for ongoing jpeg jobs by job ID
  *
  * PARAMETERS :
- *   @data      : ptr to post process input data
- *   @user_data : user data ptr (QCamera3Reprocessor)
+ *   @data       : ptr to a jpeg job struct
+ *   @user_data  : not used
+ *   @match_data : ptr to the job ID
  *
- * RETURN     : None
+ * RETURN     : true if the job has the job ID
  *==========================================================================*/
-void QCamera3PostProcessor::releasePPInputData(void *data, void *user_data)
+bool QCamera3PostProcessor::matchJpegJobId(void *data, void *, void *match_data)
 {
-    QCamera3PostProcessor *pme = (QCamera3PostProcessor *)user_data;
-    if (NULL != pme) {
-        qcamera_hal3_pp_buffer_t *buf = (qcamera_hal3_pp_buffer_t *)data;
-        if (NULL != buf) {
-            if (buf->input) {
-                pme->releaseSuperBuf(buf->input);
-                free(buf->input);
-                buf->input = NULL;
-            }
-        }
-    }
+    qcamera_hal3_jpeg_data_t *job = (qcamera_hal3_jpeg_data_t *)data;
+    return job->jobId == *((uint32_t *)match_data);
 }
 
 /*===========================================================================
- * FUNCTION   : releaseMetaData
+ * FUNCTION   : releasePPInputData
  *
- * DESCRIPTION: callback function to release metadata camera buffer
+ * DESCRIPTION: callback function to release post process input data node
  *
  * PARAMETERS :
- *   @data      : ptr to post process input data
+ *   @data      : ptr to joined post process input data
  *   @user_data : user data ptr (QCamera3Reprocessor)
  *
  * RETURN     : None
  *==========================================================================*/
-void QCamera3PostProcessor::releaseMetadata(void *data, void *user_data)
+void QCamera3PostProcessor::releasePPInputData(void *data, void *user_data)
 {
     QCamera3PostProcessor *pme = (QCamera3PostProcessor *)user_data;
-    if (NULL != pme) {
-        pme->m_parent->metadataBufDone((mm_camera_super_buf_t *)data);
+    if ((NULL != pme) && (NULL != data)) {
+        pme->releaseJoinData(*(qcamera_hal3_pp_join_t *)data);
     }
 }
 
@@ -1045,7 +1243,8 @@ void QCamera3PostProcessor::releaseJpegJobData(qcamera_hal3_jpeg_data_t *job)
             job->jpeg_settings = NULL;
         }
     }
-    /* Additional trigger to process any pending jobs in the input queue */
+    /* Additional trigger to process any pending jobs in the input queues */
+    m_jpegProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
     m_dataProcTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
     LOGD("X");
 }
@@ -1943,12 +2142,140 @@ int32_t QCamera3PostProcessor::encodeData(qcamera_hal3_jpeg_data_t *jpeg_job_dat
     return ret;
 }
 
+/*===========================================================================
+ * FUNCTION   : reprocessFWKFrame
+ *
+ * DESCRIPTION: send a framework reprocess request to the reprocess channel
+ *
+ * PARAMETERS :
+ *   @fwk_frame : framework input frame, owned by the pp job on success and
+ *                freed on failure
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3PostProcessor::reprocessFWKFrame(
+        qcamera_fwk_input_pp_data_t *fwk_frame)
+{
+    int32_t ret = NO_ERROR;
+    uint32_t frameNumber = fwk_frame->frameNumber;
+    qcamera_hal3_pp_data_t *pp_job =
+            (qcamera_hal3_pp_data_t *)malloc(sizeof(qcamera_hal3_pp_data_t));
+    if (pp_job == NULL) {
+        LOGE("no mem for qcamera_hal3_pp_data_t");
+        free(fwk_frame);
+        return NO_MEMORY;
+    }
+
+    memset(pp_job, 0, sizeof(qcamera_hal3_pp_data_t));
+    pthread_mutex_lock(&mReprocJobLock);
+    pp_job->jpeg_settings = m_joinTable.takeJpegSettings(frameNumber);
+    pthread_mutex_unlock(&mReprocJobLock);
+    pp_job->frameNumber = frameNumber;
+
+    if (m_pReprocChannel != NULL) {
+        if (NO_ERROR != m_pReprocChannel->overrideFwkMetadata(fwk_frame)) {
+            LOGE("Failed to extract output crop");
+        }
+        // add into ongoing PP job Q
+        pp_job->fwk_src_frame = fwk_frame;
+        m_ongoingPPQ.enqueue((void *)pp_job);
+        ret = m_pReprocChannel->doReprocessOffline(fwk_frame);
+        if (NO_ERROR != ret) {
+            // remove from ongoing PP job Q
+            m_ongoingPPQ.dequeue(matchPPFrameNumber, (void *)&frameNumber);
+        }
+    } else {
+        LOGE("Reprocess channel is NULL");
+        ret = -1;
+    }
+
+    if (NO_ERROR != ret) {
+        if (NULL != pp_job->jpeg_settings) {
+            free(pp_job->jpeg_settings);
+        }
+        free(pp_job);
+        free(fwk_frame);
+    }
+    return ret;
+}
+
+/*===========================================================================
+ * FUNCTION   : reprocessFrame
+ *
+ * DESCRIPTION: send a joined internal request to the reprocess channel, or
+ *              straight to jpeg encoding if there is no reprocess channel
+ *
+ * PARAMETERS :
+ *   @input   : joined input frame, metadata and jpeg settings. Freed on
+ *              return, its buffers are owned by the pp job on success and
+ *              released on failure.
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3PostProcessor::reprocessFrame(qcamera_hal3_pp_join_t *input)
+{
+    int32_t ret = NO_ERROR;
+    qcamera_hal3_pp_buffer_t *pp_buffer = input->pp_buffer;
+    mm_camera_super_buf_t *meta_buffer = input->metadata;
+    uint32_t frameNumber = pp_buffer->frameNumber;
+    qcamera_hal3_pp_data_t *pp_job =
+            (qcamera_hal3_pp_data_t *)malloc(sizeof(qcamera_hal3_pp_data_t));
+    if (pp_job == NULL) {
+        LOGE("no mem for qcamera_hal3_pp_data_t");
+        releaseJoinData(*input);
+        free(input);
+        return NO_MEMORY;
+    }
+
+    LOGH("reprocess frame %u", frameNumber);
+    memset(pp_job, 0, sizeof(qcamera_hal3_pp_data_t));
+    pp_job->src_frame = pp_buffer->input;
+    pp_job->src_metadata = meta_buffer;
+    if (meta_buffer->bufs[0] != NULL) {
+        pp_job->metadata = (metadata_buffer_t *)meta_buffer->bufs[0]->buffer;
+    }
+    pp_job->jpeg_settings = input->jpeg_settings;
+    pp_job->frameNumber = frameNumber;
+    m_ongoingPPQ.enqueue((void *)pp_job);
+
+    if (m_pReprocChannel != NULL) {
+        qcamera_fwk_input_pp_data_t fwk_frame;
+        memset(&fwk_frame, 0, sizeof(qcamera_fwk_input_pp_data_t));
+        fwk_frame.frameNumber = frameNumber;
+        ret = m_pReprocChannel->overrideMetadata(pp_buffer, meta_buffer->bufs[0],
+                pp_job->jpeg_settings, fwk_frame);
+        if (NO_ERROR == ret) {
+            ret = m_pReprocChannel->doReprocessOffline(&fwk_frame, true);
+        }
+        if (NO_ERROR != ret) {
+            // remove from ongoing PP job Q
+            m_ongoingPPQ.dequeue(matchPPFrameNumber, (void *)&frameNumber);
+        }
+    } else {
+        LOGE("No reprocess. Calling processPPData directly");
+        ret = processPPData(pp_buffer->input, frameNumber);
+    }
+
+    if (NO_ERROR != ret) {
+        free(pp_job);
+        releaseJoinData(*input);
+    } else {
+        free(pp_buffer);
+    }
+    free(input);
+    return ret;
+}
+
 /*===========================================================================
  * FUNCTION   : dataProcessRoutine
  *
- * DESCRIPTION: data process routine that handles input data either from input
- *              Jpeg Queue to do jpeg encoding, or from input PP Queue to do
- *              reprocess.
+ * DESCRIPTION: reprocess stage. Sends framework requests and joined requests
+ *              from the input PP Queue to the reprocess channel, keeping at
+ *              most mMaxInflightReproc of them in flight.
  *
  * PARAMETERS :
  *   @data    : user data ptr (QCamera3PostProcessor)
@@ -1960,8 +2287,6 @@ void *QCamera3PostProcessor::dataProcessRoutine(void *data)
     int running = 1;
     int ret;
     uint8_t is_active = FALSE;
-    uint8_t needNewSess = TRUE;
-    mm_camera_super_buf_t *meta_buffer = NULL;
     LOGD("E");
     QCamera3PostProcessor *pme = (QCamera3PostProcessor *)data;
     QCameraCmdThread *cmdThread = &pme->m_dataProcTh;
@@ -1983,14 +2308,10 @@ void *QCamera3PostProcessor::dataProcessRoutine(void *data)
         case CAMERA_CMD_TYPE_START_DATA_PROC:
             LOGH("start data proc");
             is_active = TRUE;
-            needNewSess = TRUE;
 
             pme->m_ongoingPPQ.init();
-            pme->m_inputJpegQ.init();
             pme->m_inputPPQ.init();
             pme->m_inputFWKPPQ.init();
-            pme->m_inputMetaQ.init();
-            pme->m_jpegSettingsQ.init();
             cam_sem_post(&cmdThread->sync_sem);
 
             break;
@@ -1999,6 +2320,123 @@ void *QCamera3PostProcessor::dataProcessRoutine(void *data)
                 LOGH("stop data proc");
                 is_active = FALSE;
 
+                // flush ongoing postproc Queue
+                pme->m_ongoingPPQ.flush();
+
+                // flush input Postproc Queue
+                pme->m_inputPPQ.flush();
+
+                // flush framework input Postproc Queue
+                pme->m_inputFWKPPQ.flush();
+
+                // drop requests still waiting for frame or metadata
+                pthread_mutex_lock(&pme->mReprocJobLock);
+                pme->m_joinTable.flush();
+                pthread_mutex_unlock(&pme->mReprocJobLock);
+                pme->returnDroppedRequests(false);
+
+                // signal cmd is completed
+                cam_sem_post(&cmdThread->sync_sem);
+            }
+            break;
+        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
+            {
+                LOGH("Do next job, active is %d", is_active);
+                pme->returnDroppedRequests(is_active == TRUE);
+                if (is_active == TRUE) {
+                    while ((uint32_t)pme->m_ongoingPPQ.getCurrentSize() <
+                            pme->mMaxInflightReproc) {
+                        // framework pp jobs go first, they are not joined
+                        qcamera_fwk_input_pp_data_t *fwk_frame =
+                                (qcamera_fwk_input_pp_data_t *)pme->m_inputFWKPPQ.dequeue();
+                        if (NULL != fwk_frame) {
+                            pme->reprocessFWKFrame(fwk_frame);
+                            continue;
+                        }
+
+                        qcamera_hal3_pp_join_t *input =
+                                (qcamera_hal3_pp_join_t *)pme->m_inputPPQ.dequeue();
+                        if (NULL == input) {
+                            break;
+                        }
+                        pme->reprocessFrame(input);
+                    }
+                } else {
+                    // not active, simply return buf and do no op
+                    qcamera_hal3_pp_join_t *input =
+                            (qcamera_hal3_pp_join_t *)pme->m_inputPPQ.dequeue();
+                    if (NULL != input) {
+                        pme->releaseJoinData(*input);
+                        free(input);
+                    }
+                    qcamera_fwk_input_pp_data_t *fwk_frame =
+                            (qcamera_fwk_input_pp_data_t *) pme->m_inputFWKPPQ.dequeue();
+                    if (NULL != fwk_frame) {
+                        free(fwk_frame);
+                    }
+                }
+            }
+            break;
+        case CAMERA_CMD_TYPE_EXIT:
+            running = 0;
+            break;
+        default:
+            break;
+        }
+    } while (running);
+    LOGD("X");
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : jpegProcessRoutine
+ *
+ * DESCRIPTION: encode stage. Sends jobs from the input Jpeg Queue to jpeg
+ *              encoding, one at a time as the session is set up per job.
+ *
+ * PARAMETERS :
+ *   @data    : user data ptr (QCamera3PostProcessor)
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void *QCamera3PostProcessor::jpegProcessRoutine(void *data)
+{
+    int running = 1;
+    int ret;
+    uint8_t is_active = FALSE;
+    uint8_t needNewSess = TRUE;
+    LOGD("E");
+    QCamera3PostProcessor *pme = (QCamera3PostProcessor *)data;
+    QCameraCmdThread *cmdThread = &pme->m_jpegProcTh;
+    cmdThread->setName("cam_jpeg_proc");
+
+    do {
+        do {
+            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            if (ret != 0 && errno != EINVAL) {
+                LOGE("cam_sem_wait error (%s)",
+                            strerror(errno));
+                return NULL;
+            }
+        } while (ret != 0);
+
+        // we got notified about new cmd avail in cmd queue
+        camera_cmd_type_t cmd = cmdThread->getCmd();
+        switch (cmd) {
+        case CAMERA_CMD_TYPE_START_DATA_PROC:
+            LOGH("start jpeg proc");
+            is_active = TRUE;
+            needNewSess = TRUE;
+
+            pme->m_inputJpegQ.init();
+            cam_sem_post(&cmdThread->sync_sem);
+
+            break;
+        case CAMERA_CMD_TYPE_STOP_DATA_PROC:
+            {
+                LOGH("stop jpeg proc");
+                is_active = FALSE;
+
                 // cancel all ongoing jpeg jobs
                 qcamera_hal3_jpeg_data_t *jpeg_job =
                     (qcamera_hal3_jpeg_data_t *)pme->m_ongoingJpegQ.dequeue();
@@ -2019,21 +2457,9 @@ void *QCamera3PostProcessor::dataProcessRoutine(void *data)
 
                 needNewSess = TRUE;
 
-                // flush ongoing postproc Queue
-                pme->m_ongoingPPQ.flush();
-
                 // flush input jpeg Queue
                 pme->m_inputJpegQ.flush();
 
-                // flush input Postproc Queue
-                pme->m_inputPPQ.flush();
-
-                // flush framework input Postproc Queue
-                pme->m_inputFWKPPQ.flush();
-
-                pme->m_inputMetaQ.flush();
-                pme->m_jpegSettingsQ.flush();
-
                 // signal cmd is completed
                 cam_sem_post(&cmdThread->sync_sem);
             }
@@ -2070,135 +2496,6 @@ void *QCamera3PostProcessor::dataProcessRoutine(void *data)
                             }
                         }
                     }
-
-                    // check if there are any framework pp jobs
-                    if (!pme->m_inputFWKPPQ.isEmpty()) {
-                        qcamera_fwk_input_pp_data_t *fwk_frame =
-                                (qcamera_fwk_input_pp_data_t *) pme->m_inputFWKPPQ.dequeue();
-                        if (NULL != fwk_frame) {
-                            qcamera_hal3_pp_data_t *pp_job =
-                                    (qcamera_hal3_pp_data_t *)malloc(sizeof(qcamera_hal3_pp_data_t));
-                            jpeg_settings_t *jpeg_settings =
-                                    (jpeg_settings_t *)pme->m_jpegSettingsQ.dequeue();
-                            if (pp_job != NULL) {
-                                memset(pp_job, 0, sizeof(qcamera_hal3_pp_data_t));
-                                pp_job->jpeg_settings = jpeg_settings;
-                                if (pme->m_pReprocChannel != NULL) {
-                                    if (NO_ERROR != pme->m_pReprocChannel->overrideFwkMetadata(fwk_frame)) {
-                                        LOGE("Failed to extract output crop");
-                                    }
-                                    // add into ongoing PP job Q
-                                    pp_job->fwk_src_frame = fwk_frame;
-                                    pme->m_ongoingPPQ.enqueue((void *)pp_job);
-                                    ret = pme->m_pReprocChannel->doReprocessOffline(fwk_frame);
-                                    if (NO_ERROR != ret) {
-                                        // remove from ongoing PP job Q
-                                        pme->m_ongoingPPQ.dequeue(false);
-                                    }
-                                } else {
-                                    LOGE("Reprocess channel is NULL");
-                                    ret = -1;
-                                }
-                            } else {
-                                LOGE("no mem for qcamera_hal3_pp_data_t");
-                                ret = -1;
-                            }
-
-                            if (0 != ret) {
-                                // free pp_job
-                                if (pp_job != NULL) {
-                                    free(pp_job);
-                                }
-                                // free frame
-                                if (fwk_frame != NULL) {
-                                    free(fwk_frame);
-                                }
-                            }
-                        }
-                    }
-
-                    LOGH("dequeuing pp frame");
-                    pthread_mutex_lock(&pme->mReprocJobLock);
-                    if(!pme->m_inputPPQ.isEmpty() && !pme->m_inputMetaQ.isEmpty()) {
-                        qcamera_hal3_pp_buffer_t *pp_buffer =
-                            (qcamera_hal3_pp_buffer_t *)pme->m_inputPPQ.dequeue();
-                        meta_buffer =
-                            (mm_camera_super_buf_t *)pme->m_inputMetaQ.dequeue();
-                        jpeg_settings_t *jpeg_settings =
-                           (jpeg_settings_t *)pme->m_jpegSettingsQ.dequeue();
-                        pthread_mutex_unlock(&pme->mReprocJobLock);
-                        qcamera_hal3_pp_data_t *pp_job =
-                            (qcamera_hal3_pp_data_t *)malloc(sizeof(qcamera_hal3_pp_data_t));
-                        if (pp_job == NULL) {
-                            LOGE("no mem for qcamera_hal3_pp_data_t");
-                            ret = -1;
-                        } else if (meta_buffer == NULL) {
-                            LOGE("failed to dequeue from m_inputMetaQ");
-                            ret = -1;
-                        } else if (pp_buffer == NULL) {
-                            LOGE("failed to dequeue from m_inputPPQ");
-                            ret = -1;
-                        } else if (pp_buffer != NULL){
-                            memset(pp_job, 0, sizeof(qcamera_hal3_pp_data_t));
-                            pp_job->src_frame = pp_buffer->input;
-                            pp_job->src_metadata = meta_buffer;
-                            if (meta_buffer->bufs[0] != NULL) {
-                                pp_job->metadata = (metadata_buffer_t *)
-                                        meta_buffer->bufs[0]->buffer;
-                            }
-                            pp_job->jpeg_settings = jpeg_settings;
-                            pme->m_ongoingPPQ.enqueue((void *)pp_job);
-                            if (pme->m_pReprocChannel != NULL) {
-                                mm_camera_buf_def_t *meta_buffer_arg = NULL;
-                                meta_buffer_arg = meta_buffer->bufs[0];
-                                qcamera_fwk_input_pp_data_t fwk_frame;
-                                memset(&fwk_frame, 0, sizeof(qcamera_fwk_input_pp_data_t));
-                                fwk_frame.frameNumber = pp_buffer->frameNumber;
-                                ret = pme->m_pReprocChannel->overrideMetadata(
-                                        pp_buffer, meta_buffer_arg,
-                                        pp_job->jpeg_settings,
-                                        fwk_frame);
-                                if (NO_ERROR == ret) {
-                                    // add into ongoing PP job Q
-                                    ret = pme->m_pReprocChannel->doReprocessOffline(
-                                            &fwk_frame, true);
-                                    if (NO_ERROR != ret) {
-                                        // remove from ongoing PP job Q
-                                        pme->m_ongoingPPQ.dequeue(false);
-                                    }
-                                }
-                            } else {
-                                LOGE("No reprocess. Calling processPPData directly");
-                                ret = pme->processPPData(pp_buffer->input);
-                            }
-                        }
-
-                        if (0 != ret) {
-                            // free pp_job
-                            if (pp_job != NULL) {
-                                free(pp_job);
-                            }
-                            // free frame
-                            if (pp_buffer != NULL) {
-                                if (pp_buffer->input) {
-                                    pme->releaseSuperBuf(pp_buffer->input);
-                                    free(pp_buffer->input);
-                                }
-                                free(pp_buffer);
-                            }
-                            //free metadata
-                            if (NULL != meta_buffer) {
-                                pme->m_parent->metadataBufDone(meta_buffer);
-                                free(meta_buffer);
-                            }
-                        } else {
-                            if (pp_buffer != NULL) {
-                                free(pp_buffer);
-                            }
-                        }
-                    } else {
-                        pthread_mutex_unlock(&pme->mReprocJobLock);
-                    }
                 } else {
                     // not active, simply return buf and do no op
                     qcamera_hal3_jpeg_data_t *jpeg_job =
@@ -2206,27 +2503,6 @@ void *QCamera3PostProcessor::dataProcessRoutine(void *data)
                     if (NULL != jpeg_job) {
                         free(jpeg_job);
                     }
-
-                    qcamera_hal3_pp_buffer_t* pp_buf =
-                            (qcamera_hal3_pp_buffer_t *)pme->m_inputPPQ.dequeue();
-                    if (NULL != pp_buf) {
-                        if (pp_buf->input) {
-                            pme->releaseSuperBuf(pp_buf->input);
-                            free(pp_buf->input);
-                            pp_buf->input = NULL;
-                        }
-                        free(pp_buf);
-                    }
-                    mm_camera_super_buf_t *metadata = (mm_camera_super_buf_t *)pme->m_inputMetaQ.dequeue();
-                    if (metadata != NULL) {
-                        pme->m_parent->metadataBufDone(metadata);
-                        free(metadata);
-                    }
-                    qcamera_fwk_input_pp_data_t *fwk_frame =
-                            (qcamera_fwk_input_pp_data_t *) pme->m_inputFWKPPQ.dequeue();
-                    if (NULL != fwk_frame) {
-                        free(fwk_frame);
-                    }
                 }
             }
             break;
@@ -2794,27 +3070,7 @@ QCamera3Exif *QCamera3PostProcessor::getExifData(metadata_buffer_t *metadata,
 
 #ifdef ENABLE_MODEL_INFO_EXIF
 
-    char value[PROPERTY_VALUE_MAX];
-    if (property_get("ro.product.manufacturer", value, "QCOM-AA") > 0) {
-        exif->addEntry(EXIFTAGID_MAKE, EXIF_ASCII,
-                (uint32_t)(strlen(value) + 1), (void *)value);
-    } else {
-        LOGW("getExifMaker failed");
-    }
-
-    if (property_get("ro.product.model", value, "QCAM-AA") > 0) {
-        exif->addEntry(EXIFTAGID_MODEL, EXIF_ASCII,
-                (uint32_t)(strlen(value) + 1), (void *)value);
-    } else {
-        LOGW("getExifModel failed");
-    }
-
-    if (property_get("ro.build.description", value, "QCAM-AA") > 0) {
-        exif->addEntry(EXIFTAGID_SOFTWARE, EXIF_ASCII,
-                (uint32_t)(strlen(value) + 1), (void *)value);
-    } else {
-        LOGW("getExifSoftware failed");
-    }
+    exif->addModelInfoEntries(false);
 
 #endif
 
@@ -2859,286 +3115,4 @@ QCamera3Exif *QCamera3PostProcessor::getExifData(metadata_buffer_t *metadata,
     return exif;
 }
 
-/*===========================================================================
- * FUNCTION   : QCamera3Exif
- *
- * DESCRIPTION: constructor of QCamera3Exif
- *
- * PARAMETERS : None
- *
- * RETURN     : None
- *==========================================================================*/
-QCamera3Exif::QCamera3Exif()
-    : m_nNumEntries(0)
-{
-    memset(m_Entries, 0, sizeof(m_Entries));
-}
-
-/*===========================================================================
- * FUNCTION   : ~QCamera3Exif
- *
- * DESCRIPTION: deconstructor of QCamera3Exif. Will release internal memory ptr.
- *
- * PARAMETERS : None
- *
- * RETURN     : None
- *==========================================================================*/
-QCamera3Exif::~QCamera3Exif()
-{
-    for (uint32_t i = 0; i < m_nNumEntries; i++) {
-        switch (m_Entries[i].tag_entry.type) {
-            case EXIF_BYTE:
-                {
-                    if (m_Entries[i].tag_entry.count > 1 &&
-                            m_Entries[i].tag_entry.data._bytes != NULL) {
-                        free(m_Entries[i].tag_entry.data._bytes);
-                        m_Entries[i].tag_entry.data._bytes = NULL;
-                    }
-                }
-                break;
-            case EXIF_ASCII:
-                {
-                    if (m_Entries[i].tag_entry.data._ascii != NULL) {
-                        free(m_Entries[i].tag_entry.data._ascii);
-                        m_Entries[i].tag_entry.data._ascii = NULL;
-                    }
-                }
-                break;
-            case EXIF_SHORT:
-                {
-                    if (m_Entries[i].tag_entry.count > 1 &&
-                            m_Entries[i].tag_entry.data._shorts != NULL) {
-                        free(m_Entries[i].tag_entry.data._shorts);
-                        m_Entries[i].tag_entry.data._shorts = NULL;
-                    }
-                }
-                break;
-            case EXIF_LONG:
-                {
-                    if (m_Entries[i].tag_entry.count > 1 &&
-                            m_Entries[i].tag_entry.data._longs != NULL) {
-                        free(m_Entries[i].tag_entry.data._longs);
-                        m_Entries[i].tag_entry.data._longs = NULL;
-                    }
-                }
-                break;
-            case EXIF_RATIONAL:
-                {
-                    if (m_Entries[i].tag_entry.count > 1 &&
-                            m_Entries[i].tag_entry.data._rats != NULL) {
-                        free(m_Entries[i].tag_entry.data._rats);
-                        m_Entries[i].tag_entry.data._rats = NULL;
-                    }
-                }
-                break;
-            case EXIF_UNDEFINED:
-                {
-                    if (m_Entries[i].tag_entry.data._undefined != NULL) {
-                        free(m_Entries[i].tag_entry.data._undefined);
-                        m_Entries[i].tag_entry.data._undefined = NULL;
-                    }
-                }
-                break;
-            case EXIF_SLONG:
-                {
-                    if (m_Entries[i].tag_entry.count > 1 &&
-                            m_Entries[i].tag_entry.data._slongs != NULL) {
-                        free(m_Entries[i].tag_entry.data._slongs);
-                        m_Entries[i].tag_entry.data._slongs = NULL;
-                    }
-                }
-                break;
-            case EXIF_SRATIONAL:
-                {
-                    if (m_Entries[i].tag_entry.count > 1 &&
-                            m_Entries[i].tag_entry.data._srats != NULL) {
-                        free(m_Entries[i].tag_entry.data._srats);
-                        m_Entries[i].tag_entry.data._srats = NULL;
-                    }
-                }
-                break;
-            default:
-                LOGW("Error, Unknown type");
-                break;
-        }
-    }
-}
-
-/*===========================================================================
- * FUNCTION   : addEntry
- *
- * DESCRIPTION: function to add an entry to exif data
- *
- * PARAMETERS :
- *   @tagid   : exif tag ID
- *   @type    : data type
- *   @count   : number of data in uint of its type
- *   @data    : input data ptr
- *
- * RETURN     : int32_t type of status
- *              NO_ERROR  -- success
- *              none-zero failure code
- *==========================================================================*/
-int32_t QCamera3Exif::addEntry(exif_tag_id_t tagid,
-                              exif_tag_type_t type,
-                              uint32_t count,
-                              void *data)
-{
-    int32_t rc = NO_ERROR;
-    if(m_nNumEntries >= MAX_HAL3_EXIF_TABLE_ENTRIES) {
-        LOGE("Number of entries exceeded limit");
-        return NO_MEMORY;
-    }
-
-    m_Entries[m_nNumEntries].tag_id = tagid;
-    m_Entries[m_nNumEntries].tag_entry.type = type;
-    m_Entries[m_nNumEntries].tag_entry.count = count;
-    m_Entries[m_nNumEntries].tag_entry.copy = 1;
-    switch (type) {
-        case EXIF_BYTE:
-            {
-                if (count > 1) {
-                    uint8_t *values = (uint8_t *)malloc(count);
-                    if (values == NULL) {
-                        LOGE("No memory for byte array");
-                        rc = NO_MEMORY;
-                    } else {
-                        memcpy(values, data, count);
-                        m_Entries[m_nNumEntries].tag_entry.data._bytes = values;
-                    }
-                } else {
-                    m_Entries[m_nNumEntries].tag_entry.data._byte =
-                        *(uint8_t *)data;
-                }
-            }
-            break;
-        case EXIF_ASCII:
-            {
-                char *str = NULL;
-                str = (char *)malloc(count + 1);
-                if (str == NULL) {
-                    LOGE("No memory for ascii string");
-                    rc = NO_MEMORY;
-                } else {
-                    memset(str, 0, count + 1);
-                    memcpy(str, data, count);
-                    m_Entries[m_nNumEntries].tag_entry.data._ascii = str;
-                }
-            }
-            break;
-        case EXIF_SHORT:
-            {
-                uint16_t *exif_data = (uint16_t *)data;
-                if (count > 1) {
-                    uint16_t *values =
-                        (uint16_t *)malloc(count * sizeof(uint16_t));
-                    if (values == NULL) {
-                        LOGE("No memory for short array");
-                        rc = NO_MEMORY;
-                    } else {
-                        memcpy(values, exif_data, count * sizeof(uint16_t));
-                        m_Entries[m_nNumEntries].tag_entry.data._shorts = values;
-                    }
-                } else {
-                    m_Entries[m_nNumEntries].tag_entry.data._short =
-                        *(uint16_t *)data;
-                }
-            }
-            break;
-        case EXIF_LONG:
-            {
-                uint32_t *exif_data = (uint32_t *)data;
-                if (count > 1) {
-                    uint32_t *values =
-                        (uint32_t *)malloc(count * sizeof(uint32_t));
-                    if (values == NULL) {
-                        LOGE("No memory for long array");
-                        rc = NO_MEMORY;
-                    } else {
-                        memcpy(values, exif_data, count * sizeof(uint32_t));
-                        m_Entries[m_nNumEntries].tag_entry.data._longs = values;
-                    }
-                } else {
-                    m_Entries[m_nNumEntries].tag_entry.data._long =
-                        *(uint32_t *)data;
-                }
-            }
-            break;
-        case EXIF_RATIONAL:
-            {
-                rat_t *exif_data = (rat_t *)data;
-                if (count > 1) {
-                    rat_t *values = (rat_t *)malloc(count * sizeof(rat_t));
-                    if (values == NULL) {
-                        LOGE("No memory for rational array");
-                        rc = NO_MEMORY;
-                    } else {
-                        memcpy(values, exif_data, count * sizeof(rat_t));
-                        m_Entries[m_nNumEntries].tag_entry.data._rats = values;
-                    }
-                } else {
-                    m_Entries[m_nNumEntries].tag_entry.data._rat =
-                        *(rat_t *)data;
-                }
-            }
-            break;
-        case EXIF_UNDEFINED:
-            {
-                uint8_t *values = (uint8_t *)malloc(count);
-                if (values == NULL) {
-                    LOGE("No memory for undefined array");
-                    rc = NO_MEMORY;
-                } else {
-                    memcpy(values, data, count);
-                    m_Entries[m_nNumEntries].tag_entry.data._undefined = values;
-                }
-            }
-            break;
-        case EXIF_SLONG:
-            {
-                int32_t *exif_data = (int32_t *)data;
-                if (count > 1) {
-                    int32_t *values =
-                        (int32_t *)malloc(count * sizeof(int32_t));
-                    if (values == NULL) {
-                        LOGE("No memory for signed long array");
-                        rc = NO_MEMORY;
-                    } else {
-                        memcpy(values, exif_data, count * sizeof(int32_t));
-                        m_Entries[m_nNumEntries].tag_entry.data._slongs =values;
-                    }
-                } else {
-                    m_Entries[m_nNumEntries].tag_entry.data._slong =
-                        *(int32_t *)data;
-                }
-            }
-            break;
-        case EXIF_SRATIONAL:
-            {
-                srat_t *exif_data = (srat_t *)data;
-                if (count > 1) {
-                    srat_t *values = (srat_t *)malloc(count * sizeof(srat_t));
-                    if (values == NULL) {
-                        LOGE("No memory for sign rational array");
-                        rc = NO_MEMORY;
-                    } else {
-                        memcpy(values, exif_data, count * sizeof(srat_t));
-                        m_Entries[m_nNumEntries].tag_entry.data._srats = values;
-                    }
-                } else {
-                    m_Entries[m_nNumEntries].tag_entry.data._srat =
-                        *(srat_t *)data;
-                }
-            }
-            break;
-        default:
-            LOGE("Error, Unknown type");
-            break;
-    }
-
-    // Increase number of entries
-    m_nNumEntries++;
-    return rc;
-}
-
 }; // namespace qcamera
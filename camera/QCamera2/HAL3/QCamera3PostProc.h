@@ -33,7 +33,9 @@
 // Camera dependencies
 #include "hardware/camera3.h"
 #include "QCamera3HALHeader.h"
+#include "QCamera3PPJoin.h"
 #include "QCameraCmdThread.h"
+#include "QCameraExifBuilder.h"
 #include "QCameraQueue.h"
 
 extern "C" {
@@ -78,31 +80,18 @@ typedef struct {
     metadata_buffer_t *metadata;
     jpeg_settings_t *jpeg_settings;
     mm_camera_super_buf_t *src_metadata;
+    uint32_t frameNumber;            // request the job belongs to
 } qcamera_hal3_pp_data_t;
 
-typedef struct {
-    mm_camera_super_buf_t *input;
-    buffer_handle_t *output;
-    uint32_t frameNumber;
-} qcamera_hal3_pp_buffer_t;
+// Default number of reprocess requests in flight at once
+#define DEFAULT_HAL3_REPROC_INFLIGHT 4
 
 #define MAX_HAL3_EXIF_TABLE_ENTRIES 23
-class QCamera3Exif
+class QCamera3Exif : public QCameraExifBuilder
 {
 public:
-    QCamera3Exif();
-    virtual ~QCamera3Exif();
-
-    int32_t addEntry(exif_tag_id_t tagid,
-                     exif_tag_type_t type,
-                     uint32_t count,
-                     void *data);
-    uint32_t getNumOfEntries() {return m_nNumEntries;};
-    QEXIF_INFO_DATA *getEntries() {return m_Entries;};
-
-private:
-    QEXIF_INFO_DATA m_Entries[MAX_HAL3_EXIF_TABLE_ENTRIES];  // exif tags for JPEG encoder
-    uint32_t  m_nNumEntries;                            // number of valid entries
+    QCamera3Exif() : QCameraExifBuilder(MAX_HAL3_EXIF_TABLE_ENTRIES) {};
+    virtual ~QCamera3Exif() {};
 };
 
 class QCamera3PostProcessor
@@ -122,10 +111,11 @@ public:
     int32_t processData(qcamera_fwk_input_pp_data_t *frame);
     int32_t processData(mm_camera_super_buf_t *input,
             buffer_handle_t *output, uint32_t frameNumber);
-    int32_t processData(mm_camera_super_buf_t *input);
-    int32_t processPPData(mm_camera_super_buf_t *frame);
-    int32_t processPPMetadata(mm_camera_super_buf_t *reproc_meta);
-    int32_t processJpegSettingData(jpeg_settings_t *jpeg_settings);
+    int32_t processPPData(mm_camera_super_buf_t *frame, uint32_t frameNumber);
+    int32_t processPPMetadata(mm_camera_super_buf_t *reproc_meta,
+            uint32_t frameNumber);
+    int32_t processJpegSettingData(jpeg_settings_t *jpeg_settings,
+            uint32_t frameNumber);
     qcamera_hal3_pp_data_t *dequeuePPJob(uint32_t frameNumber);
     qcamera_hal3_jpeg_data_t *findJpegJobByJobId(uint32_t jobId);
     void releaseJpegJobData(qcamera_hal3_jpeg_data_t *job);
@@ -152,12 +142,22 @@ private:
     static void releaseNotifyData(void *user_data, void *cookie);
     int32_t processRawImageImpl(mm_camera_super_buf_t *recvd_frame);
 
+    void releaseJoinData(qcamera_hal3_pp_join_t &entry);
+    void returnDroppedRequests(bool active);
+    int32_t reprocessFWKFrame(qcamera_fwk_input_pp_data_t *fwk_frame);
+    int32_t reprocessFrame(qcamera_hal3_pp_join_t *input);
+    qcamera_hal3_pp_data_t *dequeueOngoingPPJob(uint32_t frameNumber);
+
+    static void releaseJoinEntry(qcamera_hal3_pp_join_t &entry, void *user_data);
     static void releaseJpegData(void *data, void *user_data);
     static void releasePPInputData(void *data, void *user_data);
-    static void releaseMetadata(void *data, void *user_data);
     static void releaseOngoingPPData(void *data, void *user_data);
+    static bool matchPPFrameNumber(void *data, void *user_data,
+            void *match_data);
+    static bool matchJpegJobId(void *data, void *user_data, void *match_data);
 
     static void *dataProcessRoutine(void *data);
+    static void *jpegProcessRoutine(void *data);
 
     bool needsReprocess(qcamera_fwk_input_pp_data_t *frame);
 
@@ -174,16 +174,20 @@ private:
     QCamera3StreamMem          *mOutputMem;
     QCamera3ReprocessChannel *  m_pReprocChannel;
 
-    QCameraQueue m_inputPPQ;            // input queue for postproc
+    QCameraQueue m_inputPPQ;            // joined input queue for postproc
     QCameraQueue m_inputFWKPPQ;         // framework input queue for postproc
     QCameraQueue m_ongoingPPQ;          // ongoing postproc queue
     QCameraQueue m_inputJpegQ;          // input jpeg job queue
     QCameraQueue m_ongoingJpegQ;        // ongoing jpeg job queue
     QCameraQueue m_inputRawQ;           // input raw job queue
-    QCameraQueue m_inputMetaQ;          // input meta queue
-    QCameraQueue m_jpegSettingsQ;       // input jpeg setting queue
-    QCameraCmdThread m_dataProcTh;      // thread for data processing
-
+    QCameraCmdThread m_dataProcTh;      // thread for reprocess
+    QCameraCmdThread m_jpegProcTh;      // thread for jpeg encoding
+    uint32_t mMaxInflightReproc;        // reprocess jobs sent at once
+
+    // inputs still waiting for their counterpart, protected by
+    // mReprocJobLock
+    QCamera3PPJoinTable m_joinTable;
+    bool m_bPPActive;
     pthread_mutex_t mReprocJobLock;
 };
 
@@ -0,0 +1,364 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#define LOG_TAG "QCamera3ReprocMeta"
+
+// System dependencies
+#include <stddef.h>
+
+// Camera dependencies
+#include "QCamera3ReprocMeta.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+/*===========================================================================
+ * FUNCTION   : QCamera3ReprocMetaPool
+ *
+ * DESCRIPTION: constructor of QCamera3ReprocMetaPool
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCamera3ReprocMetaPool::QCamera3ReprocMetaPool() :
+        mMemory(QCAMERA3_REPROC_META_SLOTS, false),
+        mInitialized(false)
+{
+    memset(mRefCnt, 0, sizeof(mRefCnt));
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCamera3ReprocMetaPool
+ *
+ * DESCRIPTION: destructor of QCamera3ReprocMetaPool
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCamera3ReprocMetaPool::~QCamera3ReprocMetaPool()
+{
+    deinit();
+}
+
+/*===========================================================================
+ * FUNCTION   : init
+ *
+ * DESCRIPTION: allocate the metadata slots, if not done yet
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3ReprocMetaPool::init()
+{
+    Mutex::Autolock lock(mLock);
+    if (mInitialized) {
+        return NO_ERROR;
+    }
+
+    int32_t rc = mMemory.allocateAll(sizeof(metadata_buffer_t));
+    if (NO_ERROR != rc) {
+        LOGE("Failed to allocate shared reprocess metadata %d", rc);
+        return rc;
+    }
+    memset(mRefCnt, 0, sizeof(mRefCnt));
+    mFreeSlots.setAll(mMemory.getCnt());
+    mInitialized = true;
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : deinit
+ *
+ * DESCRIPTION: release the metadata slots
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ReprocMetaPool::deinit()
+{
+    Mutex::Autolock lock(mLock);
+    if (mInitialized) {
+        mMemory.deallocate();
+        mFreeSlots.clear();
+        mInitialized = false;
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : reset
+ *
+ * DESCRIPTION: drop all references, used once every channel that could hold
+ *              a slot has been torn down
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ReprocMetaPool::reset()
+{
+    Mutex::Autolock lock(mLock);
+    if (mInitialized) {
+        for (uint32_t i = 0; i < mMemory.getCnt(); i++) {
+            mMemory.markFrameNumber(i, -1);
+        }
+        memset(mRefCnt, 0, sizeof(mRefCnt));
+        mFreeSlots.setAll(mMemory.getCnt());
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : acquire
+ *
+ * DESCRIPTION: get a free slot for the settings of an input reprocess
+ *              request. The caller owns the first reference.
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *
+ * RETURN     : metadata buffer, NULL if no slot is free
+ *==========================================================================*/
+metadata_buffer_t *QCamera3ReprocMetaPool::acquire(uint32_t frameNumber)
+{
+    Mutex::Autolock lock(mLock);
+    if (!mInitialized) {
+        return NULL;
+    }
+
+    int32_t slot = mFreeSlots.get();
+    if (slot < 0) {
+        LOGD("No free shared reprocess metadata slot");
+        return NULL;
+    }
+    mRefCnt[slot] = 1;
+    mMemory.markFrameNumber((uint32_t)slot, frameNumber);
+    return (metadata_buffer_t *)mMemory.getPtr((uint32_t)slot);
+}
+
+/*===========================================================================
+ * FUNCTION   : ref
+ *
+ * DESCRIPTION: take a reference on a slot and describe it for mapping
+ *
+ * PARAMETERS :
+ *   @meta    : metadata buffer returned by acquire
+ *   @offset  : plane offset of the metadata buffer
+ *   @bufDef  : output buffer definition
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3ReprocMetaPool::ref(metadata_buffer_t *meta,
+        const cam_frame_len_offset_t &offset, mm_camera_buf_def_t &bufDef)
+{
+    Mutex::Autolock lock(mLock);
+    int32_t slot = getSlot(meta);
+    if ((slot < 0) || (0 == mRefCnt[slot])) {
+        LOGE("Metadata %p is not a live shared slot", meta);
+        return BAD_VALUE;
+    }
+
+    int32_t rc = mMemory.getBufDef(offset, bufDef, (uint32_t)slot);
+    if (NO_ERROR == rc) {
+        mRefCnt[slot]++;
+    }
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : unref
+ *
+ * DESCRIPTION: drop a reference on a slot
+ *
+ * PARAMETERS :
+ *   @meta    : metadata buffer of the slot
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ReprocMetaPool::unref(metadata_buffer_t *meta)
+{
+    Mutex::Autolock lock(mLock);
+    unrefSlotLocked(getSlot(meta));
+}
+
+/*===========================================================================
+ * FUNCTION   : unrefFrame
+ *
+ * DESCRIPTION: drop a reference on the slot used by a request
+ *
+ * PARAMETERS :
+ *   @frameNumber : frame number of the request
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ReprocMetaPool::unrefFrame(uint32_t frameNumber)
+{
+    Mutex::Autolock lock(mLock);
+    if (mInitialized) {
+        unrefSlotLocked(mMemory.getHeapBufferIndex(frameNumber));
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getRefCount
+ *
+ * DESCRIPTION: number of holders of a slot
+ *
+ * PARAMETERS :
+ *   @meta    : metadata buffer of the slot
+ *
+ * RETURN     : reference count, 0 if not a pool slot
+ *==========================================================================*/
+uint32_t QCamera3ReprocMetaPool::getRefCount(metadata_buffer_t *meta)
+{
+    Mutex::Autolock lock(mLock);
+    int32_t slot = getSlot(meta);
+    return (slot < 0) ? 0 : mRefCnt[slot];
+}
+
+/*===========================================================================
+ * FUNCTION   : isShared
+ *
+ * DESCRIPTION: check whether a metadata buffer belongs to the pool
+ *
+ * PARAMETERS :
+ *   @meta    : metadata buffer
+ *
+ * RETURN     : true if meta is a pool slot
+ *==========================================================================*/
+bool QCamera3ReprocMetaPool::isShared(metadata_buffer_t *meta)
+{
+    Mutex::Autolock lock(mLock);
+    return (getSlot(meta) >= 0);
+}
+
+/*===========================================================================
+ * FUNCTION   : copyMeta
+ *
+ * DESCRIPTION: copy a metadata buffer. The trailing tuning and debug blobs
+ *              are the bulk of metadata_buffer_t and are only copied when
+ *              they are valid in the source.
+ *
+ * PARAMETERS :
+ *   @dst     : destination buffer
+ *   @src     : source buffer
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ReprocMetaPool::copyMeta(metadata_buffer_t *dst,
+        const metadata_buffer_t *src)
+{
+    if ((NULL == dst) || (NULL == src) || (dst == src)) {
+        return;
+    }
+
+    memcpy(dst, src, offsetof(metadata_buffer_t, is_tuning_params_valid));
+
+#define COPY_META_BLOCK(VALID, DATA) \
+    dst->VALID = src->VALID; \
+    if (src->VALID) { \
+        memcpy(&dst->DATA, &src->DATA, sizeof(dst->DATA)); \
+    }
+
+    COPY_META_BLOCK(is_tuning_params_valid, tuning_params);
+    COPY_META_BLOCK(is_mobicat_aec_params_valid, mobicat_aec_params);
+    COPY_META_BLOCK(is_statsdebug_ae_params_valid, statsdebug_ae_data);
+    COPY_META_BLOCK(is_statsdebug_awb_params_valid, statsdebug_awb_data);
+    COPY_META_BLOCK(is_statsdebug_af_params_valid, statsdebug_af_data);
+    COPY_META_BLOCK(is_statsdebug_asd_params_valid, statsdebug_asd_data);
+    COPY_META_BLOCK(is_statsdebug_stats_params_valid,
+            statsdebug_stats_buffer_data);
+    COPY_META_BLOCK(is_statsdebug_bestats_params_valid,
+            statsdebug_bestats_buffer_data);
+    COPY_META_BLOCK(is_statsdebug_bhist_params_valid, statsdebug_bhist_data);
+    COPY_META_BLOCK(is_statsdebug_3a_tuning_params_valid,
+            statsdebug_3a_tuning_data);
+
+#undef COPY_META_BLOCK
+}
+
+/*===========================================================================
+ * FUNCTION   : getSlot
+ *
+ * DESCRIPTION: map a metadata buffer back to its slot. Caller must hold
+ *              mLock.
+ *
+ * PARAMETERS :
+ *   @meta    : metadata buffer
+ *
+ * RETURN     : slot index, -1 if meta is not a pool slot
+ *==========================================================================*/
+int32_t QCamera3ReprocMetaPool::getSlot(metadata_buffer_t *meta)
+{
+    if (!mInitialized || (NULL == meta)) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < mMemory.getCnt(); i++) {
+        if (mMemory.getPtr(i) == (void *)meta) {
+            return (int32_t)i;
+        }
+    }
+    return -1;
+}
+
+/*===========================================================================
+ * FUNCTION   : unrefSlotLocked
+ *
+ * DESCRIPTION: drop a reference and recycle the slot when it was the last
+ *              one. Caller must hold mLock.
+ *
+ * PARAMETERS :
+ *   @slot    : slot index
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCamera3ReprocMetaPool::unrefSlotLocked(int32_t slot)
+{
+    if ((slot < 0) || (0 == mRefCnt[slot])) {
+        LOGW("Unbalanced unref of shared reprocess metadata slot %d", slot);
+        return;
+    }
+    if (0 == --mRefCnt[slot]) {
+        mMemory.markFrameNumber((uint32_t)slot, -1);
+        mFreeSlots.put((uint32_t)slot);
+    }
+}
+
+}; // namespace qcamera
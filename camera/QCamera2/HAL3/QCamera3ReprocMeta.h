@@ -0,0 +1,147 @@
+/* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#ifndef __QCAMERA3REPROCMETA_H__
+#define __QCAMERA3REPROCMETA_H__
+
+// System dependencies
+#include <string.h>
+#include <utils/Errors.h>
+#include <utils/Mutex.h>
+
+// Camera dependencies
+#include "QCamera3StreamMem.h"
+
+extern "C" {
+#include "mm_camera_interface.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+#define QCAMERA3_BUF_IDX_MASK_BITS \
+        (CAM_MAX_NUM_BUFS_PER_STREAM + MAX_REPROCESS_PIPELINE_STAGES)
+#define QCAMERA3_BUF_IDX_MASK_WORDS ((QCAMERA3_BUF_IDX_MASK_BITS + 31) / 32)
+
+/* Number of in-flight input reprocess requests whose translated settings
+ * can be shared with the output channels without a copy */
+#define QCAMERA3_REPROC_META_SLOTS \
+        (MAX_INFLIGHT_REQUESTS + MAX_REPROCESS_PIPELINE_STAGES)
+
+/* Fixed bitmap of free buffer indices. Not thread safe, callers keep
+ * using the lock that guarded the free list before. */
+class QCamera3BufIdxMask {
+public:
+    QCamera3BufIdxMask() {clear();}
+
+    void clear() {memset(mWords, 0, sizeof(mWords));}
+    void setAll(uint32_t count)
+    {
+        clear();
+        for (uint32_t i = 0; (i < count) && (i < QCAMERA3_BUF_IDX_MASK_BITS); i++) {
+            put(i);
+        }
+    }
+    void put(uint32_t idx)
+    {
+        if (idx < QCAMERA3_BUF_IDX_MASK_BITS) {
+            mWords[idx / 32] |= (1U << (idx % 32));
+        }
+    }
+    int32_t get()
+    {
+        for (uint32_t i = 0; i < QCAMERA3_BUF_IDX_MASK_WORDS; i++) {
+            if (mWords[i]) {
+                uint32_t bit = (uint32_t)__builtin_ctz(mWords[i]);
+                mWords[i] &= ~(1U << bit);
+                return (int32_t)(i * 32 + bit);
+            }
+        }
+        return -1;
+    }
+    bool empty() const
+    {
+        for (uint32_t i = 0; i < QCAMERA3_BUF_IDX_MASK_WORDS; i++) {
+            if (mWords[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    uint32_t size() const
+    {
+        uint32_t cnt = 0;
+        for (uint32_t i = 0; i < QCAMERA3_BUF_IDX_MASK_WORDS; i++) {
+            cnt += (uint32_t)__builtin_popcount(mWords[i]);
+        }
+        return cnt;
+    }
+
+private:
+    uint32_t mWords[QCAMERA3_BUF_IDX_MASK_WORDS];
+};
+
+/* Refcounted pool of ion backed metadata buffers. Input reprocess settings
+ * are translated straight into a slot which every output channel of the
+ * request maps as is; a channel only copies the slot when it has to
+ * override entries while other holders still reference it. */
+class QCamera3ReprocMetaPool {
+public:
+    QCamera3ReprocMetaPool();
+    virtual ~QCamera3ReprocMetaPool();
+
+    int32_t init();
+    void deinit();
+    void reset();
+
+    metadata_buffer_t *acquire(uint32_t frameNumber);
+    int32_t ref(metadata_buffer_t *meta, const cam_frame_len_offset_t &offset,
+            mm_camera_buf_def_t &bufDef);
+    void unref(metadata_buffer_t *meta);
+    void unrefFrame(uint32_t frameNumber);
+    uint32_t getRefCount(metadata_buffer_t *meta);
+    bool isShared(metadata_buffer_t *meta);
+
+    static void copyMeta(metadata_buffer_t *dst, const metadata_buffer_t *src);
+
+private:
+    int32_t getSlot(metadata_buffer_t *meta);
+    void unrefSlotLocked(int32_t slot);
+
+    QCamera3StreamMem mMemory;
+    bool mInitialized;
+    uint32_t mRefCnt[QCAMERA3_REPROC_META_SLOTS];
+    QCamera3BufIdxMask mFreeSlots;
+    Mutex mLock;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA3REPROCMETA_H__ */
@@ -29,9 +29,13 @@
 
 #define LOG_TAG "QCamera3Stream"
 
+// System dependencies
+#include <cutils/properties.h>
+
 // Camera dependencies
 #include "QCamera3HWI.h"
 #include "QCamera3Stream.h"
+#include "QCameraBufferMaps.h"
 
 extern "C" {
 #include "mm_camera_dbg.h"
@@ -473,6 +477,11 @@ int32_t QCamera3Stream::start()
     mTimeoutFrameQ.init();
     if (mBatchSize)
         mFreeBatchBufQ.init();
+
+    char prop[PROPERTY_VALUE_MAX];
+    memset(prop, 0, sizeof(prop));
+    property_get("persist.camera.cmd.coalesce", prop, "0");
+    mProcTh.setCoalesceNextJob(atoi(prop) > 0);
     rc = mProcTh.launch(dataProcRoutine, this);
     return rc;
 }
@@ -631,20 +640,24 @@ void *QCamera3Stream::dataProcRoutine(void *data)
         case CAMERA_CMD_TYPE_DO_NEXT_JOB:
             {
                 LOGD("Do next job");
-                mm_camera_super_buf_t *frame =
-                    (mm_camera_super_buf_t *)pme->mDataQ.dequeue();
-                if (NULL != frame) {
-                    if (UNLIKELY(frame->bufs[0]->buf_type ==
-                            CAM_STREAM_BUF_TYPE_USERPTR)) {
-                        pme->handleBatchBuffer(frame);
-                    } else if (pme->mDataCB != NULL) {
-                        pme->mDataCB(frame, pme, pme->mUserData);
-                    } else {
-                        // no data cb routine, return buf here
-                        pme->bufDone(frame->bufs[0]->buf_idx);
-                        free(frame);
+                // with coalescing one DO_NEXT_JOB may stand for many frames
+                bool drain = cmdThread->getCoalesceNextJob();
+                mm_camera_super_buf_t *frame = NULL;
+                do {
+                    frame = (mm_camera_super_buf_t *)pme->mDataQ.dequeue();
+                    if (NULL != frame) {
+                        if (UNLIKELY(frame->bufs[0]->buf_type ==
+                                CAM_STREAM_BUF_TYPE_USERPTR)) {
+                            pme->handleBatchBuffer(frame);
+                        } else if (pme->mDataCB != NULL) {
+                            pme->mDataCB(frame, pme, pme->mUserData);
+                        } else {
+                            // no data cb routine, return buf here
+                            pme->bufDone(frame->bufs[0]->buf_idx);
+                            free(frame);
+                        }
                     }
-                }
+                } while (drain && (NULL != frame));
             }
             break;
         case CAMERA_CMD_TYPE_EXIT:
@@ -859,31 +872,36 @@ int32_t QCamera3Stream::getBufs(cam_frame_len_offset_t *offset,
         return NO_MEMORY;
     }
 
+    // Send all stream buffers to the server in one bundled message so
+    // stream start pays a single map round trip instead of one per buffer
+    QCameraBufferMaps bufferMaps;
     for (uint32_t i = 0; i < mNumBufs; i++) {
         if (mStreamBufs->valid(i)) {
             ssize_t bufSize = mStreamBufs->getSize(i);
-            if (BAD_INDEX != bufSize) {
-                rc = ops_tbl->map_ops(i, -1, mStreamBufs->getFd(i),
-                        (size_t)bufSize, CAM_MAPPING_BUF_TYPE_STREAM_BUF,
-                        ops_tbl->userdata);
-                if (rc < 0) {
-                    LOGE("map_stream_buf failed: %d", rc);
-                    for (uint32_t j = 0; j < i; j++) {
-                        if (mStreamBufs->valid(j)) {
-                            ops_tbl->unmap_ops(j, -1,
-                                    CAM_MAPPING_BUF_TYPE_STREAM_BUF,
-                                    ops_tbl->userdata);
-                        }
-                    }
-                    return INVALID_OPERATION;
-                }
-            } else {
+            if (BAD_INDEX == bufSize) {
                 LOGE("Failed to retrieve buffer size (bad index)");
                 return INVALID_OPERATION;
             }
+            rc = bufferMaps.enqueue(CAM_MAPPING_BUF_TYPE_STREAM_BUF,
+                    0 /*stream id*/, i /*buf index*/, -1 /*plane index*/,
+                    0 /*cookie*/, mStreamBufs->getFd(i), (size_t)bufSize);
+            if (rc < 0) {
+                LOGE("Failed to map buffers");
+                return BAD_INDEX;
+            }
         }
     }
 
+    cam_buf_map_type_list bufMapList;
+    rc = bufferMaps.getCamBufMapList(bufMapList);
+    if (rc == NO_ERROR) {
+        rc = ops_tbl->bundled_map_ops(&bufMapList, ops_tbl->userdata);
+    }
+    if (rc < 0) {
+        LOGE("map_stream_buf failed: %d", rc);
+        return INVALID_OPERATION;
+    }
+
     //regFlags array is allocated by us, but consumed and freed by mm-camera-interface
     regFlags = (uint8_t *)malloc(sizeof(uint8_t) * mNumBufs);
     if (!regFlags) {
@@ -1144,6 +1162,25 @@ int32_t QCamera3Stream::mapBuf(uint8_t buf_type, uint32_t buf_idx,
 
 }
 
+/*===========================================================================
+ * FUNCTION   : mapBufs
+ *
+ * DESCRIPTION: map a list of stream related buffers to backend server in
+ *              a single round trip
+ *
+ * PARAMETERS :
+ *   @bufMapList : list of buffers to map
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCamera3Stream::mapBufs(const cam_buf_map_type_list &bufMapList)
+{
+    return mCamOps->map_stream_bufs(mCamHandle, mChannelHandle,
+                                    &bufMapList);
+}
+
 /*===========================================================================
  * FUNCTION   : unmapBuf
  *
@@ -92,6 +92,7 @@ public:
 
     int32_t mapBuf(uint8_t buf_type, uint32_t buf_idx,
             int32_t plane_idx, int fd, size_t size);
+    int32_t mapBufs(const cam_buf_map_type_list &bufMapList);
     int32_t unmapBuf(uint8_t buf_type, uint32_t buf_idx, int32_t plane_idx);
     int32_t setParameter(cam_stream_parm_buffer_t &param);
     cam_stream_info_t* getStreamInfo() const {return mStreamInfo; };
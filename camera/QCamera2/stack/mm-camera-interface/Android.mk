@@ -9,7 +9,18 @@ MM_CAM_FILES := \
         src/mm_camera_channel.c \
         src/mm_camera_stream.c \
         src/mm_camera_thread.c \
-        src/mm_camera_sock.c
+        src/mm_camera_sock.c \
+        src/mm_camera_binlog.c \
+        src/mm_camera_backend.c
+
+# Virtual sensor backend (persist.camera.virtual.sensor), for bring-up and
+# benchmarks without the msm nodes or daemon. Never part of user builds.
+ifeq ($(TARGET_CAMERA_VIRTUAL_SENSOR),true)
+ifneq ($(TARGET_BUILD_VARIANT),user)
+    MM_CAM_FILES += src/mm_camera_virtual.c
+    LOCAL_CFLAGS += -DCAMERA_VIRTUAL_SENSOR
+endif
+endif
 
 # System header file path prefix
 LOCAL_CFLAGS += -DSYSTEM_HEADER_PREFIX=sys
@@ -47,6 +58,9 @@ LOCAL_SRC_FILES := $(MM_CAM_FILES)
 
 LOCAL_MODULE           := libmmcamera_interface
 LOCAL_SHARED_LIBRARIES := libdl libcutils liblog
+# Binary log engine of the location HAL, kept private to this library
+LOCAL_STATIC_LIBRARIES := libloc_binlog
+LOCAL_LDFLAGS += -Wl,--exclude-libs,libloc_binlog.a
 LOCAL_HEADER_LIBRARIES := libhardware_headers
 LOCAL_HEADER_LIBRARIES += camera_common_headers
 LOCAL_HEADER_LIBRARIES += media_plugin_headers
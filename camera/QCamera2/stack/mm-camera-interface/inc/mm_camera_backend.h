@@ -0,0 +1,69 @@
+/* Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __MM_CAMERA_BACKEND_H__
+#define __MM_CAMERA_BACKEND_H__
+
+// System dependencies
+#include <poll.h>
+#include <stddef.h>
+
+/* Device backend of mm-camera-interface. Every access to the msm media,
+ * subdev and video nodes, the event/data poll and the daemon socket path
+ * goes through the ops below.
+ *
+ * The kernel backend maps them 1:1 onto libc. Builds with
+ * TARGET_CAMERA_VIRTUAL_SENSOR := true (never user builds) also carry the
+ * virtual backend (mm_camera_virtual.c, CAMERA_VIRTUAL_SENSOR). With
+ * persist.camera.virtual.sensor set to the number of cameras to expose it
+ * is used instead: it emulates the media topology, the video nodes and the
+ * mm-camera daemon so the HAL can be driven without msm V4L2 nodes or the
+ * daemon. */
+
+typedef struct {
+    const char *name;
+    int (*open)(const char *path, int flags);
+    int (*close)(int fd);
+    int (*ioctl)(int fd, unsigned long request, void *arg);
+    int (*poll)(struct pollfd *fds, nfds_t nfds, int timeout);
+    void (*get_sock_path)(int cam_id, char *path, size_t len);
+} mm_camera_backend_ops_t;
+
+const mm_camera_backend_ops_t *mm_camera_backend_get(void);
+#ifdef CAMERA_VIRTUAL_SENSOR
+const mm_camera_backend_ops_t *mm_camera_virtual_get_ops(void);
+#endif
+
+int mm_camera_dev_open(const char *path, int flags);
+int mm_camera_dev_close(int fd);
+int mm_camera_dev_ioctl(int fd, unsigned long request, void *arg);
+int mm_camera_dev_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+void mm_camera_dev_get_sock_path(int cam_id, char *path, size_t len);
+
+#endif /*__MM_CAMERA_BACKEND_H__*/
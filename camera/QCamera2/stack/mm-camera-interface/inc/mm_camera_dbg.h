@@ -60,13 +60,28 @@ typedef enum {
 
 extern int g_cam_log[CAM_LAST_MODULE][CAM_GLBL_DBG_INFO + 1];
 
+/* persist.camera.binlog: 0 - format on the calling thread,
+ * 1 - capture arguments and format them from a background thread,
+ * 2 - capture arguments and dump them raw for offline decoding */
+extern int g_cam_binlog_mode;
+
+/* one per CLOGx call site, id is assigned on the first captured call */
+typedef struct {
+    uint32_t id;
+} mm_camera_binlog_site_t;
+
 #define FATAL_IF(cond, ...) LOG_ALWAYS_FATAL_IF(cond, ## __VA_ARGS__)
 
 #undef CLOGx
 #define CLOGx(module, level, fmt, args...)                         \
 {\
 if (g_cam_log[module][level]) {                                  \
-  mm_camera_debug_log(module, level, __func__, __LINE__, fmt, ##args); \
+  static mm_camera_binlog_site_t mm_binlog_site_;                \
+  if (!g_cam_binlog_mode ||                                      \
+      mm_camera_binlog_write(&mm_binlog_site_, module, level,    \
+          __func__, __LINE__, fmt, ##args)) {                    \
+    mm_camera_debug_log(module, level, __func__, __LINE__, fmt, ##args); \
+  }\
 }\
 }
 
@@ -114,6 +129,18 @@ void mm_camera_debug_log(const cam_modules_t module,
                    const cam_global_debug_level_t level,
                    const char *func, const int line, const char *fmt, ...);
 
+/* binary logger, returns non-zero if the call has to be logged directly */
+int mm_camera_binlog_write(mm_camera_binlog_site_t *site,
+                   const cam_modules_t module,
+                   const cam_global_debug_level_t level,
+                   const char *func, const int line, const char *fmt, ...);
+
+/* applies persist.camera.binlog */
+void mm_camera_binlog_init(int mode);
+
+/* drains pending binary log records */
+void mm_camera_binlog_flush(void);
+
 #else
 
 #undef LOGD
@@ -43,6 +43,7 @@
 // Camera dependencies
 #include "cam_semaphore.h"
 #include "mm_camera_dbg.h"
+#include "mm_camera_backend.h"
 #include "mm_camera_sock.h"
 #include "mm_camera_interface.h"
 #include "mm_camera.h"
@@ -160,7 +161,7 @@ static void mm_camera_event_notify(void* user_data)
     if (NULL != my_obj) {
         /* read evt */
         memset(&ev, 0, sizeof(ev));
-        rc = ioctl(my_obj->ctrl_fd, VIDIOC_DQEVENT, &ev);
+        rc = mm_camera_dev_ioctl(my_obj->ctrl_fd, VIDIOC_DQEVENT, &ev);
 
         if (rc >= 0 && ev.id == MSM_CAMERA_MSM_NOTIFY) {
             msm_evt = (struct msm_v4l2_event_data *)ev.u.data;
@@ -281,7 +282,7 @@ int32_t mm_camera_open(mm_camera_obj_t *my_obj)
     do{
         n_try--;
         errno = 0;
-        my_obj->ctrl_fd = open(dev_name, O_RDWR | O_NONBLOCK);
+        my_obj->ctrl_fd = mm_camera_dev_open(dev_name, O_RDWR | O_NONBLOCK);
         l_errno = errno;
         LOGD("ctrl_fd = %d, errno == %d", my_obj->ctrl_fd, l_errno);
         if((my_obj->ctrl_fd >= 0) || (errno != EIO && errno != ETIMEDOUT) || (n_try <= 0 )) {
@@ -367,7 +368,7 @@ on_error:
         rc = -1;
     } else {
         if (my_obj->ctrl_fd >= 0) {
-            close(my_obj->ctrl_fd);
+            mm_camera_dev_close(my_obj->ctrl_fd);
             my_obj->ctrl_fd = -1;
         }
         if (my_obj->ds_fd >= 0) {
@@ -408,7 +409,7 @@ int32_t mm_camera_close(mm_camera_obj_t *my_obj)
     mm_camera_cmd_thread_release(&my_obj->evt_thread);
 
     if(my_obj->ctrl_fd >= 0) {
-        close(my_obj->ctrl_fd);
+        mm_camera_dev_close(my_obj->ctrl_fd);
         my_obj->ctrl_fd = -1;
     }
     if(my_obj->ds_fd >= 0) {
@@ -562,8 +563,9 @@ int32_t mm_camera_cancel_buf(mm_camera_obj_t *my_obj,
     mm_channel_t * ch_obj = NULL;
     ch_obj = mm_camera_util_get_channel_by_handler(my_obj, ch_id);
 
+    pthread_mutex_unlock(&my_obj->cam_lock);
+
     if (NULL != ch_obj) {
-        pthread_mutex_unlock(&my_obj->cam_lock);
         rc = mm_channel_cancel_buf(ch_obj,stream_id,buf_idx);
     }
 
@@ -624,7 +626,7 @@ int32_t mm_camera_query_capability(mm_camera_obj_t *my_obj)
 
     /* get camera capabilities */
     memset(&cap, 0, sizeof(cap));
-    rc = ioctl(my_obj->ctrl_fd, VIDIOC_QUERYCAP, &cap);
+    rc = mm_camera_dev_ioctl(my_obj->ctrl_fd, VIDIOC_QUERYCAP, &cap);
     if (rc != 0) {
         LOGE("cannot get camera capabilities, rc = %d, errno %d",
                  rc, errno);
@@ -1720,7 +1722,7 @@ int32_t mm_camera_evt_sub(mm_camera_obj_t * my_obj,
     sub.id = MSM_CAMERA_MSM_NOTIFY;
     if(FALSE == reg_flag) {
         /* unsubscribe */
-        rc = ioctl(my_obj->ctrl_fd, VIDIOC_UNSUBSCRIBE_EVENT, &sub);
+        rc = mm_camera_dev_ioctl(my_obj->ctrl_fd, VIDIOC_UNSUBSCRIBE_EVENT, &sub);
         if (rc < 0) {
             LOGE("unsubscribe event rc = %d, errno %d",
                      rc, errno);
@@ -1731,7 +1733,7 @@ int32_t mm_camera_evt_sub(mm_camera_obj_t * my_obj,
                                                my_obj->my_hdl,
                                                mm_camera_sync_call);
     } else {
-        rc = ioctl(my_obj->ctrl_fd, VIDIOC_SUBSCRIBE_EVENT, &sub);
+        rc = mm_camera_dev_ioctl(my_obj->ctrl_fd, VIDIOC_SUBSCRIBE_EVENT, &sub);
         if (rc < 0) {
             LOGE("subscribe event rc = %d, errno %d",
              rc, errno);
@@ -2003,7 +2005,7 @@ int32_t mm_camera_util_s_ctrl(int32_t fd,  uint32_t id, int32_t *value)
     if (value != NULL) {
         control.value = *value;
     }
-    rc = ioctl(fd, VIDIOC_S_CTRL, &control);
+    rc = mm_camera_dev_ioctl(fd, VIDIOC_S_CTRL, &control);
 
     LOGD("fd=%d, S_CTRL, id=0x%x, value = %p, rc = %d\n",
           fd, id, value, rc);
@@ -2039,7 +2041,7 @@ int32_t mm_camera_util_g_ctrl( int32_t fd, uint32_t id, int32_t *value)
     if (value != NULL) {
         control.value = *value;
     }
-    rc = ioctl(fd, VIDIOC_G_CTRL, &control);
+    rc = mm_camera_dev_ioctl(fd, VIDIOC_G_CTRL, &control);
     LOGD("fd=%d, G_CTRL, id=0x%x, rc = %d\n", fd, id, rc);
     if (value != NULL) {
         *value = control.value;
@@ -2431,6 +2433,9 @@ void mm_camera_set_dbg_log_properties(void) {
                          (j                                <= cam_loginfo[CAM_NO_MODULE].level));
     }
   }
+
+  property_get("persist.camera.binlog", property_value, "0");
+  mm_camera_binlog_init(atoi(property_value));
   pthread_mutex_unlock(&dbg_log_mutex);
 }
 
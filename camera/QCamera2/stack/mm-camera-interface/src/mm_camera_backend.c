@@ -0,0 +1,144 @@
+/* Copyright (c) 2012-2017, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#define IOCTL_H <SYSTEM_HEADER_PREFIX/ioctl.h>
+#include IOCTL_H
+
+// Camera dependencies
+#include "mm_camera_dbg.h"
+#include "mm_camera_backend.h"
+
+static pthread_once_t g_backend_once = PTHREAD_ONCE_INIT;
+static const mm_camera_backend_ops_t *g_backend = NULL;
+
+static int mm_camera_kernel_open(const char *path, int flags)
+{
+    return open(path, flags);
+}
+
+static int mm_camera_kernel_close(int fd)
+{
+    return close(fd);
+}
+
+static int mm_camera_kernel_ioctl(int fd, unsigned long request, void *arg)
+{
+    return ioctl(fd, request, arg);
+}
+
+static int mm_camera_kernel_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    return poll(fds, nfds, timeout);
+}
+
+static void mm_camera_kernel_get_sock_path(int cam_id, char *path, size_t len)
+{
+    snprintf(path, len, "/data/vendor/camera/cam_socket%d", cam_id);
+}
+
+static const mm_camera_backend_ops_t mm_camera_kernel_ops = {
+    .name = "kernel",
+    .open = mm_camera_kernel_open,
+    .close = mm_camera_kernel_close,
+    .ioctl = mm_camera_kernel_ioctl,
+    .poll = mm_camera_kernel_poll,
+    .get_sock_path = mm_camera_kernel_get_sock_path
+};
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_backend_select
+ *
+ * DESCRIPTION: pick the device backend once per process
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_backend_select(void)
+{
+#ifdef CAMERA_VIRTUAL_SENSOR
+    char prop[PROPERTY_VALUE_MAX];
+#endif
+
+    g_backend = &mm_camera_kernel_ops;
+#ifdef CAMERA_VIRTUAL_SENSOR
+    property_get("persist.camera.virtual.sensor", prop, "0");
+    if (atoi(prop) > 0) {
+        g_backend = mm_camera_virtual_get_ops();
+    }
+#endif
+    LOGH("mm-camera device backend: %s", g_backend->name);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_backend_get
+ *
+ * DESCRIPTION: get the device backend of this process
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : backend ops table, never NULL
+ *==========================================================================*/
+const mm_camera_backend_ops_t *mm_camera_backend_get(void)
+{
+    pthread_once(&g_backend_once, mm_camera_backend_select);
+    return g_backend;
+}
+
+int mm_camera_dev_open(const char *path, int flags)
+{
+    return mm_camera_backend_get()->open(path, flags);
+}
+
+int mm_camera_dev_close(int fd)
+{
+    return mm_camera_backend_get()->close(fd);
+}
+
+int mm_camera_dev_ioctl(int fd, unsigned long request, void *arg)
+{
+    return mm_camera_backend_get()->ioctl(fd, request, arg);
+}
+
+int mm_camera_dev_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    return mm_camera_backend_get()->poll(fds, nfds, timeout);
+}
+
+void mm_camera_dev_get_sock_path(int cam_id, char *path, size_t len)
+{
+    mm_camera_backend_get()->get_sock_path(cam_id, path, len);
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2012-2017, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Binary deferred-format logging for CLOGx.
+ *
+ * With persist.camera.binlog set, CLOGx stops formatting on the calling
+ * thread. The capture engine is the one of the location HAL
+ * (gps/utils/loc_binlog.c, linked in statically as libloc_binlog); this
+ * file only maps camera call sites onto it. The first call of a site
+ * registers it with the "<MODULE><LEVEL> func: line: " prefix built once;
+ * later calls only copy their raw arguments into a ring owned by the
+ * calling thread. The mm_cam_binlog thread drains the rings and either
+ * formats the records into logcat (1) or appends them unformatted to
+ * MM_CAMERA_BINLOG_FILE (2) for the loc_binlog_decode host tool. */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "mm_camera_dbg.h"
+#include "loc_binlog.h"
+
+#ifdef QCAMERA_REDEFINE_LOG
+
+#undef LOG_TAG
+#define LOG_TAG "QCamera"
+
+#define MM_CAMERA_BINLOG_FILE       QCAMERA_DUMP_FRM_LOCATION"mm_camera_binlog.bin"
+#define MM_CAMERA_BINLOG_PREFIX_MAX 128
+
+int g_cam_binlog_mode = 0;
+
+/* string representation of the camera levels, as in mm_camera_debug_log */
+static const char *g_binlog_module_str[CAM_LAST_MODULE] = {
+    "", "<HAL>", "<MCI>", "<JPEG>"
+};
+static const char *g_binlog_level_str[CAM_GLBL_DBG_INFO + 1] = {
+    "", "<ERROR>", "<WARN>", "<HIGH>", "<DBG>", "<LOW>", "<INFO>"
+};
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_binlog_register
+ *
+ * DESCRIPTION: give a call site its id, with the prefix and logcat
+ *              priority mm_camera_debug_log would use for it
+ *
+ * PARAMETERS :
+ *   @site   : static site of the call
+ *   @module : origin of the message
+ *   @level  : logging level
+ *   @func   : caller function name
+ *   @line   : caller line number
+ *   @fmt    : format string
+ *
+ * RETURN     : site id
+ *==========================================================================*/
+static uint32_t mm_camera_binlog_register(mm_camera_binlog_site_t *site,
+    const cam_modules_t module, const cam_global_debug_level_t level,
+    const char *func, const int line, const char *fmt)
+{
+    char prefix[MM_CAMERA_BINLOG_PREFIX_MAX];
+    uint8_t prio;
+
+    snprintf(prefix, sizeof(prefix), "%s%s %s: %d: ",
+        g_binlog_module_str[module], g_binlog_level_str[level], func, line);
+    switch (level) {
+    case CAM_GLBL_DBG_ERR:
+        prio = LOC_BINLOG_LEVEL_E;
+        break;
+    case CAM_GLBL_DBG_WARN:
+        prio = LOC_BINLOG_LEVEL_W;
+        break;
+    case CAM_GLBL_DBG_INFO:
+        prio = LOC_BINLOG_LEVEL_I;
+        break;
+    default:
+        prio = LOC_BINLOG_LEVEL_D;
+        break;
+    }
+    return loc_binlog_register(&site->id, LOG_TAG, prio, prefix, fmt);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_binlog_write
+ *
+ * DESCRIPTION: capture one CLOGx call into the calling thread's ring
+ *
+ * PARAMETERS :
+ *   @site   : static site of the call
+ *   @module : origin of the message
+ *   @level  : logging level
+ *   @func   : caller function name
+ *   @line   : caller line number
+ *   @fmt    : format string, followed by its arguments
+ *
+ * RETURN     : 0  -- captured, or dropped because the ring was full
+ *              -1 -- caller has to use mm_camera_debug_log
+ *==========================================================================*/
+int mm_camera_binlog_write(mm_camera_binlog_site_t *site,
+    const cam_modules_t module, const cam_global_debug_level_t level,
+    const char *func, const int line, const char *fmt, ...)
+{
+    uint32_t id;
+    va_list ap;
+    int rc;
+
+    id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+    if (0 == id) {
+        id = mm_camera_binlog_register(site, module, level, func, line, fmt);
+    }
+    va_start(ap, fmt);
+    rc = loc_binlog_vwrite(id, fmt, ap);
+    va_end(ap);
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_binlog_flush
+ *
+ * DESCRIPTION: drain all rings synchronously
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void mm_camera_binlog_flush(void)
+{
+    loc_binlog_flush();
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_binlog_init
+ *
+ * DESCRIPTION: apply persist.camera.binlog. The mm_cam_binlog thread is
+ *              started the first time a binary mode is selected and stays
+ *              up, so records captured before a switch back to 0 are still
+ *              written.
+ *
+ * PARAMETERS :
+ *   @mode : 0 -- format on the calling thread
+ *           1 -- capture, format into logcat from the background thread
+ *           2 -- capture, append raw records to MM_CAMERA_BINLOG_FILE
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void mm_camera_binlog_init(int mode)
+{
+    if (mode < LOC_BINLOG_MODE_OFF || mode > LOC_BINLOG_MODE_FILE) {
+        ALOGE("%s: invalid binlog mode %d, ignored", __func__, mode);
+        mode = LOC_BINLOG_MODE_OFF;
+    }
+    loc_binlog_init_ext((unsigned long)mode, MM_CAMERA_BINLOG_FILE,
+        "mm_cam_binlog");
+    g_cam_binlog_mode = loc_binlog_mode;
+}
+
+#endif
@@ -46,6 +46,7 @@
 
 // Camera dependencies
 #include "mm_camera_dbg.h"
+#include "mm_camera_backend.h"
 #include "mm_camera_interface.h"
 #include "mm_camera_sock.h"
 #include "mm_camera.h"
@@ -54,6 +55,14 @@ static pthread_mutex_t g_intf_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static mm_camera_ctrl_t g_cam_ctrl;
 
+/* number of per-frame callers currently holding a camera obj without
+ * g_intf_lock, indexed by camera idx. close waits for it to drain on
+ * g_cam_fast_cond, releasers only signal while g_cam_fast_closing is set */
+static int32_t g_cam_fast_users[MM_CAMERA_MAX_NUM_SENSORS];
+static int32_t g_cam_fast_closing[MM_CAMERA_MAX_NUM_SENSORS];
+static pthread_mutex_t g_cam_fast_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cam_fast_cond = PTHREAD_COND_INITIALIZER;
+
 static pthread_mutex_t g_handler_lock = PTHREAD_MUTEX_INITIALIZER;
 static uint16_t g_handler_history_count = 0; /* history count for handler */
 
@@ -148,6 +157,103 @@ mm_camera_obj_t* mm_camera_util_get_camera_by_handler(uint32_t cam_handle)
     return cam_obj;
 }
 
+/*===========================================================================
+ * FUNCTION   : mm_camera_util_put_fast_user
+ *
+ * DESCRIPTION: drop one per-frame reference on a camera slot and wake up a
+ *              close waiting for the slot to drain
+ *
+ * PARAMETERS :
+ *   @cam_idx : camera index
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_util_put_fast_user(uint8_t cam_idx)
+{
+    /* pairs with the closing flag store + count load in
+     * mm_camera_util_wait_fast_users, so the last user either sees the
+     * flag or the closer sees the count already at 0 */
+    if ((0 == __atomic_sub_fetch(&g_cam_fast_users[cam_idx], 1,
+            __ATOMIC_SEQ_CST)) &&
+            __atomic_load_n(&g_cam_fast_closing[cam_idx], __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&g_cam_fast_lock);
+        pthread_cond_broadcast(&g_cam_fast_cond);
+        pthread_mutex_unlock(&g_cam_fast_lock);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_util_acquire_camera_fast
+ *
+ * DESCRIPTION: lock-free lookup of camera object for per-frame operations.
+ *              Takes a reference on the camera slot so the object cannot be
+ *              freed until mm_camera_util_release_camera_fast is called.
+ *
+ * PARAMETERS :
+ *   @cam_handle: camera handle
+ *
+ * RETURN     : ptr to the camera object, NULL if handle is stale
+ * NOTE       : caller must release a non-NULL object
+ *==========================================================================*/
+static mm_camera_obj_t* mm_camera_util_acquire_camera_fast(uint32_t cam_handle)
+{
+    mm_camera_obj_t *cam_obj = NULL;
+    uint8_t cam_idx = mm_camera_util_get_index_by_handler(cam_handle);
+
+    if (cam_idx >= MM_CAMERA_MAX_NUM_SENSORS) {
+        return NULL;
+    }
+
+    /* publish the reference before looking at the slot, pairs with the
+     * slot clear + drain in mm_camera_intf_close */
+    __atomic_add_fetch(&g_cam_fast_users[cam_idx], 1, __ATOMIC_SEQ_CST);
+    cam_obj = __atomic_load_n(&g_cam_ctrl.cam_obj[cam_idx], __ATOMIC_SEQ_CST);
+    if ((NULL == cam_obj) || (cam_handle != cam_obj->my_hdl)) {
+        mm_camera_util_put_fast_user(cam_idx);
+        cam_obj = NULL;
+    }
+    return cam_obj;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_util_release_camera_fast
+ *
+ * DESCRIPTION: drop reference taken by mm_camera_util_acquire_camera_fast
+ *
+ * PARAMETERS :
+ *   @cam_handle: camera handle
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_util_release_camera_fast(uint32_t cam_handle)
+{
+    uint8_t cam_idx = mm_camera_util_get_index_by_handler(cam_handle);
+    mm_camera_util_put_fast_user(cam_idx);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_util_wait_fast_users
+ *
+ * DESCRIPTION: wait until no per-frame caller holds the camera object of a
+ *              slot. The slot must already be cleared so no new caller can
+ *              pick the object up.
+ *
+ * PARAMETERS :
+ *   @cam_idx : camera index
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_util_wait_fast_users(uint8_t cam_idx)
+{
+    pthread_mutex_lock(&g_cam_fast_lock);
+    __atomic_store_n(&g_cam_fast_closing[cam_idx], 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&g_cam_fast_users[cam_idx], __ATOMIC_SEQ_CST) > 0) {
+        pthread_cond_wait(&g_cam_fast_cond, &g_cam_fast_lock);
+    }
+    __atomic_store_n(&g_cam_fast_closing[cam_idx], 0, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&g_cam_fast_lock);
+}
+
 /*===========================================================================
  * FUNCTION   : mm_camera_intf_query_capability
  *
@@ -411,10 +517,14 @@ static int32_t mm_camera_intf_close(uint32_t camera_handle)
         } else {
             /* need close camera here as no other reference
              * first empty g_cam_ctrl's referent to cam_obj */
-            g_cam_ctrl.cam_obj[cam_idx] = NULL;
+            __atomic_store_n(&g_cam_ctrl.cam_obj[cam_idx], NULL, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&g_intf_lock);
+
+            /* the object is unreachable now, wait for in-flight per-frame
+             * callers to drop it without blocking other cameras */
+            mm_camera_util_wait_fast_users(cam_idx);
 
             pthread_mutex_lock(&my_obj->cam_lock);
-            pthread_mutex_unlock(&g_intf_lock);
             rc = mm_camera_close(my_obj);
             pthread_mutex_destroy(&my_obj->cam_lock);
             free(my_obj);
@@ -599,15 +709,13 @@ static int32_t mm_camera_intf_qbuf(uint32_t camera_handle,
     int32_t rc = -1;
     mm_camera_obj_t * my_obj = NULL;
 
-    pthread_mutex_lock(&g_intf_lock);
-    my_obj = mm_camera_util_get_camera_by_handler(camera_handle);
+    /* per-frame path, skip g_intf_lock so cameras do not serialize */
+    my_obj = mm_camera_util_acquire_camera_fast(camera_handle);
 
     if(my_obj) {
         pthread_mutex_lock(&my_obj->cam_lock);
-        pthread_mutex_unlock(&g_intf_lock);
         rc = mm_camera_qbuf(my_obj, ch_id, buf);
-    } else {
-        pthread_mutex_unlock(&g_intf_lock);
+        mm_camera_util_release_camera_fast(camera_handle);
     }
     LOGD("X evt_type = %d",rc);
     return rc;
@@ -633,15 +741,13 @@ static int32_t mm_camera_intf_cancel_buf(uint32_t camera_handle, uint32_t ch_id,
     int32_t rc = -1;
     mm_camera_obj_t * my_obj = NULL;
 
-    pthread_mutex_lock(&g_intf_lock);
-    my_obj = mm_camera_util_get_camera_by_handler(camera_handle);
+    /* per-frame path, skip g_intf_lock so cameras do not serialize */
+    my_obj = mm_camera_util_acquire_camera_fast(camera_handle);
 
     if(my_obj) {
         pthread_mutex_lock(&my_obj->cam_lock);
-        pthread_mutex_unlock(&g_intf_lock);
         rc = mm_camera_cancel_buf(my_obj, ch_id, stream_id, buf_idx);
-    } else {
-        pthread_mutex_unlock(&g_intf_lock);
+        mm_camera_util_release_camera_fast(camera_handle);
     }
     LOGD("X evt_type = %d",rc);
     return rc;
@@ -667,15 +773,13 @@ static int32_t mm_camera_intf_get_queued_buf_count(uint32_t camera_handle,
     int32_t rc = -1;
     mm_camera_obj_t * my_obj = NULL;
 
-    pthread_mutex_lock(&g_intf_lock);
-    my_obj = mm_camera_util_get_camera_by_handler(camera_handle);
+    /* per-frame path, skip g_intf_lock so cameras do not serialize */
+    my_obj = mm_camera_util_acquire_camera_fast(camera_handle);
 
     if(my_obj) {
         pthread_mutex_lock(&my_obj->cam_lock);
-        pthread_mutex_unlock(&g_intf_lock);
         rc = mm_camera_get_queued_buf_count(my_obj, ch_id, stream_id);
-    } else {
-        pthread_mutex_unlock(&g_intf_lock);
+        mm_camera_util_release_camera_fast(camera_handle);
     }
     LOGD("X queued buffer count = %d",rc);
     return rc;
@@ -1540,24 +1644,24 @@ void get_sensor_info()
     while (1) {
         char dev_name[32];
         snprintf(dev_name, sizeof(dev_name), "/dev/media%d", num_media_devices);
-        dev_fd = open(dev_name, O_RDWR | O_NONBLOCK);
+        dev_fd = mm_camera_dev_open(dev_name, O_RDWR | O_NONBLOCK);
         if (dev_fd < 0) {
             LOGD("Done discovering media devices\n");
             break;
         }
         num_media_devices++;
         memset(&mdev_info, 0, sizeof(mdev_info));
-        rc = ioctl(dev_fd, MEDIA_IOC_DEVICE_INFO, &mdev_info);
+        rc = mm_camera_dev_ioctl(dev_fd, MEDIA_IOC_DEVICE_INFO, &mdev_info);
         if (rc < 0) {
             LOGE("Error: ioctl media_dev failed: %s\n", strerror(errno));
-            close(dev_fd);
+            mm_camera_dev_close(dev_fd);
             dev_fd = -1;
             num_cameras = 0;
             break;
         }
 
         if(strncmp(mdev_info.model,  MSM_CONFIGURATION_NAME, sizeof(mdev_info.model)) != 0) {
-            close(dev_fd);
+            mm_camera_dev_close(dev_fd);
             dev_fd = -1;
             continue;
         }
@@ -1573,7 +1677,7 @@ void get_sensor_info()
 
             memset(&entity, 0, sizeof(entity));
             entity.id = num_entities++;
-            rc = ioctl(dev_fd, MEDIA_IOC_ENUM_ENTITIES, &entity);
+            rc = mm_camera_dev_ioctl(dev_fd, MEDIA_IOC_ENUM_ENTITIES, &entity);
             if (rc < 0) {
                 LOGD("Done enumerating media entities\n");
                 rc = 0;
@@ -1610,7 +1714,7 @@ void get_sensor_info()
                 continue;
             }
         }
-        close(dev_fd);
+        mm_camera_dev_close(dev_fd);
         dev_fd = -1;
     }
 
@@ -1769,23 +1873,23 @@ uint8_t get_num_of_cameras()
         char dev_name[32];
 
         snprintf(dev_name, sizeof(dev_name), "/dev/media%d", num_media_devices);
-        dev_fd = open(dev_name, O_RDWR | O_NONBLOCK);
+        dev_fd = mm_camera_dev_open(dev_name, O_RDWR | O_NONBLOCK);
         if (dev_fd < 0) {
             LOGD("Done discovering media devices\n");
             break;
         }
         num_media_devices++;
-        rc = ioctl(dev_fd, MEDIA_IOC_DEVICE_INFO, &mdev_info);
+        rc = mm_camera_dev_ioctl(dev_fd, MEDIA_IOC_DEVICE_INFO, &mdev_info);
         if (rc < 0) {
             LOGE("Error: ioctl media_dev failed: %s\n", strerror(errno));
-            close(dev_fd);
+            mm_camera_dev_close(dev_fd);
             dev_fd = -1;
             break;
         }
 
         if (strncmp(mdev_info.model, MSM_CONFIGURATION_NAME,
           sizeof(mdev_info.model)) != 0) {
-            close(dev_fd);
+            mm_camera_dev_close(dev_fd);
             dev_fd = -1;
             continue;
         }
@@ -1795,7 +1899,7 @@ uint8_t get_num_of_cameras()
             memset(&entity, 0, sizeof(entity));
             entity.id = num_entities++;
             LOGD("entity id %d", entity.id);
-            rc = ioctl(dev_fd, MEDIA_IOC_ENUM_ENTITIES, &entity);
+            rc = mm_camera_dev_ioctl(dev_fd, MEDIA_IOC_ENUM_ENTITIES, &entity);
             if (rc < 0) {
                 LOGD("Done enumerating media entities");
                 rc = 0;
@@ -1809,12 +1913,12 @@ uint8_t get_num_of_cameras()
                 break;
             }
         }
-        close(dev_fd);
+        mm_camera_dev_close(dev_fd);
         dev_fd = -1;
     }
 
     /* Open sensor_init subdev */
-    sd_fd = open(subdev_name, O_RDWR);
+    sd_fd = mm_camera_dev_open(subdev_name, O_RDWR);
     if (sd_fd < 0) {
         LOGE("Open sensor_init subdev failed");
         return FALSE;
@@ -1822,10 +1926,10 @@ uint8_t get_num_of_cameras()
 
     cfg.cfgtype = CFG_SINIT_PROBE_WAIT_DONE;
     cfg.cfg.setting = NULL;
-    if (ioctl(sd_fd, VIDIOC_MSM_SENSOR_INIT_CFG, &cfg) < 0) {
+    if (mm_camera_dev_ioctl(sd_fd, VIDIOC_MSM_SENSOR_INIT_CFG, &cfg) < 0) {
         LOGI("failed...Camera Daemon may not up so try again");
         for(i = 0; i < (MM_CAMERA_EVT_ENTRY_MAX + EXTRA_ENTRY); i++) {
-            if (ioctl(sd_fd, VIDIOC_MSM_SENSOR_INIT_CFG, &cfg) < 0) {
+            if (mm_camera_dev_ioctl(sd_fd, VIDIOC_MSM_SENSOR_INIT_CFG, &cfg) < 0) {
                 LOGI("failed...Camera Daemon may not up so try again");
                 continue;
             }
@@ -1833,7 +1937,7 @@ uint8_t get_num_of_cameras()
                 break;
         }
     }
-    close(sd_fd);
+    mm_camera_dev_close(sd_fd);
     dev_fd = -1;
 
 
@@ -1843,24 +1947,24 @@ uint8_t get_num_of_cameras()
         char dev_name[32];
 
         snprintf(dev_name, sizeof(dev_name), "/dev/media%d", num_media_devices);
-        dev_fd = open(dev_name, O_RDWR | O_NONBLOCK);
+        dev_fd = mm_camera_dev_open(dev_name, O_RDWR | O_NONBLOCK);
         if (dev_fd < 0) {
             LOGD("Done discovering media devices: %s\n", strerror(errno));
             break;
         }
         num_media_devices++;
         memset(&mdev_info, 0, sizeof(mdev_info));
-        rc = ioctl(dev_fd, MEDIA_IOC_DEVICE_INFO, &mdev_info);
+        rc = mm_camera_dev_ioctl(dev_fd, MEDIA_IOC_DEVICE_INFO, &mdev_info);
         if (rc < 0) {
             LOGE("Error: ioctl media_dev failed: %s\n", strerror(errno));
-            close(dev_fd);
+            mm_camera_dev_close(dev_fd);
             dev_fd = -1;
             num_cameras = 0;
             break;
         }
 
         if(strncmp(mdev_info.model, MSM_CAMERA_NAME, sizeof(mdev_info.model)) != 0) {
-            close(dev_fd);
+            mm_camera_dev_close(dev_fd);
             dev_fd = -1;
             continue;
         }
@@ -1869,7 +1973,7 @@ uint8_t get_num_of_cameras()
             struct media_entity_desc entity;
             memset(&entity, 0, sizeof(entity));
             entity.id = num_entities++;
-            rc = ioctl(dev_fd, MEDIA_IOC_ENUM_ENTITIES, &entity);
+            rc = mm_camera_dev_ioctl(dev_fd, MEDIA_IOC_ENUM_ENTITIES, &entity);
             if (rc < 0) {
                 LOGD("Done enumerating media entities\n");
                 rc = 0;
@@ -1884,7 +1988,7 @@ uint8_t get_num_of_cameras()
                 break;
             }
         }
-        close(dev_fd);
+        mm_camera_dev_close(dev_fd);
         dev_fd = -1;
         if (num_cameras >= MM_CAMERA_MAX_NUM_SENSORS) {
             LOGW("Maximum number of camera reached %d", num_cameras);
@@ -2111,7 +2215,8 @@ int32_t camera_open(uint8_t camera_idx, mm_camera_vtbl_t **camera_vtbl)
         return rc;
     } else {
         LOGD("Open succeded\n");
-        g_cam_ctrl.cam_obj[camera_idx] = cam_obj;
+        __atomic_store_n(&g_cam_ctrl.cam_obj[camera_idx], cam_obj,
+                __ATOMIC_SEQ_CST);
         pthread_mutex_unlock(&g_intf_lock);
         *camera_vtbl = &cam_obj->vtbl;
         return 0;
@@ -36,6 +36,7 @@
 
 // Camera dependencies
 #include "mm_camera_dbg.h"
+#include "mm_camera_backend.h"
 #include "mm_camera_sock.h"
 
 /*===========================================================================
@@ -74,8 +75,8 @@ int mm_camera_socket_create(int cam_id, mm_camera_sock_type_t sock_type)
 
     memset(&sock_addr, 0, sizeof(sock_addr));
     sock_addr.addr_un.sun_family = AF_UNIX;
-    snprintf(sock_addr.addr_un.sun_path,
-             UNIX_PATH_MAX, "/data/vendor/camera/cam_socket%d", cam_id);
+    mm_camera_dev_get_sock_path(cam_id, sock_addr.addr_un.sun_path,
+             UNIX_PATH_MAX);
     rc = connect(socket_fd, &sock_addr.addr, sizeof(sock_addr.addr_un));
     if (0 != rc) {
       close(socket_fd);
@@ -43,6 +43,7 @@
 // Camera dependencies
 #include "cam_semaphore.h"
 #include "mm_camera_dbg.h"
+#include "mm_camera_backend.h"
 #include "mm_camera_interface.h"
 #include "mm_camera.h"
 
@@ -545,7 +546,7 @@ int32_t mm_stream_fsm_inited(mm_stream_t *my_obj,
         snprintf(dev_name, sizeof(dev_name), "/dev/%s",
                  dev_name_value);
 
-        my_obj->fd = open(dev_name, O_RDWR | O_NONBLOCK);
+        my_obj->fd = mm_camera_dev_open(dev_name, O_RDWR | O_NONBLOCK);
         if (my_obj->fd < 0) {
             LOGE("open dev returned %d\n", my_obj->fd);
             rc = -1;
@@ -558,7 +559,7 @@ int32_t mm_stream_fsm_inited(mm_stream_t *my_obj,
         } else {
             /* failed setting ext_mode
              * close fd */
-            close(my_obj->fd);
+            mm_camera_dev_close(my_obj->fd);
             my_obj->fd = -1;
             break;
         }
@@ -1118,7 +1119,7 @@ int32_t mm_stream_release(mm_stream_t *my_obj)
     /* close fd */
     if(my_obj->fd >= 0)
     {
-        close(my_obj->fd);
+        mm_camera_dev_close(my_obj->fd);
     }
 
     /* destroy mutex */
@@ -1185,7 +1186,7 @@ int32_t mm_stream_streamon(mm_stream_t *my_obj)
         return rc;
     }
 
-    rc = ioctl(my_obj->fd, VIDIOC_STREAMON, &buf_type);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_STREAMON, &buf_type);
     if (rc < 0) {
         LOGE("ioctl VIDIOC_STREAMON failed: rc=%d, errno %d",
                     rc, errno);
@@ -1229,7 +1230,7 @@ int32_t mm_stream_streamoff(mm_stream_t *my_obj)
     }
 
     /* step2: stream off */
-    rc = ioctl(my_obj->fd, VIDIOC_STREAMOFF, &buf_type);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_STREAMOFF, &buf_type);
     if (rc < 0) {
         LOGE("STREAMOFF failed: %s\n",
                  strerror(errno));
@@ -1466,7 +1467,7 @@ int32_t mm_stream_read_msm_frame(mm_stream_t * my_obj,
     vb.m.planes = &planes[0];
     vb.length = num_planes;
 
-    rc = ioctl(my_obj->fd, VIDIOC_DQBUF, &vb);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_DQBUF, &vb);
     if (0 > rc) {
         LOGE("VIDIOC_DQBUF ioctl call failed on stream type %d (rc=%d): %s",
              my_obj->stream_info->stream_type, rc, strerror(errno));
@@ -1633,7 +1634,7 @@ int32_t mm_stream_set_ext_mode(mm_stream_t * my_obj)
     memset(&s_parm, 0, sizeof(s_parm));
     s_parm.type =  V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
 
-    rc = ioctl(my_obj->fd, VIDIOC_S_PARM, &s_parm);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_S_PARM, &s_parm);
     LOGD("stream fd=%d, rc=%d, extended_mode=%d\n",
           my_obj->fd, rc, s_parm.parm.capture.extendedmode);
     if (rc == 0) {
@@ -1718,7 +1719,7 @@ int32_t mm_stream_qbuf(mm_stream_t *my_obj, mm_camera_buf_def_t *buf)
     }
     pthread_mutex_unlock(&my_obj->buf_lock);
 
-    rc = ioctl(my_obj->fd, VIDIOC_QBUF, &buffer);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_QBUF, &buffer);
     pthread_mutex_lock(&my_obj->buf_lock);
     if (0 > rc) {
         LOGE("VIDIOC_QBUF ioctl call failed on stream type %d (rc=%d): %s",
@@ -1779,7 +1780,7 @@ int32_t mm_stream_request_buf(mm_stream_t * my_obj)
     bufreq.count = buf_num;
     bufreq.type  = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     bufreq.memory = V4L2_MEMORY_USERPTR;
-    rc = ioctl(my_obj->fd, VIDIOC_REQBUFS, &bufreq);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_REQBUFS, &bufreq);
     if (rc < 0) {
       LOGE("fd=%d, ioctl VIDIOC_REQBUFS failed: rc=%d, errno %d",
             my_obj->fd, rc, errno);
@@ -1951,10 +1952,15 @@ int32_t mm_stream_map_bufs(mm_stream_t * my_obj,
             == CAM_STREAMING_MODE_BATCH)))) {
         pthread_mutex_lock(&my_obj->buf_lock);
         for (i = 0; i < numbufs; i++) {
+           /* bundled lists may be sparse, track status per frame index */
+           uint32_t frame_idx = buf_map_list->buf_maps[i].frame_idx;
+           if (frame_idx >= CAM_MAX_NUM_BUFS_PER_STREAM) {
+               continue;
+           }
            if (ret < 0) {
-               my_obj->buf_status[i].map_status = -1;
+               my_obj->buf_status[frame_idx].map_status = -1;
            } else {
-               my_obj->buf_status[i].map_status = 1;
+               my_obj->buf_status[frame_idx].map_status = 1;
            }
         }
 
@@ -2206,7 +2212,7 @@ int32_t mm_stream_unreg_buf(mm_stream_t * my_obj)
     bufreq.count = 0;
     bufreq.type  = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
     bufreq.memory = V4L2_MEMORY_USERPTR;
-    rc = ioctl(my_obj->fd, VIDIOC_REQBUFS, &bufreq);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_REQBUFS, &bufreq);
     if (rc < 0) {
         LOGE("fd=%d, VIDIOC_REQBUFS failed, rc=%d, errno %d",
                my_obj->fd, rc, errno);
@@ -4545,7 +4551,7 @@ int32_t mm_stream_set_fmt(mm_stream_t *my_obj)
     }
 
     memcpy(fmt.fmt.raw_data, &msm_fmt, sizeof(msm_fmt));
-    rc = ioctl(my_obj->fd, VIDIOC_S_FMT, &fmt);
+    rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_S_FMT, &fmt);
     if (rc < 0) {
         LOGE("ioctl failed %d, errno %d", rc, errno);
     }
@@ -4603,7 +4609,7 @@ int32_t mm_stream_cancel_buf(mm_stream_t * my_obj,
             arg.ioctl_ptr = (uint32_t) &bufid;
 
 
-            rc = ioctl(my_obj->fd, VIDIOC_MSM_CAMERA_PRIVATE_IOCTL_CMD, &arg);
+            rc = mm_camera_dev_ioctl(my_obj->fd, VIDIOC_MSM_CAMERA_PRIVATE_IOCTL_CMD, &arg);
 
             if(rc < 0) {
                 LOGE("mm_stream_cancel_buf(idx=%d) err=%d\n",
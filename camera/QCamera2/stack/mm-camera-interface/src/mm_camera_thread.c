@@ -40,6 +40,7 @@
 #include <cam_semaphore.h>
 
 #include "mm_camera_dbg.h"
+#include "mm_camera_backend.h"
 #include "mm_camera_interface.h"
 #include "mm_camera.h"
 
@@ -296,7 +297,7 @@ static void *mm_camera_poll_fn(mm_camera_poll_thread_t *poll_cb)
             poll_cb->poll_fds[i].events = POLLIN|POLLRDNORM|POLLPRI;
          }
 
-         rc = poll(poll_cb->poll_fds, poll_cb->num_fds, poll_cb->timeoutms);
+         rc = mm_camera_dev_poll(poll_cb->poll_fds, poll_cb->num_fds, poll_cb->timeoutms);
          if(rc > 0) {
             if ((poll_cb->poll_fds[0].revents & POLLIN) &&
                 (poll_cb->poll_fds[0].revents & POLLRDNORM)) {
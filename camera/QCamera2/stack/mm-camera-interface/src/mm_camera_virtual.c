@@ -0,0 +1,1552 @@
+/* Copyright (c) 2012-2017, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Virtual device backend, selected by persist.camera.virtual.sensor. Only
+ * built with TARGET_CAMERA_VIRTUAL_SENSOR := true on non user builds, see
+ * Android.mk.
+ *
+ * Every emulated node (media devices, the sensor_init subdev and the
+ * video nodes) is backed by an eventfd, so the poll threads keep polling
+ * real file descriptors. An eventfd only raises POLLIN, mm_camera_virt_poll
+ * translates that into POLLPRI for control nodes and POLLIN|POLLRDNORM for
+ * stream nodes, which is what mm_camera_thread.c expects from the kernel.
+ *
+ * Per opened camera two threads stand in for the mm-camera daemon:
+ *   - CAM_vDaemon serves the domain socket: it mmaps the buffers the HAL
+ *     maps, unmaps them again and answers with CAM_EVENT_TYPE_MAP_UNMAP_DONE
+ *   - CAM_vSensor ticks at persist.camera.virtual.fps with up to
+ *     persist.camera.virtual.jitter_us of jitter and returns buffers. Once
+ *     the HAL sets CAM_INTF_PARM_FPS_RANGE it ticks at its max fps
+ * A request is recorded whenever a parameter buffer carrying
+ * CAM_INTF_META_FRAME_NUMBER is set. Each tick consumes the oldest one:
+ * the metadata stream gets a buffer stamped with its frame number and
+ * timestamp, and the streams listed in its CAM_INTF_META_STREAM_ID get a
+ * buffer, honouring the requested buffer index. Without any request ever
+ * seen (HAL1) all streams get a buffer on every tick.
+ *
+ * persist.camera.virtual.dir holds the daemon socket and the blobs:
+ *   caps_<id>.bin  cam_capability_t captured on a device, required by
+ *                  query capability
+ *   meta_<id>.bin  optional metadata_buffer_t used as template for every
+ *                  metadata buffer, e.g. to replay 3A state
+ * Image buffers are returned untouched. A request on a batch mode stream
+ * takes as many sensor frames as the batch container it consumes holds,
+ * and its buffers and metadata are returned on the last one of them, as
+ * the sensor returns an HFR batch. */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/media.h>
+#include <media/msm_cam_sensor.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#define IOCTL_H <SYSTEM_HEADER_PREFIX/ioctl.h>
+#include IOCTL_H
+
+// Camera dependencies
+#include "mm_camera_dbg.h"
+#include "mm_camera_sock.h"
+#include "mm_camera_interface.h"
+#include "mm_camera.h"
+#include "mm_camera_backend.h"
+
+#define MM_CAMERA_VIRT_MAX_FDS          1024
+#define MM_CAMERA_VIRT_MAX_NODES        64
+#define MM_CAMERA_VIRT_MAX_MAPS         256
+#define MM_CAMERA_VIRT_MAX_EVTS         32
+#define MM_CAMERA_VIRT_MAX_REQS         32
+#define MM_CAMERA_VIRT_PATH_LEN         128
+#define MM_CAMERA_VIRT_DEFAULT_DIR      "/data/vendor/camera/virtual"
+#define MM_CAMERA_VIRT_SENSOR_INIT_NAME "vcam-sensor-init"
+/* sensor entity flags, see CAM_SENSOR_FACING_MASK in mm_camera_interface.c */
+#define MM_CAMERA_VIRT_FACING_FRONT     (1U << 16)
+#define MM_CAMERA_VIRT_MOUNT_SHIFT      8
+
+#define MM_CAMERA_VIRT_SET_META(META, META_ID, DATA) \
+    do { \
+        *POINTER_OF_META(META_ID, META) = (DATA); \
+        (META)->is_valid[META_ID] = 1; \
+    } while (0)
+
+typedef enum {
+    MM_CAMERA_VIRT_NODE_NONE,
+    MM_CAMERA_VIRT_NODE_MEDIA,
+    MM_CAMERA_VIRT_NODE_SENSOR_INIT,
+    MM_CAMERA_VIRT_NODE_CTRL,
+    MM_CAMERA_VIRT_NODE_STREAM,
+} mm_camera_virt_node_type_t;
+
+typedef struct {
+    uint32_t idx;
+    uint32_t sequence;
+    struct timeval ts;
+} mm_camera_virt_frame_t;
+
+typedef struct {
+    mm_camera_virt_node_type_t type;
+    int fd;                     /* eventfd standing in for the device node */
+    int cam_idx;                /* camera, or media device for media nodes */
+    /* stream nodes only */
+    uint32_t server_id;
+    uint8_t streaming;
+    uint8_t batch;              /* frames per container, 0 unless batch mode */
+    cam_stream_type_t stream_type;
+    uint32_t queued[MM_CAMERA_MAX_NUM_FRAMES];  /* buffer indices, FIFO */
+    uint32_t num_queued;
+    mm_camera_virt_frame_t done[MM_CAMERA_MAX_NUM_FRAMES];
+    uint32_t done_head;
+    uint32_t num_done;
+} mm_camera_virt_node_t;
+
+typedef struct {
+    cam_mapping_buf_type type;
+    uint32_t stream_id;
+    uint32_t frame_idx;
+    int32_t plane_idx;
+    void *vaddr;                /* NULL if the slot is free */
+    size_t size;
+} mm_camera_virt_map_t;
+
+typedef struct {
+    uint32_t frame_number;
+    cam_stream_ID_t streams;
+} mm_camera_virt_req_t;
+
+typedef struct {
+    uint32_t frames;            /* sensor ticks with a stream on */
+    uint32_t delivered;         /* buffers returned to the HAL */
+    uint32_t starved;           /* buffers due but none queued */
+    uint32_t requests;
+    uint32_t maps;
+} mm_camera_virt_stats_t;
+
+typedef struct {
+    mm_camera_virt_node_t *ctrl;
+    uint32_t next_stream_id;
+    uint8_t running;
+    uint8_t request_mode;
+    uint32_t sequence;
+    uint32_t fps;               /* sensor rate, follows the fps range */
+    /* events for the control node, FIFO */
+    struct msm_v4l2_event_data evts[MM_CAMERA_VIRT_MAX_EVTS];
+    uint32_t evt_head;
+    uint32_t num_evts;
+    /* pending requests, FIFO */
+    mm_camera_virt_req_t reqs[MM_CAMERA_VIRT_MAX_REQS];
+    uint32_t req_head;
+    uint32_t num_reqs;
+    /* request whose batch the sensor is filling, served in batch_ticks */
+    mm_camera_virt_req_t batch_req;
+    uint32_t batch_ticks;
+    mm_camera_virt_map_t maps[MM_CAMERA_VIRT_MAX_MAPS];
+    void *caps;
+    size_t caps_len;
+    metadata_buffer_t *meta_tmpl;
+    int sock_fd;
+    int stop_fd;
+    char sock_path[MM_CAMERA_VIRT_PATH_LEN];
+    pthread_t daemon_pid;
+    pthread_t sensor_pid;
+    mm_camera_virt_stats_t stats;
+} mm_camera_virt_cam_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int num_cams;
+    uint32_t fps;
+    uint32_t jitter_us;
+    char dir[MM_CAMERA_VIRT_PATH_LEN];
+    mm_camera_virt_node_t nodes[MM_CAMERA_VIRT_MAX_NODES];
+    mm_camera_virt_node_t *fd_node[MM_CAMERA_VIRT_MAX_FDS];
+    mm_camera_virt_cam_t cams[MM_CAMERA_MAX_NUM_SENSORS];
+} mm_camera_virt_ctrl_t;
+
+static mm_camera_virt_ctrl_t g_virt = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static pthread_once_t g_virt_once = PTHREAD_ONCE_INIT;
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_init
+ *
+ * DESCRIPTION: read the virtual backend configuration, once per process
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_init(void)
+{
+    char prop[PROPERTY_VALUE_MAX];
+    int i;
+
+    property_get("persist.camera.virtual.sensor", prop, "0");
+    g_virt.num_cams = atoi(prop);
+    if (g_virt.num_cams > MM_CAMERA_MAX_NUM_SENSORS) {
+        g_virt.num_cams = MM_CAMERA_MAX_NUM_SENSORS;
+    } else if (g_virt.num_cams < 0) {
+        g_virt.num_cams = 0;
+    }
+    property_get("persist.camera.virtual.fps", prop, "30");
+    g_virt.fps = (uint32_t)atoi(prop);
+    if (0 == g_virt.fps) {
+        g_virt.fps = 30;
+    }
+    property_get("persist.camera.virtual.jitter_us", prop, "0");
+    g_virt.jitter_us = (uint32_t)atoi(prop);
+    property_get("persist.camera.virtual.dir", prop, MM_CAMERA_VIRT_DEFAULT_DIR);
+    strlcpy(g_virt.dir, prop, sizeof(g_virt.dir));
+
+    for (i = 0; i < MM_CAMERA_MAX_NUM_SENSORS; i++) {
+        g_virt.cams[i].sock_fd = -1;
+        g_virt.cams[i].stop_fd = -1;
+    }
+    LOGH("virtual sensors %d, %u fps, jitter %u us, dir %s",
+            g_virt.num_cams, g_virt.fps, g_virt.jitter_us, g_virt.dir);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_node_alloc
+ *
+ * DESCRIPTION: allocate a node and the eventfd standing in for its device
+ *              fd. Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @type    : node type
+ *   @cam_idx : camera index, media device index for media nodes
+ *
+ * RETURN     : node, NULL with errno set on failure
+ *==========================================================================*/
+static mm_camera_virt_node_t *mm_camera_virt_node_alloc(
+        mm_camera_virt_node_type_t type, int cam_idx)
+{
+    mm_camera_virt_node_t *node = NULL;
+    int fd;
+    int i;
+
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_NODES; i++) {
+        if (MM_CAMERA_VIRT_NODE_NONE == g_virt.nodes[i].type) {
+            node = &g_virt.nodes[i];
+            break;
+        }
+    }
+    if (NULL == node) {
+        errno = EMFILE;
+        return NULL;
+    }
+
+    fd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE | EFD_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fd >= MM_CAMERA_VIRT_MAX_FDS) {
+        close(fd);
+        errno = EMFILE;
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(*node));
+    node->type = type;
+    node->fd = fd;
+    node->cam_idx = cam_idx;
+    g_virt.fd_node[fd] = node;
+    return node;
+}
+
+static mm_camera_virt_node_t *mm_camera_virt_node_get(int fd)
+{
+    if ((fd < 0) || (fd >= MM_CAMERA_VIRT_MAX_FDS)) {
+        return NULL;
+    }
+    return g_virt.fd_node[fd];
+}
+
+static void mm_camera_virt_node_free(mm_camera_virt_node_t *node)
+{
+    g_virt.fd_node[node->fd] = NULL;
+    close(node->fd);
+    node->fd = -1;
+    node->type = MM_CAMERA_VIRT_NODE_NONE;
+}
+
+static void mm_camera_virt_node_signal(mm_camera_virt_node_t *node)
+{
+    uint64_t one = 1;
+
+    if (write(node->fd, &one, sizeof(one)) != sizeof(one)) {
+        LOGE("cannot signal node fd %d: %s", node->fd, strerror(errno));
+    }
+}
+
+static int mm_camera_virt_node_consume(mm_camera_virt_node_t *node)
+{
+    uint64_t val;
+
+    return (read(node->fd, &val, sizeof(val)) == sizeof(val)) ? 0 : -1;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_load_file
+ *
+ * DESCRIPTION: read a whole blob file into a heap buffer
+ *
+ * PARAMETERS :
+ *   @path    : file path
+ *   @len     : returns the blob size
+ *
+ * RETURN     : blob, NULL if missing or empty. Freed by the caller.
+ *==========================================================================*/
+static void *mm_camera_virt_load_file(const char *path, size_t *len)
+{
+    FILE *fp;
+    long size;
+    void *buf = NULL;
+
+    *len = 0;
+    fp = fopen(path, "rb");
+    if (NULL == fp) {
+        return NULL;
+    }
+    if ((0 == fseek(fp, 0, SEEK_END)) && ((size = ftell(fp)) > 0)) {
+        rewind(fp);
+        buf = malloc((size_t)size);
+        if ((NULL != buf) && (fread(buf, 1, (size_t)size, fp) != (size_t)size)) {
+            free(buf);
+            buf = NULL;
+        }
+        if (NULL != buf) {
+            *len = (size_t)size;
+        }
+    }
+    fclose(fp);
+    return buf;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_find_map
+ *
+ * DESCRIPTION: look up a buffer mapped by the HAL. Stream buffers are
+ *              matched on stream and buffer index, taking their first
+ *              plane; other buffers only on type. Called with g_virt.lock
+ *              held.
+ *
+ * PARAMETERS :
+ *   @cam       : virtual camera
+ *   @type      : mapping type
+ *   @stream_id : server stream id
+ *   @frame_idx : buffer index
+ *
+ * RETURN     : mapping, NULL if not mapped
+ *==========================================================================*/
+static mm_camera_virt_map_t *mm_camera_virt_find_map(mm_camera_virt_cam_t *cam,
+        cam_mapping_buf_type type, uint32_t stream_id, uint32_t frame_idx)
+{
+    mm_camera_virt_map_t *found = NULL;
+    mm_camera_virt_map_t *map;
+    int i;
+
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_MAPS; i++) {
+        map = &cam->maps[i];
+        if ((NULL == map->vaddr) || (map->type != type)) {
+            continue;
+        }
+        if ((CAM_MAPPING_BUF_TYPE_STREAM_BUF == type) ||
+                (CAM_MAPPING_BUF_TYPE_STREAM_USER_BUF == type)) {
+            if ((map->stream_id != stream_id) || (map->frame_idx != frame_idx)) {
+                continue;
+            }
+            if ((NULL == found) || (map->plane_idx < found->plane_idx)) {
+                found = map;
+            }
+        } else if (CAM_MAPPING_BUF_TYPE_STREAM_INFO == type) {
+            if (map->stream_id == stream_id) {
+                return map;
+            }
+        } else {
+            return map;
+        }
+    }
+    return found;
+}
+
+static cam_stream_info_t *mm_camera_virt_stream_info(mm_camera_virt_cam_t *cam,
+        uint32_t server_id)
+{
+    mm_camera_virt_map_t *map = mm_camera_virt_find_map(cam,
+            CAM_MAPPING_BUF_TYPE_STREAM_INFO, server_id, 0);
+
+    if ((NULL == map) || (map->size < sizeof(cam_stream_info_t))) {
+        return NULL;
+    }
+    return (cam_stream_info_t *)map->vaddr;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_post_evt
+ *
+ * DESCRIPTION: queue an event for VIDIOC_DQEVENT on the control node.
+ *              Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @command : CAM_EVENT_TYPE_*
+ *   @status  : MSM_CAMERA_STATUS_*
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_post_evt(mm_camera_virt_cam_t *cam,
+        uint32_t command, uint32_t status)
+{
+    struct msm_v4l2_event_data *evt;
+
+    if ((NULL == cam->ctrl) || (cam->num_evts >= MM_CAMERA_VIRT_MAX_EVTS)) {
+        LOGE("cannot post event 0x%x, %u events pending", command, cam->num_evts);
+        return;
+    }
+    evt = &cam->evts[(cam->evt_head + cam->num_evts) % MM_CAMERA_VIRT_MAX_EVTS];
+    memset(evt, 0, sizeof(*evt));
+    evt->command = command;
+    evt->status = status;
+    cam->num_evts++;
+    mm_camera_virt_node_signal(cam->ctrl);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_map
+ *
+ * DESCRIPTION: mmap a buffer the HAL mapped to the daemon.
+ *              Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @buf_map : mapping request
+ *   @fd      : fd received over the socket
+ *
+ * RETURN     : MSM_CAMERA_STATUS_SUCCESS or MSM_CAMERA_STATUS_FAIL
+ *==========================================================================*/
+static uint32_t mm_camera_virt_map(mm_camera_virt_cam_t *cam,
+        const cam_buf_map_type *buf_map, int fd)
+{
+    mm_camera_virt_map_t *map = NULL;
+    cam_stream_info_t *stream_info;
+    size_t size = buf_map->size;
+    void *vaddr;
+    int i;
+
+    if ((fd < 0) || (0 == buf_map->size)) {
+        LOGE("invalid mapping type %d, fd %d, size %zu",
+                buf_map->type, fd, buf_map->size);
+        return MSM_CAMERA_STATUS_FAIL;
+    }
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_MAPS; i++) {
+        if (NULL == cam->maps[i].vaddr) {
+            map = &cam->maps[i];
+            break;
+        }
+    }
+    if (NULL == map) {
+        LOGE("out of mapping slots");
+        return MSM_CAMERA_STATUS_FAIL;
+    }
+    /* all batch containers of a stream share one mapping, sized in containers */
+    if (CAM_MAPPING_BUF_TYPE_STREAM_USER_BUF == buf_map->type) {
+        stream_info = mm_camera_virt_stream_info(cam, buf_map->stream_id);
+        if (NULL == stream_info) {
+            LOGE("batch containers of stream %u mapped before its info",
+                    buf_map->stream_id);
+            return MSM_CAMERA_STATUS_FAIL;
+        }
+        size *= stream_info->user_buf_info.size;
+    }
+
+    vaddr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == vaddr) {
+        LOGE("mmap of type %d, size %zu failed: %s",
+                buf_map->type, size, strerror(errno));
+        return MSM_CAMERA_STATUS_FAIL;
+    }
+    map->type = buf_map->type;
+    map->stream_id = buf_map->stream_id;
+    map->frame_idx = buf_map->frame_idx;
+    map->plane_idx = buf_map->plane_idx;
+    map->vaddr = vaddr;
+    map->size = size;
+    cam->stats.maps++;
+    return MSM_CAMERA_STATUS_SUCCESS;
+}
+
+static uint32_t mm_camera_virt_unmap(mm_camera_virt_cam_t *cam,
+        const cam_buf_unmap_type *buf_unmap)
+{
+    mm_camera_virt_map_t *map;
+    uint8_t stream_buf;
+    int i;
+
+    stream_buf = (CAM_MAPPING_BUF_TYPE_STREAM_BUF == buf_unmap->type) ||
+            (CAM_MAPPING_BUF_TYPE_STREAM_INFO == buf_unmap->type) ||
+            (CAM_MAPPING_BUF_TYPE_STREAM_USER_BUF == buf_unmap->type) ||
+            (CAM_MAPPING_BUF_TYPE_OFFLINE_INPUT_BUF == buf_unmap->type);
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_MAPS; i++) {
+        map = &cam->maps[i];
+        if ((NULL == map->vaddr) || (map->type != buf_unmap->type)) {
+            continue;
+        }
+        if (stream_buf && ((map->stream_id != buf_unmap->stream_id) ||
+                (map->frame_idx != buf_unmap->frame_idx) ||
+                (map->plane_idx != buf_unmap->plane_idx))) {
+            continue;
+        }
+        munmap(map->vaddr, map->size);
+        memset(map, 0, sizeof(*map));
+        return MSM_CAMERA_STATUS_SUCCESS;
+    }
+    LOGE("no mapping of type %d, stream %u, idx %u, plane %d",
+            buf_unmap->type, buf_unmap->stream_id, buf_unmap->frame_idx,
+            buf_unmap->plane_idx);
+    return MSM_CAMERA_STATUS_FAIL;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_daemon_recv
+ *
+ * DESCRIPTION: serve one map/unmap packet from the HAL and answer it with
+ *              CAM_EVENT_TYPE_MAP_UNMAP_DONE
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @packet  : receive buffer
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_daemon_recv(mm_camera_virt_cam_t *cam,
+        cam_sock_packet_t *packet)
+{
+    struct msghdr msgh;
+    struct iovec iov[1];
+    struct cmsghdr *cmsghp;
+    char control[CMSG_SPACE(sizeof(int) * CAM_MAX_NUM_BUFS_PER_STREAM)];
+    int fds[CAM_MAX_NUM_BUFS_PER_STREAM];
+    uint32_t num_fds = 0;
+    uint32_t status = MSM_CAMERA_STATUS_SUCCESS;
+    uint32_t i, n;
+    ssize_t len;
+
+    memset(&msgh, 0, sizeof(msgh));
+    memset(packet, 0, sizeof(*packet));
+    iov[0].iov_base = packet;
+    iov[0].iov_len = sizeof(*packet);
+    msgh.msg_iov = iov;
+    msgh.msg_iovlen = 1;
+    msgh.msg_control = control;
+    msgh.msg_controllen = sizeof(control);
+
+    len = recvmsg(cam->sock_fd, &msgh, 0);
+    if (len <= 0) {
+        LOGE("recvmsg failed: %s", strerror(errno));
+        return;
+    }
+    for (cmsghp = CMSG_FIRSTHDR(&msgh); NULL != cmsghp;
+            cmsghp = CMSG_NXTHDR(&msgh, cmsghp)) {
+        if ((SOL_SOCKET != cmsghp->cmsg_level) ||
+                (SCM_RIGHTS != cmsghp->cmsg_type)) {
+            continue;
+        }
+        n = (uint32_t)((cmsghp->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        if (n > CAM_MAX_NUM_BUFS_PER_STREAM - num_fds) {
+            n = CAM_MAX_NUM_BUFS_PER_STREAM - num_fds;
+        }
+        memcpy(&fds[num_fds], CMSG_DATA(cmsghp), sizeof(int) * n);
+        num_fds += n;
+    }
+
+    pthread_mutex_lock(&g_virt.lock);
+    switch (packet->msg_type) {
+    case CAM_MAPPING_TYPE_FD_MAPPING:
+        status = mm_camera_virt_map(cam, &packet->payload.buf_map,
+                (num_fds > 0) ? fds[0] : -1);
+        break;
+    case CAM_MAPPING_TYPE_FD_UNMAPPING:
+        status = mm_camera_virt_unmap(cam, &packet->payload.buf_unmap);
+        break;
+    case CAM_MAPPING_TYPE_FD_BUNDLED_MAPPING:
+        for (i = 0; (i < packet->payload.buf_map_list.length) &&
+                (i < CAM_MAX_NUM_BUFS_PER_STREAM); i++) {
+            if (MSM_CAMERA_STATUS_SUCCESS != mm_camera_virt_map(cam,
+                    &packet->payload.buf_map_list.buf_maps[i],
+                    (i < num_fds) ? fds[i] : -1)) {
+                status = MSM_CAMERA_STATUS_FAIL;
+            }
+        }
+        break;
+    case CAM_MAPPING_TYPE_FD_BUNDLED_UNMAPPING:
+        for (i = 0; (i < packet->payload.buf_unmap_list.length) &&
+                (i < CAM_MAX_NUM_BUFS_PER_STREAM); i++) {
+            if (MSM_CAMERA_STATUS_SUCCESS != mm_camera_virt_unmap(cam,
+                    &packet->payload.buf_unmap_list.buf_unmaps[i])) {
+                status = MSM_CAMERA_STATUS_FAIL;
+            }
+        }
+        break;
+    default:
+        LOGE("unknown packet type %d", packet->msg_type);
+        status = MSM_CAMERA_STATUS_FAIL;
+        break;
+    }
+    mm_camera_virt_post_evt(cam, CAM_EVENT_TYPE_MAP_UNMAP_DONE, status);
+    pthread_mutex_unlock(&g_virt.lock);
+
+    /* the mappings stay valid without the received fds */
+    for (i = 0; i < num_fds; i++) {
+        close(fds[i]);
+    }
+}
+
+static void *mm_camera_virt_daemon_routine(void *data)
+{
+    mm_camera_virt_cam_t *cam = (mm_camera_virt_cam_t *)data;
+    cam_sock_packet_t *packet;
+    struct pollfd fds[2];
+    int rc;
+
+    mm_camera_cmd_thread_name("CAM_vDaemon");
+    packet = (cam_sock_packet_t *)malloc(sizeof(cam_sock_packet_t));
+    if (NULL == packet) {
+        LOGE("No memory for cam_sock_packet_t");
+        return NULL;
+    }
+    while (1) {
+        fds[0].fd = cam->sock_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = cam->stop_fd;
+        fds[1].events = POLLIN;
+        rc = poll(fds, 2, -1);
+        if (rc < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            LOGE("poll failed: %s", strerror(errno));
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            mm_camera_virt_daemon_recv(cam, packet);
+        }
+    }
+    free(packet);
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_fill_meta
+ *
+ * DESCRIPTION: stamp a metadata stream buffer for the current frame.
+ *              Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @node    : metadata stream node
+ *   @idx     : buffer index
+ *   @req     : request served by this frame, NULL if none
+ *   @ts_ns   : frame timestamp in ns
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_fill_meta(mm_camera_virt_cam_t *cam,
+        mm_camera_virt_node_t *node, uint32_t idx,
+        const mm_camera_virt_req_t *req, int64_t ts_ns)
+{
+    mm_camera_virt_map_t *map;
+    metadata_buffer_t *meta;
+    int32_t valid = (NULL != req) ? 1 : 0;
+    uint32_t frame_number = (NULL != req) ? req->frame_number : 0;
+
+    map = mm_camera_virt_find_map(cam, CAM_MAPPING_BUF_TYPE_STREAM_BUF,
+            node->server_id, idx);
+    if ((NULL == map) || (map->size < sizeof(metadata_buffer_t))) {
+        LOGE("metadata buffer %u of stream %u not mapped", idx, node->server_id);
+        return;
+    }
+    meta = (metadata_buffer_t *)map->vaddr;
+    if (NULL != cam->meta_tmpl) {
+        memcpy(meta, cam->meta_tmpl, sizeof(metadata_buffer_t));
+    } else {
+        clear_metadata_buffer(meta);
+    }
+    MM_CAMERA_VIRT_SET_META(meta, CAM_INTF_META_FRAME_NUMBER_VALID, valid);
+    MM_CAMERA_VIRT_SET_META(meta, CAM_INTF_META_FRAME_NUMBER, frame_number);
+    MM_CAMERA_VIRT_SET_META(meta, CAM_INTF_META_URGENT_FRAME_NUMBER_VALID, valid);
+    MM_CAMERA_VIRT_SET_META(meta, CAM_INTF_META_URGENT_FRAME_NUMBER, frame_number);
+    MM_CAMERA_VIRT_SET_META(meta, CAM_INTF_META_SENSOR_TIMESTAMP, ts_ns);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_deliver
+ *
+ * DESCRIPTION: move a queued buffer to the done queue of a stream node and
+ *              make it readable. Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @node    : stream node
+ *   @buf_idx : requested buffer index, CAM_FREERUN_IDX for the oldest
+ *   @req     : request served by this frame, NULL if none
+ *   @now     : frame timestamp
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_deliver(mm_camera_virt_cam_t *cam,
+        mm_camera_virt_node_t *node, uint32_t buf_idx,
+        const mm_camera_virt_req_t *req, const struct timespec *now)
+{
+    mm_camera_virt_frame_t *frame;
+    uint32_t pos = 0;
+    uint32_t idx;
+
+    if (CAM_FREERUN_IDX != buf_idx) {
+        for (pos = 0; pos < node->num_queued; pos++) {
+            if (node->queued[pos] == buf_idx) {
+                break;
+            }
+        }
+    }
+    if ((pos >= node->num_queued) ||
+            (node->num_done >= MM_CAMERA_MAX_NUM_FRAMES)) {
+        LOGD("stream %u starved, want buffer %u, %u queued",
+                node->server_id, buf_idx, node->num_queued);
+        cam->stats.starved++;
+        return;
+    }
+    idx = node->queued[pos];
+    node->num_queued--;
+    memmove(&node->queued[pos], &node->queued[pos + 1],
+            (node->num_queued - pos) * sizeof(node->queued[0]));
+
+    frame = &node->done[(node->done_head + node->num_done) %
+            MM_CAMERA_MAX_NUM_FRAMES];
+    frame->idx = idx;
+    frame->sequence = cam->sequence;
+    frame->ts.tv_sec = now->tv_sec;
+    frame->ts.tv_usec = now->tv_nsec / 1000;
+    if (CAM_STREAM_TYPE_METADATA == node->stream_type) {
+        mm_camera_virt_fill_meta(cam, node, idx, req,
+                (int64_t)frame->ts.tv_sec * 1000000000LL +
+                (int64_t)frame->ts.tv_usec * 1000LL);
+    }
+    node->num_done++;
+    cam->stats.delivered++;
+    mm_camera_virt_node_signal(node);
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_req_frames
+ *
+ * DESCRIPTION: number of sensor frames a request takes: the frame count of
+ *              the batch container it consumes on a batch mode stream, 1
+ *              without one. Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @cam_idx : camera index
+ *   @req     : request
+ *
+ * RETURN     : number of frames
+ *==========================================================================*/
+static uint32_t mm_camera_virt_req_frames(mm_camera_virt_cam_t *cam,
+        int cam_idx, const mm_camera_virt_req_t *req)
+{
+    struct msm_camera_user_buf_cont_t *cont;
+    cam_stream_info_t *stream_info;
+    mm_camera_virt_node_t *node;
+    mm_camera_virt_map_t *map;
+    uint32_t frames = 1;
+    uint32_t buf_idx;
+    size_t offset;
+    uint32_t i, j;
+
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_NODES; i++) {
+        node = &g_virt.nodes[i];
+        if ((MM_CAMERA_VIRT_NODE_STREAM != node->type) ||
+                (node->cam_idx != cam_idx) || !node->streaming ||
+                (0 == node->batch) || (0 == node->num_queued)) {
+            continue;
+        }
+        for (j = 0; (j < req->streams.num_streams) && (j < MAX_NUM_STREAMS); j++) {
+            if (req->streams.stream_request[j].streamID != node->server_id) {
+                continue;
+            }
+            buf_idx = req->streams.stream_request[j].buf_index;
+            if (CAM_FREERUN_IDX == buf_idx) {
+                buf_idx = node->queued[0];
+            }
+            /* the containers follow each other in one mapping */
+            stream_info = mm_camera_virt_stream_info(cam, node->server_id);
+            map = mm_camera_virt_find_map(cam, CAM_MAPPING_BUF_TYPE_STREAM_USER_BUF,
+                    node->server_id, 0);
+            offset = (NULL != stream_info) ?
+                    (size_t)buf_idx * stream_info->user_buf_info.size : 0;
+            if ((NULL == stream_info) || (NULL == map) || (map->size <
+                    offset + sizeof(struct msm_camera_user_buf_cont_t))) {
+                LOGE("batch container %u of stream %u not mapped",
+                        buf_idx, node->server_id);
+                break;
+            }
+            cont = (struct msm_camera_user_buf_cont_t *)((uint8_t *)map->vaddr + offset);
+            if ((cont->buf_cnt > frames) && (cont->buf_cnt <= node->batch)) {
+                frames = cont->buf_cnt;
+            }
+            break;
+        }
+    }
+    return frames;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_sensor_tick
+ *
+ * DESCRIPTION: produce one sensor frame. Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @cam_idx : camera index
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_sensor_tick(mm_camera_virt_cam_t *cam, int cam_idx)
+{
+    mm_camera_virt_node_t *node;
+    mm_camera_virt_req_t req;
+    uint8_t has_req = FALSE;
+    uint8_t active = FALSE;
+    struct timespec now;
+    uint32_t frames;
+    uint32_t i, j;
+
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_NODES; i++) {
+        node = &g_virt.nodes[i];
+        if ((MM_CAMERA_VIRT_NODE_STREAM == node->type) &&
+                (node->cam_idx == cam_idx) && node->streaming &&
+                (CAM_STREAM_TYPE_OFFLINE_PROC != node->stream_type)) {
+            active = TRUE;
+            break;
+        }
+    }
+    if (!active) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    cam->sequence++;
+    cam->stats.frames++;
+    memset(&req, 0, sizeof(req));
+    if (cam->batch_ticks > 0) {
+        /* still filling the batch of the held request */
+        if (--cam->batch_ticks > 0) {
+            return;
+        }
+        req = cam->batch_req;
+        has_req = TRUE;
+    } else if (cam->num_reqs > 0) {
+        req = cam->reqs[cam->req_head];
+        cam->req_head = (cam->req_head + 1) % MM_CAMERA_VIRT_MAX_REQS;
+        cam->num_reqs--;
+        has_req = TRUE;
+        frames = mm_camera_virt_req_frames(cam, cam_idx, &req);
+        if (frames > 1) {
+            cam->batch_req = req;
+            cam->batch_ticks = frames - 1;
+            return;
+        }
+    }
+
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_NODES; i++) {
+        node = &g_virt.nodes[i];
+        if ((MM_CAMERA_VIRT_NODE_STREAM != node->type) ||
+                (node->cam_idx != cam_idx) || !node->streaming ||
+                (CAM_STREAM_TYPE_OFFLINE_PROC == node->stream_type)) {
+            continue;
+        }
+        if (CAM_STREAM_TYPE_METADATA == node->stream_type) {
+            mm_camera_virt_deliver(cam, node, CAM_FREERUN_IDX,
+                    has_req ? &req : NULL, &now);
+        } else if (has_req) {
+            for (j = 0; (j < req.streams.num_streams) &&
+                    (j < MAX_NUM_STREAMS); j++) {
+                if (req.streams.stream_request[j].streamID == node->server_id) {
+                    mm_camera_virt_deliver(cam, node,
+                            req.streams.stream_request[j].buf_index, &req, &now);
+                    break;
+                }
+            }
+        } else if (!cam->request_mode) {
+            mm_camera_virt_deliver(cam, node, CAM_FREERUN_IDX, NULL, &now);
+        }
+    }
+}
+
+static void *mm_camera_virt_sensor_routine(void *data)
+{
+    mm_camera_virt_cam_t *cam = (mm_camera_virt_cam_t *)data;
+    int cam_idx = (int)(cam - g_virt.cams);
+    unsigned int seed = (unsigned int)cam_idx + 1;
+    int64_t period_ns = 1000000000LL / cam->fps;
+    int64_t next_ns, wake_ns;
+    struct timespec ts;
+
+    mm_camera_cmd_thread_name("CAM_vSensor");
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    next_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    while (1) {
+        /* jitter moves single frames, it never accumulates */
+        next_ns += period_ns;
+        wake_ns = next_ns;
+        if (g_virt.jitter_us > 0) {
+            wake_ns += ((int64_t)(rand_r(&seed) % (2 * g_virt.jitter_us + 1)) -
+                    (int64_t)g_virt.jitter_us) * 1000LL;
+        }
+        ts.tv_sec = (time_t)(wake_ns / 1000000000LL);
+        ts.tv_nsec = (long)(wake_ns % 1000000000LL);
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL));
+
+        pthread_mutex_lock(&g_virt.lock);
+        if (!cam->running) {
+            pthread_mutex_unlock(&g_virt.lock);
+            break;
+        }
+        mm_camera_virt_sensor_tick(cam, cam_idx);
+        period_ns = 1000000000LL / cam->fps;
+        pthread_mutex_unlock(&g_virt.lock);
+    }
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_cam_release
+ *
+ * DESCRIPTION: free everything a virtual camera holds once its threads are
+ *              stopped. Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_cam_release(mm_camera_virt_cam_t *cam)
+{
+    int i;
+
+    LOGH("frames %u, delivered %u, starved %u, requests %u, maps %u",
+            cam->stats.frames, cam->stats.delivered, cam->stats.starved,
+            cam->stats.requests, cam->stats.maps);
+    for (i = 0; i < MM_CAMERA_VIRT_MAX_MAPS; i++) {
+        if (NULL != cam->maps[i].vaddr) {
+            munmap(cam->maps[i].vaddr, cam->maps[i].size);
+        }
+    }
+    if (cam->sock_fd >= 0) {
+        close(cam->sock_fd);
+        unlink(cam->sock_path);
+    }
+    if (cam->stop_fd >= 0) {
+        close(cam->stop_fd);
+    }
+    free(cam->caps);
+    free(cam->meta_tmpl);
+    memset(cam, 0, sizeof(*cam));
+    cam->sock_fd = -1;
+    cam->stop_fd = -1;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_cam_start
+ *
+ * DESCRIPTION: bring up the daemon stand-in of a camera when its control
+ *              node is opened. Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *   @cam_idx : camera index
+ *
+ * RETURN     : int32_t type of status
+ *              0  -- success
+ *              -1 -- failure
+ *==========================================================================*/
+static int32_t mm_camera_virt_cam_start(mm_camera_virt_cam_t *cam, int cam_idx)
+{
+    mm_camera_sock_addr_t sock_addr;
+    char path[MM_CAMERA_VIRT_PATH_LEN];
+    size_t len = 0;
+
+    snprintf(path, sizeof(path), "%s/caps_%d.bin", g_virt.dir, cam_idx);
+    cam->caps = mm_camera_virt_load_file(path, &cam->caps_len);
+    if (NULL == cam->caps) {
+        LOGW("no capability blob %s, query capability will fail", path);
+    }
+    snprintf(path, sizeof(path), "%s/meta_%d.bin", g_virt.dir, cam_idx);
+    cam->meta_tmpl = (metadata_buffer_t *)mm_camera_virt_load_file(path, &len);
+    if ((NULL != cam->meta_tmpl) && (len != sizeof(metadata_buffer_t))) {
+        LOGW("ignoring %s, %zu bytes instead of %zu",
+                path, len, sizeof(metadata_buffer_t));
+        free(cam->meta_tmpl);
+        cam->meta_tmpl = NULL;
+    }
+
+    cam->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (cam->stop_fd < 0) {
+        LOGE("eventfd failed: %s", strerror(errno));
+        return -1;
+    }
+
+    snprintf(cam->sock_path, sizeof(cam->sock_path), "%s/cam_socket%d",
+            g_virt.dir, cam_idx);
+    cam->sock_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (cam->sock_fd < 0) {
+        LOGE("socket failed: %s", strerror(errno));
+        return -1;
+    }
+    memset(&sock_addr, 0, sizeof(sock_addr));
+    sock_addr.addr_un.sun_family = AF_UNIX;
+    strlcpy(sock_addr.addr_un.sun_path, cam->sock_path,
+            sizeof(sock_addr.addr_un.sun_path));
+    unlink(cam->sock_path);
+    if (0 != bind(cam->sock_fd, &sock_addr.addr, sizeof(sock_addr.addr_un))) {
+        LOGE("cannot bind %s: %s", cam->sock_path, strerror(errno));
+        close(cam->sock_fd);
+        cam->sock_fd = -1;
+        return -1;
+    }
+
+    cam->fps = g_virt.fps;
+    cam->running = TRUE;
+    if (0 != pthread_create(&cam->daemon_pid, NULL,
+            mm_camera_virt_daemon_routine, (void *)cam)) {
+        cam->running = FALSE;
+        return -1;
+    }
+    if (0 != pthread_create(&cam->sensor_pid, NULL,
+            mm_camera_virt_sensor_routine, (void *)cam)) {
+        uint64_t one = 1;
+        cam->running = FALSE;
+        if (write(cam->stop_fd, &one, sizeof(one)) == sizeof(one)) {
+            pthread_mutex_unlock(&g_virt.lock);
+            pthread_join(cam->daemon_pid, NULL);
+            pthread_mutex_lock(&g_virt.lock);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_cam_stop
+ *
+ * DESCRIPTION: stop the threads of a virtual camera. Called without
+ *              g_virt.lock, which both threads take.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_cam_stop(mm_camera_virt_cam_t *cam)
+{
+    uint64_t one = 1;
+
+    if (write(cam->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        LOGE("cannot stop daemon thread: %s", strerror(errno));
+    }
+    pthread_join(cam->daemon_pid, NULL);
+    pthread_join(cam->sensor_pid, NULL);
+}
+
+static void mm_camera_virt_stream_reset(mm_camera_virt_node_t *node)
+{
+    node->streaming = FALSE;
+    node->num_queued = 0;
+    node->num_done = 0;
+    node->done_head = 0;
+    while (0 == mm_camera_virt_node_consume(node));
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_parse_parms
+ *
+ * DESCRIPTION: record a request if the parameter buffer just set carries a
+ *              frame number, and take the sensor rate from its fps range.
+ *              Called with g_virt.lock held.
+ *
+ * PARAMETERS :
+ *   @cam     : virtual camera
+ *
+ * RETURN     : none
+ *==========================================================================*/
+static void mm_camera_virt_parse_parms(mm_camera_virt_cam_t *cam)
+{
+    mm_camera_virt_map_t *map;
+    mm_camera_virt_req_t *req;
+    parm_buffer_t *parms;
+
+    map = mm_camera_virt_find_map(cam, CAM_MAPPING_BUF_TYPE_PARM_BUF, 0, 0);
+    if ((NULL == map) || (map->size < sizeof(parm_buffer_t))) {
+        return;
+    }
+    parms = (parm_buffer_t *)map->vaddr;
+    IF_META_AVAILABLE(cam_fps_range_t, fps_range, CAM_INTF_PARM_FPS_RANGE, parms) {
+        if (fps_range->max_fps >= 1.0f) {
+            cam->fps = (uint32_t)fps_range->max_fps;
+        }
+    }
+    IF_META_AVAILABLE(uint32_t, frame_number, CAM_INTF_META_FRAME_NUMBER, parms) {
+        if (cam->num_reqs >= MM_CAMERA_VIRT_MAX_REQS) {
+            LOGE("dropping request %u, %u pending", *frame_number, cam->num_reqs);
+            return;
+        }
+        req = &cam->reqs[(cam->req_head + cam->num_reqs) % MM_CAMERA_VIRT_MAX_REQS];
+        memset(req, 0, sizeof(*req));
+        req->frame_number = *frame_number;
+        IF_META_AVAILABLE(cam_stream_ID_t, streams, CAM_INTF_META_STREAM_ID, parms) {
+            req->streams = *streams;
+        }
+        cam->num_reqs++;
+        cam->request_mode = TRUE;
+        cam->stats.requests++;
+    }
+}
+
+static int mm_camera_virt_media_ioctl(mm_camera_virt_node_t *node,
+        unsigned long request, void *arg)
+{
+    struct media_device_info *mdev_info;
+    struct media_entity_desc *entity;
+    uint32_t cam_idx;
+
+    switch (request) {
+    case MEDIA_IOC_DEVICE_INFO:
+        mdev_info = (struct media_device_info *)arg;
+        memset(mdev_info, 0, sizeof(*mdev_info));
+        strlcpy(mdev_info->model,
+                (0 == node->cam_idx) ? MSM_CONFIGURATION_NAME : MSM_CAMERA_NAME,
+                sizeof(mdev_info->model));
+        return 0;
+    case MEDIA_IOC_ENUM_ENTITIES:
+        entity = (struct media_entity_desc *)arg;
+        if (0 == node->cam_idx) {
+            /* msm_config: sensor_init followed by one sensor per camera */
+            if (1 == entity->id) {
+                entity->type = MEDIA_ENT_T_V4L2_SUBDEV;
+                entity->group_id = MSM_CAMERA_SUBDEV_SENSOR_INIT;
+                strlcpy(entity->name, MM_CAMERA_VIRT_SENSOR_INIT_NAME,
+                        sizeof(entity->name));
+                return 0;
+            }
+            cam_idx = entity->id - 2;
+            if ((entity->id >= 2) && (cam_idx < (uint32_t)g_virt.num_cams)) {
+                entity->type = MEDIA_ENT_T_V4L2_SUBDEV;
+                entity->group_id = MSM_CAMERA_SUBDEV_SENSOR;
+                snprintf(entity->name, sizeof(entity->name), "vcam-sensor%u",
+                        cam_idx);
+                /* camera 1 faces front at 270 degrees, all others back at 90 */
+                entity->flags = (1 == cam_idx) ?
+                        (MM_CAMERA_VIRT_FACING_FRONT |
+                        (3U << MM_CAMERA_VIRT_MOUNT_SHIFT)) :
+                        (1U << MM_CAMERA_VIRT_MOUNT_SHIFT);
+                return 0;
+            }
+        } else if (1 == entity->id) {
+            entity->type = MEDIA_ENT_T_DEVNODE_V4L;
+            entity->group_id = QCAMERA_VNODE_GROUP_ID;
+            snprintf(entity->name, sizeof(entity->name), "video%d",
+                    node->cam_idx - 1);
+            return 0;
+        }
+        break;
+    default:
+        break;
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static int mm_camera_virt_ctrl_ioctl(mm_camera_virt_node_t *node,
+        unsigned long request, void *arg)
+{
+    mm_camera_virt_cam_t *cam = &g_virt.cams[node->cam_idx];
+    struct v4l2_event *ev;
+    struct v4l2_control *control;
+    mm_camera_virt_map_t *map;
+
+    switch (request) {
+    case VIDIOC_SUBSCRIBE_EVENT:
+    case VIDIOC_UNSUBSCRIBE_EVENT:
+    case VIDIOC_G_CTRL:
+        return 0;
+    case VIDIOC_DQEVENT:
+        if ((0 == cam->num_evts) || (0 != mm_camera_virt_node_consume(node))) {
+            errno = ENOENT;
+            return -1;
+        }
+        ev = (struct v4l2_event *)arg;
+        memset(ev, 0, sizeof(*ev));
+        ev->type = MSM_CAMERA_V4L2_EVENT_TYPE;
+        ev->id = MSM_CAMERA_MSM_NOTIFY;
+        memcpy(ev->u.data, &cam->evts[cam->evt_head],
+                sizeof(struct msm_v4l2_event_data));
+        cam->evt_head = (cam->evt_head + 1) % MM_CAMERA_VIRT_MAX_EVTS;
+        cam->num_evts--;
+        return 0;
+    case VIDIOC_QUERYCAP:
+        map = mm_camera_virt_find_map(cam, CAM_MAPPING_BUF_TYPE_CAPABILITY, 0, 0);
+        if ((NULL == map) || (NULL == cam->caps)) {
+            LOGE("capability %s", (NULL == map) ? "buffer not mapped" : "blob missing");
+            errno = ENODATA;
+            return -1;
+        }
+        memcpy(map->vaddr, cam->caps,
+                (cam->caps_len < map->size) ? cam->caps_len : map->size);
+        return 0;
+    case VIDIOC_S_CTRL:
+        control = (struct v4l2_control *)arg;
+        if (CAM_PRIV_PARM == control->id) {
+            mm_camera_virt_parse_parms(cam);
+        }
+        return 0;
+    default:
+        break;
+    }
+    LOGW("unsupported ioctl 0x%lx on control node", request);
+    errno = EINVAL;
+    return -1;
+}
+
+static int mm_camera_virt_stream_ioctl(mm_camera_virt_node_t *node,
+        unsigned long request, void *arg)
+{
+    mm_camera_virt_cam_t *cam = &g_virt.cams[node->cam_idx];
+    struct v4l2_streamparm *s_parm;
+    struct v4l2_requestbuffers *bufreq;
+    struct v4l2_buffer *vb;
+    struct v4l2_control *control;
+    struct msm_camera_private_ioctl_arg *priv;
+    struct msm_camera_return_buf *ret_buf;
+    mm_camera_virt_frame_t *frame;
+    cam_stream_info_t *stream_info;
+    struct timespec now;
+    uint32_t i;
+
+    switch (request) {
+    case VIDIOC_S_PARM:
+        s_parm = (struct v4l2_streamparm *)arg;
+        node->server_id = ++cam->next_stream_id;
+        s_parm->parm.capture.extendedmode = node->server_id;
+        return 0;
+    case VIDIOC_S_FMT:
+    case VIDIOC_G_CTRL:
+        return 0;
+    case VIDIOC_REQBUFS:
+        bufreq = (struct v4l2_requestbuffers *)arg;
+        if (0 == bufreq->count) {
+            mm_camera_virt_stream_reset(node);
+        }
+        return 0;
+    case VIDIOC_QBUF:
+        vb = (struct v4l2_buffer *)arg;
+        if ((vb->index >= MM_CAMERA_MAX_NUM_FRAMES) ||
+                (node->num_queued >= MM_CAMERA_MAX_NUM_FRAMES)) {
+            errno = EINVAL;
+            return -1;
+        }
+        for (i = 0; i < node->num_queued; i++) {
+            if (node->queued[i] == vb->index) {
+                errno = EINVAL;
+                return -1;
+            }
+        }
+        node->queued[node->num_queued++] = vb->index;
+        return 0;
+    case VIDIOC_DQBUF:
+        if ((0 == node->num_done) || (0 != mm_camera_virt_node_consume(node))) {
+            errno = EAGAIN;
+            return -1;
+        }
+        vb = (struct v4l2_buffer *)arg;
+        frame = &node->done[node->done_head];
+        vb->index = frame->idx;
+        vb->sequence = frame->sequence;
+        vb->timestamp = frame->ts;
+        vb->flags = 0;
+        vb->reserved = 0;
+        node->done_head = (node->done_head + 1) % MM_CAMERA_MAX_NUM_FRAMES;
+        node->num_done--;
+        return 0;
+    case VIDIOC_STREAMON:
+        stream_info = mm_camera_virt_stream_info(cam, node->server_id);
+        if (NULL != stream_info) {
+            node->stream_type = stream_info->stream_type;
+            node->batch = (CAM_STREAMING_MODE_BATCH == stream_info->streaming_mode) ?
+                    stream_info->user_buf_info.frame_buf_cnt : 0;
+        } else {
+            node->stream_type = CAM_STREAM_TYPE_DEFAULT;
+            node->batch = 0;
+        }
+        node->streaming = TRUE;
+        return 0;
+    case VIDIOC_STREAMOFF:
+        if (node->batch) {
+            cam->batch_ticks = 0;
+        }
+        mm_camera_virt_stream_reset(node);
+        return 0;
+    case VIDIOC_S_CTRL:
+        control = (struct v4l2_control *)arg;
+        stream_info = mm_camera_virt_stream_info(cam, node->server_id);
+        /* an offline stream returns one buffer per reprocess request */
+        if ((CAM_PRIV_STREAM_PARM == control->id) && (NULL != stream_info) &&
+                node->streaming &&
+                (CAM_STREAM_TYPE_OFFLINE_PROC == node->stream_type) &&
+                (CAM_STREAM_PARAM_TYPE_DO_REPROCESS == stream_info->parm_buf.type)) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            mm_camera_virt_deliver(cam, node, CAM_FREERUN_IDX, NULL, &now);
+        }
+        return 0;
+    case VIDIOC_MSM_CAMERA_PRIVATE_IOCTL_CMD:
+        priv = (struct msm_camera_private_ioctl_arg *)arg;
+        if (MSM_CAMERA_PRIV_IOCTL_ID_RETURN_BUF == priv->id) {
+            ret_buf = (struct msm_camera_return_buf *)(uintptr_t)priv->ioctl_ptr;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            mm_camera_virt_deliver(cam, node, ret_buf->index, NULL, &now);
+            return 0;
+        }
+        break;
+    default:
+        break;
+    }
+    LOGW("unsupported ioctl 0x%lx on stream %u", request, node->server_id);
+    errno = EINVAL;
+    return -1;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_open
+ *
+ * DESCRIPTION: open an emulated device node. /dev/mediaN, the sensor_init
+ *              subdev and /dev/videoN are emulated, other paths pass
+ *              through. The first open of a camera's video node is its
+ *              control node, later ones are stream nodes.
+ *
+ * PARAMETERS :
+ *   @path    : device path
+ *   @flags   : open flags
+ *
+ * RETURN     : fd, -1 with errno set on failure
+ *==========================================================================*/
+static int mm_camera_virt_open(const char *path, int flags)
+{
+    mm_camera_virt_node_t *node = NULL;
+    mm_camera_virt_cam_t *cam;
+    int idx = 0;
+
+    pthread_once(&g_virt_once, mm_camera_virt_init);
+    if (1 == sscanf(path, "/dev/media%d", &idx)) {
+        /* media0 is msm_config, media1..N one per camera */
+        if ((idx < 0) || (idx > g_virt.num_cams)) {
+            errno = ENOENT;
+            return -1;
+        }
+        pthread_mutex_lock(&g_virt.lock);
+        node = mm_camera_virt_node_alloc(MM_CAMERA_VIRT_NODE_MEDIA, idx);
+        pthread_mutex_unlock(&g_virt.lock);
+    } else if (0 == strcmp(path, "/dev/" MM_CAMERA_VIRT_SENSOR_INIT_NAME)) {
+        pthread_mutex_lock(&g_virt.lock);
+        node = mm_camera_virt_node_alloc(MM_CAMERA_VIRT_NODE_SENSOR_INIT, 0);
+        pthread_mutex_unlock(&g_virt.lock);
+    } else if (1 == sscanf(path, "/dev/video%d", &idx)) {
+        if ((idx < 0) || (idx >= g_virt.num_cams)) {
+            errno = ENOENT;
+            return -1;
+        }
+        pthread_mutex_lock(&g_virt.lock);
+        cam = &g_virt.cams[idx];
+        if (NULL == cam->ctrl) {
+            node = mm_camera_virt_node_alloc(MM_CAMERA_VIRT_NODE_CTRL, idx);
+            if (NULL != node) {
+                cam->ctrl = node;
+                if (0 != mm_camera_virt_cam_start(cam, idx)) {
+                    mm_camera_virt_cam_release(cam);
+                    mm_camera_virt_node_free(node);
+                    node = NULL;
+                    errno = EIO;
+                }
+            }
+        } else {
+            node = mm_camera_virt_node_alloc(MM_CAMERA_VIRT_NODE_STREAM, idx);
+        }
+        pthread_mutex_unlock(&g_virt.lock);
+    } else {
+        return open(path, flags);
+    }
+    return (NULL != node) ? node->fd : -1;
+}
+
+static int mm_camera_virt_close(int fd)
+{
+    mm_camera_virt_node_t *node;
+    mm_camera_virt_cam_t *cam;
+
+    pthread_mutex_lock(&g_virt.lock);
+    node = mm_camera_virt_node_get(fd);
+    if (NULL == node) {
+        pthread_mutex_unlock(&g_virt.lock);
+        return close(fd);
+    }
+    if (MM_CAMERA_VIRT_NODE_CTRL == node->type) {
+        cam = &g_virt.cams[node->cam_idx];
+        cam->running = FALSE;
+        pthread_mutex_unlock(&g_virt.lock);
+        mm_camera_virt_cam_stop(cam);
+        pthread_mutex_lock(&g_virt.lock);
+        mm_camera_virt_cam_release(cam);
+    } else if (MM_CAMERA_VIRT_NODE_STREAM == node->type) {
+        mm_camera_virt_stream_reset(node);
+    }
+    mm_camera_virt_node_free(node);
+    pthread_mutex_unlock(&g_virt.lock);
+    return 0;
+}
+
+static int mm_camera_virt_ioctl(int fd, unsigned long request, void *arg)
+{
+    mm_camera_virt_node_t *node;
+    int rc;
+
+    pthread_mutex_lock(&g_virt.lock);
+    node = mm_camera_virt_node_get(fd);
+    if (NULL == node) {
+        pthread_mutex_unlock(&g_virt.lock);
+        return ioctl(fd, request, arg);
+    }
+    switch (node->type) {
+    case MM_CAMERA_VIRT_NODE_MEDIA:
+        rc = mm_camera_virt_media_ioctl(node, request, arg);
+        break;
+    case MM_CAMERA_VIRT_NODE_SENSOR_INIT:
+        /* sensors are probed as soon as they exist */
+        rc = 0;
+        break;
+    case MM_CAMERA_VIRT_NODE_CTRL:
+        rc = mm_camera_virt_ctrl_ioctl(node, request, arg);
+        break;
+    case MM_CAMERA_VIRT_NODE_STREAM:
+        rc = mm_camera_virt_stream_ioctl(node, request, arg);
+        break;
+    default:
+        errno = EBADF;
+        rc = -1;
+        break;
+    }
+    pthread_mutex_unlock(&g_virt.lock);
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virt_poll
+ *
+ * DESCRIPTION: poll, reporting readable control nodes as POLLPRI and
+ *              readable stream nodes as POLLIN|POLLRDNORM like the msm
+ *              video nodes do
+ *
+ * PARAMETERS :
+ *   @fds     : poll fds
+ *   @nfds    : number of poll fds
+ *   @timeout : timeout in ms
+ *
+ * RETURN     : as poll()
+ *==========================================================================*/
+static int mm_camera_virt_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    mm_camera_virt_node_t *node;
+    nfds_t i;
+    int rc;
+
+    rc = poll(fds, nfds, timeout);
+    if (rc <= 0) {
+        return rc;
+    }
+    pthread_mutex_lock(&g_virt.lock);
+    for (i = 0; i < nfds; i++) {
+        node = mm_camera_virt_node_get(fds[i].fd);
+        if ((NULL == node) || !(fds[i].revents & POLLIN)) {
+            continue;
+        }
+        if (MM_CAMERA_VIRT_NODE_CTRL == node->type) {
+            fds[i].revents = (short)((fds[i].revents & ~(POLLIN | POLLRDNORM)) |
+                    POLLPRI);
+        } else if (MM_CAMERA_VIRT_NODE_STREAM == node->type) {
+            fds[i].revents |= POLLRDNORM;
+        }
+    }
+    pthread_mutex_unlock(&g_virt.lock);
+    return rc;
+}
+
+static void mm_camera_virt_get_sock_path(int cam_id, char *path, size_t len)
+{
+    pthread_once(&g_virt_once, mm_camera_virt_init);
+    snprintf(path, len, "%s/cam_socket%d", g_virt.dir, cam_id);
+}
+
+static const mm_camera_backend_ops_t mm_camera_virt_ops = {
+    .name = "virtual",
+    .open = mm_camera_virt_open,
+    .close = mm_camera_virt_close,
+    .ioctl = mm_camera_virt_ioctl,
+    .poll = mm_camera_virt_poll,
+    .get_sock_path = mm_camera_virt_get_sock_path
+};
+
+/*===========================================================================
+ * FUNCTION   : mm_camera_virtual_get_ops
+ *
+ * DESCRIPTION: get the ops table of the virtual backend
+ *
+ * PARAMETERS : none
+ *
+ * RETURN     : backend ops table
+ *==========================================================================*/
+const mm_camera_backend_ops_t *mm_camera_virtual_get_ops(void)
+{
+    pthread_once(&g_virt_once, mm_camera_virt_init);
+    return &mm_camera_virt_ops;
+}
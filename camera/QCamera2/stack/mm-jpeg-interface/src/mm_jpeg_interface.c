@@ -31,8 +31,10 @@
 #include <cutils/properties.h>
 
 // System dependencies
+#include <stdint.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
 
 // JPEG dependencies
 #include "mm_jpeg_dbg.h"
@@ -43,6 +45,12 @@
 static pthread_mutex_t g_intf_lock = PTHREAD_MUTEX_INITIALIZER;
 static mm_jpeg_obj* g_jpeg_obj = NULL;
 
+/* Keep the jpeg obj (OMX core, job thread, work buffers) warm for a while
+ * after the last client closes so camera reopen and stream reconfigure do
+ * not pay mm_jpeg_init again. Protected by g_intf_lock */
+static pthread_cond_t g_warm_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t g_warm_gen = 0; /* bumped whenever the warm obj is claimed */
+
 static pthread_mutex_t g_handler_lock = PTHREAD_MUTEX_INITIALIZER;
 static uint16_t g_handler_history_count = 0; /* history count for handler */
 volatile uint32_t gKpiDebugLevel = 0;
@@ -232,6 +240,129 @@ static int32_t mm_jpeg_intf_abort_job(uint32_t job_id)
   return rc;
 }
 
+/** mm_jpeg_intf_release_obj:
+ *
+ *  Arguments:
+ *    none
+ *
+ *  Return:
+ *       0 success, failure otherwise
+ *
+ *  Description:
+ *       Deinit and free the global jpeg obj. Must be called with
+ *       g_intf_lock held
+ *
+ **/
+static int32_t mm_jpeg_intf_release_obj(void)
+{
+  int32_t rc = mm_jpeg_deinit(g_jpeg_obj);
+  free(g_jpeg_obj);
+  g_jpeg_obj = NULL;
+  KPI_ATRACE_INT("Camera:JpegWarm", 0);
+  return rc;
+}
+
+/** mm_jpeg_intf_warm_reaper:
+ *
+ *  Arguments:
+ *    @data: warm generation the obj was parked with
+ *
+ *  Return:
+ *       NULL
+ *
+ *  Description:
+ *       Releases the parked jpeg obj once it stayed unclaimed for
+ *       the idle timeout
+ *
+ **/
+static void *mm_jpeg_intf_warm_reaper(void *data)
+{
+  uint32_t gen = (uint32_t)(uintptr_t)data;
+  char prop[PROPERTY_VALUE_MAX];
+  struct timespec ts;
+  int rc = 0;
+
+  property_get("persist.camera.jpeg.warm_idle_ms", prop, "3000");
+  long idle_ms = atol(prop);
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += idle_ms / 1000;
+  ts.tv_nsec += (idle_ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&g_intf_lock);
+  while ((gen == g_warm_gen) && (0 == rc)) {
+    rc = pthread_cond_timedwait(&g_warm_cond, &g_intf_lock, &ts);
+  }
+  if ((gen == g_warm_gen) && (NULL != g_jpeg_obj) &&
+    (0 == g_jpeg_obj->num_clients)) {
+    LOGH("Releasing idle jpeg obj");
+    mm_jpeg_intf_release_obj();
+  }
+  pthread_mutex_unlock(&g_intf_lock);
+  return NULL;
+}
+
+/** mm_jpeg_intf_park_obj:
+ *
+ *  Arguments:
+ *    none
+ *
+ *  Return:
+ *       0 if the obj was kept warm, -1 if the caller must release it
+ *
+ *  Description:
+ *       Called with g_intf_lock held when the last client closes.
+ *       Keeps the obj alive within the memory budget and arms the
+ *       idle timeout
+ *
+ **/
+static int32_t mm_jpeg_intf_park_obj(void)
+{
+  char prop[PROPERTY_VALUE_MAX];
+  pthread_attr_t attr;
+  pthread_t tid;
+  uint64_t work_kb = 0;
+  uint32_t i;
+  int rc;
+
+  property_get("persist.camera.jpeg.warm_idle_ms", prop, "3000");
+  if (atol(prop) <= 0) {
+    return -1;
+  }
+
+  property_get("persist.camera.jpeg.warm_budget_kb", prop, "65536");
+  /* buffers may be sized for an earlier, larger client */
+  for (i = 0; i < g_jpeg_obj->work_buf_cnt; i++) {
+    work_kb += g_jpeg_obj->ionBuffer[i].size / 1024;
+  }
+  if (work_kb > (uint64_t)atol(prop)) {
+    LOGH("Work buffers %llu KB exceed warm budget",
+      (unsigned long long)work_kb);
+    return -1;
+  }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  g_warm_gen++;
+  rc = pthread_create(&tid, &attr, mm_jpeg_intf_warm_reaper,
+    (void *)(uintptr_t)g_warm_gen);
+  pthread_attr_destroy(&attr);
+  if (0 != rc) {
+    LOGE("Cannot launch warm reaper %d", rc);
+    return -1;
+  }
+  pthread_setname_np(tid, "CAM_jpegWarm");
+
+  /* metadata belongs to the client that just closed */
+  g_jpeg_obj->jpeg_metadata = NULL;
+  KPI_ATRACE_INT("Camera:JpegWarm", 1);
+  return 0;
+}
+
 /** mm_jpeg_intf_close:
  *
  *  Arguments:
@@ -265,10 +396,10 @@ static int32_t mm_jpeg_intf_close(uint32_t client_hdl)
   g_jpeg_obj->num_clients--;
   if(0 == rc) {
     if (0 == g_jpeg_obj->num_clients) {
-      /* No client, close jpeg internally */
-      rc = mm_jpeg_deinit(g_jpeg_obj);
-      free(g_jpeg_obj);
-      g_jpeg_obj = NULL;
+      /* No client, keep jpeg warm or close it internally */
+      if (0 != mm_jpeg_intf_park_obj()) {
+        rc = mm_jpeg_intf_release_obj();
+      }
     }
   }
 
@@ -335,6 +466,25 @@ uint32_t jpeg_open(mm_jpeg_ops_t *ops, mm_jpeg_mpo_ops_t *mpo_ops,
   gKpiDebugLevel = atoi(prop);
 
   pthread_mutex_lock(&g_intf_lock);
+  /* claim the warm jpeg obj left by a previous client if it fits */
+  if ((NULL != g_jpeg_obj) && (0 == g_jpeg_obj->num_clients)) {
+    g_warm_gen++;
+    pthread_cond_broadcast(&g_warm_cond);
+    if (((uint32_t)picture_size.w > g_jpeg_obj->max_pic_w) ||
+      ((uint32_t)picture_size.h > g_jpeg_obj->max_pic_h) ||
+      (g_jpeg_obj->reuse_reproc_buffer != ((mpo_ops == NULL) ? 1 : 0))) {
+      LOGH("Warm jpeg obj incompatible, reinit");
+      mm_jpeg_intf_release_obj();
+    } else {
+      LOGH("Reusing warm jpeg obj");
+      /* work buffers allocated from now on are sized for this client */
+      g_jpeg_obj->max_pic_w = picture_size.w;
+      g_jpeg_obj->max_pic_h = picture_size.h;
+      g_jpeg_obj->jpeg_metadata = jpeg_metadata;
+      KPI_ATRACE_INT("Camera:JpegWarm", 0);
+    }
+  }
+
   /* first time open */
   if(NULL == g_jpeg_obj) {
     jpeg_obj = (mm_jpeg_obj *)malloc(sizeof(mm_jpeg_obj));
@@ -398,9 +548,7 @@ uint32_t jpeg_open(mm_jpeg_ops_t *ops, mm_jpeg_mpo_ops_t *mpo_ops,
 
     if (0 == g_jpeg_obj->num_clients) {
       /* no client, close jpeg */
-      mm_jpeg_deinit(g_jpeg_obj);
-      free(g_jpeg_obj);
-      g_jpeg_obj = NULL;
+      mm_jpeg_intf_release_obj();
     }
   }
 
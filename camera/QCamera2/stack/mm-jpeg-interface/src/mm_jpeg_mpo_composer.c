@@ -31,6 +31,7 @@
 
 // System dependencies
 #include <pthread.h>
+#include <string.h>
 
 // JPEG dependencies
 #include "mm_jpeg_dbg.h"
@@ -39,9 +40,26 @@
 #define M_APP0    0xe0
 #define M_APP1    0xe1
 #define M_APP2    0xe2
+#define M_APP15   0xef
+#define M_RST0    0xd0
+#define M_RST7    0xd7
+#define M_SOS     0xda
+#define M_TEM     0x01
 #define M_EOI     0xd9
 #define M_SOI     0xd8
 
+#define MPO_NUM_APP_MARKERS (M_APP15 - M_APP0 + 1)
+
+/** mm_jpeg_mpo_marker_index_t
+ *  @app_marker: start of each APPn segment (its length field),
+ *               NULL if the image has no such segment
+ *
+ *  Header segment layout of a JPEG image, built in a single pass
+ **/
+typedef struct {
+  uint8_t *app_marker[MPO_NUM_APP_MARKERS];
+} mm_jpeg_mpo_marker_index_t;
+
 /** READ_LONG:
  *  @b: Buffer start addr
  *  @o: Buffer offset to start reading
@@ -78,6 +96,17 @@
   (uint16_t) (((uint16_t)b[o] << 8) + \
   (uint16_t) b[o + 1]);
 
+/** READ_SHORT_LITTLE:
+ *  @b: Buffer start addr
+ *  @o: Buffer offset to start reading
+ *
+ *  Read short value from the specified buff addr at given
+ *  offset in Little Endian
+ **/
+#define READ_SHORT_LITTLE(b, o)  \
+  (uint16_t) (((uint16_t)b[o + 1] << 8) + \
+  (uint16_t) b[o]);
+
 /*Mutex to serializa MPO composition*/
 static pthread_mutex_t g_mpo_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -143,6 +172,74 @@ void mm_jpeg_mpo_write_long(uint8_t *buff_addr, uint32_t buff_offset,
   }
 }
 
+/** mm_jpeg_mpo_index_markers
+ *
+ *  Arguments:
+ *    @buffer_addr: Jpeg image start addr
+ *    @buffer_size: Size of the Buffer
+ *    @p_index: marker index to fill
+ *
+ *  Return:
+ *       0 - Success
+ *      -1 - Not a JPEG image
+ *
+ *  Description:
+ *       Walks the header segments once, from SOI up to SOS, and
+ *       records the first occurrence of every APPn marker. Segment
+ *       lengths are bounds checked so corrupt images cannot make the
+ *       walk run past the buffer.
+ *
+ **/
+static int mm_jpeg_mpo_index_markers(uint8_t *buffer_addr, uint32_t buffer_size,
+  mm_jpeg_mpo_marker_index_t *p_index)
+{
+  uint32_t pos = 2;
+  uint8_t marker;
+  uint16_t seg_len;
+
+  memset(p_index, 0, sizeof(*p_index));
+  if ((buffer_size < 4) || (buffer_addr[0] != 0xFF) ||
+    (buffer_addr[1] != M_SOI)) {
+    LOGE("SOI not found");
+    return -1;
+  }
+
+  while ((pos + 1) < buffer_size) {
+    if (buffer_addr[pos] != 0xFF) {
+      LOGD("Marker expected at %d", pos);
+      break;
+    }
+    marker = buffer_addr[pos + 1];
+    if (marker == 0xFF) {
+      //Fill byte
+      pos++;
+      continue;
+    }
+    if ((marker == M_SOS) || (marker == M_EOI)) {
+      break;
+    }
+    if ((marker == M_TEM) || ((marker >= M_RST0) && (marker <= M_RST7))) {
+      pos += 2;
+      continue;
+    }
+    if ((pos + 3) >= buffer_size) {
+      break;
+    }
+    seg_len = READ_SHORT(buffer_addr, pos + 2);
+    if ((seg_len < 2) || ((pos + 2 + seg_len) > buffer_size)) {
+      LOGE("Invalid segment length %d at %d", seg_len, pos);
+      break;
+    }
+    if ((marker >= M_APP0) && (marker <= M_APP15) &&
+      (p_index->app_marker[marker - M_APP0] == NULL)) {
+      p_index->app_marker[marker - M_APP0] = buffer_addr + pos + 2;
+    }
+    pos += 2 + (uint32_t)seg_len;
+  }
+
+  return 0;
+}
+
 /** mm_jpeg_mpo_get_app_marker
  *
  *  Arguments:
@@ -160,42 +257,13 @@ void mm_jpeg_mpo_write_long(uint8_t *buff_addr, uint32_t buff_offset,
 uint8_t *mm_jpeg_mpo_get_app_marker(uint8_t *buffer_addr, int buffer_size,
   int app_marker)
 {
-  int32_t byte;
-  uint8_t *p_current_addr = NULL, *p_start_offset = NULL;
-  uint16_t app_marker_size = 0;
-
-  p_current_addr = buffer_addr;
-  do {
-    do {
-      byte = *(p_current_addr);
-      p_current_addr++;
-    }
-    while ((byte != 0xFF) &&
-      (p_current_addr < (buffer_addr + (buffer_size - 1))));
+  mm_jpeg_mpo_marker_index_t index;
 
-    //If 0xFF is not found at all, break
-    if (byte != 0xFF) {
-      LOGD("0xFF not found");
-      break;
-    }
-
-    //Read the next byte after 0xFF
-    byte = *(p_current_addr);
-    LOGD("Byte %x", byte);
-    if (byte == app_marker) {
-      LOGD("Byte %x", byte);
-      p_start_offset = ++p_current_addr;
-      break;
-    } else if (byte != M_SOI) {
-      app_marker_size = READ_SHORT(p_current_addr, 1);
-      LOGD("size %d", app_marker_size);
-      p_current_addr += app_marker_size;
-    }
+  if ((app_marker < M_APP0) || (app_marker > M_APP15) || (buffer_size < 0) ||
+    mm_jpeg_mpo_index_markers(buffer_addr, (uint32_t)buffer_size, &index)) {
+    return NULL;
   }
-  while ((byte != M_EOI) &&
-    (p_current_addr < (buffer_addr + (buffer_size - 1))));
-
-  return p_start_offset;
+  return index.app_marker[app_marker - M_APP0];
 }
 
 /** mm_jpeg_mpo_get_mp_header
@@ -247,10 +315,15 @@ int mm_jpeg_mpo_update_header(mm_jpeg_mpo_info_t *mpo_info)
   int i = 0, rc = -1;
   uint32_t endianess = MPO_LITTLE_ENDIAN, offset_to_nxt_ifd = 8;
   uint16_t ifd_tag_count = 0;
+  mm_jpeg_mpo_marker_index_t marker_index;
 
-  //Get the addr of the App Marker
-  app2_start_off_addr = mm_jpeg_mpo_get_app_marker(
-    mpo_info->output_buff.buf_vaddr, mpo_info->primary_image.buf_filled_len, M_APP2);
+  //Index the primary image headers once and look up the App2 marker
+  if (mm_jpeg_mpo_index_markers(mpo_info->output_buff.buf_vaddr,
+    mpo_info->primary_image.buf_filled_len, &marker_index)) {
+    LOGE("Primary image is not a JPEG. MPO composition failed");
+    return rc;
+  }
+  app2_start_off_addr = marker_index.app_marker[M_APP2 - M_APP0];
   if (!app2_start_off_addr) {
     LOGE("Cannot find App2 marker. MPO composition failed" );
     return rc;
@@ -293,7 +366,13 @@ int mm_jpeg_mpo_update_header(mm_jpeg_mpo_info_t *mpo_info)
     mp_index_ifd_offset);
 
   //Traverse to MP Entry value
-  ifd_tag_count = READ_SHORT(mpo_info->output_buff.buf_vaddr, current_offset);
+  if (endianess == MPO_LITTLE_ENDIAN) {
+    ifd_tag_count = READ_SHORT_LITTLE(mpo_info->output_buff.buf_vaddr,
+      current_offset);
+  } else {
+    ifd_tag_count = READ_SHORT(mpo_info->output_buff.buf_vaddr,
+      current_offset);
+  }
   LOGD("Tag count in MP entry %d", ifd_tag_count);
   current_offset += MP_INDEX_COUNT_BYTES;
 
@@ -25,7 +25,8 @@ endif
 
 
 LOCAL_SRC_FILES := \
-    src/mm_lib2d.c
+    src/mm_lib2d.c \
+    src/mm_lib2d_native.c
 
 LOCAL_MODULE           := libmmlib2d_interface
 LOCAL_SHARED_LIBRARIES := libdl libcutils liblog libmmcamera_interface
@@ -158,7 +158,8 @@ typedef lib2d_error (*lib2d_client_cb) (void *userdata, int jobid);
  *   MM_LIB2D_ERR_BAD_PARAM
  *   MM_LIB2D_ERR_GENERAL
  *
- * Notes: none
+ * Notes: Falls back to a built-in NV12/NV21 backend when the imglib
+ *     component can not be used, see mm_lib2d_native.h.
  **/
 lib2d_error mm_lib2d_init(lib2d_mode mode, cam_format_t src_format,
   cam_format_t dst_format, void **lib2d_obj_handle);
@@ -0,0 +1,117 @@
+/* Copyright (c) 2015-2017, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef MM_LIB2D_NATIVE_H_
+#define MM_LIB2D_NATIVE_H_
+
+// Camera dependencies
+#include "mm_lib2d.h"
+
+/* Built-in lib2d backend, used when libmmcamera_imglib can not be
+ * loaded or when persist.camera.lib2d.native is set. It handles
+ *   - NV12/NV21 to the same format, rotated by 0/90/180/270 clockwise
+ *   - NV12/NV21 to CAM_FORMAT_8888_ARGB, no rotation
+ * Jobs are cut into bands of destination rows that are processed by the
+ * calling thread together with a small worker pool. */
+
+#define MM_LIB2D_NATIVE_MAX_WORKERS 4
+
+/**
+ * Function: mm_lib2d_native_supported
+ *
+ * Description: Checks whether the native backend handles a conversion
+ *
+ * Input parameters:
+ *   src_format - source surface format
+ *   dst_format - destination surface format
+ *
+ * Return values:
+ *   1 if supported, 0 otherwise
+ *
+ * Notes: none
+ **/
+int mm_lib2d_native_supported(cam_format_t src_format,
+  cam_format_t dst_format);
+
+/**
+ * Function: mm_lib2d_native_init
+ *
+ * Description: Creates the native backend and its worker pool
+ *
+ * Input parameters:
+ *   num_workers - worker threads besides the caller, at most
+ *       MM_LIB2D_NATIVE_MAX_WORKERS
+ *   p_handle - native handle returned on success
+ *
+ * Return values:
+ *   MM_LIB2D_SUCCESS
+ *   MM_LIB2D_ERR_MEMORY
+ *
+ * Notes: Failing to start a worker is not an error, the caller then
+ *     processes more bands itself.
+ **/
+lib2d_error mm_lib2d_native_init(uint32_t num_workers, void **p_handle);
+
+/**
+ * Function: mm_lib2d_native_deinit
+ *
+ * Description: Stops the worker pool and frees the native backend
+ *
+ * Input parameters:
+ *   handle - native handle
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+void mm_lib2d_native_deinit(void *handle);
+
+/**
+ * Function: mm_lib2d_native_process
+ *
+ * Description: Runs one job to completion
+ *
+ * Input parameters:
+ *   handle - native handle
+ *   src_buffer - pointer to the source buffer
+ *   dst_buffer - pointer to the destination buffer
+ *   rotation - clockwise rotation in degrees
+ *
+ * Return values:
+ *   MM_LIB2D_SUCCESS
+ *   MM_LIB2D_ERR_BAD_PARAM
+ *
+ * Notes: Jobs on one handle are serialized.
+ **/
+lib2d_error mm_lib2d_native_process(void *handle,
+  mm_lib2d_buffer *src_buffer, mm_lib2d_buffer *dst_buffer,
+  uint32_t rotation);
+
+#endif /* MM_LIB2D_NATIVE_H_ */
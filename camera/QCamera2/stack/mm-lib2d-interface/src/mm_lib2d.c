@@ -35,10 +35,13 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <pthread.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <cutils/properties.h>
 
 // Camera dependencies
 #include "img_common.h"
@@ -47,6 +50,7 @@
 #include "img_buffer.h"
 #include "lib2d.h"
 #include "mm_lib2d.h"
+#include "mm_lib2d_native.h"
 #include "img_meta.h"
 
 /** lib2d_job_private_info
@@ -82,6 +86,8 @@ typedef struct {
  * @img_lib: imglib library, function ptrs handle
  * @mutex: lib2d mutex used for synchronization
  * @cond: librd cond used for synchronization
+ * @native_handle: built-in backend, used instead of the imglib
+ *     component when set
 **/
 typedef struct mm_lib2d_obj_t {
   img_core_ops_t      core_ops;
@@ -91,6 +97,7 @@ typedef struct mm_lib2d_obj_t {
   img_lib_t           img_lib;
   pthread_mutex_t     mutex;
   pthread_cond_t      cond;
+  void               *native_handle;
 } mm_lib2d_obj;
 
 
@@ -258,6 +265,32 @@ lib2d_error lib2d_fill_img_frame(img_frame_t *p_frame,
   return MM_LIB2D_SUCCESS;
 }
 
+/**
+ * Function: lib2d_native_setup
+ *
+ * Description: Switches a lib2d object to the built-in backend, with
+ *     one worker per additional online cpu
+ *
+ * Input parameters:
+ *   lib2d_obj - lib2d object
+ *   mode - Mode (sync/async) requested by App
+ *
+ * Return values:
+ *   MM_LIB2D_SUCCESS
+ *   MM_LIB2D_ERR_MEMORY
+ *
+ * Notes: none
+ **/
+static lib2d_error lib2d_native_setup(mm_lib2d_obj *lib2d_obj,
+  lib2d_mode mode)
+{
+  long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t num_workers = (num_cpus > 1) ? (uint32_t)(num_cpus - 1) : 0;
+
+  lib2d_obj->lib2d_mode = mode;
+  return mm_lib2d_native_init(num_workers, &lib2d_obj->native_handle);
+}
+
 /**
  * Function: mm_lib2d_init
  *
@@ -288,6 +321,7 @@ lib2d_error mm_lib2d_init(lib2d_mode mode, cam_format_t src_format,
   img_core_ops_t      *p_core_ops = NULL;
   img_component_ops_t *p_comp     = NULL;
   pthread_condattr_t cond_attr;
+  char prop[PROPERTY_VALUE_MAX];
 
   if (my_obj == NULL) {
     return MM_LIB2D_ERR_BAD_PARAM;
@@ -305,6 +339,18 @@ lib2d_error mm_lib2d_init(lib2d_mode mode, cam_format_t src_format,
   if (lib2d_obj == NULL) {
     return MM_LIB2D_ERR_MEMORY;
   }
+  memset(lib2d_obj, 0x0, sizeof(mm_lib2d_obj));
+
+  property_get("persist.camera.lib2d.native", prop, "0");
+  if (atoi(prop) && mm_lib2d_native_supported(src_format, dst_format)) {
+    if (lib2d_native_setup(lib2d_obj, mode) != MM_LIB2D_SUCCESS) {
+      free(lib2d_obj);
+      return MM_LIB2D_ERR_MEMORY;
+    }
+    LOGH("Using native lib2d backend");
+    *my_obj = (void *)lib2d_obj;
+    return MM_LIB2D_SUCCESS;
+  }
 
   // Open libmmcamera_imglib
   lib2d_obj->img_lib.ptr = dlopen("libmmcamera_imglib.so", RTLD_NOW);
@@ -431,6 +477,22 @@ COMP_UNLOAD :
   }
 
 FREE_LIB2D_OBJ :
+  // p_comp is set right before the mutex and cond are initialized
+  if (p_comp != NULL) {
+    pthread_cond_destroy(&lib2d_obj->cond);
+    pthread_mutex_destroy(&lib2d_obj->mutex);
+  }
+  if (lib2d_obj->img_lib.ptr) {
+    dlclose(lib2d_obj->img_lib.ptr);
+    lib2d_obj->img_lib.ptr = NULL;
+  }
+  // imglib missing or failing, the built-in backend may still do the job
+  if (mm_lib2d_native_supported(src_format, dst_format) &&
+    (lib2d_native_setup(lib2d_obj, mode) == MM_LIB2D_SUCCESS)) {
+    LOGW("imglib lib2d unavailable, using native backend");
+    *my_obj = (void *)lib2d_obj;
+    return MM_LIB2D_SUCCESS;
+  }
   free(lib2d_obj);
   return MM_LIB2D_ERR_GENERAL;
 }
@@ -456,6 +518,12 @@ lib2d_error mm_lib2d_deinit(void *lib2d_obj_handle)
   img_core_ops_t      *p_core_ops = &lib2d_obj->core_ops;
   img_component_ops_t *p_comp     = &lib2d_obj->comp;
 
+  if (lib2d_obj->native_handle) {
+    mm_lib2d_native_deinit(lib2d_obj->native_handle);
+    free(lib2d_obj);
+    return MM_LIB2D_SUCCESS;
+  }
+
   rc = IMG_COMP_DEINIT(p_comp);
   if (rc != IMG_SUCCESS) {
     LOGE("rc %d", rc);
@@ -503,6 +571,16 @@ lib2d_error mm_lib2d_start_job(void *lib2d_obj_handle,
   int                  rc         = IMG_SUCCESS;
   img_component_ops_t *p_comp     = &lib2d_obj->comp;
 
+  if (lib2d_obj->native_handle) {
+    // runs to completion in either mode, the callback follows right away
+    lib2d_error lib2d_err = mm_lib2d_native_process(lib2d_obj->native_handle,
+      src_buffer, dst_buffer, rotation);
+    if ((lib2d_err == MM_LIB2D_SUCCESS) && (cb != NULL)) {
+      cb(userdata, jobid);
+    }
+    return lib2d_err;
+  }
+
   img_frame_t *p_in_frame = malloc(sizeof(img_frame_t));
   if (p_in_frame == NULL) {
     return MM_LIB2D_ERR_MEMORY;
@@ -0,0 +1,875 @@
+/* Copyright (c) 2015-2017, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// System dependencies
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+// LIB2D_NO_NEON keeps the plain C paths, the tests compare both builds
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(LIB2D_NO_NEON)
+#include <arm_neon.h>
+#define LIB2D_NEON
+#endif
+
+// Camera dependencies
+#include "mm_lib2d_native.h"
+
+/* Rotations go through 8x8 element blocks, walked in LIB2D_TILE square
+ * tiles so the source lines of a tile stay in L1 while it is written.
+ * A band is LIB2D_BAND_ROWS destination luma rows, half as many chroma
+ * rows; it is the unit handed to the workers. */
+#define LIB2D_BLOCK     8
+#define LIB2D_TILE      32
+#define LIB2D_BAND_ROWS 64
+
+/* BT.601 full range, as used by JFIF, in Q14 */
+#define LIB2D_CSC_SHIFT 14
+#define LIB2D_CSC_ROUND (1 << (LIB2D_CSC_SHIFT - 1))
+#define LIB2D_CSC_RV    22970
+#define LIB2D_CSC_GU    5638
+#define LIB2D_CSC_GV    11700
+#define LIB2D_CSC_BU    29032
+
+/** lib2d_plane_t
+ * @src: first element of the source plane
+ * @src_stride: source stride in bytes
+ * @dst: first element of the destination plane
+ * @dst_stride: destination stride in bytes
+ * @width: source width in elements
+ * @height: source height in elements
+**/
+typedef struct {
+  const uint8_t *src;
+  int32_t        src_stride;
+  uint8_t       *dst;
+  int32_t        dst_stride;
+  uint32_t       width;
+  uint32_t       height;
+} lib2d_plane_t;
+
+typedef enum {
+  LIB2D_NATIVE_OP_ROTATE,
+  LIB2D_NATIVE_OP_TO_ARGB,
+} lib2d_native_op_t;
+
+/** lib2d_native_job_t
+ * @op: operation
+ * @rotation: clockwise rotation, LIB2D_NATIVE_OP_ROTATE only
+ * @luma: Y plane, 1 byte elements
+ * @chroma: interleaved chroma plane, 2 byte elements
+ * @v_first: chroma is CrCb (NV21), LIB2D_NATIVE_OP_TO_ARGB only
+ * @dst_rows: destination luma rows
+ * @num_bands: bands of this job
+**/
+typedef struct {
+  lib2d_native_op_t op;
+  uint32_t          rotation;
+  lib2d_plane_t     luma;
+  lib2d_plane_t     chroma;
+  uint32_t          v_first;
+  uint32_t          dst_rows;
+  uint32_t          num_bands;
+} lib2d_native_job_t;
+
+/** lib2d_native_obj_t
+ * @job_lock: serializes jobs on this handle
+ * @lock: protects job dispatch and the fields below
+ * @work_cond: signaled when a job is posted or on exit
+ * @done_cond: signaled when the last band of a job is done
+ * @job: current job
+ * @next_band: next band to be claimed
+ * @bands_done: bands of the current job completed
+ * @exit: workers shall exit
+ * @threads: worker threads
+ * @num_threads: started worker threads
+**/
+typedef struct {
+  pthread_mutex_t    job_lock;
+  pthread_mutex_t    lock;
+  pthread_cond_t     work_cond;
+  pthread_cond_t     done_cond;
+  lib2d_native_job_t job;
+  uint32_t           next_band;
+  uint32_t           bands_done;
+  uint32_t           exit;
+  pthread_t          threads[MM_LIB2D_NATIVE_MAX_WORKERS];
+  uint32_t           num_threads;
+} lib2d_native_obj_t;
+
+/**
+ * Function: lib2d_src_pos
+ *
+ * Description: Maps a destination element to its source element for a
+ *     clockwise rotation
+ *
+ * Input parameters:
+ *   p - plane
+ *   rotation - 0/90/180/270
+ *   dx, dy - destination element
+ *   sx, sy - source element, output
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static inline void lib2d_src_pos(const lib2d_plane_t *p, uint32_t rotation,
+  uint32_t dx, uint32_t dy, uint32_t *sx, uint32_t *sy)
+{
+  switch (rotation) {
+  case 90:
+    *sx = dy;
+    *sy = p->height - 1 - dx;
+    break;
+  case 180:
+    *sx = p->width - 1 - dx;
+    *sy = p->height - 1 - dy;
+    break;
+  case 270:
+    *sx = p->width - 1 - dy;
+    *sy = dx;
+    break;
+  default:
+    *sx = dx;
+    *sy = dy;
+    break;
+  }
+}
+
+#ifdef LIB2D_NEON
+/**
+ * Function: lib2d_transpose_u8
+ *
+ * Description: Transposes 8 rows of 8 bytes in place
+ *
+ * Input parameters:
+ *   r - rows
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static inline void lib2d_transpose_u8(uint8x8_t r[8])
+{
+  uint8x8x2_t t01 = vtrn_u8(r[0], r[1]);
+  uint8x8x2_t t23 = vtrn_u8(r[2], r[3]);
+  uint8x8x2_t t45 = vtrn_u8(r[4], r[5]);
+  uint8x8x2_t t67 = vtrn_u8(r[6], r[7]);
+  uint16x4x2_t u02 = vtrn_u16(vreinterpret_u16_u8(t01.val[0]),
+    vreinterpret_u16_u8(t23.val[0]));
+  uint16x4x2_t u13 = vtrn_u16(vreinterpret_u16_u8(t01.val[1]),
+    vreinterpret_u16_u8(t23.val[1]));
+  uint16x4x2_t u46 = vtrn_u16(vreinterpret_u16_u8(t45.val[0]),
+    vreinterpret_u16_u8(t67.val[0]));
+  uint16x4x2_t u57 = vtrn_u16(vreinterpret_u16_u8(t45.val[1]),
+    vreinterpret_u16_u8(t67.val[1]));
+  uint32x2x2_t v04 = vtrn_u32(vreinterpret_u32_u16(u02.val[0]),
+    vreinterpret_u32_u16(u46.val[0]));
+  uint32x2x2_t v15 = vtrn_u32(vreinterpret_u32_u16(u13.val[0]),
+    vreinterpret_u32_u16(u57.val[0]));
+  uint32x2x2_t v26 = vtrn_u32(vreinterpret_u32_u16(u02.val[1]),
+    vreinterpret_u32_u16(u46.val[1]));
+  uint32x2x2_t v37 = vtrn_u32(vreinterpret_u32_u16(u13.val[1]),
+    vreinterpret_u32_u16(u57.val[1]));
+
+  r[0] = vreinterpret_u8_u32(v04.val[0]);
+  r[1] = vreinterpret_u8_u32(v15.val[0]);
+  r[2] = vreinterpret_u8_u32(v26.val[0]);
+  r[3] = vreinterpret_u8_u32(v37.val[0]);
+  r[4] = vreinterpret_u8_u32(v04.val[1]);
+  r[5] = vreinterpret_u8_u32(v15.val[1]);
+  r[6] = vreinterpret_u8_u32(v26.val[1]);
+  r[7] = vreinterpret_u8_u32(v37.val[1]);
+}
+
+/**
+ * Function: lib2d_transpose_u16
+ *
+ * Description: Transposes 8 rows of 8 16 bit elements in place
+ *
+ * Input parameters:
+ *   r - rows
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static inline void lib2d_transpose_u16(uint16x8_t r[8])
+{
+  uint16x8x2_t t01 = vtrnq_u16(r[0], r[1]);
+  uint16x8x2_t t23 = vtrnq_u16(r[2], r[3]);
+  uint16x8x2_t t45 = vtrnq_u16(r[4], r[5]);
+  uint16x8x2_t t67 = vtrnq_u16(r[6], r[7]);
+  uint32x4x2_t u02 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[0]),
+    vreinterpretq_u32_u16(t23.val[0]));
+  uint32x4x2_t u13 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[1]),
+    vreinterpretq_u32_u16(t23.val[1]));
+  uint32x4x2_t u46 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[0]),
+    vreinterpretq_u32_u16(t67.val[0]));
+  uint32x4x2_t u57 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[1]),
+    vreinterpretq_u32_u16(t67.val[1]));
+
+  r[0] = vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(u02.val[0]),
+    vget_low_u32(u46.val[0])));
+  r[1] = vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(u13.val[0]),
+    vget_low_u32(u57.val[0])));
+  r[2] = vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(u02.val[1]),
+    vget_low_u32(u46.val[1])));
+  r[3] = vreinterpretq_u16_u32(vcombine_u32(vget_low_u32(u13.val[1]),
+    vget_low_u32(u57.val[1])));
+  r[4] = vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(u02.val[0]),
+    vget_high_u32(u46.val[0])));
+  r[5] = vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(u13.val[0]),
+    vget_high_u32(u57.val[0])));
+  r[6] = vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(u02.val[1]),
+    vget_high_u32(u46.val[1])));
+  r[7] = vreinterpretq_u16_u32(vcombine_u32(vget_high_u32(u13.val[1]),
+    vget_high_u32(u57.val[1])));
+}
+#endif
+
+/**
+ * Function: lib2d_block_u8
+ *
+ * Description: Writes one destination block of a 90/270 rotation of
+ *     a 1 byte plane
+ *
+ * Input parameters:
+ *   p - plane
+ *   rotation - 90 or 270
+ *   dx0, dy0 - top left destination element of the block
+ *   bw, bh - block size, at most LIB2D_BLOCK
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_block_u8(const lib2d_plane_t *p, uint32_t rotation,
+  uint32_t dx0, uint32_t dy0, uint32_t bw, uint32_t bh)
+{
+  uint32_t dx, dy, sx, sy;
+
+#ifdef LIB2D_NEON
+  if ((bw == LIB2D_BLOCK) && (bh == LIB2D_BLOCK)) {
+    uint8x8_t r[LIB2D_BLOCK];
+    uint32_t j;
+
+    if (rotation == 90) {
+      // row j of the source block is destination column j, read upwards
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        r[j] = vld1_u8(p->src +
+          (p->height - 1 - dx0 - j) * (uint32_t)p->src_stride + dy0);
+      }
+      lib2d_transpose_u8(r);
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        vst1_u8(p->dst + (dy0 + j) * (uint32_t)p->dst_stride + dx0, r[j]);
+      }
+    } else {
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        r[j] = vld1_u8(p->src + (dx0 + j) * (uint32_t)p->src_stride +
+          (p->width - LIB2D_BLOCK - dy0));
+      }
+      lib2d_transpose_u8(r);
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        vst1_u8(p->dst + (dy0 + LIB2D_BLOCK - 1 - j) *
+          (uint32_t)p->dst_stride + dx0, r[j]);
+      }
+    }
+    return;
+  }
+#endif
+
+  for (dy = dy0; dy < dy0 + bh; dy++) {
+    uint8_t *dst = p->dst + dy * (uint32_t)p->dst_stride;
+    for (dx = dx0; dx < dx0 + bw; dx++) {
+      lib2d_src_pos(p, rotation, dx, dy, &sx, &sy);
+      dst[dx] = p->src[sy * (uint32_t)p->src_stride + sx];
+    }
+  }
+}
+
+/**
+ * Function: lib2d_block_u16
+ *
+ * Description: Writes one destination block of a 90/270 rotation of
+ *     a 2 byte plane
+ *
+ * Input parameters:
+ *   p - plane
+ *   rotation - 90 or 270
+ *   dx0, dy0 - top left destination element of the block
+ *   bw, bh - block size, at most LIB2D_BLOCK
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_block_u16(const lib2d_plane_t *p, uint32_t rotation,
+  uint32_t dx0, uint32_t dy0, uint32_t bw, uint32_t bh)
+{
+  uint32_t dx, dy, sx, sy;
+
+#ifdef LIB2D_NEON
+  if ((bw == LIB2D_BLOCK) && (bh == LIB2D_BLOCK)) {
+    uint16x8_t r[LIB2D_BLOCK];
+    uint32_t j;
+
+    if (rotation == 90) {
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        r[j] = vld1q_u16((const uint16_t *)(p->src +
+          (p->height - 1 - dx0 - j) * (uint32_t)p->src_stride) + dy0);
+      }
+      lib2d_transpose_u16(r);
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        vst1q_u16((uint16_t *)(p->dst +
+          (dy0 + j) * (uint32_t)p->dst_stride) + dx0, r[j]);
+      }
+    } else {
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        r[j] = vld1q_u16((const uint16_t *)(p->src +
+          (dx0 + j) * (uint32_t)p->src_stride) +
+          (p->width - LIB2D_BLOCK - dy0));
+      }
+      lib2d_transpose_u16(r);
+      for (j = 0; j < LIB2D_BLOCK; j++) {
+        vst1q_u16((uint16_t *)(p->dst + (dy0 + LIB2D_BLOCK - 1 - j) *
+          (uint32_t)p->dst_stride) + dx0, r[j]);
+      }
+    }
+    return;
+  }
+#endif
+
+  for (dy = dy0; dy < dy0 + bh; dy++) {
+    uint16_t *dst = (uint16_t *)(p->dst + dy * (uint32_t)p->dst_stride);
+    for (dx = dx0; dx < dx0 + bw; dx++) {
+      lib2d_src_pos(p, rotation, dx, dy, &sx, &sy);
+      dst[dx] = ((const uint16_t *)(p->src +
+        sy * (uint32_t)p->src_stride))[sx];
+    }
+  }
+}
+
+/**
+ * Function: lib2d_flip_row_u8
+ *
+ * Description: Copies a row of bytes in reverse order
+ *
+ * Input parameters:
+ *   src - source row
+ *   dst - destination row
+ *   width - row length in elements
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_flip_row_u8(const uint8_t *src, uint8_t *dst,
+  uint32_t width)
+{
+  uint32_t x = 0;
+
+#ifdef LIB2D_NEON
+  for (; x + 16 <= width; x += 16) {
+    uint8x16_t v = vrev64q_u8(vld1q_u8(src + width - 16 - x));
+    vst1q_u8(dst + x, vcombine_u8(vget_high_u8(v), vget_low_u8(v)));
+  }
+#endif
+  for (; x < width; x++) {
+    dst[x] = src[width - 1 - x];
+  }
+}
+
+/**
+ * Function: lib2d_flip_row_u16
+ *
+ * Description: Copies a row of 16 bit elements in reverse order
+ *
+ * Input parameters:
+ *   src - source row
+ *   dst - destination row
+ *   width - row length in elements
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_flip_row_u16(const uint16_t *src, uint16_t *dst,
+  uint32_t width)
+{
+  uint32_t x = 0;
+
+#ifdef LIB2D_NEON
+  for (; x + 8 <= width; x += 8) {
+    uint16x8_t v = vrev64q_u16(vld1q_u16(src + width - 8 - x));
+    vst1q_u16(dst + x, vcombine_u16(vget_high_u16(v), vget_low_u16(v)));
+  }
+#endif
+  for (; x < width; x++) {
+    dst[x] = src[width - 1 - x];
+  }
+}
+
+/**
+ * Function: lib2d_rotate_rows
+ *
+ * Description: Writes destination rows [r0, r1) of a rotated plane
+ *
+ * Input parameters:
+ *   p - plane
+ *   rotation - 0/90/180/270
+ *   elem_size - 1 or 2 bytes
+ *   r0, r1 - destination rows
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_rotate_rows(const lib2d_plane_t *p, uint32_t rotation,
+  uint32_t elem_size, uint32_t r0, uint32_t r1)
+{
+  uint32_t dst_w = ((rotation == 90) || (rotation == 270)) ?
+    p->height : p->width;
+  uint32_t dy, dx, ty, tx;
+
+  if ((rotation == 0) || (rotation == 180)) {
+    for (dy = r0; dy < r1; dy++) {
+      uint8_t *dst = p->dst + dy * (uint32_t)p->dst_stride;
+      if (rotation == 0) {
+        memcpy(dst, p->src + dy * (uint32_t)p->src_stride,
+          dst_w * elem_size);
+      } else if (elem_size == 1) {
+        lib2d_flip_row_u8(p->src +
+          (p->height - 1 - dy) * (uint32_t)p->src_stride, dst, dst_w);
+      } else {
+        lib2d_flip_row_u16((const uint16_t *)(p->src +
+          (p->height - 1 - dy) * (uint32_t)p->src_stride),
+          (uint16_t *)dst, dst_w);
+      }
+    }
+    return;
+  }
+
+  for (ty = r0; ty < r1; ty += LIB2D_TILE) {
+    uint32_t ty_end = (ty + LIB2D_TILE < r1) ? ty + LIB2D_TILE : r1;
+    for (tx = 0; tx < dst_w; tx += LIB2D_TILE) {
+      uint32_t tx_end = (tx + LIB2D_TILE < dst_w) ? tx + LIB2D_TILE : dst_w;
+      for (dy = ty; dy < ty_end; dy += LIB2D_BLOCK) {
+        uint32_t bh = (dy + LIB2D_BLOCK < ty_end) ?
+          LIB2D_BLOCK : ty_end - dy;
+        for (dx = tx; dx < tx_end; dx += LIB2D_BLOCK) {
+          uint32_t bw = (dx + LIB2D_BLOCK < tx_end) ?
+            LIB2D_BLOCK : tx_end - dx;
+          if (elem_size == 1) {
+            lib2d_block_u8(p, rotation, dx, dy, bw, bh);
+          } else {
+            lib2d_block_u16(p, rotation, dx, dy, bw, bh);
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Function: lib2d_clamp_u8
+ *
+ * Description: Scales a Q14 color value back and clamps it to a byte
+ *
+ * Input parameters:
+ *   v - Q14 value, rounding already added
+ *
+ * Return values:
+ *   clamped value
+ *
+ * Notes: none
+ **/
+static inline uint8_t lib2d_clamp_u8(int32_t v)
+{
+  v >>= LIB2D_CSC_SHIFT;
+  return (uint8_t)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+/**
+ * Function: lib2d_argb_rows
+ *
+ * Description: Converts destination rows [r0, r1) to ARGB. Pixels are
+ *     written R, G, B, A in memory order, like android ARGB_8888. The
+ *     NEON path produces the same values as the C one.
+ *
+ * Input parameters:
+ *   job - conversion job, luma.dst holds the ARGB buffer
+ *   r0, r1 - destination rows
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_argb_rows(const lib2d_native_job_t *job, uint32_t r0,
+  uint32_t r1)
+{
+  const lib2d_plane_t *y_plane = &job->luma;
+  const lib2d_plane_t *c_plane = &job->chroma;
+  uint32_t u_off = job->v_first ? 1 : 0;
+  uint32_t y, x;
+
+  for (y = r0; y < r1; y++) {
+    const uint8_t *src_y = y_plane->src + y * (uint32_t)y_plane->src_stride;
+    const uint8_t *src_c = c_plane->src +
+      (y / 2) * (uint32_t)c_plane->src_stride;
+    uint8_t *dst = y_plane->dst + y * (uint32_t)y_plane->dst_stride;
+    x = 0;
+
+#ifdef LIB2D_NEON
+    for (; x + 8 <= y_plane->width; x += 8) {
+      // 4 chroma pairs; trn with itself doubles each byte of a pair
+      uint8x8x2_t c = vtrn_u8(vld1_u8(src_c + x), vld1_u8(src_c + x));
+      int16x8_t yv = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src_y + x)));
+      int16x8_t uv = vsubq_s16(vreinterpretq_s16_u16(
+        vmovl_u8(c.val[u_off])), vdupq_n_s16(128));
+      int16x8_t vv = vsubq_s16(vreinterpretq_s16_u16(
+        vmovl_u8(c.val[1 - u_off])), vdupq_n_s16(128));
+      int32x4_t round = vdupq_n_s32(LIB2D_CSC_ROUND);
+      int32x4_t yl = vaddq_s32(vshll_n_s16(vget_low_s16(yv),
+        LIB2D_CSC_SHIFT), round);
+      int32x4_t yh = vaddq_s32(vshll_n_s16(vget_high_s16(yv),
+        LIB2D_CSC_SHIFT), round);
+      int32x4_t rl = vmlal_n_s16(yl, vget_low_s16(vv), LIB2D_CSC_RV);
+      int32x4_t rh = vmlal_n_s16(yh, vget_high_s16(vv), LIB2D_CSC_RV);
+      int32x4_t gl = vmlsl_n_s16(vmlsl_n_s16(yl, vget_low_s16(uv),
+        LIB2D_CSC_GU), vget_low_s16(vv), LIB2D_CSC_GV);
+      int32x4_t gh = vmlsl_n_s16(vmlsl_n_s16(yh, vget_high_s16(uv),
+        LIB2D_CSC_GU), vget_high_s16(vv), LIB2D_CSC_GV);
+      int32x4_t bl = vmlal_n_s16(yl, vget_low_s16(uv), LIB2D_CSC_BU);
+      int32x4_t bh = vmlal_n_s16(yh, vget_high_s16(uv), LIB2D_CSC_BU);
+      uint8x8x4_t out;
+
+      out.val[0] = vqmovun_s16(vcombine_s16(
+        vqmovn_s32(vshrq_n_s32(rl, LIB2D_CSC_SHIFT)),
+        vqmovn_s32(vshrq_n_s32(rh, LIB2D_CSC_SHIFT))));
+      out.val[1] = vqmovun_s16(vcombine_s16(
+        vqmovn_s32(vshrq_n_s32(gl, LIB2D_CSC_SHIFT)),
+        vqmovn_s32(vshrq_n_s32(gh, LIB2D_CSC_SHIFT))));
+      out.val[2] = vqmovun_s16(vcombine_s16(
+        vqmovn_s32(vshrq_n_s32(bl, LIB2D_CSC_SHIFT)),
+        vqmovn_s32(vshrq_n_s32(bh, LIB2D_CSC_SHIFT))));
+      out.val[3] = vdup_n_u8(0xFF);
+      vst4_u8(dst + x * 4, out);
+    }
+#endif
+    for (; x < y_plane->width; x++) {
+      int32_t yq = ((int32_t)src_y[x] << LIB2D_CSC_SHIFT) + LIB2D_CSC_ROUND;
+      int32_t u = (int32_t)src_c[(x & ~1U) + u_off] - 128;
+      int32_t v = (int32_t)src_c[(x & ~1U) + 1 - u_off] - 128;
+
+      dst[x * 4]     = lib2d_clamp_u8(yq + LIB2D_CSC_RV * v);
+      dst[x * 4 + 1] = lib2d_clamp_u8(yq - LIB2D_CSC_GU * u -
+        LIB2D_CSC_GV * v);
+      dst[x * 4 + 2] = lib2d_clamp_u8(yq + LIB2D_CSC_BU * u);
+      dst[x * 4 + 3] = 0xFF;
+    }
+  }
+}
+
+/**
+ * Function: lib2d_native_run_band
+ *
+ * Description: Processes one band of a job
+ *
+ * Input parameters:
+ *   job - job
+ *   band - band index
+ *
+ * Return values:
+ *   none
+ *
+ * Notes: none
+ **/
+static void lib2d_native_run_band(const lib2d_native_job_t *job,
+  uint32_t band)
+{
+  uint32_t r0 = band * LIB2D_BAND_ROWS;
+  uint32_t r1 = (r0 + LIB2D_BAND_ROWS < job->dst_rows) ?
+    r0 + LIB2D_BAND_ROWS : job->dst_rows;
+
+  if (job->op == LIB2D_NATIVE_OP_TO_ARGB) {
+    lib2d_argb_rows(job, r0, r1);
+    return;
+  }
+  lib2d_rotate_rows(&job->luma, job->rotation, 1, r0, r1);
+  // dst_rows is even, so is every band start and end
+  lib2d_rotate_rows(&job->chroma, job->rotation, 2, r0 / 2, r1 / 2);
+}
+
+/**
+ * Function: lib2d_native_worker
+ *
+ * Description: Worker thread, claims bands of posted jobs until exit
+ *
+ * Input parameters:
+ *   data - native object
+ *
+ * Return values:
+ *   NULL
+ *
+ * Notes: none
+ **/
+static void *lib2d_native_worker(void *data)
+{
+  lib2d_native_obj_t *obj = (lib2d_native_obj_t *)data;
+
+  prctl(PR_SET_NAME, (unsigned long)"cam_lib2d_wk", 0, 0, 0);
+
+  pthread_mutex_lock(&obj->lock);
+  while (!obj->exit) {
+    if (obj->next_band < obj->job.num_bands) {
+      uint32_t band = obj->next_band++;
+      pthread_mutex_unlock(&obj->lock);
+      lib2d_native_run_band(&obj->job, band);
+      pthread_mutex_lock(&obj->lock);
+      if (++obj->bands_done == obj->job.num_bands) {
+        pthread_cond_signal(&obj->done_cond);
+      }
+      continue;
+    }
+    pthread_cond_wait(&obj->work_cond, &obj->lock);
+  }
+  pthread_mutex_unlock(&obj->lock);
+
+  return NULL;
+}
+
+/**
+ * Function: lib2d_native_fill_planes
+ *
+ * Description: Validates a rotation job and sets up its planes
+ *
+ * Input parameters:
+ *   job - job to fill
+ *   src - source YUV buffer
+ *   dst - destination YUV buffer
+ *   rotation - clockwise rotation
+ *
+ * Return values:
+ *   MM_LIB2D_SUCCESS
+ *   MM_LIB2D_ERR_BAD_PARAM
+ *
+ * Notes: none
+ **/
+static lib2d_error lib2d_native_fill_planes(lib2d_native_job_t *job,
+  mm_lib2d_yuv_buffer *src, mm_lib2d_yuv_buffer *dst, uint32_t rotation)
+{
+  uint32_t swap = ((rotation == 90) || (rotation == 270));
+
+  if ((rotation != 0) && (rotation != 90) && (rotation != 180) &&
+    (rotation != 270)) {
+    LOGE("rotation %d not supported", rotation);
+    return MM_LIB2D_ERR_BAD_PARAM;
+  }
+  if ((dst->format != src->format) ||
+    (dst->width != (swap ? src->height : src->width)) ||
+    (dst->height != (swap ? src->width : src->height))) {
+    LOGE("dst %dx%d fmt %d does not match src %dx%d fmt %d rotated by %d",
+      dst->width, dst->height, dst->format, src->width, src->height,
+      src->format, rotation);
+    return MM_LIB2D_ERR_BAD_PARAM;
+  }
+
+  job->op = LIB2D_NATIVE_OP_ROTATE;
+  job->rotation = rotation;
+  job->luma.src = (const uint8_t *)src->plane0;
+  job->luma.src_stride = src->stride0;
+  job->luma.dst = (uint8_t *)dst->plane0;
+  job->luma.dst_stride = dst->stride0;
+  job->luma.width = src->width;
+  job->luma.height = src->height;
+  job->chroma.src = (const uint8_t *)src->plane1;
+  job->chroma.src_stride = src->stride1;
+  job->chroma.dst = (uint8_t *)dst->plane1;
+  job->chroma.dst_stride = dst->stride1;
+  job->chroma.width = src->width / 2;
+  job->chroma.height = src->height / 2;
+  job->dst_rows = dst->height;
+
+  return MM_LIB2D_SUCCESS;
+}
+
+int mm_lib2d_native_supported(cam_format_t src_format,
+  cam_format_t dst_format)
+{
+  if ((src_format != CAM_FORMAT_YUV_420_NV12) &&
+    (src_format != CAM_FORMAT_YUV_420_NV21)) {
+    return 0;
+  }
+  return ((dst_format == src_format) ||
+    (dst_format == CAM_FORMAT_8888_ARGB));
+}
+
+lib2d_error mm_lib2d_native_init(uint32_t num_workers, void **p_handle)
+{
+  lib2d_native_obj_t *obj;
+  uint32_t i;
+
+  obj = calloc(1, sizeof(lib2d_native_obj_t));
+  if (obj == NULL) {
+    return MM_LIB2D_ERR_MEMORY;
+  }
+
+  pthread_mutex_init(&obj->job_lock, NULL);
+  pthread_mutex_init(&obj->lock, NULL);
+  pthread_cond_init(&obj->work_cond, NULL);
+  pthread_cond_init(&obj->done_cond, NULL);
+
+  if (num_workers > MM_LIB2D_NATIVE_MAX_WORKERS) {
+    num_workers = MM_LIB2D_NATIVE_MAX_WORKERS;
+  }
+  for (i = 0; i < num_workers; i++) {
+    if (pthread_create(&obj->threads[obj->num_threads], NULL,
+      lib2d_native_worker, obj) != 0) {
+      LOGW("started %d of %d workers", obj->num_threads, num_workers);
+      break;
+    }
+    obj->num_threads++;
+  }
+
+  *p_handle = obj;
+  return MM_LIB2D_SUCCESS;
+}
+
+void mm_lib2d_native_deinit(void *handle)
+{
+  lib2d_native_obj_t *obj = (lib2d_native_obj_t *)handle;
+  uint32_t i;
+
+  if (obj == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&obj->lock);
+  obj->exit = 1;
+  pthread_cond_broadcast(&obj->work_cond);
+  pthread_mutex_unlock(&obj->lock);
+  for (i = 0; i < obj->num_threads; i++) {
+    pthread_join(obj->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&obj->done_cond);
+  pthread_cond_destroy(&obj->work_cond);
+  pthread_mutex_destroy(&obj->lock);
+  pthread_mutex_destroy(&obj->job_lock);
+  free(obj);
+}
+
+lib2d_error mm_lib2d_native_process(void *handle,
+  mm_lib2d_buffer *src_buffer, mm_lib2d_buffer *dst_buffer,
+  uint32_t rotation)
+{
+  lib2d_native_obj_t *obj = (lib2d_native_obj_t *)handle;
+  mm_lib2d_yuv_buffer *src;
+  lib2d_native_job_t job;
+  lib2d_error rc;
+
+  if ((obj == NULL) || (src_buffer == NULL) || (dst_buffer == NULL) ||
+    (src_buffer->buffer_type != MM_LIB2D_BUFFER_TYPE_YUV)) {
+    return MM_LIB2D_ERR_BAD_PARAM;
+  }
+  src = &src_buffer->yuv_buffer;
+  if (!mm_lib2d_native_supported(src->format, src->format) ||
+    (src->plane0 == NULL) || (src->plane1 == NULL) ||
+    (src->width & 1) || (src->height & 1)) {
+    LOGE("src %dx%d fmt %d not supported", src->width, src->height,
+      src->format);
+    return MM_LIB2D_ERR_BAD_PARAM;
+  }
+
+  memset(&job, 0x0, sizeof(job));
+  if (dst_buffer->buffer_type == MM_LIB2D_BUFFER_TYPE_YUV) {
+    if ((dst_buffer->yuv_buffer.plane0 == NULL) ||
+      (dst_buffer->yuv_buffer.plane1 == NULL)) {
+      return MM_LIB2D_ERR_BAD_PARAM;
+    }
+    rc = lib2d_native_fill_planes(&job, src, &dst_buffer->yuv_buffer,
+      rotation);
+    if (rc != MM_LIB2D_SUCCESS) {
+      return rc;
+    }
+  } else {
+    mm_lib2d_rgb_buffer *dst = &dst_buffer->rgb_buffer;
+    if ((dst->buffer == NULL) || (rotation != 0) ||
+      (dst->width != src->width) || (dst->height != src->height)) {
+      LOGE("ARGB dst %dx%d rotation %d not supported", dst->width,
+        dst->height, rotation);
+      return MM_LIB2D_ERR_BAD_PARAM;
+    }
+    job.op = LIB2D_NATIVE_OP_TO_ARGB;
+    job.luma.src = (const uint8_t *)src->plane0;
+    job.luma.src_stride = src->stride0;
+    job.luma.dst = (uint8_t *)dst->buffer;
+    job.luma.dst_stride = dst->stride;
+    job.luma.width = src->width;
+    job.luma.height = src->height;
+    job.chroma.src = (const uint8_t *)src->plane1;
+    job.chroma.src_stride = src->stride1;
+    job.v_first = (src->format == CAM_FORMAT_YUV_420_NV21);
+    job.dst_rows = src->height;
+  }
+  job.num_bands = (job.dst_rows + LIB2D_BAND_ROWS - 1) / LIB2D_BAND_ROWS;
+
+  pthread_mutex_lock(&obj->job_lock);
+  pthread_mutex_lock(&obj->lock);
+  obj->job = job;
+  obj->next_band = 0;
+  obj->bands_done = 0;
+  pthread_cond_broadcast(&obj->work_cond);
+
+  // the caller works on the job too, then waits for bands still running
+  while (obj->next_band < obj->job.num_bands) {
+    uint32_t band = obj->next_band++;
+    pthread_mutex_unlock(&obj->lock);
+    lib2d_native_run_band(&obj->job, band);
+    pthread_mutex_lock(&obj->lock);
+    obj->bands_done++;
+  }
+  while (obj->bands_done < obj->job.num_bands) {
+    pthread_cond_wait(&obj->done_cond, &obj->lock);
+  }
+  pthread_mutex_unlock(&obj->lock);
+  pthread_mutex_unlock(&obj->job_lock);
+
+  return MM_LIB2D_SUCCESS;
+}
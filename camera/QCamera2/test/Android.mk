@@ -0,0 +1,512 @@
+LOCAL_PATH := $(call my-dir)
+
+# Benchmarks and tests of HAL pieces that run without the camera stack.
+# Code that only needs libc and libutils is built for the host; anything
+# including cam_types.h needs the msm kernel headers and is built as a
+# native test for the device. Benchmarks print their results, tests are
+# gtests.
+
+QCAMERA_TEST_C_INCLUDES := \
+        $(LOCAL_PATH)/../util \
+        $(LOCAL_PATH)/../stack/common \
+        $(LOCAL_PATH)/../stack/mm-camera-interface/inc \
+        $(LOCAL_PATH)/../../mm-image-codec/qexif \
+        $(LOCAL_PATH)/../../mm-image-codec/qomx_core \
+        $(call project-path-for,qcom-media)/mm-core/inc
+
+QCAMERA_TEST_HEADER_LIBRARIES :=
+ifeq ($(TARGET_COMPILE_WITH_MSM_KERNEL),true)
+QCAMERA_TEST_HEADER_LIBRARIES += generated_kernel_headers
+endif
+
+# Tests that build single HAL sources use the flags, paths and libraries of
+# the camera.$(TARGET_BOARD_PLATFORM) module
+QCAMERA_HAL_TEST_C_INCLUDES := \
+        $(QCAMERA_TEST_C_INCLUDES) \
+        $(LOCAL_PATH)/../include \
+        $(LOCAL_PATH)/../HAL \
+        $(LOCAL_PATH)/../HAL3 \
+        $(call project-path-for,qcom-media)/libstagefrighthw \
+        $(call project-path-for,qcom-display)/libqservice \
+        $(TARGET_OUT_HEADERS)/mm-camera-lib/cp/prebuilt
+
+QCAMERA_HAL_TEST_CFLAGS := -Wall -Wextra -Werror -Wno-unused-parameter \
+        -Wno-unused-variable -Wno-compound-token-split-by-macro \
+        -DSYSTEM_HEADER_PREFIX=sys -DHAS_MULTIMEDIA_HINTS -D_ANDROID \
+        -DDEFAULT_DENOISE_MODE_ON -DHAL3 -DQCAMERA_REDEFINE_LOG
+ifeq ($(TARGET_SUPPORT_HAL1),false)
+QCAMERA_HAL_TEST_CFLAGS += -DQCAMERA_HAL3_SUPPORT
+else
+QCAMERA_HAL_TEST_CFLAGS += -DQCAMERA_HAL1_SUPPORT
+endif
+ifneq (,$(filter msm8974 msm8916 msm8226 msm8610 msm8916 apq8084 msm8084 msm8994 msm8992 msm8952 msm8937 msm8953 msm8996 msmcobalt msmfalcon, $(TARGET_BOARD_PLATFORM)))
+QCAMERA_HAL_TEST_CFLAGS += -DVENUS_PRESENT
+endif
+ifneq (,$(filter msm8996 msmcobalt msmfalcon,$(TARGET_BOARD_PLATFORM)))
+QCAMERA_HAL_TEST_CFLAGS += -DUBWC_PRESENT
+endif
+
+QCAMERA_HAL_TEST_HEADER_LIBRARIES := \
+        $(QCAMERA_TEST_HEADER_LIBRARIES) \
+        camera_common_headers \
+        display_headers \
+        media_plugin_headers \
+        libandroid_sensor_headers \
+        libcutils_headers \
+        libsystem_headers \
+        libhardware_headers
+
+QCAMERA_HAL_TEST_SHARED_LIBRARIES := libcamera_metadata libcutils libhardware \
+        liblog libmmcamera_interface libqdMetaData libutils
+QCAMERA_HAL_TEST_STATIC_LIBRARIES := android.hardware.camera.common@1.0-helper
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_snapshot_bench
+LOCAL_SRC_FILES := QCameraSeqSnapshotBench.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../util
+LOCAL_CFLAGS := -Wall -Wextra -Werror -O2
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_frame_tracer_bench
+LOCAL_SRC_FILES := \
+        QCameraFrameTracerBench.cpp \
+        ../util/QCameraFrameTracer.cpp
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/../util \
+        $(LOCAL_PATH)/../stack/mm-camera-interface/inc
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror -O2
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_exif_builder_test
+LOCAL_SRC_FILES := \
+        QCameraExifBuilderTest.cpp \
+        ../util/QCameraExifBuilder.cpp
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_cmd_thread_test
+LOCAL_SRC_FILES := \
+        QCameraCmdThreadTest.cpp \
+        ../util/QCameraCmdThread.cpp
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror -DSYSTEM_HEADER_PREFIX=sys
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+QCAMERA_FRAME_DUMPER_SRC_FILES := \
+        ../util/QCameraFrameDumper.cpp \
+        ../util/QCameraCmdThread.cpp \
+        ../util/QCameraQueue.cpp
+
+# Builds the qcamera_dump_extract host tool in, with its main() renamed
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_frame_dumper_test
+LOCAL_SRC_FILES := \
+        QCameraFrameDumperTest.cpp \
+        ../util/qcamera_dump_extract.cpp \
+        $(QCAMERA_FRAME_DUMPER_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror -DSYSTEM_HEADER_PREFIX=sys \
+        -Dmain=qcamera_dump_extract_main
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_frame_dump_bench
+LOCAL_SRC_FILES := QCameraFrameDumpBench.cpp $(QCAMERA_FRAME_DUMPER_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror -DSYSTEM_HEADER_PREFIX=sys -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+QCAMERA_TASK_GRAPH_SRC_FILES := \
+        ../util/QCameraTaskGraph.cpp \
+        ../util/QCameraCmdThread.cpp
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_task_graph_test
+LOCAL_SRC_FILES := QCameraTaskGraphTest.cpp $(QCAMERA_TASK_GRAPH_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror -DSYSTEM_HEADER_PREFIX=sys
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_task_graph_bench
+LOCAL_SRC_FILES := QCameraTaskGraphBench.cpp $(QCAMERA_TASK_GRAPH_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror -DSYSTEM_HEADER_PREFIX=sys -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+# Replaces clock_gettime() for the process CPU clock and property_get()
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_power_governor_test
+LOCAL_SRC_FILES := \
+        QCameraPowerGovernorTest.cpp \
+        ../HAL/QCameraPowerGovernor.cpp
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/../HAL \
+        $(LOCAL_PATH)/../util \
+        $(LOCAL_PATH)/../stack/mm-camera-interface/inc
+LOCAL_HEADER_LIBRARIES := libhardware_headers
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils
+LOCAL_CFLAGS := -Wall -Wextra -Werror
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_NATIVE_TEST)
+
+QCAMERA_LIB2D_NATIVE_SRC_FILES := \
+        ../stack/mm-lib2d-interface/src/mm_lib2d_native.c \
+        mm_lib2d_native_c.c
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_lib2d_native_test
+LOCAL_SRC_FILES := \
+        QCameraLib2dNativeTest.cpp \
+        $(QCAMERA_LIB2D_NATIVE_SRC_FILES)
+LOCAL_C_INCLUDES := \
+        $(QCAMERA_TEST_C_INCLUDES) \
+        $(LOCAL_PATH)/../stack/mm-lib2d-interface/inc
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils libmmcamera_interface
+LOCAL_CFLAGS := -Wall -Wextra -Werror -Wno-unused-parameter \
+        -D_ANDROID_ -DQCAMERA_REDEFINE_LOG
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_lib2d_native_bench
+LOCAL_SRC_FILES := \
+        QCameraLib2dNativeBench.cpp \
+        $(QCAMERA_LIB2D_NATIVE_SRC_FILES)
+LOCAL_C_INCLUDES := \
+        $(QCAMERA_TEST_C_INCLUDES) \
+        $(LOCAL_PATH)/../stack/mm-lib2d-interface/inc
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libutils libmmcamera_interface
+LOCAL_CFLAGS := -Wall -Wextra -Werror -Wno-unused-parameter -O2 \
+        -D_ANDROID_ -DQCAMERA_REDEFINE_LOG
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+QCAMERA_MPO_SRC_FILES := \
+        QCameraMpoSample.cpp \
+        ../stack/mm-jpeg-interface/src/mm_jpeg_mpo_composer.c
+QCAMERA_MPO_C_INCLUDES := \
+        $(QCAMERA_TEST_C_INCLUDES) \
+        $(LOCAL_PATH)/../stack/mm-jpeg-interface/inc
+QCAMERA_MPO_CFLAGS := -Wall -Wextra -Werror -Wno-unused-parameter \
+        -Wno-compound-token-split-by-macro -DSYSTEM_HEADER_PREFIX=sys \
+        -D_ANDROID_ -DQCAMERA_REDEFINE_LOG
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_mpo_compose_test
+LOCAL_SRC_FILES := \
+        QCameraMpoComposeTest.cpp \
+        $(QCAMERA_MPO_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_MPO_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES) libutils_headers
+LOCAL_SHARED_LIBRARIES := libcutils liblog libmmcamera_interface
+LOCAL_CFLAGS := $(QCAMERA_MPO_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_mpo_compose_bench
+LOCAL_SRC_FILES := \
+        QCameraMpoComposeBench.cpp \
+        $(QCAMERA_MPO_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_MPO_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES) libutils_headers
+LOCAL_SHARED_LIBRARIES := libcutils liblog libmmcamera_interface
+LOCAL_CFLAGS := $(QCAMERA_MPO_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+# mm_camera_interface.c on fake camera objects, built with the flags of
+# libmmcamera_interface
+QCAMERA_INTF_FAKE_SRC_FILES := mm_camera_interface_fake.c
+QCAMERA_INTF_FAKE_CFLAGS := -Wall -Wextra -Werror -Wno-compound-token-split-by-macro \
+        -DSYSTEM_HEADER_PREFIX=sys -D_ANDROID_ -DQCAMERA_REDEFINE_LOG
+QCAMERA_INTF_FAKE_HEADER_LIBRARIES := \
+        $(QCAMERA_TEST_HEADER_LIBRARIES) \
+        libhardware_headers \
+        camera_common_headers \
+        media_plugin_headers
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_intf_fast_user_test
+LOCAL_SRC_FILES := \
+        QCameraIntfFastUserTest.cpp \
+        $(QCAMERA_INTF_FAKE_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_INTF_FAKE_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libmmcamera_interface
+LOCAL_CFLAGS := $(QCAMERA_INTF_FAKE_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_intf_contention_bench
+LOCAL_SRC_FILES := \
+        QCameraIntfContentionBench.cpp \
+        $(QCAMERA_INTF_FAKE_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_INTF_FAKE_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := libcutils liblog libmmcamera_interface
+LOCAL_CFLAGS := $(QCAMERA_INTF_FAKE_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+# Needs gralloc, ion and the camera buffer heaps of the device
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_gralloc_index_bench
+LOCAL_SRC_FILES := \
+        QCamera3GrallocIndexBench.cpp \
+        ../HAL3/QCamera3Mem.cpp
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+QCAMERA_REPROC_META_SRC_FILES := \
+        ../HAL3/QCamera3ReprocMeta.cpp \
+        ../HAL3/QCamera3StreamMem.cpp \
+        ../HAL3/QCamera3Mem.cpp
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_reproc_meta_test
+LOCAL_SRC_FILES := QCamera3ReprocMetaTest.cpp $(QCAMERA_REPROC_META_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_reproc_meta_bench
+LOCAL_SRC_FILES := QCamera3ReprocMetaBench.cpp $(QCAMERA_REPROC_META_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+QCAMERA_PP_JOIN_SRC_FILES := \
+        ../HAL3/QCamera3PPJoin.cpp \
+        ../util/QCameraQueue.cpp
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_pp_join_test
+LOCAL_SRC_FILES := QCamera3PPJoinTest.cpp $(QCAMERA_PP_JOIN_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_pp_join_bench
+LOCAL_SRC_FILES := QCamera3PPJoinBench.cpp $(QCAMERA_PP_JOIN_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+# Replace property_get() of libcutils, see QCameraParametersReplay.cpp
+ifneq ($(TARGET_SUPPORT_HAL1),false)
+QCAMERA_PARAM_REPLAY_SRC_FILES := \
+        QCameraParametersReplay.cpp \
+        ../HAL/QCameraParameters.cpp \
+        ../HAL/QCameraMem.cpp \
+        ../util/QCameraBufferMaps.cpp \
+        ../util/QCameraCommon.cpp
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_parameters_test
+LOCAL_SRC_FILES := \
+        QCameraParametersTest.cpp \
+        $(QCAMERA_PARAM_REPLAY_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_parameters_replay_bench
+LOCAL_SRC_FILES := \
+        QCameraParametersReplayBench.cpp \
+        $(QCAMERA_PARAM_REPLAY_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+QCAMERA_EVT_BUNDLE_SRC_FILES := \
+        ../HAL/QCameraEvtBundlePool.cpp \
+        ../util/QCameraQueue.cpp
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_evt_bundle_test
+LOCAL_SRC_FILES := QCameraEvtBundlePoolTest.cpp $(QCAMERA_EVT_BUNDLE_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_evt_bundle_bench
+LOCAL_SRC_FILES := QCameraEvtBundlePoolBench.cpp $(QCAMERA_EVT_BUNDLE_SRC_FILES)
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS) -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+# Replaces the few QCamera2HardwareInterface calls of the notifier thread
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera_cb_notifier_test
+LOCAL_SRC_FILES := \
+        QCameraCbNotifierTest.cpp \
+        ../HAL/QCameraCbNotifier.cpp \
+        ../util/QCameraCmdThread.cpp \
+        ../util/QCameraQueue.cpp
+LOCAL_C_INCLUDES := $(QCAMERA_HAL_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_HAL_TEST_HEADER_LIBRARIES)
+LOCAL_SHARED_LIBRARIES := $(QCAMERA_HAL_TEST_SHARED_LIBRARIES)
+LOCAL_STATIC_LIBRARIES := $(QCAMERA_HAL_TEST_STATIC_LIBRARIES)
+LOCAL_CFLAGS := $(QCAMERA_HAL_TEST_CFLAGS)
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+endif
+
+# Run on the virtual sensor backend of mm-camera-interface
+ifeq ($(TARGET_CAMERA_VIRTUAL_SENSOR),true)
+ifneq ($(TARGET_BUILD_VARIANT),user)
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_virtual_bench
+LOCAL_SRC_FILES := QCamera3VirtualBench.cpp
+LOCAL_SHARED_LIBRARIES := libcamera_metadata libcutils libhardware liblog
+LOCAL_HEADER_LIBRARIES := libhardware_headers
+LOCAL_CFLAGS := -Wall -Wextra -Werror -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_stream_map_test
+LOCAL_SRC_FILES := QCamera3StreamMapTest.cpp
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES) libhardware_headers
+LOCAL_SHARED_LIBRARIES := libcutils liblog libmmcamera_interface
+LOCAL_CFLAGS := -Wall -Wextra -Werror
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := qcamera3_stream_reuse_test
+LOCAL_SRC_FILES := QCamera3StreamReuseTest.cpp
+LOCAL_C_INCLUDES := $(QCAMERA_TEST_C_INCLUDES)
+LOCAL_HEADER_LIBRARIES := $(QCAMERA_TEST_HEADER_LIBRARIES) libhardware_headers
+LOCAL_SHARED_LIBRARIES := libcamera_metadata libcutils libhardware liblog \
+        libmmcamera_interface
+LOCAL_CFLAGS := -Wall -Wextra -Werror
+LOCAL_VENDOR_MODULE := true
+LOCAL_32_BIT_ONLY := $(BOARD_QTI_CAMERA_32BIT_ONLY)
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_NATIVE_TEST)
+endif
+endif
@@ -0,0 +1,322 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Benchmark of the buffer index lookups of QCamera3GrallocMemory.
+ *
+ * A processing channel looks its gralloc buffers up by handle on every
+ * request (getMatchBufIndex, markFrameNumber) and by frame number on every
+ * result (getBufferIndex, getFrameNumber, getOldestFrameNumber, then
+ * markFrameNumber -1 to release the buffer). This replays that sequence
+ * on registered gralloc buffers through QCamera3GrallocMemory and through
+ * a copy of the slot scans it used before the lookup tables, for
+ *   -  30 fps preview,   8 buffers, 6 requests in flight
+ *   - 240 fps HFR video, MAX_INFLIGHT_HFR_REQUESTS buffers, batches of 8
+ * and prints the lookup cost per frame, also in % of the frame period,
+ * and the registerBuffer / unregisterBuffers cost per buffer (the ion
+ * import and mmap included). The oldest frame number reported by
+ * QCamera3GrallocMemory is checked against the replayed sequence.
+ *
+ * usage: qcamera3_gralloc_index_bench [frames] [register_rounds] */
+
+// System dependencies
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <utils/Errors.h>
+#include <vector>
+
+// Camera dependencies
+#include "hardware/gralloc.h"
+#include "QCamera3Mem.h"
+
+using namespace qcamera;
+
+typedef struct {
+    const char *name;
+    uint32_t fps;
+    uint32_t width;
+    uint32_t height;
+    uint32_t buffers;
+    uint32_t inflight;      // requests not yet completed
+    uint32_t batch;         // requests submitted and completed together
+} bench_case_t;
+
+static const bench_case_t gCases[] = {
+    { " 30 fps preview",   30, 1920, 1080, 8, 6, 1 },
+    { "240 fps HFR video", 240, 1280, 720, MAX_INFLIGHT_HFR_REQUESTS,
+            MAX_INFLIGHT_HFR_REQUESTS - 8, 8 },
+};
+
+/* Buffer bookkeeping of QCamera3GrallocMemory before the lookup tables,
+ * every query scans the slots */
+class LegacyGrallocIndex {
+public:
+    LegacyGrallocIndex() : mBufferCount(0)
+    {
+        for (uint32_t i = 0; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
+            mBufferHandle[i] = NULL;
+            mRegistered[i] = false;
+            mCurrentFrameNumbers[i] = -1;
+        }
+    }
+
+    int registerBuffer(buffer_handle_t *buffer)
+    {
+        if (0 <= getMatchBufIndex(buffer)) {
+            return ALREADY_EXISTS;
+        }
+        Mutex::Autolock lock(mLock);
+        int idx = -1;
+        for (uint32_t i = 0; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
+            if (!mRegistered[i]) {
+                idx = (int)i;
+                break;
+            }
+        }
+        if (0 > idx) {
+            return BAD_INDEX;
+        }
+        mBufferHandle[idx] = buffer;
+        mRegistered[idx] = true;
+        mBufferCount++;
+        return NO_ERROR;
+    }
+
+    int getMatchBufIndex(buffer_handle_t *key)
+    {
+        Mutex::Autolock lock(mLock);
+        for (uint32_t i = 0; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
+            if (mBufferHandle[i] == key) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    int32_t markFrameNumber(uint32_t index, uint32_t frameNumber)
+    {
+        Mutex::Autolock lock(mLock);
+        if (!mRegistered[index]) {
+            return BAD_INDEX;
+        }
+        mCurrentFrameNumbers[index] = (int32_t)frameNumber;
+        return NO_ERROR;
+    }
+
+    int32_t getFrameNumber(uint32_t index)
+    {
+        Mutex::Autolock lock(mLock);
+        return mRegistered[index] ? mCurrentFrameNumbers[index] : -1;
+    }
+
+    int32_t getOldestFrameNumber(uint32_t &bufIndex)
+    {
+        int32_t oldest = -1;
+        for (uint32_t i = 0; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
+            if (mRegistered[i] && (mCurrentFrameNumbers[i] != -1) &&
+                    ((oldest == -1) || (oldest > mCurrentFrameNumbers[i]))) {
+                oldest = mCurrentFrameNumbers[i];
+                bufIndex = i;
+            }
+        }
+        return oldest;
+    }
+
+    int32_t getBufferIndex(uint32_t frameNumber)
+    {
+        for (uint32_t i = 0; i < MM_CAMERA_MAX_NUM_FRAMES; i++) {
+            if (mRegistered[i] &&
+                    (mCurrentFrameNumbers[i] == (int32_t)frameNumber)) {
+                return (int32_t)i;
+            }
+        }
+        return -1;
+    }
+
+private:
+    buffer_handle_t *mBufferHandle[MM_CAMERA_MAX_NUM_FRAMES];
+    bool mRegistered[MM_CAMERA_MAX_NUM_FRAMES];
+    int32_t mCurrentFrameNumbers[MM_CAMERA_MAX_NUM_FRAMES];
+    uint32_t mBufferCount;
+    Mutex mLock;
+};
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+/* Replays the request and result lookups of a channel over 'frames'
+ * frames, returns the number of wrong oldest frame numbers */
+template <typename Index>
+static uint32_t replay(Index &index, std::vector<buffer_handle_t> &handles,
+        const bench_case_t &c, uint32_t frames, bool check)
+{
+    uint32_t errors = 0;
+    uint32_t completed = 0;
+
+    for (uint32_t submitted = 0; submitted < frames; ) {
+        for (uint32_t b = 0; b < c.batch; b++, submitted++) {
+            buffer_handle_t *buffer = &handles[submitted % handles.size()];
+            int idx = index.getMatchBufIndex(buffer);
+            if (0 > idx) {
+                return frames;
+            }
+            index.markFrameNumber((uint32_t)idx, submitted);
+        }
+        while (submitted - completed > c.inflight) {
+            for (uint32_t b = 0; b < c.batch; b++, completed++) {
+                uint32_t oldestIdx = 0;
+                int32_t idx = index.getBufferIndex(completed);
+                if (0 > idx) {
+                    return frames;
+                }
+                int32_t frameNumber = index.getFrameNumber((uint32_t)idx);
+                int32_t oldest = index.getOldestFrameNumber(oldestIdx);
+                if (check && ((oldest != frameNumber) ||
+                        (oldestIdx != (uint32_t)idx))) {
+                    errors++;
+                }
+                index.markFrameNumber((uint32_t)idx, (uint32_t)-1);
+            }
+        }
+    }
+    return errors;
+}
+
+static int run(alloc_device_t *alloc, const bench_case_t &c, uint32_t frames,
+        uint32_t rounds)
+{
+    std::vector<buffer_handle_t> handles;
+    int64_t registerNs = 0, unregisterNs = 0, lookupNs, legacyNs;
+    uint32_t errors = 0;
+    int rc = -1;
+
+    for (uint32_t i = 0; i < c.buffers; i++) {
+        buffer_handle_t handle = NULL;
+        int stride = 0;
+        if (alloc->alloc(alloc, (int)c.width, (int)c.height,
+                HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED,
+                GRALLOC_USAGE_HW_CAMERA_WRITE | GRALLOC_USAGE_HW_VIDEO_ENCODER,
+                &handle, &stride) != 0) {
+            fprintf(stderr, "gralloc alloc failed\n");
+            goto done;
+        }
+        handles.push_back(handle);
+    }
+
+    {
+        QCamera3GrallocMemory memory(0);
+        for (uint32_t r = 0; r < rounds; r++) {
+            int64_t startNs = now_ns();
+            for (size_t i = 0; i < handles.size(); i++) {
+                if (memory.registerBuffer(&handles[i], CAM_STREAM_TYPE_VIDEO) != NO_ERROR) {
+                    fprintf(stderr, "registerBuffer %zu failed\n", i);
+                    memory.unregisterBuffers();
+                    goto done;
+                }
+            }
+            registerNs += now_ns() - startNs;
+            if (r + 1 < rounds) {
+                startNs = now_ns();
+                memory.unregisterBuffers();
+                unregisterNs += now_ns() - startNs;
+            }
+        }
+
+        // Warm up, then measure
+        errors = replay(memory, handles, c, c.buffers * 4, true);
+        lookupNs = now_ns();
+        errors += replay(memory, handles, c, frames, true);
+        lookupNs = now_ns() - lookupNs;
+
+        int64_t startNs = now_ns();
+        memory.unregisterBuffers();
+        unregisterNs += now_ns() - startNs;
+    }
+
+    {
+        LegacyGrallocIndex legacy;
+        for (size_t i = 0; i < handles.size(); i++) {
+            legacy.registerBuffer(&handles[i]);
+        }
+        replay(legacy, handles, c, c.buffers * 4, false);
+        legacyNs = now_ns();
+        replay(legacy, handles, c, frames, false);
+        legacyNs = now_ns() - legacyNs;
+    }
+
+    printf("%s, %2u buffers: register %.1f us, unregister %.1f us per buffer\n"
+            "    lookups %.0f ns/frame (%.4f%% of the frame period), "
+            "slot scans %.0f ns/frame (%.4f%%), %u wrong oldest frames\n",
+            c.name, c.buffers,
+            registerNs / 1e3 / rounds / c.buffers,
+            unregisterNs / 1e3 / rounds / c.buffers,
+            (double)lookupNs / frames, lookupNs * 100.0 * c.fps / 1e9 / frames,
+            (double)legacyNs / frames, legacyNs * 100.0 * c.fps / 1e9 / frames,
+            errors);
+    rc = (errors == 0) ? 0 : -1;
+
+done:
+    for (size_t i = 0; i < handles.size(); i++) {
+        alloc->free(alloc, handles[i]);
+    }
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 100000;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 20;
+    const hw_module_t *module = NULL;
+    alloc_device_t *alloc = NULL;
+    int rc = 0;
+
+    if ((frames <= 0) || (rounds <= 0)) {
+        fprintf(stderr, "usage: %s [frames] [register_rounds]\n", argv[0]);
+        return 2;
+    }
+    if ((hw_get_module(GRALLOC_HARDWARE_MODULE_ID, &module) != 0) ||
+            (gralloc_open(module, &alloc) != 0)) {
+        fprintf(stderr, "FAIL: no gralloc\n");
+        return 1;
+    }
+
+    printf("%d frames, %d register rounds\n", frames, rounds);
+    for (size_t i = 0; i < sizeof(gCases) / sizeof(gCases[0]); i++) {
+        if (run(alloc, gCases[i], (uint32_t)frames, (uint32_t)rounds) != 0) {
+            fprintf(stderr, "FAIL:%s\n", gCases[i].name);
+            rc = 1;
+        }
+    }
+    gralloc_close(alloc);
+    return rc;
+}
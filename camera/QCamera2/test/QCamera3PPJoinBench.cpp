@@ -0,0 +1,391 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Burst simulation of the join stage of the HAL3 postprocessor.
+ *
+ * A frame thread and a metadata thread deliver the pieces of a burst of
+ * reprocess requests at a fixed frame interval, each in frame number order
+ * and each losing a piece now and then, the way the pic channel and the HWI
+ * call processData and processPPMetadata. Both join under one lock like
+ * mReprocJobLock. A data proc thread dequeues the joined requests at the
+ * reprocess rate and, as DO_NEXT_JOB does, takes the dropped requests and
+ * returns them. The burst runs with the reprocess time below, at and above
+ * the frame interval, so that each drop path is hit: the sweep of requests
+ * that lost a piece and, once reprocess falls behind, the full input queue.
+ *
+ * Prints per run the requests processed and dropped with and without their
+ * frame, the average and max time a join call holds the lock, the average
+ * time from the first piece of a request until reprocess starts and the
+ * average time from a drop until the request is returned. Fails if a frame
+ * or metadata buffer is leaked or released twice.
+ *
+ * usage: qcamera3_pp_join_bench [requests] [frame_interval_us] [loss_pct] */
+
+// System dependencies
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCamera3PPJoin.h"
+
+using namespace android;
+using namespace qcamera;
+
+static const uint32_t gReprocPct[] = { 50, 100, 150, 300 };
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadlineNs)
+{
+    int64_t left = deadlineNs - now_ns();
+    if (left > 0) {
+        usleep((useconds_t)(left / 1000));
+    }
+}
+
+class JoinBench {
+public:
+    JoinBench(uint32_t requests, uint32_t intervalUs, uint32_t lossPct,
+            uint32_t reprocUs) :
+            mRequests(requests),
+            mIntervalUs(intervalUs),
+            mLossPct(lossPct),
+            mReprocUs(reprocUs),
+            mTable(release, this),
+            mReadyQ(releaseReady, this),
+            mFirstNs(requests),
+            mDropNs(requests, 0),
+            mProducersDone(0),
+            mAllocated(0),
+            mReleased(0),
+            mProcessed(0),
+            mDroppedWithFrame(0),
+            mDroppedWithoutFrame(0),
+            mReturnedNs(0),
+            mJoinCalls(0),
+            mJoinNs(0),
+            mJoinMaxNs(0),
+            mWaitNs(0)
+    {
+        pthread_mutex_init(&mLock, NULL);
+        pthread_cond_init(&mCond, NULL);
+        for (uint32_t i = 0; i < requests; i++) {
+            mFirstNs[i] = 0;
+        }
+    }
+
+    ~JoinBench()
+    {
+        pthread_cond_destroy(&mCond);
+        pthread_mutex_destroy(&mLock);
+    }
+
+    int run()
+    {
+        pthread_t frameTh, metaTh, procTh;
+        int64_t startNs = now_ns() + 1000000LL;
+        mStartNs = startNs;
+        pthread_create(&procTh, NULL, dataProcRoutine, this);
+        pthread_create(&frameTh, NULL, frameRoutine, this);
+        pthread_create(&metaTh, NULL, metaRoutine, this);
+        pthread_join(frameTh, NULL);
+        pthread_join(metaTh, NULL);
+        pthread_join(procTh, NULL);
+
+        // STOP_DATA_PROC: whatever is still waiting is flushed, not reported
+        pthread_mutex_lock(&mLock);
+        uint32_t leftover = (uint32_t)mTable.size();
+        mTable.flush();
+        pthread_mutex_unlock(&mLock);
+        mReadyQ.flush();
+        returnDropped();
+
+        uint32_t dropped = mDroppedWithFrame + mDroppedWithoutFrame;
+        printf("reprocess %5u us: processed %5u, dropped %4u with frame %4u "
+                "without %4u, flushed %2u, join %5.2f us avg %6.2f us max, "
+                "to reprocess %7.1f us, drop to return %7.1f us\n",
+                mReprocUs, mProcessed.load(), dropped, mDroppedWithFrame,
+                mDroppedWithoutFrame, leftover,
+                mJoinNs / 1e3 / (mJoinCalls ? mJoinCalls : 1), mJoinMaxNs / 1e3,
+                mWaitNs / 1e3 / (mProcessed ? mProcessed.load() : 1),
+                mReturnedNs / 1e3 / (dropped ? dropped : 1));
+
+        if (mAllocated != mReleased) {
+            fprintf(stderr, "%u buffers allocated, %u released\n",
+                    mAllocated.load(), mReleased.load());
+            return -1;
+        }
+        return 0;
+    }
+
+private:
+    static mm_camera_super_buf_t *newInput(uint32_t bufIdx)
+    {
+        mm_camera_super_buf_t *input =
+                (mm_camera_super_buf_t *)calloc(1, sizeof(mm_camera_super_buf_t));
+        mm_camera_buf_def_t *buf =
+                (mm_camera_buf_def_t *)calloc(1, sizeof(mm_camera_buf_def_t));
+        buf->buf_idx = bufIdx;
+        input->num_bufs = 1;
+        input->bufs[0] = buf;
+        return input;
+    }
+
+    void freeInput(mm_camera_super_buf_t *input)
+    {
+        if (NULL != input) {
+            free(input->bufs[0]);
+            free(input);
+            mReleased++;
+        }
+    }
+
+    void releaseEntry(qcamera_hal3_pp_join_t &entry)
+    {
+        if (NULL != entry.pp_buffer) {
+            freeInput(entry.pp_buffer->input);
+            free(entry.pp_buffer);
+        }
+        freeInput(entry.metadata);
+        memset(&entry, 0, sizeof(entry));
+    }
+
+    static void release(qcamera_hal3_pp_join_t &entry, void *userData)
+    {
+        ((JoinBench *)userData)->releaseEntry(entry);
+    }
+
+    /* The queue frees the node data itself */
+    static void releaseReady(void *data, void *userData)
+    {
+        ((JoinBench *)userData)->releaseEntry(*(qcamera_hal3_pp_join_t *)data);
+    }
+
+    void markFirst(uint32_t frameNumber)
+    {
+        int64_t expected = 0;
+        mFirstNs[frameNumber].compare_exchange_strong(expected, now_ns());
+    }
+
+    /* One piece of a request joins, under the lock as in processData */
+    void deliver(uint32_t frameNumber, bool isFrame)
+    {
+        markFirst(frameNumber);
+        mm_camera_super_buf_t *input = newInput(frameNumber);
+        mAllocated++;
+
+        pthread_mutex_lock(&mLock);
+        int64_t t = now_ns();
+        qcamera_hal3_pp_join_t &entry = mTable.getEntry(frameNumber);
+        if (isFrame) {
+            qcamera_hal3_pp_buffer_t *pp_buffer = (qcamera_hal3_pp_buffer_t *)
+                    calloc(1, sizeof(qcamera_hal3_pp_buffer_t));
+            pp_buffer->input = input;
+            pp_buffer->frameNumber = frameNumber;
+            entry.pp_buffer = pp_buffer;
+        } else {
+            entry.metadata = input;
+        }
+        bool queued = mTable.join(frameNumber, mReadyQ);
+        bool dropped = mTable.hasDropped();
+        int64_t held = now_ns() - t;
+        mJoinCalls++;
+        mJoinNs += held;
+        if (held > mJoinMaxNs) {
+            mJoinMaxNs = held;
+        }
+        if (dropped) {
+            int64_t dropNs = now_ns();
+            Vector<qcamera_hal3_pp_dropped_t> list;
+            // time stamp the drops, the data proc thread returns them
+            mTable.takeDropped(list);
+            for (size_t i = 0; i < list.size(); i++) {
+                if (0 == mDropNs[list[i].frameNumber]) {
+                    mDropNs[list[i].frameNumber] = dropNs;
+                }
+            }
+            mPending.appendVector(list);
+        }
+        pthread_mutex_unlock(&mLock);
+
+        if (queued || dropped) {
+            pthread_cond_signal(&mCond);
+        }
+    }
+
+    void produce(bool isFrame)
+    {
+        unsigned int seed = isFrame ? 1 : 2;
+        for (uint32_t f = 0; f < mRequests; f++) {
+            sleep_until(mStartNs + (int64_t)f * mIntervalUs * 1000LL);
+            if ((uint32_t)(rand_r(&seed) % 100) < mLossPct) {
+                continue;
+            }
+            deliver(f, isFrame);
+        }
+        pthread_mutex_lock(&mLock);
+        mProducersDone++;
+        pthread_mutex_unlock(&mLock);
+        pthread_cond_signal(&mCond);
+    }
+
+    static void *frameRoutine(void *data)
+    {
+        ((JoinBench *)data)->produce(true);
+        return NULL;
+    }
+
+    static void *metaRoutine(void *data)
+    {
+        ((JoinBench *)data)->produce(false);
+        return NULL;
+    }
+
+    /* returnDroppedRequests: the channel recycles the frame and fails the
+     * request, here the frame is freed */
+    void returnDropped()
+    {
+        Vector<qcamera_hal3_pp_dropped_t> list;
+        pthread_mutex_lock(&mLock);
+        list = mPending;
+        mPending.clear();
+        pthread_mutex_unlock(&mLock);
+
+        int64_t t = now_ns();
+        for (size_t i = 0; i < list.size(); i++) {
+            if (NULL != list[i].input) {
+                mDroppedWithFrame++;
+            } else {
+                mDroppedWithoutFrame++;
+            }
+            mReturnedNs += t - mDropNs[list[i].frameNumber];
+            freeInput(list[i].input);
+        }
+    }
+
+    void dataProc()
+    {
+        for (;;) {
+            pthread_mutex_lock(&mLock);
+            while ((mProducersDone < 2) && mReadyQ.isEmpty() && mPending.isEmpty()) {
+                pthread_cond_wait(&mCond, &mLock);
+            }
+            bool done = (mProducersDone == 2);
+            pthread_mutex_unlock(&mLock);
+
+            // DO_NEXT_JOB: return the dropped requests first
+            returnDropped();
+
+            qcamera_hal3_pp_join_t *input =
+                    (qcamera_hal3_pp_join_t *)mReadyQ.dequeue();
+            if (NULL == input) {
+                if (done) {
+                    break;
+                }
+                continue;
+            }
+            mWaitNs += now_ns() - mFirstNs[input->pp_buffer->frameNumber];
+            usleep(mReprocUs);
+            releaseEntry(*input);
+            free(input);
+            mProcessed++;
+        }
+    }
+
+    static void *dataProcRoutine(void *data)
+    {
+        ((JoinBench *)data)->dataProc();
+        return NULL;
+    }
+
+    uint32_t mRequests;
+    uint32_t mIntervalUs;
+    uint32_t mLossPct;
+    uint32_t mReprocUs;
+    int64_t mStartNs;
+
+    pthread_mutex_t mLock;                      // mReprocJobLock
+    pthread_cond_t mCond;
+    QCamera3PPJoinTable mTable;
+    QCameraQueue mReadyQ;
+    Vector<qcamera_hal3_pp_dropped_t> mPending; // dropped, not yet returned
+    std::vector<std::atomic<int64_t> > mFirstNs;
+    std::vector<int64_t> mDropNs;
+    uint32_t mProducersDone;
+
+    std::atomic<uint32_t> mAllocated;
+    std::atomic<uint32_t> mReleased;
+    std::atomic<uint32_t> mProcessed;
+    uint32_t mDroppedWithFrame;
+    uint32_t mDroppedWithoutFrame;
+    int64_t mReturnedNs;
+    uint32_t mJoinCalls;
+    int64_t mJoinNs;
+    int64_t mJoinMaxNs;
+    int64_t mWaitNs;
+};
+
+int main(int argc, char *argv[])
+{
+    int requests = (argc > 1) ? atoi(argv[1]) : 300;
+    int intervalUs = (argc > 2) ? atoi(argv[2]) : 2000;
+    int lossPct = (argc > 3) ? atoi(argv[3]) : 3;
+    int rc = 0;
+
+    if ((requests <= 0) || (intervalUs <= 0) || (lossPct < 0) || (lossPct > 100)) {
+        fprintf(stderr, "usage: %s [requests] [frame_interval_us] [loss_pct]\n",
+                argv[0]);
+        return 2;
+    }
+    printf("%d requests every %d us, %d%% of frames and of metadata lost, "
+            "join table %d, input queue %d\n", requests, intervalUs, lossPct,
+            MAX_HAL3_PP_JOIN_ENTRIES, MAX_HAL3_PP_INPUT_DEPTH);
+    for (size_t i = 0; i < sizeof(gReprocPct) / sizeof(gReprocPct[0]); i++) {
+        JoinBench bench((uint32_t)requests, (uint32_t)intervalUs, (uint32_t)lossPct,
+                (uint32_t)intervalUs * gReprocPct[i] / 100);
+        if (bench.run() != 0) {
+            fprintf(stderr, "FAIL: reprocess at %u%% of the frame interval\n",
+                    gReprocPct[i]);
+            rc = 1;
+        }
+    }
+    return rc;
+}
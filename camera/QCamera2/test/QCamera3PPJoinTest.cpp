@@ -0,0 +1,356 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Unit tests of the join stage of the HAL3 postprocessor, QCamera3PPJoin.
+ *
+ * Frames, metadata and jpeg settings are fed by frame number the way the
+ * pic and YUV channels feed processData, processPPMetadata and
+ * processJpegSettingData. Each drop path is driven on its own: the
+ * eviction of the oldest entry from a full table, the sweep of older
+ * requests that never got their frame or metadata, the drop of the oldest
+ * queued request from a full reprocess queue and a stopped queue. Dropped
+ * requests must be reported exactly once, with their input frame when it
+ * came, and every buffer must be released exactly once. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+
+// Camera dependencies
+#include "QCamera3PPJoin.h"
+
+using namespace android;
+using namespace qcamera;
+
+class QCamera3PPJoinTest : public ::testing::Test {
+protected:
+    QCamera3PPJoinTest() :
+            mTable(release, this),
+            mReadyQ(releaseReady, this),
+            mReleasedFrames(0),
+            mReleasedMeta(0),
+            mReleasedSettings(0)
+    {
+    }
+
+    virtual ~QCamera3PPJoinTest()
+    {
+        mReadyQ.flush();
+        mTable.flush();
+        Vector<qcamera_hal3_pp_dropped_t> dropped;
+        mTable.takeDropped(dropped);
+        for (size_t i = 0; i < dropped.size(); i++) {
+            freeInput(dropped[i].input);
+        }
+    }
+
+    static mm_camera_super_buf_t *newInput(uint32_t bufIdx)
+    {
+        mm_camera_super_buf_t *input =
+                (mm_camera_super_buf_t *)calloc(1, sizeof(mm_camera_super_buf_t));
+        mm_camera_buf_def_t *buf =
+                (mm_camera_buf_def_t *)calloc(1, sizeof(mm_camera_buf_def_t));
+        buf->buf_idx = bufIdx;
+        input->num_bufs = 1;
+        input->bufs[0] = buf;
+        return input;
+    }
+
+    static void freeInput(mm_camera_super_buf_t *input)
+    {
+        if (NULL != input) {
+            free(input->bufs[0]);
+            free(input);
+        }
+    }
+
+    /* processData */
+    void addFrame(uint32_t frameNumber)
+    {
+        qcamera_hal3_pp_buffer_t *pp_buffer =
+                (qcamera_hal3_pp_buffer_t *)calloc(1, sizeof(qcamera_hal3_pp_buffer_t));
+        pp_buffer->input = newInput(frameNumber);
+        pp_buffer->frameNumber = frameNumber;
+        qcamera_hal3_pp_join_t &entry = mTable.getEntry(frameNumber);
+        ASSERT_TRUE(NULL == entry.pp_buffer);
+        entry.pp_buffer = pp_buffer;
+        mTable.join(frameNumber, mReadyQ);
+    }
+
+    /* processPPMetadata */
+    void addMeta(uint32_t frameNumber)
+    {
+        qcamera_hal3_pp_join_t &entry = mTable.getEntry(frameNumber);
+        ASSERT_TRUE(NULL == entry.metadata);
+        entry.metadata = newInput(frameNumber);
+        mTable.join(frameNumber, mReadyQ);
+    }
+
+    /* processJpegSettingData */
+    void addSettings(uint32_t frameNumber)
+    {
+        qcamera_hal3_pp_join_t &entry = mTable.getEntry(frameNumber);
+        ASSERT_TRUE(NULL == entry.jpeg_settings);
+        entry.jpeg_settings = (jpeg_settings_t *)calloc(1, sizeof(jpeg_settings_t));
+        entry.jpeg_settings->out_buf_index = frameNumber;
+    }
+
+    /* Reported drops as frame number -> whether the frame came with it.
+     * The inputs must be the frames of the dropped requests. */
+    void takeDropped(std::set<uint32_t> &withFrame, std::set<uint32_t> &withoutFrame)
+    {
+        Vector<qcamera_hal3_pp_dropped_t> dropped;
+        mTable.takeDropped(dropped);
+        EXPECT_FALSE(mTable.hasDropped());
+        for (size_t i = 0; i < dropped.size(); i++) {
+            std::set<uint32_t> &set = (NULL != dropped[i].input) ?
+                    withFrame : withoutFrame;
+            EXPECT_TRUE(set.insert(dropped[i].frameNumber).second)
+                    << "request " << dropped[i].frameNumber << " reported twice";
+            if (NULL != dropped[i].input) {
+                EXPECT_EQ(dropped[i].frameNumber, dropped[i].input->bufs[0]->buf_idx);
+            }
+            freeInput(dropped[i].input);
+        }
+    }
+
+    /* Joined request at the head of the reprocess queue */
+    uint32_t dequeueReady()
+    {
+        qcamera_hal3_pp_join_t *input = (qcamera_hal3_pp_join_t *)mReadyQ.dequeue();
+        if (NULL == input) {
+            return UINT32_MAX;
+        }
+        uint32_t frameNumber = input->pp_buffer->frameNumber;
+        EXPECT_EQ(frameNumber, input->metadata->bufs[0]->buf_idx);
+        releaseEntry(*input);
+        free(input);
+        return frameNumber;
+    }
+
+    void releaseEntry(qcamera_hal3_pp_join_t &entry)
+    {
+        if (NULL != entry.pp_buffer) {
+            if (NULL != entry.pp_buffer->input) {
+                freeInput(entry.pp_buffer->input);
+                mReleasedFrames++;
+            }
+            free(entry.pp_buffer);
+        }
+        if (NULL != entry.metadata) {
+            freeInput(entry.metadata);
+            mReleasedMeta++;
+        }
+        if (NULL != entry.jpeg_settings) {
+            free(entry.jpeg_settings);
+            mReleasedSettings++;
+        }
+        memset(&entry, 0, sizeof(entry));
+    }
+
+    static void release(qcamera_hal3_pp_join_t &entry, void *userData)
+    {
+        ((QCamera3PPJoinTest *)userData)->releaseEntry(entry);
+    }
+
+    /* The queue frees the node data itself */
+    static void releaseReady(void *data, void *userData)
+    {
+        ((QCamera3PPJoinTest *)userData)->releaseEntry(
+                *(qcamera_hal3_pp_join_t *)data);
+    }
+
+    QCamera3PPJoinTable mTable;
+    QCameraQueue mReadyQ;
+    uint32_t mReleasedFrames;
+    uint32_t mReleasedMeta;
+    uint32_t mReleasedSettings;
+};
+
+TEST_F(QCamera3PPJoinTest, JoinsFrameAndMetadataInEitherOrder)
+{
+    addFrame(1);
+    EXPECT_EQ(0, mReadyQ.getCurrentSize());
+    addMeta(1);
+    addMeta(2);
+    addFrame(2);
+    EXPECT_EQ(0U, mTable.size());
+    EXPECT_FALSE(mTable.hasDropped());
+
+    EXPECT_EQ(1U, dequeueReady());
+    EXPECT_EQ(2U, dequeueReady());
+    EXPECT_EQ(UINT32_MAX, dequeueReady());
+}
+
+TEST_F(QCamera3PPJoinTest, SettingsStayWithTheRequest)
+{
+    addSettings(1);
+    addFrame(1);
+    addMeta(1);
+    qcamera_hal3_pp_join_t *input = (qcamera_hal3_pp_join_t *)mReadyQ.dequeue();
+    ASSERT_TRUE(NULL != input);
+    ASSERT_TRUE(NULL != input->jpeg_settings);
+    EXPECT_EQ(1U, input->jpeg_settings->out_buf_index);
+    releaseEntry(*input);
+    free(input);
+    EXPECT_EQ(0U, mTable.size());
+}
+
+TEST_F(QCamera3PPJoinTest, SweepDropsOlderPartialRequests)
+{
+    // 1 lost its metadata, 2 lost its frame, 3 is a framework request with
+    // settings only, 4 completes first
+    addFrame(1);
+    addMeta(2);
+    addSettings(3);
+    addFrame(4);
+    addMeta(4);
+
+    std::set<uint32_t> withFrame, withoutFrame;
+    takeDropped(withFrame, withoutFrame);
+    EXPECT_EQ(std::set<uint32_t>({1}), withFrame);
+    EXPECT_EQ(std::set<uint32_t>({2}), withoutFrame);
+    // the frame of 1 is handed over, not released
+    EXPECT_EQ(0U, mReleasedFrames);
+    EXPECT_EQ(1U, mReleasedMeta);
+
+    EXPECT_EQ(1U, mTable.size());
+    jpeg_settings_t *settings = mTable.takeJpegSettings(3);
+    ASSERT_TRUE(NULL != settings);
+    free(settings);
+    EXPECT_EQ(0U, mTable.size());
+    EXPECT_EQ(4U, dequeueReady());
+}
+
+TEST_F(QCamera3PPJoinTest, SweepKeepsNewerRequests)
+{
+    addFrame(5);
+    addMeta(6);
+    addFrame(3);
+    addMeta(3);
+    EXPECT_FALSE(mTable.hasDropped());
+    EXPECT_EQ(2U, mTable.size());
+}
+
+TEST_F(QCamera3PPJoinTest, FullTableEvictsOldest)
+{
+    for (uint32_t i = 0; i < MAX_HAL3_PP_JOIN_ENTRIES; i++) {
+        addFrame(i);
+    }
+    EXPECT_FALSE(mTable.hasDropped());
+    EXPECT_EQ((size_t)MAX_HAL3_PP_JOIN_ENTRIES, mTable.size());
+
+    addMeta(MAX_HAL3_PP_JOIN_ENTRIES);
+    std::set<uint32_t> withFrame, withoutFrame;
+    takeDropped(withFrame, withoutFrame);
+    EXPECT_EQ(std::set<uint32_t>({0}), withFrame);
+    EXPECT_TRUE(withoutFrame.empty());
+    EXPECT_EQ((size_t)MAX_HAL3_PP_JOIN_ENTRIES, mTable.size());
+}
+
+TEST_F(QCamera3PPJoinTest, EvictedSettingsAreNotReported)
+{
+    addSettings(0);
+    for (uint32_t i = 1; i <= MAX_HAL3_PP_JOIN_ENTRIES; i++) {
+        addMeta(i);
+    }
+    EXPECT_FALSE(mTable.hasDropped());
+    EXPECT_EQ(1U, mReleasedSettings);
+    EXPECT_TRUE(NULL == mTable.takeJpegSettings(0));
+}
+
+TEST_F(QCamera3PPJoinTest, FullQueueDropsOldestQueued)
+{
+    const uint32_t total = MAX_HAL3_PP_INPUT_DEPTH + 3;
+    for (uint32_t i = 0; i < total; i++) {
+        addFrame(i);
+        addMeta(i);
+        EXPECT_LE((uint32_t)mReadyQ.getCurrentSize(), (uint32_t)MAX_HAL3_PP_INPUT_DEPTH);
+    }
+
+    std::set<uint32_t> withFrame, withoutFrame;
+    takeDropped(withFrame, withoutFrame);
+    EXPECT_EQ(std::set<uint32_t>({0, 1, 2}), withFrame);
+    EXPECT_TRUE(withoutFrame.empty());
+    EXPECT_EQ(3U, mReleasedMeta);
+    EXPECT_EQ(0U, mReleasedFrames);
+
+    for (uint32_t i = 3; i < total; i++) {
+        EXPECT_EQ(i, dequeueReady());
+    }
+}
+
+TEST_F(QCamera3PPJoinTest, StoppedQueueReleasesWithoutReporting)
+{
+    mReadyQ.flush();
+    addFrame(1);
+    addMeta(1);
+    EXPECT_FALSE(mTable.hasDropped());
+    EXPECT_EQ(1U, mReleasedFrames);
+    EXPECT_EQ(1U, mReleasedMeta);
+    EXPECT_EQ(0U, mTable.size());
+    mReadyQ.init();
+}
+
+TEST_F(QCamera3PPJoinTest, FlushReleasesWithoutReporting)
+{
+    addFrame(1);
+    addMeta(2);
+    addSettings(3);
+    mTable.flush();
+    EXPECT_FALSE(mTable.hasDropped());
+    EXPECT_EQ(0U, mTable.size());
+    EXPECT_EQ(1U, mReleasedFrames);
+    EXPECT_EQ(1U, mReleasedMeta);
+    EXPECT_EQ(1U, mReleasedSettings);
+}
+
+TEST_F(QCamera3PPJoinTest, LatePieceOfDroppedRequestIsDroppedAgain)
+{
+    // frame 1 is swept, its metadata comes after 2 joined
+    addFrame(1);
+    addFrame(2);
+    addMeta(2);
+    std::set<uint32_t> withFrame, withoutFrame;
+    takeDropped(withFrame, withoutFrame);
+    EXPECT_EQ(std::set<uint32_t>({1}), withFrame);
+
+    addMeta(1);
+    addFrame(3);
+    addMeta(3);
+    withFrame.clear();
+    takeDropped(withFrame, withoutFrame);
+    EXPECT_TRUE(withFrame.empty());
+    EXPECT_EQ(std::set<uint32_t>({1}), withoutFrame);
+    EXPECT_EQ(2U, dequeueReady());
+    EXPECT_EQ(3U, dequeueReady());
+}
@@ -0,0 +1,336 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Benchmark of the input reprocess setup of QCamera3ReprocMeta.
+ *
+ * Replays the metadata side of input reprocess requests with 1 to 3
+ * output channels (YUV + JPEG + a second YUV):
+ *   - legacy: settings translated into a scratch buffer, every channel
+ *     pops an offline meta buffer from a list and memcpy's the whole
+ *     metadata_buffer_t into it, as setFwkInputPPData did before the pool
+ *   - shared: settings translated straight into a pool slot, every channel
+ *     maps the slot with ref(), the HWI drops its own reference
+ *   - shared+cow: as shared, and every channel but the last one overrides
+ *     the rotation, so it takes a sparse private copy (privatizeOfflineMeta)
+ * The result path (releaseOfflineMeta) is included. Prints the setup cost
+ * per request and the metadata bytes copied per request.
+ *
+ * usage: qcamera3_reproc_meta_bench [requests] */
+
+// System dependencies
+#include <list>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCamera3ReprocMeta.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace qcamera;
+
+#define BENCH_MAX_CHANNELS      3
+#define BENCH_OFFLINE_BUFS      (MAX_INFLIGHT_REQUESTS + MAX_REPROCESS_PIPELINE_STAGES - 1)
+#define BENCH_INFLIGHT          4
+
+typedef enum {
+    BENCH_LEGACY,
+    BENCH_SHARED,
+    BENCH_SHARED_COW,
+} bench_mode_t;
+
+static const char *gModeNames[] = { "legacy    ", "shared    ", "shared+cow" };
+
+/* Offline meta buffers of one output channel */
+class OfflineMeta {
+public:
+    OfflineMeta() : mMemory(BENCH_OFFLINE_BUFS, false) {}
+
+    int32_t init()
+    {
+        int32_t rc = mMemory.allocateAll(sizeof(metadata_buffer_t));
+        mFreeList.clear();
+        mFreeMask.setAll(mMemory.getCnt());
+        for (uint32_t i = 0; i < mMemory.getCnt(); i++) {
+            mFreeList.push_back(i);
+        }
+        return rc;
+    }
+
+    /* List<> based free list used before QCamera3BufIdxMask */
+    int32_t getLegacy(uint32_t frameNumber, const cam_frame_len_offset_t &offset,
+            mm_camera_buf_def_t &bufDef)
+    {
+        uint32_t idx;
+        {
+            Mutex::Autolock lock(mLock);
+            if (mFreeList.empty()) {
+                return BAD_VALUE;
+            }
+            idx = *mFreeList.begin();
+            mFreeList.erase(mFreeList.begin());
+        }
+        mMemory.markFrameNumber(idx, frameNumber);
+        return mMemory.getBufDef(offset, bufDef, idx);
+    }
+
+    void releaseLegacy(uint32_t frameNumber)
+    {
+        int32_t idx = mMemory.getHeapBufferIndex(frameNumber);
+        if (0 <= idx) {
+            mMemory.markFrameNumber((uint32_t)idx, -1);
+            Mutex::Autolock lock(mLock);
+            mFreeList.push_back((uint32_t)idx);
+        }
+    }
+
+    int32_t get(uint32_t frameNumber, const cam_frame_len_offset_t &offset,
+            mm_camera_buf_def_t &bufDef)
+    {
+        int32_t idx;
+        {
+            Mutex::Autolock lock(mLock);
+            idx = mFreeMask.get();
+            if (idx < 0) {
+                return BAD_VALUE;
+            }
+        }
+        mMemory.markFrameNumber((uint32_t)idx, frameNumber);
+        return mMemory.getBufDef(offset, bufDef, (uint32_t)idx);
+    }
+
+    /* releaseOfflineMeta: private buffer, else the shared slot reference */
+    void release(QCamera3ReprocMetaPool &pool, uint32_t frameNumber)
+    {
+        int32_t idx = mMemory.getHeapBufferIndex(frameNumber);
+        if (0 <= idx) {
+            mMemory.markFrameNumber((uint32_t)idx, -1);
+            Mutex::Autolock lock(mLock);
+            mFreeMask.put((uint32_t)idx);
+        } else {
+            pool.unrefFrame(frameNumber);
+        }
+    }
+
+    void deinit() { mMemory.deallocate(); }
+
+private:
+    QCamera3StreamMem mMemory;
+    std::list<uint32_t> mFreeList;
+    QCamera3BufIdxMask mFreeMask;
+    Mutex mLock;
+};
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+/* Stand-in for translateToHalMetadata of the reprocess settings */
+static void translate(metadata_buffer_t *meta, uint32_t frameNumber)
+{
+    clear_metadata_buffer(meta);
+    ADD_SET_PARAM_ENTRY_TO_BATCH(meta, CAM_INTF_META_FRAME_NUMBER, frameNumber);
+    uint32_t quality = 95;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(meta, CAM_INTF_META_JPEG_QUALITY, quality);
+    cam_rotation_info_t rotation;
+    memset(&rotation, 0, sizeof(rotation));
+    rotation.rotation = ROTATE_90;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(meta, CAM_INTF_PARM_ROTATION, rotation);
+}
+
+static void override(metadata_buffer_t *meta)
+{
+    cam_rotation_info_t rotation;
+    memset(&rotation, 0, sizeof(rotation));
+    rotation.rotation = ROTATE_0;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(meta, CAM_INTF_PARM_ROTATION, rotation);
+}
+
+/* Sets up one request, returns the metadata bytes copied or -1 */
+static ssize_t setup(bench_mode_t mode, uint32_t channels, uint32_t frameNumber,
+        QCamera3ReprocMetaPool &pool, OfflineMeta *offline,
+        metadata_buffer_t *scratch, const cam_frame_len_offset_t &offset)
+{
+    ssize_t copied = 0;
+    mm_camera_buf_def_t bufDef;
+
+    if (BENCH_LEGACY == mode) {
+        translate(scratch, frameNumber);
+        for (uint32_t c = 0; c < channels; c++) {
+            if (NO_ERROR != offline[c].getLegacy(frameNumber, offset, bufDef)) {
+                return -1;
+            }
+            memcpy(bufDef.buffer, scratch, sizeof(metadata_buffer_t));
+            copied += sizeof(metadata_buffer_t);
+            if (c + 1 < channels) {
+                override((metadata_buffer_t *)bufDef.buffer);
+            }
+        }
+        return copied;
+    }
+
+    metadata_buffer_t *shared = pool.acquire(frameNumber);
+    if (NULL == shared) {
+        return -1;
+    }
+    translate(shared, frameNumber);
+    for (uint32_t c = 0; c < channels; c++) {
+        if (NO_ERROR != pool.ref(shared, offset, bufDef)) {
+            return -1;
+        }
+    }
+    pool.unref(shared);
+
+    if (BENCH_SHARED_COW == mode) {
+        for (uint32_t c = 0; c < channels; c++) {
+            metadata_buffer_t *meta = shared;
+            if (pool.getRefCount(shared) > 1) {
+                if (NO_ERROR != offline[c].get(frameNumber, offset, bufDef)) {
+                    return -1;
+                }
+                meta = (metadata_buffer_t *)bufDef.buffer;
+                QCamera3ReprocMetaPool::copyMeta(meta, shared);
+                copied += offsetof(metadata_buffer_t, is_tuning_params_valid);
+                pool.unref(shared);
+            }
+            if (c + 1 < channels) {
+                override(meta);
+            }
+        }
+    }
+    return copied;
+}
+
+static void release(bench_mode_t mode, uint32_t channels, uint32_t frameNumber,
+        QCamera3ReprocMetaPool &pool, OfflineMeta *offline)
+{
+    for (uint32_t c = 0; c < channels; c++) {
+        if (BENCH_LEGACY == mode) {
+            offline[c].releaseLegacy(frameNumber);
+        } else {
+            offline[c].release(pool, frameNumber);
+        }
+    }
+}
+
+static int run(bench_mode_t mode, uint32_t channels, uint32_t requests)
+{
+    QCamera3ReprocMetaPool pool;
+    OfflineMeta offline[BENCH_MAX_CHANNELS];
+    cam_frame_len_offset_t offset;
+    ssize_t copied = 0;
+    int rc = -1;
+
+    metadata_buffer_t *scratch = (metadata_buffer_t *)malloc(sizeof(metadata_buffer_t));
+    if ((NULL == scratch) || (NO_ERROR != pool.init())) {
+        fprintf(stderr, "allocation failed\n");
+        free(scratch);
+        return -1;
+    }
+    for (uint32_t c = 0; c < channels; c++) {
+        if (NO_ERROR != offline[c].init()) {
+            fprintf(stderr, "offline meta allocation failed\n");
+            goto done;
+        }
+    }
+    memset(&offset, 0, sizeof(offset));
+    offset.num_planes = 1;
+    offset.frame_len = sizeof(metadata_buffer_t);
+    offset.mp[0].len = sizeof(metadata_buffer_t);
+
+    {
+        // Warm up, then measure; BENCH_INFLIGHT requests stay in flight
+        uint32_t warmup = requests / 10 + BENCH_INFLIGHT;
+        int64_t startNs = 0, setupNs = 0;
+        for (uint32_t f = 0; f < warmup + requests; f++) {
+            if (f == warmup) {
+                startNs = now_ns();
+                setupNs = 0;
+                copied = 0;
+            }
+            int64_t t = now_ns();
+            ssize_t bytes = setup(mode, channels, f, pool, offline, scratch, offset);
+            setupNs += now_ns() - t;
+            if (bytes < 0) {
+                fprintf(stderr, "setup of request %u failed\n", f);
+                goto done;
+            }
+            copied += bytes;
+            if (f >= BENCH_INFLIGHT) {
+                release(mode, channels, f - BENCH_INFLIGHT, pool, offline);
+            }
+        }
+        int64_t totalNs = now_ns() - startNs;
+        printf("%s %u channel%s: setup %7.2f us, setup+release %7.2f us, "
+                "%8zd bytes copied per request\n",
+                gModeNames[mode], channels, (channels > 1) ? "s" : " ",
+                setupNs / 1e3 / requests, totalNs / 1e3 / requests,
+                copied / (ssize_t)requests);
+    }
+    rc = 0;
+
+done:
+    for (uint32_t c = 0; c < channels; c++) {
+        offline[c].deinit();
+    }
+    pool.deinit();
+    free(scratch);
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    int requests = (argc > 1) ? atoi(argv[1]) : 2000;
+    int rc = 0;
+
+    if (requests <= 0) {
+        fprintf(stderr, "usage: %s [requests]\n", argv[0]);
+        return 2;
+    }
+    printf("%d requests, metadata_buffer_t %zu bytes\n", requests,
+            sizeof(metadata_buffer_t));
+    for (uint32_t channels = 1; channels <= BENCH_MAX_CHANNELS; channels++) {
+        for (int mode = BENCH_LEGACY; mode <= BENCH_SHARED_COW; mode++) {
+            if (run((bench_mode_t)mode, channels, (uint32_t)requests) != 0) {
+                fprintf(stderr, "FAIL: %s %u channels\n", gModeNames[mode], channels);
+                rc = 1;
+            }
+        }
+    }
+    return rc;
+}
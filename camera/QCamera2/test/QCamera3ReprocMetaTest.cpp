@@ -0,0 +1,396 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Unit tests of the shared reprocess metadata of QCamera3ReprocMeta.
+ *
+ * QCamera3BufIdxMask is checked against a std::set of free indices over
+ * random put/get sequences, for the lowest-index-first order and the
+ * capacity clamp. QCamera3ReprocMetaPool is driven the way an input
+ * reprocess request uses it: the HWI acquires a slot and every output
+ * channel maps it with ref(), a channel overriding entries takes a private
+ * copy while others still hold the slot (privatizeOfflineMeta), the sole
+ * holder writes in place, and the result path drops the references by
+ * frame number. copyMeta is checked to skip the invalid tuning and debug
+ * blobs. */
+
+// System dependencies
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <vector>
+
+// Camera dependencies
+#include "QCamera3ReprocMeta.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace qcamera;
+
+#define REPROC_TEST_CHANNELS    3
+#define REPROC_TEST_THREADS     4
+#define REPROC_TEST_LOOPS       2000
+
+static void fill_offset(cam_frame_len_offset_t &offset)
+{
+    memset(&offset, 0, sizeof(offset));
+    offset.num_planes = 1;
+    offset.frame_len = sizeof(metadata_buffer_t);
+    offset.mp[0].len = sizeof(metadata_buffer_t);
+}
+
+TEST(QCamera3BufIdxMaskTest, EmptyByDefault)
+{
+    QCamera3BufIdxMask mask;
+    EXPECT_TRUE(mask.empty());
+    EXPECT_EQ(0U, mask.size());
+    EXPECT_EQ(-1, mask.get());
+}
+
+TEST(QCamera3BufIdxMaskTest, SetAllHandsOutLowestFirst)
+{
+    const uint32_t counts[] = { 1, 31, 32, 33, QCAMERA3_BUF_IDX_MASK_BITS,
+            QCAMERA3_BUF_IDX_MASK_BITS + 5 };
+    for (uint32_t count : counts) {
+        QCamera3BufIdxMask mask;
+        mask.setAll(count);
+        uint32_t expected = std::min(count, (uint32_t)QCAMERA3_BUF_IDX_MASK_BITS);
+        EXPECT_EQ(expected, mask.size()) << "count " << count;
+        for (uint32_t i = 0; i < expected; i++) {
+            ASSERT_EQ((int32_t)i, mask.get()) << "count " << count;
+        }
+        EXPECT_TRUE(mask.empty());
+        EXPECT_EQ(-1, mask.get());
+    }
+}
+
+TEST(QCamera3BufIdxMaskTest, PutIsIdempotentAndBounded)
+{
+    QCamera3BufIdxMask mask;
+    mask.put(QCAMERA3_BUF_IDX_MASK_BITS);
+    mask.put(QCAMERA3_BUF_IDX_MASK_BITS + 100);
+    EXPECT_TRUE(mask.empty());
+
+    mask.put(QCAMERA3_BUF_IDX_MASK_BITS - 1);
+    mask.put(QCAMERA3_BUF_IDX_MASK_BITS - 1);
+    mask.put(7);
+    EXPECT_EQ(2U, mask.size());
+    EXPECT_EQ(7, mask.get());
+    EXPECT_EQ((int32_t)QCAMERA3_BUF_IDX_MASK_BITS - 1, mask.get());
+    EXPECT_EQ(-1, mask.get());
+
+    mask.setAll(4);
+    mask.clear();
+    EXPECT_TRUE(mask.empty());
+}
+
+TEST(QCamera3BufIdxMaskTest, MatchesFreeListModel)
+{
+    QCamera3BufIdxMask mask;
+    std::set<uint32_t> model;
+    srand(0x36);
+    for (uint32_t i = 0; i < 20000; i++) {
+        if (rand() % 2) {
+            uint32_t idx = (uint32_t)rand() % QCAMERA3_BUF_IDX_MASK_BITS;
+            mask.put(idx);
+            model.insert(idx);
+        } else {
+            int32_t expected = model.empty() ? -1 : (int32_t)*model.begin();
+            if (!model.empty()) {
+                model.erase(model.begin());
+            }
+            ASSERT_EQ(expected, mask.get());
+        }
+        ASSERT_EQ(model.size(), mask.size());
+        ASSERT_EQ(model.empty(), mask.empty());
+    }
+}
+
+class QCamera3ReprocMetaPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(NO_ERROR, mPool.init());
+        fill_offset(mOffset);
+    }
+
+    void TearDown() override
+    {
+        mPool.deinit();
+    }
+
+    QCamera3ReprocMetaPool mPool;
+    cam_frame_len_offset_t mOffset;
+};
+
+TEST_F(QCamera3ReprocMetaPoolTest, UninitializedPoolHasNoSlots)
+{
+    QCamera3ReprocMetaPool pool;
+    metadata_buffer_t meta;
+    mm_camera_buf_def_t bufDef;
+
+    EXPECT_EQ(NULL, pool.acquire(1));
+    EXPECT_FALSE(pool.isShared(&meta));
+    EXPECT_EQ(0U, pool.getRefCount(&meta));
+    EXPECT_NE(NO_ERROR, pool.ref(&meta, mOffset, bufDef));
+    pool.unrefFrame(1);
+}
+
+TEST_F(QCamera3ReprocMetaPoolTest, AcquireUntilExhausted)
+{
+    std::set<metadata_buffer_t *> slots;
+    for (uint32_t i = 0; i < QCAMERA3_REPROC_META_SLOTS; i++) {
+        metadata_buffer_t *meta = mPool.acquire(i);
+        ASSERT_NE((metadata_buffer_t *)NULL, meta);
+        EXPECT_TRUE(mPool.isShared(meta));
+        EXPECT_EQ(1U, mPool.getRefCount(meta));
+        slots.insert(meta);
+    }
+    EXPECT_EQ((size_t)QCAMERA3_REPROC_META_SLOTS, slots.size());
+    EXPECT_EQ(NULL, mPool.acquire(QCAMERA3_REPROC_META_SLOTS));
+
+    // The last reference recycles the slot
+    mPool.unrefFrame(3);
+    metadata_buffer_t *meta = mPool.acquire(100);
+    ASSERT_NE((metadata_buffer_t *)NULL, meta);
+    EXPECT_EQ(1U, slots.count(meta));
+    EXPECT_EQ(NULL, mPool.acquire(101));
+
+    mPool.reset();
+    for (metadata_buffer_t *slot : slots) {
+        EXPECT_EQ(0U, mPool.getRefCount(slot));
+    }
+    for (uint32_t i = 0; i < QCAMERA3_REPROC_META_SLOTS; i++) {
+        EXPECT_NE((metadata_buffer_t *)NULL, mPool.acquire(200 + i));
+    }
+}
+
+TEST_F(QCamera3ReprocMetaPoolTest, RefCountsHolders)
+{
+    metadata_buffer_t *meta = mPool.acquire(10);
+    ASSERT_NE((metadata_buffer_t *)NULL, meta);
+
+    for (uint32_t i = 0; i < REPROC_TEST_CHANNELS; i++) {
+        mm_camera_buf_def_t bufDef;
+        memset(&bufDef, 0, sizeof(bufDef));
+        ASSERT_EQ(NO_ERROR, mPool.ref(meta, mOffset, bufDef));
+        EXPECT_EQ((void *)meta, bufDef.buffer);
+        EXPECT_LE(sizeof(metadata_buffer_t), bufDef.frame_len);
+        EXPECT_EQ(1, bufDef.planes_buf.num_planes);
+    }
+    EXPECT_EQ(1U + REPROC_TEST_CHANNELS, mPool.getRefCount(meta));
+
+    // The HWI drops its reference once the channels have the request
+    mPool.unref(meta);
+    EXPECT_EQ((uint32_t)REPROC_TEST_CHANNELS, mPool.getRefCount(meta));
+
+    for (uint32_t i = 0; i < REPROC_TEST_CHANNELS; i++) {
+        mPool.unrefFrame(10);
+    }
+    EXPECT_EQ(0U, mPool.getRefCount(meta));
+    EXPECT_TRUE(mPool.isShared(meta));
+
+    // A freed slot can neither be mapped nor released again
+    mm_camera_buf_def_t bufDef;
+    EXPECT_EQ(BAD_VALUE, mPool.ref(meta, mOffset, bufDef));
+    mPool.unref(meta);
+    mPool.unrefFrame(10);
+    EXPECT_EQ(0U, mPool.getRefCount(meta));
+
+    metadata_buffer_t local;
+    EXPECT_FALSE(mPool.isShared(&local));
+    EXPECT_EQ(BAD_VALUE, mPool.ref(&local, mOffset, bufDef));
+    EXPECT_EQ(BAD_VALUE, mPool.ref(NULL, mOffset, bufDef));
+}
+
+/* privatizeOfflineMeta of QCamera3ProcessingChannel on the pool API */
+static metadata_buffer_t *privatize(QCamera3ReprocMetaPool &pool,
+        metadata_buffer_t *shared, metadata_buffer_t *privateMeta)
+{
+    if (pool.getRefCount(shared) <= 1) {
+        return shared;
+    }
+    QCamera3ReprocMetaPool::copyMeta(privateMeta, shared);
+    pool.unref(shared);
+    return privateMeta;
+}
+
+TEST_F(QCamera3ReprocMetaPoolTest, CopyOnWrite)
+{
+    metadata_buffer_t *shared = mPool.acquire(20);
+    ASSERT_NE((metadata_buffer_t *)NULL, shared);
+    clear_metadata_buffer(shared);
+    uint32_t quality = 95;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(shared, CAM_INTF_META_JPEG_QUALITY, quality);
+    cam_rotation_info_t rotation;
+    memset(&rotation, 0, sizeof(rotation));
+    rotation.rotation = ROTATE_90;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(shared, CAM_INTF_PARM_ROTATION, rotation);
+
+    mm_camera_buf_def_t bufDef;
+    ASSERT_EQ(NO_ERROR, mPool.ref(shared, mOffset, bufDef));
+    ASSERT_EQ(NO_ERROR, mPool.ref(shared, mOffset, bufDef));
+    mPool.unref(shared);
+
+    // YUV reprocess overrides the rotation while the JPEG channel holds it
+    metadata_buffer_t *yuvMeta =
+            (metadata_buffer_t *)malloc(sizeof(metadata_buffer_t));
+    ASSERT_NE((metadata_buffer_t *)NULL, yuvMeta);
+    metadata_buffer_t *yuv = privatize(mPool, shared, yuvMeta);
+    EXPECT_EQ(yuvMeta, yuv);
+    EXPECT_EQ(1U, mPool.getRefCount(shared));
+    rotation.rotation = ROTATE_0;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(yuv, CAM_INTF_PARM_ROTATION, rotation);
+
+    // The JPEG channel is now the sole holder and writes in place
+    metadata_buffer_t jpegMeta;
+    metadata_buffer_t *jpeg = privatize(mPool, shared, &jpegMeta);
+    EXPECT_EQ(shared, jpeg);
+    EXPECT_EQ(1U, mPool.getRefCount(shared));
+    quality = 80;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(jpeg, CAM_INTF_META_JPEG_QUALITY, quality);
+
+    IF_META_AVAILABLE(cam_rotation_info_t, yuvRot, CAM_INTF_PARM_ROTATION, yuv) {
+        EXPECT_EQ(ROTATE_0, yuvRot->rotation);
+    } else {
+        ADD_FAILURE() << "rotation missing from the private copy";
+    }
+    IF_META_AVAILABLE(uint32_t, yuvQuality, CAM_INTF_META_JPEG_QUALITY, yuv) {
+        EXPECT_EQ(95U, *yuvQuality);
+    } else {
+        ADD_FAILURE() << "quality missing from the private copy";
+    }
+    IF_META_AVAILABLE(cam_rotation_info_t, jpegRot, CAM_INTF_PARM_ROTATION, jpeg) {
+        EXPECT_EQ(ROTATE_90, jpegRot->rotation);
+    } else {
+        ADD_FAILURE() << "rotation missing from the shared slot";
+    }
+    IF_META_AVAILABLE(uint32_t, jpegQuality, CAM_INTF_META_JPEG_QUALITY, jpeg) {
+        EXPECT_EQ(80U, *jpegQuality);
+    } else {
+        ADD_FAILURE() << "quality missing from the shared slot";
+    }
+
+    // The private copy no longer holds the slot, the JPEG result frees it
+    mPool.unrefFrame(20);
+    EXPECT_EQ(0U, mPool.getRefCount(shared));
+    free(yuvMeta);
+}
+
+TEST_F(QCamera3ReprocMetaPoolTest, CopyMetaSkipsInvalidBlobs)
+{
+    metadata_buffer_t *src = (metadata_buffer_t *)malloc(sizeof(metadata_buffer_t));
+    metadata_buffer_t *dst = (metadata_buffer_t *)malloc(sizeof(metadata_buffer_t));
+    ASSERT_NE((metadata_buffer_t *)NULL, src);
+    ASSERT_NE((metadata_buffer_t *)NULL, dst);
+
+    memset(src, 0x5a, sizeof(*src));
+    clear_metadata_buffer(src);
+    uint32_t frameNumber = 42;
+    ADD_SET_PARAM_ENTRY_TO_BATCH(src, CAM_INTF_META_FRAME_NUMBER, frameNumber);
+    memset(dst, 0xa5, sizeof(*dst));
+
+    QCamera3ReprocMetaPool::copyMeta(dst, src);
+    EXPECT_EQ(0, memcmp(dst, src, offsetof(metadata_buffer_t, is_tuning_params_valid)));
+    EXPECT_EQ(0, dst->is_tuning_params_valid);
+    EXPECT_EQ(0, dst->is_statsdebug_3a_tuning_params_valid);
+    const uint8_t *tuning = (const uint8_t *)&dst->tuning_params;
+    for (size_t i = 0; i < sizeof(dst->tuning_params); i++) {
+        ASSERT_EQ(0xa5, tuning[i]) << "invalid tuning blob copied at " << i;
+    }
+
+    src->is_tuning_params_valid = 1;
+    src->is_statsdebug_3a_tuning_params_valid = 1;
+    QCamera3ReprocMetaPool::copyMeta(dst, src);
+    EXPECT_EQ(1, dst->is_tuning_params_valid);
+    EXPECT_EQ(0, memcmp(&dst->tuning_params, &src->tuning_params,
+            sizeof(dst->tuning_params)));
+    EXPECT_EQ(0, memcmp(&dst->statsdebug_3a_tuning_data,
+            &src->statsdebug_3a_tuning_data, sizeof(dst->statsdebug_3a_tuning_data)));
+    EXPECT_EQ(0, dst->is_statsdebug_af_params_valid);
+
+    IF_META_AVAILABLE(uint32_t, copied, CAM_INTF_META_FRAME_NUMBER, dst) {
+        EXPECT_EQ(42U, *copied);
+    } else {
+        ADD_FAILURE() << "frame number missing from the copy";
+    }
+
+    // Copying onto itself or from NULL is a no-op
+    QCamera3ReprocMetaPool::copyMeta(dst, dst);
+    QCamera3ReprocMetaPool::copyMeta(dst, NULL);
+    QCamera3ReprocMetaPool::copyMeta(NULL, src);
+    free(src);
+    free(dst);
+}
+
+typedef struct {
+    QCamera3ReprocMetaPool *pool;
+    metadata_buffer_t *meta;
+    cam_frame_len_offset_t *offset;
+    uint32_t failures;
+} ref_thread_t;
+
+static void *ref_thread(void *arg)
+{
+    ref_thread_t *t = (ref_thread_t *)arg;
+    for (uint32_t i = 0; i < REPROC_TEST_LOOPS; i++) {
+        mm_camera_buf_def_t bufDef;
+        if (NO_ERROR != t->pool->ref(t->meta, *t->offset, bufDef)) {
+            t->failures++;
+            continue;
+        }
+        t->pool->unref(t->meta);
+    }
+    return NULL;
+}
+
+TEST_F(QCamera3ReprocMetaPoolTest, ConcurrentRefUnref)
+{
+    metadata_buffer_t *meta = mPool.acquire(30);
+    ASSERT_NE((metadata_buffer_t *)NULL, meta);
+
+    std::vector<pthread_t> threads(REPROC_TEST_THREADS);
+    std::vector<ref_thread_t> args(REPROC_TEST_THREADS);
+    for (uint32_t i = 0; i < REPROC_TEST_THREADS; i++) {
+        args[i] = { &mPool, meta, &mOffset, 0 };
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, ref_thread, &args[i]));
+    }
+    for (uint32_t i = 0; i < REPROC_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        EXPECT_EQ(0U, args[i].failures);
+    }
+    EXPECT_EQ(1U, mPool.getRefCount(meta));
+    mPool.unrefFrame(30);
+    EXPECT_EQ(0U, mPool.getRefCount(meta));
+}
@@ -0,0 +1,282 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stream buffer mapping against the stand-in daemon of the virtual sensor.
+ *
+ * Opens camera 0 of the virtual backend through mm-camera-interface, adds
+ * a stream and maps a stream start worth of buffers to the daemon, once
+ * as one bundled message, as QCamera3Stream::getBufs does, and once with
+ * a message per buffer, as it did before. sendmsg() is replaced to count
+ * the domain socket round trips. The stream is then checked to track the
+ * map status of a sparse buffer set by frame_idx.
+ *
+ * property_get() is replaced to select the virtual backend with one
+ * camera. The daemon binds its socket in persist.camera.virtual.dir,
+ * /data/local/tmp unless set. Needs a build with
+ * TARGET_CAMERA_VIRTUAL_SENSOR := true. */
+
+// System dependencies
+#include <algorithm>
+#include <cutils/properties.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/system_properties.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Camera dependencies
+extern "C" {
+#include "mm_camera_interface.h"
+#include "mm_camera.h"
+
+mm_camera_obj_t *mm_camera_util_get_camera_by_handler(uint32_t cam_handle);
+mm_channel_t *mm_camera_util_get_channel_by_handler(mm_camera_obj_t *cam_obj,
+        uint32_t handler);
+mm_stream_t *mm_channel_util_get_stream_by_handler(mm_channel_t *ch_obj,
+        uint32_t handler);
+}
+
+#define MAP_TEST_NUM_BUFS   8           // HAL3 preview stream
+#define MAP_TEST_BUF_SIZE   (1920 * 1088 * 3 / 2)
+#define MAP_TEST_STARTS     50
+#define MAP_TEST_DIR        "/data/local/tmp"
+
+static volatile uint32_t gSendmsgCalls;
+
+extern "C" ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+    __sync_fetch_and_add(&gSendmsgCalls, 1);
+    return (ssize_t)syscall(SYS_sendmsg, fd, msg, flags);
+}
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    if (!strcmp(key, "persist.camera.virtual.sensor")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "1");
+    }
+    len = __system_property_get(key, value);
+    if ((len <= 0) && !strcmp(key, "persist.camera.virtual.dir")) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", MAP_TEST_DIR);
+    } else if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+class QCamera3StreamMapTest : public ::testing::Test {
+protected:
+    mm_camera_vtbl_t *mCam;
+    uint32_t mChId;
+    uint32_t mStreamId;
+    int mFds[CAM_MAX_NUM_BUFS_PER_STREAM];
+
+    virtual void SetUp() {
+        mm_camera_channel_attr_t attr;
+        char dir[PROPERTY_VALUE_MAX];
+
+        mCam = NULL;
+        mChId = 0;
+        mStreamId = 0;
+        for (uint32_t i = 0; i < CAM_MAX_NUM_BUFS_PER_STREAM; i++) {
+            mFds[i] = -1;
+        }
+
+        ASSERT_GE(get_num_of_cameras(), 1);
+        ASSERT_EQ(0, camera_open(0, &mCam));
+        ASSERT_TRUE(mCam != NULL);
+
+        memset(&attr, 0, sizeof(attr));
+        attr.notify_mode = MM_CAMERA_SUPER_BUF_NOTIFY_CONTINUOUS;
+        mChId = mCam->ops->add_channel(mCam->camera_handle, &attr, NULL, NULL);
+        ASSERT_NE(0U, mChId);
+        mStreamId = mCam->ops->add_stream(mCam->camera_handle, mChId);
+        ASSERT_NE(0U, mStreamId);
+
+        // Sparse files stand in for the ION buffers, the daemon mmaps them
+        property_get("persist.camera.virtual.dir", dir, MAP_TEST_DIR);
+        for (uint32_t i = 0; i < CAM_MAX_NUM_BUFS_PER_STREAM; i++) {
+            char name[PROPERTY_VALUE_MAX + 16];
+            snprintf(name, sizeof(name), "%s/map_test_XXXXXX", dir);
+            mFds[i] = mkstemp(name);
+            ASSERT_GE(mFds[i], 0) << name;
+            unlink(name);
+            ASSERT_EQ(0, ftruncate(mFds[i], MAP_TEST_BUF_SIZE));
+        }
+    }
+
+    virtual void TearDown() {
+        if (mCam != NULL) {
+            if (mStreamId != 0) {
+                mCam->ops->delete_stream(mCam->camera_handle, mChId, mStreamId);
+            }
+            if (mChId != 0) {
+                mCam->ops->delete_channel(mCam->camera_handle, mChId);
+            }
+            mCam->ops->close_camera(mCam->camera_handle);
+        }
+        for (uint32_t i = 0; i < CAM_MAX_NUM_BUFS_PER_STREAM; i++) {
+            if (mFds[i] >= 0) {
+                close(mFds[i]);
+            }
+        }
+    }
+
+    void fillMap(cam_buf_map_type *map, uint32_t frameIdx) {
+        memset(map, 0, sizeof(*map));
+        map->type = CAM_MAPPING_BUF_TYPE_STREAM_BUF;
+        map->stream_id = mStreamId;
+        map->frame_idx = frameIdx;
+        map->plane_idx = -1;
+        map->fd = mFds[frameIdx];
+        map->size = MAP_TEST_BUF_SIZE;
+    }
+
+    int32_t mapBundled(const uint32_t *frameIdx, uint32_t num) {
+        cam_buf_map_type_list list;
+        memset(&list, 0, sizeof(list));
+        for (uint32_t i = 0; i < num; i++) {
+            fillMap(&list.buf_maps[i], frameIdx[i]);
+        }
+        list.length = num;
+        return mCam->ops->map_stream_bufs(mCam->camera_handle, mChId, &list);
+    }
+
+    int32_t mapEach(const uint32_t *frameIdx, uint32_t num) {
+        for (uint32_t i = 0; i < num; i++) {
+            int32_t rc = mCam->ops->map_stream_buf(mCam->camera_handle, mChId,
+                    mStreamId, CAM_MAPPING_BUF_TYPE_STREAM_BUF, frameIdx[i], -1,
+                    mFds[frameIdx[i]], MAP_TEST_BUF_SIZE);
+            if (rc != 0) {
+                return rc;
+            }
+        }
+        return 0;
+    }
+
+    void unmap(const uint32_t *frameIdx, uint32_t num) {
+        for (uint32_t i = 0; i < num; i++) {
+            EXPECT_EQ(0, mCam->ops->unmap_stream_buf(mCam->camera_handle, mChId,
+                    mStreamId, CAM_MAPPING_BUF_TYPE_STREAM_BUF, frameIdx[i], -1));
+        }
+    }
+
+    int8_t mapStatus(uint32_t frameIdx) {
+        mm_camera_obj_t *camObj =
+                mm_camera_util_get_camera_by_handler(mCam->camera_handle);
+        mm_channel_t *chObj = mm_camera_util_get_channel_by_handler(camObj, mChId);
+        mm_stream_t *sObj = mm_channel_util_get_stream_by_handler(chObj, mStreamId);
+        int8_t status;
+
+        pthread_mutex_lock(&sObj->buf_lock);
+        status = sObj->buf_status[frameIdx].map_status;
+        pthread_mutex_unlock(&sObj->buf_lock);
+        return status;
+    }
+};
+
+TEST_F(QCamera3StreamMapTest, BundledStartIsOneRoundTrip)
+{
+    const char *names[2] = { "bundled", "per-buffer" };
+    uint32_t frameIdx[MAP_TEST_NUM_BUFS];
+    std::vector<int64_t> latencyNs[2];
+    uint32_t roundTrips[2] = { 0, 0 };
+
+    for (uint32_t i = 0; i < MAP_TEST_NUM_BUFS; i++) {
+        frameIdx[i] = i;
+    }
+    for (uint32_t start = 0; start < MAP_TEST_STARTS; start++) {
+        // One stream start: map every buffer, time it and count messages
+        for (uint32_t mode = 0; mode < 2; mode++) {
+            uint32_t calls = gSendmsgCalls;
+            int64_t t0 = now_ns();
+            ASSERT_EQ(0, (0 == mode) ? mapBundled(frameIdx, MAP_TEST_NUM_BUFS) :
+                    mapEach(frameIdx, MAP_TEST_NUM_BUFS));
+            latencyNs[mode].push_back(now_ns() - t0);
+            roundTrips[mode] += gSendmsgCalls - calls;
+            unmap(frameIdx, MAP_TEST_NUM_BUFS);
+        }
+    }
+
+    for (uint32_t mode = 0; mode < 2; mode++) {
+        std::vector<int64_t> &v = latencyNs[mode];
+        std::sort(v.begin(), v.end());
+        printf("%-10s %u buffers of %u bytes: %.1f round trips, "
+                "p50 %.1f us, p99 %.1f us per start\n",
+                names[mode], MAP_TEST_NUM_BUFS, MAP_TEST_BUF_SIZE,
+                (double)roundTrips[mode] / MAP_TEST_STARTS,
+                (double)v[v.size() / 2] / 1000.0,
+                (double)v[v.size() * 99 / 100] / 1000.0);
+    }
+    EXPECT_EQ((uint32_t)MAP_TEST_STARTS, roundTrips[0]);
+    EXPECT_EQ((uint32_t)(MAP_TEST_STARTS * MAP_TEST_NUM_BUFS), roundTrips[1]);
+    EXPECT_LT(latencyNs[0][MAP_TEST_STARTS / 2], latencyNs[1][MAP_TEST_STARTS / 2]);
+}
+
+TEST_F(QCamera3StreamMapTest, SparseMapStatusByFrameIdx)
+{
+    // HAL3 maps only the gralloc buffers registered so far
+    const uint32_t sparse[] = { 1, 3, 6 };
+    const uint32_t num = sizeof(sparse) / sizeof(sparse[0]);
+    const uint32_t late = 5;
+
+    ASSERT_EQ(0, mapBundled(sparse, num));
+    for (uint32_t i = 0; i < CAM_MAX_NUM_BUFS_PER_STREAM; i++) {
+        bool mapped = std::find(sparse, sparse + num, i) != sparse + num;
+        EXPECT_EQ(mapped ? 1 : 0, mapStatus(i)) << "frame_idx " << i;
+    }
+
+    // A buffer registered later is mapped on its own
+    ASSERT_EQ(0, mapEach(&late, 1));
+    EXPECT_EQ(1, mapStatus(late));
+    EXPECT_EQ(0, mapStatus(0));
+
+    unmap(&sparse[1], 1);
+    EXPECT_EQ(0, mapStatus(sparse[1]));
+    EXPECT_EQ(1, mapStatus(sparse[0]));
+    EXPECT_EQ(1, mapStatus(sparse[2]));
+
+    unmap(sparse, 1);
+    unmap(&sparse[2], 1);
+    unmap(&late, 1);
+}
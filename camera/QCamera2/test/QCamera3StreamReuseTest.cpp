@@ -0,0 +1,418 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stream reuse of HAL3 configureStreams on the virtual sensor.
+ *
+ * Opens the camera HAL module like the camera service does, configures a
+ * preview and a video stream, runs a few frames and then configures the
+ * same stream objects again with variations. A reconfiguration may keep
+ * the channels of the last one only if the streams, their usage and the
+ * operation mode are unchanged. Whether it did is read from the domain
+ * socket traffic to the stand-in daemon: sendmsg() is replaced to count
+ * stream info mappings, which only a rebuilt stream sends.
+ *
+ * property_get() is replaced to select the virtual backend with one
+ * camera, keep video batching off and force persist.camera.stream.reuse.
+ * The daemon binds its socket in persist.camera.virtual.dir,
+ * /data/local/tmp unless set. Needs a build with
+ * TARGET_CAMERA_VIRTUAL_SENSOR := true and the capability blob of the
+ * camera in persist.camera.virtual.dir. */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <errno.h>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/system_properties.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Camera dependencies
+#include "cam_types.h"
+#include "hardware/camera3.h"
+#include "hardware/gralloc.h"
+#include "system/camera_metadata.h"
+
+#define REUSE_TEST_WIDTH    1280
+#define REUSE_TEST_HEIGHT   720
+#define REUSE_TEST_FRAMES   5
+#define REUSE_TEST_TIMEOUT  5 // seconds
+#define REUSE_TEST_DIR      "/data/local/tmp"
+
+static volatile uint32_t gStreamInfoMaps;
+static const char *gStreamReuseProp = "1";
+
+/* Count the stream info buffers mapped to the daemon, one per stream the
+ * HAL adds to the backend */
+extern "C" ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+    if ((msg != NULL) && (msg->msg_iovlen > 0) &&
+            (msg->msg_iov[0].iov_len >= sizeof(cam_sock_packet_t))) {
+        const cam_sock_packet_t *packet =
+                (const cam_sock_packet_t *)msg->msg_iov[0].iov_base;
+        uint32_t maps = 0;
+
+        if ((packet->msg_type == CAM_MAPPING_TYPE_FD_MAPPING) &&
+                (packet->payload.buf_map.type ==
+                CAM_MAPPING_BUF_TYPE_STREAM_INFO)) {
+            maps = 1;
+        } else if (packet->msg_type == CAM_MAPPING_TYPE_FD_BUNDLED_MAPPING) {
+            const cam_buf_map_type_list *list = &packet->payload.buf_map_list;
+            for (uint32_t i = 0; (i < list->length) &&
+                    (i < CAM_MAX_NUM_BUFS_PER_STREAM); i++) {
+                if (list->buf_maps[i].type == CAM_MAPPING_BUF_TYPE_STREAM_INFO) {
+                    maps++;
+                }
+            }
+        }
+        __sync_fetch_and_add(&gStreamInfoMaps, maps);
+    }
+    return (ssize_t)syscall(SYS_sendmsg, fd, msg, flags);
+}
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    if (!strcmp(key, "persist.camera.virtual.sensor")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "1");
+    }
+    // Video batching is set per device and never reuses a video session
+    if (!strcmp(key, "persist.camera.video.batch")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "0");
+    }
+    if (!strcmp(key, "persist.camera.stream.reuse")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "%s", gStreamReuseProp);
+    }
+    len = __system_property_get(key, value);
+    if ((len <= 0) && !strcmp(key, "persist.camera.virtual.dir")) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", REUSE_TEST_DIR);
+    } else if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+class QCamera3StreamReuseTest : public ::testing::Test {
+protected:
+    struct Callbacks {
+        camera3_callback_ops_t ops;     // first, the callbacks cast back to it
+        QCamera3StreamReuseTest *test;
+    };
+
+    camera_module_t *mModule;
+    alloc_device_t *mAlloc;
+    camera3_device_t *mDev;
+    Callbacks mCb;
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    camera3_stream_t mStreams[2];
+    camera3_stream_t *mStreamList[2];
+    std::vector<buffer_handle_t> mHandles[2];
+    camera_metadata_t *mSettings;
+    uint32_t mPartialCount;
+    uint32_t mFrameNumber;
+    uint32_t mPending;          // buffers and final metadata still to come
+    uint32_t mErrors;
+
+    virtual void SetUp() {
+        const hw_module_t *hwModule = NULL;
+
+        mModule = NULL;
+        mAlloc = NULL;
+        mDev = NULL;
+        mSettings = NULL;
+        mFrameNumber = 0;
+        mPending = 0;
+        mErrors = 0;
+        pthread_mutex_init(&mLock, NULL);
+        pthread_cond_init(&mCond, NULL);
+
+        ASSERT_EQ(0, hw_get_module(CAMERA_HARDWARE_MODULE_ID, &hwModule));
+        mModule = (camera_module_t *)hwModule;
+        ASSERT_GE(mModule->get_number_of_cameras(), 1);
+        ASSERT_EQ(0, hw_get_module(GRALLOC_HARDWARE_MODULE_ID, &hwModule));
+        ASSERT_EQ(0, gralloc_open(hwModule, &mAlloc));
+        ASSERT_NO_FATAL_FAILURE(open());
+    }
+
+    virtual void TearDown() {
+        close();
+        for (uint32_t s = 0; s < 2; s++) {
+            for (size_t i = 0; i < mHandles[s].size(); i++) {
+                mAlloc->free(mAlloc, mHandles[s][i]);
+            }
+        }
+        if (mAlloc != NULL) {
+            gralloc_close(mAlloc);
+        }
+        pthread_cond_destroy(&mCond);
+        pthread_mutex_destroy(&mLock);
+    }
+
+    // Open camera 0, configure preview + video and run a few frames
+    void open() {
+        hw_device_t *hwDev = NULL;
+        struct camera_info info;
+        camera_metadata_ro_entry_t entry;
+
+        mPartialCount = 1;
+        if ((mModule->get_camera_info(0, &info) == 0) &&
+                (find_camera_metadata_ro_entry(info.static_camera_characteristics,
+                ANDROID_REQUEST_PARTIAL_RESULT_COUNT, &entry) == 0)) {
+            mPartialCount = (uint32_t)entry.data.i32[0];
+        }
+        ASSERT_EQ(0, mModule->common.methods->open(&mModule->common, "0", &hwDev));
+        mDev = (camera3_device_t *)hwDev;
+        memset(&mCb, 0, sizeof(mCb));
+        mCb.ops.process_capture_result = processCaptureResult;
+        mCb.ops.notify = notify;
+        mCb.test = this;
+        ASSERT_EQ(0, mDev->ops->initialize(mDev, &mCb.ops));
+
+        memset(mStreams, 0, sizeof(mStreams));
+        for (uint32_t s = 0; s < 2; s++) {
+            mStreams[s].stream_type = CAMERA3_STREAM_OUTPUT;
+            mStreams[s].width = REUSE_TEST_WIDTH;
+            mStreams[s].height = REUSE_TEST_HEIGHT;
+            mStreams[s].format = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
+            mStreams[s].usage = (s == 0) ? GRALLOC_USAGE_HW_TEXTURE :
+                    GRALLOC_USAGE_HW_VIDEO_ENCODER;
+            mStreamList[s] = &mStreams[s];
+        }
+        ASSERT_EQ(0, configure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE));
+        if (mHandles[0].empty()) {
+            for (uint32_t s = 0; s < 2; s++) {
+                for (uint32_t i = 0; i < mStreams[s].max_buffers; i++) {
+                    buffer_handle_t handle = NULL;
+                    int stride = 0;
+                    ASSERT_EQ(0, mAlloc->alloc(mAlloc, (int)mStreams[s].width,
+                            (int)mStreams[s].height, mStreams[s].format,
+                            (int)mStreams[s].usage, &handle, &stride));
+                    mHandles[s].push_back(handle);
+                }
+            }
+        }
+        const camera_metadata_t *tmpl = mDev->ops->construct_default_request_settings(
+                mDev, CAMERA3_TEMPLATE_VIDEO_RECORD);
+        ASSERT_TRUE(tmpl != NULL);
+        mSettings = clone_camera_metadata(tmpl);
+        ASSERT_TRUE(runFrames(REUSE_TEST_FRAMES, true));
+    }
+
+    void close() {
+        if (mDev != NULL) {
+            mDev->ops->flush(mDev);
+            mDev->common.close(&mDev->common);
+            mDev = NULL;
+        }
+        free_camera_metadata(mSettings);
+        mSettings = NULL;
+    }
+
+    int configure(uint32_t opMode) {
+        camera3_stream_configuration_t config;
+
+        memset(&config, 0, sizeof(config));
+        config.num_streams = 2;
+        config.streams = mStreamList;
+        config.operation_mode = opMode;
+        return mDev->ops->configure_streams(mDev, &config);
+    }
+
+    // Submit frames one at a time and wait for each to complete
+    bool runFrames(uint32_t frames, bool withSettings) {
+        for (uint32_t f = 0; f < frames; f++) {
+            camera3_stream_buffer_t bufs[2];
+            camera3_capture_request_t request;
+            bool done = true;
+
+            for (uint32_t s = 0; s < 2; s++) {
+                bufs[s].stream = mStreamList[s];
+                bufs[s].buffer = &mHandles[s][mFrameNumber % mHandles[s].size()];
+                bufs[s].status = CAMERA3_BUFFER_STATUS_OK;
+                bufs[s].acquire_fence = -1;
+                bufs[s].release_fence = -1;
+            }
+            memset(&request, 0, sizeof(request));
+            request.frame_number = mFrameNumber;
+            request.settings = ((f == 0) && withSettings) ? mSettings : NULL;
+            request.num_output_buffers = 2;
+            request.output_buffers = bufs;
+
+            pthread_mutex_lock(&mLock);
+            mPending = 3;
+            pthread_mutex_unlock(&mLock);
+            if (mDev->ops->process_capture_request(mDev, &request) != 0) {
+                return false;
+            }
+            pthread_mutex_lock(&mLock);
+            while (mPending > 0) {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_sec += REUSE_TEST_TIMEOUT;
+                if (pthread_cond_timedwait(&mCond, &mLock, &ts) == ETIMEDOUT) {
+                    done = false;
+                    break;
+                }
+            }
+            pthread_mutex_unlock(&mLock);
+            if (!done) {
+                return false;
+            }
+            mFrameNumber++;
+        }
+        return true;
+    }
+
+    /* Configure the streams again, run a frame on the new configuration
+     * and return the stream info buffers it mapped, -1 on failure */
+    int reconfigure(uint32_t opMode) {
+        uint32_t maps = __sync_fetch_and_add(&gStreamInfoMaps, 0);
+
+        if (configure(opMode) != 0) {
+            return -1;
+        }
+        // Settings go with the first request after a configuration
+        if (!runFrames(1, true)) {
+            return -1;
+        }
+        return (int)(__sync_fetch_and_add(&gStreamInfoMaps, 0) - maps);
+    }
+
+    static void processCaptureResult(const camera3_callback_ops_t *ops,
+            const camera3_capture_result_t *result) {
+        QCamera3StreamReuseTest *test = ((const Callbacks *)ops)->test;
+        uint32_t count = result->num_output_buffers;
+
+        pthread_mutex_lock(&test->mLock);
+        for (uint32_t i = 0; i < result->num_output_buffers; i++) {
+            if (result->output_buffers[i].status != CAMERA3_BUFFER_STATUS_OK) {
+                test->mErrors++;
+            }
+        }
+        if ((result->result != NULL) &&
+                (result->partial_result == test->mPartialCount)) {
+            count++;
+        }
+        if (result->frame_number == test->mFrameNumber) {
+            test->mPending = (test->mPending > count) ? test->mPending - count : 0;
+            pthread_cond_signal(&test->mCond);
+        }
+        pthread_mutex_unlock(&test->mLock);
+    }
+
+    static void notify(const camera3_callback_ops_t *ops,
+            const camera3_notify_msg_t *msg) {
+        QCamera3StreamReuseTest *test = ((const Callbacks *)ops)->test;
+
+        if (msg->type != CAMERA3_MSG_ERROR) {
+            return;
+        }
+        pthread_mutex_lock(&test->mLock);
+        test->mErrors++;
+        if ((msg->message.error.error_code == CAMERA3_MSG_ERROR_REQUEST) ||
+                (msg->message.error.error_code == CAMERA3_MSG_ERROR_RESULT)) {
+            // No final metadata follows for this frame
+            if (msg->message.error.frame_number == test->mFrameNumber) {
+                test->mPending = (test->mPending > 1) ? test->mPending - 1 : 0;
+            }
+        }
+        pthread_cond_signal(&test->mCond);
+        pthread_mutex_unlock(&test->mLock);
+    }
+};
+
+TEST_F(QCamera3StreamReuseTest, IdenticalConfigReused)
+{
+    camera3_stream_t *preview = &mStreams[0];
+    void *channel = preview->priv;
+    uint32_t halUsage = preview->usage;
+    uint32_t maxBuffers = preview->max_buffers;
+
+    // The framework hands back the usage the HAL set
+    EXPECT_EQ(0, reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE));
+    EXPECT_EQ(channel, preview->priv);
+    EXPECT_EQ(halUsage, preview->usage);
+    EXPECT_EQ(maxBuffers, preview->max_buffers);
+
+    // or resets it to the consumer usage
+    mStreams[0].usage = GRALLOC_USAGE_HW_TEXTURE;
+    mStreams[1].usage = GRALLOC_USAGE_HW_VIDEO_ENCODER;
+    EXPECT_EQ(0, reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE));
+    EXPECT_EQ(halUsage, preview->usage);
+    EXPECT_EQ(0U, mErrors);
+}
+
+TEST_F(QCamera3StreamReuseTest, ChangedUsageRebuilt)
+{
+    mStreams[0].usage = GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_COMPOSER;
+    EXPECT_GE(reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE), 2);
+
+    // The new usage is kept from here on
+    EXPECT_EQ(0, reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE));
+    EXPECT_EQ(0U, mErrors);
+}
+
+TEST_F(QCamera3StreamReuseTest, ChangedOperationModeRebuilt)
+{
+    const uint32_t vendorMode = CAMERA3_VENDOR_STREAM_CONFIGURATION_MODE_START;
+
+    EXPECT_GE(reconfigure(vendorMode), 2);
+    EXPECT_EQ(0, reconfigure(vendorMode));
+    EXPECT_GE(reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE), 2);
+    EXPECT_EQ(0U, mErrors);
+}
+
+TEST_F(QCamera3StreamReuseTest, ChangedStreamSetRebuilt)
+{
+    // Same size and usage, but another stream object
+    camera3_stream_t other = mStreams[1];
+
+    other.priv = NULL;
+    mStreamList[1] = &other;
+    EXPECT_GE(reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE), 2);
+    // The HAL holds on to the stream until close
+    close();
+}
+
+TEST_F(QCamera3StreamReuseTest, ReuseDisabledByProperty)
+{
+    close();
+    gStreamReuseProp = "0";
+    ASSERT_NO_FATAL_FAILURE(open());
+    gStreamReuseProp = "1";
+    EXPECT_GE(reconfigure(CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE), 2);
+}
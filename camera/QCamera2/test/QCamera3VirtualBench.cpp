@@ -0,0 +1,736 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* End to end benchmark of the HAL3 on the virtual sensor.
+ *
+ * Opens the camera HAL module like the camera service does, configures a
+ * preview and a video stream and records at a fixed 30, 60 and 120 fps
+ * range, one session per rate. The virtual sensor of mm-camera-interface
+ * follows the requested rate, so the whole HAL3 pipeline (request
+ * handling, channels, streams, poll threads and the result path) runs
+ * without the msm nodes or the mm-camera daemon.
+ *
+ * Per rate it reports the achieved fps, the request to result latency
+ * (p50/p90/p99/max, time from process_capture_request to the last buffer
+ * and final metadata of the frame), the process CPU time per frame and
+ * in % of one core, and the heap growth over the measured frames.
+ *
+ * The same is then measured at 60 and 120 fps with video batching
+ * (persist.camera.video.batch) off and on. These sessions request
+ * preview with every BENCH_VIDEO_BATCH-th video frame only, as the
+ * camera service builds high speed request lists, so that a batch is not
+ * closed early by the next preview buffer. The virtual sensor returns a
+ * batch once all its frames are captured, so the batched rows show the
+ * CPU the HAL saves per frame against the latency a batch adds.
+ *
+ * It then times session startup over a number of cycles, with a JPEG
+ * stream configured next to preview and video: open to the first frame
+ * (open, initialize, configure_streams and the first request), and an
+ * identical configure_streams to the first frame on the new configuration.
+ * This runs once with stream reuse and the warm mm-jpeg object disabled
+ * (persist.camera.stream.reuse=0, persist.camera.jpeg.warm_idle_ms=0) and
+ * once with both enabled. The first open of a run finds no warm jpeg
+ * object and is reported on its own.
+ *
+ * Needs a build with TARGET_CAMERA_VIRTUAL_SENSOR := true and
+ * persist.camera.virtual.sensor >= 1, with the capability blob of the
+ * camera in persist.camera.virtual.dir. property_get() is replaced to
+ * force the properties compared above, every other property is read as
+ * usual.
+ *
+ * usage: qcamera3_virtual_bench [camera_id] [frames_per_rate] [startup_cycles] */
+
+// System dependencies
+#include <algorithm>
+#include <cutils/properties.h>
+#include <errno.h>
+#include <malloc.h>
+#include <map>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/system_properties.h>
+#include <time.h>
+#include <vector>
+
+// Camera dependencies
+#include "hardware/camera3.h"
+#include "hardware/gralloc.h"
+#include "system/camera_metadata.h"
+
+#define BENCH_WIDTH          1920
+#define BENCH_HEIGHT         1080
+#define BENCH_WARMUP_FRAMES  30
+#define BENCH_MAX_INFLIGHT   64
+#define BENCH_RESULT_TIMEOUT 5 // seconds
+#define BENCH_VIDEO_BATCH    4 // requests per batch when batching is on
+
+typedef struct {
+    uint32_t frameNumber;
+    int64_t submitNs;
+    uint32_t pending;       // buffers and final metadata still to come
+} bench_frame_t;
+
+typedef struct {
+    camera3_stream_t stream;
+    std::vector<buffer_handle_t> handles;
+    std::vector<buffer_handle_t *> free;
+} bench_stream_t;
+
+typedef struct bench_ctx {
+    camera3_callback_ops_t ops;     // first, the callbacks cast back to it
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bench_stream_t streams[2];
+    bench_frame_t frames[BENCH_MAX_INFLIGHT];
+    uint32_t partialCount;
+    uint32_t inflight;
+    uint32_t completed;
+    uint32_t errors;
+    bool deviceError;
+    std::vector<int64_t> latencyNs;
+} bench_ctx_t;
+
+static std::map<std::string, std::string> gPropOverrides;
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    std::map<std::string, std::string>::const_iterator it = gPropOverrides.find(key);
+    if (it != gPropOverrides.end()) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", it->second.c_str());
+    } else {
+        len = __system_property_get(key, value);
+    }
+    if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+static int64_t now_ns(clockid_t clock = CLOCK_MONOTONIC)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static int64_t cpu_ns()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ((int64_t)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000LL +
+            ((int64_t)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+/* Called with ctx->lock held */
+static void frame_done(bench_ctx_t *ctx, bench_frame_t *frame, uint32_t count)
+{
+    if (frame->pending < count) {
+        frame->pending = 0;
+    } else {
+        frame->pending -= count;
+    }
+    if (frame->pending == 0) {
+        if (ctx->latencyNs.size() < ctx->latencyNs.capacity()) {
+            ctx->latencyNs.push_back(now_ns() - frame->submitNs);
+        }
+        ctx->inflight--;
+        ctx->completed++;
+        pthread_cond_signal(&ctx->cond);
+    }
+}
+
+static void process_capture_result(const camera3_callback_ops_t *ops,
+        const camera3_capture_result_t *result)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)ops;
+    bench_frame_t *frame = &ctx->frames[result->frame_number % BENCH_MAX_INFLIGHT];
+    uint32_t count = result->num_output_buffers;
+
+    pthread_mutex_lock(&ctx->lock);
+    for (uint32_t i = 0; i < result->num_output_buffers; i++) {
+        const camera3_stream_buffer_t *buf = &result->output_buffers[i];
+        for (uint32_t s = 0; s < 2; s++) {
+            if (buf->stream == &ctx->streams[s].stream) {
+                ctx->streams[s].free.push_back(buf->buffer);
+            }
+        }
+        if (buf->status != CAMERA3_BUFFER_STATUS_OK) {
+            ctx->errors++;
+        }
+    }
+    if ((result->result != NULL) && (result->partial_result == ctx->partialCount)) {
+        count++;
+    }
+    if ((frame->frameNumber == result->frame_number) && (count > 0)) {
+        frame_done(ctx, frame, count);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static void notify(const camera3_callback_ops_t *ops, const camera3_notify_msg_t *msg)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)ops;
+
+    if (msg->type != CAMERA3_MSG_ERROR) {
+        return;
+    }
+    pthread_mutex_lock(&ctx->lock);
+    ctx->errors++;
+    switch (msg->message.error.error_code) {
+    case CAMERA3_MSG_ERROR_DEVICE:
+        ctx->deviceError = true;
+        pthread_cond_signal(&ctx->cond);
+        break;
+    case CAMERA3_MSG_ERROR_REQUEST:
+    case CAMERA3_MSG_ERROR_RESULT: {
+        // No final metadata follows for this frame
+        bench_frame_t *frame =
+                &ctx->frames[msg->message.error.frame_number % BENCH_MAX_INFLIGHT];
+        if (frame->frameNumber == msg->message.error.frame_number) {
+            frame_done(ctx, frame, 1);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static int alloc_buffers(alloc_device_t *alloc, bench_stream_t *s)
+{
+    for (uint32_t i = 0; i < s->stream.max_buffers; i++) {
+        buffer_handle_t handle = NULL;
+        int stride = 0;
+        if (alloc->alloc(alloc, (int)s->stream.width, (int)s->stream.height,
+                s->stream.format, (int)s->stream.usage, &handle, &stride) != 0) {
+            fprintf(stderr, "gralloc alloc failed\n");
+            return -1;
+        }
+        s->handles.push_back(handle);
+    }
+    // Pointers into handles stay valid, it is not resized anymore
+    for (size_t i = 0; i < s->handles.size(); i++) {
+        s->free.push_back(&s->handles[i]);
+    }
+    return 0;
+}
+
+static camera_metadata_t *make_settings(camera3_device_t *dev, int32_t fps)
+{
+    const camera_metadata_t *tmpl =
+            dev->ops->construct_default_request_settings(dev, CAMERA3_TEMPLATE_VIDEO_RECORD);
+    int32_t range[2] = { fps, fps };
+    camera_metadata_entry_t entry;
+
+    if (tmpl == NULL) {
+        return NULL;
+    }
+    camera_metadata_t *settings = allocate_camera_metadata(
+            get_camera_metadata_entry_count(tmpl) + 1,
+            get_camera_metadata_data_count(tmpl) + sizeof(range));
+    if ((settings == NULL) || (append_camera_metadata(settings, tmpl) != 0)) {
+        free_camera_metadata(settings);
+        return NULL;
+    }
+    if (find_camera_metadata_entry(settings, ANDROID_CONTROL_AE_TARGET_FPS_RANGE,
+            &entry) == 0) {
+        update_camera_metadata_entry(settings, entry.index, range, 2, NULL);
+    } else {
+        add_camera_metadata_entry(settings, ANDROID_CONTROL_AE_TARGET_FPS_RANGE,
+                range, 2);
+    }
+    return settings;
+}
+
+/* Record at a fixed rate, with preview in every previewEvery-th request
+ * and video batching set to batch (0 is off) */
+static int run(camera_module_t *module, alloc_device_t *alloc, int cameraId,
+        int32_t fps, uint32_t frames, uint32_t batch, uint32_t previewEvery)
+{
+    char id[8];
+    hw_device_t *hwDev = NULL;
+    camera3_device_t *dev;
+    camera_metadata_t *settings = NULL;
+    camera3_stream_t *streamList[2];
+    camera3_stream_configuration_t config;
+    bench_ctx_t *ctx = new bench_ctx_t();
+    uint32_t submitted = 0, measured = 0;
+    int64_t startNs = 0, startCpuNs = 0, wallNs, cpuNs;
+    size_t startHeap = 0;
+    long heapGrowth;
+    int rc = -1;
+
+    ctx->ops.process_capture_result = process_capture_result;
+    ctx->ops.notify = notify;
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->cond, NULL);
+    ctx->latencyNs.reserve(frames);
+    gPropOverrides["persist.camera.video.batch"] = std::to_string(batch);
+
+    struct camera_info info;
+    camera_metadata_ro_entry_t entry;
+    ctx->partialCount = 1;
+    if ((module->get_camera_info(cameraId, &info) == 0) &&
+            (find_camera_metadata_ro_entry(info.static_camera_characteristics,
+            ANDROID_REQUEST_PARTIAL_RESULT_COUNT, &entry) == 0)) {
+        ctx->partialCount = (uint32_t)entry.data.i32[0];
+    }
+
+    snprintf(id, sizeof(id), "%d", cameraId);
+    if ((module->common.methods->open(&module->common, id, &hwDev) != 0) ||
+            (hwDev == NULL)) {
+        fprintf(stderr, "cannot open camera %s\n", id);
+        goto done;
+    }
+    dev = (camera3_device_t *)hwDev;
+    if (dev->ops->initialize(dev, &ctx->ops) != 0) {
+        fprintf(stderr, "initialize failed\n");
+        goto close;
+    }
+
+    for (uint32_t s = 0; s < 2; s++) {
+        camera3_stream_t *stream = &ctx->streams[s].stream;
+        stream->stream_type = CAMERA3_STREAM_OUTPUT;
+        stream->width = BENCH_WIDTH;
+        stream->height = BENCH_HEIGHT;
+        stream->format = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
+        stream->usage = (s == 0) ? GRALLOC_USAGE_HW_TEXTURE :
+                GRALLOC_USAGE_HW_VIDEO_ENCODER;
+        streamList[s] = stream;
+    }
+    memset(&config, 0, sizeof(config));
+    config.num_streams = 2;
+    config.streams = streamList;
+    config.operation_mode = CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE;
+    if (dev->ops->configure_streams(dev, &config) != 0) {
+        fprintf(stderr, "configure_streams failed\n");
+        goto close;
+    }
+    if ((alloc_buffers(alloc, &ctx->streams[0]) != 0) ||
+            (alloc_buffers(alloc, &ctx->streams[1]) != 0)) {
+        goto close;
+    }
+    settings = make_settings(dev, fps);
+    if (settings == NULL) {
+        fprintf(stderr, "cannot build the request settings\n");
+        goto close;
+    }
+
+    while (submitted < frames + BENCH_WARMUP_FRAMES) {
+        camera3_stream_buffer_t bufs[2];
+        camera3_capture_request_t request;
+        bench_frame_t *frame;
+        // Video in every request, preview in every previewEvery-th
+        uint32_t first = ((submitted % previewEvery) == 0) ? 0 : 1;
+
+        pthread_mutex_lock(&ctx->lock);
+        while (!ctx->deviceError && ((ctx->inflight >= BENCH_MAX_INFLIGHT) ||
+                ((first == 0) && ctx->streams[0].free.empty()) ||
+                ctx->streams[1].free.empty())) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += BENCH_RESULT_TIMEOUT;
+            if (pthread_cond_timedwait(&ctx->cond, &ctx->lock, &ts) == ETIMEDOUT) {
+                ctx->deviceError = true;
+                fprintf(stderr, "no result for %d s\n", BENCH_RESULT_TIMEOUT);
+            }
+        }
+        if (ctx->deviceError) {
+            pthread_mutex_unlock(&ctx->lock);
+            goto flush;
+        }
+        for (uint32_t s = first; s < 2; s++) {
+            bufs[s - first].stream = &ctx->streams[s].stream;
+            bufs[s - first].buffer = ctx->streams[s].free.back();
+            bufs[s - first].status = CAMERA3_BUFFER_STATUS_OK;
+            bufs[s - first].acquire_fence = -1;
+            bufs[s - first].release_fence = -1;
+            ctx->streams[s].free.pop_back();
+        }
+        frame = &ctx->frames[submitted % BENCH_MAX_INFLIGHT];
+        frame->frameNumber = submitted;
+        frame->pending = 3 - first;     // buffers and final metadata
+        ctx->inflight++;
+        if (submitted == BENCH_WARMUP_FRAMES) {
+            // Steady state from here on
+            startNs = now_ns();
+            startCpuNs = cpu_ns();
+            startHeap = mallinfo().uordblks;
+            ctx->latencyNs.clear();
+            measured = ctx->completed;
+        }
+        frame->submitNs = now_ns();
+        pthread_mutex_unlock(&ctx->lock);
+
+        memset(&request, 0, sizeof(request));
+        request.frame_number = submitted;
+        // Settings only change with the first request, as the service does
+        request.settings = (submitted == 0) ? settings : NULL;
+        request.num_output_buffers = 2 - first;
+        request.output_buffers = bufs;
+        if (dev->ops->process_capture_request(dev, &request) != 0) {
+            fprintf(stderr, "request %u failed\n", submitted);
+            pthread_mutex_lock(&ctx->lock);
+            ctx->inflight--;
+            for (uint32_t s = first; s < 2; s++) {
+                ctx->streams[s].free.push_back(bufs[s - first].buffer);
+            }
+            pthread_mutex_unlock(&ctx->lock);
+            goto flush;
+        }
+        submitted++;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    measured = ctx->completed - measured;
+    wallNs = now_ns() - startNs;
+    cpuNs = cpu_ns() - startCpuNs;
+    heapGrowth = (long)mallinfo().uordblks - (long)startHeap;
+    std::sort(ctx->latencyNs.begin(), ctx->latencyNs.end());
+    if (!ctx->latencyNs.empty() && (measured > 0)) {
+        size_t n = ctx->latencyNs.size();
+        printf("%3d fps, batch %u, preview 1/%u: %6.1f fps achieved, "
+                "latency p50 %.2f p90 %.2f p99 %.2f max %.2f ms, "
+                "cpu %.1f us/frame (%.1f%% of a core), heap %+ld B (%+.1f B/frame), "
+                "%u errors\n",
+                fps, batch, previewEvery, measured * 1e9 / wallNs,
+                ctx->latencyNs[n / 2] / 1e6, ctx->latencyNs[n * 9 / 10] / 1e6,
+                ctx->latencyNs[n * 99 / 100] / 1e6, ctx->latencyNs[n - 1] / 1e6,
+                cpuNs / 1e3 / measured, cpuNs * 100.0 / wallNs,
+                heapGrowth, (double)heapGrowth / measured, ctx->errors);
+        rc = 0;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+flush:
+    dev->ops->flush(dev);
+close:
+    hwDev->close(hwDev);
+done:
+    free_camera_metadata(settings);
+    for (uint32_t s = 0; s < 2; s++) {
+        for (size_t i = 0; i < ctx->streams[s].handles.size(); i++) {
+            alloc->free(alloc, ctx->streams[s].handles[i]);
+        }
+    }
+    pthread_cond_destroy(&ctx->cond);
+    pthread_mutex_destroy(&ctx->lock);
+    delete ctx;
+    return rc;
+}
+
+/* Largest JPEG output size of the camera, false if it has none */
+static bool find_jpeg_size(const struct camera_info *info, uint32_t *width,
+        uint32_t *height)
+{
+    camera_metadata_ro_entry_t entry;
+    int64_t area = 0;
+
+    if (find_camera_metadata_ro_entry(info->static_camera_characteristics,
+            ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS, &entry) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i + 3 < entry.count; i += 4) {
+        const int32_t *config = &entry.data.i32[i];
+        if ((config[0] == HAL_PIXEL_FORMAT_BLOB) &&
+                (config[3] == ANDROID_SCALER_AVAILABLE_STREAM_CONFIGURATIONS_OUTPUT) &&
+                ((int64_t)config[1] * config[2] > area)) {
+            *width = (uint32_t)config[1];
+            *height = (uint32_t)config[2];
+            area = (int64_t)config[1] * config[2];
+        }
+    }
+    return area > 0;
+}
+
+/* Submit one preview + video request and wait until it completes */
+static int run_frame(camera3_device_t *dev, bench_ctx_t *ctx, uint32_t frameNumber,
+        const camera_metadata_t *settings)
+{
+    camera3_stream_buffer_t bufs[2];
+    camera3_capture_request_t request;
+    bench_frame_t *frame = &ctx->frames[frameNumber % BENCH_MAX_INFLIGHT];
+    uint32_t completed;
+    int rc;
+
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->streams[0].free.empty() || ctx->streams[1].free.empty()) {
+        pthread_mutex_unlock(&ctx->lock);
+        return -1;
+    }
+    for (uint32_t s = 0; s < 2; s++) {
+        bufs[s].stream = &ctx->streams[s].stream;
+        bufs[s].buffer = ctx->streams[s].free.back();
+        bufs[s].status = CAMERA3_BUFFER_STATUS_OK;
+        bufs[s].acquire_fence = -1;
+        bufs[s].release_fence = -1;
+        ctx->streams[s].free.pop_back();
+    }
+    frame->frameNumber = frameNumber;
+    frame->pending = 3;
+    frame->submitNs = now_ns();
+    ctx->inflight++;
+    completed = ctx->completed;
+    pthread_mutex_unlock(&ctx->lock);
+
+    memset(&request, 0, sizeof(request));
+    request.frame_number = frameNumber;
+    request.settings = settings;
+    request.num_output_buffers = 2;
+    request.output_buffers = bufs;
+    if (dev->ops->process_capture_request(dev, &request) != 0) {
+        fprintf(stderr, "request %u failed\n", frameNumber);
+        pthread_mutex_lock(&ctx->lock);
+        ctx->inflight--;
+        ctx->streams[0].free.push_back(bufs[0].buffer);
+        ctx->streams[1].free.push_back(bufs[1].buffer);
+        pthread_mutex_unlock(&ctx->lock);
+        return -1;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    while (!ctx->deviceError && (ctx->completed == completed)) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += BENCH_RESULT_TIMEOUT;
+        if (pthread_cond_timedwait(&ctx->cond, &ctx->lock, &ts) == ETIMEDOUT) {
+            ctx->deviceError = true;
+            fprintf(stderr, "no result for %d s\n", BENCH_RESULT_TIMEOUT);
+        }
+    }
+    rc = ctx->deviceError ? -1 : 0;
+    pthread_mutex_unlock(&ctx->lock);
+    return rc;
+}
+
+/* Open to first frame and reconfigure to first frame over a number of
+ * sessions, with stream reuse and the warm jpeg object on or off */
+static int startup(camera_module_t *module, alloc_device_t *alloc, int cameraId,
+        bool warm, uint32_t cycles)
+{
+    char id[8];
+    bench_ctx_t *ctx = new bench_ctx_t();
+    camera3_stream_t jpeg;
+    camera3_stream_t *streamList[3];
+    camera3_stream_configuration_t config;
+    struct camera_info info;
+    camera_metadata_ro_entry_t entry;
+    std::vector<int64_t> openNs, reconfigNs;
+    uint32_t frameNumber = 0;
+    bool hasJpeg = false;
+    int rc = 0;
+
+    // A batching device never reuses the streams of a video session
+    gPropOverrides["persist.camera.video.batch"] = "0";
+    gPropOverrides["persist.camera.stream.reuse"] = warm ? "1" : "0";
+    if (warm) {
+        gPropOverrides.erase("persist.camera.jpeg.warm_idle_ms");
+    } else {
+        gPropOverrides["persist.camera.jpeg.warm_idle_ms"] = "0";
+    }
+
+    ctx->ops.process_capture_result = process_capture_result;
+    ctx->ops.notify = notify;
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->cond, NULL);
+    ctx->partialCount = 1;
+    memset(&jpeg, 0, sizeof(jpeg));
+    if (module->get_camera_info(cameraId, &info) == 0) {
+        if (find_camera_metadata_ro_entry(info.static_camera_characteristics,
+                ANDROID_REQUEST_PARTIAL_RESULT_COUNT, &entry) == 0) {
+            ctx->partialCount = (uint32_t)entry.data.i32[0];
+        }
+        hasJpeg = find_jpeg_size(&info, &jpeg.width, &jpeg.height);
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.streams = streamList;
+    config.operation_mode = CAMERA3_STREAM_CONFIGURATION_NORMAL_MODE;
+    snprintf(id, sizeof(id), "%d", cameraId);
+    for (uint32_t c = 0; (c < cycles) && (rc == 0); c++) {
+        hw_device_t *hwDev = NULL;
+        camera3_device_t *dev;
+        camera_metadata_t *settings = NULL;
+        int64_t startNs;
+
+        // Streams of a new session, as the camera service creates them
+        config.num_streams = 0;
+        for (uint32_t s = 0; s < 2; s++) {
+            camera3_stream_t *stream = &ctx->streams[s].stream;
+            stream->stream_type = CAMERA3_STREAM_OUTPUT;
+            stream->width = BENCH_WIDTH;
+            stream->height = BENCH_HEIGHT;
+            stream->format = HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED;
+            stream->usage = (s == 0) ? GRALLOC_USAGE_HW_TEXTURE :
+                    GRALLOC_USAGE_HW_VIDEO_ENCODER;
+            stream->priv = NULL;
+            streamList[config.num_streams++] = stream;
+        }
+        if (hasJpeg) {
+            jpeg.stream_type = CAMERA3_STREAM_OUTPUT;
+            jpeg.format = HAL_PIXEL_FORMAT_BLOB;
+            jpeg.usage = GRALLOC_USAGE_SW_READ_OFTEN;
+            jpeg.priv = NULL;
+            streamList[config.num_streams++] = &jpeg;
+        }
+
+        startNs = now_ns();
+        if ((module->common.methods->open(&module->common, id, &hwDev) != 0) ||
+                (hwDev == NULL)) {
+            fprintf(stderr, "cannot open camera %s\n", id);
+            rc = -1;
+            break;
+        }
+        dev = (camera3_device_t *)hwDev;
+        if ((dev->ops->initialize(dev, &ctx->ops) != 0) ||
+                (dev->ops->configure_streams(dev, &config) != 0)) {
+            fprintf(stderr, "cannot configure camera %s\n", id);
+            rc = -1;
+        }
+        if ((rc == 0) && ctx->streams[0].handles.empty() &&
+                ((alloc_buffers(alloc, &ctx->streams[0]) != 0) ||
+                (alloc_buffers(alloc, &ctx->streams[1]) != 0))) {
+            rc = -1;
+        }
+        if (rc == 0) {
+            settings = make_settings(dev, 30);
+            rc = (settings != NULL) ? run_frame(dev, ctx, frameNumber++, settings) : -1;
+        }
+        if (rc == 0) {
+            openNs.push_back(now_ns() - startNs);
+            // The camera service hands back the usage the HAL set
+            startNs = now_ns();
+            rc = dev->ops->configure_streams(dev, &config);
+        }
+        if (rc == 0) {
+            rc = run_frame(dev, ctx, frameNumber++, settings);
+        }
+        if (rc == 0) {
+            reconfigNs.push_back(now_ns() - startNs);
+        }
+
+        dev->ops->flush(dev);
+        hwDev->close(hwDev);
+        free_camera_metadata(settings);
+    }
+
+    if ((rc == 0) && !openNs.empty()) {
+        std::vector<int64_t> warmOpenNs(openNs.begin() + 1, openNs.end());
+        std::sort(warmOpenNs.begin(), warmOpenNs.end());
+        std::sort(reconfigNs.begin(), reconfigNs.end());
+        printf("startup, stream reuse and jpeg warm %s, %u cycles%s:\n",
+                warm ? "on" : "off", cycles, hasJpeg ? "" : " (no JPEG stream)");
+        printf("  open to first frame: first %.2f ms", openNs[0] / 1e6);
+        if (!warmOpenNs.empty()) {
+            printf(", then p50 %.2f max %.2f ms", warmOpenNs[warmOpenNs.size() / 2] / 1e6,
+                    warmOpenNs.back() / 1e6);
+        }
+        printf("\n  reconfigure to first frame: p50 %.2f max %.2f ms\n",
+                reconfigNs[reconfigNs.size() / 2] / 1e6, reconfigNs.back() / 1e6);
+    }
+
+    for (uint32_t s = 0; s < 2; s++) {
+        for (size_t i = 0; i < ctx->streams[s].handles.size(); i++) {
+            alloc->free(alloc, ctx->streams[s].handles[i]);
+        }
+    }
+    pthread_cond_destroy(&ctx->cond);
+    pthread_mutex_destroy(&ctx->lock);
+    delete ctx;
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int32_t rates[] = { 30, 60, 120 };
+    static const int32_t batchRates[] = { 60, 120 };
+    int cameraId = (argc > 1) ? atoi(argv[1]) : 0;
+    int frames = (argc > 2) ? atoi(argv[2]) : 600;
+    int cycles = (argc > 3) ? atoi(argv[3]) : 10;
+    const hw_module_t *hwModule = NULL;
+    alloc_device_t *alloc = NULL;
+    int rc = 0;
+
+    if ((frames <= 0) || (cycles < 0)) {
+        fprintf(stderr, "usage: %s [camera_id] [frames_per_rate] [startup_cycles]\n",
+                argv[0]);
+        return 2;
+    }
+    if (hw_get_module(CAMERA_HARDWARE_MODULE_ID, &hwModule) != 0) {
+        fprintf(stderr, "FAIL: no camera HAL module\n");
+        return 1;
+    }
+    camera_module_t *module = (camera_module_t *)hwModule;
+    if (module->get_number_of_cameras() <= cameraId) {
+        fprintf(stderr, "FAIL: no camera %d, is persist.camera.virtual.sensor set?\n",
+                cameraId);
+        return 1;
+    }
+    if ((hw_get_module(GRALLOC_HARDWARE_MODULE_ID, &hwModule) != 0) ||
+            (gralloc_open(hwModule, &alloc) != 0)) {
+        fprintf(stderr, "FAIL: no gralloc\n");
+        return 1;
+    }
+
+    printf("camera %d, %dx%d preview + video, %d frames per rate\n",
+            cameraId, BENCH_WIDTH, BENCH_HEIGHT, frames);
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (run(module, alloc, cameraId, rates[i], (uint32_t)frames, 0, 1) != 0) {
+            fprintf(stderr, "FAIL: %d fps\n", rates[i]);
+            rc = 1;
+        }
+    }
+    for (size_t i = 0; i < sizeof(batchRates) / sizeof(batchRates[0]); i++) {
+        for (uint32_t batch = 0; batch <= BENCH_VIDEO_BATCH; batch += BENCH_VIDEO_BATCH) {
+            if (run(module, alloc, cameraId, batchRates[i], (uint32_t)frames, batch,
+                    BENCH_VIDEO_BATCH) != 0) {
+                fprintf(stderr, "FAIL: %d fps, batch %u\n", batchRates[i], batch);
+                rc = 1;
+            }
+        }
+    }
+    // Without reuse first, so that the first open with it finds no warm
+    // jpeg object either
+    for (int warm = 0; (warm < 2) && (cycles > 0); warm++) {
+        if (startup(module, alloc, cameraId, warm != 0, (uint32_t)cycles) != 0) {
+            fprintf(stderr, "FAIL: startup, stream reuse and jpeg warm %s\n",
+                    warm ? "on" : "off");
+            rc = 1;
+        }
+    }
+    gralloc_close(alloc);
+    return rc;
+}
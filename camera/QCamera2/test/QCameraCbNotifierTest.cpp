@@ -0,0 +1,302 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Unit tests of the callback lanes of QCameraCbNotifier.
+ *
+ * The app preview data callback is made deliberately slow, slower than the
+ * preview frame rate, while shutter notifies and video frames come in. The
+ * shutter must be handed to the app within one preview callback however
+ * many preview frames arrived before it, preview frames the app has not
+ * been handed yet must be superseded by the newest one, and every frame
+ * must be released exactly once: after its callback, or with
+ * FAILED_TRANSACTION when superseded or flushed.
+ *
+ * QCameraCbNotifier only asks its HWI whether a message is enabled; that
+ * and the calls of the snapshot path are replaced below. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// Camera dependencies
+#include "QCamera2HWI.h"
+
+using namespace android;
+using namespace qcamera;
+
+namespace qcamera {
+
+// Normally defined by QCamera2Factory.cpp
+volatile uint32_t gKpiDebugLevel = 0;
+
+int QCamera2HardwareInterface::msgTypeEnabledWithLock(int32_t /*msg_type*/)
+{
+    return 1;
+}
+
+int QCamera2HardwareInterface::processSyncEvt(qcamera_sm_evt_enum_t /*evt*/,
+        void * /*evt_payload*/)
+{
+    return NO_ERROR;
+}
+
+uint8_t QCameraParametersIntf::getNumOfSnapshots()
+{
+    return 1;
+}
+
+}; // namespace qcamera
+
+#define QCAMERA_TEST_PREVIEW_CB_US       20000 // slow app preview callback
+#define QCAMERA_TEST_PREVIEW_INTERVAL_US 5000  // preview frame interval
+#define QCAMERA_TEST_SLACK_US            10000 // scheduling slack
+#define QCAMERA_TEST_MAX_FRAMES          64
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+class QCameraCbNotifierTest : public ::testing::Test {
+protected:
+    QCameraCbNotifierTest() :
+            // only the overridden members above are called on the parent
+            mNotifier(reinterpret_cast<QCamera2HardwareInterface *>(&mParentStorage)),
+            mFrames(0),
+            mPreviewCbs(0),
+            mVideoCbs(0),
+            mDelivered(0),
+            mFailed(0),
+            mShutters(0),
+            mShutterMaxNs(0),
+            mLastVideo(-1)
+    {
+        for (uint32_t i = 0; i < QCAMERA_TEST_MAX_FRAMES; i++) {
+            mReleases[i] = 0;
+        }
+        mNotifier.setCallbacks(notifyCb, dataCb, timestampCb, this);
+    }
+
+    virtual ~QCameraCbNotifierTest()
+    {
+        mNotifier.exit();
+    }
+
+    /* the frame index is the cookie of the release callback */
+    void postFrame(qcamera_callback_type_m type, int32_t msgType)
+    {
+        qcamera_callback_argm_t cbArg;
+        ASSERT_LT(mFrames.load(), (uint32_t)QCAMERA_TEST_MAX_FRAMES);
+        memset(&cbArg, 0, sizeof(cbArg));
+        cbArg.cb_type = type;
+        cbArg.msg_type = msgType;
+        cbArg.index = mFrames;
+        cbArg.user_data = this;
+        cbArg.cookie = (void *)(uintptr_t)mFrames;
+        cbArg.release_cb = releaseCb;
+        mFrames++;
+        EXPECT_EQ(NO_ERROR, mNotifier.notifyCallback(cbArg));
+    }
+
+    void postShutter()
+    {
+        qcamera_callback_argm_t cbArg;
+        memset(&cbArg, 0, sizeof(cbArg));
+        cbArg.cb_type = QCAMERA_NOTIFY_CALLBACK;
+        cbArg.msg_type = CAMERA_MSG_SHUTTER;
+        mShutterPostNs = now_ns();
+        EXPECT_EQ(NO_ERROR, mNotifier.notifyCallback(cbArg));
+    }
+
+    /* waits until every frame posted is released */
+    bool waitReleased()
+    {
+        for (int i = 0; i < 500; i++) {
+            if ((mDelivered + mFailed) == mFrames) {
+                return true;
+            }
+            usleep(10000);
+        }
+        return false;
+    }
+
+    qcamera_cb_lane_stats_t laneStats(qcamera_cb_lane_t lane)
+    {
+        qcamera_cb_lane_stats_t stats[QCAMERA_CB_LANE_MAX];
+        mNotifier.getLaneStats(stats);
+        return stats[lane];
+    }
+
+    static void notifyCb(int32_t msgType, int32_t, int32_t, void *user)
+    {
+        QCameraCbNotifierTest *pme = (QCameraCbNotifierTest *)user;
+        if (CAMERA_MSG_SHUTTER == msgType) {
+            int64_t latency = now_ns() - pme->mShutterPostNs;
+            if (latency > pme->mShutterMaxNs) {
+                pme->mShutterMaxNs = latency;
+            }
+            pme->mShutters++;
+        }
+    }
+
+    static void dataCb(int32_t msgType, const camera_memory_t *, unsigned int,
+            camera_frame_metadata_t *, void *user)
+    {
+        QCameraCbNotifierTest *pme = (QCameraCbNotifierTest *)user;
+        if (CAMERA_MSG_PREVIEW_FRAME == msgType) {
+            pme->mPreviewCbs++;
+            usleep(QCAMERA_TEST_PREVIEW_CB_US);
+        }
+    }
+
+    static void timestampCb(nsecs_t, int32_t, const camera_memory_t *,
+            unsigned int index, void *user)
+    {
+        QCameraCbNotifierTest *pme = (QCameraCbNotifierTest *)user;
+        EXPECT_GT((int32_t)index, pme->mLastVideo);
+        pme->mLastVideo = (int32_t)index;
+        pme->mVideoCbs++;
+    }
+
+    static void releaseCb(void *userData, void *cookie, int32_t status)
+    {
+        QCameraCbNotifierTest *pme = (QCameraCbNotifierTest *)userData;
+        pme->mReleases[(uintptr_t)cookie]++;
+        if (NO_ERROR == status) {
+            pme->mDelivered++;
+        } else {
+            EXPECT_EQ(FAILED_TRANSACTION, status);
+            pme->mFailed++;
+        }
+    }
+
+    void expectReleasedOnce()
+    {
+        for (uint32_t i = 0; i < mFrames; i++) {
+            EXPECT_EQ(1, mReleases[i].load()) << "frame " << i;
+        }
+    }
+
+    uint64_t mParentStorage;
+    QCameraCbNotifier mNotifier;
+    std::atomic<uint32_t> mFrames;
+    std::atomic<int> mReleases[QCAMERA_TEST_MAX_FRAMES];
+    std::atomic<uint32_t> mPreviewCbs;
+    std::atomic<uint32_t> mVideoCbs;
+    std::atomic<uint32_t> mDelivered;
+    std::atomic<uint32_t> mFailed;
+    std::atomic<uint32_t> mShutters;
+    std::atomic<int64_t> mShutterPostNs;
+    std::atomic<int64_t> mShutterMaxNs;
+    int32_t mLastVideo;
+};
+
+TEST_F(QCameraCbNotifierTest, ShutterIsNotDelayedBySlowPreviewCallback)
+{
+    for (uint32_t f = 0; f < 40; f++) {
+        postFrame(QCAMERA_DATA_CALLBACK, CAMERA_MSG_PREVIEW_FRAME);
+        if ((f % 10) == 9) {
+            postShutter();
+        }
+        usleep(QCAMERA_TEST_PREVIEW_INTERVAL_US);
+    }
+    ASSERT_TRUE(waitReleased());
+
+    // at most the preview callback running when the shutter came
+    EXPECT_EQ(4u, mShutters.load());
+    EXPECT_LT(mShutterMaxNs.load(),
+            (QCAMERA_TEST_PREVIEW_CB_US + QCAMERA_TEST_SLACK_US) * 1000LL);
+    qcamera_cb_lane_stats_t control = laneStats(QCAMERA_CB_LANE_CONTROL);
+    EXPECT_EQ(4u, control.dispatched);
+    EXPECT_LT(control.max_delay_ns,
+            (QCAMERA_TEST_PREVIEW_CB_US + QCAMERA_TEST_SLACK_US) * 1000LL);
+
+    // the app keeps up with one in four frames, the others are superseded
+    qcamera_cb_lane_stats_t preview = laneStats(QCAMERA_CB_LANE_PREVIEW);
+    EXPECT_EQ(40u, preview.dispatched + preview.superseded);
+    EXPECT_EQ(mPreviewCbs.load(), preview.dispatched);
+    EXPECT_EQ(preview.dispatched, mDelivered.load());
+    EXPECT_EQ(preview.superseded, mFailed.load());
+    EXPECT_GE(preview.superseded, 20u);
+    EXPECT_LT(preview.max_delay_ns,
+            (QCAMERA_TEST_PREVIEW_CB_US + QCAMERA_TEST_SLACK_US) * 1000LL);
+    expectReleasedOnce();
+}
+
+TEST_F(QCameraCbNotifierTest, VideoFramesAreNotSuperseded)
+{
+    for (uint32_t f = 0; f < 20; f++) {
+        postFrame(QCAMERA_DATA_CALLBACK, CAMERA_MSG_PREVIEW_FRAME);
+        postFrame(QCAMERA_DATA_TIMESTAMP_CALLBACK, CAMERA_MSG_VIDEO_FRAME);
+        usleep(QCAMERA_TEST_PREVIEW_INTERVAL_US);
+    }
+    ASSERT_TRUE(waitReleased());
+
+    EXPECT_EQ(20u, mVideoCbs.load());
+    EXPECT_EQ(20u, laneStats(QCAMERA_CB_LANE_VIDEO).dispatched);
+    EXPECT_EQ(0u, laneStats(QCAMERA_CB_LANE_VIDEO).superseded);
+    qcamera_cb_lane_stats_t preview = laneStats(QCAMERA_CB_LANE_PREVIEW);
+    EXPECT_EQ(20u, preview.dispatched + preview.superseded);
+    EXPECT_EQ(20u + preview.dispatched, mDelivered.load());
+    EXPECT_EQ(preview.superseded, mFailed.load());
+    expectReleasedOnce();
+}
+
+TEST_F(QCameraCbNotifierTest, FlushReleasesWaitingPreviewFrame)
+{
+    // the first frame keeps the notify thread busy, the second waits
+    postFrame(QCAMERA_DATA_CALLBACK, CAMERA_MSG_PREVIEW_FRAME);
+    usleep(QCAMERA_TEST_PREVIEW_CB_US / 4);
+    postFrame(QCAMERA_DATA_CALLBACK, CAMERA_MSG_PREVIEW_FRAME);
+    EXPECT_EQ(NO_ERROR, mNotifier.flushPreviewNotifications());
+    EXPECT_EQ(1, mReleases[1].load());
+    ASSERT_TRUE(waitReleased());
+
+    EXPECT_EQ(1u, mPreviewCbs.load());
+    EXPECT_EQ(1u, mDelivered.load());
+    EXPECT_EQ(1u, mFailed.load());
+    expectReleasedOnce();
+}
+
+TEST_F(QCameraCbNotifierTest, ExitReleasesWaitingPreviewFrame)
+{
+    postFrame(QCAMERA_DATA_CALLBACK, CAMERA_MSG_PREVIEW_FRAME);
+    usleep(QCAMERA_TEST_PREVIEW_CB_US / 4);
+    postFrame(QCAMERA_DATA_CALLBACK, CAMERA_MSG_PREVIEW_FRAME);
+    mNotifier.exit();
+
+    EXPECT_EQ(2u, mDelivered + mFailed);
+    EXPECT_EQ(1u, mFailed.load());
+    expectReleasedOnce();
+}
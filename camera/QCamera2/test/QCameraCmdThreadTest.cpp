@@ -0,0 +1,240 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Ordering tests of QCameraCmdThread.
+ *
+ * Priority classes stand in for the HAL users: prioritized STOP_DATA_PROC
+ * and EXIT are urgent, snapshot work is sent with priority and preview
+ * frames without. Commands are pulled with getCmd() directly, so the
+ * order is deterministic; the last test runs a real consumer thread. */
+
+// System dependencies
+#include <atomic>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Camera dependencies
+#include "QCameraCmdThread.h"
+
+using namespace qcamera;
+
+#define SNAPSHOT_CMD CAMERA_CMD_TYPE_START_DATA_PROC
+#define PREVIEW_CMD  CAMERA_CMD_TYPE_DO_NEXT_JOB
+
+TEST(QCameraCmdThreadTest, FifoWithinClass)
+{
+    QCameraCmdThread th;
+
+    th.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+    th.sendCmd(CAMERA_CMD_TYPE_TIMEOUT, 0, 0);
+    th.sendCmd(CAMERA_CMD_TYPE_START_DATA_PROC, 0, 0);
+
+    EXPECT_EQ(CAMERA_CMD_TYPE_DO_NEXT_JOB, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_TIMEOUT, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_START_DATA_PROC, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+}
+
+TEST(QCameraCmdThreadTest, StopBeforeSnapshotBeforePreview)
+{
+    QCameraCmdThread th;
+
+    th.sendCmd(PREVIEW_CMD, 0, 0);
+    th.sendCmd(SNAPSHOT_CMD, 0, 1);
+    th.sendCmd(PREVIEW_CMD, 0, 0);
+    th.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, 0, 1);
+    th.sendCmd(SNAPSHOT_CMD, 0, 1);
+
+    EXPECT_EQ(CAMERA_CMD_TYPE_STOP_DATA_PROC, th.getCmd());
+    EXPECT_EQ(SNAPSHOT_CMD, th.getCmd());
+    EXPECT_EQ(SNAPSHOT_CMD, th.getCmd());
+    EXPECT_EQ(PREVIEW_CMD, th.getCmd());
+    EXPECT_EQ(PREVIEW_CMD, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+}
+
+TEST(QCameraCmdThreadTest, ExitIsUrgentWithoutPriorityFlag)
+{
+    QCameraCmdThread th;
+
+    th.sendCmd(SNAPSHOT_CMD, 0, 1);
+    th.sendCmd(CAMERA_CMD_TYPE_EXIT, 0, 0);
+
+    EXPECT_EQ(CAMERA_CMD_TYPE_EXIT, th.getCmd());
+    EXPECT_EQ(SNAPSHOT_CMD, th.getCmd());
+}
+
+TEST(QCameraCmdThreadTest, StopWithoutPriorityStaysInOrder)
+{
+    QCameraCmdThread th;
+
+    th.sendCmd(PREVIEW_CMD, 0, 0);
+    th.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, 0, 0);
+
+    EXPECT_EQ(PREVIEW_CMD, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_STOP_DATA_PROC, th.getCmd());
+}
+
+TEST(QCameraCmdThreadTest, HigherClassPreemptsDrainedBatch)
+{
+    QCameraCmdThread th;
+
+    // The first getCmd moves all three preview cmds into the local batch
+    th.sendCmd(PREVIEW_CMD, 0, 0);
+    th.sendCmd(CAMERA_CMD_TYPE_TIMEOUT, 0, 0);
+    th.sendCmd(PREVIEW_CMD, 0, 0);
+    EXPECT_EQ(PREVIEW_CMD, th.getCmd());
+
+    th.sendCmd(SNAPSHOT_CMD, 0, 1);
+    th.sendCmd(CAMERA_CMD_TYPE_STOP_DATA_PROC, 0, 1);
+    EXPECT_EQ(CAMERA_CMD_TYPE_STOP_DATA_PROC, th.getCmd());
+    EXPECT_EQ(SNAPSHOT_CMD, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_TIMEOUT, th.getCmd());
+    EXPECT_EQ(PREVIEW_CMD, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+}
+
+TEST(QCameraCmdThreadTest, BatchLargerThanLimit)
+{
+    QCameraCmdThread th;
+    camera_cmd_thread_stats_t stats;
+    uint32_t num = CAMERA_CMD_BATCH_MAX * 2 + 3;
+
+    for (uint32_t i = 0; i < num; i++) {
+        th.sendCmd((i & 1) ? CAMERA_CMD_TYPE_TIMEOUT : PREVIEW_CMD, 0, 0);
+    }
+    for (uint32_t i = 0; i < num; i++) {
+        EXPECT_EQ((i & 1) ? CAMERA_CMD_TYPE_TIMEOUT : PREVIEW_CMD, th.getCmd());
+    }
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+
+    th.getStats(stats);
+    EXPECT_EQ(num, stats.cmds_queued);
+    EXPECT_EQ((uint32_t)CAMERA_CMD_BATCH_MAX, stats.max_batch);
+    EXPECT_EQ(3u, stats.batches);
+}
+
+TEST(QCameraCmdThreadTest, StaleNextJobDropped)
+{
+    QCameraCmdThread th;
+    camera_cmd_thread_stats_t stats;
+
+    th.setCoalesceNextJob(true);
+    for (int i = 0; i < 10; i++) {
+        th.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+    }
+    th.sendCmd(CAMERA_CMD_TYPE_TIMEOUT, 0, 0);
+    th.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+
+    EXPECT_EQ(CAMERA_CMD_TYPE_DO_NEXT_JOB, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_TIMEOUT, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+
+    // Once the pending one is consumed the next one is queued again
+    th.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+    EXPECT_EQ(CAMERA_CMD_TYPE_DO_NEXT_JOB, th.getCmd());
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+
+    th.getStats(stats);
+    EXPECT_EQ(3u, stats.cmds_queued);
+    EXPECT_EQ(10u, stats.cmds_coalesced);
+}
+
+TEST(QCameraCmdThreadTest, NextJobKeptWithoutCoalescing)
+{
+    QCameraCmdThread th;
+
+    for (int i = 0; i < 10; i++) {
+        th.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+    }
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(CAMERA_CMD_TYPE_DO_NEXT_JOB, th.getCmd());
+    }
+    EXPECT_EQ(CAMERA_CMD_TYPE_NONE, th.getCmd());
+}
+
+typedef struct {
+    QCameraCmdThread *th;
+    std::atomic<uint32_t> jobs;
+    uint32_t done;
+    uint32_t wakeups;
+} consumer_ctx_t;
+
+static void *consumer_loop(void *data)
+{
+    consumer_ctx_t *ctx = (consumer_ctx_t *)data;
+    bool running = true;
+
+    while (running) {
+        cam_sem_wait(&ctx->th->cmd_sem);
+        switch (ctx->th->getCmd()) {
+        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
+            // Drain the whole job queue per wakeup, as the stream threads do
+            ctx->wakeups++;
+            ctx->done += ctx->jobs.exchange(0);
+            break;
+        case CAMERA_CMD_TYPE_EXIT:
+            running = false;
+            break;
+        default:
+            break;
+        }
+    }
+    return NULL;
+}
+
+TEST(QCameraCmdThreadTest, CoalescingLosesNoJobs)
+{
+    QCameraCmdThread th;
+    consumer_ctx_t ctx;
+    const uint32_t num = 200000;
+
+    ctx.th = &th;
+    ctx.jobs = 0;
+    ctx.done = 0;
+    ctx.wakeups = 0;
+    th.setCoalesceNextJob(true);
+    th.launch(consumer_loop, &ctx);
+
+    for (uint32_t i = 0; i < num; i++) {
+        ctx.jobs++;
+        th.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, 0, 0);
+    }
+    /* Let the last DO_NEXT_JOB through before the urgent EXIT. A job left
+     * behind by a dropped DO_NEXT_JOB would never be picked up */
+    for (int i = 0; (i < 5000) && (ctx.jobs.load() > 0); i++) {
+        usleep(1000);
+    }
+    th.exit();
+
+    EXPECT_EQ(0u, ctx.jobs.load());
+    EXPECT_EQ(num, ctx.done);
+    EXPECT_LE(ctx.wakeups, num);
+}
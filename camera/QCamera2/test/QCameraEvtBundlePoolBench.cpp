@@ -0,0 +1,359 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Metadata callback simulation for the internal events of the HAL1 state
+ * machine.
+ *
+ * A metadata thread produces one frame of internal events per frame
+ * interval: face detection, crop, ASD, AWB, AE, focus position and HDR,
+ * plus a focus update every QCAMERA_BENCH_FOCUS_EVERY frames. A state
+ * machine thread waits on the semaphore and dispatches each event with a
+ * fixed cost, below and above what the frame interval allows. Each run is
+ * done twice: per event, the way metadata_stream_cb_routine posted before,
+ * with a malloc'ed payload and queue node per event, and per frame through
+ * QCameraEvtBundlePool.
+ *
+ * Prints per run the time the metadata thread spends posting a frame, the
+ * heap allocations per frame, the nodes queued and coalesced, the deepest
+ * backlog of the queue and the average and max age of the AE update when
+ * the state machine dispatches it.
+ *
+ * usage: qcamera_evt_bundle_bench [frames] [frame_interval_us] */
+
+// System dependencies
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraStateMachine.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define QCAMERA_BENCH_FOCUS_EVERY 4
+
+static const qcamera_internal_evt_type_t gFrameEvts[] = {
+    QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT,
+    QCAMERA_INTERNAL_EVT_CROP_INFO,
+    QCAMERA_INTERNAL_EVT_ASD_UPDATE,
+    QCAMERA_INTERNAL_EVT_AWB_UPDATE,
+    QCAMERA_INTERNAL_EVT_AE_UPDATE,
+    QCAMERA_INTERNAL_EVT_FOCUS_POS_UPDATE,
+    QCAMERA_INTERNAL_EVT_HDR_UPDATE,
+};
+
+static const uint32_t gDispatchUs[] = { 0, 2000, 8000 };
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadlineNs)
+{
+    int64_t left = deadlineNs - now_ns();
+    if (left > 0) {
+        usleep((useconds_t)(left / 1000));
+    }
+}
+
+class EvtBench {
+public:
+    EvtBench(uint32_t frames, uint32_t intervalUs, uint32_t dispatchUs,
+            bool bundled) :
+            mFrames(frames),
+            mIntervalUs(intervalUs),
+            mDispatchUs(dispatchUs),
+            mBundled(bundled),
+            mQueue(),
+            mPool(&mQueue, &mSem),
+            mPostNs(frames, 0),
+            mHeapAllocs(0),
+            mQueued(0),
+            mDequeued(0),
+            mMaxBacklog(0),
+            mCbNs(0),
+            mCbMaxNs(0),
+            mAeCount(0),
+            mAeAgeNs(0),
+            mAeMaxAgeNs(0)
+    {
+        cam_sem_init(&mSem, 0);
+    }
+
+    ~EvtBench()
+    {
+        cam_sem_destroy(&mSem);
+    }
+
+    void run()
+    {
+        pthread_t smTh;
+        pthread_create(&smTh, NULL, smRoutine, this);
+
+        int64_t startNs = now_ns() + 1000000LL;
+        for (uint32_t f = 0; f < mFrames; f++) {
+            sleep_until(startNs + (int64_t)f * mIntervalUs * 1000LL);
+            int64_t t = now_ns();
+            mPostNs[f] = t;
+            if (mBundled) {
+                postBundle(f);
+            } else {
+                postEvts(f);
+            }
+            int64_t spent = now_ns() - t;
+            mCbNs += spent;
+            if (spent > mCbMaxNs) {
+                mCbMaxNs = spent;
+            }
+            if (mBundled) {
+                qcamera_sm_evt_bundle_stats_t stats;
+                mPool.getStats(&stats);
+                if (stats.posted != mQueued) {
+                    queued();
+                }
+            }
+        }
+
+        // releaseThread: exit node behind everything queued
+        qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)calloc(1, sizeof(qcamera_sm_cmd_t));
+        node->cmd = QCAMERA_SM_CMD_TYPE_EXIT;
+        mQueue.enqueue(node);
+        cam_sem_post(&mSem);
+        pthread_join(smTh, NULL);
+
+        uint32_t coalesced = 0;
+        uint32_t heapAllocs = mHeapAllocs;
+        if (mBundled) {
+            qcamera_sm_evt_bundle_stats_t stats;
+            mPool.getStats(&stats);
+            coalesced = stats.coalesced;
+            heapAllocs = stats.heapAllocs;
+        }
+        printf("%-9s dispatch %5u us/evt: post %6.2f us avg %7.2f us max, "
+                "%5.2f allocs/frame, queued %5u coalesced %4u, backlog %4u, "
+                "AE age %8.2f ms avg %8.2f ms max\n",
+                mBundled ? "bundle" : "per event", mDispatchUs,
+                mCbNs / 1e3 / mFrames, mCbMaxNs / 1e3,
+                (double)heapAllocs / mFrames, mQueued.load(), coalesced,
+                mMaxBacklog, mAeAgeNs / 1e6 / (mAeCount ? mAeCount : 1),
+                mAeMaxAgeNs / 1e6);
+    }
+
+private:
+    static void fill(qcamera_sm_internal_evt_payload_t &payload,
+            qcamera_internal_evt_type_t type, uint32_t frame)
+    {
+        memset(&payload, 0, sizeof(payload));
+        payload.evt_type = type;
+        switch (type) {
+        case QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT:
+            payload.faces_data.detection_data.num_faces_detected = 1;
+            break;
+        case QCAMERA_INTERNAL_EVT_AE_UPDATE:
+            payload.ae_data.iso_value = (int32_t)frame;
+            break;
+        case QCAMERA_INTERNAL_EVT_FOCUS_UPDATE:
+            payload.focus_data.focus_state = CAM_AF_STATE_PASSIVE_SCAN;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void queued()
+    {
+        // a bundle is counted after the post, it may be dequeued already
+        int32_t backlog = (int32_t)(++mQueued) - (int32_t)mDequeued;
+        if (backlog > (int32_t)mMaxBacklog) {
+            mMaxBacklog = (uint32_t)backlog;
+        }
+    }
+
+    /* metadata_stream_cb_routine before bundling: payload and node per evt */
+    void postEvts(uint32_t frame)
+    {
+        uint32_t count = sizeof(gFrameEvts) / sizeof(gFrameEvts[0]);
+        bool focus = (frame % QCAMERA_BENCH_FOCUS_EVERY) == 0;
+        for (uint32_t i = 0; i < count + (focus ? 1 : 0); i++) {
+            qcamera_sm_internal_evt_payload_t *payload =
+                    (qcamera_sm_internal_evt_payload_t *)
+                    malloc(sizeof(qcamera_sm_internal_evt_payload_t));
+            fill(*payload, (i < count) ? gFrameEvts[i] :
+                    QCAMERA_INTERNAL_EVT_FOCUS_UPDATE, frame);
+            // procEvt
+            qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)malloc(sizeof(qcamera_sm_cmd_t));
+            mHeapAllocs += 2;
+            memset(node, 0, sizeof(qcamera_sm_cmd_t));
+            node->cmd = QCAMERA_SM_CMD_TYPE_EVT;
+            node->evt = QCAMERA_SM_EVT_EVT_INTERNAL;
+            node->evt_payload = payload;
+            queued();
+            mQueue.enqueue(node);
+            cam_sem_post(&mSem);
+        }
+    }
+
+    /* metadata_stream_cb_routine: one bundle per frame */
+    void postBundle(uint32_t frame)
+    {
+        qcamera_sm_internal_evt_payload_t payload;
+        qcamera_sm_internal_evt_bundle_t *bundle = mPool.get();
+
+        fill(payload, QCAMERA_INTERNAL_EVT_FACE_DETECT_RESULT, frame);
+        bundle->faces_data = payload.faces_data;
+        bundle->crop_data = payload.crop_data;
+        bundle->asd_data = payload.asd_data;
+        bundle->awb_data = payload.awb_data;
+        fill(payload, QCAMERA_INTERNAL_EVT_AE_UPDATE, frame);
+        bundle->ae_data = payload.ae_data;
+        bundle->focus_pos = payload.focus_pos;
+        bundle->hdr_data = payload.hdr_data;
+        for (size_t i = 0; i < sizeof(gFrameEvts) / sizeof(gFrameEvts[0]); i++) {
+            bundle->evt_mask |= QCAMERA_INTERNAL_EVT_BIT(gFrameEvts[i]);
+        }
+        if ((frame % QCAMERA_BENCH_FOCUS_EVERY) == 0) {
+            fill(payload, QCAMERA_INTERNAL_EVT_FOCUS_UPDATE, frame);
+            bundle->focus_data = payload.focus_data;
+            bundle->evt_mask |= QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_FOCUS_UPDATE);
+        }
+        mPool.post(bundle);
+    }
+
+    /* stateMachine for one QCAMERA_SM_EVT_EVT_INTERNAL */
+    void dispatch(const qcamera_sm_internal_evt_payload_t &payload)
+    {
+        if (QCAMERA_INTERNAL_EVT_AE_UPDATE == payload.evt_type) {
+            int64_t age = now_ns() - mPostNs[payload.ae_data.iso_value];
+            mAeCount++;
+            mAeAgeNs += age;
+            if (age > mAeMaxAgeNs) {
+                mAeMaxAgeNs = age;
+            }
+        }
+        if (mDispatchUs > 0) {
+            usleep(mDispatchUs);
+        }
+    }
+
+    /* smEvtProcRoutine */
+    void stateMachine()
+    {
+        for (;;) {
+            cam_sem_wait(&mSem);
+            qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)mQueue.dequeue();
+            if (NULL == node) {
+                continue;
+            }
+            if (QCAMERA_SM_CMD_TYPE_EXIT == node->cmd) {
+                free(node);
+                break;
+            }
+            mDequeued++;
+            if (QCAMERA_SM_CMD_TYPE_EVT_BUNDLE == node->cmd) {
+                qcamera_sm_internal_evt_bundle_t *bundle = mPool.take(node);
+                qcamera_sm_internal_evt_payload_t payload;
+                // dispatchEvtBundle order does not matter for the cost
+                for (uint32_t type = 0; type < QCAMERA_INTERNAL_EVT_MAX; type++) {
+                    if (!(bundle->evt_mask & QCAMERA_INTERNAL_EVT_BIT(type))) {
+                        continue;
+                    }
+                    payload.evt_type = (qcamera_internal_evt_type_t)type;
+                    if (QCAMERA_INTERNAL_EVT_AE_UPDATE == type) {
+                        payload.ae_data = bundle->ae_data;
+                    }
+                    dispatch(payload);
+                }
+                mPool.release(bundle);
+            } else {
+                dispatch(*(qcamera_sm_internal_evt_payload_t *)node->evt_payload);
+                free(node->evt_payload);
+                free(node);
+            }
+        }
+    }
+
+    static void *smRoutine(void *data)
+    {
+        ((EvtBench *)data)->stateMachine();
+        return NULL;
+    }
+
+    uint32_t mFrames;
+    uint32_t mIntervalUs;
+    uint32_t mDispatchUs;
+    bool mBundled;
+
+    cam_semaphore_t mSem;                 // cmd_sem
+    QCameraQueue mQueue;                  // evt_queue
+    QCameraEvtBundlePool mPool;
+    std::vector<int64_t> mPostNs;
+
+    uint32_t mHeapAllocs;
+    std::atomic<uint32_t> mQueued;
+    std::atomic<uint32_t> mDequeued;
+    uint32_t mMaxBacklog;
+    int64_t mCbNs;
+    int64_t mCbMaxNs;
+    uint32_t mAeCount;
+    int64_t mAeAgeNs;
+    int64_t mAeMaxAgeNs;
+};
+
+int main(int argc, char *argv[])
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 150;
+    int intervalUs = (argc > 2) ? atoi(argv[2]) : 33333;
+
+    if ((frames <= 0) || (intervalUs <= 0)) {
+        fprintf(stderr, "usage: %s [frames] [frame_interval_us]\n", argv[0]);
+        return 2;
+    }
+    printf("%d frames every %d us, %zu evts per frame and a focus update every "
+            "%d frames, pool of %d bundles\n", frames, intervalUs,
+            sizeof(gFrameEvts) / sizeof(gFrameEvts[0]), QCAMERA_BENCH_FOCUS_EVERY,
+            QCAMERA_SM_EVT_BUNDLE_POOL_SIZE);
+    for (size_t i = 0; i < sizeof(gDispatchUs) / sizeof(gDispatchUs[0]); i++) {
+        for (int bundled = 0; bundled < 2; bundled++) {
+            EvtBench bench((uint32_t)frames, (uint32_t)intervalUs, gDispatchUs[i],
+                    bundled != 0);
+            bench.run();
+        }
+    }
+    return 0;
+}
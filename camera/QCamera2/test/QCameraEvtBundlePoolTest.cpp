@@ -0,0 +1,329 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Unit tests of the internal event bundles of the HAL1 state machine,
+ * QCameraEvtBundlePool.
+ *
+ * Bundles are filled and posted the way the metadata callback does, and
+ * taken off the queue the way smEvtProcRoutine does. A bundle posted while
+ * an earlier one still waits in the queue must be merged into it, with the
+ * newer payloads winning, except when both carry a focus update or a
+ * prepare snapshot done; those transitions are queued on their own. Only a
+ * lagging consumer that holds more than the pooled bundles may cause heap
+ * allocations, and those are counted. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Camera dependencies
+#include "QCameraStateMachine.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define EVT_BIT(evt) QCAMERA_INTERNAL_EVT_BIT(QCAMERA_INTERNAL_EVT_##evt)
+
+class QCameraEvtBundlePoolTest : public ::testing::Test {
+protected:
+    QCameraEvtBundlePoolTest() :
+            mQueue(),
+            mPool(&mQueue, &mSem)
+    {
+        cam_sem_init(&mSem, 0);
+    }
+
+    virtual ~QCameraEvtBundlePoolTest()
+    {
+        while (NULL != dequeue()) {
+        }
+        cam_sem_destroy(&mSem);
+    }
+
+    /* metadata callback with AE and AWB and, when asked, a focus update */
+    void postFrame(int32_t iso, int32_t cct, int focusState = -1)
+    {
+        qcamera_sm_internal_evt_bundle_t *bundle = mPool.get();
+        ASSERT_TRUE(NULL != bundle);
+        bundle->ae_data.iso_value = iso;
+        bundle->evt_mask |= EVT_BIT(AE_UPDATE);
+        bundle->awb_data.cct_value = cct;
+        bundle->evt_mask |= EVT_BIT(AWB_UPDATE);
+        if (focusState >= 0) {
+            bundle->focus_data.focus_state = (cam_af_state_t)focusState;
+            bundle->evt_mask |= EVT_BIT(FOCUS_UPDATE);
+        }
+        EXPECT_EQ(NO_ERROR, mPool.post(bundle));
+    }
+
+    /* smEvtProcRoutine: copy of the next queued bundle, evt_mask 0 if none */
+    qcamera_sm_internal_evt_bundle_t *dequeue()
+    {
+        qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)mQueue.dequeue();
+        if (NULL == node) {
+            return NULL;
+        }
+        EXPECT_EQ(QCAMERA_SM_CMD_TYPE_EVT_BUNDLE, node->cmd);
+        EXPECT_EQ(QCAMERA_SM_EVT_EVT_INTERNAL, node->evt);
+        qcamera_sm_internal_evt_bundle_t *bundle = mPool.take(node);
+        mLast = *bundle;
+        mPool.release(bundle);
+        return &mLast;
+    }
+
+    qcamera_sm_evt_bundle_stats_t stats()
+    {
+        qcamera_sm_evt_bundle_stats_t s;
+        mPool.getStats(&s);
+        return s;
+    }
+
+    cam_semaphore_t mSem;
+    QCameraQueue mQueue;
+    QCameraEvtBundlePool mPool;
+    qcamera_sm_internal_evt_bundle_t mLast;
+};
+
+TEST_F(QCameraEvtBundlePoolTest, WaitingBundleTakesNewerPayloads)
+{
+    postFrame(100, 5000);
+    qcamera_sm_internal_evt_bundle_t *bundle = mPool.get();
+    bundle->faces_data.detection_data.num_faces_detected = 2;
+    bundle->evt_mask |= EVT_BIT(FACE_DETECT_RESULT);
+    EXPECT_EQ(NO_ERROR, mPool.post(bundle));
+    postFrame(200, 5100);
+
+    EXPECT_EQ(1, mSem.val);
+    ASSERT_TRUE(NULL != dequeue());
+    EXPECT_EQ(EVT_BIT(AE_UPDATE) | EVT_BIT(AWB_UPDATE) |
+            EVT_BIT(FACE_DETECT_RESULT), mLast.evt_mask);
+    EXPECT_EQ(200, mLast.ae_data.iso_value);
+    EXPECT_EQ(5100, mLast.awb_data.cct_value);
+    EXPECT_EQ(2, mLast.faces_data.detection_data.num_faces_detected);
+    EXPECT_TRUE(NULL == dequeue());
+
+    qcamera_sm_evt_bundle_stats_t s = stats();
+    EXPECT_EQ(1u, s.posted);
+    EXPECT_EQ(2u, s.coalesced);
+    EXPECT_EQ(0u, s.heapAllocs);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, DequeuedBundleIsNotMergedInto)
+{
+    postFrame(100, 5000);
+    qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)mQueue.dequeue();
+    ASSERT_TRUE(NULL != node);
+    qcamera_sm_internal_evt_bundle_t *taken = mPool.take(node);
+
+    // posted while the state machine dispatches the first one
+    postFrame(200, 5100);
+    EXPECT_EQ(100, taken->ae_data.iso_value);
+    mPool.release(taken);
+
+    ASSERT_TRUE(NULL != dequeue());
+    EXPECT_EQ(200, mLast.ae_data.iso_value);
+    EXPECT_EQ(2u, stats().posted);
+    EXPECT_EQ(0u, stats().coalesced);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, FocusUpdatesAreNotOverwritten)
+{
+    postFrame(100, 5000, CAM_AF_STATE_ACTIVE_SCAN);
+    // no focus update, merges into the waiting bundle
+    postFrame(110, 5010);
+    postFrame(120, 5020, CAM_AF_STATE_FOCUSED_LOCKED);
+    postFrame(130, 5030);
+
+    ASSERT_TRUE(NULL != dequeue());
+    EXPECT_TRUE(mLast.evt_mask & EVT_BIT(FOCUS_UPDATE));
+    EXPECT_EQ(CAM_AF_STATE_ACTIVE_SCAN, mLast.focus_data.focus_state);
+    EXPECT_EQ(110, mLast.ae_data.iso_value);
+
+    ASSERT_TRUE(NULL != dequeue());
+    EXPECT_TRUE(mLast.evt_mask & EVT_BIT(FOCUS_UPDATE));
+    EXPECT_EQ(CAM_AF_STATE_FOCUSED_LOCKED, mLast.focus_data.focus_state);
+    EXPECT_EQ(130, mLast.ae_data.iso_value);
+    EXPECT_TRUE(NULL == dequeue());
+
+    EXPECT_EQ(2u, stats().posted);
+    EXPECT_EQ(2u, stats().coalesced);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, FocusUpdateMergesIntoBundleWithout)
+{
+    postFrame(100, 5000);
+    postFrame(110, 5010, CAM_AF_STATE_PASSIVE_SCAN);
+
+    ASSERT_TRUE(NULL != dequeue());
+    EXPECT_EQ(CAM_AF_STATE_PASSIVE_SCAN, mLast.focus_data.focus_state);
+    EXPECT_EQ(110, mLast.ae_data.iso_value);
+    EXPECT_TRUE(NULL == dequeue());
+    EXPECT_EQ(1u, stats().coalesced);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, PrepSnapshotDoneIsNotOverwritten)
+{
+    const cam_prep_snapshot_state_t states[] = {
+        NEED_FUTURE_FRAME, DO_NOT_NEED_FUTURE_FRAME };
+
+    for (size_t i = 0; i < 2; i++) {
+        qcamera_sm_internal_evt_bundle_t *bundle = mPool.get();
+        bundle->prep_snapshot_state = states[i];
+        bundle->evt_mask |= EVT_BIT(PREP_SNAPSHOT_DONE);
+        EXPECT_EQ(NO_ERROR, mPool.post(bundle));
+    }
+
+    EXPECT_EQ(2, mSem.val);
+    for (size_t i = 0; i < 2; i++) {
+        ASSERT_TRUE(NULL != dequeue());
+        EXPECT_EQ(states[i], mLast.prep_snapshot_state);
+    }
+    EXPECT_EQ(0u, stats().coalesced);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, EmptyBundleIsNotQueued)
+{
+    for (uint32_t i = 0; i < 2 * QCAMERA_SM_EVT_BUNDLE_POOL_SIZE; i++) {
+        EXPECT_EQ(NO_ERROR, mPool.post(mPool.get()));
+    }
+    EXPECT_EQ(0, mSem.val);
+    EXPECT_TRUE(NULL == dequeue());
+
+    qcamera_sm_evt_bundle_stats_t s = stats();
+    EXPECT_EQ(0u, s.posted);
+    EXPECT_EQ(0u, s.heapAllocs);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, LaggingConsumerIsServedFromThePool)
+{
+    // 1000 frames, a focus scan every fifth one, the consumer gets to run
+    // every third frame only
+    for (int32_t f = 0; f < 1000; f++) {
+        postFrame(f, f, ((f % 5) == 0) ? CAM_AF_STATE_PASSIVE_SCAN : -1);
+        if ((f % 3) == 2) {
+            while (NULL != dequeue()) {
+            }
+        }
+    }
+    while (NULL != dequeue()) {
+    }
+
+    qcamera_sm_evt_bundle_stats_t s = stats();
+    EXPECT_EQ(1000u, s.posted + s.coalesced);
+    EXPECT_GT(s.coalesced, 500u);
+    EXPECT_EQ(0u, s.heapAllocs);
+}
+
+TEST_F(QCameraEvtBundlePoolTest, ShortageFallsBackToHeap)
+{
+    // focus updates only, so none of them merges
+    for (uint32_t i = 0; i < QCAMERA_SM_EVT_BUNDLE_POOL_SIZE + 2; i++) {
+        postFrame(i, i, CAM_AF_STATE_PASSIVE_SCAN);
+    }
+    qcamera_sm_evt_bundle_stats_t s = stats();
+    EXPECT_EQ(QCAMERA_SM_EVT_BUNDLE_POOL_SIZE + 2u, s.posted);
+    EXPECT_EQ(2u, s.heapAllocs);
+
+    // heap bundles are freed, pooled ones go back: no allocations after
+    for (uint32_t i = 0; i < QCAMERA_SM_EVT_BUNDLE_POOL_SIZE + 2; i++) {
+        ASSERT_TRUE(NULL != dequeue());
+        EXPECT_EQ((int32_t)i, mLast.ae_data.iso_value);
+    }
+    for (uint32_t i = 0; i < QCAMERA_SM_EVT_BUNDLE_POOL_SIZE; i++) {
+        postFrame(i, i, CAM_AF_STATE_PASSIVE_SCAN);
+    }
+    EXPECT_EQ(2u, stats().heapAllocs);
+}
+
+struct ConsumerArgs {
+    QCameraQueue *queue;
+    cam_semaphore_t *sem;
+    QCameraEvtBundlePool *pool;
+    uint32_t focusUpdates;
+    int32_t lastIso;
+};
+
+/* smEvtProcRoutine with a slow state machine, until a NULL payload node */
+static void *consumerRoutine(void *data)
+{
+    ConsumerArgs *args = (ConsumerArgs *)data;
+    for (;;) {
+        cam_sem_wait(args->sem);
+        qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)args->queue->dequeue();
+        if (NULL == node) {
+            continue;
+        }
+        if (NULL == node->evt_payload) {
+            free(node);
+            break;
+        }
+        qcamera_sm_internal_evt_bundle_t *bundle = args->pool->take(node);
+        if (bundle->evt_mask & EVT_BIT(FOCUS_UPDATE)) {
+            args->focusUpdates++;
+        }
+        EXPECT_GT(bundle->ae_data.iso_value, args->lastIso);
+        args->lastIso = bundle->ae_data.iso_value;
+        usleep(200);
+        args->pool->release(bundle);
+    }
+    return NULL;
+}
+
+TEST_F(QCameraEvtBundlePoolTest, ConcurrentConsumerSeesEveryFocusUpdate)
+{
+    ConsumerArgs args = { &mQueue, &mSem, &mPool, 0, -1 };
+    pthread_t consumer;
+    uint32_t focusPosted = 0;
+
+    ASSERT_EQ(0, pthread_create(&consumer, NULL, consumerRoutine, &args));
+    for (int32_t f = 0; f < 2000; f++) {
+        bool focus = (f % 7) == 0;
+        postFrame(f, f, focus ? CAM_AF_STATE_PASSIVE_SCAN : -1);
+        focusPosted += focus ? 1 : 0;
+        if ((f % 50) == 0) {
+            usleep(1000);
+        }
+    }
+
+    // exit node
+    qcamera_sm_cmd_t *node = (qcamera_sm_cmd_t *)calloc(1, sizeof(qcamera_sm_cmd_t));
+    node->cmd = QCAMERA_SM_CMD_TYPE_EXIT;
+    ASSERT_TRUE(mQueue.enqueue(node));
+    cam_sem_post(&mSem);
+    pthread_join(consumer, NULL);
+
+    EXPECT_EQ(focusPosted, args.focusUpdates);
+    EXPECT_EQ(1999, args.lastIso);
+    qcamera_sm_evt_bundle_stats_t s = stats();
+    EXPECT_EQ(2000u, s.posted + s.coalesced);
+}
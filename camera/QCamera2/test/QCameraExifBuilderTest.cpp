@@ -0,0 +1,530 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Compares the entry table built by QCameraExifBuilder with the one the
+ * per-HAL QCameraExif/QCamera3Exif classes built before they were merged.
+ * LegacyExif below is that implementation, kept verbatim apart from the
+ * class name, so both can be fed the same tags and dumped.
+ *
+ * property_get() is replaced so a test can set properties for the calls that
+ * follow; every other property is read as usual. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <cutils/properties.h>
+#include <sys/system_properties.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCameraExifBuilder.h"
+
+using namespace android;
+using namespace qcamera;
+
+namespace {
+
+std::map<std::string, std::string> gPropOverrides;
+
+}; // namespace
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    std::map<std::string, std::string>::const_iterator it = gPropOverrides.find(key);
+    if (it != gPropOverrides.end()) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", it->second.c_str());
+    } else {
+        len = __system_property_get(key, value);
+    }
+    if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+namespace {
+
+// MAX_HAL3_EXIF_TABLE_ENTRIES / MAX_EXIF_TABLE_ENTRIES
+#define TEST_EXIF_TABLE_ENTRIES 23
+
+class LegacyExif
+{
+public:
+    LegacyExif() : m_nNumEntries(0) {
+        memset(m_Entries, 0, sizeof(m_Entries));
+    }
+
+    ~LegacyExif() {
+        for (uint32_t i = 0; i < m_nNumEntries; i++) {
+            exif_tag_entry_t &e = m_Entries[i].tag_entry;
+            switch (e.type) {
+            case EXIF_BYTE:
+                if (e.count > 1) free(e.data._bytes);
+                break;
+            case EXIF_ASCII:
+                free(e.data._ascii);
+                break;
+            case EXIF_SHORT:
+                if (e.count > 1) free(e.data._shorts);
+                break;
+            case EXIF_LONG:
+                if (e.count > 1) free(e.data._longs);
+                break;
+            case EXIF_RATIONAL:
+                if (e.count > 1) free(e.data._rats);
+                break;
+            case EXIF_UNDEFINED:
+                free(e.data._undefined);
+                break;
+            case EXIF_SLONG:
+                if (e.count > 1) free(e.data._slongs);
+                break;
+            case EXIF_SRATIONAL:
+                if (e.count > 1) free(e.data._srats);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    int32_t addEntry(exif_tag_id_t tagid, exif_tag_type_t type,
+            uint32_t count, void *data) {
+        int32_t rc = NO_ERROR;
+        if (m_nNumEntries >= TEST_EXIF_TABLE_ENTRIES) {
+            return NO_MEMORY;
+        }
+
+        m_Entries[m_nNumEntries].tag_id = tagid;
+        m_Entries[m_nNumEntries].tag_entry.type = type;
+        m_Entries[m_nNumEntries].tag_entry.count = count;
+        m_Entries[m_nNumEntries].tag_entry.copy = 1;
+        switch (type) {
+        case EXIF_BYTE:
+            if (count > 1) {
+                uint8_t *values = (uint8_t *)malloc(count);
+                if (values == NULL) {
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count);
+                    m_Entries[m_nNumEntries].tag_entry.data._bytes = values;
+                }
+            } else {
+                m_Entries[m_nNumEntries].tag_entry.data._byte = *(uint8_t *)data;
+            }
+            break;
+        case EXIF_ASCII: {
+            char *str = (char *)malloc(count + 1);
+            if (str == NULL) {
+                rc = NO_MEMORY;
+            } else {
+                memset(str, 0, count + 1);
+                memcpy(str, data, count);
+                m_Entries[m_nNumEntries].tag_entry.data._ascii = str;
+            }
+            break;
+        }
+        case EXIF_SHORT:
+            if (count > 1) {
+                uint16_t *values = (uint16_t *)malloc(count * sizeof(uint16_t));
+                if (values == NULL) {
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(uint16_t));
+                    m_Entries[m_nNumEntries].tag_entry.data._shorts = values;
+                }
+            } else {
+                m_Entries[m_nNumEntries].tag_entry.data._short = *(uint16_t *)data;
+            }
+            break;
+        case EXIF_LONG:
+            if (count > 1) {
+                uint32_t *values = (uint32_t *)malloc(count * sizeof(uint32_t));
+                if (values == NULL) {
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(uint32_t));
+                    m_Entries[m_nNumEntries].tag_entry.data._longs = values;
+                }
+            } else {
+                m_Entries[m_nNumEntries].tag_entry.data._long = *(uint32_t *)data;
+            }
+            break;
+        case EXIF_RATIONAL:
+            if (count > 1) {
+                rat_t *values = (rat_t *)malloc(count * sizeof(rat_t));
+                if (values == NULL) {
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(rat_t));
+                    m_Entries[m_nNumEntries].tag_entry.data._rats = values;
+                }
+            } else {
+                m_Entries[m_nNumEntries].tag_entry.data._rat = *(rat_t *)data;
+            }
+            break;
+        case EXIF_UNDEFINED: {
+            uint8_t *values = (uint8_t *)malloc(count);
+            if (values == NULL) {
+                rc = NO_MEMORY;
+            } else {
+                memcpy(values, data, count);
+                m_Entries[m_nNumEntries].tag_entry.data._undefined = values;
+            }
+            break;
+        }
+        case EXIF_SLONG:
+            if (count > 1) {
+                int32_t *values = (int32_t *)malloc(count * sizeof(int32_t));
+                if (values == NULL) {
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(int32_t));
+                    m_Entries[m_nNumEntries].tag_entry.data._slongs = values;
+                }
+            } else {
+                m_Entries[m_nNumEntries].tag_entry.data._slong = *(int32_t *)data;
+            }
+            break;
+        case EXIF_SRATIONAL:
+            if (count > 1) {
+                srat_t *values = (srat_t *)malloc(count * sizeof(srat_t));
+                if (values == NULL) {
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(srat_t));
+                    m_Entries[m_nNumEntries].tag_entry.data._srats = values;
+                }
+            } else {
+                m_Entries[m_nNumEntries].tag_entry.data._srat = *(srat_t *)data;
+            }
+            break;
+        }
+
+        m_nNumEntries++;
+        return rc;
+    }
+
+    // getExifData model info tags, HAL1 honours the persist overrides
+    void addModelInfoEntries(bool allowOverride) {
+        char value[PROPERTY_VALUE_MAX];
+        if ((allowOverride && property_get("persist.sys.exif.make", value, "") > 0) ||
+                property_get("ro.product.manufacturer", value, "QCOM-AA") > 0) {
+            addEntry(EXIFTAGID_MAKE, EXIF_ASCII,
+                    (uint32_t)(strlen(value) + 1), (void *)value);
+        }
+        if ((allowOverride && property_get("persist.sys.exif.model", value, "") > 0) ||
+                property_get("ro.product.model", value, "QCAM-AA") > 0) {
+            addEntry(EXIFTAGID_MODEL, EXIF_ASCII,
+                    (uint32_t)(strlen(value) + 1), (void *)value);
+        }
+        if (property_get("ro.build.description", value, "QCAM-AA") > 0) {
+            addEntry(EXIFTAGID_SOFTWARE, EXIF_ASCII,
+                    (uint32_t)(strlen(value) + 1), (void *)value);
+        }
+    }
+
+    uint32_t getNumOfEntries() { return m_nNumEntries; }
+    QEXIF_INFO_DATA *getEntries() { return m_Entries; }
+
+private:
+    QEXIF_INFO_DATA m_Entries[TEST_EXIF_TABLE_ENTRIES];
+    uint32_t m_nNumEntries;
+};
+
+// Element size of array payloads, 0 for types stored inline when count is 1
+size_t elemSize(exif_tag_type_t type)
+{
+    switch (type) {
+    case EXIF_BYTE:
+    case EXIF_ASCII:
+    case EXIF_UNDEFINED:
+        return 1;
+    case EXIF_SHORT:
+        return sizeof(uint16_t);
+    case EXIF_LONG:
+    case EXIF_SLONG:
+        return sizeof(uint32_t);
+    case EXIF_RATIONAL:
+        return sizeof(rat_t);
+    case EXIF_SRATIONAL:
+        return sizeof(srat_t);
+    default:
+        return 0;
+    }
+}
+
+// Canonical text form of an entry table: everything the JPEG encoder reads
+std::string dumpEntries(QEXIF_INFO_DATA *entries, uint32_t num)
+{
+    std::string out;
+    char buf[64];
+
+    for (uint32_t i = 0; i < num; i++) {
+        const exif_tag_entry_t &e = entries[i].tag_entry;
+        snprintf(buf, sizeof(buf), "%08x t%d n%u c%d:", entries[i].tag_id,
+                (int)e.type, e.count, (int)e.copy);
+        out += buf;
+
+        const uint8_t *bytes = NULL;
+        size_t len = 0;
+        bool inlined = (e.count <= 1) && (e.type != EXIF_ASCII) &&
+                (e.type != EXIF_UNDEFINED);
+        if (inlined) {
+            bytes = (const uint8_t *)&e.data;
+            len = elemSize(e.type);
+        } else {
+            switch (e.type) {
+            case EXIF_BYTE:      bytes = e.data._bytes; break;
+            case EXIF_ASCII:     bytes = (const uint8_t *)e.data._ascii; break;
+            case EXIF_UNDEFINED: bytes = e.data._undefined; break;
+            case EXIF_SHORT:     bytes = (const uint8_t *)e.data._shorts; break;
+            case EXIF_LONG:      bytes = (const uint8_t *)e.data._longs; break;
+            case EXIF_SLONG:     bytes = (const uint8_t *)e.data._slongs; break;
+            case EXIF_RATIONAL:  bytes = (const uint8_t *)e.data._rats; break;
+            case EXIF_SRATIONAL: bytes = (const uint8_t *)e.data._srats; break;
+            default: break;
+            }
+            len = e.count * elemSize(e.type);
+        }
+
+        if (bytes == NULL) {
+            out += " null";
+        } else {
+            for (size_t j = 0; j < len; j++) {
+                snprintf(buf, sizeof(buf), " %02x", bytes[j]);
+                out += buf;
+            }
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+// Payload of the ASCII entry with the given tag, empty if it is missing
+std::string asciiTag(QCameraExifBuilder &builder, exif_tag_id_t tagid)
+{
+    QEXIF_INFO_DATA *entries = builder.getEntries();
+    for (uint32_t i = 0; i < builder.getNumOfEntries(); i++) {
+        if ((entries[i].tag_id == tagid) &&
+                (entries[i].tag_entry.type == EXIF_ASCII)) {
+            return std::string(entries[i].tag_entry.data._ascii);
+        }
+    }
+    return std::string();
+}
+
+// Adds the tags of a regular capture, in getExifData order and types
+template <typename Exif>
+void addCaptureTags(Exif &exif)
+{
+    char dateTime[20] = "2016:01:02 03:04:05";
+    char subsec[7] = "123456";
+    rat_t focalLength = { 4600, 1000 };
+    uint16_t iso = 400;
+    rat_t exposure = { 1, 30 };
+    srat_t brightness = { -150, 100 };
+    uint16_t whiteBalance = 1;
+    uint8_t gpsVersion[4] = { 2, 2, 0, 0 };
+    rat_t latitude[3] = { { 37, 1 }, { 25, 1 }, { 1923, 100 } };
+    char latRef[2] = "N";
+    rat_t longitude[3] = { { 122, 1 }, { 5, 1 }, { 4871, 100 } };
+    char lonRef[2] = "W";
+    uint8_t altRef = 0;
+    rat_t altitude = { 3200, 100 };
+    char processing[] = "ASCII\0\0\0GPS";
+    rat_t gpsTime[3] = { { 3, 1 }, { 4, 1 }, { 5, 1 } };
+    char gpsDate[11] = "2016:01:02";
+    uint32_t imageLengths[2] = { 4000, 3000 };
+    int32_t offsets[3] = { -1, 0, 65536 };
+    srat_t shutter[2] = { { 49, 10 }, { -1, 3 } };
+    uint16_t subjectArea[4] = { 2000, 1500, 400, 300 };
+
+    exif.addEntry(EXIFTAGID_EXIF_DATE_TIME_ORIGINAL, EXIF_ASCII,
+            (uint32_t)strlen(dateTime) + 1, dateTime);
+    exif.addEntry(EXIFTAGID_DATE_TIME, EXIF_ASCII,
+            (uint32_t)strlen(dateTime) + 1, dateTime);
+    exif.addEntry(EXIFTAGID_SUBSEC_TIME_ORIGINAL, EXIF_ASCII,
+            (uint32_t)strlen(subsec) + 1, subsec);
+    exif.addEntry(EXIFTAGID_FOCAL_LENGTH, EXIF_RATIONAL, 1, &focalLength);
+    exif.addEntry(EXIFTAGID_ISO_SPEED_RATING, EXIF_SHORT, 1, &iso);
+    exif.addEntry(EXIFTAGID_EXPOSURE_TIME, EXIF_RATIONAL, 1, &exposure);
+    exif.addEntry(EXIFTAGID_BRIGHTNESS, EXIF_SRATIONAL, 1, &brightness);
+    exif.addEntry(EXIFTAGID_WHITE_BALANCE, EXIF_SHORT, 1, &whiteBalance);
+    exif.addEntry(EXIFTAGID_GPS_VERSION_ID, EXIF_BYTE, 4, gpsVersion);
+    exif.addEntry(EXIFTAGID_GPS_LATITUDE, EXIF_RATIONAL, 3, latitude);
+    exif.addEntry(EXIFTAGID_GPS_LATITUDE_REF, EXIF_ASCII, 2, latRef);
+    exif.addEntry(EXIFTAGID_GPS_LONGITUDE, EXIF_RATIONAL, 3, longitude);
+    exif.addEntry(EXIFTAGID_GPS_LONGITUDE_REF, EXIF_ASCII, 2, lonRef);
+    exif.addEntry(EXIFTAGID_GPS_ALTITUDE_REF, EXIF_BYTE, 1, &altRef);
+    exif.addEntry(EXIFTAGID_GPS_ALTITUDE, EXIF_RATIONAL, 1, &altitude);
+    exif.addEntry(EXIFTAGID_GPS_PROCESSINGMETHOD, EXIF_UNDEFINED,
+            (uint32_t)sizeof(processing), processing);
+    exif.addEntry(EXIFTAGID_GPS_TIMESTAMP, EXIF_RATIONAL, 3, gpsTime);
+    exif.addEntry(EXIFTAGID_GPS_DATESTAMP, EXIF_ASCII,
+            (uint32_t)strlen(gpsDate) + 1, gpsDate);
+    exif.addEntry(EXIFTAGID_IMAGE_LENGTH, EXIF_LONG, 2, imageLengths);
+    exif.addEntry(EXIFTAGID_EXIF_IFD_PTR, EXIF_SLONG, 3, offsets);
+    exif.addEntry(EXIFTAGID_SHUTTER_SPEED, EXIF_SRATIONAL, 2, shutter);
+    exif.addEntry(EXIFTAGID_SUBJECT_AREA, EXIF_SHORT, 4, subjectArea);
+}
+
+}; // namespace
+
+TEST(QCameraExifBuilderTest, CaptureTagsMatchLegacy)
+{
+    LegacyExif legacy;
+    QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+
+    addCaptureTags(legacy);
+    addCaptureTags(builder);
+
+    ASSERT_EQ(legacy.getNumOfEntries(), builder.getNumOfEntries());
+    EXPECT_EQ(dumpEntries(legacy.getEntries(), legacy.getNumOfEntries()),
+            dumpEntries(builder.getEntries(), builder.getNumOfEntries()));
+}
+
+TEST(QCameraExifBuilderTest, ModelInfoMatchesLegacy)
+{
+    for (int allowOverride = 0; allowOverride < 2; allowOverride++) {
+        LegacyExif legacy;
+        QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+
+        legacy.addModelInfoEntries(allowOverride);
+        EXPECT_EQ(NO_ERROR, builder.addModelInfoEntries(allowOverride));
+
+        ASSERT_EQ(legacy.getNumOfEntries(), builder.getNumOfEntries());
+        EXPECT_EQ(dumpEntries(legacy.getEntries(), legacy.getNumOfEntries()),
+                dumpEntries(builder.getEntries(), builder.getNumOfEntries()))
+                << "allowOverride " << allowOverride;
+    }
+}
+
+TEST(QCameraExifBuilderTest, OverrideReadPerBuild)
+{
+    std::string make;
+    std::string model;
+    std::string software;
+
+    {
+        QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+        EXPECT_EQ(NO_ERROR, builder.addModelInfoEntries(false));
+        make = asciiTag(builder, EXIFTAGID_MAKE);
+        model = asciiTag(builder, EXIFTAGID_MODEL);
+        software = asciiTag(builder, EXIFTAGID_SOFTWARE);
+    }
+
+    // Overrides set after the first build are picked up by the next one
+    gPropOverrides["persist.sys.exif.make"] = "TestMake";
+    gPropOverrides["persist.sys.exif.model"] = "TestModel";
+    {
+        QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+        EXPECT_EQ(NO_ERROR, builder.addModelInfoEntries(true));
+        EXPECT_EQ("TestMake", asciiTag(builder, EXIFTAGID_MAKE));
+        EXPECT_EQ("TestModel", asciiTag(builder, EXIFTAGID_MODEL));
+        EXPECT_EQ(software, asciiTag(builder, EXIFTAGID_SOFTWARE));
+    }
+    {
+        QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+        EXPECT_EQ(NO_ERROR, builder.addModelInfoEntries(false));
+        EXPECT_EQ(make, asciiTag(builder, EXIFTAGID_MAKE));
+        EXPECT_EQ(model, asciiTag(builder, EXIFTAGID_MODEL));
+    }
+
+    // Changed and cleared overrides are followed too
+    gPropOverrides["persist.sys.exif.make"] = "OtherMake";
+    gPropOverrides["persist.sys.exif.model"] = "";
+    {
+        QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+        EXPECT_EQ(NO_ERROR, builder.addModelInfoEntries(true));
+        EXPECT_EQ("OtherMake", asciiTag(builder, EXIFTAGID_MAKE));
+        EXPECT_EQ(model, asciiTag(builder, EXIFTAGID_MODEL));
+    }
+
+    // ro.* values are resolved once per process
+    gPropOverrides["ro.product.manufacturer"] = "NewBuildMake";
+    {
+        QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+        EXPECT_EQ(NO_ERROR, builder.addModelInfoEntries(false));
+        EXPECT_EQ(make, asciiTag(builder, EXIFTAGID_MAKE));
+    }
+    gPropOverrides.clear();
+}
+
+TEST(QCameraExifBuilderTest, ArenaOverflowMatchesLegacy)
+{
+    LegacyExif legacy;
+    QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+    uint8_t blob[QCAMERA_EXIF_ARENA_SIZE / 2 + 1];
+    rat_t latitude[3];
+
+    // Second and later payloads no longer fit the arena and go to the heap
+    for (int i = 0; i < 3; i++) {
+        memset(blob, 0x20 + i, sizeof(blob));
+        EXPECT_EQ(NO_ERROR, legacy.addEntry(EXIFTAGID_GPS_PROCESSINGMETHOD,
+                EXIF_UNDEFINED, (uint32_t)sizeof(blob), blob));
+        EXPECT_EQ(NO_ERROR, builder.addEntry(EXIFTAGID_GPS_PROCESSINGMETHOD,
+                EXIF_UNDEFINED, (uint32_t)sizeof(blob), blob));
+    }
+    for (uint32_t i = 3; i < TEST_EXIF_TABLE_ENTRIES; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            latitude[j].num = i * 10 + j;
+            latitude[j].denom = j + 1;
+        }
+        EXPECT_EQ(NO_ERROR, legacy.addEntry(EXIFTAGID_GPS_LATITUDE,
+                EXIF_RATIONAL, 3, latitude));
+        EXPECT_EQ(NO_ERROR, builder.addEntry(EXIFTAGID_GPS_LATITUDE,
+                EXIF_RATIONAL, 3, latitude));
+    }
+
+    ASSERT_EQ(legacy.getNumOfEntries(), builder.getNumOfEntries());
+    EXPECT_EQ(dumpEntries(legacy.getEntries(), legacy.getNumOfEntries()),
+            dumpEntries(builder.getEntries(), builder.getNumOfEntries()));
+}
+
+TEST(QCameraExifBuilderTest, EntryLimit)
+{
+    LegacyExif legacy;
+    QCameraExifBuilder builder(TEST_EXIF_TABLE_ENTRIES);
+    uint16_t value = 7;
+
+    for (uint32_t i = 0; i < TEST_EXIF_TABLE_ENTRIES; i++) {
+        EXPECT_EQ(NO_ERROR, legacy.addEntry(EXIFTAGID_ORIENTATION, EXIF_SHORT, 1, &value));
+        EXPECT_EQ(NO_ERROR, builder.addEntry(EXIFTAGID_ORIENTATION, EXIF_SHORT, 1, &value));
+    }
+    EXPECT_EQ(NO_MEMORY, legacy.addEntry(EXIFTAGID_ORIENTATION, EXIF_SHORT, 1, &value));
+    EXPECT_EQ(NO_MEMORY, builder.addEntry(EXIFTAGID_ORIENTATION, EXIF_SHORT, 1, &value));
+    EXPECT_EQ(legacy.getNumOfEntries(), builder.getNumOfEntries());
+}
@@ -0,0 +1,303 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Benchmark of QCameraFrameDumper against the legacy synchronous dump.
+ *
+ * Frames are dumped at the camera rate, once the way the channels did
+ * before the recorder (open a file per frame, one write() per row with the
+ * stride removed, close) and once through dumpFrame(), for
+ *   - 30 fps 1080p NV12 preview
+ *   - 30 fps 4K NV12 video
+ *   -  2 fps 12MP NV12 snapshot
+ * and prints the time the callback thread spends per frame, average and
+ * worst, in % of the frame period, and the frames the recorder dropped.
+ * The recorder time until the writer has committed every frame is printed
+ * too. property_get() is replaced to size the container for the run;
+ * files go to QCAMERA_DUMP_FRM_LOCATION and are removed afterwards.
+ *
+ * usage: qcamera_frame_dump_bench [frames] */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/system_properties.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraFrameDumper.h"
+
+using namespace qcamera;
+
+typedef struct {
+    const char *name;
+    uint32_t fps;
+    int32_t width;
+    int32_t height;
+    int32_t stride;
+    int32_t scanline;
+} bench_case_t;
+
+static const bench_case_t gCases[] = {
+    { "1080p preview ", 30, 1920, 1080, 1920, 1088 },
+    { "4K video      ", 30, 3840, 2160, 3840, 2176 },
+    { "12MP snapshot ", 2, 4000, 3000, 4096, 3008 },
+};
+
+static char gContainerMb[PROPERTY_VALUE_MAX] = "512";
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    if (!strcmp(key, "persist.camera.dumpimg.async")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "1");
+    }
+    if (!strcmp(key, "persist.camera.dumpimg.size")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "%s", gContainerMb);
+    }
+    len = __system_property_get(key, value);
+    if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static void sleep_until(int64_t deadlineNs)
+{
+    int64_t left = deadlineNs - now_ns();
+    if (left > 0) {
+        struct timespec ts = { (time_t)(left / 1000000000LL), (long)(left % 1000000000LL) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void make_offset(const bench_case_t &c, cam_frame_len_offset_t &offset)
+{
+    memset(&offset, 0, sizeof(offset));
+    offset.num_planes = 2;
+    for (uint32_t i = 0; i < 2; i++) {
+        offset.mp[i].width = c.width;
+        offset.mp[i].height = (i == 0) ? c.height : c.height / 2;
+        offset.mp[i].stride = c.stride;
+        offset.mp[i].scanline = (i == 0) ? c.scanline : c.scanline / 2;
+        offset.mp[i].len = (uint32_t)(offset.mp[i].stride * offset.mp[i].scanline);
+    }
+    offset.frame_len = offset.mp[0].len + offset.mp[1].len;
+}
+
+/* Per frame dump of QCamera3Channel::dumpYUV before the recorder */
+static ssize_t legacy_dump(const char *path, mm_camera_buf_def_t *frame,
+        const cam_frame_len_offset_t &offset)
+{
+    int file_fd = open(path, O_RDWR | O_CREAT, 0777);
+    ssize_t written_len = 0;
+    if (file_fd < 0) {
+        return -1;
+    }
+    fchmod(file_fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    for (uint32_t i = 0; i < offset.num_planes; i++) {
+        uint32_t index = offset.mp[i].offset;
+        if (i > 0) {
+            index += offset.mp[i-1].len;
+        }
+        for (int j = 0; j < offset.mp[i].height; j++) {
+            void *data = (void *)((uint8_t *)frame->buffer + index);
+            written_len += write(file_fd, data, (size_t)offset.mp[i].width);
+            index += (uint32_t)offset.mp[i].stride;
+        }
+    }
+    close(file_fd);
+    return written_len;
+}
+
+static void print_result(const char *mode, const bench_case_t &c, int64_t totalNs,
+        int64_t worstNs, uint32_t frames)
+{
+    double periodNs = 1e9 / c.fps;
+    printf("%s %s: %8.1f us/frame (%5.2f%% of the frame period), worst %8.1f us\n",
+            c.name, mode, totalNs / 1e3 / frames, totalNs * 100.0 / frames / periodNs,
+            worstNs / 1e3);
+}
+
+static int run(const bench_case_t &c, uint32_t frames)
+{
+    cam_frame_len_offset_t offset;
+    make_offset(c, offset);
+    std::vector<uint8_t> buf(offset.frame_len);
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = (uint8_t)i;
+    }
+    mm_camera_buf_def_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.buffer = buf.data();
+    frame.frame_len = buf.size();
+    int64_t periodNs = 1000000000LL / c.fps;
+
+    // Legacy synchronous dump, a file per frame
+    int64_t totalNs = 0, worstNs = 0;
+    int64_t next = now_ns();
+    for (uint32_t f = 0; f < frames; f++) {
+        char path[FILENAME_MAX];
+        snprintf(path, sizeof(path), QCAMERA_DUMP_FRM_LOCATION "bench_%d_%u.yuv",
+                getpid(), f);
+        frame.frame_idx = f;
+        int64_t t = now_ns();
+        if (legacy_dump(path, &frame, offset) < 0) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return -1;
+        }
+        t = now_ns() - t;
+        totalNs += t;
+        worstNs = (t > worstNs) ? t : worstNs;
+        next += periodNs;
+        sleep_until(next);
+    }
+    print_result("legacy  ", c, totalNs, worstNs, frames);
+    for (uint32_t f = 0; f < frames; f++) {
+        char path[FILENAME_MAX];
+        snprintf(path, sizeof(path), QCAMERA_DUMP_FRM_LOCATION "bench_%d_%u.yuv",
+                getpid(), f);
+        unlink(path);
+    }
+
+    // Recorder, staging copy on the caller and container append on the writer
+    QCameraFrameDumper *dumper = QCameraFrameDumper::getInstance();
+    qcamera_dump_stats_t before, after;
+    qcamera_dump_desc_t desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.streamType = CAM_STREAM_TYPE_PREVIEW;
+    desc.format = CAM_FORMAT_YUV_420_NV12;
+    desc.dim.width = c.width;
+    desc.dim.height = c.height;
+    desc.tag = "p";
+    dumper->getStats(before);
+
+    totalNs = 0;
+    worstNs = 0;
+    next = now_ns();
+    int64_t startNs = next;
+    for (uint32_t f = 0; f < frames; f++) {
+        frame.frame_idx = f;
+        int64_t t = now_ns();
+        dumper->dumpFrame(desc, &frame, offset);
+        t = now_ns() - t;
+        totalNs += t;
+        worstNs = (t > worstNs) ? t : worstNs;
+        next += periodNs;
+        if (f + 1 < frames) {
+            sleep_until(next);
+        }
+    }
+    do {
+        dumper->getStats(after);
+        if (after.written + after.droppedBudget + after.droppedFull +
+                after.writeErrors - before.written - before.droppedBudget -
+                before.droppedFull - before.writeErrors >= frames) {
+            break;
+        }
+        usleep(1000);
+    } while (true);
+    int64_t drainNs = now_ns() - startNs;
+
+    print_result("recorder", c, totalNs, worstNs, frames);
+    printf("%s recorder: %u written, %u dropped over budget, %u container "
+            "full, %u errors, all committed after %.1f ms (%.1f ms of frames)\n",
+            c.name, after.written - before.written,
+            after.droppedBudget - before.droppedBudget,
+            after.droppedFull - before.droppedFull,
+            after.writeErrors - before.writeErrors, drainNs / 1e6,
+            (double)frames * periodNs / 1e6);
+    return (after.writeErrors == before.writeErrors) ? 0 : -1;
+}
+
+/* Removes the container of this process, <time>_<pid>.qcd */
+static void remove_container()
+{
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%d.qcd", getpid());
+    DIR *d = opendir(QCAMERA_DUMP_FRM_LOCATION);
+    if (d == NULL) {
+        return;
+    }
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if ((len > strlen(suffix)) && !strcmp(de->d_name + len - strlen(suffix), suffix)) {
+            char path[FILENAME_MAX];
+            snprintf(path, sizeof(path), QCAMERA_DUMP_FRM_LOCATION "%s", de->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 30;
+    int rc = 0;
+
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return 2;
+    }
+
+    // Room for every frame of the run, plus the index
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < sizeof(gCases) / sizeof(gCases[0]); i++) {
+        bytes += (uint64_t)frames * (uint64_t)(gCases[i].width * gCases[i].height * 3 / 2 +
+                QCAMERA_DUMP_ALIGN);
+    }
+    snprintf(gContainerMb, sizeof(gContainerMb), "%llu",
+            (unsigned long long)(bytes >> 20) + 16);
+    mkdir(QCAMERA_DUMP_FRM_LOCATION, 0770);
+
+    printf("%d frames per case, %s MB container\n", frames, gContainerMb);
+    for (size_t i = 0; i < sizeof(gCases) / sizeof(gCases[0]); i++) {
+        if (run(gCases[i], (uint32_t)frames) != 0) {
+            fprintf(stderr, "FAIL:%s\n", gCases[i].name);
+            rc = 1;
+        }
+    }
+    remove_container();
+    return rc;
+}
@@ -0,0 +1,469 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Round trip of the frame dump container through qcamera_dump_extract.
+ *
+ * Frames are dumped through QCameraFrameDumper: NV12 with padded strides,
+ * NV12 with UBWC style plane meta data and a linear RAW buffer. Once the
+ * writer has committed them, the container is unpacked with the
+ * extractor, built into this test with its main() renamed, and every
+ * extracted file is compared with the frame packed the way the legacy per
+ * frame dumps wrote it. The extractor is also checked to reject foreign
+ * files and to read back a container whose entry count was cut short.
+ *
+ * property_get() is replaced to turn the recorder on with a small
+ * container. The container is written to QCAMERA_DUMP_FRM_LOCATION. */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/system_properties.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils/Errors.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraFrameDumper.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define DUMP_TEST_SIZE_MB       "32"
+#define DUMP_TEST_WAIT_MS       5000
+
+// util/qcamera_dump_extract.cpp, built with -Dmain=qcamera_dump_extract_main
+int qcamera_dump_extract_main(int argc, char *argv[]);
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    if (!strcmp(key, "persist.camera.dumpimg.async")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "1");
+    }
+    if (!strcmp(key, "persist.camera.dumpimg.size")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, DUMP_TEST_SIZE_MB);
+    }
+    len = __system_property_get(key, value);
+    if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+/* A frame and the bytes the container must hold for it */
+struct DumpTestFrame {
+    std::vector<uint8_t> buf;
+    std::vector<uint8_t> packed;
+    cam_frame_len_offset_t offset;
+    mm_camera_buf_def_t def;
+    qcamera_dump_desc_t desc;
+    uint32_t seq;
+};
+
+static void fill_pattern(std::vector<uint8_t> &buf, uint32_t seed)
+{
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = (uint8_t)((i * 131 + seed) >> 3);
+    }
+}
+
+/* NV12 with padded stride/scanline, meta_len bytes of plane meta data in
+ * front of every plane */
+static void make_nv12(DumpTestFrame &f, int32_t width, int32_t height,
+        int32_t stride, int32_t scanline, int32_t metaLen, uint32_t frameIdx)
+{
+    memset(&f.offset, 0, sizeof(f.offset));
+    f.offset.num_planes = 2;
+    for (uint32_t i = 0; i < 2; i++) {
+        cam_mp_len_offset_t &mp = f.offset.mp[i];
+        mp.width = width;
+        mp.height = (i == 0) ? height : height / 2;
+        mp.stride = stride;
+        mp.scanline = (i == 0) ? scanline : scanline / 2;
+        mp.meta_len = metaLen;
+        mp.len = (uint32_t)(metaLen + mp.stride * mp.scanline);
+    }
+    f.offset.frame_len = f.offset.mp[0].len + f.offset.mp[1].len;
+    f.buf.resize(f.offset.frame_len);
+    fill_pattern(f.buf, frameIdx);
+
+    f.packed.clear();
+    size_t base = 0;
+    for (uint32_t i = 0; i < 2; i++) {
+        const cam_mp_len_offset_t &mp = f.offset.mp[i];
+        f.packed.insert(f.packed.end(), f.buf.begin() + base,
+                f.buf.begin() + base + mp.meta_len);
+        for (int32_t j = 0; j < mp.height; j++) {
+            size_t row = base + mp.meta_len + (size_t)j * mp.stride;
+            f.packed.insert(f.packed.end(), f.buf.begin() + row,
+                    f.buf.begin() + row + mp.width);
+        }
+        base += mp.len;
+    }
+
+    memset(&f.def, 0, sizeof(f.def));
+    f.def.buffer = f.buf.data();
+    f.def.frame_len = f.buf.size();
+    f.def.frame_idx = frameIdx;
+    f.def.ts.tv_sec = frameIdx;
+    f.def.ts.tv_nsec = 1000;
+
+    memset(&f.desc, 0, sizeof(f.desc));
+    f.desc.cameraId = 1;
+    f.desc.dumpType = 0x1;
+    f.desc.streamType = CAM_STREAM_TYPE_PREVIEW;
+    f.desc.format = CAM_FORMAT_YUV_420_NV12;
+    f.desc.dim.width = width;
+    f.desc.dim.height = height;
+    f.desc.tag = "p";
+}
+
+static void make_raw(DumpTestFrame &f, size_t len, uint32_t frameIdx)
+{
+    memset(&f.offset, 0, sizeof(f.offset));
+    f.buf.resize(len);
+    fill_pattern(f.buf, frameIdx);
+    f.packed = f.buf;
+
+    memset(&f.def, 0, sizeof(f.def));
+    f.def.buffer = f.buf.data();
+    f.def.frame_len = f.buf.size();
+    f.def.frame_idx = frameIdx;
+
+    memset(&f.desc, 0, sizeof(f.desc));
+    f.desc.dumpType = 0x8;
+    f.desc.streamType = CAM_STREAM_TYPE_RAW;
+    f.desc.format = CAM_FORMAT_MAX;
+    f.desc.dim.width = (int32_t)len;
+    f.desc.dim.height = 1;
+    f.desc.tag = "r";
+}
+
+static std::string entry_file_name(const DumpTestFrame &f)
+{
+    char name[96];
+    const char *ext = strcmp(f.desc.tag, "r") ? "yuv" : "raw";
+    if (f.desc.misc != NULL) {
+        snprintf(name, sizeof(name), "%u%s_%dx%d_%u_%s_%u.%s", f.seq, f.desc.tag,
+                f.desc.dim.width, f.desc.dim.height, f.def.frame_idx, f.desc.misc,
+                f.desc.cameraId, ext);
+    } else {
+        snprintf(name, sizeof(name), "%u%s_%dx%d_%u_%u.%s", f.seq, f.desc.tag,
+                f.desc.dim.width, f.desc.dim.height, f.def.frame_idx,
+                f.desc.cameraId, ext);
+    }
+    return name;
+}
+
+static bool read_file(const std::string &path, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    data.resize((size_t)ftell(fp));
+    fseek(fp, 0, SEEK_SET);
+    bool ok = data.empty() || (fread(data.data(), data.size(), 1, fp) == 1);
+    fclose(fp);
+    return ok;
+}
+
+static bool write_file(const std::string &path, const void *data, size_t len)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = (len == 0) || (fwrite(data, len, 1, fp) == 1);
+    fclose(fp);
+    return ok;
+}
+
+static int run_extract(const std::string &container, const char *outDir)
+{
+    std::vector<char *> argv;
+    argv.push_back((char *)"qcamera_dump_extract");
+    if (outDir != NULL) {
+        argv.push_back((char *)"-x");
+        argv.push_back((char *)outDir);
+    }
+    argv.push_back((char *)container.c_str());
+    argv.push_back(NULL);
+    optind = 1;
+    return qcamera_dump_extract_main((int)argv.size() - 1, argv.data());
+}
+
+static void remove_dir(const std::string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d == NULL) {
+        return;
+    }
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] != '.') {
+            unlink((dir + "/" + de->d_name).c_str());
+        }
+    }
+    closedir(d);
+    rmdir(dir.c_str());
+}
+
+class QCameraFrameDumperTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        mkdir(QCAMERA_DUMP_FRM_LOCATION, 0770);
+        char dir[FILENAME_MAX];
+        snprintf(dir, sizeof(dir), QCAMERA_DUMP_FRM_LOCATION "dump_extract_%d_%s",
+                getpid(), ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        mOutDir = dir;
+        remove_dir(mOutDir);
+        ASSERT_EQ(0, mkdir(mOutDir.c_str(), 0770)) << strerror(errno);
+        mDumper = QCameraFrameDumper::getInstance();
+        ASSERT_TRUE(mDumper->isEnabled());
+    }
+
+    void TearDown() override
+    {
+        remove_dir(mOutDir);
+    }
+
+    void dump(DumpTestFrame &f)
+    {
+        qcamera_dump_stats_t stats;
+        mDumper->getStats(stats);
+        f.seq = stats.submitted;
+        if (f.offset.num_planes > 0) {
+            ASSERT_EQ(NO_ERROR, mDumper->dumpFrame(f.desc, &f.def, f.offset));
+        } else {
+            ASSERT_EQ(NO_ERROR, mDumper->dumpLinear(f.desc, &f.def, f.buf.size()));
+        }
+    }
+
+    /* Waits for the writer to commit every submitted frame */
+    bool waitWritten()
+    {
+        for (int i = 0; i < DUMP_TEST_WAIT_MS; i++) {
+            qcamera_dump_stats_t stats;
+            mDumper->getStats(stats);
+            if (stats.written + stats.droppedFull + stats.writeErrors +
+                    stats.droppedBudget >= stats.submitted) {
+                return (stats.droppedFull == 0) && (stats.writeErrors == 0);
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+
+    /* Container of this process, <time>_<pid>.qcd */
+    std::string findContainer()
+    {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), "_%d.qcd", getpid());
+        std::string found;
+        DIR *d = opendir(QCAMERA_DUMP_FRM_LOCATION);
+        if (d == NULL) {
+            return found;
+        }
+        struct dirent *de;
+        while ((de = readdir(d)) != NULL) {
+            size_t len = strlen(de->d_name);
+            if ((len > strlen(suffix)) &&
+                    !strcmp(de->d_name + len - strlen(suffix), suffix)) {
+                found = std::string(QCAMERA_DUMP_FRM_LOCATION) + de->d_name;
+            }
+        }
+        closedir(d);
+        return found;
+    }
+
+    QCameraFrameDumper *mDumper;
+    std::string mOutDir;
+};
+
+TEST_F(QCameraFrameDumperTest, RejectsBadFrames)
+{
+    DumpTestFrame f;
+    make_nv12(f, 64, 32, 64, 32, 0, 0);
+    EXPECT_EQ(BAD_VALUE, mDumper->dumpFrame(f.desc, NULL, f.offset));
+    f.offset.num_planes = QCAMERA_DUMP_MAX_PLANES + 1;
+    EXPECT_EQ(BAD_VALUE, mDumper->dumpFrame(f.desc, &f.def, f.offset));
+    EXPECT_EQ(BAD_VALUE, mDumper->dumpLinear(f.desc, &f.def, 0));
+    f.def.buffer = NULL;
+    EXPECT_EQ(BAD_VALUE, mDumper->dumpLinear(f.desc, &f.def, 16));
+}
+
+TEST_F(QCameraFrameDumperTest, ExtractRoundTrip)
+{
+    std::vector<DumpTestFrame> frames(4);
+    make_nv12(frames[0], 1280, 720, 1408, 736, 0, 100);
+    make_nv12(frames[1], 1920, 1080, 1920, 1088, 0, 101);
+    make_nv12(frames[2], 640, 480, 768, 512, 4096, 102);
+    frames[2].desc.misc = "ubwc";
+    make_raw(frames[3], 100000, 103);
+    for (size_t i = 0; i < frames.size(); i++) {
+        dump(frames[i]);
+    }
+    ASSERT_TRUE(waitWritten());
+
+    std::string container = findContainer();
+    ASSERT_FALSE(container.empty());
+    EXPECT_EQ(0, run_extract(container, NULL));
+    ASSERT_EQ(0, run_extract(container, mOutDir.c_str()));
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        std::vector<uint8_t> data;
+        std::string name = entry_file_name(frames[i]);
+        ASSERT_TRUE(read_file(mOutDir + "/" + name, data)) << name;
+        ASSERT_EQ(frames[i].packed.size(), data.size()) << name;
+        EXPECT_TRUE(frames[i].packed == data) << name;
+    }
+
+    // Index entries describe the frames
+    FILE *fp = fopen(container.c_str(), "rb");
+    ASSERT_NE((FILE *)NULL, fp);
+    qcamera_dump_file_hdr_t hdr;
+    ASSERT_EQ(1U, fread(&hdr, sizeof(hdr), 1, fp));
+    ASSERT_GE(hdr.num_entries, frames[3].seq + 1);
+    for (size_t i = 0; i < frames.size(); i++) {
+        qcamera_dump_entry_t e;
+        ASSERT_EQ(0, fseeko(fp, (off_t)(QCAMERA_DUMP_HDR_SIZE +
+                (uint64_t)frames[i].seq * sizeof(e)), SEEK_SET));
+        ASSERT_EQ(1U, fread(&e, sizeof(e), 1, fp));
+        EXPECT_EQ(frames[i].seq, e.seq);
+        EXPECT_EQ((uint32_t)frames[i].desc.format, e.format);
+        EXPECT_EQ(frames[i].offset.num_planes, e.num_planes);
+        EXPECT_EQ(frames[i].packed.size(), e.data_len);
+        EXPECT_EQ(0U, e.data_offset % QCAMERA_DUMP_ALIGN);
+        EXPECT_EQ((int64_t)frames[i].def.ts.tv_sec * 1000000000LL +
+                frames[i].def.ts.tv_nsec, e.timestamp);
+        if (e.num_planes == 2) {
+            EXPECT_EQ((uint32_t)frames[i].offset.mp[0].meta_len, e.planes[0].meta_len);
+            EXPECT_EQ(frames[i].offset.mp[1].height, e.planes[1].height);
+            EXPECT_EQ(frames[i].offset.mp[0].meta_len +
+                    frames[i].offset.mp[0].width * frames[i].offset.mp[0].height,
+                    (int32_t)e.planes[1].offset);
+        }
+    }
+    fclose(fp);
+}
+
+TEST_F(QCameraFrameDumperTest, ExtractCutShortContainer)
+{
+    std::vector<DumpTestFrame> frames(3);
+    for (size_t i = 0; i < frames.size(); i++) {
+        make_nv12(frames[i], 320, 240, 384, 256, 0, 200 + i);
+        dump(frames[i]);
+    }
+    ASSERT_TRUE(waitWritten());
+    std::string container = findContainer();
+    ASSERT_FALSE(container.empty());
+
+    // A crash before num_entries was bumped loses the last entries only
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(read_file(container, data));
+    qcamera_dump_file_hdr_t *hdr = (qcamera_dump_file_hdr_t *)data.data();
+    hdr->num_entries = frames[1].seq + 1;
+    std::string cut = mOutDir + "/cut.qcd";
+    ASSERT_TRUE(write_file(cut, data.data(), data.size()));
+    ASSERT_EQ(0, run_extract(cut, mOutDir.c_str()));
+
+    std::vector<uint8_t> out;
+    EXPECT_TRUE(read_file(mOutDir + "/" + entry_file_name(frames[1]), out));
+    EXPECT_TRUE(frames[1].packed == out);
+    EXPECT_FALSE(read_file(mOutDir + "/" + entry_file_name(frames[2]), out));
+}
+
+TEST_F(QCameraFrameDumperTest, ExtractRejectsForeignFiles)
+{
+    qcamera_dump_file_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, QCAMERA_DUMP_MAGIC, sizeof(hdr.magic));
+    hdr.version = QCAMERA_DUMP_VERSION;
+    hdr.entry_size = sizeof(qcamera_dump_entry_t);
+    hdr.max_entries = 4;
+    hdr.data_offset = QCAMERA_DUMP_HDR_SIZE + 4 * sizeof(qcamera_dump_entry_t);
+    hdr.file_size = hdr.data_offset;
+    std::string path = mOutDir + "/foreign.qcd";
+
+    ASSERT_TRUE(write_file(path, &hdr, sizeof(hdr)));
+    EXPECT_EQ(0, run_extract(path, NULL));
+
+    hdr.num_entries = hdr.max_entries + 1;
+    ASSERT_TRUE(write_file(path, &hdr, sizeof(hdr)));
+    EXPECT_EQ(1, run_extract(path, NULL));
+
+    hdr.num_entries = 0;
+    hdr.entry_size = sizeof(qcamera_dump_entry_t) + 8;
+    ASSERT_TRUE(write_file(path, &hdr, sizeof(hdr)));
+    EXPECT_EQ(1, run_extract(path, NULL));
+
+    hdr.entry_size = sizeof(qcamera_dump_entry_t);
+    hdr.magic[0] = 'X';
+    ASSERT_TRUE(write_file(path, &hdr, sizeof(hdr)));
+    EXPECT_EQ(1, run_extract(path, NULL));
+
+    ASSERT_TRUE(write_file(path, "", 0));
+    EXPECT_EQ(1, run_extract(path, NULL));
+    EXPECT_EQ(1, run_extract(mOutDir + "/missing.qcd", NULL));
+}
+
+TEST_F(QCameraFrameDumperTest, ExtractRejectsEntryOutOfRange)
+{
+    std::vector<uint8_t> data(QCAMERA_DUMP_HDR_SIZE + sizeof(qcamera_dump_entry_t));
+    qcamera_dump_file_hdr_t *hdr = (qcamera_dump_file_hdr_t *)data.data();
+    memcpy(hdr->magic, QCAMERA_DUMP_MAGIC, sizeof(hdr->magic));
+    hdr->version = QCAMERA_DUMP_VERSION;
+    hdr->entry_size = sizeof(qcamera_dump_entry_t);
+    hdr->max_entries = 1;
+    hdr->num_entries = 1;
+    hdr->data_offset = data.size();
+    hdr->file_size = data.size() + 16;
+    qcamera_dump_entry_t *e = (qcamera_dump_entry_t *)(data.data() + QCAMERA_DUMP_HDR_SIZE);
+    e->data_offset = hdr->data_offset;
+    e->data_len = 4096;
+    memcpy(e->tag, "p", 2);
+    std::string path = mOutDir + "/range.qcd";
+
+    ASSERT_TRUE(write_file(path, data.data(), data.size()));
+    EXPECT_EQ(0, run_extract(path, NULL));
+    EXPECT_EQ(1, run_extract(path, mOutDir.c_str()));
+}
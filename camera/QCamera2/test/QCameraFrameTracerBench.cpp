@@ -0,0 +1,197 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Overhead benchmark of the always-on frame tracer.
+ *
+ * Measures the cost of one QCameraFrameTracer::record() call, with and
+ * without reading the clock, from one thread and from several threads
+ * recording at once, and the cost of a dump taken while the writers
+ * run. The per-call cost is then scaled to the records a camera session
+ * makes per second at 30, 60 and 120 fps, one record per pipeline stage
+ * and frame.
+ *
+ * Times are wall clock per writer thread, so they include preemption
+ * when there are more writers than cpus.
+ *
+ * The tracer must be enabled (persist.camera.frame.trace, default 1).
+ *
+ * usage: qcamera_frame_tracer_bench [threads] [records_per_thread] */
+
+// System dependencies
+#include <atomic>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Camera dependencies
+#include "QCameraFrameTracer.h"
+
+using namespace qcamera;
+
+typedef struct {
+    pthread_t thread;
+    uint32_t id;
+    uint32_t count;
+    bool withClock;
+    std::atomic<bool> *start;
+    uint64_t ns;
+} bench_writer_t;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *writer_loop(void *arg)
+{
+    bench_writer_t *w = (bench_writer_t *)arg;
+    QCameraFrameTracer *tracer = QCameraFrameTracer::getInstance();
+
+    // Register the ring of this thread outside of the timed loop
+    tracer->record(w->id, 0, QCAMERA_FRAME_STAGE_REQUEST, 0);
+    while (!w->start->load(std::memory_order_acquire)) {
+        sched_yield();
+    }
+
+    uint64_t start = now_ns();
+    for (uint32_t f = 0; f < w->count; f++) {
+        qcamera_frame_stage_t stage =
+                (qcamera_frame_stage_t)(f % QCAMERA_FRAME_STAGE_MAX);
+        if (w->withClock) {
+            tracer->record(w->id, f, stage);
+        } else {
+            tracer->record(w->id, f, stage, (int64_t)f);
+        }
+    }
+    w->ns = now_ns() - start;
+    return NULL;
+}
+
+static double run(uint32_t threads, uint32_t count, bool withClock,
+        int dumpFd, uint32_t dumps, uint64_t *dumpNs)
+{
+    bench_writer_t *w = new bench_writer_t[threads]();
+    std::atomic<bool> start(false);
+    uint64_t totalNs = 0;
+
+    for (uint32_t i = 0; i < threads; i++) {
+        w[i].id = i;
+        w[i].count = count;
+        w[i].withClock = withClock;
+        w[i].start = &start;
+        pthread_create(&w[i].thread, NULL, writer_loop, &w[i]);
+    }
+    start.store(true, std::memory_order_release);
+
+    // Dump repeatedly while the writers are busy, as dumpsys would
+    if (dumpFd >= 0) {
+        QCameraFrameTracer *tracer = QCameraFrameTracer::getInstance();
+        for (uint32_t i = 0; i < dumps; i++) {
+            uint64_t t = now_ns();
+            tracer->dump(dumpFd, 0);
+            *dumpNs += now_ns() - t;
+        }
+    }
+
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(w[i].thread, NULL);
+        totalNs += w[i].ns;
+    }
+    delete[] w;
+    return (double)totalNs / ((double)threads * (double)count);
+}
+
+static void report(const char *name, uint32_t threads, double ns)
+{
+    static const uint32_t fps[] = { 30, 60, 120 };
+
+    printf("%-28s threads=%u: %6.1f ns/record", name, threads, ns);
+    for (uint32_t i = 0; i < sizeof(fps) / sizeof(fps[0]); i++) {
+        double recsPerSec = (double)fps[i] * QCAMERA_FRAME_STAGE_MAX;
+        printf(", %ufps %.1f us/s (%.4f%% cpu)", fps[i],
+                ns * recsPerSec / 1e3, ns * recsPerSec / 1e7);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t threads = (argc > 1) ? (uint32_t)atoi(argv[1]) : 4;
+    uint32_t count = (argc > 2) ? (uint32_t)atoi(argv[2]) : 2000000;
+    uint64_t dumpNs = 0;
+    uint32_t dumps = 20;
+    double ns;
+
+    if ((threads == 0) || (count == 0) ||
+            (threads >= QCAMERA_FRAME_TRACE_MAX_RINGS)) {
+        fprintf(stderr, "usage: %s [threads < %d] [records_per_thread]\n",
+                argv[0], QCAMERA_FRAME_TRACE_MAX_RINGS);
+        return 2;
+    }
+
+    // Warm up, then make sure the records were actually taken
+    run(1, 1000, true, -1, 0, NULL);
+    FILE *exported = tmpfile();
+    struct stat st;
+    if ((exported == NULL) ||
+            (QCameraFrameTracer::getInstance()->exportBinary(
+                fileno(exported)) != 0) ||
+            (fstat(fileno(exported), &st) != 0) || (st.st_size <= 16)) {
+        fprintf(stderr, "FAIL: frame tracer disabled or export failed\n");
+        return 1;
+    }
+    fclose(exported);
+
+    ns = run(1, count, true, -1, 0, NULL);
+    report("record", 1, ns);
+    ns = run(1, count, false, -1, 0, NULL);
+    report("record, caller timestamp", 1, ns);
+    ns = run(threads, count, true, -1, 0, NULL);
+    report("record", threads, ns);
+
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open /dev/null\n");
+        return 1;
+    }
+    ns = run(threads, count, true, fd, dumps, &dumpNs);
+    close(fd);
+    report("record, concurrent dump", threads, ns);
+    printf("dump while recording: %.1f us\n",
+            (double)dumpNs / (double)dumps / 1e3);
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Contention benchmark of the per-frame mm-camera-interface ops.
+ *
+ * Caller threads stand in for the HAL stream threads returning buffers.
+ * They run on one or two fake cameras (mm_camera_interface_fake.c) and
+ * call either get_queued_buf_count, which takes the per-slot user count
+ * like qbuf and cancel_buffer, or get_bundle_info, which looks the camera
+ * up under g_intf_lock as the per-frame ops did before. Both spend the
+ * same busy loop inside the op, standing in for the channel work.
+ *
+ * Per case it reports the mean ns per call of a thread and the total calls
+ * per second of all threads.
+ *
+ * usage: qcamera_intf_contention_bench [calls_per_thread] [op_spin] */
+
+// System dependencies
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Camera dependencies
+extern "C" {
+#include "mm_camera_interface.h"
+}
+#include "mm_camera_interface_fake.h"
+
+#define BENCH_MAX_CAMERAS   2
+#define BENCH_MAX_THREADS   4   // per camera
+
+typedef enum {
+    BENCH_OP_FAST,      // per-slot user count
+    BENCH_OP_LOCKED,    // g_intf_lock
+} bench_op_t;
+
+typedef struct {
+    uint32_t handle;
+    mm_camera_ops_t *ops;
+    bench_op_t op;
+    uint32_t calls;
+    volatile int32_t *go;
+    int32_t errors;
+} bench_thread_t;
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static void *bench_caller(void *data)
+{
+    bench_thread_t *t = (bench_thread_t *)data;
+    cam_bundle_config_t bundle;
+
+    while (!__atomic_load_n(t->go, __ATOMIC_SEQ_CST)) {
+    }
+    for (uint32_t i = 0; i < t->calls; i++) {
+        int32_t rc;
+        if (BENCH_OP_FAST == t->op) {
+            rc = t->ops->get_queued_buf_count(t->handle, 0, 0);
+        } else {
+            rc = t->ops->get_bundle_info(t->handle, 0, &bundle);
+        }
+        if (rc < 0) {
+            t->errors++;
+        }
+    }
+    return NULL;
+}
+
+static int32_t run(mm_camera_vtbl_t **cams, uint32_t numCams, uint32_t threads,
+        bench_op_t op, uint32_t calls)
+{
+    bench_thread_t t[BENCH_MAX_CAMERAS * BENCH_MAX_THREADS];
+    pthread_t tids[BENCH_MAX_CAMERAS * BENCH_MAX_THREADS];
+    uint32_t num = numCams * threads;
+    volatile int32_t go = 0;
+    int32_t errors = 0;
+    int64_t start;
+    int64_t elapsed;
+
+    for (uint32_t i = 0; i < num; i++) {
+        memset(&t[i], 0, sizeof(t[i]));
+        t[i].handle = cams[i % numCams]->camera_handle;
+        t[i].ops = cams[i % numCams]->ops;
+        t[i].op = op;
+        t[i].calls = calls;
+        t[i].go = &go;
+        if (pthread_create(&tids[i], NULL, bench_caller, &t[i]) != 0) {
+            fprintf(stderr, "pthread_create failed\n");
+            exit(1);
+        }
+    }
+    start = now_ns();
+    __atomic_store_n(&go, 1, __ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < num; i++) {
+        pthread_join(tids[i], NULL);
+        errors += t[i].errors;
+    }
+    elapsed = now_ns() - start;
+
+    printf("%-6s %u camera(s) x %u thread(s): %8.1f ns/call, %6.2f Mcalls/s\n",
+            (BENCH_OP_FAST == op) ? "fast" : "locked", numCams, threads,
+            (double)elapsed / (double)calls,
+            (double)calls * num * 1000.0 / (double)elapsed);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t calls = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200000;
+    uint32_t spin = (argc > 2) ? (uint32_t)atoi(argv[2]) : 200;
+    mm_camera_vtbl_t *cams[BENCH_MAX_CAMERAS];
+    int32_t errors = 0;
+
+    if (calls == 0) {
+        fprintf(stderr, "usage: %s [calls_per_thread] [op_spin]\n", argv[0]);
+        return 2;
+    }
+
+    mm_camera_fake_init(BENCH_MAX_CAMERAS, spin);
+    for (uint8_t i = 0; i < BENCH_MAX_CAMERAS; i++) {
+        if (camera_open(i, &cams[i]) != 0) {
+            fprintf(stderr, "camera_open(%u) failed\n", i);
+            return 1;
+        }
+    }
+
+    printf("%u calls per thread, op spin %u\n", calls, spin);
+    for (uint32_t numCams = 1; numCams <= BENCH_MAX_CAMERAS; numCams++) {
+        for (uint32_t threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+            errors += run(cams, numCams, threads, BENCH_OP_FAST, calls);
+            errors += run(cams, numCams, threads, BENCH_OP_LOCKED, calls);
+        }
+    }
+
+    for (uint8_t i = 0; i < BENCH_MAX_CAMERAS; i++) {
+        cams[i]->ops->close_camera(cams[i]->camera_handle);
+    }
+    if (errors || mm_camera_fake_stale_uses()) {
+        fprintf(stderr, "FAIL: %d failed calls, %u stale uses\n",
+                errors, mm_camera_fake_stale_uses());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,244 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Races between per-frame mm-camera-interface calls and camera close.
+ *
+ * qbuf, cancel_buffer and get_queued_buf_count look the camera up without
+ * g_intf_lock and hold a per-slot user count instead, which close drains
+ * before it frees the camera object. mm_camera_interface_fake.c runs this
+ * logic on fake camera objects: several threads keep calling
+ * get_queued_buf_count while the main thread closes the camera, over many
+ * open/close cycles. Calls that start after close returned must fail, and
+ * no call may still use the object once close freed it. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Camera dependencies
+extern "C" {
+#include "mm_camera_interface.h"
+}
+#include "mm_camera_interface_fake.h"
+
+#define RACE_TEST_THREADS   4
+#define RACE_TEST_CYCLES    100
+#define RACE_TEST_OP_SPIN   1000
+
+/* Copies of the vtbl fields, the vtbl is part of the object close frees */
+typedef struct {
+    uint32_t handle;
+    mm_camera_ops_t *ops;
+    volatile int32_t closed;    // set once close_camera returned
+    volatile int32_t stop;
+    volatile int32_t running;   // callers that made their first call
+} race_ctx_t;
+
+typedef struct {
+    race_ctx_t *ctx;
+    uint32_t okBeforeClose;
+    uint32_t failAfterClose;
+    uint32_t okAfterClose;      // must stay 0
+} race_caller_t;
+
+static void *race_caller(void *data)
+{
+    race_caller_t *caller = (race_caller_t *)data;
+    race_ctx_t *ctx = caller->ctx;
+    bool first = true;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_SEQ_CST)) {
+        int32_t closed = __atomic_load_n(&ctx->closed, __ATOMIC_SEQ_CST);
+        int32_t rc = ctx->ops->get_queued_buf_count(ctx->handle, 0, 0);
+        if (first) {
+            __atomic_add_fetch(&ctx->running, 1, __ATOMIC_SEQ_CST);
+            first = false;
+        }
+        if (!closed) {
+            caller->okBeforeClose += (rc >= 0) ? 1 : 0;
+        } else if (rc < 0) {
+            caller->failAfterClose++;
+        } else {
+            caller->okAfterClose++;
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    race_ctx_t *ctx;
+    int32_t rc;
+    volatile int32_t done;
+} race_call_t;
+
+static void *race_get_count(void *data)
+{
+    race_call_t *call = (race_call_t *)data;
+    call->rc = call->ctx->ops->get_queued_buf_count(call->ctx->handle, 0, 0);
+    __atomic_store_n(&call->done, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+static void *race_close(void *data)
+{
+    race_call_t *call = (race_call_t *)data;
+    call->rc = call->ctx->ops->close_camera(call->ctx->handle);
+    __atomic_store_n(&call->done, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+class QCameraIntfFastUserTest : public ::testing::Test {
+protected:
+    virtual void SetUp() {
+        mm_camera_fake_init(2, RACE_TEST_OP_SPIN);
+    }
+
+    virtual void TearDown() {
+        mm_camera_fake_gate(-1);
+        EXPECT_EQ(0U, mm_camera_fake_stale_uses());
+    }
+
+    void openCamera(uint8_t camIdx, race_ctx_t *ctx) {
+        mm_camera_vtbl_t *cam = NULL;
+
+        memset(ctx, 0, sizeof(*ctx));
+        ASSERT_EQ(0, camera_open(camIdx, &cam));
+        ASSERT_TRUE(cam != NULL);
+        ctx->handle = cam->camera_handle;
+        ctx->ops = cam->ops;
+    }
+};
+
+TEST_F(QCameraIntfFastUserTest, CloseRacesPerFrameCallers)
+{
+    uint32_t okBeforeClose = 0;
+    uint32_t failAfterClose = 0;
+
+    for (uint32_t cycle = 0; cycle < RACE_TEST_CYCLES; cycle++) {
+        race_ctx_t ctx;
+        race_caller_t callers[RACE_TEST_THREADS];
+        pthread_t tids[RACE_TEST_THREADS];
+
+        openCamera(0, &ctx);
+        ASSERT_FALSE(HasFatalFailure());
+        for (uint32_t i = 0; i < RACE_TEST_THREADS; i++) {
+            memset(&callers[i], 0, sizeof(callers[i]));
+            callers[i].ctx = &ctx;
+            ASSERT_EQ(0, pthread_create(&tids[i], NULL, race_caller, &callers[i]));
+        }
+        while (__atomic_load_n(&ctx.running, __ATOMIC_SEQ_CST) < RACE_TEST_THREADS) {
+            sched_yield();
+        }
+        // vary where in the callers' loop close lands
+        usleep(cycle % 10 * 50);
+
+        EXPECT_EQ(0, ctx.ops->close_camera(ctx.handle));
+        __atomic_store_n(&ctx.closed, 1, __ATOMIC_SEQ_CST);
+        usleep(200);
+        __atomic_store_n(&ctx.stop, 1, __ATOMIC_SEQ_CST);
+
+        for (uint32_t i = 0; i < RACE_TEST_THREADS; i++) {
+            pthread_join(tids[i], NULL);
+            EXPECT_EQ(0U, callers[i].okAfterClose) << "cycle " << cycle;
+            okBeforeClose += callers[i].okBeforeClose;
+            failAfterClose += callers[i].failAfterClose;
+        }
+    }
+    printf("%u calls served before close, %u rejected after close\n",
+            okBeforeClose, failAfterClose);
+    EXPECT_GT(okBeforeClose, 0U);
+    EXPECT_GT(failAfterClose, 0U);
+}
+
+TEST_F(QCameraIntfFastUserTest, CloseWaitsForCallerInsideOp)
+{
+    race_ctx_t ctx;
+    race_ctx_t other;
+    race_call_t user;
+    race_call_t closer;
+    pthread_t userTid;
+    pthread_t closeTid;
+    cam_bundle_config_t bundle;
+
+    openCamera(0, &ctx);
+    ASSERT_FALSE(HasFatalFailure());
+    openCamera(1, &other);
+    ASSERT_FALSE(HasFatalFailure());
+
+    // park a per-frame call inside the op, camera object acquired
+    mm_camera_fake_gate(0);
+    memset(&user, 0, sizeof(user));
+    user.ctx = &ctx;
+    ASSERT_EQ(0, pthread_create(&userTid, NULL, race_get_count, &user));
+    while (mm_camera_fake_gate_waiters() < 1) {
+        usleep(100);
+    }
+
+    memset(&closer, 0, sizeof(closer));
+    closer.ctx = &ctx;
+    ASSERT_EQ(0, pthread_create(&closeTid, NULL, race_close, &closer));
+    usleep(50000);
+    EXPECT_FALSE(__atomic_load_n(&closer.done, __ATOMIC_SEQ_CST));
+
+    // the slot is cleared already, new calls on the handle fail at once
+    EXPECT_LT(ctx.ops->get_queued_buf_count(ctx.handle, 0, 0), 0);
+    // and the drain holds no global lock: camera 1 keeps working
+    EXPECT_EQ(0, other.ops->get_queued_buf_count(other.handle, 0, 0));
+    EXPECT_EQ(0, other.ops->get_bundle_info(other.handle, 0, &bundle));
+
+    mm_camera_fake_gate(-1);
+    pthread_join(userTid, NULL);
+    pthread_join(closeTid, NULL);
+    EXPECT_EQ(0, user.rc);
+    EXPECT_EQ(0, closer.rc);
+    EXPECT_EQ(0, other.ops->close_camera(other.handle));
+}
+
+TEST_F(QCameraIntfFastUserTest, StaleHandleAfterReopen)
+{
+    race_ctx_t stale;
+    race_ctx_t ctx;
+
+    openCamera(0, &stale);
+    ASSERT_FALSE(HasFatalFailure());
+    ASSERT_EQ(0, stale.ops->close_camera(stale.handle));
+
+    // same slot, new handle: the old one must not reach the new object
+    openCamera(0, &ctx);
+    ASSERT_FALSE(HasFatalFailure());
+    ASSERT_NE(stale.handle, ctx.handle);
+    EXPECT_EQ(0, ctx.ops->get_queued_buf_count(ctx.handle, 0, 0));
+    EXPECT_LT(ctx.ops->get_queued_buf_count(stale.handle, 0, 0), 0);
+    EXPECT_LT(ctx.ops->cancel_buffer(stale.handle, 0, 0, 0), 0);
+    EXPECT_EQ(0, ctx.ops->close_camera(ctx.handle));
+}
@@ -0,0 +1,171 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Throughput benchmark of the native lib2d backend on a 12MP frame.
+ *
+ * Runs every rotation of a 4000x3000 NV21 frame and its ARGB conversion
+ * through the regular build (NEON on ARM) and the plain C build of
+ * mm_lib2d_native_c.c, and prints MP/s averaged over the iterations.
+ * The first run of each case is a warm up and is not counted.
+ *
+ * usage: qcamera_lib2d_native_bench [workers] [iterations] */
+
+// System dependencies
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+// Camera dependencies
+extern "C" {
+#include "mm_lib2d_native.h"
+
+lib2d_error mm_lib2d_native_c_init(uint32_t num_workers, void **p_handle);
+void mm_lib2d_native_c_deinit(void *handle);
+lib2d_error mm_lib2d_native_c_process(void *handle,
+  mm_lib2d_buffer *src_buffer, mm_lib2d_buffer *dst_buffer,
+  uint32_t rotation);
+}
+
+#define BENCH_WIDTH  4000
+#define BENCH_HEIGHT 3000
+
+typedef lib2d_error (*process_fn)(void *handle, mm_lib2d_buffer *src_buffer,
+  mm_lib2d_buffer *dst_buffer, uint32_t rotation);
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void fill_yuv(mm_lib2d_buffer &buf, uint8_t *data, uint32_t w,
+  uint32_t h)
+{
+  memset(&buf, 0, sizeof(buf));
+  buf.buffer_type = MM_LIB2D_BUFFER_TYPE_YUV;
+  buf.yuv_buffer.format = CAM_FORMAT_YUV_420_NV21;
+  buf.yuv_buffer.width = w;
+  buf.yuv_buffer.height = h;
+  buf.yuv_buffer.plane0 = data;
+  buf.yuv_buffer.stride0 = (int32_t)w;
+  buf.yuv_buffer.plane1 = data + w * h;
+  buf.yuv_buffer.stride1 = (int32_t)w;
+}
+
+static double run(process_fn process, void *handle, mm_lib2d_buffer &src,
+  mm_lib2d_buffer &dst, uint32_t rotation, uint32_t iterations)
+{
+  uint64_t total = 0;
+
+  for (uint32_t i = 0; i <= iterations; i++) {
+    uint64_t start = now_ns();
+    if (process(handle, &src, &dst, rotation) != MM_LIB2D_SUCCESS) {
+      return -1.0;
+    }
+    if (i > 0) {
+      total += now_ns() - start;
+    }
+  }
+  return (double)BENCH_WIDTH * BENCH_HEIGHT * iterations / (double)total *
+    1e3;
+}
+
+int main(int argc, char *argv[])
+{
+  static const uint32_t rotations[] = { 0, 90, 180, 270 };
+  uint32_t workers = (argc > 1) ? (uint32_t)atoi(argv[1]) : 3;
+  uint32_t iterations = (argc > 2) ? (uint32_t)atoi(argv[2]) : 10;
+  size_t yuv_size = BENCH_WIDTH * BENCH_HEIGHT * 3 / 2;
+  std::vector<uint8_t> src_data(yuv_size), dst_data(yuv_size);
+  std::vector<uint8_t> argb_data(BENCH_WIDTH * BENCH_HEIGHT * 4);
+  mm_lib2d_buffer src, dst, argb;
+  void *native = NULL, *plain = NULL;
+  int rc = 0;
+
+  if ((iterations == 0) || (workers > MM_LIB2D_NATIVE_MAX_WORKERS)) {
+    fprintf(stderr, "usage: %s [workers <= %d] [iterations]\n", argv[0],
+      MM_LIB2D_NATIVE_MAX_WORKERS);
+    return 2;
+  }
+  if ((mm_lib2d_native_init(workers, &native) != MM_LIB2D_SUCCESS) ||
+    (mm_lib2d_native_c_init(workers, &plain) != MM_LIB2D_SUCCESS)) {
+    fprintf(stderr, "FAIL: cannot create the native backend\n");
+    return 1;
+  }
+
+  for (size_t i = 0; i < yuv_size; i++) {
+    src_data[i] = (uint8_t)rand();
+  }
+  fill_yuv(src, &src_data[0], BENCH_WIDTH, BENCH_HEIGHT);
+  memset(&argb, 0, sizeof(argb));
+  argb.buffer_type = MM_LIB2D_BUFFER_TYPE_RGB;
+  argb.rgb_buffer.format = CAM_FORMAT_8888_ARGB;
+  argb.rgb_buffer.width = BENCH_WIDTH;
+  argb.rgb_buffer.height = BENCH_HEIGHT;
+  argb.rgb_buffer.buffer = &argb_data[0];
+  argb.rgb_buffer.stride = BENCH_WIDTH * 4;
+
+  printf("%ux%u NV21, %u workers + caller, %u iterations\n", BENCH_WIDTH,
+    BENCH_HEIGHT, workers, iterations);
+  for (size_t i = 0; i < sizeof(rotations) / sizeof(rotations[0]); i++) {
+    bool swap = (rotations[i] == 90) || (rotations[i] == 270);
+    fill_yuv(dst, &dst_data[0], swap ? BENCH_HEIGHT : BENCH_WIDTH,
+      swap ? BENCH_WIDTH : BENCH_HEIGHT);
+    double mps = run(mm_lib2d_native_process, native, src, dst,
+      rotations[i], iterations);
+    double c_mps = run(mm_lib2d_native_c_process, plain, src, dst,
+      rotations[i], iterations);
+    if ((mps < 0) || (c_mps < 0)) {
+      fprintf(stderr, "FAIL: rotation %u\n", rotations[i]);
+      rc = 1;
+      continue;
+    }
+    printf("rotate %3u: native %7.1f MP/s, C %7.1f MP/s\n", rotations[i],
+      mps, c_mps);
+  }
+
+  double mps = run(mm_lib2d_native_process, native, src, argb, 0,
+    iterations);
+  double c_mps = run(mm_lib2d_native_c_process, plain, src, argb, 0,
+    iterations);
+  if ((mps < 0) || (c_mps < 0)) {
+    fprintf(stderr, "FAIL: ARGB conversion\n");
+    rc = 1;
+  } else {
+    printf("to ARGB   : native %7.1f MP/s, C %7.1f MP/s\n", mps, c_mps);
+  }
+
+  mm_lib2d_native_deinit(native);
+  mm_lib2d_native_c_deinit(plain);
+  return rc;
+}
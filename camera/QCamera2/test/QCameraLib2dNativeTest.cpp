@@ -0,0 +1,351 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Bit-exactness tests of the native lib2d backend.
+ *
+ * Every conversion is run through the regular build of the backend,
+ * which uses NEON on ARM, and through the plain C build of
+ * mm_lib2d_native_c.c. Both must match the per-pixel reference below
+ * byte for byte, padding included: rotations by 0/90/180/270 (180 being
+ * the row flip path), and NV12/NV21 to ARGB with the Q14 BT.601
+ * coefficients of the backend. Sizes are chosen to hit the 8x8 block
+ * edges, partial tiles and bands, and the scalar tails of the vector
+ * loops. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Camera dependencies
+extern "C" {
+#include "mm_lib2d_native.h"
+
+int mm_lib2d_native_c_supported(cam_format_t src_format,
+  cam_format_t dst_format);
+lib2d_error mm_lib2d_native_c_init(uint32_t num_workers, void **p_handle);
+void mm_lib2d_native_c_deinit(void *handle);
+lib2d_error mm_lib2d_native_c_process(void *handle,
+  mm_lib2d_buffer *src_buffer, mm_lib2d_buffer *dst_buffer,
+  uint32_t rotation);
+}
+
+#define PAD_BYTE   0xA5
+#define SRC_PAD    24
+#define DST_PAD    12
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+} test_size_t;
+
+static const test_size_t kSizes[] = {
+  { 2, 2 }, { 8, 8 }, { 16, 2 }, { 18, 14 }, { 38, 22 }, { 64, 48 },
+  { 130, 66 }, { 250, 142 },
+};
+
+/* NV12/NV21 frame with stride padding filled with PAD_BYTE */
+class YuvFrame {
+public:
+  YuvFrame(uint32_t w, uint32_t h, uint32_t pad, bool random)
+    : width(w), height(h), stride(w + pad),
+      data(stride * (h + h / 2), PAD_BYTE)
+  {
+    if (!random) {
+      return;
+    }
+    for (uint32_t y = 0; y < h + h / 2; y++) {
+      for (uint32_t x = 0; x < w; x++) {
+        data[y * stride + x] = (uint8_t)rand();
+      }
+    }
+  }
+  uint8_t *luma() { return &data[0]; }
+  uint8_t *chroma() { return &data[stride * height]; }
+  void fill(mm_lib2d_buffer &buf, cam_format_t format)
+  {
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer_type = MM_LIB2D_BUFFER_TYPE_YUV;
+    buf.yuv_buffer.format = format;
+    buf.yuv_buffer.width = width;
+    buf.yuv_buffer.height = height;
+    buf.yuv_buffer.plane0 = luma();
+    buf.yuv_buffer.stride0 = (int32_t)stride;
+    buf.yuv_buffer.plane1 = chroma();
+    buf.yuv_buffer.stride1 = (int32_t)stride;
+  }
+
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+  std::vector<uint8_t> data;
+};
+
+static void ref_src_pos(uint32_t w, uint32_t h, uint32_t rotation,
+  uint32_t dx, uint32_t dy, uint32_t *sx, uint32_t *sy)
+{
+  switch (rotation) {
+  case 90:
+    *sx = dy;
+    *sy = h - 1 - dx;
+    break;
+  case 180:
+    *sx = w - 1 - dx;
+    *sy = h - 1 - dy;
+    break;
+  case 270:
+    *sx = w - 1 - dy;
+    *sy = dx;
+    break;
+  default:
+    *sx = dx;
+    *sy = dy;
+    break;
+  }
+}
+
+static void ref_rotate(YuvFrame &src, YuvFrame &dst, uint32_t rotation)
+{
+  uint32_t sx, sy;
+
+  for (uint32_t dy = 0; dy < dst.height; dy++) {
+    for (uint32_t dx = 0; dx < dst.width; dx++) {
+      ref_src_pos(src.width, src.height, rotation, dx, dy, &sx, &sy);
+      dst.luma()[dy * dst.stride + dx] = src.luma()[sy * src.stride + sx];
+    }
+  }
+  for (uint32_t dy = 0; dy < dst.height / 2; dy++) {
+    for (uint32_t dx = 0; dx < dst.width / 2; dx++) {
+      ref_src_pos(src.width / 2, src.height / 2, rotation, dx, dy, &sx, &sy);
+      memcpy(&dst.chroma()[dy * dst.stride + dx * 2],
+        &src.chroma()[sy * src.stride + sx * 2], 2);
+    }
+  }
+}
+
+static uint8_t ref_clamp(int32_t v)
+{
+  v >>= 14;
+  return (uint8_t)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+static void ref_argb(YuvFrame &src, bool v_first, std::vector<uint8_t> &dst,
+  uint32_t dst_stride)
+{
+  for (uint32_t y = 0; y < src.height; y++) {
+    for (uint32_t x = 0; x < src.width; x++) {
+      const uint8_t *c = &src.chroma()[(y / 2) * src.stride + (x & ~1U)];
+      int32_t yq = ((int32_t)src.luma()[y * src.stride + x] << 14) +
+        (1 << 13);
+      int32_t u = (int32_t)c[v_first ? 1 : 0] - 128;
+      int32_t v = (int32_t)c[v_first ? 0 : 1] - 128;
+      uint8_t *d = &dst[y * dst_stride + x * 4];
+
+      d[0] = ref_clamp(yq + 22970 * v);
+      d[1] = ref_clamp(yq - 5638 * u - 11700 * v);
+      d[2] = ref_clamp(yq + 29032 * u);
+      d[3] = 0xFF;
+    }
+  }
+}
+
+class Lib2dNativeTest : public ::testing::Test {
+protected:
+  void SetUp()
+  {
+    srand(1);
+    ASSERT_EQ(MM_LIB2D_SUCCESS, mm_lib2d_native_init(2, &mHandle));
+    ASSERT_EQ(MM_LIB2D_SUCCESS, mm_lib2d_native_c_init(2, &mCHandle));
+  }
+  void TearDown()
+  {
+    mm_lib2d_native_deinit(mHandle);
+    mm_lib2d_native_c_deinit(mCHandle);
+  }
+  void checkRotation(uint32_t w, uint32_t h, cam_format_t format,
+    uint32_t rotation);
+  void checkArgb(YuvFrame &src, cam_format_t format);
+
+  void *mHandle;
+  void *mCHandle;
+};
+
+void Lib2dNativeTest::checkRotation(uint32_t w, uint32_t h,
+  cam_format_t format, uint32_t rotation)
+{
+  bool swap = (rotation == 90) || (rotation == 270);
+  uint32_t dw = swap ? h : w;
+  uint32_t dh = swap ? w : h;
+  YuvFrame src(w, h, SRC_PAD, true);
+  YuvFrame ref(dw, dh, DST_PAD, false);
+  YuvFrame out(dw, dh, DST_PAD, false);
+  YuvFrame out_c(dw, dh, DST_PAD, false);
+  mm_lib2d_buffer src_buf, dst_buf;
+
+  ref_rotate(src, ref, rotation);
+
+  src.fill(src_buf, format);
+  out.fill(dst_buf, format);
+  ASSERT_EQ(MM_LIB2D_SUCCESS,
+    mm_lib2d_native_process(mHandle, &src_buf, &dst_buf, rotation));
+  out_c.fill(dst_buf, format);
+  ASSERT_EQ(MM_LIB2D_SUCCESS,
+    mm_lib2d_native_c_process(mCHandle, &src_buf, &dst_buf, rotation));
+
+  EXPECT_TRUE(out_c.data == ref.data) << "C vs reference " << w << "x" << h
+    << " format " << format << " rotation " << rotation;
+  EXPECT_TRUE(out.data == out_c.data) << "native vs C " << w << "x" << h
+    << " format " << format << " rotation " << rotation;
+}
+
+void Lib2dNativeTest::checkArgb(YuvFrame &src, cam_format_t format)
+{
+  uint32_t stride = src.width * 4 + DST_PAD * 4;
+  std::vector<uint8_t> ref(stride * src.height, PAD_BYTE);
+  std::vector<uint8_t> out(ref.size(), PAD_BYTE);
+  std::vector<uint8_t> out_c(ref.size(), PAD_BYTE);
+  mm_lib2d_buffer src_buf, dst_buf;
+
+  ref_argb(src, format == CAM_FORMAT_YUV_420_NV21, ref, stride);
+
+  src.fill(src_buf, format);
+  memset(&dst_buf, 0, sizeof(dst_buf));
+  dst_buf.buffer_type = MM_LIB2D_BUFFER_TYPE_RGB;
+  dst_buf.rgb_buffer.format = CAM_FORMAT_8888_ARGB;
+  dst_buf.rgb_buffer.width = src.width;
+  dst_buf.rgb_buffer.height = src.height;
+  dst_buf.rgb_buffer.stride = (int32_t)stride;
+  dst_buf.rgb_buffer.buffer = &out[0];
+  ASSERT_EQ(MM_LIB2D_SUCCESS,
+    mm_lib2d_native_process(mHandle, &src_buf, &dst_buf, 0));
+  dst_buf.rgb_buffer.buffer = &out_c[0];
+  ASSERT_EQ(MM_LIB2D_SUCCESS,
+    mm_lib2d_native_c_process(mCHandle, &src_buf, &dst_buf, 0));
+
+  EXPECT_TRUE(out_c == ref) << "C vs reference " << src.width << "x"
+    << src.height << " format " << format;
+  EXPECT_TRUE(out == out_c) << "native vs C " << src.width << "x"
+    << src.height << " format " << format;
+}
+
+TEST_F(Lib2dNativeTest, Rotate0)
+{
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV12, 0);
+  }
+}
+
+TEST_F(Lib2dNativeTest, Rotate90)
+{
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV12, 90);
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV21, 90);
+  }
+}
+
+TEST_F(Lib2dNativeTest, Rotate180)
+{
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV12, 180);
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV21, 180);
+  }
+}
+
+TEST_F(Lib2dNativeTest, Rotate270)
+{
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV12, 270);
+    checkRotation(kSizes[i].width, kSizes[i].height,
+      CAM_FORMAT_YUV_420_NV21, 270);
+  }
+}
+
+TEST_F(Lib2dNativeTest, FlipEveryRowWidth)
+{
+  // 180 flips each row; cover the vector body and every tail length
+  for (uint32_t w = 2; w <= 68; w += 2) {
+    checkRotation(w, 4, CAM_FORMAT_YUV_420_NV12, 180);
+  }
+}
+
+TEST_F(Lib2dNativeTest, ArgbRandom)
+{
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); i++) {
+    YuvFrame src(kSizes[i].width, kSizes[i].height, SRC_PAD, true);
+    checkArgb(src, CAM_FORMAT_YUV_420_NV12);
+    checkArgb(src, CAM_FORMAT_YUV_420_NV21);
+  }
+}
+
+TEST_F(Lib2dNativeTest, ArgbClamping)
+{
+  // every Y with the chroma extremes, both ends of each channel clamp
+  static const uint8_t kChroma[] = { 0, 1, 127, 128, 129, 254, 255 };
+  const uint32_t nc = sizeof(kChroma) / sizeof(kChroma[0]);
+  YuvFrame src(256 * 2, nc * nc * 2, SRC_PAD, false);
+
+  for (uint32_t y = 0; y < src.height; y++) {
+    for (uint32_t x = 0; x < src.width; x++) {
+      src.luma()[y * src.stride + x] = (uint8_t)(x / 2);
+    }
+  }
+  for (uint32_t y = 0; y < src.height / 2; y++) {
+    for (uint32_t x = 0; x < src.width; x += 2) {
+      src.chroma()[y * src.stride + x] = kChroma[y / nc];
+      src.chroma()[y * src.stride + x + 1] = kChroma[y % nc];
+    }
+  }
+  checkArgb(src, CAM_FORMAT_YUV_420_NV12);
+  checkArgb(src, CAM_FORMAT_YUV_420_NV21);
+}
+
+TEST_F(Lib2dNativeTest, BadParams)
+{
+  YuvFrame src(16, 8, 0, true);
+  YuvFrame dst(16, 8, 0, false);
+  mm_lib2d_buffer src_buf, dst_buf;
+
+  src.fill(src_buf, CAM_FORMAT_YUV_420_NV12);
+  dst.fill(dst_buf, CAM_FORMAT_YUV_420_NV12);
+  EXPECT_EQ(MM_LIB2D_ERR_BAD_PARAM,
+    mm_lib2d_native_process(mHandle, &src_buf, &dst_buf, 45));
+  EXPECT_EQ(MM_LIB2D_ERR_BAD_PARAM,
+    mm_lib2d_native_process(mHandle, &src_buf, &dst_buf, 90));
+  dst_buf.yuv_buffer.format = CAM_FORMAT_YUV_420_NV21;
+  EXPECT_EQ(MM_LIB2D_ERR_BAD_PARAM,
+    mm_lib2d_native_process(mHandle, &src_buf, &dst_buf, 0));
+}
@@ -0,0 +1,164 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* MPO composition benchmark on a 13MP + 13MP dual camera capture.
+ *
+ * Composes two sample JPEGs of jpeg_bytes each (default 5MB, about a
+ * 4160x3120 capture at high quality) and prints the time per MPO for:
+ *   index     - the APPn index walk that finds the MP header
+ *   compose   - mm_jpeg_mpo_compose copying both images, as QCameraMuxer
+ *               uses it today
+ *   in place  - the primary image already encoded into the output, only
+ *               the aux image is appended
+ *   header    - patching the MP entries alone, the cost left if both
+ *               images were encoded at their offsets in the output
+ * The first run of each case is a warm up and is not counted.
+ *
+ * usage: qcamera_mpo_compose_bench [iterations] [jpeg_bytes] */
+
+// System dependencies
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraMpoSample.h"
+
+extern "C" int mm_jpeg_mpo_update_header(mm_jpeg_mpo_info_t *mpo_info);
+
+using namespace qcamera;
+
+typedef enum {
+  BENCH_INDEX,
+  BENCH_COMPOSE,
+  BENCH_IN_PLACE,
+  BENCH_HEADER,
+} bench_case_t;
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Average ns per MPO, -1 on failure */
+static double run(bench_case_t bench, QCameraMpoSample &primary,
+  QCameraMpoSample &aux, std::vector<uint8_t> &out, uint32_t iterations)
+{
+  mm_jpeg_mpo_info_t info;
+  uint64_t total = 0;
+  int rc = 0;
+
+  memset(&info, 0, sizeof(info));
+  info.num_of_images = 2;
+  info.primary_image.buf_vaddr = primary.data();
+  info.primary_image.buf_filled_len = primary.size();
+  info.aux_images[0].buf_vaddr = aux.data();
+  info.aux_images[0].buf_filled_len = aux.size();
+  info.output_buff.buf_vaddr = &out[0];
+  info.output_buff_size = (uint32_t)out.size();
+  memcpy(&out[0], primary.data(), primary.size());
+  memcpy(&out[primary.size()], aux.data(), aux.size());
+
+  for (uint32_t i = 0; i <= iterations; i++) {
+    uint64_t start = now_ns();
+    switch (bench) {
+    case BENCH_INDEX:
+      rc = mm_jpeg_mpo_get_app_marker(primary.data(), (int)primary.size(),
+        0xE2) ? 0 : -1;
+      break;
+    case BENCH_COMPOSE:
+      info.output_buff.buf_filled_len = 0;
+      rc = mm_jpeg_mpo_compose(&info);
+      break;
+    case BENCH_IN_PLACE:
+      info.output_buff.buf_filled_len = primary.size();
+      rc = mm_jpeg_mpo_compose(&info);
+      break;
+    case BENCH_HEADER:
+      info.output_buff.buf_filled_len = primary.size() + aux.size();
+      rc = mm_jpeg_mpo_update_header(&info);
+      break;
+    }
+    if (rc != 0) {
+      return -1.0;
+    }
+    if (i > 0) {
+      total += now_ns() - start;
+    }
+  }
+  return (double)total / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+  static const struct {
+    bench_case_t bench;
+    const char *name;
+    uint32_t copied;  // images copied per MPO
+  } cases[] = {
+    { BENCH_INDEX,    "index",    0 },
+    { BENCH_COMPOSE,  "compose",  2 },
+    { BENCH_IN_PLACE, "in place", 1 },
+    { BENCH_HEADER,   "header",   0 },
+  };
+  uint32_t iterations = (argc > 1) ? (uint32_t)atoi(argv[1]) : 20;
+  uint32_t jpeg_bytes = (argc > 2) ? (uint32_t)atoi(argv[2]) : 5 << 20;
+
+  if ((iterations == 0) || (jpeg_bytes < 1024)) {
+    fprintf(stderr, "usage: %s [iterations] [jpeg_bytes >= 1024]\n",
+      argv[0]);
+    return 2;
+  }
+
+  QCameraMpoSample primary(jpeg_bytes, true, false, 1);
+  QCameraMpoSample aux(jpeg_bytes, true, false, 2);
+  std::vector<uint8_t> out(primary.size() + aux.size());
+
+  printf("13MP + 13MP MPO, %u + %u bytes, %u iterations\n", primary.size(),
+    aux.size(), iterations);
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    double ns = run(cases[i].bench, primary, aux, out, iterations);
+    if (ns < 0) {
+      fprintf(stderr, "FAIL: %s\n", cases[i].name);
+      return 1;
+    }
+    if (cases[i].copied) {
+      printf("%-8s: %9.1f us per MPO, %6.2f GB/s copied\n", cases[i].name,
+        ns / 1e3, (double)jpeg_bytes * cases[i].copied / ns);
+    } else {
+      printf("%-8s: %9.1f us per MPO\n", cases[i].name, ns / 1e3);
+    }
+  }
+  return 0;
+}
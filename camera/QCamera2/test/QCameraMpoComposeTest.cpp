@@ -0,0 +1,204 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Tests of MPO composition on sample JPEGs.
+ *
+ * The APPn index of mm_jpeg_mpo_composer.c must find the segments of a
+ * well formed header, stop at SOS so marker-like bytes of the scan data
+ * are never taken for APP2, and stay inside the buffer when a segment
+ * length is corrupt. mm_jpeg_mpo_compose must lay the aux image right
+ * after the primary one and patch the sizes and the aux offset into the
+ * MP entries, in both MP header byte orders, also when the primary image
+ * already sits in the output buffer. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraMpoSample.h"
+
+using namespace qcamera;
+
+static void fill_mpo_info(mm_jpeg_mpo_info_t &info, QCameraMpoSample &primary,
+    QCameraMpoSample &aux, std::vector<uint8_t> &out)
+{
+  memset(&info, 0, sizeof(info));
+  info.num_of_images = 2;
+  info.primary_image.buf_vaddr = primary.data();
+  info.primary_image.buf_filled_len = primary.size();
+  info.aux_images[0].buf_vaddr = aux.data();
+  info.aux_images[0].buf_filled_len = aux.size();
+  info.output_buff.buf_vaddr = &out[0];
+  info.output_buff.buf_filled_len = 0;
+  info.output_buff_size = (uint32_t)out.size();
+}
+
+static void expect_mpo(const std::vector<uint8_t> &out,
+    QCameraMpoSample &primary, QCameraMpoSample &aux)
+{
+  uint32_t entry = primary.mpEntryOffset();
+  uint32_t entryBytes = 2 * MP_INDEX_ENTRY_VALUE_BYTES;
+
+  // everything but the MP entries is the two images back to back
+  EXPECT_EQ(0, memcmp(&out[0], primary.data(), entry));
+  EXPECT_EQ(0, memcmp(&out[entry + entryBytes], primary.data() + entry +
+      entryBytes, primary.size() - entry - entryBytes));
+  EXPECT_EQ(0, memcmp(&out[primary.size()], aux.data(), aux.size()));
+
+  EXPECT_EQ(primary.size(),
+      mpo_read_entry(&out[0], primary, 0, MPO_ENTRY_SIZE));
+  EXPECT_EQ(0u, mpo_read_entry(&out[0], primary, 0, MPO_ENTRY_OFFSET));
+  EXPECT_EQ(aux.size(),
+      mpo_read_entry(&out[0], primary, 1, MPO_ENTRY_SIZE));
+  EXPECT_EQ(primary.size() - primary.mpHeaderOffset(),
+      mpo_read_entry(&out[0], primary, 1, MPO_ENTRY_OFFSET));
+  // attributes are left to the encoder
+  EXPECT_EQ(mpo_read_entry(primary.data(), primary, 1, MPO_ENTRY_ATTRIBUTE),
+      mpo_read_entry(&out[0], primary, 1, MPO_ENTRY_ATTRIBUTE));
+}
+
+TEST(QCameraMpoCompose, IndexFindsAppSegments)
+{
+  QCameraMpoSample jpeg(4096);
+
+  EXPECT_EQ(jpeg.data() + jpeg.app1Offset(),
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE1));
+  EXPECT_EQ(jpeg.data() + jpeg.app2Offset(),
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE2));
+  EXPECT_EQ(NULL,
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE0));
+  // not an APPn marker
+  EXPECT_EQ(NULL,
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xDB));
+}
+
+TEST(QCameraMpoCompose, IndexStopsAtSos)
+{
+  QCameraMpoSample jpeg(4096, false);
+  uint8_t *scan = jpeg.data() + jpeg.sosOffset() + 10;
+
+  // an APP2 marker look-alike in the scan data must not be found
+  scan[100] = 0xFF;
+  scan[101] = 0xE2;
+  scan[102] = 0x00;
+  scan[103] = 0x10;
+  EXPECT_EQ(NULL,
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE2));
+}
+
+TEST(QCameraMpoCompose, IndexBoundsCorruptLength)
+{
+  QCameraMpoSample jpeg(64);
+  uint8_t *app1Len = jpeg.data() + jpeg.app1Offset();
+
+  // APP1 claims to run past the end of the image
+  app1Len[0] = 0xFF;
+  app1Len[1] = 0xF0;
+  EXPECT_EQ(NULL,
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE1));
+  EXPECT_EQ(NULL,
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE2));
+
+  // the header is cut short in the middle of APP2
+  EXPECT_EQ(NULL, mm_jpeg_mpo_get_app_marker(jpeg.data(),
+      (int)jpeg.app2Offset() + 1, 0xE2));
+
+  // not a JPEG
+  jpeg.data()[1] = 0x00;
+  EXPECT_EQ(NULL,
+      mm_jpeg_mpo_get_app_marker(jpeg.data(), (int)jpeg.size(), 0xE1));
+}
+
+TEST(QCameraMpoCompose, ComposeLittleEndian)
+{
+  QCameraMpoSample primary(100000, true, false, 1);
+  QCameraMpoSample aux(60000, true, false, 2);
+  std::vector<uint8_t> out(primary.size() + aux.size() + 512, 0);
+  mm_jpeg_mpo_info_t info;
+
+  fill_mpo_info(info, primary, aux, out);
+  ASSERT_EQ(0, mm_jpeg_mpo_compose(&info));
+  EXPECT_EQ(primary.size() + aux.size(), info.output_buff.buf_filled_len);
+  expect_mpo(out, primary, aux);
+}
+
+TEST(QCameraMpoCompose, ComposeBigEndian)
+{
+  QCameraMpoSample primary(50000, true, true, 3);
+  QCameraMpoSample aux(70000, true, true, 4);
+  std::vector<uint8_t> out(primary.size() + aux.size(), 0);
+  mm_jpeg_mpo_info_t info;
+
+  fill_mpo_info(info, primary, aux, out);
+  ASSERT_EQ(0, mm_jpeg_mpo_compose(&info));
+  EXPECT_EQ(primary.size() + aux.size(), info.output_buff.buf_filled_len);
+  expect_mpo(out, primary, aux);
+}
+
+TEST(QCameraMpoCompose, ComposeWithPrimaryInOutput)
+{
+  QCameraMpoSample primary(80000, true, false, 5);
+  QCameraMpoSample aux(80000, true, false, 6);
+  std::vector<uint8_t> out(primary.size() + aux.size(), 0);
+  mm_jpeg_mpo_info_t info;
+
+  // the primary image was encoded into the output buffer, only the aux
+  // image is appended
+  memcpy(&out[0], primary.data(), primary.size());
+  fill_mpo_info(info, primary, aux, out);
+  info.output_buff.buf_filled_len = primary.size();
+  ASSERT_EQ(0, mm_jpeg_mpo_compose(&info));
+  EXPECT_EQ(primary.size() + aux.size(), info.output_buff.buf_filled_len);
+  expect_mpo(out, primary, aux);
+}
+
+TEST(QCameraMpoCompose, ComposeFailures)
+{
+  QCameraMpoSample primary(20000, true, false, 7);
+  QCameraMpoSample noApp2(20000, false, false, 8);
+  QCameraMpoSample aux(20000, true, false, 9);
+  std::vector<uint8_t> out(primary.size() + aux.size() - 1, 0);
+  mm_jpeg_mpo_info_t info;
+
+  // output one byte short of both images
+  fill_mpo_info(info, primary, aux, out);
+  EXPECT_NE(0, mm_jpeg_mpo_compose(&info));
+
+  // output too small for the primary image alone
+  out.resize(primary.size());
+  fill_mpo_info(info, primary, aux, out);
+  EXPECT_NE(0, mm_jpeg_mpo_compose(&info));
+
+  // primary image without MP header
+  out.resize(noApp2.size() + aux.size());
+  fill_mpo_info(info, noApp2, aux, out);
+  EXPECT_NE(0, mm_jpeg_mpo_compose(&info));
+}
@@ -0,0 +1,156 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+
+// Camera dependencies
+#include "QCameraMpoSample.h"
+
+namespace qcamera {
+
+// MP Index IFD: MP Format Version, Number of Images and MP Entry
+#define SAMPLE_MP_TAG_COUNT    3
+#define SAMPLE_MP_NUM_IMAGES   2
+
+QCameraMpoSample::QCameraMpoSample(uint32_t scanBytes, bool withApp2,
+    bool bigEndian, uint32_t seed)
+  : mBigEndian(bigEndian), mInMpHeader(false), mApp1(0), mApp2(0),
+    mMpHeader(0), mMpEntry(0), mSos(0)
+{
+  uint32_t ifd, entries;
+
+  put8(0xFF); put8(0xD8);
+
+  mApp1 = size() + 2;
+  putSegment(0xE1, 32, 0x11);
+  memcpy(&mData[mApp1 + 2], "Exif\0\0", 6);
+
+  if (withApp2) {
+    uint32_t mpBytes = MP_FORMAT_IDENTIFIER_BYTES + MP_ENDIAN_BYTES +
+        MP_HEADER_OFFSET_TO_FIRST_IFD_BYTES + MP_INDEX_COUNT_BYTES +
+        SAMPLE_MP_TAG_COUNT * MP_TAG_BYTES +
+        MP_INDEX_OFFSET_OF_NEXT_IFD_BYTES +
+        SAMPLE_MP_NUM_IMAGES * MP_INDEX_ENTRY_VALUE_BYTES;
+
+    put8(0xFF); put8(0xE2);
+    mApp2 = size();
+    put16((uint16_t)(mpBytes + MP_APP2_FIELD_LENGTH_BYTES));
+    put8('M'); put8('P'); put8('F'); put8(0);
+
+    // MP header, all offsets below are relative to the endian field
+    mMpHeader = size();
+    mInMpHeader = true;
+    if (bigEndian) {
+      put8('M'); put8('M'); put8(0x00); put8(0x2A);
+    } else {
+      put8('I'); put8('I'); put8(0x2A); put8(0x00);
+    }
+    put32(MP_ENDIAN_BYTES + MP_HEADER_OFFSET_TO_FIRST_IFD_BYTES);
+
+    ifd = size() - mMpHeader;
+    entries = ifd + MP_INDEX_COUNT_BYTES +
+        SAMPLE_MP_TAG_COUNT * MP_TAG_BYTES +
+        MP_INDEX_OFFSET_OF_NEXT_IFD_BYTES;
+    put16(SAMPLE_MP_TAG_COUNT);
+    put16(0xB000); put16(7); put32(4);
+    put8('0'); put8('1'); put8('0'); put8('0');
+    put16(0xB001); put16(4); put32(1); put32(SAMPLE_MP_NUM_IMAGES);
+    put16(0xB002); put16(7);
+    put32(SAMPLE_MP_NUM_IMAGES * MP_INDEX_ENTRY_VALUE_BYTES);
+    put32(entries);
+    put32(0);
+
+    mMpEntry = size();
+    put32(DEPENDENT_PARENT_IMAGE | REPRESENTATIVE_IMAGE | BASELINE_PRIMARY);
+    put32(0); put32(0); put16(0); put16(0);
+    put32(MULTI_VIEW_DISPARITY);
+    put32(0); put32(0); put16(0); put16(0);
+    mInMpHeader = false;
+  }
+
+  putSegment(0xDB, 65, 0x02);
+
+  mSos = size();
+  put8(0xFF); put8(0xDA);
+  put16(8);
+  put8(1); put8(1); put8(0); put8(0); put8(0x3F); put8(0);
+
+  srand(seed);
+  for (uint32_t i = 0; i < scanBytes; i++) {
+    put8((uint8_t)rand());
+  }
+  put8(0xFF); put8(0xD9);
+}
+
+void QCameraMpoSample::put16(uint16_t v)
+{
+  if (mBigEndian || !mInMpHeader) {
+    // JPEG segments are always big endian
+    put8((uint8_t)(v >> 8)); put8((uint8_t)v);
+  } else {
+    put8((uint8_t)v); put8((uint8_t)(v >> 8));
+  }
+}
+
+void QCameraMpoSample::put32(uint32_t v)
+{
+  if (mBigEndian) {
+    put16((uint16_t)(v >> 16)); put16((uint16_t)v);
+  } else {
+    put16((uint16_t)v); put16((uint16_t)(v >> 16));
+  }
+}
+
+void QCameraMpoSample::putSegment(uint8_t marker, uint32_t payloadBytes,
+    uint8_t fill)
+{
+  uint16_t len = (uint16_t)(payloadBytes + 2);
+
+  put8(0xFF); put8(marker);
+  put8((uint8_t)(len >> 8)); put8((uint8_t)len);
+  mData.insert(mData.end(), payloadBytes, fill);
+}
+
+uint32_t mpo_read_entry(const uint8_t *mpo, const QCameraMpoSample &primary,
+    uint32_t image, uint32_t field)
+{
+  const uint8_t *p = mpo + primary.mpEntryOffset() +
+      image * MP_INDEX_ENTRY_VALUE_BYTES + field;
+
+  if (primary.bigEndian()) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+        ((uint32_t)p[2] << 8) | p[3];
+  }
+  return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+      ((uint32_t)p[1] << 8) | p[0];
+}
+
+}; // namespace qcamera
@@ -0,0 +1,99 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_MPO_SAMPLE_H__
+#define __QCAMERA_MPO_SAMPLE_H__
+
+// System dependencies
+#include <stdint.h>
+#include <vector>
+
+// Camera dependencies
+extern "C" {
+#include "mm_jpeg_mpo.h"
+
+uint8_t *mm_jpeg_mpo_get_app_marker(uint8_t *buffer_addr, int buffer_size,
+  int app_marker);
+}
+
+namespace qcamera {
+
+/* Sample JPEG as the encoder lays it out for MPO: SOI, APP1 (Exif), APP2
+ * (MP header with an MP Index IFD of two zeroed MP entries), DQT, SOS,
+ * scan data and EOI. Only the header segments are well formed, the scan
+ * data is pseudo random. */
+class QCameraMpoSample {
+public:
+  QCameraMpoSample(uint32_t scanBytes, bool withApp2 = true,
+      bool bigEndian = false, uint32_t seed = 1);
+
+  uint8_t *data() { return &mData[0]; }
+  uint32_t size() const { return (uint32_t)mData.size(); }
+
+  // offset of the APPn length field, as mm_jpeg_mpo_get_app_marker
+  // returns it, 0 if the image has no such segment
+  uint32_t app1Offset() const { return mApp1; }
+  uint32_t app2Offset() const { return mApp2; }
+  // offset of the MP Endian field, MP offsets are relative to it
+  uint32_t mpHeaderOffset() const { return mMpHeader; }
+  // offset of the first MP entry value
+  uint32_t mpEntryOffset() const { return mMpEntry; }
+  uint32_t sosOffset() const { return mSos; }
+
+  bool bigEndian() const { return mBigEndian; }
+
+private:
+  void put8(uint8_t v) { mData.push_back(v); }
+  void put16(uint16_t v);
+  void put32(uint32_t v);
+  void putSegment(uint8_t marker, uint32_t payloadBytes, uint8_t fill);
+
+  std::vector<uint8_t> mData;
+  bool mBigEndian;
+  bool mInMpHeader;
+  uint32_t mApp1;
+  uint32_t mApp2;
+  uint32_t mMpHeader;
+  uint32_t mMpEntry;
+  uint32_t mSos;
+};
+
+// MP entry field of an MPO, read with the endianness of its MP header
+uint32_t mpo_read_entry(const uint8_t *mpo, const QCameraMpoSample &primary,
+    uint32_t image, uint32_t field);
+
+enum {
+  MPO_ENTRY_ATTRIBUTE = 0,
+  MPO_ENTRY_SIZE = 4,
+  MPO_ENTRY_OFFSET = 8,
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_MPO_SAMPLE_H__ */
@@ -0,0 +1,329 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Parameter replay shared by the parameter test and benchmark.
+ *
+ * The capability is the blob the virtual sensor serves, caps_<id>.bin in
+ * persist.camera.virtual.dir, captured on a device. property_get() is
+ * replaced so that persist.camera.param.incremental follows the replay
+ * object being constructed; every other property is read as usual. */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/system_properties.h>
+
+// Camera dependencies
+#include "QCameraParametersReplay.h"
+
+#define REPLAY_MAX_INSTANCES 4
+
+namespace qcamera {
+
+// Normally defined by QCamera2Factory.cpp
+volatile uint32_t gKpiDebugLevel = 0;
+
+static bool gReplayIncremental = true;
+static QCameraParamReplay *gReplayInstances[REPLAY_MAX_INSTANCES];
+
+}; // namespace qcamera
+
+using namespace qcamera;
+
+extern "C" int property_get(const char *key, char *value, const char *default_value)
+{
+    int len;
+
+    if (!strcmp(key, "persist.camera.param.incremental")) {
+        return snprintf(value, PROPERTY_VALUE_MAX, "%d", gReplayIncremental ? 1 : 0);
+    }
+    len = __system_property_get(key, value);
+    if ((len <= 0) && (default_value != NULL)) {
+        len = snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+    }
+    return len;
+}
+
+namespace qcamera {
+
+QCameraParamReplay::QCameraParamReplay(cam_capability_t *caps, bool incremental)
+    : mCaps(caps),
+      mIncremental(incremental),
+      mParams(NULL),
+      mCommitted(NULL),
+      mLastCommitCnt(0)
+{
+    memset(&mOps, 0, sizeof(mOps));
+    mOps.map_buf = mapBuf;
+    mOps.map_bufs = mapBufs;
+    mOps.unmap_buf = unmapBuf;
+    mOps.set_parms = setParms;
+    mOps.get_parms = getParms;
+    mVtbl.camera_handle = 0;
+    mVtbl.ops = &mOps;
+    for (uint32_t i = 0; i < REPLAY_MAX_INSTANCES; i++) {
+        if (gReplayInstances[i] == NULL) {
+            gReplayInstances[i] = this;
+            mVtbl.camera_handle = i + 1;
+            break;
+        }
+    }
+}
+
+QCameraParamReplay::~QCameraParamReplay()
+{
+    if (mParams != NULL) {
+        mParams->deinit();
+        delete mParams;
+    }
+    if (mVtbl.camera_handle > 0) {
+        gReplayInstances[mVtbl.camera_handle - 1] = NULL;
+    }
+}
+
+int32_t QCameraParamReplay::init()
+{
+    bool needRestart = false;
+    int32_t rc;
+
+    if (mVtbl.camera_handle == 0) {
+        return NO_MEMORY;
+    }
+    gReplayIncremental = mIncremental;
+    mParams = new QCameraParameters();
+    gReplayIncremental = true;
+
+    rc = mParams->allocate();
+    if (rc == NO_ERROR) {
+        rc = mParams->init(mCaps, &mVtbl, NULL);
+    }
+    if (rc == NO_ERROR) {
+        rc = mParams->commitParameters();
+    }
+    if (rc == NO_ERROR) {
+        rc = apply(getParameters(), needRestart);
+    }
+    return rc;
+}
+
+int32_t QCameraParamReplay::apply(const String8 &params, bool &needRestart)
+{
+    mLastCommitCnt = 0;
+    int32_t rc = mParams->updateParameters(params, needRestart);
+    if (rc == NO_ERROR) {
+        rc = mParams->commitParameters();
+    }
+    return rc;
+}
+
+String8 QCameraParamReplay::getParameters()
+{
+    char *str = mParams->getParameters();
+    String8 params(str != NULL ? str : "");
+    free(str);
+    return params;
+}
+
+int32_t QCameraParamReplay::mapBuf(uint32_t, uint8_t, int, size_t)
+{
+    return NO_ERROR;
+}
+
+int32_t QCameraParamReplay::mapBufs(uint32_t, const cam_buf_map_type_list *)
+{
+    return NO_ERROR;
+}
+
+int32_t QCameraParamReplay::unmapBuf(uint32_t, uint8_t)
+{
+    return NO_ERROR;
+}
+
+int32_t QCameraParamReplay::setParms(uint32_t handle, parm_buffer_t *parms)
+{
+    QCameraParamReplay *replay;
+
+    if ((handle == 0) || (handle > REPLAY_MAX_INSTANCES) ||
+            (gReplayInstances[handle - 1] == NULL)) {
+        return BAD_VALUE;
+    }
+    replay = gReplayInstances[handle - 1];
+    replay->mCommitted = parms;
+    replay->mLastCommitCnt = 0;
+    for (uint32_t i = 0; i < CAM_INTF_PARM_MAX; i++) {
+        if (parms->is_valid[i]) {
+            replay->mLastCommitCnt++;
+        }
+    }
+    return NO_ERROR;
+}
+
+int32_t QCameraParamReplay::getParms(uint32_t, parm_buffer_t *)
+{
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : loadCapability
+ *
+ * DESCRIPTION: read the capability blob of the virtual sensor
+ *
+ * PARAMETERS :
+ *   @cameraId : camera of the blob
+ *
+ * RETURN     : capability, free() it. NULL if there is no usable blob
+ *==========================================================================*/
+cam_capability_t *QCameraParamReplay::loadCapability(int cameraId)
+{
+    char dir[PROPERTY_VALUE_MAX];
+    char path[PROPERTY_VALUE_MAX + 32];
+    cam_capability_t *caps;
+    FILE *f;
+
+    property_get("persist.camera.virtual.dir", dir, "/data/vendor/camera/virtual");
+    snprintf(path, sizeof(path), "%s/caps_%d.bin", dir, cameraId);
+    f = fopen(path, "rb");
+    if (f == NULL) {
+        printf("no capability blob %s\n", path);
+        return NULL;
+    }
+    caps = (cam_capability_t *)calloc(1, sizeof(cam_capability_t));
+    if ((caps != NULL) && (fread(caps, sizeof(cam_capability_t), 1, f) != 1)) {
+        printf("%s is not a cam_capability_t of this build\n", path);
+        free(caps);
+        caps = NULL;
+    }
+    fclose(f);
+    return caps;
+}
+
+/*===========================================================================
+ * FUNCTION   : buildSteps
+ *
+ * DESCRIPTION: setParameters() sequence of a camera app in preview: 3A
+ *              locks, pinch zoom, tap to focus, picture tuning, then the
+ *              parameters set before each capture. A white balance change
+ *              and dropped GPS keys need the full update.
+ *
+ * PARAMETERS :
+ *   @defaults : flattened parameters after init
+ *   @steps    : [output] the sequence
+ *
+ * RETURN     : none
+ *==========================================================================*/
+void QCameraParamReplay::buildSteps(const String8 &defaults,
+        std::vector<param_replay_step_t> &steps)
+{
+    CameraParameters p;
+    char value[32];
+
+    p.unflatten(defaults);
+    steps.clear();
+
+    p.set(CameraParameters::KEY_AUTO_EXPOSURE_LOCK, CameraParameters::TRUE);
+    p.set(CameraParameters::KEY_AUTO_WHITEBALANCE_LOCK, CameraParameters::TRUE);
+    steps.push_back({ "3a lock", p.flatten(), true });
+    p.set(CameraParameters::KEY_AUTO_EXPOSURE_LOCK, CameraParameters::FALSE);
+    p.set(CameraParameters::KEY_AUTO_WHITEBALANCE_LOCK, CameraParameters::FALSE);
+    steps.push_back({ "3a unlock", p.flatten(), true });
+
+    int maxZoom = p.getInt(CameraParameters::KEY_MAX_ZOOM);
+    for (int zoom = 1; zoom <= maxZoom / 2; zoom++) {
+        p.set(CameraParameters::KEY_ZOOM, zoom);
+        steps.push_back({ "zoom", p.flatten(), true });
+    }
+
+    if (p.getInt(CameraParameters::KEY_MAX_NUM_FOCUS_AREAS) > 0) {
+        p.set(CameraParameters::KEY_FOCUS_AREAS, "(-250,-250,250,250,1000)");
+        steps.push_back({ "focus areas", p.flatten(), true });
+    }
+    if (p.getInt(CameraParameters::KEY_MAX_NUM_METERING_AREAS) > 0) {
+        p.set(CameraParameters::KEY_METERING_AREAS, "(-250,-250,250,250,1000)");
+        steps.push_back({ "metering areas", p.flatten(), true });
+    }
+
+    int maxExp = p.getInt(CameraParameters::KEY_MAX_EXPOSURE_COMPENSATION);
+    if (maxExp > 0) {
+        p.set(CameraParameters::KEY_EXPOSURE_COMPENSATION, maxExp / 2);
+        steps.push_back({ "exposure compensation", p.flatten(), true });
+    }
+    static const char *tuning[][3] = {
+        { "luma-adaptation",     "min-brightness", "max-brightness" },
+        { "sharpness",           "min-sharpness",  "max-sharpness" },
+        { "saturation",          "min-saturation", "max-saturation" },
+        { "contrast",            "min-contrast",   "max-contrast" },
+    };
+    for (size_t i = 0; i < sizeof(tuning) / sizeof(tuning[0]); i++) {
+        if ((p.get(tuning[i][1]) != NULL) && (p.get(tuning[i][2]) != NULL)) {
+            p.set(tuning[i][0], (p.getInt(tuning[i][1]) + p.getInt(tuning[i][2])) / 2);
+            steps.push_back({ tuning[i][0], p.flatten(), true });
+        }
+    }
+
+    // Before every capture
+    for (int shot = 0; shot < 4; shot++) {
+        p.set(CameraParameters::KEY_ROTATION, (shot % 4) * 90);
+        p.set(CameraParameters::KEY_JPEG_QUALITY, 85 + shot);
+        p.set(CameraParameters::KEY_JPEG_THUMBNAIL_QUALITY, 75 + shot);
+        p.set(CameraParameters::KEY_GPS_LATITUDE, "37.422");
+        p.set(CameraParameters::KEY_GPS_LONGITUDE, "-122.084");
+        p.set(CameraParameters::KEY_GPS_ALTITUDE, "32.0");
+        snprintf(value, sizeof(value), "%d", 1700000000 + shot);
+        p.set(CameraParameters::KEY_GPS_TIMESTAMP, value);
+        p.set(CameraParameters::KEY_GPS_PROCESSING_METHOD, "GPS");
+        steps.push_back({ "capture", p.flatten(), true });
+    }
+
+    // Second supported white balance, the first one is auto
+    const char *wb = p.get(CameraParameters::KEY_SUPPORTED_WHITE_BALANCE);
+    const char *next = (wb != NULL) ? strchr(wb, ',') : NULL;
+    if (next != NULL) {
+        String8 mode(next + 1);
+        const char *end = strchr(next + 1, ',');
+        if (end != NULL) {
+            mode = String8(next + 1, (size_t)(end - next - 1));
+        }
+        p.set(CameraParameters::KEY_WHITE_BALANCE, mode.string());
+        steps.push_back({ "white balance", p.flatten(), false });
+    }
+
+    p.remove(CameraParameters::KEY_GPS_LATITUDE);
+    p.remove(CameraParameters::KEY_GPS_LONGITUDE);
+    p.remove(CameraParameters::KEY_GPS_ALTITUDE);
+    p.remove(CameraParameters::KEY_GPS_TIMESTAMP);
+    p.remove(CameraParameters::KEY_GPS_PROCESSING_METHOD);
+    steps.push_back({ "gps removed", p.flatten(), false });
+
+    p.set(CameraParameters::KEY_ZOOM, 0);
+    steps.push_back({ "zoom reset", p.flatten(), true });
+}
+
+}; // namespace qcamera
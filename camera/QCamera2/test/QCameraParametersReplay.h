@@ -0,0 +1,91 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_PARAMETERS_REPLAY_H__
+#define __QCAMERA_PARAMETERS_REPLAY_H__
+
+// System dependencies
+#include <utils/String8.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraParameters.h"
+
+namespace qcamera {
+
+/* One setParameters() call of an app, params is the whole flattened string
+ * as the camera service passes it */
+typedef struct {
+    const char *name;
+    String8 params;
+    bool incremental;   // only keys with an incremental handler changed
+} param_replay_step_t;
+
+/* QCameraParameters on a fake backend. Mapping succeeds, every committed
+ * batch is recorded and get_parms returns the buffer untouched. */
+class QCameraParamReplay {
+public:
+    QCameraParamReplay(cam_capability_t *caps, bool incremental);
+    ~QCameraParamReplay();
+
+    // allocate, init and apply the default parameters once in full
+    int32_t init();
+    // updateParameters() and commitParameters() as the HAL does
+    int32_t apply(const String8 &params, bool &needRestart);
+    String8 getParameters();
+
+    // buffer of the last commit, its data section holds the last value
+    // written for every parameter
+    const parm_buffer_t *committed() const { return mCommitted; }
+    // parameters set by the last commit, 0 if nothing was committed
+    uint32_t lastCommitCnt() const { return mLastCommitCnt; }
+
+    static cam_capability_t *loadCapability(int cameraId);
+    static void buildSteps(const String8 &defaults,
+            std::vector<param_replay_step_t> &steps);
+
+private:
+    static int32_t mapBuf(uint32_t, uint8_t, int, size_t);
+    static int32_t mapBufs(uint32_t, const cam_buf_map_type_list *);
+    static int32_t unmapBuf(uint32_t, uint8_t);
+    static int32_t setParms(uint32_t handle, parm_buffer_t *parms);
+    static int32_t getParms(uint32_t, parm_buffer_t *);
+
+    cam_capability_t *mCaps;
+    bool mIncremental;
+    mm_camera_ops_t mOps;
+    mm_camera_vtbl_t mVtbl;
+    QCameraParameters *mParams;
+    const parm_buffer_t *mCommitted;
+    uint32_t mLastCommitCnt;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_PARAMETERS_REPLAY_H__ */
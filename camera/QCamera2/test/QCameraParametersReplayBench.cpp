@@ -0,0 +1,144 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Replay benchmark of QCameraParameters::updateParameters().
+ *
+ * Replays the setParameters() sequence of QCameraParamReplay::buildSteps
+ * (3A locks, pinch zoom, tap to focus, picture tuning, per capture JPEG
+ * and GPS keys, a white balance change) on a fake backend, once with
+ * persist.camera.param.incremental on and once with it off, and prints
+ * the update plus commit time per call, split into the steps that only
+ * change keys with an incremental handler and the ones that do not, and
+ * the parameters committed per call. Needs the capability blob of the
+ * virtual sensor, see QCameraParametersReplay.cpp.
+ *
+ * usage: qcamera_parameters_replay_bench [camera_id] [rounds] */
+
+// System dependencies
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraParametersReplay.h"
+
+using namespace qcamera;
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+static void print_stats(const char *label, std::vector<int64_t> &ns, uint64_t commits)
+{
+    if (ns.empty()) {
+        return;
+    }
+    std::sort(ns.begin(), ns.end());
+    size_t n = ns.size();
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += ns[i];
+    }
+    printf("    %-12s %5zu calls: mean %7.1f p50 %7.1f p99 %7.1f us, %5.1f parameters committed\n",
+            label, n, sum / 1e3 / n, ns[n / 2] / 1e3, ns[n * 99 / 100] / 1e3,
+            (double)commits / n);
+}
+
+static int run(cam_capability_t *caps, bool incremental, uint32_t rounds)
+{
+    QCameraParamReplay replay(caps, incremental);
+    std::vector<param_replay_step_t> steps;
+    std::vector<int64_t> changedNs, otherNs;
+    uint64_t changedCommits = 0, otherCommits = 0;
+    bool needRestart = false;
+
+    if (replay.init() != NO_ERROR) {
+        fprintf(stderr, "parameter init failed\n");
+        return -1;
+    }
+    QCameraParamReplay::buildSteps(replay.getParameters(), steps);
+    changedNs.reserve(steps.size() * rounds);
+    otherNs.reserve(steps.size() * rounds);
+
+    for (uint32_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < steps.size(); i++) {
+            int64_t startNs = now_ns();
+            int32_t rc = replay.apply(steps[i].params, needRestart);
+            int64_t ns = now_ns() - startNs;
+            if (rc != NO_ERROR) {
+                fprintf(stderr, "step %s failed: %d\n", steps[i].name, rc);
+                return -1;
+            }
+            // The first step of a round undoes the white balance change
+            if (steps[i].incremental && ((i > 0) || (r == 0))) {
+                changedNs.push_back(ns);
+                changedCommits += replay.lastCommitCnt();
+            } else {
+                otherNs.push_back(ns);
+                otherCommits += replay.lastCommitCnt();
+            }
+        }
+    }
+
+    printf("incremental update %s:\n", incremental ? "on" : "off");
+    print_stats("incremental", changedNs, changedCommits);
+    print_stats("other keys", otherNs, otherCommits);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int cameraId = (argc > 1) ? atoi(argv[1]) : 0;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 50;
+    cam_capability_t *caps;
+    int rc = 0;
+
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: %s [camera_id] [rounds]\n", argv[0]);
+        return 2;
+    }
+    caps = QCameraParamReplay::loadCapability(cameraId);
+    if (caps == NULL) {
+        fprintf(stderr, "FAIL: no capability of camera %d\n", cameraId);
+        return 1;
+    }
+
+    printf("camera %d, %d rounds\n", cameraId, rounds);
+    if ((run(caps, true, (uint32_t)rounds) != 0) ||
+            (run(caps, false, (uint32_t)rounds) != 0)) {
+        rc = 1;
+    }
+    free(caps);
+    return rc;
+}
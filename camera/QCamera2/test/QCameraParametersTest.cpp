@@ -0,0 +1,133 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Tests of the incremental parameter update of QCameraParameters.
+ *
+ * Two parameter objects on the same capability replay the same app
+ * sequence, one with persist.camera.param.incremental on and one with it
+ * off. After every step the flattened parameters and the last value of
+ * every backend parameter have to match. Needs the capability blob of
+ * the virtual sensor (see QCameraParametersReplay.cpp), without it the
+ * tests pass without checking anything. */
+
+// System dependencies
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Camera dependencies
+#include "QCameraParametersReplay.h"
+
+using namespace qcamera;
+
+class QCameraParametersTest : public ::testing::Test {
+protected:
+    cam_capability_t *mCaps;
+    QCameraParamReplay *mIncremental;
+    QCameraParamReplay *mFull;
+
+    virtual void SetUp() {
+        mIncremental = NULL;
+        mFull = NULL;
+        mCaps = QCameraParamReplay::loadCapability(0);
+        if (mCaps == NULL) {
+            return;
+        }
+        mIncremental = new QCameraParamReplay(mCaps, true);
+        mFull = new QCameraParamReplay(mCaps, false);
+        ASSERT_EQ(NO_ERROR, mIncremental->init());
+        ASSERT_EQ(NO_ERROR, mFull->init());
+        ASSERT_TRUE(mIncremental->committed() != NULL);
+        ASSERT_TRUE(mFull->committed() != NULL);
+    }
+
+    virtual void TearDown() {
+        delete mIncremental;
+        delete mFull;
+        free(mCaps);
+    }
+
+    void expectSameState(const char *step) {
+        SCOPED_TRACE(step);
+        EXPECT_STREQ(mFull->getParameters().string(),
+                mIncremental->getParameters().string());
+        EXPECT_EQ(0, memcmp(&mFull->committed()->data,
+                &mIncremental->committed()->data, sizeof(metadata_data_t)));
+    }
+};
+
+TEST_F(QCameraParametersTest, SameStateAfterInit)
+{
+    if (mCaps == NULL) {
+        return;
+    }
+    expectSameState("init");
+}
+
+TEST_F(QCameraParametersTest, IncrementalMatchesFullUpdate)
+{
+    std::vector<param_replay_step_t> steps;
+
+    if (mCaps == NULL) {
+        return;
+    }
+    QCameraParamReplay::buildSteps(mFull->getParameters(), steps);
+    ASSERT_FALSE(steps.empty());
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        bool restartIncremental = false, restartFull = false;
+        SCOPED_TRACE(steps[i].name);
+
+        ASSERT_EQ(mFull->apply(steps[i].params, restartFull),
+                mIncremental->apply(steps[i].params, restartIncremental));
+        EXPECT_EQ(restartFull, restartIncremental);
+        if (steps[i].incremental) {
+            // only the changed handlers ran
+            EXPECT_LT(mIncremental->lastCommitCnt(), mFull->lastCommitCnt());
+        } else {
+            EXPECT_EQ(mFull->lastCommitCnt(), mIncremental->lastCommitCnt());
+        }
+        expectSameState(steps[i].name);
+    }
+}
+
+TEST_F(QCameraParametersTest, RepeatedUpdateCommitsNothing)
+{
+    bool needRestart = false;
+
+    if (mCaps == NULL) {
+        return;
+    }
+    String8 params = mIncremental->getParameters();
+    ASSERT_EQ(NO_ERROR, mIncremental->apply(params, needRestart));
+    EXPECT_EQ(0u, mIncremental->lastCommitCnt());
+    EXPECT_FALSE(needRestart);
+    ASSERT_EQ(NO_ERROR, mFull->apply(params, needRestart));
+    expectSameState("repeated");
+}
@@ -0,0 +1,320 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Host simulation of QCameraPowerGovernor.
+ *
+ * Preview frames are fed at 25 fps, so one 1000 ms epoch is 25 frames,
+ * together with a simulated process CPU time: clock_gettime() is
+ * replaced for CLOCK_PROCESS_CPUTIME_ID and property_get() returns the
+ * defaults, so the traces give the same decisions on every run. Frames
+ * left out of a trace are deadline misses. */
+
+// System dependencies
+#include <cutils/properties.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraPowerGovernor.h"
+
+using namespace qcamera;
+
+#define SIM_FRAME_NS  40000000LL
+#define SIM_EPOCH     25
+#define SIM_HOLD      5     // persist.camera.pwrgov.hold default
+
+static nsecs_t gSimCpuNs;
+
+extern "C" int clock_gettime(clockid_t clk, struct timespec *ts)
+{
+    if (CLOCK_PROCESS_CPUTIME_ID == clk) {
+        ts->tv_sec = gSimCpuNs / 1000000000LL;
+        ts->tv_nsec = gSimCpuNs % 1000000000LL;
+        return 0;
+    }
+    return (int)syscall(SYS_clock_gettime, clk, ts);
+}
+
+extern "C" int property_get(const char *, char *value, const char *default_value)
+{
+    return snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value ? default_value : "");
+}
+
+class QCameraPowerGovernorTest : public ::testing::Test {
+protected:
+    QCameraPowerGovernor mGov;
+    nsecs_t mTs;
+    uint32_t mSlot;
+    uint32_t mChanges;
+
+    virtual void SetUp() {
+        gSimCpuNs = 0;
+        mTs = 1000000000LL;
+        mSlot = 0;
+        mChanges = 0;
+        mGov.init();
+        ASSERT_TRUE(mGov.isEnabled());
+        mGov.reset();
+        mGov.setFrameInterval(SIM_FRAME_NS);
+        // opens the first epoch
+        frame(0.1f, false);
+    }
+
+    // one frame slot at load cores, missDeadline drops the frame
+    qcamera_power_evt_t frame(float load, bool missDeadline) {
+        qcamera_power_evt_t evt = QCAMERA_PWR_EVT_NONE;
+        mTs += SIM_FRAME_NS;
+        gSimCpuNs += (nsecs_t)(load * (float)SIM_FRAME_NS);
+        mSlot++;
+        if (!missDeadline) {
+            evt = mGov.onFrame(mTs);
+        }
+        if (QCAMERA_PWR_EVT_CHANGED == evt) {
+            mChanges++;
+        }
+        return evt;
+    }
+
+    // one epoch, every missEvery-th frame is dropped. The frame closing
+    // the epoch always arrives.
+    qcamera_power_evt_t epoch(float load, uint32_t missEvery = 0) {
+        qcamera_power_evt_t evt = QCAMERA_PWR_EVT_NONE;
+        for (uint32_t i = 1; i <= SIM_EPOCH; i++) {
+            bool miss = (missEvery > 0) && (i < SIM_EPOCH) && (0 == i % missEvery);
+            evt = frame(load, miss);
+            if (i < SIM_EPOCH) {
+                EXPECT_EQ(QCAMERA_PWR_EVT_NONE, evt);
+            }
+        }
+        EXPECT_NE(QCAMERA_PWR_EVT_NONE, evt);
+        return evt;
+    }
+
+    qcamera_power_step_t step() {
+        return mGov.getDecision().step;
+    }
+};
+
+TEST_F(QCameraPowerGovernorTest, NominalAtModerateLoad)
+{
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(QCAMERA_PWR_EVT_EPOCH, epoch(1.0f));
+    }
+    qcamera_power_decision_t d = mGov.getDecision();
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, d.step);
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_NONE, d.perfLevel);
+    EXPECT_EQ(QCAMERA_THERMAL_NO_ADJUSTMENT, d.fpsLevel);
+    EXPECT_FALSE(d.tnrOff);
+    EXPECT_FALSE(d.wnrOff);
+}
+
+TEST_F(QCameraPowerGovernorTest, ClimbsOneStepPerHotEpoch)
+{
+    epoch(0.5f);
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, step());
+
+    // the rising trend is extrapolated, 2 cores predict well above 150%
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(2.0f));
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_BOOST, step());
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(2.0f));
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_TNR, step());
+    EXPECT_TRUE(mGov.getDecision().tnrOff);
+    EXPECT_FALSE(mGov.getDecision().wnrOff);
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(2.0f));
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_WNR, step());
+    EXPECT_TRUE(mGov.getDecision().wnrOff);
+
+    // fps and frameskip are left to the thermal engine
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(QCAMERA_PWR_EVT_EPOCH, epoch(3.0f));
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_WNR, step());
+    EXPECT_EQ(QCAMERA_THERMAL_NO_ADJUSTMENT, mGov.getDecision().fpsLevel);
+    EXPECT_EQ(3u, mChanges);
+}
+
+TEST_F(QCameraPowerGovernorTest, StepsDownOnlyAfterQuietHold)
+{
+    epoch(0.5f);
+    for (int i = 0; i < 3; i++) {
+        epoch(2.0f);
+    }
+    ASSERT_EQ(QCAMERA_PWR_STEP_NO_WNR, step());
+
+    std::vector<uint32_t> downs;
+    qcamera_power_step_t prev = step();
+    for (uint32_t e = 1; e <= 40; e++) {
+        epoch(0.2f);
+        EXPECT_LE(step(), prev);
+        if (step() < prev) {
+            downs.push_back(e);
+        }
+        prev = step();
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, step());
+    ASSERT_EQ(3u, downs.size());
+    EXPECT_GE(downs[0], (uint32_t)SIM_HOLD);
+    EXPECT_EQ((uint32_t)SIM_HOLD, downs[1] - downs[0]);
+    EXPECT_EQ((uint32_t)SIM_HOLD, downs[2] - downs[1]);
+}
+
+TEST_F(QCameraPowerGovernorTest, ClimbRestartsQuietRun)
+{
+    epoch(0.5f);
+    epoch(2.0f);
+    ASSERT_EQ(QCAMERA_PWR_STEP_NO_BOOST, step());
+    // settle between the marks, then almost a full quiet run
+    for (int i = 0; i < 6; i++) {
+        epoch(1.0f);
+    }
+    for (int i = 0; i < SIM_HOLD - 1; i++) {
+        epoch(0.2f);
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_BOOST, step());
+
+    // misses climb and the quiet run starts over
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(0.2f, 4));
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_TNR, step());
+    for (int i = 0; i < SIM_HOLD - 1; i++) {
+        EXPECT_EQ(QCAMERA_PWR_EVT_EPOCH, epoch(0.2f));
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_TNR, step());
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(0.2f));
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_BOOST, step());
+}
+
+TEST_F(QCameraPowerGovernorTest, ThermalFloor)
+{
+    EXPECT_TRUE(mGov.setThermalLevel(QCAMERA_THERMAL_BIG_ADJUSTMENT));
+    qcamera_power_decision_t d = mGov.getDecision();
+    EXPECT_EQ(QCAMERA_PWR_STEP_BIG, d.step);
+    EXPECT_EQ(QCAMERA_THERMAL_BIG_ADJUSTMENT, d.fpsLevel);
+    EXPECT_TRUE(d.tnrOff);
+    EXPECT_TRUE(d.wnrOff);
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_NONE, d.perfLevel);
+
+    // quiet epochs never go below the floor
+    for (int i = 0; i < 4 * SIM_HOLD; i++) {
+        EXPECT_EQ(QCAMERA_PWR_EVT_EPOCH, epoch(0.2f));
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_BIG, step());
+
+    // a lower level only lowers the floor. The quiet run at the old floor
+    // is longer than the hold, so the next quiet epoch steps down
+    EXPECT_FALSE(mGov.setThermalLevel(QCAMERA_THERMAL_SLIGHT_ADJUSTMENT));
+    EXPECT_EQ(QCAMERA_PWR_STEP_BIG, step());
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(0.2f));
+    EXPECT_EQ(QCAMERA_PWR_STEP_SLIGHT, step());
+    EXPECT_EQ(QCAMERA_THERMAL_SLIGHT_ADJUSTMENT, mGov.getDecision().fpsLevel);
+    for (int i = 0; i < 4 * SIM_HOLD; i++) {
+        epoch(0.2f);
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_SLIGHT, step());
+
+    // a new preview starts at the floor
+    mGov.reset();
+    EXPECT_EQ(QCAMERA_PWR_STEP_SLIGHT, step());
+    EXPECT_TRUE(mGov.setThermalLevel(QCAMERA_THERMAL_MAX_ADJUSTMENT));
+    EXPECT_EQ(QCAMERA_PWR_STEP_MAX, step());
+    EXPECT_EQ(QCAMERA_THERMAL_MAX_ADJUSTMENT, mGov.getDecision().fpsLevel);
+
+    // shutdown is passed on as is
+    EXPECT_TRUE(mGov.setThermalLevel(QCAMERA_THERMAL_SHUTDOWN));
+    EXPECT_EQ(QCAMERA_PWR_STEP_MAX, step());
+    EXPECT_EQ(QCAMERA_THERMAL_SHUTDOWN, mGov.getDecision().fpsLevel);
+}
+
+TEST_F(QCameraPowerGovernorTest, DeadlineMissesBoostAtNominal)
+{
+    // 2 of 25 slots missed, 8%: boost low
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(0.5f, 12));
+    qcamera_power_decision_t d = mGov.getDecision();
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, d.step);
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_LOW, d.perfLevel);
+    EXPECT_FALSE(d.tnrOff);
+
+    // 6 of 25 slots missed, 24%: boost high
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(0.5f, 4));
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, step());
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_HIGH, mGov.getDecision().perfLevel);
+
+    // 1 of 25, 4%: below persist.camera.pwrgov.miss_pct, boost released
+    EXPECT_EQ(QCAMERA_PWR_EVT_CHANGED, epoch(0.5f, 24));
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_NONE, mGov.getDecision().perfLevel);
+}
+
+TEST_F(QCameraPowerGovernorTest, DeadlineMissesClimbWithoutBoost)
+{
+    epoch(0.5f);
+    epoch(2.0f);
+    ASSERT_EQ(QCAMERA_PWR_STEP_NO_BOOST, step());
+
+    // boosting is withheld, misses shed work instead
+    epoch(0.5f, 4);
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_TNR, step());
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_NONE, mGov.getDecision().perfLevel);
+    epoch(0.5f, 4);
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_WNR, step());
+    epoch(0.5f, 4);
+    EXPECT_EQ(QCAMERA_PWR_STEP_NO_WNR, step());
+    EXPECT_EQ(QCAMERA_THERMAL_NO_ADJUSTMENT, mGov.getDecision().fpsLevel);
+}
+
+TEST_F(QCameraPowerGovernorTest, RateChangeIsNoMiss)
+{
+    epoch(0.5f);
+    // a 200 ms gap while the stream is reconfigured to 50 fps
+    mTs += 5 * SIM_FRAME_NS;
+    mGov.setFrameInterval(SIM_FRAME_NS / 2);
+    nsecs_t start = mTs;
+    while (mTs - start < 2 * SIM_EPOCH * SIM_FRAME_NS) {
+        mTs += SIM_FRAME_NS / 2;
+        gSimCpuNs += SIM_FRAME_NS / 4;
+        mGov.onFrame(mTs);
+    }
+    EXPECT_EQ(QCAMERA_PERF_LEVEL_NONE, mGov.getDecision().perfLevel);
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, step());
+}
+
+TEST(QCameraPowerGovernorDisabledTest, NoEpochsWithoutInit)
+{
+    QCameraPowerGovernor gov;
+    nsecs_t ts = 0;
+
+    EXPECT_FALSE(gov.isEnabled());
+    for (int i = 0; i < 100; i++) {
+        ts += SIM_FRAME_NS;
+        EXPECT_EQ(QCAMERA_PWR_EVT_NONE, gov.onFrame(ts));
+    }
+    EXPECT_EQ(QCAMERA_PWR_STEP_NOMINAL, gov.getDecision().step);
+}
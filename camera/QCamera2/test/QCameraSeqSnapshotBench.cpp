@@ -0,0 +1,242 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Contention benchmark of the HAL1 parameter snapshot.
+ *
+ * Reader threads stand in for the data callback threads calling the
+ * snapshot getters of QCameraParametersIntf while one writer commits
+ * parameters under a mutex, as WriteLock does. The same load is run
+ * against a plain mutex protected copy for comparison.
+ *
+ * Every snapshot carries redundant words derived from its version, so a
+ * torn copy is detected; the run fails if any reader sees one.
+ *
+ * usage: qcamera_snapshot_bench [readers] [seconds] [commit_interval_us]
+ *   commit_interval_us 0 commits back to back */
+
+// System dependencies
+#include <atomic>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Camera dependencies
+#include "QCameraSeqSnapshot.h"
+
+using namespace qcamera;
+
+#define BENCH_WORDS 16
+
+typedef struct {
+    uint32_t version;
+    uint32_t words[BENCH_WORDS];
+} bench_snapshot_t;
+
+typedef enum {
+    BENCH_MODE_SEQ,
+    BENCH_MODE_MUTEX,
+} bench_mode_t;
+
+typedef struct {
+    bench_mode_t mode;
+    QCameraSeqSnapshot<bench_snapshot_t> seq;
+    pthread_mutex_t lock;
+    bench_snapshot_t locked;
+    std::atomic<bool> stop;
+    uint32_t commitIntervalUs;
+    uint64_t commits;
+    uint64_t commitNs;
+} bench_ctx_t;
+
+typedef struct {
+    bench_ctx_t *ctx;
+    pthread_t thread;
+    uint64_t reads;
+    uint64_t readNs;
+    uint32_t retries;
+    uint64_t torn;
+} bench_reader_t;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void fill(bench_snapshot_t &s, uint32_t version)
+{
+    s.version = version;
+    for (uint32_t i = 0; i < BENCH_WORDS; i++) {
+        s.words[i] = version * (i + 1);
+    }
+}
+
+static bool consistent(const bench_snapshot_t &s)
+{
+    for (uint32_t i = 0; i < BENCH_WORDS; i++) {
+        if (s.words[i] != s.version * (i + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void commit(bench_ctx_t *ctx, uint32_t version)
+{
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->mode == BENCH_MODE_SEQ) {
+        fill(ctx->seq.beginWrite(), version);
+        ctx->seq.endWrite();
+    } else {
+        fill(ctx->locked, version);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static void *writer_loop(void *arg)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t version = 1;
+
+    while (!ctx->stop.load(std::memory_order_relaxed)) {
+        uint64_t start = now_ns();
+        commit(ctx, ++version);
+        ctx->commitNs += now_ns() - start;
+        ctx->commits++;
+        if (ctx->commitIntervalUs) {
+            usleep(ctx->commitIntervalUs);
+        }
+    }
+    return NULL;
+}
+
+static void *reader_loop(void *arg)
+{
+    bench_reader_t *reader = (bench_reader_t *)arg;
+    bench_ctx_t *ctx = reader->ctx;
+    bench_snapshot_t s = bench_snapshot_t();
+
+    while (!ctx->stop.load(std::memory_order_relaxed)) {
+        uint64_t start = now_ns();
+        // Batch reads so the clock does not dominate
+        for (int i = 0; i < 64; i++) {
+            if (ctx->mode == BENCH_MODE_SEQ) {
+                ctx->seq.read(s, &reader->retries);
+            } else {
+                pthread_mutex_lock(&ctx->lock);
+                s = ctx->locked;
+                pthread_mutex_unlock(&ctx->lock);
+            }
+            if (!consistent(s)) {
+                reader->torn++;
+            }
+        }
+        reader->readNs += now_ns() - start;
+        reader->reads += 64;
+    }
+    return NULL;
+}
+
+static uint64_t run(bench_mode_t mode, uint32_t readers, uint32_t seconds,
+        uint32_t commitIntervalUs)
+{
+    bench_ctx_t *ctx = new bench_ctx_t();
+    bench_reader_t *r = new bench_reader_t[readers]();
+    pthread_t writer;
+    uint64_t reads = 0, readNs = 0, retries = 0, torn = 0;
+
+    ctx->mode = mode;
+    pthread_mutex_init(&ctx->lock, NULL);
+    ctx->stop.store(false);
+    ctx->commitIntervalUs = commitIntervalUs;
+    commit(ctx, 1);
+
+    for (uint32_t i = 0; i < readers; i++) {
+        r[i].ctx = ctx;
+        pthread_create(&r[i].thread, NULL, reader_loop, &r[i]);
+    }
+    pthread_create(&writer, NULL, writer_loop, ctx);
+
+    sleep(seconds);
+    ctx->stop.store(true);
+
+    pthread_join(writer, NULL);
+    for (uint32_t i = 0; i < readers; i++) {
+        pthread_join(r[i].thread, NULL);
+        reads += r[i].reads;
+        readNs += r[i].readNs;
+        retries += r[i].retries;
+        torn += r[i].torn;
+    }
+
+    printf("%-6s readers=%u commit_interval=%uus: "
+            "%.1f ns/read, %.2f Mreads/s total, %" PRIu64 " retries "
+            "(%.3f per 1k reads), %" PRIu64 " commits at %.1f ns/commit, "
+            "%" PRIu64 " torn\n",
+            (mode == BENCH_MODE_SEQ) ? "seq" : "mutex", readers,
+            commitIntervalUs,
+            reads ? (double)readNs / (double)reads : 0.0,
+            (double)reads / (double)seconds / 1e6,
+            retries, reads ? (double)retries * 1000.0 / (double)reads : 0.0,
+            ctx->commits,
+            ctx->commits ? (double)ctx->commitNs / (double)ctx->commits : 0.0,
+            torn);
+
+    pthread_mutex_destroy(&ctx->lock);
+    delete[] r;
+    delete ctx;
+    return torn;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t readers = (argc > 1) ? (uint32_t)atoi(argv[1]) : 4;
+    uint32_t seconds = (argc > 2) ? (uint32_t)atoi(argv[2]) : 2;
+    uint32_t interval = (argc > 3) ? (uint32_t)atoi(argv[3]) : 0;
+    uint64_t torn = 0;
+
+    if ((readers == 0) || (seconds == 0)) {
+        fprintf(stderr, "usage: %s [readers] [seconds] [commit_interval_us]\n",
+                argv[0]);
+        return 2;
+    }
+
+    torn += run(BENCH_MODE_SEQ, readers, seconds, interval);
+    torn += run(BENCH_MODE_MUTEX, readers, seconds, interval);
+
+    if (torn) {
+        fprintf(stderr, "FAIL: %" PRIu64 " torn snapshots\n", torn);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,319 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Camera launch latency of the HAL1 deferred work on QCameraTaskGraph.
+ *
+ * Replays the deferred jobs of openCamera and startPreview with the
+ * dependencies queueDeferredWork declares for them:
+ *   PARAM_ALLOC                      parameter buffer
+ *   METADATA_ALLOC   after PARAM_ALLOC, CAMERA_MIN_METADATA_BUFFERS buffers
+ *   PARAM_INIT       after PARAM_ALLOC, daemon round trips
+ *   stream alloc/map per stream (preview 1080p, ZSL 12MP), the map task
+ *                    waits for the alloc task like QCameraStream does
+ *   PPROC_INIT       after PARAM_INIT, jpeg_open and its work buffers
+ * while the caller does camera_open, add_stream/config_stream and then
+ * waits where the HAL waits. Buffers come from a fake ion allocator: a
+ * fixed ioctl latency, then an mmap whose pages are zeroed as the ion
+ * system heap does. Daemon round trips are sleeps.
+ *
+ * Runs with 1 worker, the single deferred work thread the HAL had before,
+ * and with 2 to QCAMERA_TASK_MAX_WORKERS workers (persist.camera.defwork.
+ * threads, 3 by default), and prints the average time from the start of
+ * openCamera until it returns, until the preview streams are mapped and
+ * until the postprocessor is ready.
+ *
+ * usage: qcamera_task_graph_bench [cycles] [ion_ioctl_us] */
+
+// System dependencies
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils/Errors.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraTaskGraph.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define BENCH_PARM_SIZE         (1200 * 1024)   // parm_buffer_t, padded
+#define BENCH_META_SIZE         (1200 * 1024)   // metadata_buffer_t, padded
+#define BENCH_META_BUFS         10              // CAMERA_MIN_METADATA_BUFFERS
+#define BENCH_JPEG_WORK_SIZE    (4000 * 3000 * 3 / 2)
+#define BENCH_CAMERA_OPEN_US    30000
+#define BENCH_PARAM_INIT_US     8000
+#define BENCH_ADD_STREAM_US     3000            // add_stream + config_stream
+#define BENCH_MAP_BUF_US        250             // map_buf round trip
+#define BENCH_JPEG_OPEN_US      15000
+
+typedef struct {
+    const char *name;
+    size_t size;
+    uint32_t count;
+} bench_stream_t;
+
+static const bench_stream_t gStreams[] = {
+    { "preview", 1920 * 1088 * 3 / 2, 7 },
+    { "zsl",     4000 * 3008 * 3 / 2, 4 },
+};
+#define BENCH_NUM_STREAMS (sizeof(gStreams) / sizeof(gStreams[0]))
+
+static uint32_t gIonIoctlUs = 300;
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + (int64_t)ts.tv_nsec;
+}
+
+/* Fake ion allocation: ioctl latency, then zeroed pages */
+typedef struct {
+    void *ptr;
+    size_t size;
+} fake_ion_buf_t;
+
+static int fake_ion_alloc(std::vector<fake_ion_buf_t> &bufs, size_t size, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        usleep(gIonIoctlUs);
+        void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return NO_MEMORY;
+        }
+        memset(ptr, 0, size);
+        fake_ion_buf_t buf = { ptr, size };
+        bufs.push_back(buf);
+    }
+    return NO_ERROR;
+}
+
+static void fake_ion_free(std::vector<fake_ion_buf_t> &bufs)
+{
+    for (size_t i = 0; i < bufs.size(); i++) {
+        munmap(bufs[i].ptr, bufs[i].size);
+    }
+    bufs.clear();
+}
+
+typedef enum {
+    JOB_PARAM_ALLOC,
+    JOB_METADATA_ALLOC,
+    JOB_PARAM_INIT,
+    JOB_STREAM_ALLOC,
+    JOB_STREAM_MAP,
+    JOB_PPROC_INIT,
+} job_type_t;
+
+typedef struct {
+    job_type_t type;
+    uint32_t stream;
+} job_t;
+
+/* The HWI side: job ids, buffers and the waits of openCamera and
+ * startPreview */
+class LaunchSim {
+public:
+    LaunchSim() : mNextId(1)
+    {
+        memset(mStreamAllocJob, 0, sizeof(mStreamAllocJob));
+        memset(mStreamMapJob, 0, sizeof(mStreamMapJob));
+    }
+
+    int32_t init(uint32_t workers)
+    {
+        return mGraph.init(workers, exec, release, this, "bench");
+    }
+
+    void deinit()
+    {
+        mGraph.deinit();
+        freeBuffers();
+    }
+
+    /* Returns the times in ns since start: open returned, preview
+     * streams mapped, postprocessor ready */
+    void launch(int64_t times[3])
+    {
+        int64_t start = now_ns();
+        uint32_t deps[QCAMERA_TASK_MAX_DEPS];
+
+        // openCamera
+        mParamAllocJob = queue(JOB_PARAM_ALLOC, 0, NULL, 0);
+        deps[0] = mParamAllocJob;
+        mMetadataAllocJob = queue(JOB_METADATA_ALLOC, 0, deps, 1);
+        usleep(BENCH_CAMERA_OPEN_US);
+        mParamInitJob = queue(JOB_PARAM_INIT, 0, deps, 1);
+        times[0] = now_ns() - start;
+
+        // startPreview, preparePreview waits for the metadata and params
+        mGraph.wait(mMetadataAllocJob);
+        mGraph.wait(mParamAllocJob);
+        for (uint32_t s = 0; s < BENCH_NUM_STREAMS; s++) {
+            mStreamAllocJob[s] = queue(JOB_STREAM_ALLOC, s, NULL, 0);
+            usleep(BENCH_ADD_STREAM_US);
+            mStreamMapJob[s] = queue(JOB_STREAM_MAP, s, NULL, 0);
+        }
+        for (uint32_t s = 0; s < BENCH_NUM_STREAMS; s++) {
+            mGraph.wait(mStreamMapJob[s]);
+        }
+        deps[0] = mParamInitJob;
+        mInitPProcJob = queue(JOB_PPROC_INIT, 0, deps, 1);
+        times[1] = now_ns() - start;
+
+        // takePicture waits for the postprocessor
+        mGraph.wait(mInitPProcJob);
+        times[2] = now_ns() - start;
+    }
+
+    /* Buffers of the launch, released out of the timed section */
+    void close()
+    {
+        mGraph.wait(mParamInitJob);
+        freeBuffers();
+    }
+
+private:
+    void freeBuffers()
+    {
+        fake_ion_free(mParm);
+        fake_ion_free(mMeta);
+        fake_ion_free(mJpegWork);
+        for (uint32_t s = 0; s < BENCH_NUM_STREAMS; s++) {
+            fake_ion_free(mStreamBufs[s]);
+        }
+    }
+
+    uint32_t queue(job_type_t type, uint32_t stream, const uint32_t *deps,
+            uint32_t numDeps)
+    {
+        job_t *job = new job_t;
+        job->type = type;
+        job->stream = stream;
+        uint32_t id = mNextId++;
+        if (mGraph.submit(id, job, deps, numDeps) != NO_ERROR) {
+            delete job;
+            return 0;
+        }
+        return id;
+    }
+
+    static int32_t exec(void *task, void *userData)
+    {
+        LaunchSim *sim = (LaunchSim *)userData;
+        job_t *job = (job_t *)task;
+        int32_t rc = NO_ERROR;
+
+        switch (job->type) {
+        case JOB_PARAM_ALLOC:
+            rc = fake_ion_alloc(sim->mParm, BENCH_PARM_SIZE, 1);
+            break;
+        case JOB_METADATA_ALLOC:
+            rc = fake_ion_alloc(sim->mMeta, BENCH_META_SIZE, BENCH_META_BUFS);
+            break;
+        case JOB_PARAM_INIT:
+            usleep(BENCH_PARAM_INIT_US);
+            break;
+        case JOB_STREAM_ALLOC:
+            rc = fake_ion_alloc(sim->mStreamBufs[job->stream],
+                    gStreams[job->stream].size, gStreams[job->stream].count);
+            break;
+        case JOB_STREAM_MAP:
+            // backgroundMap waits for the allocation of its stream
+            sim->mGraph.wait(sim->mStreamAllocJob[job->stream]);
+            usleep(BENCH_MAP_BUF_US * gStreams[job->stream].count);
+            break;
+        case JOB_PPROC_INIT:
+            usleep(BENCH_JPEG_OPEN_US);
+            rc = fake_ion_alloc(sim->mJpegWork, BENCH_JPEG_WORK_SIZE, 1);
+            break;
+        }
+        delete job;
+        return rc;
+    }
+
+    static void release(void *task, void *)
+    {
+        delete (job_t *)task;
+    }
+
+    QCameraTaskGraph mGraph;
+    uint32_t mNextId;
+    uint32_t mParamAllocJob;
+    uint32_t mMetadataAllocJob;
+    uint32_t mParamInitJob;
+    uint32_t mInitPProcJob;
+    uint32_t mStreamAllocJob[BENCH_NUM_STREAMS];
+    uint32_t mStreamMapJob[BENCH_NUM_STREAMS];
+    std::vector<fake_ion_buf_t> mParm;
+    std::vector<fake_ion_buf_t> mMeta;
+    std::vector<fake_ion_buf_t> mJpegWork;
+    std::vector<fake_ion_buf_t> mStreamBufs[BENCH_NUM_STREAMS];
+};
+
+int main(int argc, char *argv[])
+{
+    int cycles = (argc > 1) ? atoi(argv[1]) : 20;
+    int ioctlUs = (argc > 2) ? atoi(argv[2]) : 300;
+
+    if ((cycles <= 0) || (ioctlUs < 0)) {
+        fprintf(stderr, "usage: %s [cycles] [ion_ioctl_us]\n", argv[0]);
+        return 2;
+    }
+    gIonIoctlUs = (uint32_t)ioctlUs;
+
+    printf("%d launches, ion ioctl %d us\n", cycles, ioctlUs);
+    for (uint32_t workers = 1; workers <= QCAMERA_TASK_MAX_WORKERS; workers++) {
+        LaunchSim sim;
+        if (sim.init(workers) != NO_ERROR) {
+            fprintf(stderr, "FAIL: cannot launch %u workers\n", workers);
+            return 1;
+        }
+        int64_t sum[3] = { 0, 0, 0 };
+        for (int c = 0; c <= cycles; c++) {
+            int64_t times[3];
+            sim.launch(times);
+            sim.close();
+            // the first launch warms up
+            for (int i = 0; (c > 0) && (i < 3); i++) {
+                sum[i] += times[i];
+            }
+        }
+        printf("%u worker%s: open %6.1f ms, preview mapped %6.1f ms, "
+                "pproc ready %6.1f ms\n", workers, (workers > 1) ? "s" : " ",
+                sum[0] / 1e6 / cycles, sum[1] / 1e6 / cycles, sum[2] / 1e6 / cycles);
+        sim.deinit();
+    }
+    return 0;
+}
@@ -0,0 +1,367 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Tests of QCameraTaskGraph, the executor of the HAL1 deferred work.
+ *
+ * Tasks log when they start and finish, so every run can be checked to
+ * start a task only after all of its dependencies have finished. Random
+ * graphs are run on the full worker pool, and wait() is checked to return
+ * only once the task and its dependencies are done, and to run a ready
+ * task on the calling thread while the workers are busy. deinit() is
+ * checked to let running tasks complete and to release, without running,
+ * every task that has not started. */
+
+// System dependencies
+#include <atomic>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <utils/Errors.h>
+#include <vector>
+
+// Camera dependencies
+#include "QCameraTaskGraph.h"
+
+using namespace android;
+using namespace qcamera;
+
+#define GRAPH_TEST_TASKS    200
+#define GRAPH_TEST_ROUNDS   20
+
+typedef struct {
+    uint32_t id;
+    uint32_t numDeps;
+    uint32_t deps[QCAMERA_TASK_MAX_DEPS];
+    uint32_t spinUs;
+    int64_t start;          // global sequence numbers
+    int64_t end;
+    pthread_t thread;
+    std::atomic<bool> released;
+} graph_task_t;
+
+class QCameraTaskGraphTest : public ::testing::Test {
+protected:
+    QCameraTaskGraphTest() : mSeq(0), mRuns(0), mReleases(0), mGateOpen(false)
+    {
+        pthread_mutex_init(&mGateLock, NULL);
+        pthread_cond_init(&mGateCond, NULL);
+    }
+
+    ~QCameraTaskGraphTest()
+    {
+        openGate();
+        mGraph.deinit();
+        pthread_cond_destroy(&mGateCond);
+        pthread_mutex_destroy(&mGateLock);
+    }
+
+    static int32_t exec(void *task, void *userData)
+    {
+        QCameraTaskGraphTest *test = (QCameraTaskGraphTest *)userData;
+        graph_task_t *t = (graph_task_t *)task;
+        t->thread = pthread_self();
+        t->start = test->mSeq++;
+        if (t->spinUs == (uint32_t)-1) {
+            test->waitGate();
+        } else if (t->spinUs > 0) {
+            usleep(t->spinUs);
+        }
+        test->mRuns++;
+        t->end = test->mSeq++;
+        return NO_ERROR;
+    }
+
+    static void release(void *task, void *userData)
+    {
+        QCameraTaskGraphTest *test = (QCameraTaskGraphTest *)userData;
+        ((graph_task_t *)task)->released = true;
+        test->mReleases++;
+    }
+
+    void initTasks(std::vector<graph_task_t> &tasks)
+    {
+        for (size_t i = 0; i < tasks.size(); i++) {
+            tasks[i].id = (uint32_t)i + 1;
+            tasks[i].numDeps = 0;
+            tasks[i].spinUs = 0;
+            tasks[i].start = -1;
+            tasks[i].end = -1;
+            tasks[i].released = false;
+        }
+    }
+
+    int32_t submit(graph_task_t &t)
+    {
+        return mGraph.submit(t.id, &t, t.deps, t.numDeps);
+    }
+
+    /* Every dependency that was submitted earlier has finished before the
+     * task started */
+    void checkOrder(std::vector<graph_task_t> &tasks)
+    {
+        for (size_t i = 0; i < tasks.size(); i++) {
+            graph_task_t &t = tasks[i];
+            ASSERT_GE(t.start, 0) << "task " << t.id << " did not run";
+            for (uint32_t d = 0; d < t.numDeps; d++) {
+                graph_task_t &dep = tasks[t.deps[d] - 1];
+                EXPECT_LT(dep.end, t.start) << "task " << t.id << " started before "
+                        << dep.id << " finished";
+            }
+        }
+    }
+
+    void waitGate()
+    {
+        pthread_mutex_lock(&mGateLock);
+        while (!mGateOpen) {
+            pthread_cond_wait(&mGateCond, &mGateLock);
+        }
+        pthread_mutex_unlock(&mGateLock);
+    }
+
+    void openGate()
+    {
+        pthread_mutex_lock(&mGateLock);
+        mGateOpen = true;
+        pthread_cond_broadcast(&mGateCond);
+        pthread_mutex_unlock(&mGateLock);
+    }
+
+    QCameraTaskGraph mGraph;
+    std::atomic<int64_t> mSeq;
+    std::atomic<uint32_t> mRuns;
+    std::atomic<uint32_t> mReleases;
+    pthread_mutex_t mGateLock;
+    pthread_cond_t mGateCond;
+    bool mGateOpen;
+};
+
+TEST_F(QCameraTaskGraphTest, RejectsBadInput)
+{
+    graph_task_t t;
+    t.id = 1;
+    t.numDeps = 0;
+    EXPECT_EQ(NO_INIT, submit(t));
+    EXPECT_EQ(BAD_VALUE, mGraph.init(1, NULL, release, this, "gt"));
+
+    ASSERT_EQ(NO_ERROR, mGraph.init(1, exec, release, this, "gt"));
+    EXPECT_EQ(BAD_VALUE, mGraph.init(1, exec, release, this, "gt"));
+    t.id = 0;
+    EXPECT_EQ(BAD_VALUE, submit(t));
+    t.id = 1;
+    t.numDeps = QCAMERA_TASK_MAX_DEPS + 1;
+    EXPECT_EQ(BAD_VALUE, submit(t));
+    EXPECT_FALSE(mGraph.isPending(1));
+    mGraph.wait(1);
+    mGraph.wait(0);
+}
+
+TEST_F(QCameraTaskGraphTest, ChainRunsInOrder)
+{
+    std::vector<graph_task_t> tasks(16);
+    initTasks(tasks);
+    ASSERT_EQ(NO_ERROR, mGraph.init(QCAMERA_TASK_MAX_WORKERS, exec, release,
+            this, "gt"));
+
+    for (size_t i = 1; i < tasks.size(); i++) {
+        tasks[i].spinUs = 200;
+        tasks[i].deps[tasks[i].numDeps++] = tasks[i - 1].id;
+    }
+    // The first task holds back the chain until all of it is queued, FIFO
+    // order alone would then start the rest on the idle workers
+    tasks[0].spinUs = (uint32_t)-1;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        ASSERT_EQ(NO_ERROR, submit(tasks[i]));
+    }
+    EXPECT_TRUE(mGraph.isPending(tasks.back().id));
+    openGate();
+    mGraph.wait(tasks.back().id);
+    EXPECT_FALSE(mGraph.isPending(tasks.back().id));
+    EXPECT_EQ(tasks.size(), mRuns.load());
+    checkOrder(tasks);
+    for (size_t i = 1; i < tasks.size(); i++) {
+        EXPECT_LT(tasks[i - 1].end, tasks[i].start);
+    }
+}
+
+TEST_F(QCameraTaskGraphTest, RandomGraphsHonourDeps)
+{
+    ASSERT_EQ(NO_ERROR, mGraph.init(QCAMERA_TASK_MAX_WORKERS, exec, release,
+            this, "gt"));
+    srand(39);
+
+    for (uint32_t round = 0; round < GRAPH_TEST_ROUNDS; round++) {
+        std::vector<graph_task_t> tasks(GRAPH_TEST_TASKS);
+        initTasks(tasks);
+        mRuns = 0;
+        for (size_t i = 0; i < tasks.size(); i++) {
+            // ids are reused across rounds, offset them to keep them unique
+            tasks[i].id = round * GRAPH_TEST_TASKS + (uint32_t)i + 1;
+            tasks[i].spinUs = (uint32_t)(rand() % 50);
+            uint32_t numDeps = (i > 0) ? (uint32_t)rand() % (QCAMERA_TASK_MAX_DEPS + 1) : 0;
+            for (uint32_t d = 0; d < numDeps; d++) {
+                tasks[i].deps[tasks[i].numDeps++] =
+                        tasks[(size_t)rand() % i].id;
+            }
+        }
+        for (size_t i = 0; i < tasks.size(); i++) {
+            ASSERT_EQ(NO_ERROR, submit(tasks[i]));
+        }
+        // wait for a random task first, it must find its deps done
+        size_t probe = (size_t)rand() % tasks.size();
+        mGraph.wait(tasks[probe].id);
+        ASSERT_GE(tasks[probe].end, 0);
+        for (uint32_t d = 0; d < tasks[probe].numDeps; d++) {
+            uint32_t dep = tasks[probe].deps[d] - round * GRAPH_TEST_TASKS - 1;
+            EXPECT_GE(tasks[dep].end, 0);
+            EXPECT_LT(tasks[dep].end, tasks[probe].start);
+        }
+        for (size_t i = 0; i < tasks.size(); i++) {
+            mGraph.wait(tasks[i].id);
+        }
+        ASSERT_EQ(tasks.size(), mRuns.load());
+        for (size_t i = 0; i < tasks.size(); i++) {
+            for (uint32_t d = 0; d < tasks[i].numDeps; d++) {
+                uint32_t dep = tasks[i].deps[d] - round * GRAPH_TEST_TASKS - 1;
+                ASSERT_LT(tasks[dep].end, tasks[i].start) << "round " << round;
+            }
+        }
+    }
+    EXPECT_EQ(0U, mReleases.load());
+}
+
+TEST_F(QCameraTaskGraphTest, UnknownAndSelfDepsCountAsFinished)
+{
+    std::vector<graph_task_t> tasks(2);
+    initTasks(tasks);
+    ASSERT_EQ(NO_ERROR, mGraph.init(1, exec, release, this, "gt"));
+
+    tasks[0].deps[tasks[0].numDeps++] = 1000;   // never submitted
+    tasks[0].deps[tasks[0].numDeps++] = 0;
+    tasks[1].deps[tasks[1].numDeps++] = tasks[1].id;
+    ASSERT_EQ(NO_ERROR, submit(tasks[0]));
+    ASSERT_EQ(NO_ERROR, submit(tasks[1]));
+    mGraph.wait(tasks[0].id);
+    mGraph.wait(tasks[1].id);
+    EXPECT_GE(tasks[0].end, 0);
+    EXPECT_GE(tasks[1].end, 0);
+}
+
+TEST_F(QCameraTaskGraphTest, WaitRunsReadyTaskOnCaller)
+{
+    std::vector<graph_task_t> tasks(3);
+    initTasks(tasks);
+    ASSERT_EQ(NO_ERROR, mGraph.init(1, exec, release, this, "gt"));
+
+    // The only worker is stuck in task 1, task 3 needs task 2
+    tasks[0].spinUs = (uint32_t)-1;
+    tasks[2].deps[tasks[2].numDeps++] = tasks[1].id;
+    ASSERT_EQ(NO_ERROR, submit(tasks[0]));
+    while (tasks[0].start < 0) {
+        usleep(100);
+    }
+    ASSERT_EQ(NO_ERROR, submit(tasks[1]));
+    ASSERT_EQ(NO_ERROR, submit(tasks[2]));
+
+    mGraph.wait(tasks[2].id);
+    EXPECT_TRUE(pthread_equal(pthread_self(), tasks[1].thread));
+    EXPECT_TRUE(pthread_equal(pthread_self(), tasks[2].thread));
+    EXPECT_LT(tasks[1].end, tasks[2].start);
+    EXPECT_TRUE(mGraph.isPending(tasks[0].id));
+
+    openGate();
+    mGraph.wait(tasks[0].id);
+    EXPECT_FALSE(pthread_equal(pthread_self(), tasks[0].thread));
+    EXPECT_EQ(3U, mRuns.load());
+}
+
+static void *deinit_thread(void *data)
+{
+    ((QCameraTaskGraph *)data)->deinit();
+    return NULL;
+}
+
+TEST_F(QCameraTaskGraphTest, DeinitReleasesQueuedTasks)
+{
+    std::vector<graph_task_t> tasks(32);
+    initTasks(tasks);
+    ASSERT_EQ(NO_ERROR, mGraph.init(2, exec, release, this, "gt"));
+
+    // Both workers are busy, the rest waits on them or on each other
+    tasks[0].spinUs = (uint32_t)-1;
+    tasks[1].spinUs = (uint32_t)-1;
+    ASSERT_EQ(NO_ERROR, submit(tasks[0]));
+    ASSERT_EQ(NO_ERROR, submit(tasks[1]));
+    while ((tasks[0].start < 0) || (tasks[1].start < 0)) {
+        usleep(100);
+    }
+    for (size_t i = 2; i < tasks.size(); i++) {
+        tasks[i].deps[tasks[i].numDeps++] = tasks[i % 2].id;
+        if (i > 2) {
+            tasks[i].deps[tasks[i].numDeps++] = tasks[i - 1].id;
+        }
+        ASSERT_EQ(NO_ERROR, submit(tasks[i]));
+    }
+
+    // deinit lets the running tasks complete
+    pthread_t th;
+    ASSERT_EQ(0, pthread_create(&th, NULL, deinit_thread, &mGraph));
+    usleep(20000);
+    EXPECT_EQ(0U, mRuns.load());
+    openGate();
+    pthread_join(th, NULL);
+
+    EXPECT_EQ(2U, mRuns.load());
+    EXPECT_EQ(tasks.size() - 2, mReleases.load());
+    for (size_t i = 0; i < tasks.size(); i++) {
+        EXPECT_EQ(i >= 2, tasks[i].released.load()) << "task " << tasks[i].id;
+        EXPECT_EQ(i < 2, tasks[i].end >= 0) << "task " << tasks[i].id;
+        EXPECT_FALSE(mGraph.isPending(tasks[i].id));
+    }
+    EXPECT_EQ(NO_INIT, submit(tasks[0]));
+    mGraph.wait(tasks.back().id);
+
+    // The graph can be brought up again
+    mRuns = 0;
+    ASSERT_EQ(NO_ERROR, mGraph.init(1, exec, release, this, "gt"));
+    tasks[5].numDeps = 0;
+    ASSERT_EQ(NO_ERROR, submit(tasks[5]));
+    mGraph.wait(tasks[5].id);
+    EXPECT_EQ(1U, mRuns.load());
+}
+
+TEST_F(QCameraTaskGraphTest, DeinitWithoutWorkIsClean)
+{
+    ASSERT_EQ(NO_ERROR, mGraph.init(QCAMERA_TASK_MAX_WORKERS + 4, exec, release,
+            this, "gt"));
+    mGraph.deinit();
+    mGraph.deinit();
+    EXPECT_EQ(0U, mReleases.load());
+}
@@ -0,0 +1,140 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Test build of mm_camera_interface.c for the fast-user race test and the
+ * contention benchmark. The camera object calls below replace those of
+ * mm_camera.c in the executable, so camera_open, close_camera and the
+ * lookups of the ops run unchanged on objects without a device. Every
+ * other mm_camera.c call still comes from libmmcamera_interface.
+ *
+ * Closing poisons the object before it is freed, an op still holding it
+ * afterwards is counted as a stale use. */
+
+#include "../stack/mm-camera-interface/src/mm_camera_interface.c"
+
+#include "mm_camera_interface_fake.h"
+
+#define MM_CAMERA_FAKE_CLOSED 0x0dead0
+
+static uint32_t g_fake_op_spin;
+static uint32_t g_fake_stale_uses;
+static pthread_mutex_t g_fake_gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_fake_gate_cond = PTHREAD_COND_INITIALIZER;
+static int32_t g_fake_gate = -1;
+static uint32_t g_fake_gate_waiters;
+
+void mm_camera_fake_init(uint8_t num_cam, uint32_t op_spin)
+{
+    g_cam_ctrl.num_cam = num_cam;
+    g_fake_op_spin = op_spin;
+    __atomic_store_n(&g_fake_stale_uses, 0, __ATOMIC_SEQ_CST);
+}
+
+uint32_t mm_camera_fake_stale_uses(void)
+{
+    return __atomic_load_n(&g_fake_stale_uses, __ATOMIC_SEQ_CST);
+}
+
+void mm_camera_fake_gate(int32_t cam_idx)
+{
+    pthread_mutex_lock(&g_fake_gate_lock);
+    __atomic_store_n(&g_fake_gate, cam_idx, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&g_fake_gate_cond);
+    pthread_mutex_unlock(&g_fake_gate_lock);
+}
+
+uint32_t mm_camera_fake_gate_waiters(void)
+{
+    uint32_t waiters;
+
+    pthread_mutex_lock(&g_fake_gate_lock);
+    waiters = g_fake_gate_waiters;
+    pthread_mutex_unlock(&g_fake_gate_lock);
+    return waiters;
+}
+
+static void mm_camera_fake_check(mm_camera_obj_t *my_obj)
+{
+    if (MM_CAMERA_FAKE_CLOSED == __atomic_load_n(&my_obj->ctrl_fd,
+            __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&g_fake_stale_uses, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/* the work of an op after it dropped cam_lock, with the object held */
+static void mm_camera_fake_work(mm_camera_obj_t *my_obj)
+{
+    volatile uint32_t spin;
+
+    mm_camera_fake_check(my_obj);
+    for (spin = 0; spin < g_fake_op_spin; spin++) {
+    }
+    mm_camera_fake_check(my_obj);
+}
+
+int32_t mm_camera_open(mm_camera_obj_t *my_obj)
+{
+    pthread_mutex_unlock(&my_obj->cam_lock);
+    return 0;
+}
+
+int32_t mm_camera_close(mm_camera_obj_t *my_obj)
+{
+    __atomic_store_n(&my_obj->ctrl_fd, MM_CAMERA_FAKE_CLOSED, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&my_obj->cam_lock);
+    return 0;
+}
+
+int32_t mm_camera_get_queued_buf_count(mm_camera_obj_t *my_obj,
+        uint32_t ch_id __unused, uint32_t stream_id __unused)
+{
+    int32_t cam_idx = (int32_t)mm_camera_util_get_index_by_handler(my_obj->my_hdl);
+
+    pthread_mutex_unlock(&my_obj->cam_lock);
+    /* unlocked check first, the benchmark must not serialize on the gate */
+    if (__atomic_load_n(&g_fake_gate, __ATOMIC_SEQ_CST) == cam_idx) {
+        pthread_mutex_lock(&g_fake_gate_lock);
+        g_fake_gate_waiters++;
+        while (g_fake_gate == cam_idx) {
+            pthread_cond_wait(&g_fake_gate_cond, &g_fake_gate_lock);
+        }
+        g_fake_gate_waiters--;
+        pthread_mutex_unlock(&g_fake_gate_lock);
+    }
+    mm_camera_fake_work(my_obj);
+    return 0;
+}
+
+int32_t mm_camera_get_bundle_info(mm_camera_obj_t *my_obj,
+        uint32_t ch_id __unused, cam_bundle_config_t *bundle_info __unused)
+{
+    pthread_mutex_unlock(&my_obj->cam_lock);
+    mm_camera_fake_work(my_obj);
+    return 0;
+}
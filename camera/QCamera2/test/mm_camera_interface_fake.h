@@ -0,0 +1,61 @@
+/* Copyright (c) 2019, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __MM_CAMERA_INTERFACE_FAKE_H__
+#define __MM_CAMERA_INTERFACE_FAKE_H__
+
+// System dependencies
+#include <stdint.h>
+
+/* mm_camera_interface.c on fake camera objects, see
+ * mm_camera_interface_fake.c. camera_open and the ops table are the real
+ * ones. get_queued_buf_count stands in for the per-frame ops, which skip
+ * g_intf_lock, and get_bundle_info for the ops that take it. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* number of cameras camera_open accepts, and the busy loop iterations
+ * every faked op spends with the camera object held */
+void mm_camera_fake_init(uint8_t num_cam, uint32_t op_spin);
+
+/* per-frame ops that found their camera object already closed */
+uint32_t mm_camera_fake_stale_uses(void);
+
+/* hold get_queued_buf_count of camera cam_idx inside the op, with the
+ * object acquired, until the gate is opened again with -1 */
+void mm_camera_fake_gate(int32_t cam_idx);
+uint32_t mm_camera_fake_gate_waiters(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MM_CAMERA_INTERFACE_FAKE_H__ */
@@ -28,6 +28,7 @@
 */
 
 // System dependencies
+#include <stdlib.h>
 #include <string.h>
 #include <utils/Errors.h>
 #define PRCTL_H <SYSTEM_HEADER_PREFIX/prctl.h>
@@ -54,11 +55,22 @@ namespace qcamera {
  * RETURN     : None
  *==========================================================================*/
 QCameraCmdThread::QCameraCmdThread() :
-    cmd_queue()
+    m_batchHead(0),
+    m_batchCount(0),
+    m_batchPriority(CAMERA_CMD_PRIORITY_NORMAL),
+    m_bCoalesceNextJob(false),
+    m_bNextJobPending(false)
 {
     cmd_pid = 0;
     cam_sem_init(&sync_sem, 0);
     cam_sem_init(&cmd_sem, 0);
+    pthread_mutex_init(&m_lock, NULL);
+    memset(m_ring, 0, sizeof(m_ring));
+    for (int32_t i = 0; i < CAMERA_CMD_PRIORITY_MAX; i++) {
+        m_pending[i] = 0;
+    }
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(m_name, 0, sizeof(m_name));
 }
 
 /*===========================================================================
@@ -75,6 +87,11 @@ QCameraCmdThread::~QCameraCmdThread()
     exit();
     cam_sem_destroy(&sync_sem);
     cam_sem_destroy(&cmd_sem);
+    for (int32_t i = 0; i < CAMERA_CMD_PRIORITY_MAX; i++) {
+        free(m_ring[i].entries);
+        m_ring[i].entries = NULL;
+    }
+    pthread_mutex_destroy(&m_lock);
 }
 
 /*===========================================================================
@@ -117,6 +134,7 @@ int32_t QCameraCmdThread::setName(const char* name)
 {
     /* name the thread */
     prctl(PR_SET_NAME, (unsigned long)name, 0, 0, 0);
+    strlcpy(m_name, name, sizeof(m_name));
     return NO_ERROR;
 }
 
@@ -130,7 +148,8 @@ int32_t QCameraCmdThread::setName(const char* name)
  *   @sync_cmd: flag to indicate if this is a synchorinzed cmd. If true, this call
  *              will wait until signal is set after the command is completed.
  *   @priority: flag to indicate if this is a cmd with priority. If true, the cmd
- *              will be enqueued to the head with priority.
+ *              is served before all normal cmds. EXIT and prioritized
+ *              STOP_DATA_PROC are served before everything else.
  *
  * RETURN     : int32_t type of status
  *              NO_ERROR  -- success
@@ -138,26 +157,40 @@ int32_t QCameraCmdThread::setName(const char* name)
  *==========================================================================*/
 int32_t QCameraCmdThread::sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8_t priority)
 {
-    camera_cmd_t *node = (camera_cmd_t *)malloc(sizeof(camera_cmd_t));
-    if (NULL == node) {
-        LOGE("No memory for camera_cmd_t");
-        return NO_MEMORY;
-    }
-    memset(node, 0, sizeof(camera_cmd_t));
-    node->cmd = cmd;
-
-    if (priority) {
-        if (!cmd_queue.enqueueWithPriority((void *)node)) {
-            free(node);
-            node = NULL;
-        }
+    camera_cmd_t node;
+    int32_t cls = priority ? CAMERA_CMD_PRIORITY_HIGH : CAMERA_CMD_PRIORITY_NORMAL;
+    bool wakeup = true;
+
+    if ((CAMERA_CMD_TYPE_EXIT == cmd) ||
+            (priority && (CAMERA_CMD_TYPE_STOP_DATA_PROC == cmd))) {
+        cls = CAMERA_CMD_PRIORITY_URGENT;
+    }
+    node.cmd = cmd;
+    node.enqueue_ts = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    pthread_mutex_lock(&m_lock);
+    if (m_bCoalesceNextJob && !sync_cmd &&
+            (CAMERA_CMD_TYPE_DO_NEXT_JOB == cmd) && m_bNextJobPending) {
+        /* consumer has not picked up the previous DO_NEXT_JOB yet and will
+         * drain its job queue when it does */
+        m_stats.cmds_coalesced++;
+        wakeup = false;
     } else {
-        if (!cmd_queue.enqueue((void *)node)) {
-            free(node);
-            node = NULL;
+        if (!pushLocked(cls, node)) {
+            pthread_mutex_unlock(&m_lock);
+            LOGE("No memory for camera_cmd_t");
+            return NO_MEMORY;
         }
+        if (CAMERA_CMD_TYPE_DO_NEXT_JOB == cmd) {
+            m_bNextJobPending = true;
+        }
+        m_stats.cmds_queued++;
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    if (wakeup) {
+        cam_sem_post(&cmd_sem);
     }
-    cam_sem_post(&cmd_sem);
 
     /* if is a sync call, need to wait until it returns */
     if (sync_cmd) {
@@ -169,7 +202,10 @@ int32_t QCameraCmdThread::sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8
 /*===========================================================================
  * FUNCTION   : getCmd
  *
- * DESCRIPTION: dequeue a cmommand from cmd queue
+ * DESCRIPTION: dequeue a cmommand from cmd queue. Pending cmds of the highest
+ *              class are moved into a local batch under a single lock, later
+ *              calls are served from the batch unless a higher class cmd
+ *              arrived meanwhile.
  *
  * PARAMETERS : None
  *
@@ -177,16 +213,198 @@ int32_t QCameraCmdThread::sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8
  *==========================================================================*/
 camera_cmd_type_t QCameraCmdThread::getCmd()
 {
-    camera_cmd_type_t cmd = CAMERA_CMD_TYPE_NONE;
-    camera_cmd_t *node = (camera_cmd_t *)cmd_queue.dequeue();
-    if (NULL == node) {
+    camera_cmd_t node;
+
+    if ((m_batchCount > 0) && !higherPending(m_batchPriority)) {
+        node = m_batch[m_batchHead++];
+        m_batchCount--;
+    } else if (!refillBatch(node)) {
         LOGD("No notify avail");
         return CAMERA_CMD_TYPE_NONE;
+    }
+
+    if (CAMERA_CMD_TYPE_DO_NEXT_JOB == node.cmd) {
+        m_bNextJobPending = false;
+    }
+    return node.cmd;
+}
+
+/*===========================================================================
+ * FUNCTION   : getStats
+ *
+ * DESCRIPTION: get queueing statistics of the cmd thread
+ *
+ * PARAMETERS :
+ *   @stats   : output statistics
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraCmdThread::getStats(camera_cmd_thread_stats_t &stats)
+{
+    pthread_mutex_lock(&m_lock);
+    stats = m_stats;
+    pthread_mutex_unlock(&m_lock);
+}
+
+/*===========================================================================
+ * FUNCTION   : pushLocked
+ *
+ * DESCRIPTION: append a cmd to the ring of its class, growing the ring if
+ *              needed. Caller must hold m_lock.
+ *
+ * PARAMETERS :
+ *   @priority: class of the cmd
+ *   @node    : cmd to be queued
+ *
+ * RETURN     : true on success, false if out of memory
+ *==========================================================================*/
+bool QCameraCmdThread::pushLocked(int32_t priority, const camera_cmd_t &node)
+{
+    cmd_ring_t &ring = m_ring[priority];
+
+    if (ring.count == ring.capacity) {
+        uint32_t capacity = (ring.capacity > 0) ? (ring.capacity * 2) : 16;
+        camera_cmd_t *entries =
+                (camera_cmd_t *)malloc(capacity * sizeof(camera_cmd_t));
+        if (NULL == entries) {
+            return false;
+        }
+        for (uint32_t i = 0; i < ring.count; i++) {
+            entries[i] = ring.entries[(ring.head + i) % ring.capacity];
+        }
+        free(ring.entries);
+        ring.entries = entries;
+        ring.head = 0;
+        ring.capacity = capacity;
+    }
+
+    ring.entries[(ring.head + ring.count) % ring.capacity] = node;
+    ring.count++;
+    m_pending[priority].fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : popLocked
+ *
+ * DESCRIPTION: remove the oldest cmd of a class and account its queueing
+ *              delay. Caller must hold m_lock and the ring must not be empty.
+ *
+ * PARAMETERS :
+ *   @priority: class to dequeue from
+ *   @now     : current monotonic time
+ *
+ * RETURN     : dequeued cmd
+ *==========================================================================*/
+camera_cmd_t QCameraCmdThread::popLocked(int32_t priority, nsecs_t now)
+{
+    cmd_ring_t &ring = m_ring[priority];
+    camera_cmd_t node = ring.entries[ring.head];
+    nsecs_t delay = now - node.enqueue_ts;
+
+    ring.head = (ring.head + 1) % ring.capacity;
+    ring.count--;
+    m_pending[priority].fetch_sub(1, std::memory_order_relaxed);
+
+    m_stats.total_delay_ns += delay;
+    if (delay > m_stats.max_delay_ns) {
+        m_stats.max_delay_ns = delay;
+    }
+    return node;
+}
+
+/*===========================================================================
+ * FUNCTION   : highestPendingLocked
+ *
+ * DESCRIPTION: find the highest class with queued cmds. Caller must hold
+ *              m_lock.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : class index, or -1 if all rings are empty
+ *==========================================================================*/
+int32_t QCameraCmdThread::highestPendingLocked()
+{
+    for (int32_t i = CAMERA_CMD_PRIORITY_MAX - 1; i >= 0; i--) {
+        if (m_ring[i].count > 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*===========================================================================
+ * FUNCTION   : higherPending
+ *
+ * DESCRIPTION: lock-free check for queued cmds above a given class
+ *
+ * PARAMETERS :
+ *   @priority: class of the cmds currently being served
+ *
+ * RETURN     : true if a higher class cmd is waiting
+ *==========================================================================*/
+bool QCameraCmdThread::higherPending(int32_t priority)
+{
+    for (int32_t i = priority + 1; i < CAMERA_CMD_PRIORITY_MAX; i++) {
+        if (m_pending[i].load(std::memory_order_acquire) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*===========================================================================
+ * FUNCTION   : refillBatch
+ *
+ * DESCRIPTION: take the next cmd from the shared rings. If the local batch
+ *              is empty, all cmds of the highest pending class (up to
+ *              CAMERA_CMD_BATCH_MAX) are moved into it in one go; otherwise
+ *              a single higher class cmd is taken ahead of the batch.
+ *
+ * PARAMETERS :
+ *   @node    : output cmd
+ *
+ * RETURN     : true if a cmd was dequeued
+ *==========================================================================*/
+bool QCameraCmdThread::refillBatch(camera_cmd_t &node)
+{
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    bool found = true;
+
+    pthread_mutex_lock(&m_lock);
+    int32_t priority = highestPendingLocked();
+    if ((priority < 0) ||
+            ((m_batchCount > 0) && (priority <= m_batchPriority))) {
+        /* nothing queued ahead of the batch */
+        found = false;
+    } else if (m_batchCount > 0) {
+        node = popLocked(priority, now);
     } else {
-        cmd = node->cmd;
-        free(node);
+        uint32_t num = m_ring[priority].count;
+        if (num > CAMERA_CMD_BATCH_MAX) {
+            num = CAMERA_CMD_BATCH_MAX;
+        }
+        for (uint32_t i = 0; i < num; i++) {
+            m_batch[i] = popLocked(priority, now);
+        }
+        m_batchPriority = priority;
+        m_batchHead = 1;
+        m_batchCount = num - 1;
+        node = m_batch[0];
+
+        m_stats.batches++;
+        if (num > m_stats.max_batch) {
+            m_stats.max_batch = num;
+        }
     }
-    return cmd;
+    pthread_mutex_unlock(&m_lock);
+
+    if (!found && (m_batchCount > 0)) {
+        node = m_batch[m_batchHead++];
+        m_batchCount--;
+        found = true;
+    }
+    return found;
 }
 
 /*===========================================================================
@@ -219,6 +437,16 @@ int32_t QCameraCmdThread::exit()
         LOGD("pthread dead already\n");
     }
     cmd_pid = 0;
+
+    camera_cmd_thread_stats_t stats;
+    getStats(stats);
+    LOGH("%s: queued %u coalesced %u batches %u max batch %u "
+            "avg delay %lld us max delay %lld us", m_name,
+            stats.cmds_queued, stats.cmds_coalesced, stats.batches,
+            stats.max_batch,
+            (stats.cmds_queued > 0) ?
+            (long long)(stats.total_delay_ns / stats.cmds_queued / 1000) : 0LL,
+            (long long)(stats.max_delay_ns / 1000));
     return rc;
 }
 
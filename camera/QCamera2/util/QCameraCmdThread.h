@@ -32,6 +32,8 @@
 
 // System dependencies
 #include <pthread.h>
+#include <atomic>
+#include <utils/Timers.h>
 
 // Camera dependencies
 #include "cam_semaphore.h"
@@ -51,10 +53,33 @@ typedef enum
     CAMERA_CMD_TYPE_MAX
 } camera_cmd_type_t;
 
+/* Priority classes, served strictly highest first and FIFO within a class.
+ * sendCmd() callers pass TRUE/FALSE which map to HIGH/NORMAL; EXIT and
+ * prioritized STOP_DATA_PROC are always promoted to URGENT. */
+typedef enum
+{
+    CAMERA_CMD_PRIORITY_NORMAL,
+    CAMERA_CMD_PRIORITY_HIGH,
+    CAMERA_CMD_PRIORITY_URGENT,
+    CAMERA_CMD_PRIORITY_MAX
+} camera_cmd_priority_t;
+
+#define CAMERA_CMD_BATCH_MAX 32
+
 typedef struct {
     camera_cmd_type_t cmd;
+    nsecs_t enqueue_ts;          /* monotonic time the cmd was queued */
 } camera_cmd_t;
 
+typedef struct {
+    uint32_t cmds_queued;        /* cmds accepted by sendCmd */
+    uint32_t cmds_coalesced;     /* DO_NEXT_JOB dropped as already pending */
+    uint32_t batches;            /* queue lock acquisitions by the consumer */
+    uint32_t max_batch;          /* largest number of cmds drained at once */
+    nsecs_t total_delay_ns;      /* summed enqueue-to-dequeue delay */
+    nsecs_t max_delay_ns;        /* worst enqueue-to-dequeue delay */
+} camera_cmd_thread_stats_t;
+
 class QCameraCmdThread {
 public:
     QCameraCmdThread();
@@ -65,11 +90,42 @@ public:
     int32_t exit();
     int32_t sendCmd(camera_cmd_type_t cmd, uint8_t sync_cmd, uint8_t priority);
     camera_cmd_type_t getCmd();
+    void setCoalesceNextJob(bool enable) {m_bCoalesceNextJob = enable;}
+    bool getCoalesceNextJob() const {return m_bCoalesceNextJob;}
+    void getStats(camera_cmd_thread_stats_t &stats);
 
-    QCameraQueue cmd_queue;      /* cmd queue */
     pthread_t cmd_pid;           /* cmd thread ID */
     cam_semaphore_t cmd_sem;               /* semaphore for cmd thread */
     cam_semaphore_t sync_sem;              /* semaphore for synchronized call signal */
+
+private:
+    typedef struct {
+        camera_cmd_t *entries;
+        uint32_t head;
+        uint32_t count;
+        uint32_t capacity;
+    } cmd_ring_t;
+
+    bool pushLocked(int32_t priority, const camera_cmd_t &node);
+    camera_cmd_t popLocked(int32_t priority, nsecs_t now);
+    int32_t highestPendingLocked();
+    bool higherPending(int32_t priority);
+    bool refillBatch(camera_cmd_t &node);
+
+    pthread_mutex_t m_lock;                      /* protects rings and stats */
+    cmd_ring_t m_ring[CAMERA_CMD_PRIORITY_MAX];  /* pending cmds per class */
+    std::atomic<uint32_t> m_pending[CAMERA_CMD_PRIORITY_MAX];
+
+    /* consumer-owned batch, refilled under m_lock once per drain */
+    camera_cmd_t m_batch[CAMERA_CMD_BATCH_MAX];
+    uint32_t m_batchHead;
+    uint32_t m_batchCount;
+    int32_t m_batchPriority;
+
+    bool m_bCoalesceNextJob;                   /* drop redundant DO_NEXT_JOB */
+    std::atomic<bool> m_bNextJobPending;       /* DO_NEXT_JOB not yet consumed */
+    camera_cmd_thread_stats_t m_stats;
+    char m_name[16];
 };
 
 }; // namespace qcamera
@@ -0,0 +1,93 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_DUMP_FORMAT_H__
+#define __QCAMERA_DUMP_FORMAT_H__
+
+// System dependencies
+#include <stdint.h>
+
+/* Layout of the frame dump container written by QCameraFrameDumper and
+ * read by qcamera_dump_extract. Kept free of HAL dependencies so the host
+ * tool can include it.
+ *
+ *   [0, QCAMERA_DUMP_HDR_SIZE)        qcamera_dump_file_hdr_t
+ *   [QCAMERA_DUMP_HDR_SIZE, data_off) max_entries x qcamera_dump_entry_t
+ *   [data_off, file_size)             frame data, appended
+ *
+ * An entry is written after its frame data and num_entries is bumped
+ * last, so a container cut short by a crash still reads back cleanly. */
+
+#define QCAMERA_DUMP_MAGIC        "QCAMDUMP"
+#define QCAMERA_DUMP_VERSION      1
+#define QCAMERA_DUMP_HDR_SIZE     4096
+#define QCAMERA_DUMP_ALIGN        4096
+#define QCAMERA_DUMP_MAX_PLANES   8
+#define QCAMERA_DUMP_TAG_LEN      8
+#define QCAMERA_DUMP_MISC_LEN     16
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t entry_size;    // sizeof(qcamera_dump_entry_t)
+    uint32_t max_entries;
+    uint32_t num_entries;   // committed entries
+    uint64_t data_offset;   // first frame byte
+    uint64_t file_size;     // preallocated size
+} qcamera_dump_file_hdr_t;
+
+/* One plane of a packed frame: meta_len bytes of UBWC meta data followed
+ * by height rows of width bytes, strides removed */
+typedef struct {
+    uint32_t offset;        // from the start of the frame data
+    uint32_t meta_len;
+    int32_t  width;
+    int32_t  height;
+} qcamera_dump_plane_t;
+
+typedef struct {
+    uint32_t seq;           // order of submission
+    uint32_t camera_id;
+    uint32_t dump_type;     // QCAMERA_DUMP_FRM_* bit of the HAL
+    uint32_t stream_type;   // cam_stream_type_t
+    uint32_t format;        // cam_format_t, CAM_FORMAT_MAX if unknown
+    uint32_t frame_idx;
+    int32_t  width;
+    int32_t  height;
+    int64_t  timestamp;     // frame timestamp in ns
+    uint64_t data_offset;   // absolute file offset of the frame data
+    uint64_t data_len;
+    uint32_t num_planes;    // 0 for a linear copy of the whole buffer
+    uint32_t reserved;
+    qcamera_dump_plane_t planes[QCAMERA_DUMP_MAX_PLANES];
+    char     tag[QCAMERA_DUMP_TAG_LEN];    // legacy file name prefix, e.g. "p"
+    char     misc[QCAMERA_DUMP_MISC_LEN];  // caller supplied suffix
+} qcamera_dump_entry_t;
+
+#endif /* __QCAMERA_DUMP_FORMAT_H__ */
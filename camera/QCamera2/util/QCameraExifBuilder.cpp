@@ -0,0 +1,384 @@
+/* Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#define LOG_TAG "QCameraExifBuilder"
+
+// System dependencies
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cutils/properties.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCameraExifBuilder.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+/* ro.* model info tags only change with a new build, resolve them once per
+ * process. The persist.sys.exif overrides can be set at runtime and are read
+ * on every build. */
+typedef struct {
+    char make[PROPERTY_VALUE_MAX];
+    char model[PROPERTY_VALUE_MAX];
+    char software[PROPERTY_VALUE_MAX];
+} qcamera_exif_static_tags_t;
+
+static qcamera_exif_static_tags_t gExifStaticTags;
+static pthread_once_t gExifStaticTagsOnce = PTHREAD_ONCE_INIT;
+
+static void loadExifStaticTags()
+{
+    property_get("ro.product.manufacturer", gExifStaticTags.make, "QCOM-AA");
+    property_get("ro.product.model", gExifStaticTags.model, "QCAM-AA");
+    property_get("ro.build.description", gExifStaticTags.software, "QCAM-AA");
+}
+
+/*===========================================================================
+ * FUNCTION   : QCameraExifBuilder
+ *
+ * DESCRIPTION: constructor of QCameraExifBuilder
+ *
+ * PARAMETERS :
+ *   @maxEntries : max number of entries the owner allows
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraExifBuilder::QCameraExifBuilder(uint32_t maxEntries)
+    : m_nNumEntries(0),
+      m_nMaxEntries(maxEntries),
+      m_nArenaUsed(0),
+      m_nHeapCnt(0)
+{
+    if (m_nMaxEntries > QCAMERA_EXIF_MAX_ENTRIES) {
+        m_nMaxEntries = QCAMERA_EXIF_MAX_ENTRIES;
+    }
+    memset(m_Entries, 0, sizeof(m_Entries));
+    memset(m_HeapData, 0, sizeof(m_HeapData));
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraExifBuilder
+ *
+ * DESCRIPTION: deconstructor of QCameraExifBuilder. Only payloads which
+ *              did not fit into the arena own heap memory.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraExifBuilder::~QCameraExifBuilder()
+{
+    for (uint32_t i = 0; i < m_nHeapCnt; i++) {
+        free(m_HeapData[i]);
+        m_HeapData[i] = NULL;
+    }
+    m_nHeapCnt = 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : allocData
+ *
+ * DESCRIPTION: carve tag payload memory out of the per-capture arena,
+ *              falling back to the heap once the arena is exhausted
+ *
+ * PARAMETERS :
+ *   @size    : number of bytes needed
+ *
+ * RETURN     : ptr to zeroed memory, NULL on failure
+ *==========================================================================*/
+void *QCameraExifBuilder::allocData(size_t size)
+{
+    size_t aligned = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    void *ptr = NULL;
+
+    if (aligned <= sizeof(m_Arena) - m_nArenaUsed) {
+        ptr = (uint8_t *)m_Arena + m_nArenaUsed;
+        m_nArenaUsed += aligned;
+    } else if (m_nHeapCnt < QCAMERA_EXIF_MAX_ENTRIES) {
+        ptr = malloc(size);
+        if (ptr != NULL) {
+            m_HeapData[m_nHeapCnt++] = ptr;
+        }
+    }
+
+    if (ptr != NULL) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/*===========================================================================
+ * FUNCTION   : addEntry
+ *
+ * DESCRIPTION: function to add an entry to exif data
+ *
+ * PARAMETERS :
+ *   @tagid   : exif tag ID
+ *   @type    : data type
+ *   @count   : number of data in uint of its type
+ *   @data    : input data ptr
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraExifBuilder::addEntry(exif_tag_id_t tagid,
+                                     exif_tag_type_t type,
+                                     uint32_t count,
+                                     void *data)
+{
+    int32_t rc = NO_ERROR;
+    if(m_nNumEntries >= m_nMaxEntries) {
+        LOGE("Number of entries exceeded limit");
+        return NO_MEMORY;
+    }
+
+    exif_tag_entry_t *entry = &m_Entries[m_nNumEntries].tag_entry;
+    m_Entries[m_nNumEntries].tag_id = tagid;
+    entry->type = type;
+    entry->count = count;
+    entry->copy = 1;
+    switch (type) {
+    case EXIF_BYTE:
+        {
+            if (count > 1) {
+                uint8_t *values = (uint8_t *)allocData(count);
+                if (values == NULL) {
+                    LOGE("No memory for byte array");
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count);
+                    entry->data._bytes = values;
+                }
+            } else {
+                entry->data._byte = *(uint8_t *)data;
+            }
+        }
+        break;
+    case EXIF_ASCII:
+        {
+            char *str = (char *)allocData(count + 1);
+            if (str == NULL) {
+                LOGE("No memory for ascii string");
+                rc = NO_MEMORY;
+            } else {
+                memcpy(str, data, count);
+                entry->data._ascii = str;
+            }
+        }
+        break;
+    case EXIF_SHORT:
+        {
+            if (count > 1) {
+                uint16_t *values =
+                        (uint16_t *)allocData(count * sizeof(uint16_t));
+                if (values == NULL) {
+                    LOGE("No memory for short array");
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(uint16_t));
+                    entry->data._shorts = values;
+                }
+            } else {
+                entry->data._short = *(uint16_t *)data;
+            }
+        }
+        break;
+    case EXIF_LONG:
+        {
+            if (count > 1) {
+                uint32_t *values =
+                        (uint32_t *)allocData(count * sizeof(uint32_t));
+                if (values == NULL) {
+                    LOGE("No memory for long array");
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(uint32_t));
+                    entry->data._longs = values;
+                }
+            } else {
+                entry->data._long = *(uint32_t *)data;
+            }
+        }
+        break;
+    case EXIF_RATIONAL:
+        {
+            if (count > 1) {
+                rat_t *values = (rat_t *)allocData(count * sizeof(rat_t));
+                if (values == NULL) {
+                    LOGE("No memory for rational array");
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(rat_t));
+                    entry->data._rats = values;
+                }
+            } else {
+                entry->data._rat = *(rat_t *)data;
+            }
+        }
+        break;
+    case EXIF_UNDEFINED:
+        {
+            uint8_t *values = (uint8_t *)allocData(count);
+            if (values == NULL) {
+                LOGE("No memory for undefined array");
+                rc = NO_MEMORY;
+            } else {
+                memcpy(values, data, count);
+                entry->data._undefined = values;
+            }
+        }
+        break;
+    case EXIF_SLONG:
+        {
+            if (count > 1) {
+                int32_t *values =
+                        (int32_t *)allocData(count * sizeof(int32_t));
+                if (values == NULL) {
+                    LOGE("No memory for signed long array");
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(int32_t));
+                    entry->data._slongs = values;
+                }
+            } else {
+                entry->data._slong = *(int32_t *)data;
+            }
+        }
+        break;
+    case EXIF_SRATIONAL:
+        {
+            if (count > 1) {
+                srat_t *values = (srat_t *)allocData(count * sizeof(srat_t));
+                if (values == NULL) {
+                    LOGE("No memory for signed rational array");
+                    rc = NO_MEMORY;
+                } else {
+                    memcpy(values, data, count * sizeof(srat_t));
+                    entry->data._srats = values;
+                }
+            } else {
+                entry->data._srat = *(srat_t *)data;
+            }
+        }
+        break;
+    }
+
+    // Increase number of entries
+    m_nNumEntries++;
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : addStaticAscii
+ *
+ * DESCRIPTION: add an ascii entry that points at process lifetime storage.
+ *              The JPEG encoder copies tag data, so nothing is duplicated.
+ *
+ * PARAMETERS :
+ *   @tagid   : exif tag ID
+ *   @str     : null terminated string with static lifetime
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraExifBuilder::addStaticAscii(exif_tag_id_t tagid, const char *str)
+{
+    if(m_nNumEntries >= m_nMaxEntries) {
+        LOGE("Number of entries exceeded limit");
+        return NO_MEMORY;
+    }
+
+    m_Entries[m_nNumEntries].tag_id = tagid;
+    m_Entries[m_nNumEntries].tag_entry.type = EXIF_ASCII;
+    m_Entries[m_nNumEntries].tag_entry.count = (uint32_t)(strlen(str) + 1);
+    m_Entries[m_nNumEntries].tag_entry.copy = 1;
+    m_Entries[m_nNumEntries].tag_entry.data._ascii = (char *)str;
+    m_nNumEntries++;
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : addModelInfoEntries
+ *
+ * DESCRIPTION: add make, model and software tags from the cached ro.*
+ *              properties, or from persist.sys.exif.make/model when allowed
+ *              and set at the time of the call
+ *
+ * PARAMETERS :
+ *   @allowOverride : honour persist.sys.exif.make/model if set
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraExifBuilder::addModelInfoEntries(bool allowOverride)
+{
+    int32_t rc = NO_ERROR;
+    int32_t ret;
+    char value[PROPERTY_VALUE_MAX];
+    pthread_once(&gExifStaticTagsOnce, loadExifStaticTags);
+
+    // Overrides are copied into the entry, value does not outlive the call
+    if (allowOverride && property_get("persist.sys.exif.make", value, "") > 0) {
+        ret = addEntry(EXIFTAGID_MAKE, EXIF_ASCII,
+                (uint32_t)(strlen(value) + 1), (void *)value);
+    } else {
+        ret = addStaticAscii(EXIFTAGID_MAKE, gExifStaticTags.make);
+    }
+    if (ret != NO_ERROR) {
+        LOGW("getExifMaker failed");
+        rc = NO_MEMORY;
+    }
+    if (allowOverride && property_get("persist.sys.exif.model", value, "") > 0) {
+        ret = addEntry(EXIFTAGID_MODEL, EXIF_ASCII,
+                (uint32_t)(strlen(value) + 1), (void *)value);
+    } else {
+        ret = addStaticAscii(EXIFTAGID_MODEL, gExifStaticTags.model);
+    }
+    if (ret != NO_ERROR) {
+        LOGW("getExifModel failed");
+        rc = NO_MEMORY;
+    }
+    if (addStaticAscii(EXIFTAGID_SOFTWARE, gExifStaticTags.software) != NO_ERROR) {
+        LOGW("getExifSoftware failed");
+        rc = NO_MEMORY;
+    }
+    return rc;
+}
+
+}; // namespace qcamera
@@ -0,0 +1,82 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __QCAMERA_EXIF_BUILDER_H__
+#define __QCAMERA_EXIF_BUILDER_H__
+
+// System dependencies
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "mm_jpeg_interface.h"
+}
+
+namespace qcamera {
+
+// Upper bound of exif entries any HAL postprocessor may add
+#define QCAMERA_EXIF_MAX_ENTRIES 23
+// Backing store for array/string tags of one capture. Tags that do not fit
+// fall back to the heap.
+#define QCAMERA_EXIF_ARENA_SIZE 2048
+
+class QCameraExifBuilder
+{
+public:
+    QCameraExifBuilder(uint32_t maxEntries);
+    virtual ~QCameraExifBuilder();
+
+    int32_t addEntry(exif_tag_id_t tagid,
+                     exif_tag_type_t type,
+                     uint32_t count,
+                     void *data);
+    int32_t addModelInfoEntries(bool allowOverride);
+    uint32_t getNumOfEntries() {return m_nNumEntries;};
+    QEXIF_INFO_DATA *getEntries() {return m_Entries;};
+
+private:
+    void *allocData(size_t size);
+    int32_t addStaticAscii(exif_tag_id_t tagid, const char *str);
+
+    QEXIF_INFO_DATA m_Entries[QCAMERA_EXIF_MAX_ENTRIES];  // exif tags for JPEG encoder
+    uint32_t  m_nNumEntries;                              // number of valid entries
+    uint32_t  m_nMaxEntries;                              // table limit of the owner
+
+    // per-capture bump arena for tag payloads
+    uint64_t  m_Arena[QCAMERA_EXIF_ARENA_SIZE / sizeof(uint64_t)];
+    size_t    m_nArenaUsed;
+    // payloads which overflowed the arena
+    void     *m_HeapData[QCAMERA_EXIF_MAX_ENTRIES];
+    uint32_t  m_nHeapCnt;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_EXIF_BUILDER_H__ */
@@ -0,0 +1,695 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_TAG "QCameraFrameDumper"
+
+// System dependencies
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cutils/properties.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCameraFrameDumper.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+#define QCAMERA_DUMP_MAX_ENTRIES     4096
+#define QCAMERA_DUMP_DEF_BUDGET_MB   "64"   // staging pool
+#define QCAMERA_DUMP_DEF_SIZE_MB     "512"  // container file
+#define QCAMERA_DUMP_STATS_PERIOD    64     // frames between stats logs
+#define QCAMERA_DUMP_ALIGN_UP(x)     (((x) + QCAMERA_DUMP_ALIGN - 1) & \
+                                      ~((uint64_t)QCAMERA_DUMP_ALIGN - 1))
+
+/*===========================================================================
+ * FUNCTION   : pwriteFully
+ *
+ * DESCRIPTION: pwrite that retries on short writes and EINTR
+ *
+ * PARAMETERS :
+ *   @fd     : file descriptor
+ *   @buf    : data to write
+ *   @len    : length of data
+ *   @offset : file offset
+ *
+ * RETURN     : true if all of buf was written
+ *==========================================================================*/
+static bool pwriteFully(int fd, const void *buf, size_t len, off64_t offset)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        ssize_t n = pwrite64(fd, p, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : getInstance
+ *
+ * DESCRIPTION: get process wide dumper. The object is never destroyed so
+ *              frames staged at exit do not race the destructor.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : ptr to the dumper
+ *==========================================================================*/
+QCameraFrameDumper *QCameraFrameDumper::getInstance()
+{
+    static QCameraFrameDumper *sInstance = new QCameraFrameDumper();
+    return sInstance;
+}
+
+/*===========================================================================
+ * FUNCTION   : QCameraFrameDumper
+ *
+ * DESCRIPTION: constructor of QCameraFrameDumper
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraFrameDumper::QCameraFrameDumper()
+    : mPoolBytes(0),
+      mBudget(0),
+      mSeq(0),
+      mWriterRunning(false),
+      mFd(-1),
+      mOpenFailed(false),
+      mFullReported(false),
+      mFileSize(0),
+      mWriteOffset(0),
+      mMaxEntries(0),
+      mNumEntries(0)
+{
+    char prop[PROPERTY_VALUE_MAX];
+    pthread_mutex_init(&mLock, NULL);
+    memset(&mStats, 0, sizeof(mStats));
+    property_get("persist.camera.dumpimg.budget", prop, QCAMERA_DUMP_DEF_BUDGET_MB);
+    mBudget = (size_t)atoi(prop) * 1024 * 1024;
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraFrameDumper
+ *
+ * DESCRIPTION: deconstructor of QCameraFrameDumper
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraFrameDumper::~QCameraFrameDumper()
+{
+    if (mWriterRunning) {
+        mWriterTh.exit();
+    }
+    for (List<dump_job_t *>::iterator it = mFreeJobs.begin();
+            it != mFreeJobs.end(); it++) {
+        free((*it)->data);
+        delete *it;
+    }
+    mFreeJobs.clear();
+    if (mFd >= 0) {
+        close(mFd);
+        mFd = -1;
+    }
+    pthread_mutex_destroy(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : isEnabled
+ *
+ * DESCRIPTION: whether frame dumps go through the recorder. Turned off with
+ *              persist.camera.dumpimg.async=0 to get the legacy file per
+ *              frame dumps.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : true if enabled
+ *==========================================================================*/
+bool QCameraFrameDumper::isEnabled()
+{
+    char prop[PROPERTY_VALUE_MAX];
+    property_get("persist.camera.dumpimg.async", prop, "1");
+    return (atoi(prop) > 0) && (mBudget > 0);
+}
+
+/*===========================================================================
+ * FUNCTION   : launchWriter
+ *
+ * DESCRIPTION: start the writer thread on the first dump
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraFrameDumper::launchWriter()
+{
+    int32_t rc = NO_ERROR;
+    pthread_mutex_lock(&mLock);
+    if (!mWriterRunning) {
+        rc = mWriterTh.launch(writerRoutine, this);
+        if (rc == NO_ERROR) {
+            mWriterRunning = true;
+        } else {
+            LOGE("Failed to launch dump writer thread");
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+    return rc;
+}
+
+/*===========================================================================
+ * FUNCTION   : acquireJob
+ *
+ * DESCRIPTION: get a staging buffer of at least size bytes. Cached buffers
+ *              are reused first; a new one is only allocated while staged
+ *              plus cached bytes stay within budget.
+ *
+ * PARAMETERS :
+ *   @size : bytes needed
+ *
+ * RETURN     : job, NULL if over budget
+ *==========================================================================*/
+QCameraFrameDumper::dump_job_t *QCameraFrameDumper::acquireJob(size_t size)
+{
+    dump_job_t *job = NULL;
+    List<dump_job_t *> evicted;
+
+    pthread_mutex_lock(&mLock);
+    for (List<dump_job_t *>::iterator it = mFreeJobs.begin();
+            it != mFreeJobs.end(); it++) {
+        if ((*it)->capacity >= size) {
+            job = *it;
+            mFreeJobs.erase(it);
+            break;
+        }
+    }
+    if (job == NULL) {
+        // make room by dropping cached buffers that are too small
+        while ((mPoolBytes + size > mBudget) && !mFreeJobs.empty()) {
+            dump_job_t *old = *mFreeJobs.begin();
+            mFreeJobs.erase(mFreeJobs.begin());
+            mPoolBytes -= old->capacity;
+            evicted.push_back(old);
+        }
+        if (mPoolBytes + size > mBudget) {
+            mStats.droppedBudget++;
+            pthread_mutex_unlock(&mLock);
+            size = 0;
+        } else {
+            mPoolBytes += size;
+            pthread_mutex_unlock(&mLock);
+        }
+    } else {
+        pthread_mutex_unlock(&mLock);
+    }
+
+    for (List<dump_job_t *>::iterator it = evicted.begin();
+            it != evicted.end(); it++) {
+        free((*it)->data);
+        delete *it;
+    }
+
+    if ((job == NULL) && (size > 0)) {
+        job = new dump_job_t;
+        job->data = (uint8_t *)malloc(size);
+        job->capacity = size;
+        if (job->data == NULL) {
+            LOGE("Cannot allocate %zu bytes of dump staging", size);
+            delete job;
+            job = NULL;
+            pthread_mutex_lock(&mLock);
+            mPoolBytes -= size;
+            mStats.droppedBudget++;
+            pthread_mutex_unlock(&mLock);
+        }
+    }
+    return job;
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseJob
+ *
+ * DESCRIPTION: return a staging buffer to the pool
+ *
+ * PARAMETERS :
+ *   @job : job to release
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameDumper::releaseJob(dump_job_t *job)
+{
+    pthread_mutex_lock(&mLock);
+    mFreeJobs.push_back(job);
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : fillEntry
+ *
+ * DESCRIPTION: fill the index entry of a staged frame, except for the
+ *              fields set by the writer
+ *
+ * PARAMETERS :
+ *   @job   : staged frame
+ *   @desc  : frame description
+ *   @frame : frame buffer
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameDumper::fillEntry(dump_job_t *job,
+        const qcamera_dump_desc_t &desc, mm_camera_buf_def_t *frame)
+{
+    qcamera_dump_entry_t &entry = job->entry;
+    entry.camera_id = desc.cameraId;
+    entry.dump_type = desc.dumpType;
+    entry.stream_type = (uint32_t)desc.streamType;
+    entry.format = (uint32_t)desc.format;
+    entry.frame_idx = frame->frame_idx;
+    entry.width = desc.dim.width;
+    entry.height = desc.dim.height;
+    entry.timestamp = (int64_t)frame->ts.tv_sec * 1000000000LL + frame->ts.tv_nsec;
+    if (desc.tag != NULL) {
+        strlcpy(entry.tag, desc.tag, sizeof(entry.tag));
+    }
+    if (desc.misc != NULL) {
+        strlcpy(entry.misc, desc.misc, sizeof(entry.misc));
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : submit
+ *
+ * DESCRIPTION: hand a staged frame to the writer thread
+ *
+ * PARAMETERS :
+ *   @job : staged frame
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraFrameDumper::submit(dump_job_t *job)
+{
+    pthread_mutex_lock(&mLock);
+    job->entry.seq = mSeq++;
+    mStats.submitted++;
+    pthread_mutex_unlock(&mLock);
+
+    if (!mJobQ.enqueue(job)) {
+        releaseJob(job);
+        return UNKNOWN_ERROR;
+    }
+    mWriterTh.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB, FALSE, FALSE);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : dumpFrame
+ *
+ * DESCRIPTION: stage a planar frame for dumping. Planes are packed the
+ *              same way the legacy per frame dumps wrote them: meta data,
+ *              then width bytes of every row with the stride removed.
+ *
+ * PARAMETERS :
+ *   @desc   : frame description
+ *   @frame  : frame buffer
+ *   @offset : plane layout of the buffer
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraFrameDumper::dumpFrame(const qcamera_dump_desc_t &desc,
+        mm_camera_buf_def_t *frame, const cam_frame_len_offset_t &offset)
+{
+    if ((frame == NULL) || (frame->buffer == NULL) ||
+            (offset.num_planes > QCAMERA_DUMP_MAX_PLANES)) {
+        return BAD_VALUE;
+    }
+    if (launchWriter() != NO_ERROR) {
+        return UNKNOWN_ERROR;
+    }
+
+    size_t len = 0;
+    for (uint32_t i = 0; i < offset.num_planes; i++) {
+        len += (size_t)offset.mp[i].meta_len +
+                (size_t)offset.mp[i].width * (size_t)offset.mp[i].height;
+    }
+    dump_job_t *job = acquireJob(len);
+    if (job == NULL) {
+        return NO_MEMORY;
+    }
+    memset(&job->entry, 0, sizeof(job->entry));
+    fillEntry(job, desc, frame);
+
+    const uint8_t *src = (const uint8_t *)frame->buffer;
+    size_t bufLen = frame->frame_len;
+    size_t pos = 0;
+    for (uint32_t i = 0; i < offset.num_planes; i++) {
+        const cam_mp_len_offset_t &mp = offset.mp[i];
+        size_t index = mp.offset;
+        if (i > 0) {
+            index += offset.mp[i-1].len;
+        }
+
+        qcamera_dump_plane_t &plane = job->entry.planes[i];
+        plane.offset = (uint32_t)pos;
+        plane.meta_len = 0;
+        plane.width = mp.width;
+        plane.height = 0;
+
+        if ((mp.meta_len != 0) && (index + (size_t)mp.meta_len <= bufLen)) {
+            memcpy(job->data + pos, src + index, (size_t)mp.meta_len);
+            plane.meta_len = (uint32_t)mp.meta_len;
+            pos += (size_t)mp.meta_len;
+            index += (size_t)mp.meta_len;
+        }
+        for (int j = 0; j < mp.height; j++) {
+            if (index + (size_t)mp.width > bufLen) {
+                break;
+            }
+            memcpy(job->data + pos, src + index, (size_t)mp.width);
+            pos += (size_t)mp.width;
+            index += (size_t)mp.stride;
+            plane.height++;
+        }
+    }
+    job->entry.num_planes = offset.num_planes;
+    job->entry.data_len = pos;
+    return submit(job);
+}
+
+/*===========================================================================
+ * FUNCTION   : dumpLinear
+ *
+ * DESCRIPTION: stage the first len bytes of a buffer as is, used for RAW
+ *
+ * PARAMETERS :
+ *   @desc  : frame description
+ *   @frame : frame buffer
+ *   @len   : bytes to dump
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraFrameDumper::dumpLinear(const qcamera_dump_desc_t &desc,
+        mm_camera_buf_def_t *frame, size_t len)
+{
+    if ((frame == NULL) || (frame->buffer == NULL) || (len == 0)) {
+        return BAD_VALUE;
+    }
+    if ((frame->frame_len != 0) && (len > frame->frame_len)) {
+        len = frame->frame_len;
+    }
+    if (launchWriter() != NO_ERROR) {
+        return UNKNOWN_ERROR;
+    }
+
+    dump_job_t *job = acquireJob(len);
+    if (job == NULL) {
+        return NO_MEMORY;
+    }
+    memset(&job->entry, 0, sizeof(job->entry));
+    fillEntry(job, desc, frame);
+    memcpy(job->data, frame->buffer, len);
+    job->entry.num_planes = 0;
+    job->entry.data_len = len;
+    return submit(job);
+}
+
+/*===========================================================================
+ * FUNCTION   : getStats
+ *
+ * DESCRIPTION: get dump counters
+ *
+ * PARAMETERS :
+ *   @stats : output counters
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameDumper::getStats(qcamera_dump_stats_t &stats)
+{
+    pthread_mutex_lock(&mLock);
+    stats = mStats;
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : openContainer
+ *
+ * DESCRIPTION: create and preallocate the container file. Runs on the
+ *              writer thread.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraFrameDumper::openContainer()
+{
+    char prop[PROPERTY_VALUE_MAX];
+    char path[FILENAME_MAX];
+    char timeBuf[32];
+    struct tm timeinfo_data;
+    time_t now = time(NULL);
+
+    memset(timeBuf, 0, sizeof(timeBuf));
+    if (localtime_r(&now, &timeinfo_data) != NULL) {
+        strftime(timeBuf, sizeof(timeBuf), "%Y%m%d%H%M%S", &timeinfo_data);
+    }
+    snprintf(path, sizeof(path), QCAMERA_DUMP_FRM_LOCATION "%s_%d.qcd",
+            timeBuf, getpid());
+
+    property_get("persist.camera.dumpimg.size", prop, QCAMERA_DUMP_DEF_SIZE_MB);
+    mMaxEntries = QCAMERA_DUMP_MAX_ENTRIES;
+    uint64_t dataOffset = QCAMERA_DUMP_ALIGN_UP(QCAMERA_DUMP_HDR_SIZE +
+            (uint64_t)mMaxEntries * sizeof(qcamera_dump_entry_t));
+    mFileSize = (uint64_t)atoi(prop) * 1024 * 1024;
+    if (mFileSize <= dataOffset) {
+        LOGE("Dump container size %s MB too small", prop);
+        mOpenFailed = true;
+        return BAD_VALUE;
+    }
+
+    mFd = open(path, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (mFd < 0) {
+        LOGE("Cannot create dump container %s: %s", path, strerror(errno));
+        mOpenFailed = true;
+        return UNKNOWN_ERROR;
+    }
+    // preallocate so appending frames never has to grow the file
+    int rc = posix_fallocate64(mFd, 0, (off64_t)mFileSize);
+    if (rc != 0) {
+        LOGW("Cannot preallocate %s: %s, continuing unallocated",
+                path, strerror(rc));
+        if (ftruncate64(mFd, (off64_t)mFileSize) != 0) {
+            LOGE("Cannot size dump container: %s", strerror(errno));
+        }
+    }
+
+    qcamera_dump_file_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, QCAMERA_DUMP_MAGIC, sizeof(hdr.magic));
+    hdr.version = QCAMERA_DUMP_VERSION;
+    hdr.entry_size = sizeof(qcamera_dump_entry_t);
+    hdr.max_entries = mMaxEntries;
+    hdr.num_entries = 0;
+    hdr.data_offset = dataOffset;
+    hdr.file_size = mFileSize;
+    if (!pwriteFully(mFd, &hdr, sizeof(hdr), 0)) {
+        LOGE("Cannot write dump container header: %s", strerror(errno));
+        close(mFd);
+        mFd = -1;
+        mOpenFailed = true;
+        return UNKNOWN_ERROR;
+    }
+    mWriteOffset = dataOffset;
+    mNumEntries = 0;
+    LOGH("Dumping frames to %s", path);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : writeJob
+ *
+ * DESCRIPTION: append one staged frame and its index entry to the
+ *              container. Runs on the writer thread.
+ *
+ * PARAMETERS :
+ *   @job : staged frame
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameDumper::writeJob(dump_job_t *job)
+{
+    qcamera_dump_entry_t &entry = job->entry;
+
+    if ((mFd < 0) && (mOpenFailed || (openContainer() != NO_ERROR))) {
+        pthread_mutex_lock(&mLock);
+        mStats.writeErrors++;
+        pthread_mutex_unlock(&mLock);
+        return;
+    }
+
+    if ((mNumEntries >= mMaxEntries) ||
+            (mWriteOffset + entry.data_len > mFileSize)) {
+        pthread_mutex_lock(&mLock);
+        mStats.droppedFull++;
+        pthread_mutex_unlock(&mLock);
+        if (!mFullReported) {
+            LOGE("Dump container full after %u frames, dropping", mNumEntries);
+            mFullReported = true;
+        }
+        return;
+    }
+
+    entry.data_offset = mWriteOffset;
+    bool ok = pwriteFully(mFd, job->data, (size_t)entry.data_len,
+            (off64_t)entry.data_offset);
+    ok = ok && pwriteFully(mFd, &entry, sizeof(entry), (off64_t)(QCAMERA_DUMP_HDR_SIZE +
+            (uint64_t)mNumEntries * sizeof(qcamera_dump_entry_t)));
+    if (ok) {
+        uint32_t numEntries = mNumEntries + 1;
+        ok = pwriteFully(mFd, &numEntries, sizeof(numEntries),
+                (off64_t)offsetof(qcamera_dump_file_hdr_t, num_entries));
+    }
+
+    pthread_mutex_lock(&mLock);
+    if (ok) {
+        mNumEntries++;
+        mWriteOffset = QCAMERA_DUMP_ALIGN_UP(mWriteOffset + entry.data_len);
+        mStats.written++;
+        mStats.bytesWritten += entry.data_len;
+    } else {
+        mStats.writeErrors++;
+    }
+    qcamera_dump_stats_t stats = mStats;
+    pthread_mutex_unlock(&mLock);
+
+    if (!ok) {
+        LOGE("Failed to write frame %u to dump container: %s",
+                entry.frame_idx, strerror(errno));
+    } else if ((stats.written % QCAMERA_DUMP_STATS_PERIOD) == 0) {
+        LOGH("dump stats: submitted %u written %u dropped budget %u full %u"
+                " errors %u bytes %llu", stats.submitted, stats.written,
+                stats.droppedBudget, stats.droppedFull, stats.writeErrors,
+                (unsigned long long)stats.bytesWritten);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : drainJobs
+ *
+ * DESCRIPTION: write out every staged frame
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameDumper::drainJobs()
+{
+    dump_job_t *job = (dump_job_t *)mJobQ.dequeue();
+    while (job != NULL) {
+        writeJob(job);
+        releaseJob(job);
+        job = (dump_job_t *)mJobQ.dequeue();
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : writerRoutine
+ *
+ * DESCRIPTION: writer thread routine
+ *
+ * PARAMETERS :
+ *   @data : user data ptr (QCameraFrameDumper)
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void *QCameraFrameDumper::writerRoutine(void *data)
+{
+    int running = 1;
+    int ret;
+    QCameraFrameDumper *pme = (QCameraFrameDumper *)data;
+    QCameraCmdThread *cmdThread = &pme->mWriterTh;
+    cmdThread->setName("CAM_FrmDump");
+
+    do {
+        do {
+            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            if (ret != 0 && errno != EINVAL) {
+                LOGE("cam_sem_wait error (%s)", strerror(errno));
+                return NULL;
+            }
+        } while (ret != 0);
+
+        camera_cmd_type_t cmd = cmdThread->getCmd();
+        switch (cmd) {
+        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
+            pme->drainJobs();
+            break;
+        case CAMERA_CMD_TYPE_EXIT:
+            pme->drainJobs();
+            running = 0;
+            break;
+        default:
+            break;
+        }
+    } while (running);
+    return NULL;
+}
+
+}; // namespace qcamera
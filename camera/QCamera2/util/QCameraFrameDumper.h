@@ -0,0 +1,127 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_FRAME_DUMPER_H__
+#define __QCAMERA_FRAME_DUMPER_H__
+
+// System dependencies
+#include <pthread.h>
+#include <utils/List.h>
+
+// Camera dependencies
+#include "QCameraCmdThread.h"
+#include "QCameraDumpFormat.h"
+#include "QCameraQueue.h"
+
+extern "C" {
+#include "mm_camera_interface.h"
+}
+
+namespace qcamera {
+
+/* Describes a frame handed to QCameraFrameDumper */
+typedef struct {
+    uint32_t cameraId;
+    uint32_t dumpType;          // QCAMERA_DUMP_FRM_* bit of the HAL
+    cam_stream_type_t streamType;
+    cam_format_t format;        // CAM_FORMAT_MAX if unknown
+    cam_dimension_t dim;
+    const char *tag;            // legacy file name prefix, e.g. "p"
+    const char *misc;           // optional
+} qcamera_dump_desc_t;
+
+typedef struct {
+    uint32_t submitted;         // frames accepted into staging
+    uint32_t written;           // frames committed to the container
+    uint32_t droppedBudget;     // staging pool over budget
+    uint32_t droppedFull;       // container out of entries or space
+    uint32_t writeErrors;
+    uint64_t bytesWritten;
+} qcamera_dump_stats_t;
+
+/* Process wide asynchronous frame dump recorder. The callback thread only
+ * copies the frame into a budget bounded staging pool; a writer thread
+ * appends it to one preallocated, indexed container file. Frames that do
+ * not fit are dropped and counted instead of stalling the caller. */
+class QCameraFrameDumper {
+public:
+    static QCameraFrameDumper *getInstance();
+
+    bool isEnabled();
+    int32_t dumpFrame(const qcamera_dump_desc_t &desc,
+            mm_camera_buf_def_t *frame, const cam_frame_len_offset_t &offset);
+    int32_t dumpLinear(const qcamera_dump_desc_t &desc,
+            mm_camera_buf_def_t *frame, size_t len);
+    void getStats(qcamera_dump_stats_t &stats);
+
+private:
+    typedef struct {
+        qcamera_dump_entry_t entry;
+        uint8_t *data;
+        size_t capacity;
+    } dump_job_t;
+
+    QCameraFrameDumper();
+    ~QCameraFrameDumper();
+
+    int32_t launchWriter();
+    dump_job_t *acquireJob(size_t size);
+    void releaseJob(dump_job_t *job);
+    void fillEntry(dump_job_t *job, const qcamera_dump_desc_t &desc,
+            mm_camera_buf_def_t *frame);
+    int32_t submit(dump_job_t *job);
+    int32_t openContainer();
+    void writeJob(dump_job_t *job);
+    void drainJobs();
+    static void *writerRoutine(void *data);
+
+    pthread_mutex_t mLock;          // staging pool, stats and writer launch
+    android::List<dump_job_t *> mFreeJobs;
+    size_t mPoolBytes;              // staged and cached bytes
+    size_t mBudget;
+    uint32_t mSeq;
+    qcamera_dump_stats_t mStats;
+    bool mWriterRunning;
+
+    QCameraQueue mJobQ;
+    QCameraCmdThread mWriterTh;
+
+    // writer thread only
+    int mFd;
+    bool mOpenFailed;
+    bool mFullReported;
+    uint64_t mFileSize;
+    uint64_t mWriteOffset;
+    uint32_t mMaxEntries;
+    uint32_t mNumEntries;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_FRAME_DUMPER_H__ */
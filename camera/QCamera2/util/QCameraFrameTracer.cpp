@@ -0,0 +1,398 @@
+/* Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*     * Redistributions of source code must retain the above copyright
+*       notice, this list of conditions and the following disclaimer.
+*     * Redistributions in binary form must reproduce the above
+*       copyright notice, this list of conditions and the following
+*       disclaimer in the documentation and/or other materials provided
+*       with the distribution.
+*     * Neither the name of The Linux Foundation nor the names of its
+*       contributors may be used to endorse or promote products derived
+*       from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*/
+
+#define LOG_TAG "QCameraFrameTracer"
+
+// System dependencies
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <cutils/properties.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCameraFrameTracer.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+#define FRAME_TRACE_MAGIC   0x54464351 /* "QCFT" */
+#define FRAME_TRACE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recSize;
+    uint32_t numRecs;
+    uint32_t reserved;
+} qcamera_frame_trace_hdr_t;
+
+static const char *kStageNames[QCAMERA_FRAME_STAGE_MAX] = {
+    "request", "sensor", "metadata", "buffer", "jpeg"
+};
+
+static bool compareRecs(const qcamera_frame_trace_rec_t &a,
+        const qcamera_frame_trace_rec_t &b)
+{
+    if (a.cameraId != b.cameraId) {
+        return a.cameraId < b.cameraId;
+    }
+    if (a.frame != b.frame) {
+        return a.frame < b.frame;
+    }
+    return a.timestamp < b.timestamp;
+}
+
+/*===========================================================================
+ * FUNCTION   : getInstance
+ *
+ * DESCRIPTION: get process wide tracer. The object is never destroyed so
+ *              threads still running at exit can keep recording.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : ptr to the tracer
+ *==========================================================================*/
+QCameraFrameTracer *QCameraFrameTracer::getInstance()
+{
+    static QCameraFrameTracer *sInstance = new QCameraFrameTracer();
+    return sInstance;
+}
+
+/*===========================================================================
+ * FUNCTION   : QCameraFrameTracer
+ *
+ * DESCRIPTION: constructor of QCameraFrameTracer
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraFrameTracer::QCameraFrameTracer()
+    : mEnabled(false),
+      mNumRings(0)
+{
+    char prop[PROPERTY_VALUE_MAX];
+    memset(mRings, 0, sizeof(mRings));
+    pthread_mutex_init(&mRegLock, NULL);
+    if (pthread_key_create(&mRingKey, releaseThreadRing) == 0) {
+        property_get("persist.camera.frame.trace", prop, "1");
+        mEnabled = (atoi(prop) > 0);
+    } else {
+        LOGE("Cannot create tls key, frame tracing disabled");
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraFrameTracer
+ *
+ * DESCRIPTION: deconstructor of QCameraFrameTracer
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraFrameTracer::~QCameraFrameTracer()
+{
+    mEnabled = false;
+    for (uint32_t i = 0; i < QCAMERA_FRAME_TRACE_MAX_RINGS; i++) {
+        delete mRings[i];
+        mRings[i] = NULL;
+    }
+    pthread_mutex_destroy(&mRegLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : releaseThreadRing
+ *
+ * DESCRIPTION: tls destructor, hands the ring of an exiting thread back for
+ *              reuse. Its records stay visible until overwritten.
+ *
+ * PARAMETERS :
+ *   @ring    : ring owned by the exiting thread
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameTracer::releaseThreadRing(void *ring)
+{
+    if (ring != NULL) {
+        ((ring_t *)ring)->inUse.store(false, std::memory_order_release);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : getThreadRing
+ *
+ * DESCRIPTION: get the ring of the calling thread, registering one on the
+ *              first record from this thread
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : ptr to the ring, NULL if all rings are taken
+ *==========================================================================*/
+QCameraFrameTracer::ring_t *QCameraFrameTracer::getThreadRing()
+{
+    ring_t *ring = (ring_t *)pthread_getspecific(mRingKey);
+    if (ring != NULL) {
+        return ring;
+    }
+
+    pthread_mutex_lock(&mRegLock);
+    uint32_t numRings = mNumRings.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < numRings; i++) {
+        if (!mRings[i]->inUse.load(std::memory_order_acquire)) {
+            ring = mRings[i];
+            break;
+        }
+    }
+    if ((ring == NULL) && (numRings < QCAMERA_FRAME_TRACE_MAX_RINGS)) {
+        ring = new ring_t;
+        ring->head.store(0, std::memory_order_relaxed);
+        memset(ring->recs, 0, sizeof(ring->recs));
+        mRings[numRings] = ring;
+        mNumRings.store(numRings + 1, std::memory_order_release);
+    }
+    if (ring != NULL) {
+        ring->inUse.store(true, std::memory_order_relaxed);
+        pthread_setspecific(mRingKey, ring);
+    }
+    pthread_mutex_unlock(&mRegLock);
+    return ring;
+}
+
+/*===========================================================================
+ * FUNCTION   : record
+ *
+ * DESCRIPTION: record a pipeline stage of a frame
+ *
+ * PARAMETERS :
+ *   @cameraId  : camera id
+ *   @frame     : frame number
+ *   @stage     : pipeline stage
+ *   @timestamp : CLOCK_MONOTONIC timestamp of the event in ns
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameTracer::record(uint32_t cameraId, uint32_t frame,
+        qcamera_frame_stage_t stage, int64_t timestamp)
+{
+    if (!mEnabled) {
+        return;
+    }
+    ring_t *ring = getThreadRing();
+    if (ring == NULL) {
+        return;
+    }
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    qcamera_frame_trace_rec_t &rec =
+            ring->recs[head & (QCAMERA_FRAME_TRACE_RING_SIZE - 1)];
+    rec.timestamp = timestamp;
+    rec.frame = frame;
+    rec.stage = (uint16_t)stage;
+    rec.cameraId = (uint16_t)cameraId;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+/*===========================================================================
+ * FUNCTION   : snapshot
+ *
+ * DESCRIPTION: copy out the records of all rings. Records overwritten by
+ *              their writer while being copied are dropped.
+ *
+ * PARAMETERS :
+ *   @out     : output array
+ *   @maxRecs : capacity of output array
+ *
+ * RETURN     : number of records copied
+ *==========================================================================*/
+uint32_t QCameraFrameTracer::snapshot(qcamera_frame_trace_rec_t *out,
+        uint32_t maxRecs)
+{
+    uint32_t cnt = 0;
+    uint32_t numRings = mNumRings.load(std::memory_order_acquire);
+
+    for (uint32_t i = 0; i < numRings; i++) {
+        ring_t *ring = mRings[i];
+        uint32_t end = ring->head.load(std::memory_order_acquire);
+        uint32_t start = (end > QCAMERA_FRAME_TRACE_RING_SIZE) ?
+                (end - QCAMERA_FRAME_TRACE_RING_SIZE) : 0;
+        uint32_t first = cnt;
+        for (uint32_t pos = start; (pos != end) && (cnt < maxRecs); pos++) {
+            out[cnt++] = ring->recs[pos & (QCAMERA_FRAME_TRACE_RING_SIZE - 1)];
+        }
+
+        // drop what the writer lapped while we were copying
+        uint32_t newEnd = ring->head.load(std::memory_order_acquire);
+        if (newEnd > start + QCAMERA_FRAME_TRACE_RING_SIZE) {
+            uint32_t copied = cnt - first;
+            uint32_t drop = std::min(
+                    newEnd - start - QCAMERA_FRAME_TRACE_RING_SIZE, copied);
+            memmove(&out[first], &out[first + drop],
+                    (copied - drop) * sizeof(qcamera_frame_trace_rec_t));
+            cnt -= drop;
+        }
+    }
+    return cnt;
+}
+
+/*===========================================================================
+ * FUNCTION   : dump
+ *
+ * DESCRIPTION: print per stage latency histograms, measured from the
+ *              request of the same frame
+ *
+ * PARAMETERS :
+ *   @fd       : file descriptor to print to
+ *   @cameraId : camera id to report
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraFrameTracer::dump(int fd, uint32_t cameraId)
+{
+    uint32_t maxRecs = QCAMERA_FRAME_TRACE_RING_SIZE * QCAMERA_FRAME_TRACE_MAX_RINGS;
+    qcamera_frame_trace_rec_t *recs = (qcamera_frame_trace_rec_t *)
+            malloc(maxRecs * sizeof(qcamera_frame_trace_rec_t));
+    if (recs == NULL) {
+        LOGE("No memory for frame trace snapshot");
+        return;
+    }
+
+    uint32_t cnt = snapshot(recs, maxRecs);
+    std::sort(recs, recs + cnt, compareRecs);
+
+    uint32_t hist[QCAMERA_FRAME_STAGE_MAX][QCAMERA_FRAME_TRACE_BUCKETS];
+    uint64_t sumUs[QCAMERA_FRAME_STAGE_MAX];
+    uint64_t maxUs[QCAMERA_FRAME_STAGE_MAX];
+    uint32_t num[QCAMERA_FRAME_STAGE_MAX];
+    memset(hist, 0, sizeof(hist));
+    memset(sumUs, 0, sizeof(sumUs));
+    memset(maxUs, 0, sizeof(maxUs));
+    memset(num, 0, sizeof(num));
+
+    uint32_t i = 0;
+    while (i < cnt) {
+        uint32_t j = i;
+        int64_t reqTs = -1;
+        while ((j < cnt) && (recs[j].cameraId == recs[i].cameraId) &&
+                (recs[j].frame == recs[i].frame)) {
+            if ((reqTs < 0) && (recs[j].stage == QCAMERA_FRAME_STAGE_REQUEST)) {
+                reqTs = recs[j].timestamp;
+            }
+            j++;
+        }
+        if ((recs[i].cameraId == cameraId) && (reqTs >= 0)) {
+            for (uint32_t k = i; k < j; k++) {
+                uint16_t stage = recs[k].stage;
+                if ((stage == QCAMERA_FRAME_STAGE_REQUEST) ||
+                        (stage >= QCAMERA_FRAME_STAGE_MAX)) {
+                    continue;
+                }
+                int64_t delta = recs[k].timestamp - reqTs;
+                uint64_t us = (delta > 0) ? (uint64_t)(delta / 1000) : 0;
+                uint32_t bucket = (us == 0) ? 0 : (64 - __builtin_clzll(us));
+                if (bucket >= QCAMERA_FRAME_TRACE_BUCKETS) {
+                    bucket = QCAMERA_FRAME_TRACE_BUCKETS - 1;
+                }
+                hist[stage][bucket]++;
+                sumUs[stage] += us;
+                maxUs[stage] = std::max(maxUs[stage], us);
+                num[stage]++;
+            }
+        }
+        i = j;
+    }
+
+    dprintf(fd, "\nPer frame latency from request (us), %u records\n", cnt);
+    for (uint32_t stage = 0; stage < QCAMERA_FRAME_STAGE_MAX; stage++) {
+        if (num[stage] == 0) {
+            continue;
+        }
+        dprintf(fd, " %-8s: count %u avg %llu max %llu\n", kStageNames[stage],
+                num[stage], (unsigned long long)(sumUs[stage] / num[stage]),
+                (unsigned long long)maxUs[stage]);
+        for (uint32_t b = 0; b < QCAMERA_FRAME_TRACE_BUCKETS; b++) {
+            if (hist[stage][b] != 0) {
+                dprintf(fd, "   < %8llu : %u\n", 1ULL << b, hist[stage][b]);
+            }
+        }
+    }
+    free(recs);
+}
+
+/*===========================================================================
+ * FUNCTION   : exportBinary
+ *
+ * DESCRIPTION: write a snapshot of all records for offline analysis.
+ *              Layout is qcamera_frame_trace_hdr_t followed by numRecs
+ *              qcamera_frame_trace_rec_t in host byte order.
+ *
+ * PARAMETERS :
+ *   @fd      : file descriptor to write to
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraFrameTracer::exportBinary(int fd)
+{
+    uint32_t maxRecs = QCAMERA_FRAME_TRACE_RING_SIZE * QCAMERA_FRAME_TRACE_MAX_RINGS;
+    qcamera_frame_trace_rec_t *recs = (qcamera_frame_trace_rec_t *)
+            malloc(maxRecs * sizeof(qcamera_frame_trace_rec_t));
+    if (recs == NULL) {
+        LOGE("No memory for frame trace snapshot");
+        return NO_MEMORY;
+    }
+
+    qcamera_frame_trace_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = FRAME_TRACE_MAGIC;
+    hdr.version = FRAME_TRACE_VERSION;
+    hdr.recSize = sizeof(qcamera_frame_trace_rec_t);
+    hdr.numRecs = snapshot(recs, maxRecs);
+
+    int32_t rc = NO_ERROR;
+    size_t len = hdr.numRecs * sizeof(qcamera_frame_trace_rec_t);
+    if ((write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) ||
+            (write(fd, recs, len) != (ssize_t)len)) {
+        LOGE("Failed to write frame trace");
+        rc = UNKNOWN_ERROR;
+    }
+    free(recs);
+    return rc;
+}
+
+}; // namespace qcamera
@@ -0,0 +1,106 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#ifndef __QCAMERA_FRAME_TRACER_H__
+#define __QCAMERA_FRAME_TRACER_H__
+
+// System dependencies
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <utils/Timers.h>
+
+namespace qcamera {
+
+/* Pipeline stages recorded per frame. Latencies are reported
+ * relative to QCAMERA_FRAME_STAGE_REQUEST of the same frame */
+typedef enum {
+    QCAMERA_FRAME_STAGE_REQUEST = 0,  // request accepted by HAL
+    QCAMERA_FRAME_STAGE_SENSOR,       // sensor timestamp of the frame
+    QCAMERA_FRAME_STAGE_METADATA,     // metadata callback from backend
+    QCAMERA_FRAME_STAGE_BUFFER,       // output buffer callback from stream
+    QCAMERA_FRAME_STAGE_JPEG,         // jpeg encode done
+    QCAMERA_FRAME_STAGE_MAX
+} qcamera_frame_stage_t;
+
+#define QCAMERA_FRAME_TRACE_RING_SIZE 1024  // records per thread, power of 2
+#define QCAMERA_FRAME_TRACE_MAX_RINGS 32    // max threads traced at once
+#define QCAMERA_FRAME_TRACE_BUCKETS   24    // log2(usec) histogram buckets
+
+typedef struct {
+    int64_t  timestamp;  // CLOCK_MONOTONIC ns
+    uint32_t frame;      // framework frame number
+    uint16_t stage;      // qcamera_frame_stage_t
+    uint16_t cameraId;
+} qcamera_frame_trace_rec_t;
+
+/* Always-on per-frame event recorder. Each recording thread owns a
+ * single producer ring, so record() is a couple of stores and never
+ * takes a lock. Readers take a best-effort snapshot of all rings. */
+class QCameraFrameTracer {
+public:
+    static QCameraFrameTracer *getInstance();
+
+    inline void record(uint32_t cameraId, uint32_t frame,
+            qcamera_frame_stage_t stage) {
+        if (mEnabled) {
+            record(cameraId, frame, stage, systemTime(SYSTEM_TIME_MONOTONIC));
+        }
+    }
+    void record(uint32_t cameraId, uint32_t frame,
+            qcamera_frame_stage_t stage, int64_t timestamp);
+
+    void dump(int fd, uint32_t cameraId);
+    int32_t exportBinary(int fd);
+
+private:
+    typedef struct {
+        std::atomic<uint32_t> head;     // next write position
+        std::atomic<bool> inUse;        // owned by a live thread
+        qcamera_frame_trace_rec_t recs[QCAMERA_FRAME_TRACE_RING_SIZE];
+    } ring_t;
+
+    QCameraFrameTracer();
+    ~QCameraFrameTracer();
+
+    ring_t *getThreadRing();
+    uint32_t snapshot(qcamera_frame_trace_rec_t *out, uint32_t maxRecs);
+    static void releaseThreadRing(void *ring);
+
+    bool mEnabled;
+    pthread_key_t mRingKey;
+    ring_t *mRings[QCAMERA_FRAME_TRACE_MAX_RINGS];
+    std::atomic<uint32_t> mNumRings;
+    pthread_mutex_t mRegLock;   // ring registration only
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_FRAME_TRACER_H__ */
@@ -35,6 +35,7 @@
 // System dependencies
 #include <stdlib.h>
 #include <dlfcn.h>
+#include <utils/Errors.h>
 #include <utils/Timers.h>
 // Camera dependencies
 #include "QCameraPerf.h"
@@ -64,6 +65,8 @@ QCameraPerfLock::QCameraPerfLock() :
         mPerfLockEnable(0),
         mPerfLockHandle(-1),
         mPerfLockHandleTimed(-1),
+        mPerfLockHandleLevel(-1),
+        mPerfLevel(QCAMERA_PERF_LEVEL_NONE),
         mTimerSet(0),
         mPerfLockTimeout(0),
         mStartTimeofLock(0)
@@ -193,6 +196,12 @@ void QCameraPerfLock::lock_deinit()
             (*perf_lock_rel)(mPerfLockHandle);
         }
 
+        if ((NULL != perf_lock_rel) && (mPerfLockHandleLevel >= 0)) {
+            (*perf_lock_rel)(mPerfLockHandleLevel);
+        }
+        mPerfLockHandleLevel = -1;
+        mPerfLevel = QCAMERA_PERF_LEVEL_NONE;
+
         if (mDlHandle) {
             perf_lock_acq  = NULL;
             perf_lock_rel  = NULL;
@@ -455,6 +464,69 @@ int32_t QCameraPerfLock::lock_rel()
     return ret;
 }
 
+/*===========================================================================
+ * FUNCTION   : lock_acq_level
+ *
+ * DESCRIPTION: hold a graded performance lock for the specified duration.
+ *              Acquiring the level already held renews its duration, a
+ *              different level replaces it and QCAMERA_PERF_LEVEL_NONE
+ *              releases it. Independent of lock_acq/lock_acq_timed and of
+ *              the active power hint.
+ *
+ * PARAMETERS :
+ *  @level    : lock level
+ *  @timer_val: lock duration in milliseconds
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *
+ *==========================================================================*/
+int32_t QCameraPerfLock::lock_acq_level(qcamera_perf_level_t level, int32_t timer_val)
+{
+    int32_t ret = NO_ERROR;
+    Mutex::Autolock lock(mLock);
+
+    if (!mPerfLockEnable || (NULL == perf_lock_acq) || (NULL == perf_lock_rel)) {
+        return ret;
+    }
+
+    if ((level != mPerfLevel) && (mPerfLockHandleLevel >= 0)) {
+        LOGD("perf_handle_rel %d level %d", mPerfLockHandleLevel, mPerfLevel);
+        if ((*perf_lock_rel)(mPerfLockHandleLevel) < 0) {
+            LOGE("failed to release lock");
+        }
+        mPerfLockHandleLevel = -1;
+    }
+    mPerfLevel = QCAMERA_PERF_LEVEL_NONE;
+
+    if (QCAMERA_PERF_LEVEL_NONE == level) {
+        return ret;
+    }
+
+    int32_t perf_lock_params[] = {
+            ALL_CPUS_PWR_CLPS_DIS,
+            CPU0_MIN_FREQ_TURBO_MAX,
+            CPU4_MIN_FREQ_TURBO_MAX
+    };
+    int32_t num_params = (QCAMERA_PERF_LEVEL_HIGH == level) ?
+            (int32_t)(sizeof(perf_lock_params) / sizeof(int32_t)) : 1;
+
+    // Passing the handle held renews it
+    ret = (*perf_lock_acq)(mPerfLockHandleLevel, timer_val, perf_lock_params,
+            num_params);
+    if (ret < 0) {
+        LOGE("failed to acquire lock level %d", level);
+        mPerfLockHandleLevel = -1;
+    } else {
+        mPerfLockHandleLevel = ret;
+        mPerfLevel = level;
+        ret = NO_ERROR;
+    }
+    LOGD("perf_handle_acq %d level %d", mPerfLockHandleLevel, level);
+    return ret;
+}
+
 /*===========================================================================
  * FUNCTION   : powerHintInternal
  *
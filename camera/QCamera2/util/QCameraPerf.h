@@ -44,6 +44,13 @@ typedef enum {
     CPU4_MIN_FREQ_TURBO_MAX = 0x1FFE,
 }perf_lock_params_t;
 
+/* Graded perf lock held by the power governor, see lock_acq_level() */
+typedef enum {
+    QCAMERA_PERF_LEVEL_NONE = 0,   // no lock
+    QCAMERA_PERF_LEVEL_LOW,        // power collapse disabled
+    QCAMERA_PERF_LEVEL_HIGH,       // power collapse disabled, clusters at turbo
+} qcamera_perf_level_t;
+
 /* Time related macros */
 #define ONE_SEC 1000
 typedef int64_t nsecs_t;
@@ -64,6 +71,7 @@ public:
     int32_t lock_acq();
     int32_t lock_acq_timed(int32_t timer_val);
     int32_t lock_rel_timed();
+    int32_t lock_acq_level(qcamera_perf_level_t level, int32_t timer_val);
     bool    isTimerReset();
     void    powerHintInternal(power_hint_t hint, bool enable);
     void    powerHint(power_hint_t hint, bool enable);
@@ -78,6 +86,8 @@ private:
     Mutex           mLock;
     int32_t         mPerfLockHandle;        // Performance lock library handle
     int32_t         mPerfLockHandleTimed;   // Performance lock library handle
+    int32_t         mPerfLockHandleLevel;   // Performance lock library handle
+    qcamera_perf_level_t mPerfLevel;        // level held by mPerfLockHandleLevel
     power_module_t *m_pPowerModule;         // power module Handle
     power_hint_t    mCurrentPowerHint;
     bool            mCurrentPowerHintEnable;
@@ -0,0 +1,122 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_SEQ_SNAPSHOT_H__
+#define __QCAMERA_SEQ_SNAPSHOT_H__
+
+// System dependencies
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+namespace qcamera {
+
+/* Double buffered copy of a POD struct that readers copy out without a
+ * lock. The writer fills the slot that is not published and then flips
+ * the published pointer. Each slot has a sequence number that is odd
+ * while the slot is rewritten, so a reader still copying out of a slot
+ * being reused notices and retries.
+ *
+ * Writers must be serialized by the caller. */
+template <typename T>
+class QCameraSeqSnapshot {
+public:
+    QCameraSeqSnapshot() : mPublished(NULL), mWriting(NULL) {
+        for (size_t i = 0; i < 2; i++) {
+            mSlots[i].mSeq.store(0, std::memory_order_relaxed);
+            memset(&mSlots[i].mData, 0, sizeof(T));
+        }
+    }
+
+    bool isPublished() const {
+        return mPublished.load(std::memory_order_relaxed) != NULL;
+    }
+
+    // Returns the zeroed data of the unpublished slot to fill in
+    T &beginWrite() {
+        Slot *cur = mPublished.load(std::memory_order_relaxed);
+        mWriting = (cur == &mSlots[0]) ? &mSlots[1] : &mSlots[0];
+        uint32_t seq = mWriting->mSeq.load(std::memory_order_relaxed);
+        mWriting->mSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memset(&mWriting->mData, 0, sizeof(T));
+        return mWriting->mData;
+    }
+
+    void endWrite() {
+        uint32_t seq = mWriting->mSeq.load(std::memory_order_relaxed);
+        mWriting->mSeq.store(seq + 1, std::memory_order_release);
+        mPublished.store(mWriting, std::memory_order_release);
+        mWriting = NULL;
+    }
+
+    // Readers fall back to their locked path until the next publish
+    void unpublish() {
+        mPublished.store(NULL, std::memory_order_release);
+    }
+
+    // @retries, if not NULL, is incremented once per torn read retried
+    bool read(T &out, uint32_t *retries = NULL) const {
+        for (;;) {
+            const Slot *slot = mPublished.load(std::memory_order_acquire);
+            if (slot == NULL) {
+                return false;
+            }
+
+            uint32_t seq = slot->mSeq.load(std::memory_order_acquire);
+            if (!(seq & 1)) {
+                out = slot->mData;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot->mSeq.load(std::memory_order_relaxed) == seq) {
+                    return true;
+                }
+            }
+            if (retries != NULL) {
+                (*retries)++;
+            }
+        }
+    }
+
+private:
+    QCameraSeqSnapshot(const QCameraSeqSnapshot &);
+    QCameraSeqSnapshot &operator=(const QCameraSeqSnapshot &);
+
+    typedef struct {
+        std::atomic<uint32_t> mSeq;
+        T mData;
+    } Slot;
+
+    Slot mSlots[2];
+    std::atomic<Slot *> mPublished;
+    Slot *mWriting;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_SEQ_SNAPSHOT_H__ */
@@ -0,0 +1,519 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_TAG "QCameraTaskGraph"
+
+// System dependencies
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils/Errors.h>
+
+// Camera dependencies
+#include "QCameraTaskGraph.h"
+
+extern "C" {
+#include "mm_camera_dbg.h"
+}
+
+using namespace android;
+
+namespace qcamera {
+
+// dependency chains are short, this only guards against bad input
+#define QCAMERA_TASK_MAX_DEPTH 8
+
+/*===========================================================================
+ * FUNCTION   : QCameraTaskGraph
+ *
+ * DESCRIPTION: constructor of QCameraTaskGraph
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraTaskGraph::QCameraTaskGraph()
+    : mExec(NULL),
+      mRelease(NULL),
+      mUserData(NULL),
+      mWorkers(NULL),
+      mNumWorkers(0),
+      mNextWorker(0),
+      mActive(false)
+{
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+}
+
+/*===========================================================================
+ * FUNCTION   : ~QCameraTaskGraph
+ *
+ * DESCRIPTION: deconstructor of QCameraTaskGraph
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+QCameraTaskGraph::~QCameraTaskGraph()
+{
+    deinit();
+    pthread_cond_destroy(&mDoneCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : init
+ *
+ * DESCRIPTION: launch the worker pool
+ *
+ * PARAMETERS :
+ *   @numWorkers : number of worker threads, 1 runs tasks one at a time
+ *   @exec       : task execution function
+ *   @release    : frees tasks dropped on deinit, can be NULL
+ *   @userData   : passed to exec and release
+ *   @name       : worker thread name prefix
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraTaskGraph::init(uint32_t numWorkers, qcamera_task_exec_t exec,
+        qcamera_task_release_t release, void *userData, const char *name)
+{
+    if ((exec == NULL) || (mWorkers != NULL)) {
+        return BAD_VALUE;
+    }
+    if (numWorkers == 0) {
+        numWorkers = 1;
+    } else if (numWorkers > QCAMERA_TASK_MAX_WORKERS) {
+        numWorkers = QCAMERA_TASK_MAX_WORKERS;
+    }
+
+    mExec = exec;
+    mRelease = release;
+    mUserData = userData;
+    mWorkers = new worker_t[numWorkers];
+    mNumWorkers = 0;
+    for (uint32_t i = 0; i < numWorkers; i++) {
+        worker_t *worker = &mWorkers[i];
+        worker->graph = this;
+        snprintf(worker->name, sizeof(worker->name), "%s%u", name, i);
+        // workers drain every ready task per wake up
+        worker->thread.setCoalesceNextJob(true);
+        if (worker->thread.launch(workerRoutine, worker) != NO_ERROR) {
+            LOGE("Failed to launch worker %u", i);
+            break;
+        }
+        mNumWorkers++;
+    }
+    if (mNumWorkers == 0) {
+        delete [] mWorkers;
+        mWorkers = NULL;
+        return UNKNOWN_ERROR;
+    }
+
+    pthread_mutex_lock(&mLock);
+    mActive = true;
+    pthread_mutex_unlock(&mLock);
+    LOGH("%s: %u workers", name, mNumWorkers);
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : deinit
+ *
+ * DESCRIPTION: stop the worker pool. Running tasks complete, tasks that
+ *              have not started are released without running.
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraTaskGraph::deinit()
+{
+    if (mWorkers == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&mLock);
+    mActive = false;
+    pthread_mutex_unlock(&mLock);
+
+    for (uint32_t i = 0; i < mNumWorkers; i++) {
+        mWorkers[i].thread.exit();
+    }
+
+    // tasks still running here were claimed by a waiting thread, which
+    // retires them itself
+    pthread_mutex_lock(&mLock);
+    List<task_node_t *>::iterator it = mTasks.begin();
+    while (it != mTasks.end()) {
+        task_node_t *node = *it;
+        if (node->state != TASK_STATE_QUEUED) {
+            it++;
+            continue;
+        }
+        LOGH("Dropping task %u", node->id);
+        if (mRelease != NULL) {
+            mRelease(node->task, mUserData);
+        }
+        delete node;
+        it = mTasks.erase(it);
+    }
+    pthread_cond_broadcast(&mDoneCond);
+    pthread_mutex_unlock(&mLock);
+
+    delete [] mWorkers;
+    mWorkers = NULL;
+    mNumWorkers = 0;
+}
+
+/*===========================================================================
+ * FUNCTION   : submit
+ *
+ * DESCRIPTION: add a task to the graph
+ *
+ * PARAMETERS :
+ *   @id      : non-zero task id, unique among pending tasks
+ *   @task    : task handed to the exec function
+ *   @deps    : ids of tasks that must finish first, 0 entries are skipped
+ *   @numDeps : number of entries in deps
+ *
+ * RETURN     : int32_t type of status
+ *              NO_ERROR  -- success
+ *              none-zero failure code
+ *==========================================================================*/
+int32_t QCameraTaskGraph::submit(uint32_t id, void *task,
+        const uint32_t *deps, uint32_t numDeps)
+{
+    if ((id == 0) || (numDeps > QCAMERA_TASK_MAX_DEPS)) {
+        return BAD_VALUE;
+    }
+
+    task_node_t *node = new task_node_t;
+    node->id = id;
+    node->task = task;
+    node->state = TASK_STATE_QUEUED;
+    node->numDeps = 0;
+    for (uint32_t i = 0; i < numDeps; i++) {
+        if ((deps[i] != 0) && (deps[i] != id)) {
+            node->deps[node->numDeps++] = deps[i];
+        }
+    }
+
+    pthread_mutex_lock(&mLock);
+    if (!mActive) {
+        pthread_mutex_unlock(&mLock);
+        delete node;
+        return NO_INIT;
+    }
+    mTasks.push_back(node);
+    bool ready = isReadyLocked(node);
+    pthread_mutex_unlock(&mLock);
+
+    if (ready) {
+        kickWorkers(1);
+    }
+    return NO_ERROR;
+}
+
+/*===========================================================================
+ * FUNCTION   : wait
+ *
+ * DESCRIPTION: block until a task has finished. While the task or one of
+ *              its dependencies is ready but not picked up by a worker,
+ *              it is run on the calling thread.
+ *
+ * PARAMETERS :
+ *   @id : task id
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraTaskGraph::wait(uint32_t id)
+{
+    pthread_mutex_lock(&mLock);
+    task_node_t *node = findLocked(id);
+    while (node != NULL) {
+        task_node_t *runnable = claimForLocked(node, QCAMERA_TASK_MAX_DEPTH);
+        if (runnable != NULL) {
+            pthread_mutex_unlock(&mLock);
+            run(runnable);
+            pthread_mutex_lock(&mLock);
+        } else {
+            pthread_cond_wait(&mDoneCond, &mLock);
+        }
+        node = findLocked(id);
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : isPending
+ *
+ * DESCRIPTION: whether a task is queued or running
+ *
+ * PARAMETERS :
+ *   @id : task id
+ *
+ * RETURN     : true if pending
+ *==========================================================================*/
+bool QCameraTaskGraph::isPending(uint32_t id)
+{
+    pthread_mutex_lock(&mLock);
+    bool pending = (findLocked(id) != NULL);
+    pthread_mutex_unlock(&mLock);
+    return pending;
+}
+
+/*===========================================================================
+ * FUNCTION   : findLocked
+ *
+ * DESCRIPTION: look up a pending task
+ *
+ * PARAMETERS :
+ *   @id : task id
+ *
+ * RETURN     : task node, NULL if the task is not pending
+ *
+ * PRECONDITION : mLock is held by current thread
+ *==========================================================================*/
+QCameraTaskGraph::task_node_t *QCameraTaskGraph::findLocked(uint32_t id)
+{
+    if (id == 0) {
+        return NULL;
+    }
+    for (List<task_node_t *>::iterator it = mTasks.begin();
+            it != mTasks.end(); it++) {
+        if ((*it)->id == id) {
+            return *it;
+        }
+    }
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : isReadyLocked
+ *
+ * DESCRIPTION: whether a queued task has no pending dependency
+ *
+ * PARAMETERS :
+ *   @node : task node
+ *
+ * RETURN     : true if the task can start
+ *
+ * PRECONDITION : mLock is held by current thread
+ *==========================================================================*/
+bool QCameraTaskGraph::isReadyLocked(task_node_t *node)
+{
+    if (node->state != TASK_STATE_QUEUED) {
+        return false;
+    }
+    for (uint32_t i = 0; i < node->numDeps; i++) {
+        if (findLocked(node->deps[i]) != NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*===========================================================================
+ * FUNCTION   : claimReadyLocked
+ *
+ * DESCRIPTION: take the oldest ready task
+ *
+ * PARAMETERS : None
+ *
+ * RETURN     : task node marked running, NULL if none is ready
+ *
+ * PRECONDITION : mLock is held by current thread
+ *==========================================================================*/
+QCameraTaskGraph::task_node_t *QCameraTaskGraph::claimReadyLocked()
+{
+    for (List<task_node_t *>::iterator it = mTasks.begin();
+            it != mTasks.end(); it++) {
+        if (isReadyLocked(*it)) {
+            (*it)->state = TASK_STATE_RUNNING;
+            return *it;
+        }
+    }
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : claimForLocked
+ *
+ * DESCRIPTION: take a ready task that node is waiting on, node included
+ *
+ * PARAMETERS :
+ *   @node  : task node being waited for
+ *   @depth : remaining dependency levels to search
+ *
+ * RETURN     : task node marked running, NULL if none is ready
+ *
+ * PRECONDITION : mLock is held by current thread
+ *==========================================================================*/
+QCameraTaskGraph::task_node_t *QCameraTaskGraph::claimForLocked(
+        task_node_t *node, uint32_t depth)
+{
+    if (isReadyLocked(node)) {
+        node->state = TASK_STATE_RUNNING;
+        return node;
+    }
+    if ((node->state != TASK_STATE_QUEUED) || (depth == 0)) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < node->numDeps; i++) {
+        task_node_t *dep = findLocked(node->deps[i]);
+        if (dep != NULL) {
+            task_node_t *runnable = claimForLocked(dep, depth - 1);
+            if (runnable != NULL) {
+                return runnable;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*===========================================================================
+ * FUNCTION   : run
+ *
+ * DESCRIPTION: execute a claimed task and retire it
+ *
+ * PARAMETERS :
+ *   @node : task node marked running
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraTaskGraph::run(task_node_t *node)
+{
+    uint32_t ready = 0;
+
+    mExec(node->task, mUserData);
+
+    pthread_mutex_lock(&mLock);
+    for (List<task_node_t *>::iterator it = mTasks.begin();
+            it != mTasks.end(); it++) {
+        if (*it == node) {
+            mTasks.erase(it);
+            break;
+        }
+    }
+    for (List<task_node_t *>::iterator it = mTasks.begin();
+            it != mTasks.end(); it++) {
+        if (isReadyLocked(*it)) {
+            ready++;
+        }
+    }
+    pthread_cond_broadcast(&mDoneCond);
+    pthread_mutex_unlock(&mLock);
+
+    delete node;
+    if (ready > 0) {
+        kickWorkers(ready);
+    }
+}
+
+/*===========================================================================
+ * FUNCTION   : kickWorkers
+ *
+ * DESCRIPTION: wake up workers for newly ready tasks
+ *
+ * PARAMETERS :
+ *   @count : number of ready tasks
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void QCameraTaskGraph::kickWorkers(uint32_t count)
+{
+    pthread_mutex_lock(&mLock);
+    if (count > mNumWorkers) {
+        count = mNumWorkers;
+    }
+    for (uint32_t i = 0; mActive && (i < count); i++) {
+        mWorkers[mNextWorker].thread.sendCmd(CAMERA_CMD_TYPE_DO_NEXT_JOB,
+                FALSE, FALSE);
+        mNextWorker = (mNextWorker + 1) % mNumWorkers;
+    }
+    pthread_mutex_unlock(&mLock);
+}
+
+/*===========================================================================
+ * FUNCTION   : workerRoutine
+ *
+ * DESCRIPTION: worker thread routine, runs ready tasks until none is left
+ *
+ * PARAMETERS :
+ *   @data : user data ptr (worker_t)
+ *
+ * RETURN     : None
+ *==========================================================================*/
+void *QCameraTaskGraph::workerRoutine(void *data)
+{
+    int running = 1;
+    int ret;
+    worker_t *worker = (worker_t *)data;
+    QCameraTaskGraph *pme = worker->graph;
+    QCameraCmdThread *cmdThread = &worker->thread;
+    cmdThread->setName(worker->name);
+
+    do {
+        do {
+            ret = cam_sem_wait(&cmdThread->cmd_sem);
+            if (ret != 0 && errno != EINVAL) {
+                LOGE("cam_sem_wait error (%s)", strerror(errno));
+                return NULL;
+            }
+        } while (ret != 0);
+
+        camera_cmd_type_t cmd = cmdThread->getCmd();
+        switch (cmd) {
+        case CAMERA_CMD_TYPE_DO_NEXT_JOB:
+            {
+                pthread_mutex_lock(&pme->mLock);
+                task_node_t *node = pme->mActive ? pme->claimReadyLocked() : NULL;
+                pthread_mutex_unlock(&pme->mLock);
+                while (node != NULL) {
+                    pme->run(node);
+                    pthread_mutex_lock(&pme->mLock);
+                    node = pme->mActive ? pme->claimReadyLocked() : NULL;
+                    pthread_mutex_unlock(&pme->mLock);
+                }
+            }
+            break;
+        case CAMERA_CMD_TYPE_EXIT:
+            running = 0;
+            break;
+        default:
+            break;
+        }
+    } while (running);
+    return NULL;
+}
+
+}; // namespace qcamera
@@ -0,0 +1,110 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __QCAMERA_TASK_GRAPH_H__
+#define __QCAMERA_TASK_GRAPH_H__
+
+// System dependencies
+#include <pthread.h>
+#include <utils/List.h>
+
+// Camera dependencies
+#include "QCameraCmdThread.h"
+
+namespace qcamera {
+
+#define QCAMERA_TASK_MAX_WORKERS 4
+#define QCAMERA_TASK_MAX_DEPS    4
+
+/* Runs a task, returns its status. task is the pointer given to submit */
+typedef int32_t (*qcamera_task_exec_t)(void *task, void *user_data);
+/* Frees a task that was never run, called on deinit */
+typedef void (*qcamera_task_release_t)(void *task, void *user_data);
+
+/* Small dependency graph executor. Tasks are identified by caller chosen
+ * non-zero ids and start once every task they depend on has finished;
+ * ids that are not pending count as finished. Ready tasks run FIFO on a
+ * fixed pool of worker threads. wait() runs the awaited task, or a ready
+ * task it depends on, on the calling thread instead of idling. */
+class QCameraTaskGraph {
+public:
+    QCameraTaskGraph();
+    ~QCameraTaskGraph();
+
+    int32_t init(uint32_t numWorkers, qcamera_task_exec_t exec,
+            qcamera_task_release_t release, void *userData, const char *name);
+    void deinit();
+    int32_t submit(uint32_t id, void *task, const uint32_t *deps,
+            uint32_t numDeps);
+    void wait(uint32_t id);
+    bool isPending(uint32_t id);
+
+private:
+    typedef enum {
+        TASK_STATE_QUEUED,
+        TASK_STATE_RUNNING
+    } task_state_t;
+
+    typedef struct {
+        uint32_t id;
+        void *task;
+        task_state_t state;
+        uint32_t numDeps;
+        uint32_t deps[QCAMERA_TASK_MAX_DEPS];
+    } task_node_t;
+
+    typedef struct {
+        QCameraTaskGraph *graph;
+        QCameraCmdThread thread;
+        char name[16];
+    } worker_t;
+
+    task_node_t *findLocked(uint32_t id);
+    bool isReadyLocked(task_node_t *node);
+    task_node_t *claimReadyLocked();
+    task_node_t *claimForLocked(task_node_t *node, uint32_t depth);
+    void run(task_node_t *node);
+    void kickWorkers(uint32_t count);
+    static void *workerRoutine(void *data);
+
+    pthread_mutex_t mLock;                  // task list and worker rotation
+    pthread_cond_t mDoneCond;               // signalled when a task finishes
+    android::List<task_node_t *> mTasks;    // queued and running, FIFO
+    qcamera_task_exec_t mExec;
+    qcamera_task_release_t mRelease;
+    void *mUserData;
+    worker_t *mWorkers;
+    uint32_t mNumWorkers;
+    uint32_t mNextWorker;
+    bool mActive;
+};
+
+}; // namespace qcamera
+
+#endif /* __QCAMERA_TASK_GRAPH_H__ */
@@ -0,0 +1,194 @@
+/* Copyright (c) 2015-2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Host tool listing and unpacking a frame dump container.
+ *
+ *   usage: qcamera_dump_extract [-x <out dir>] <container>
+ *
+ * Without -x every entry is listed. With -x each frame is written to its
+ * own file, named the way the per frame dumps used to be, e.g.
+ * 12p_1920x1080_345_0.yuv */
+
+// System dependencies
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Camera dependencies
+#include "QCameraDumpFormat.h"
+
+/*===========================================================================
+ * FUNCTION   : readAt
+ *
+ * DESCRIPTION: read len bytes at offset
+ *
+ * PARAMETERS :
+ *   @fp     : container file
+ *   @buf    : output buffer
+ *   @len    : bytes to read
+ *   @offset : file offset
+ *
+ * RETURN     : true on success
+ *==========================================================================*/
+static bool readAt(FILE *fp, void *buf, size_t len, uint64_t offset)
+{
+    if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return (len == 0) || (fread(buf, len, 1, fp) == 1);
+}
+
+/*===========================================================================
+ * FUNCTION   : entryFileName
+ *
+ * DESCRIPTION: build the legacy dump file name of an entry
+ *
+ * PARAMETERS :
+ *   @e   : index entry
+ *   @buf : output buffer
+ *   @len : size of buf
+ *
+ * RETURN     : None
+ *==========================================================================*/
+static void entryFileName(const qcamera_dump_entry_t &e, char *buf, size_t len)
+{
+    char tag[QCAMERA_DUMP_TAG_LEN + 1];
+    char misc[QCAMERA_DUMP_MISC_LEN + 1];
+    memcpy(tag, e.tag, QCAMERA_DUMP_TAG_LEN);
+    tag[QCAMERA_DUMP_TAG_LEN] = '\0';
+    memcpy(misc, e.misc, QCAMERA_DUMP_MISC_LEN);
+    misc[QCAMERA_DUMP_MISC_LEN] = '\0';
+    const char *ext = (strcmp(tag, "r") == 0) ? "raw" : "yuv";
+
+    if (misc[0] != '\0') {
+        snprintf(buf, len, "%u%s_%dx%d_%u_%s_%u.%s", e.seq, tag, e.width,
+                e.height, e.frame_idx, misc, e.camera_id, ext);
+    } else {
+        snprintf(buf, len, "%u%s_%dx%d_%u_%u.%s", e.seq, tag, e.width,
+                e.height, e.frame_idx, e.camera_id, ext);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *outDir = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "x:")) != -1) {
+        if (opt == 'x') {
+            outDir = optarg;
+        } else {
+            break;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "usage: %s [-x <out dir>] <container>\n", argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[optind];
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    qcamera_dump_file_hdr_t hdr;
+    if (!readAt(fp, &hdr, sizeof(hdr), 0) ||
+            memcmp(hdr.magic, QCAMERA_DUMP_MAGIC, sizeof(hdr.magic)) != 0 ||
+            hdr.version != QCAMERA_DUMP_VERSION ||
+            hdr.entry_size != sizeof(qcamera_dump_entry_t) ||
+            hdr.num_entries > hdr.max_entries) {
+        fprintf(stderr, "%s: not a frame dump container\n", path);
+        fclose(fp);
+        return 1;
+    }
+
+    int ret = 0;
+    uint8_t *data = NULL;
+    size_t dataCap = 0;
+    for (uint32_t i = 0; i < hdr.num_entries; i++) {
+        qcamera_dump_entry_t e;
+        char name[96];
+        if (!readAt(fp, &e, sizeof(e), QCAMERA_DUMP_HDR_SIZE +
+                (uint64_t)i * sizeof(e))) {
+            fprintf(stderr, "%s: cannot read entry %u\n", path, i);
+            ret = 1;
+            break;
+        }
+        entryFileName(e, name, sizeof(name));
+        printf("%5u seq %u cam %u type 0x%x stream %u fmt %u frame %u "
+                "%dx%d ts %lld planes %u len %llu  %s\n", i, e.seq,
+                e.camera_id, e.dump_type, e.stream_type, e.format,
+                e.frame_idx, e.width, e.height, (long long)e.timestamp,
+                e.num_planes, (unsigned long long)e.data_len, name);
+        if (outDir == NULL) {
+            continue;
+        }
+
+        if ((e.data_offset < hdr.data_offset) ||
+                (e.data_offset + e.data_len > hdr.file_size)) {
+            fprintf(stderr, "%s: entry %u out of range\n", path, i);
+            ret = 1;
+            continue;
+        }
+        if (e.data_len > dataCap) {
+            free(data);
+            dataCap = (size_t)e.data_len;
+            data = (uint8_t *)malloc(dataCap);
+            if (data == NULL) {
+                fprintf(stderr, "out of memory\n");
+                ret = 1;
+                break;
+            }
+        }
+        if (!readAt(fp, data, (size_t)e.data_len, e.data_offset)) {
+            fprintf(stderr, "%s: cannot read frame of entry %u\n", path, i);
+            ret = 1;
+            continue;
+        }
+
+        char outPath[FILENAME_MAX];
+        snprintf(outPath, sizeof(outPath), "%s/%s", outDir, name);
+        FILE *out = fopen(outPath, "wb");
+        if ((out == NULL) ||
+                ((e.data_len > 0) && (fwrite(data, (size_t)e.data_len, 1, out) != 1))) {
+            fprintf(stderr, "%s: %s\n", outPath, strerror(errno));
+            ret = 1;
+        }
+        if (out != NULL) {
+            fclose(out);
+        }
+    }
+    free(data);
+    fclose(fp);
+    return ret;
+}
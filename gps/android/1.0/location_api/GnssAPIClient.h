@@ -32,6 +32,7 @@
 
 
 #include <mutex>
+#include <string>
 #include <android/hardware/gnss/1.0/IGnss.h>
 #include <android/hardware/gnss/1.0/IGnssCallback.h>
 #include <android/hardware/gnss/1.0/IGnssNiCallback.h>
@@ -85,8 +86,8 @@ public:
     void onCapabilitiesCb(LocationCapabilitiesMask capabilitiesMask) final;
     void onTrackingCb(Location location) final;
     void onGnssNiCb(uint32_t id, GnssNiNotification gnssNiNotification) final;
-    void onGnssSvCb(GnssSvNotification gnssSvNotification) final;
-    void onGnssNmeaCb(GnssNmeaNotification gnssNmeaNotification) final;
+    void onGnssSvCb(const GnssSvNotification& gnssSvNotification) final;
+    void onGnssNmeaCb(const GnssNmeaNotification& gnssNmeaNotification) final;
 
     void onStartTrackingCb(LocationError error) final;
     void onStopTrackingCb(LocationError error) final;
@@ -99,6 +100,8 @@ private:
     LocationCapabilitiesMask mLocationCapabilitiesMask;
     bool mLocationCapabilitiesCached;
     TrackingOptions mTrackingOptions;
+    // callback thread only, reused for every NMEA sentence
+    std::string mNmeaSentence;
 };
 
 }  // namespace implementation
@@ -60,7 +60,7 @@ public:
     Return<IGnssMeasurement::GnssMeasurementStatus> startTracking();
 
     // callbacks we are interested in
-    void onGnssMeasurementsCb(GnssMeasurementsNotification gnssMeasurementsNotification) final;
+    void onGnssMeasurementsCb(const GnssMeasurementsNotification& gnssMeasurementsNotification) final;
 
 private:
     std::mutex mMutex;
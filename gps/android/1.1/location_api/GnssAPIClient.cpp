@@ -31,6 +31,7 @@
 #define LOG_TAG "LocSvc_GnssAPIClient"
 #define SINGLE_SHOT_MIN_TRACKING_INTERVAL_MSEC (590 * 60 * 60 * 1000) // 590 hours
 
+#include <string.h>
 #include <log_util.h>
 #include <loc_cfg.h>
 
@@ -49,7 +50,7 @@ using ::android::hardware::gnss::V1_0::IGnssCallback;
 using ::android::hardware::gnss::V1_0::IGnssNiCallback;
 using ::android::hardware::gnss::V1_0::GnssLocation;
 
-static void convertGnssSvStatus(GnssSvNotification& in, IGnssCallback::GnssSvStatus& out);
+static void convertGnssSvStatus(const GnssSvNotification& in, IGnssCallback::GnssSvStatus& out);
 
 GnssAPIClient::GnssAPIClient(const sp<IGnssCallback>& gpsCb,
     const sp<IGnssNiCallback>& niCb) :
@@ -122,14 +123,14 @@ void GnssAPIClient::gnssUpdateCallbacks(const sp<IGnssCallback>& gpsCb,
 
     locationCallbacks.gnssSvCb = nullptr;
     if (mGnssCbIface != nullptr) {
-        locationCallbacks.gnssSvCb = [this](GnssSvNotification gnssSvNotification) {
+        locationCallbacks.gnssSvCb = [this](const GnssSvNotification& gnssSvNotification) {
             onGnssSvCb(gnssSvNotification);
         };
     }
 
     locationCallbacks.gnssNmeaCb = nullptr;
     if (mGnssCbIface != nullptr) {
-        locationCallbacks.gnssNmeaCb = [this](GnssNmeaNotification gnssNmeaNotification) {
+        locationCallbacks.gnssNmeaCb = [this](const GnssNmeaNotification& gnssNmeaNotification) {
             onGnssNmeaCb(gnssNmeaNotification);
         };
     }
@@ -445,7 +446,7 @@ void GnssAPIClient::onGnssNiCb(uint32_t id, GnssNiNotification gnssNiNotificatio
     gnssNiCbIface->niNotifyCb(notificationGnss);
 }
 
-void GnssAPIClient::onGnssSvCb(GnssSvNotification gnssSvNotification)
+void GnssAPIClient::onGnssSvCb(const GnssSvNotification& gnssSvNotification)
 {
     LOC_LOGD("%s]: (count: %zu)", __FUNCTION__, gnssSvNotification.count);
     mMutex.lock();
@@ -463,20 +464,26 @@ void GnssAPIClient::onGnssSvCb(GnssSvNotification gnssSvNotification)
     }
 }
 
-void GnssAPIClient::onGnssNmeaCb(GnssNmeaNotification gnssNmeaNotification)
+void GnssAPIClient::onGnssNmeaCb(const GnssNmeaNotification& gnssNmeaNotification)
 {
     mMutex.lock();
     auto gnssCbIface(mGnssCbIface);
     mMutex.unlock();
 
     if (gnssCbIface != nullptr) {
-        const std::string s(gnssNmeaNotification.nmea);
-        std::stringstream ss(s);
-        std::string each;
-        while(std::getline(ss, each, '\n')) {
-            each += '\n';
+        // Each sentence is copied once into mNmeaSentence, which keeps its
+        // capacity across batches. hidl_string is sent with its trailing NUL,
+        // so it can not point into the middle of the batch itself.
+        const char* p = gnssNmeaNotification.nmea;
+        const char* end = (nullptr != p) ? p + strlen(p) : p;
+        while (p < end) {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* next = (nullptr != eol) ? eol + 1 : end;
+            mNmeaSentence.assign(p, (nullptr != eol) ? eol - p : end - p);
+            mNmeaSentence += '\n';
+            p = next;
             android::hardware::hidl_string nmeaString;
-            nmeaString.setToExternal(each.c_str(), each.length());
+            nmeaString.setToExternal(mNmeaSentence.c_str(), mNmeaSentence.length());
             auto r = gnssCbIface->gnssNmeaCb(
                     static_cast<V1_0::GnssUtcTime>(gnssNmeaNotification.timestamp), nmeaString);
             if (!r.isOk()) {
@@ -530,7 +537,7 @@ void GnssAPIClient::onStopTrackingCb(LocationError error)
     }
 }
 
-static void convertGnssSvStatus(GnssSvNotification& in, IGnssCallback::GnssSvStatus& out)
+static void convertGnssSvStatus(const GnssSvNotification& in, IGnssCallback::GnssSvStatus& out)
 {
     memset(&out, 0, sizeof(IGnssCallback::GnssSvStatus));
     out.numSvs = in.count;
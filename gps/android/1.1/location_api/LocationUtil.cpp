@@ -119,7 +119,7 @@ void convertGnssLocation(const GnssLocation& in, Location& out)
     out.timestamp = static_cast<uint64_t>(in.timestamp);
 }
 
-void convertGnssConstellationType(GnssSvType& in, GnssConstellationType& out)
+void convertGnssConstellationType(const GnssSvType& in, GnssConstellationType& out)
 {
     switch(in) {
         case GNSS_SV_TYPE_GPS:
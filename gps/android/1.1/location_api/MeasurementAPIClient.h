@@ -31,6 +31,7 @@
 #define MEASUREMENT_API_CLINET_H
 
 #include <mutex>
+#include <vector>
 #include <android/hardware/gnss/1.1/IGnssMeasurement.h>
 #include <android/hardware/gnss/1.1/IGnssMeasurementCallback.h>
 #include <LocationAPIClientBase.h>
@@ -66,7 +67,7 @@ public:
             uint32_t timeBetweenMeasurement = GPS_DEFAULT_FIX_INTERVAL_MS);
 
     // callbacks we are interested in
-    void onGnssMeasurementsCb(GnssMeasurementsNotification gnssMeasurementsNotification) final;
+    void onGnssMeasurementsCb(const GnssMeasurementsNotification& gnssMeasurementsNotification) final;
 
 private:
     std::mutex mMutex;
@@ -74,6 +75,8 @@ private:
     sp<IGnssMeasurementCallback> mGnssMeasurementCbIface_1_1;
 
     bool mTracking;
+    // callback thread only, backing the hidl_vec of each report
+    std::vector<IGnssMeasurementCallback::GnssMeasurement> mMeasurements_1_1;
 };
 
 }  // namespace implementation
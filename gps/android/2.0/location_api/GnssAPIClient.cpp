@@ -31,6 +31,7 @@
 #define LOG_TAG "LocSvc_GnssAPIClient"
 #define SINGLE_SHOT_MIN_TRACKING_INTERVAL_MSEC (590 * 60 * 60 * 1000) // 590 hours
 
+#include <string.h>
 #include <log_util.h>
 #include <loc_cfg.h>
 
@@ -49,9 +50,9 @@ using ::android::hardware::gnss::V2_0::IGnssCallback;
 using ::android::hardware::gnss::V1_0::IGnssNiCallback;
 using ::android::hardware::gnss::V2_0::GnssLocation;
 
-static void convertGnssSvStatus(GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out);
-static void convertGnssSvStatus(GnssSvNotification& in,
-        hidl_vec<V2_0::IGnssCallback::GnssSvInfo>& out);
+static void convertGnssSvStatus(const GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out);
+static void convertGnssSvStatus(const GnssSvNotification& in,
+        std::vector<V2_0::IGnssCallback::GnssSvInfo>& out);
 
 GnssAPIClient::GnssAPIClient(const sp<V1_0::IGnssCallback>& gpsCb,
         const sp<V1_0::IGnssNiCallback>& niCb) :
@@ -135,12 +136,12 @@ void GnssAPIClient::setCallbacks()
     }
 
     locationCallbacks.gnssSvCb = nullptr;
-    locationCallbacks.gnssSvCb = [this](GnssSvNotification gnssSvNotification) {
+    locationCallbacks.gnssSvCb = [this](const GnssSvNotification& gnssSvNotification) {
         onGnssSvCb(gnssSvNotification);
     };
 
     locationCallbacks.gnssNmeaCb = nullptr;
-    locationCallbacks.gnssNmeaCb = [this](GnssNmeaNotification gnssNmeaNotification) {
+    locationCallbacks.gnssNmeaCb = [this](const GnssNmeaNotification& gnssNmeaNotification) {
         onGnssNmeaCb(gnssNmeaNotification);
     };
 
@@ -535,7 +536,7 @@ void GnssAPIClient::onGnssNiCb(uint32_t id, GnssNiNotification gnssNiNotificatio
     gnssNiCbIface->niNotifyCb(notificationGnss);
 }
 
-void GnssAPIClient::onGnssSvCb(GnssSvNotification gnssSvNotification)
+void GnssAPIClient::onGnssSvCb(const GnssSvNotification& gnssSvNotification)
 {
     LOC_LOGD("%s]: (count: %u)", __FUNCTION__, gnssSvNotification.count);
     mMutex.lock();
@@ -545,7 +546,8 @@ void GnssAPIClient::onGnssSvCb(GnssSvNotification gnssSvNotification)
 
     if (gnssCbIface_2_0 != nullptr) {
         hidl_vec<V2_0::IGnssCallback::GnssSvInfo> svInfoList;
-        convertGnssSvStatus(gnssSvNotification, svInfoList);
+        convertGnssSvStatus(gnssSvNotification, mSvInfoList);
+        svInfoList.setToExternal(mSvInfoList.data(), mSvInfoList.size());
         auto r = gnssCbIface_2_0->gnssSvStatusCb_2_0(svInfoList);
         if (!r.isOk()) {
             LOC_LOGE("%s] Error from gnssSvStatusCb_2_0 description=%s",
@@ -562,7 +564,7 @@ void GnssAPIClient::onGnssSvCb(GnssSvNotification gnssSvNotification)
     }
 }
 
-void GnssAPIClient::onGnssNmeaCb(GnssNmeaNotification gnssNmeaNotification)
+void GnssAPIClient::onGnssNmeaCb(const GnssNmeaNotification& gnssNmeaNotification)
 {
     mMutex.lock();
     auto gnssCbIface(mGnssCbIface);
@@ -570,13 +572,19 @@ void GnssAPIClient::onGnssNmeaCb(GnssNmeaNotification gnssNmeaNotification)
     mMutex.unlock();
 
     if (gnssCbIface != nullptr || gnssCbIface_2_0 != nullptr) {
-        const std::string s(gnssNmeaNotification.nmea);
-        std::stringstream ss(s);
-        std::string each;
-        while(std::getline(ss, each, '\n')) {
-            each += '\n';
+        // Each sentence is copied once into mNmeaSentence, which keeps its
+        // capacity across batches. hidl_string is sent with its trailing NUL,
+        // so it can not point into the middle of the batch itself.
+        const char* p = gnssNmeaNotification.nmea;
+        const char* end = (nullptr != p) ? p + strlen(p) : p;
+        while (p < end) {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* next = (nullptr != eol) ? eol + 1 : end;
+            mNmeaSentence.assign(p, (nullptr != eol) ? eol - p : end - p);
+            mNmeaSentence += '\n';
+            p = next;
             android::hardware::hidl_string nmeaString;
-            nmeaString.setToExternal(each.c_str(), each.length());
+            nmeaString.setToExternal(mNmeaSentence.c_str(), mNmeaSentence.length());
             if (gnssCbIface_2_0 != nullptr) {
                 auto r = gnssCbIface_2_0->gnssNmeaCb(
                         static_cast<V1_0::GnssUtcTime>(gnssNmeaNotification.timestamp), nmeaString);
@@ -669,7 +677,7 @@ void GnssAPIClient::onStopTrackingCb(LocationError error)
     }
 }
 
-static void convertGnssSvStatus(GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out)
+static void convertGnssSvStatus(const GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out)
 {
     memset(&out, 0, sizeof(IGnssCallback::GnssSvStatus));
     out.numSvs = in.count;
@@ -697,9 +705,10 @@ static void convertGnssSvStatus(GnssSvNotification& in, V1_0::IGnssCallback::Gns
     }
 }
 
-static void convertGnssSvStatus(GnssSvNotification& in,
-        hidl_vec<V2_0::IGnssCallback::GnssSvInfo>& out)
+static void convertGnssSvStatus(const GnssSvNotification& in,
+        std::vector<V2_0::IGnssCallback::GnssSvInfo>& out)
 {
+    // out keeps its capacity, no allocation once the largest report was seen
     out.resize(in.count);
     for (size_t i = 0; i < in.count; i++) {
         out[i].v1_0.svid = in.gnssSvs[i].svId;
@@ -32,6 +32,8 @@
 
 
 #include <mutex>
+#include <string>
+#include <vector>
 #include <android/hardware/gnss/2.0/IGnss.h>
 #include <android/hardware/gnss/2.0/IGnssCallback.h>
 #include <LocationAPIClientBase.h>
@@ -86,8 +88,8 @@ public:
     void onCapabilitiesCb(LocationCapabilitiesMask capabilitiesMask) final;
     void onTrackingCb(Location location) final;
     void onGnssNiCb(uint32_t id, GnssNiNotification gnssNiNotification) final;
-    void onGnssSvCb(GnssSvNotification gnssSvNotification) final;
-    void onGnssNmeaCb(GnssNmeaNotification gnssNmeaNotification) final;
+    void onGnssSvCb(const GnssSvNotification& gnssSvNotification) final;
+    void onGnssNmeaCb(const GnssNmeaNotification& gnssNmeaNotification) final;
 
     void onStartTrackingCb(LocationError error) final;
     void onStopTrackingCb(LocationError error) final;
@@ -102,6 +104,9 @@ private:
     LocationCapabilitiesMask mLocationCapabilitiesMask;
     bool mLocationCapabilitiesCached;
     TrackingOptions mTrackingOptions;
+    // callback thread only, reused for every NMEA sentence and SV report
+    std::string mNmeaSentence;
+    std::vector<V2_0::IGnssCallback::GnssSvInfo> mSvInfoList;
     bool mTracking;
     sp<V2_0::IGnssCallback> mGnssCbIface_2_0;
 };
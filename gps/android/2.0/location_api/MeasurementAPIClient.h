@@ -31,6 +31,7 @@
 #define MEASUREMENT_API_CLINET_H
 
 #include <mutex>
+#include <vector>
 #include <android/hardware/gnss/2.0/IGnssMeasurement.h>
 //#include <android/hardware/gnss/1.1/IGnssMeasurementCallback.h>
 #include <LocationAPIClientBase.h>
@@ -70,7 +71,7 @@ public:
             uint32_t timeBetweenMeasurement = GPS_DEFAULT_FIX_INTERVAL_MS);
 
     // callbacks we are interested in
-    void onGnssMeasurementsCb(GnssMeasurementsNotification gnssMeasurementsNotification) final;
+    void onGnssMeasurementsCb(const GnssMeasurementsNotification& gnssMeasurementsNotification) final;
 
 private:
     std::mutex mMutex;
@@ -79,6 +80,9 @@ private:
     sp<V2_0::IGnssMeasurementCallback> mGnssMeasurementCbIface_2_0;
 
     bool mTracking;
+    // callback thread only, backing the hidl_vec of each report
+    std::vector<V1_1::IGnssMeasurementCallback::GnssMeasurement> mMeasurements_1_1;
+    std::vector<V2_0::IGnssMeasurementCallback::GnssMeasurement> mMeasurements_2_0;
 };
 
 }  // namespace implementation
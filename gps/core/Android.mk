@@ -22,6 +22,8 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     LocApiBase.cpp \
+    LocApiRecorder.cpp \
+    LocApiReplay.cpp \
     LocAdapterBase.cpp \
     ContextBase.cpp \
     LocContext.cpp \
@@ -49,6 +51,103 @@ LOCAL_CFLAGS += $(GNSS_CFLAGS)
 
 include $(BUILD_SHARED_LIBRARY)
 
+# the top level makefile only includes one level down, so the test is here
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_api_replay_test
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := test/LocApiReplayTest.cpp
+LOCAL_SHARED_LIBRARIES := \
+    liblog \
+    libutils \
+    libcutils \
+    libgps.utils \
+    libloc_core
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/data-items \
+    $(LOCAL_PATH)/data-items/common \
+    $(LOCAL_PATH)/observer
+LOCAL_HEADER_LIBRARIES := \
+    libutils_headers \
+    libgps.utils_headers \
+    libloc_pla_headers \
+    liblocation_api_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     $(GNSS_CFLAGS)
+include $(BUILD_NATIVE_TEST)
+
+# replay cost per epoch and client, see test/LocApiReplayBench.cpp
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_api_replay_bench
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := test/LocApiReplayBench.cpp
+LOCAL_SHARED_LIBRARIES := \
+    liblog \
+    libutils \
+    libcutils \
+    libgps.utils \
+    libloc_core
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/data-items \
+    $(LOCAL_PATH)/data-items/common \
+    $(LOCAL_PATH)/observer
+LOCAL_HEADER_LIBRARIES := \
+    libutils_headers \
+    libgps.utils_headers \
+    libloc_pla_headers \
+    liblocation_api_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     $(GNSS_CFLAGS)
+include $(BUILD_EXECUTABLE)
+
+# report plumbing of the 2.0 HIDL clients, see test/GnssReportCopyBench.cpp
+ifeq ($(GNSS_HIDL_VERSION),2.0)
+include $(CLEAR_VARS)
+LOCAL_MODULE := gnss_report_copy_bench
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := \
+    test/GnssReportCopyBench.cpp \
+    ../android/2.0/location_api/GnssAPIClient.cpp \
+    ../android/2.0/location_api/MeasurementAPIClient.cpp \
+    ../android/2.0/location_api/LocationUtil.cpp
+LOCAL_SHARED_LIBRARIES := \
+    liblog \
+    libutils \
+    libcutils \
+    libhidlbase \
+    android.hardware.gnss@1.0 \
+    android.hardware.gnss@1.1 \
+    android.hardware.gnss@2.0 \
+    libgps.utils \
+    libloc_core \
+    liblocation_api
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/data-items \
+    $(LOCAL_PATH)/data-items/common \
+    $(LOCAL_PATH)/observer \
+    $(LOCAL_PATH)/../android/2.0 \
+    $(LOCAL_PATH)/../android/2.0/location_api
+LOCAL_HEADER_LIBRARIES := \
+    libutils_headers \
+    libgps.utils_headers \
+    libloc_pla_headers \
+    liblocation_api_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_ \
+     $(GNSS_CFLAGS)
+include $(BUILD_EXECUTABLE)
+endif # GNSS_HIDL_VERSION 2.0
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := libloc_core_headers
 LOCAL_EXPORT_C_INCLUDE_DIRS := \
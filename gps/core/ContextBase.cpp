@@ -33,6 +33,7 @@
 #include <cutils/sched_policy.h>
 #include <unistd.h>
 #include <ContextBase.h>
+#include <LocApiReplay.h>
 #include <msg_q.h>
 #include <loc_target.h>
 #include <loc_pla.h>
@@ -257,6 +258,23 @@ LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
     LocApiBase* locApi = NULL;
     const char* libname = LOC_APIV2_0_LIB_NAME;
 
+    // mGps_conf is not read yet when the first context is created
+    uint32_t recordMode = LOC_API_RECORD_OFF;
+    uint32_t replayMode = LOC_API_REPLAY_OFF;
+    char recFile[LOC_MAX_PARAM_STRING] = LOC_API_REC_FILE_PATH;
+    const loc_param_s_type rec_conf_param_table[] =
+    {
+        {"LOC_API_RECORD",   &recordMode, NULL, 'n'},
+        {"LOC_API_REPLAY",   &replayMode, NULL, 'n'},
+        {"LOC_API_REC_FILE", recFile,     NULL, 's'},
+    };
+    UTIL_READ_CONF(LOC_PATH_GPS_CONF, rec_conf_param_table);
+
+    // a replayed log stands in for the engine, no modem is needed
+    if (LOC_API_REPLAY_OFF != replayMode) {
+        return new LocApiReplay(exMask, this, recFile, replayMode);
+    }
+
     // Check the target
     if (TARGET_NO_GNSS != loc_get_target()){
 
@@ -299,6 +317,10 @@ LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
         locApi = new LocApiBase(exMask, this);
     }
 
+    if (LOC_API_RECORD_OFF != recordMode) {
+        LocApiRecorder::start(recFile);
+    }
+
     return locApi;
 }
 
@@ -312,6 +334,14 @@ ContextBase::ContextBase(const MsgTask* msgTask,
 {
 }
 
+ContextBase::ContextBase(const MsgTask* msgTask) :
+    mLBSProxy(new LBSProxyBase()),
+    mMsgTask(msgTask),
+    mLocApi(nullptr),
+    mLocApiProxy(nullptr)
+{
+}
+
 void ContextBase::setEngineCapabilities(uint64_t supportedMsgMask,
        uint8_t *featureList, bool gnssMeasurementSupported) {
 
@@ -123,6 +123,10 @@ protected:
     LocApiBase* mLocApi;
     LocApiProxyBase *mLocApiProxy;
 
+    // for contexts that create their own LocApi, e.g. a replay test: no
+    // LBS proxy library is loaded and mLocApi is left to the subclass
+    ContextBase(const MsgTask* msgTask);
+
 public:
     ContextBase(const MsgTask* msgTask,
                 LOC_API_ADAPTER_EVENT_MASK_T exMask,
@@ -34,6 +34,7 @@
 #include <gps_extended_c.h>
 #include <LocApiBase.h>
 #include <LocAdapterBase.h>
+#include <LocApiRecorder.h>
 #include <log_util.h>
 #include <LocContext.h>
 
@@ -341,6 +342,10 @@ void LocApiBase::reportPosition(UlpLocation& location,
              locationExtended.gnss_sv_used_ids.bds_sv_used_ids_mask,
              locationExtended.gnss_sv_used_ids.gal_sv_used_ids_mask,
              locationExtended.gnss_sv_used_ids.qzss_sv_used_ids_mask);
+    if (LocApiRecorder::isRecording()) {
+        LocApiRecorder::recordPosition(location, locationExtended, status,
+                                       loc_technology_mask, pDataNotify, msInWeek);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportPositionEvent(location, locationExtended,
@@ -429,6 +434,9 @@ void LocApiBase::reportSv(GnssSvNotification& svNotify)
             svNotify.gnssSvs[i].carrierFrequencyHz,
             svNotify.gnssSvs[i].gnssSvOptionsMask);
     }
+    if (LocApiRecorder::isRecording()) {
+        LocApiRecorder::recordSv(svNotify);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportSvEvent(svNotify)
@@ -459,12 +467,18 @@ void LocApiBase::reportStatus(LocGpsStatusValue status)
 
 void LocApiBase::reportData(GnssDataNotification& dataNotify, int msInWeek)
 {
+    if (LocApiRecorder::isRecording()) {
+        LocApiRecorder::recordData(dataNotify, msInWeek);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportDataEvent(dataNotify, msInWeek));
 }
 
 void LocApiBase::reportNmea(const char* nmea, int length)
 {
+    if (LocApiRecorder::isRecording()) {
+        LocApiRecorder::recordNmea(nmea, length);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportNmeaEvent(nmea, length));
 }
@@ -533,6 +547,9 @@ LocApiProxyBase* LocApiBase :: getLocApiProxy()
 
 void LocApiBase::reportGnssMeasurements(GnssMeasurements& gnssMeasurements, int msInWeek)
 {
+    if (LocApiRecorder::isRecording()) {
+        LocApiRecorder::recordMeasurements(gnssMeasurements, msInWeek);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportGnssMeasurementsEvent(gnssMeasurements, msInWeek));
 }
@@ -580,6 +597,9 @@ void LocApiBase::reportDBTPosition(UlpLocation &location, GpsLocationExtended &l
 
 void LocApiBase::reportLocations(Location* locations, size_t count, BatchingMode batchingMode)
 {
+    if (LocApiRecorder::isRecording()) {
+        LocApiRecorder::recordLocations(locations, count, batchingMode);
+    }
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportLocationsEvent(locations, count, batchingMode));
 }
 
@@ -0,0 +1,221 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_LocApiRecorder"
+
+#include <string.h>
+#include <time.h>
+#include <LocApiRecorder.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+#define LOC_API_REC_MAX_CHUNKS 4
+
+static const uint8_t sPadding[8] = { 0 };
+
+LocApiRecorder* volatile LocApiRecorder::sRecorder = nullptr;
+
+LocApiRecorder::LocApiRecorder(FILE* file) :
+    mFile(file), mFailed(false), mMutex(PTHREAD_MUTEX_INITIALIZER)
+{
+}
+
+void LocApiRecorder::fillFileHdr(LocApiRecFileHdr& hdr)
+{
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, LOC_API_REC_MAGIC, sizeof(hdr.magic));
+    hdr.version = LOC_API_REC_VERSION;
+    hdr.recHdrSize = sizeof(LocApiRecHdr);
+    hdr.ulpLocationSize = sizeof(UlpLocation);
+    hdr.locationExtendedSize = sizeof(GpsLocationExtended);
+    hdr.svNotificationSize = sizeof(GnssSvNotification);
+    hdr.measurementsSize = sizeof(GnssMeasurements);
+    hdr.dataNotificationSize = sizeof(GnssDataNotification);
+    hdr.locationSize = sizeof(Location);
+}
+
+uint64_t LocApiRecorder::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool LocApiRecorder::start(const char* path)
+{
+    if (nullptr != sRecorder) {
+        return true;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (nullptr == file) {
+        LOC_LOGe("failed to open %s", path);
+        return false;
+    }
+
+    LocApiRecFileHdr hdr;
+    fillFileHdr(hdr);
+    if (1 != fwrite(&hdr, sizeof(hdr), 1, file)) {
+        LOC_LOGe("failed to write header to %s", path);
+        fclose(file);
+        return false;
+    }
+
+    LOC_LOGi("recording LocApi reports to %s", path);
+    sRecorder = new LocApiRecorder(file);
+    return true;
+}
+
+void LocApiRecorder::write(LocApiRecType type, const void* const* data,
+                           const size_t* lens, int count, bool flush)
+{
+    LocApiRecHdr hdr;
+    size_t len = 0;
+
+    for (int i = 0; i < count; i++) {
+        len += lens[i];
+    }
+    hdr.type = type;
+    hdr.reserved = 0;
+    hdr.len = len;
+    hdr.tsNs = now();
+
+    pthread_mutex_lock(&mMutex);
+    if (mFailed) {
+        pthread_mutex_unlock(&mMutex);
+        return;
+    }
+    bool ok = (1 == fwrite(&hdr, sizeof(hdr), 1, mFile));
+    for (int i = 0; ok && i < count; i++) {
+        ok = (lens[i] == fwrite(data[i], 1, lens[i], mFile));
+    }
+    if (ok && 0 != (len & 7)) {
+        ok = (1 == fwrite(sPadding, 8 - (len & 7), 1, mFile));
+    }
+    // an epoch ends with its position report, push it out so that a
+    // crash loses at most the epoch in progress
+    if (ok && flush) {
+        ok = (0 == fflush(mFile));
+    }
+    if (!ok) {
+        // reporters may still hold this object, so it is only disabled
+        mFailed = true;
+        sRecorder = nullptr;
+        fclose(mFile);
+        mFile = nullptr;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    if (!ok) {
+        LOC_LOGe("write failed for record type %d, recording stopped", type);
+    }
+}
+
+void LocApiRecorder::recordPosition(const UlpLocation& location,
+                                    const GpsLocationExtended& locationExtended,
+                                    enum loc_sess_status status,
+                                    LocPosTechMask techMask,
+                                    const GnssDataNotification* pDataNotify,
+                                    int msInWeek)
+{
+    LocApiRecorder* recorder = sRecorder;
+    if (nullptr != recorder) {
+        LocApiRecPosition pos;
+        pos.status = status;
+        pos.techMask = techMask;
+        pos.msInWeek = msInWeek;
+        pos.hasDataNotify = (nullptr != pDataNotify);
+
+        const void* data[LOC_API_REC_MAX_CHUNKS] =
+            { &pos, &location, &locationExtended, pDataNotify };
+        size_t lens[LOC_API_REC_MAX_CHUNKS] =
+            { sizeof(pos), sizeof(location), sizeof(locationExtended),
+              sizeof(GnssDataNotification) };
+        recorder->write(LOC_API_REC_POSITION, data, lens,
+                        pos.hasDataNotify ? 4 : 3, true);
+    }
+}
+
+void LocApiRecorder::recordSv(const GnssSvNotification& svNotify)
+{
+    LocApiRecorder* recorder = sRecorder;
+    if (nullptr != recorder) {
+        const void* data[1] = { &svNotify };
+        size_t lens[1] = { sizeof(svNotify) };
+        recorder->write(LOC_API_REC_SV, data, lens, 1, false);
+    }
+}
+
+void LocApiRecorder::recordNmea(const char* nmea, int length)
+{
+    LocApiRecorder* recorder = sRecorder;
+    if (nullptr != recorder && nullptr != nmea && length > 0) {
+        const void* data[1] = { nmea };
+        size_t lens[1] = { (size_t)length };
+        recorder->write(LOC_API_REC_NMEA, data, lens, 1, false);
+    }
+}
+
+void LocApiRecorder::recordMeasurements(const GnssMeasurements& measurements,
+                                        int msInWeek)
+{
+    LocApiRecorder* recorder = sRecorder;
+    if (nullptr != recorder) {
+        LocApiRecWeek week = { msInWeek, 0 };
+        const void* data[2] = { &week, &measurements };
+        size_t lens[2] = { sizeof(week), sizeof(measurements) };
+        recorder->write(LOC_API_REC_MEASUREMENTS, data, lens, 2, false);
+    }
+}
+
+void LocApiRecorder::recordData(const GnssDataNotification& dataNotify, int msInWeek)
+{
+    LocApiRecorder* recorder = sRecorder;
+    if (nullptr != recorder) {
+        LocApiRecWeek week = { msInWeek, 0 };
+        const void* data[2] = { &week, &dataNotify };
+        size_t lens[2] = { sizeof(week), sizeof(dataNotify) };
+        recorder->write(LOC_API_REC_DATA, data, lens, 2, false);
+    }
+}
+
+void LocApiRecorder::recordLocations(const Location* locations, size_t count,
+                                     BatchingMode batchingMode)
+{
+    LocApiRecorder* recorder = sRecorder;
+    if (nullptr != recorder && (0 == count || nullptr != locations)) {
+        LocApiRecLocations hdr = { (uint32_t)batchingMode, (uint32_t)count };
+        const void* data[2] = { &hdr, locations };
+        size_t lens[2] = { sizeof(hdr), count * sizeof(Location) };
+        recorder->write(LOC_API_REC_LOCATIONS, data, lens, 2, true);
+    }
+}
+
+} // namespace loc_core
@@ -0,0 +1,148 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_API_RECORDER_H
+#define LOC_API_RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <gps_extended.h>
+#include <LocationAPI.h>
+
+namespace loc_core {
+
+/* gps.conf LOC_API_RECORD / LOC_API_REPLAY values */
+#define LOC_API_RECORD_OFF            0
+#define LOC_API_RECORD_ON             1
+#define LOC_API_REPLAY_OFF            0
+#define LOC_API_REPLAY_FAST           1
+#define LOC_API_REPLAY_REALTIME       2
+
+#define LOC_API_REC_FILE_PATH         "/data/vendor/location/loc_api_rec.bin"
+
+/* Record layout
+
+   A log is a LocApiRecFileHdr followed by records. Every record starts
+   with a LocApiRecHdr and is padded to 8 bytes. Payloads hold the report
+   arguments as raw structs, so the file header carries the size of each
+   struct and a log is only replayed by a build with identical sizes.
+
+   LOC_API_REC_POSITION      LocApiRecPosition, UlpLocation,
+                             GpsLocationExtended[, GnssDataNotification]
+   LOC_API_REC_SV            GnssSvNotification
+   LOC_API_REC_NMEA          the sentence bytes, no terminator
+   LOC_API_REC_MEASUREMENTS  LocApiRecWeek, GnssMeasurements
+   LOC_API_REC_DATA          LocApiRecWeek, GnssDataNotification
+   LOC_API_REC_LOCATIONS     LocApiRecLocations, Location[count] */
+#define LOC_API_REC_MAGIC             "LAPI"
+#define LOC_API_REC_VERSION           1
+
+typedef enum {
+    LOC_API_REC_POSITION = 1,
+    LOC_API_REC_SV,
+    LOC_API_REC_NMEA,
+    LOC_API_REC_MEASUREMENTS,
+    LOC_API_REC_DATA,
+    LOC_API_REC_LOCATIONS,
+    LOC_API_REC_MAX
+} LocApiRecType;
+
+typedef struct {
+    char     magic[4];
+    uint16_t version;
+    uint16_t recHdrSize;
+    uint32_t ulpLocationSize;
+    uint32_t locationExtendedSize;
+    uint32_t svNotificationSize;
+    uint32_t measurementsSize;
+    uint32_t dataNotificationSize;
+    uint32_t locationSize;
+} LocApiRecFileHdr;
+
+typedef struct {
+    uint16_t type;      /* LocApiRecType */
+    uint16_t reserved;
+    uint32_t len;       /* payload length, excluding header and padding */
+    uint64_t tsNs;      /* CLOCK_BOOTTIME when the report was made */
+} LocApiRecHdr;
+
+typedef struct {
+    int32_t  status;
+    uint32_t techMask;
+    int32_t  msInWeek;
+    uint32_t hasDataNotify;
+} LocApiRecPosition;
+
+typedef struct {
+    int32_t  msInWeek;
+    uint32_t reserved;
+} LocApiRecWeek;
+
+typedef struct {
+    uint32_t batchingMode;
+    uint32_t count;
+} LocApiRecLocations;
+
+/* Appends the upward reports of LocApiBase to a record log. The hooks in
+   LocApiBase only cost a load while recording is off. */
+class LocApiRecorder {
+    static LocApiRecorder* volatile sRecorder;
+    FILE* mFile;
+    bool mFailed;
+    pthread_mutex_t mMutex;
+
+    LocApiRecorder(FILE* file);
+    void write(LocApiRecType type, const void* const* data,
+               const size_t* lens, int count, bool flush);
+public:
+    // the recorder lives until the process exits
+    static bool start(const char* path);
+    static inline bool isRecording() { return nullptr != sRecorder; }
+
+    static void fillFileHdr(LocApiRecFileHdr& hdr);
+    static uint64_t now();
+
+    static void recordPosition(const UlpLocation& location,
+                               const GpsLocationExtended& locationExtended,
+                               enum loc_sess_status status,
+                               LocPosTechMask techMask,
+                               const GnssDataNotification* pDataNotify,
+                               int msInWeek);
+    static void recordSv(const GnssSvNotification& svNotify);
+    static void recordNmea(const char* nmea, int length);
+    static void recordMeasurements(const GnssMeasurements& measurements,
+                                   int msInWeek);
+    static void recordData(const GnssDataNotification& dataNotify, int msInWeek);
+    static void recordLocations(const Location* locations, size_t count,
+                                BatchingMode batchingMode);
+};
+
+} // namespace loc_core
+
+#endif //LOC_API_RECORDER_H
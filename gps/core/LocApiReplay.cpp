@@ -0,0 +1,462 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_LocApiReplay"
+
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <ContextBase.h>
+#include <LocApiReplay.h>
+#include <loc_pla.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+// longest sleep between two checks for close() in real time playback
+#define LOC_API_REPLAY_MAX_SLEEP_NS 100000000ULL
+
+static uint64_t processCpuNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class LocApiReplayRunnable : public LocRunnable {
+    LocApiBase& mLocApi;
+    FILE* mFile;
+    const uint32_t mMode;
+    std::vector<uint8_t> mPayload;
+    LocApiRecHdr mHdr;
+    bool mPending;
+    uint64_t mFirstTsNs;
+    uint64_t mStartNs;
+    uint64_t mStartCpuNs;
+    uint32_t mCounts[LOC_API_REC_MAX];
+    // reports are handed to the adapters by reference, decode into members
+    // so that the large structs are neither on the stack nor reallocated
+    UlpLocation mLocation;
+    GpsLocationExtended mLocationExtended;
+    GnssDataNotification mDataNotify;
+    GnssSvNotification mSvNotify;
+    GnssMeasurements mMeasurements;
+    std::vector<Location> mLocations;
+
+    bool readRecord();
+    bool dispatch();
+    void logStats();
+
+public:
+    LocApiReplayRunnable(LocApiBase& locApi, FILE* file, uint32_t mode);
+    virtual ~LocApiReplayRunnable();
+    virtual bool run();
+};
+
+LocApiReplayRunnable::LocApiReplayRunnable(LocApiBase& locApi, FILE* file,
+                                           uint32_t mode) :
+    mLocApi(locApi), mFile(file), mMode(mode), mPending(false),
+    mFirstTsNs(0), mStartNs(0), mStartCpuNs(0)
+{
+    memset(mCounts, 0, sizeof(mCounts));
+}
+
+LocApiReplayRunnable::~LocApiReplayRunnable()
+{
+    fclose(mFile);
+}
+
+bool LocApiReplayRunnable::readRecord()
+{
+    if (1 != fread(&mHdr, sizeof(mHdr), 1, mFile)) {
+        return false;
+    }
+    size_t padded = (mHdr.len + 7) & ~(size_t)7;
+    // one extra byte keeps NMEA sentences terminated
+    if (mPayload.size() < padded + 1) {
+        mPayload.resize(padded + 1);
+    }
+    if (padded > 0 && 1 != fread(mPayload.data(), padded, 1, mFile)) {
+        LOC_LOGe("truncated record of type %u", mHdr.type);
+        return false;
+    }
+    mPayload[mHdr.len] = 0;
+
+    if (0 == mStartNs) {
+        mFirstTsNs = mHdr.tsNs;
+        mStartNs = LocApiRecorder::now();
+        mStartCpuNs = processCpuNs();
+    }
+    return true;
+}
+
+bool LocApiReplayRunnable::dispatch()
+{
+    const uint8_t* p = mPayload.data();
+    size_t len = mHdr.len;
+
+    switch (mHdr.type) {
+    case LOC_API_REC_POSITION: {
+        LocApiRecPosition pos;
+        size_t base = sizeof(pos) + sizeof(mLocation) + sizeof(mLocationExtended);
+        if (len < sizeof(pos)) {
+            break;
+        }
+        memcpy(&pos, p, sizeof(pos));
+        if (len != base + (pos.hasDataNotify ? sizeof(mDataNotify) : 0)) {
+            break;
+        }
+        p += sizeof(pos);
+        memcpy(&mLocation, p, sizeof(mLocation));
+        p += sizeof(mLocation);
+        memcpy(&mLocationExtended, p, sizeof(mLocationExtended));
+        p += sizeof(mLocationExtended);
+        if (pos.hasDataNotify) {
+            memcpy(&mDataNotify, p, sizeof(mDataNotify));
+        }
+        mLocApi.reportPosition(mLocation, mLocationExtended,
+                               (enum loc_sess_status)pos.status,
+                               (LocPosTechMask)pos.techMask,
+                               pos.hasDataNotify ? &mDataNotify : nullptr,
+                               pos.msInWeek);
+        return true;
+    }
+    case LOC_API_REC_SV:
+        if (len != sizeof(mSvNotify)) {
+            break;
+        }
+        memcpy(&mSvNotify, p, sizeof(mSvNotify));
+        mLocApi.reportSv(mSvNotify);
+        return true;
+    case LOC_API_REC_NMEA:
+        mLocApi.reportNmea((const char*)p, (int)len);
+        return true;
+    case LOC_API_REC_MEASUREMENTS: {
+        LocApiRecWeek week;
+        if (len != sizeof(week) + sizeof(mMeasurements)) {
+            break;
+        }
+        memcpy(&week, p, sizeof(week));
+        memcpy(&mMeasurements, p + sizeof(week), sizeof(mMeasurements));
+        mLocApi.reportGnssMeasurements(mMeasurements, week.msInWeek);
+        return true;
+    }
+    case LOC_API_REC_DATA: {
+        LocApiRecWeek week;
+        if (len != sizeof(week) + sizeof(mDataNotify)) {
+            break;
+        }
+        memcpy(&week, p, sizeof(week));
+        memcpy(&mDataNotify, p + sizeof(week), sizeof(mDataNotify));
+        mLocApi.reportData(mDataNotify, week.msInWeek);
+        return true;
+    }
+    case LOC_API_REC_LOCATIONS: {
+        LocApiRecLocations hdr;
+        if (len < sizeof(hdr)) {
+            break;
+        }
+        memcpy(&hdr, p, sizeof(hdr));
+        if (len != sizeof(hdr) + hdr.count * sizeof(Location)) {
+            break;
+        }
+        mLocations.resize(hdr.count);
+        if (hdr.count > 0) {
+            memcpy(mLocations.data(), p + sizeof(hdr), hdr.count * sizeof(Location));
+        }
+        mLocApi.reportLocations(mLocations.data(), hdr.count,
+                                (BatchingMode)hdr.batchingMode);
+        return true;
+    }
+    default:
+        // written by a newer recorder, skip it
+        LOC_LOGw("unknown record type %u skipped", mHdr.type);
+        return true;
+    }
+
+    LOC_LOGe("bad length %u for record type %u", mHdr.len, mHdr.type);
+    return false;
+}
+
+void LocApiReplayRunnable::logStats()
+{
+    uint64_t elapsedNs = LocApiRecorder::now() - mStartNs;
+    uint64_t cpuNs = processCpuNs() - mStartCpuNs;
+    uint32_t epochs = mCounts[LOC_API_REC_POSITION];
+
+    LOC_LOGi("replay done in %" PRIu64 " ms: %u positions, %u sv, %u nmea, "
+             "%u measurements, %u data, %u batches, %" PRIu64 " us cpu per epoch",
+             elapsedNs / 1000000, epochs, mCounts[LOC_API_REC_SV],
+             mCounts[LOC_API_REC_NMEA], mCounts[LOC_API_REC_MEASUREMENTS],
+             mCounts[LOC_API_REC_DATA], mCounts[LOC_API_REC_LOCATIONS],
+             (epochs > 0) ? cpuNs / 1000 / epochs : 0);
+}
+
+bool LocApiReplayRunnable::run()
+{
+    if (!mPending) {
+        if (!readRecord()) {
+            logStats();
+            return false;
+        }
+        mPending = true;
+    }
+
+    if (LOC_API_REPLAY_REALTIME == mMode) {
+        uint64_t due = mStartNs + (mHdr.tsNs - mFirstTsNs);
+        uint64_t now = LocApiRecorder::now();
+        if (due > now) {
+            uint64_t waitNs = due - now;
+            if (waitNs > LOC_API_REPLAY_MAX_SLEEP_NS) {
+                waitNs = LOC_API_REPLAY_MAX_SLEEP_NS;
+            }
+            usleep(waitNs / 1000);
+            return true;
+        }
+    }
+
+    mPending = false;
+    if (!dispatch()) {
+        logStats();
+        return false;
+    }
+    if (mHdr.type < LOC_API_REC_MAX) {
+        mCounts[mHdr.type]++;
+    }
+    return true;
+}
+
+LocApiReplay::LocApiReplay(LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                           ContextBase* context, const char* path,
+                           uint32_t mode) :
+    LocApiBase(exMask, context), mMutex(PTHREAD_MUTEX_INITIALIZER), mMode(mode),
+    mNextGeofenceId(1)
+{
+    strlcpy(mPath, path, sizeof(mPath));
+}
+
+LocApiReplay::~LocApiReplay()
+{
+    close();
+}
+
+enum loc_api_adapter_err LocApiReplay::open(LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    pthread_mutex_lock(&mMutex);
+    mMask = mask;
+    if (mThread.isRunning()) {
+        // adapter set changed, playback goes on
+        pthread_mutex_unlock(&mMutex);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+
+    FILE* file = fopen(mPath, "rb");
+    if (nullptr == file) {
+        LOC_LOGe("failed to open %s", mPath);
+        pthread_mutex_unlock(&mMutex);
+        return LOC_API_ADAPTER_ERR_FAILURE;
+    }
+
+    LocApiRecFileHdr hdr, expected;
+    LocApiRecorder::fillFileHdr(expected);
+    if (1 != fread(&hdr, sizeof(hdr), 1, file) ||
+        0 != memcmp(&hdr, &expected, sizeof(hdr))) {
+        LOC_LOGe("%s is not a log of this build", mPath);
+        fclose(file);
+        pthread_mutex_unlock(&mMutex);
+        return LOC_API_ADAPTER_ERR_FAILURE;
+    }
+
+    LocApiReplayRunnable* runnable = new LocApiReplayRunnable(*this, file, mMode);
+    if (!mThread.start("LocApiReplay", runnable)) {
+        delete runnable;
+        pthread_mutex_unlock(&mMutex);
+        return LOC_API_ADAPTER_ERR_FAILURE;
+    }
+    pthread_mutex_unlock(&mMutex);
+    LOC_LOGi("replaying %s, %s", mPath,
+             (LOC_API_REPLAY_REALTIME == mMode) ? "real time" : "fast");
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiReplay::close()
+{
+    pthread_mutex_lock(&mMutex);
+    mThread.stop();
+    pthread_mutex_unlock(&mMutex);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+static void ack(LocApiResponse* adapterResponse)
+{
+    if (nullptr != adapterResponse) {
+        adapterResponse->returnToSender(LOCATION_ERROR_SUCCESS);
+    }
+}
+
+void LocApiReplay::startFix(const LocPosMode& /*fixCriteria*/,
+                            LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::stopFix(LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::deleteAidingData(const GnssAidingData& /*data*/,
+                                    LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::addGeofence(uint32_t /*clientId*/, const GeofenceOption& /*options*/,
+        const GeofenceInfo& /*info*/,
+        LocApiResponseData<LocApiGeofenceData>* adapterResponseData)
+{
+    if (nullptr != adapterResponseData) {
+        LocApiGeofenceData data;
+        data.hwId = mNextGeofenceId++;
+        adapterResponseData->returnToSender(LOCATION_ERROR_SUCCESS, data);
+    }
+}
+
+void LocApiReplay::removeGeofence(uint32_t /*hwId*/, uint32_t /*clientId*/,
+                                  LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::pauseGeofence(uint32_t /*hwId*/, uint32_t /*clientId*/,
+                                 LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::resumeGeofence(uint32_t /*hwId*/, uint32_t /*clientId*/,
+                                  LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::modifyGeofence(uint32_t /*hwId*/, uint32_t /*clientId*/,
+                                  const GeofenceOption& /*options*/,
+                                  LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::startTimeBasedTracking(const TrackingOptions& /*options*/,
+                                          LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::stopTimeBasedTracking(LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::startDistanceBasedTracking(uint32_t /*sessionId*/,
+                                              const LocationOptions& /*options*/,
+                                              LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::stopDistanceBasedTracking(uint32_t /*sessionId*/,
+                                             LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::startBatching(uint32_t /*sessionId*/, const LocationOptions& /*options*/,
+                                 uint32_t /*accuracy*/, uint32_t /*timeout*/,
+                                 LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::stopBatching(uint32_t /*sessionId*/, LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::startOutdoorTripBatching(uint32_t /*tripDistance*/, uint32_t /*tripTbf*/,
+                                            uint32_t /*timeout*/,
+                                            LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::reStartOutdoorTripBatching(uint32_t /*ongoingTripDistance*/,
+                                              uint32_t /*ongoingTripInterval*/,
+                                              uint32_t /*batchingTimeout*/,
+                                              LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::stopOutdoorTripBatching(bool /*deallocBatchBuffer*/,
+                                           LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::getBatchedLocations(size_t /*count*/, LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::getBatchedTripLocations(size_t /*count*/, uint32_t /*accumulatedDistance*/,
+                                           LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+void LocApiReplay::queryAccumulatedTripDistance(
+        LocApiResponseData<LocApiBatchData>* adapterResponseData)
+{
+    if (nullptr != adapterResponseData) {
+        LocApiBatchData data;
+        data.accumulatedDistance = 0;
+        data.numOfBatchedPositions = 0;
+        adapterResponseData->returnToSender(LOCATION_ERROR_SUCCESS, data);
+    }
+}
+
+void LocApiReplay::addToCallQueue(LocApiResponse* adapterResponse)
+{
+    ack(adapterResponse);
+}
+
+} // namespace loc_core
@@ -0,0 +1,377 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Per epoch cost of the report plumbing of the GNSS 2.0 HIDL clients.
+
+   Feeds synthetic epochs (an SV report, the NMEA batch that goes with it
+   and a measurement report) to the real GnssAPIClient and
+   MeasurementAPIClient of gps/android/2.0, which hand them to in-process
+   IGnssCallback and IGnssMeasurementCallback objects, and prints per
+   epoch:
+     - heap allocations and bytes allocated on the callback thread
+     - report bytes copied by value on the way to the client
+     - bytes converted for HIDL and received by the callback objects
+     - time spent
+   The legacy rows replay the plumbing the clients had before reports
+   were passed by reference, in this file: two by-value std::function
+   hops in front of the client, a hidl_vec allocated per SV and per
+   measurement report, and the std::stringstream split of onGnssNmeaCb.
+
+   Creating the clients creates a LocationAPI instance, and the
+   measurement callback starts a measurement session, as the HAL does.
+
+   usage: gnss_report_copy_bench [epochs] [svs] */
+
+#include <atomic>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <type_traits>
+#include <GnssAPIClient.h>
+#include <MeasurementAPIClient.h>
+
+using namespace android::hardware::gnss::V2_0::implementation;
+using ::android::sp;
+using ::android::hardware::hidl_bitfield;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
+using ::android::hardware::Return;
+using ::android::hardware::Void;
+namespace V1_0 = ::android::hardware::gnss::V1_0;
+namespace V1_1 = ::android::hardware::gnss::V1_1;
+namespace V2_0 = ::android::hardware::gnss::V2_0;
+
+// the callbacks must not copy the reports
+static_assert(std::is_same<gnssSvCallback,
+        std::function<void(const GnssSvNotification&)>>::value, "SV report by value");
+static_assert(std::is_same<gnssNmeaCallback,
+        std::function<void(const GnssNmeaNotification&)>>::value, "NMEA report by value");
+static_assert(std::is_same<gnssMeasurementsCallback,
+        std::function<void(const GnssMeasurementsNotification&)>>::value,
+        "measurement report by value");
+
+#define BENCH_LEGACY_HOPS 2
+
+/* Allocations of the thread that runs the epochs */
+static std::atomic<uint64_t> sAllocs(0);
+static std::atomic<uint64_t> sAllocBytes(0);
+static thread_local bool sCounting = false;
+
+static void* countedAlloc(size_t size)
+{
+    if (sCounting) {
+        sAllocs++;
+        sAllocBytes += size;
+    }
+    void* p = malloc(size ? size : 1);
+    if (nullptr == p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Receives the reports in process, counts what reaches it */
+class BenchGnssCallback : public V2_0::IGnssCallback {
+public:
+    uint64_t mBytes = 0;
+    uint32_t mSvs = 0;
+    uint32_t mSentences = 0;
+
+    Return<void> gnssSvStatusCb_2_0(const hidl_vec<V2_0::IGnssCallback::GnssSvInfo>& list) override {
+        mSvs += list.size();
+        mBytes += list.size() * sizeof(list[0]);
+        return Void();
+    }
+    Return<void> gnssNmeaCb(int64_t, const hidl_string& nmea) override {
+        mSentences++;
+        mBytes += nmea.size();
+        return Void();
+    }
+
+    Return<void> gnssLocationCb(const V1_0::GnssLocation&) override { return Void(); }
+    Return<void> gnssStatusCb(V1_0::IGnssCallback::GnssStatusValue) override { return Void(); }
+    Return<void> gnssSvStatusCb(const V1_0::IGnssCallback::GnssSvStatus&) override {
+        return Void();
+    }
+    Return<void> gnssSetCapabilitesCb(
+            hidl_bitfield<V1_0::IGnssCallback::Capabilities>) override { return Void(); }
+    Return<void> gnssAcquireWakelockCb() override { return Void(); }
+    Return<void> gnssReleaseWakelockCb() override { return Void(); }
+    Return<void> gnssRequestTimeCb() override { return Void(); }
+    Return<void> gnssSetSystemInfoCb(const V1_0::IGnssCallback::GnssSystemInfo&) override {
+        return Void();
+    }
+    Return<void> gnssNameCb(const hidl_string&) override { return Void(); }
+    Return<void> gnssRequestLocationCb(bool) override { return Void(); }
+    Return<void> gnssSetCapabilitiesCb_2_0(
+            hidl_bitfield<V2_0::IGnssCallback::Capabilities>) override { return Void(); }
+    Return<void> gnssLocationCb_2_0(const V2_0::GnssLocation&) override { return Void(); }
+    Return<void> gnssRequestLocationCb_2_0(bool, bool) override { return Void(); }
+};
+
+class BenchMeasurementCallback : public V2_0::IGnssMeasurementCallback {
+public:
+    uint64_t mBytes = 0;
+    uint32_t mMeasurements = 0;
+
+    Return<void> gnssMeasurementCb_2_0(
+            const V2_0::IGnssMeasurementCallback::GnssData& data) override {
+        mMeasurements += data.measurements.size();
+        mBytes += data.measurements.size() * sizeof(data.measurements[0]) +
+                sizeof(data.clock);
+        return Void();
+    }
+    Return<void> gnssMeasurementCb(const V1_1::IGnssMeasurementCallback::GnssData&) override {
+        return Void();
+    }
+    Return<void> GnssMeasurementCb(const V1_0::IGnssMeasurementCallback::GnssData&) override {
+        return Void();
+    }
+};
+
+/* Reports of one epoch with count SVs tracked */
+class Epoch {
+public:
+    GnssSvNotification mSv;
+    GnssMeasurementsNotification mMeas;
+    GnssNmeaNotification mNmea;
+    std::string mNmeaText;
+    uint32_t mSentences;
+
+    explicit Epoch(uint32_t count) : mSentences(0)
+    {
+        static const GnssSvType kTypes[] = {
+            GNSS_SV_TYPE_GPS, GNSS_SV_TYPE_GLONASS, GNSS_SV_TYPE_BEIDOU, GNSS_SV_TYPE_GALILEO
+        };
+        memset(&mSv, 0, sizeof(mSv));
+        mSv.size = sizeof(mSv);
+        mSv.count = count;
+        memset(&mMeas, 0, sizeof(mMeas));
+        mMeas.size = sizeof(mMeas);
+        mMeas.count = (count < GNSS_MEASUREMENTS_MAX) ? count : GNSS_MEASUREMENTS_MAX;
+        for (uint32_t i = 0; i < count; i++) {
+            GnssSv& sv = mSv.gnssSvs[i];
+            sv.size = sizeof(sv);
+            sv.svId = (uint16_t)(i % 32 + 1);
+            sv.type = kTypes[i % 4];
+            sv.cN0Dbhz = 20.0f + i % 25;
+            sv.elevation = (float)(i * 7 % 90);
+            sv.azimuth = (float)(i * 37 % 360);
+            sv.gnssSvOptionsMask = (GnssSvOptionsMask)(GNSS_SV_OPTIONS_HAS_EPHEMER_BIT |
+                    ((i % 2) ? GNSS_SV_OPTIONS_USED_IN_FIX_BIT : 0));
+            if (i < mMeas.count) {
+                GnssMeasurementsData& m = mMeas.measurements[i];
+                m.size = sizeof(m);
+                m.svId = sv.svId;
+                m.svType = sv.type;
+                m.carrierToNoiseDbHz = sv.cN0Dbhz;
+                m.receivedSvTimeNs = 123456789LL * (i + 1);
+            }
+        }
+        mMeas.clock.size = sizeof(mMeas.clock);
+        mMeas.clock.timeNs = 1000000000LL;
+
+        // GGA, RMC, one GSA per constellation and a GSV per 4 SVs
+        addSentence("$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76");
+        addSentence("$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43");
+        for (int i = 0; i < 4; i++) {
+            addSentence("$GNGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38,1*0A");
+        }
+        for (uint32_t i = 0; i < count; i += 4) {
+            addSentence("$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70");
+        }
+        memset(&mNmea, 0, sizeof(mNmea));
+        mNmea.size = sizeof(mNmea);
+        mNmea.timestamp = 1306315670000ULL;
+        mNmea.nmea = mNmeaText.c_str();
+        mNmea.length = mNmeaText.length();
+    }
+
+private:
+    void addSentence(const char* sentence)
+    {
+        mNmeaText += sentence;
+        mNmeaText += "\r\n";
+        mSentences++;
+    }
+};
+
+/* onGnssNmeaCb before the split moved onto the batch */
+static void legacyNmeaCb(const sp<V2_0::IGnssCallback>& cb, const GnssNmeaNotification& notif)
+{
+    const std::string s(notif.nmea);
+    std::stringstream ss(s);
+    std::string each;
+    while (std::getline(ss, each, '\n')) {
+        each += '\n';
+        hidl_string nmea;
+        nmea.setToExternal(each.c_str(), each.length());
+        cb->gnssNmeaCb(static_cast<V1_0::GnssUtcTime>(notif.timestamp), nmea);
+    }
+}
+
+typedef struct {
+    uint64_t allocs;
+    uint64_t allocBytes;
+    uint64_t byValueBytes;
+    uint64_t hidlBytes;
+    uint64_t ns;
+} BenchCost;
+
+/* Runs fn once to warm up, then epochs times with allocations counted.
+   hidlBytes is what the callback objects add to received meanwhile. */
+static BenchCost measure(uint32_t epochs, uint64_t byValueBytes, const uint64_t& received,
+        const std::function<void()>& fn)
+{
+    BenchCost cost;
+    fn();
+    uint64_t start = received;
+    sAllocs = 0;
+    sAllocBytes = 0;
+    sCounting = true;
+    uint64_t startNs = nowNs();
+    for (uint32_t i = 0; i < epochs; i++) {
+        fn();
+    }
+    cost.ns = nowNs() - startNs;
+    sCounting = false;
+    cost.allocs = sAllocs;
+    cost.allocBytes = sAllocBytes;
+    cost.byValueBytes = byValueBytes * epochs;
+    cost.hidlBytes = received - start;
+    return cost;
+}
+
+static void print(const char* name, const BenchCost& cost, uint32_t epochs)
+{
+    printf("%-20s %8.2f %12.1f %14.1f %12.1f %9.2f\n", name,
+            (double)cost.allocs / epochs, (double)cost.allocBytes / epochs,
+            (double)cost.byValueBytes / epochs, (double)cost.hidlBytes / epochs,
+            cost.ns / 1e3 / epochs);
+}
+
+int main(int argc, char* argv[])
+{
+    int epochs = (argc > 1) ? atoi(argv[1]) : 1000;
+    int svs = (argc > 2) ? atoi(argv[2]) : 64;
+    if (epochs <= 0 || svs <= 0 || svs > GNSS_SV_MAX) {
+        fprintf(stderr, "usage: %s [epochs] [svs <= %d]\n", argv[0], GNSS_SV_MAX);
+        return 2;
+    }
+
+    Epoch epoch((uint32_t)svs);
+    sp<BenchGnssCallback> gnssCb = new BenchGnssCallback();
+    sp<BenchMeasurementCallback> measCb = new BenchMeasurementCallback();
+    GnssAPIClient* gnssClient = new GnssAPIClient(sp<V2_0::IGnssCallback>(gnssCb));
+    MeasurementAPIClient* measClient = new MeasurementAPIClient();
+    V1_0::IGnssMeasurement::GnssMeasurementStatus status =
+            measClient->measurementSetCallback_2_0(measCb);
+    if (V1_0::IGnssMeasurement::GnssMeasurementStatus::SUCCESS != status) {
+        fprintf(stderr, "measurement session did not start\n");
+    }
+
+    printf("%d epochs, %d SVs, %u measurements, %u NMEA sentences of %u bytes\n",
+            epochs, svs, epoch.mMeas.count, epoch.mSentences, epoch.mNmea.length);
+    printf("%-20s %8s %12s %14s %12s %9s\n", "per epoch", "allocs", "alloc bytes",
+            "by-value bytes", "hidl bytes", "us");
+
+    // Legacy hops: LocationCallbacks and the client callback took the report by value
+    std::function<void(GnssSvNotification)> svClientHop =
+            [gnssClient](GnssSvNotification n) { gnssClient->onGnssSvCb(n); };
+    std::function<void(GnssSvNotification)> svHop =
+            [&svClientHop](GnssSvNotification n) { svClientHop(n); };
+    std::function<void(GnssMeasurementsNotification)> measClientHop =
+            [measClient](GnssMeasurementsNotification n) { measClient->onGnssMeasurementsCb(n); };
+    std::function<void(GnssMeasurementsNotification)> measHop =
+            [&measClientHop](GnssMeasurementsNotification n) { measClientHop(n); };
+    int rc = 0;
+
+    print("sv legacy", measure(epochs, BENCH_LEGACY_HOPS * sizeof(epoch.mSv), gnssCb->mBytes,
+            [&]() {
+                svHop(epoch.mSv);
+                // the 2.0 list was a hidl_vec allocated per report
+                hidl_vec<V2_0::IGnssCallback::GnssSvInfo> list;
+                list.resize(epoch.mSv.count);
+            }), epochs);
+    print("sv", measure(epochs, 0, gnssCb->mBytes,
+            [&]() { gnssClient->onGnssSvCb(epoch.mSv); }), epochs);
+
+    print("nmea legacy", measure(epochs, 0, gnssCb->mBytes,
+            [&]() { legacyNmeaCb(gnssCb, epoch.mNmea); }), epochs);
+    uint32_t sentences = gnssCb->mSentences;
+    print("nmea", measure(epochs, 0, gnssCb->mBytes,
+            [&]() { gnssClient->onGnssNmeaCb(epoch.mNmea); }), epochs);
+    if (gnssCb->mSentences - sentences != epoch.mSentences * (uint32_t)(epochs + 1)) {
+        fprintf(stderr, "FAIL: %u NMEA sentences sent, %u expected\n",
+                gnssCb->mSentences - sentences, epoch.mSentences * (epochs + 1));
+        rc = 1;
+    }
+
+    print("measurements legacy", measure(epochs, BENCH_LEGACY_HOPS * sizeof(epoch.mMeas),
+            measCb->mBytes, [&]() {
+                measHop(epoch.mMeas);
+                // the 1.1/2.0 lists were hidl_vecs allocated per report
+                hidl_vec<V2_0::IGnssMeasurementCallback::GnssMeasurement> list;
+                list.resize(epoch.mMeas.count);
+            }), epochs);
+    uint32_t measurements = measCb->mMeasurements;
+    print("measurements", measure(epochs, 0, measCb->mBytes,
+            [&]() { measClient->onGnssMeasurementsCb(epoch.mMeas); }), epochs);
+    if (measCb->mMeasurements - measurements != epoch.mMeas.count * (uint32_t)(epochs + 1)) {
+        fprintf(stderr, "FAIL: %u measurements received, %u expected\n",
+                measCb->mMeasurements - measurements, epoch.mMeas.count * (epochs + 1));
+        rc = 1;
+    }
+
+    measClient->measurementClose();
+    delete measClient;
+    delete gnssClient;
+    return rc;
+}
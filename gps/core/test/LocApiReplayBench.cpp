@@ -0,0 +1,446 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Cost of LocApiReplay and of the report fan out to the adapters.
+
+   A synthetic log is recorded in a child process, since a recorder lives
+   until its process exits. Every epoch is an SV report, its NMEA
+   sentences, a measurement report and a position; every tenth epoch also
+   carries a batch of locations. The log is replayed as fast as possible
+   into three clients, each handing its reports on to its own MsgTask
+   with a copy of the report, as the GNSS adapters do:
+     gnss      positions, SV reports, NMEA and measurements
+     tracking  positions
+     batching  batched locations
+   and printed are:
+     - the process CPU time per epoch
+     - operator new calls and bytes per epoch, of the replay itself and
+       of each client, for its copies of the reports and on its task
+     - the latency from the report reaching a client to its callback on
+       the client task, per client
+   The run fails if a client does not get every report it was sent.
+
+   usage: loc_api_replay_bench [epochs] [svs] */
+
+#include <algorithm>
+#include <atomic>
+#include <inttypes.h>
+#include <new>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <ContextBase.h>
+#include <LocAdapterBase.h>
+#include <LocApiRecorder.h>
+#include <LocApiReplay.h>
+#include <MsgTask.h>
+
+using namespace loc_core;
+
+#define BENCH_BATCH_EVERY 10
+#define BENCH_TIMEOUT_S 60
+#define BENCH_CLIENTS 3
+
+/* Allocations per bucket, 0 is everything but the clients */
+static std::atomic<uint64_t> sAllocs[BENCH_CLIENTS + 1];
+static std::atomic<uint64_t> sAllocBytes[BENCH_CLIENTS + 1];
+static std::atomic<bool> sCounting(false);
+static thread_local int sBucket = 0;
+
+static void* countedAlloc(size_t size)
+{
+    if (sCounting) {
+        sAllocs[sBucket]++;
+        sAllocBytes[sBucket] += size;
+    }
+    void* p = malloc(size ? size : 1);
+    if (nullptr == p) {
+        abort();
+    }
+    return p;
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static uint64_t processCpuNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Reports of one epoch with count SVs tracked */
+class Epoch {
+public:
+    UlpLocation mLocation;
+    GpsLocationExtended mLocationExtended;
+    GnssSvNotification mSv;
+    GnssMeasurements mMeas;
+    Location mBatch[BENCH_BATCH_EVERY];
+    std::vector<std::string> mNmea;
+
+    explicit Epoch(uint32_t count)
+    {
+        memset(&mLocation, 0, sizeof(mLocation));
+        mLocation.size = sizeof(mLocation);
+        mLocation.gpsLocation.flags = LOC_GPS_LOCATION_HAS_LAT_LONG |
+                                      LOC_GPS_LOCATION_HAS_ACCURACY;
+        mLocation.gpsLocation.latitude = 53.361336;
+        mLocation.gpsLocation.longitude = -6.505620;
+        mLocation.gpsLocation.accuracy = 3.5f;
+        memset(&mLocationExtended, 0, sizeof(mLocationExtended));
+        mLocationExtended.size = sizeof(mLocationExtended);
+
+        memset(&mSv, 0, sizeof(mSv));
+        mSv.size = sizeof(mSv);
+        mSv.count = count;
+        memset(&mMeas, 0, sizeof(mMeas));
+        mMeas.size = sizeof(mMeas);
+        GnssMeasurementsNotification& meas = mMeas.gnssMeasNotification;
+        meas.size = sizeof(meas);
+        meas.count = (count < GNSS_MEASUREMENTS_MAX) ? count : GNSS_MEASUREMENTS_MAX;
+        for (uint32_t i = 0; i < count; i++) {
+            GnssSv& sv = mSv.gnssSvs[i];
+            sv.size = sizeof(sv);
+            sv.svId = (uint16_t)(i % 32 + 1);
+            sv.type = GNSS_SV_TYPE_GPS;
+            sv.cN0Dbhz = 20.0f + i % 25;
+            if (i < meas.count) {
+                meas.measurements[i].size = sizeof(meas.measurements[i]);
+                meas.measurements[i].svId = sv.svId;
+                meas.measurements[i].carrierToNoiseDbHz = sv.cN0Dbhz;
+            }
+        }
+
+        memset(mBatch, 0, sizeof(mBatch));
+        for (int i = 0; i < BENCH_BATCH_EVERY; i++) {
+            mBatch[i].size = sizeof(Location);
+            mBatch[i].flags = LOCATION_HAS_LAT_LONG_BIT;
+            mBatch[i].latitude = 53.36 + i * 0.001;
+            mBatch[i].longitude = -6.50 - i * 0.001;
+        }
+
+        // GGA, RMC, one GSA per constellation and a GSV per 4 SVs
+        mNmea.push_back("$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76");
+        mNmea.push_back("$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43");
+        for (int i = 0; i < 4; i++) {
+            mNmea.push_back("$GNGSA,A,3,10,07,05,02,29,04,08,13,,,,,1.72,1.03,1.38,1*0A");
+        }
+        for (uint32_t i = 0; i < count; i += 4) {
+            mNmea.push_back(
+                    "$GPGSV,3,1,11,10,63,137,17,07,61,098,15,05,59,290,20,08,54,157,30*70");
+        }
+    }
+};
+
+static void recordLog(const char* path, const Epoch& e, uint32_t epochs)
+{
+    if (!LocApiRecorder::start(path)) {
+        _exit(1);
+    }
+    for (uint32_t i = 0; i < epochs; i++) {
+        LocApiRecorder::recordSv(e.mSv);
+        for (size_t j = 0; j < e.mNmea.size(); j++) {
+            LocApiRecorder::recordNmea(e.mNmea[j].c_str(), (int)e.mNmea[j].length());
+        }
+        LocApiRecorder::recordMeasurements(e.mMeas, (int)i);
+        LocApiRecorder::recordPosition(e.mLocation, e.mLocationExtended, LOC_SESS_SUCCESS,
+                                       LOC_POS_TECH_MASK_SATELLITE, nullptr, (int)i);
+        if (BENCH_BATCH_EVERY - 1 == i % BENCH_BATCH_EVERY) {
+            LocApiRecorder::recordLocations(e.mBatch, BENCH_BATCH_EVERY,
+                                            BATCHING_MODE_ROUTINE);
+        }
+    }
+    // positions flush the log, the child exits without running stdio cleanup
+    _exit(0);
+}
+
+// holds playback back until all clients are constructed
+class GatedReplay : public LocApiReplay {
+    sem_t mGate;
+protected:
+    virtual enum loc_api_adapter_err open(LOC_API_ADAPTER_EVENT_MASK_T mask) {
+        sem_wait(&mGate);
+        sem_post(&mGate);
+        return LocApiReplay::open(mask);
+    }
+public:
+    GatedReplay(ContextBase* context, const char* path) :
+        LocApiReplay(0, context, path, LOC_API_REPLAY_FAST) {
+        sem_init(&mGate, 0, 0);
+    }
+    virtual ~GatedReplay() { sem_destroy(&mGate); }
+    void release() { sem_post(&mGate); }
+};
+
+class BenchContext : public ContextBase {
+public:
+    GatedReplay* mReplay;
+    BenchContext(const char* path) :
+        ContextBase(new MsgTask("LocApiReplayBench", false)) {
+        mReplay = new GatedReplay(this, path);
+        mLocApi = mReplay;
+    }
+    virtual ~BenchContext() {
+        ((MsgTask*)mMsgTask)->destroy();
+    }
+};
+
+/* Takes the reports of its mask and calls back on its own task */
+class BenchClient : public LocAdapterBase {
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+    MsgTask* mTask;
+    const int mBucket;
+    uint32_t mReceived;
+    std::vector<uint32_t> mLatencyNs;
+
+    template <typename T>
+    struct CallbackMsg : public LocMsg {
+        BenchClient& mClient;
+        const uint64_t mSentNs;
+        const T mReport;
+        template <typename... Args>
+        CallbackMsg(BenchClient& client, Args&&... args) :
+            LocMsg(), mClient(client), mSentNs(LocApiRecorder::now()),
+            mReport(std::forward<Args>(args)...) {}
+        virtual void proc() const { mClient.callback(mSentNs); }
+    };
+    // the copy of the report and the message are the cost of the client
+    template <typename T, typename... Args>
+    void hop(Args&&... args) {
+        int bucket = sBucket;
+        sBucket = mBucket;
+        mTask->sendMsg(new CallbackMsg<T>(*this, std::forward<Args>(args)...));
+        sBucket = bucket;
+    }
+    void callback(uint64_t sentNs) {
+        uint64_t latencyNs = LocApiRecorder::now() - sentNs;
+        sBucket = mBucket;
+        pthread_mutex_lock(&mMutex);
+        if (mLatencyNs.size() < mLatencyNs.capacity()) {
+            mLatencyNs.push_back((uint32_t)std::min<uint64_t>(latencyNs, UINT32_MAX));
+        }
+        mReceived++;
+        pthread_cond_broadcast(&mCond);
+        pthread_mutex_unlock(&mMutex);
+    }
+
+public:
+    const char* const mName;
+
+    BenchClient(ContextBase* context, LOC_API_ADAPTER_EVENT_MASK_T mask,
+                const char* name, int bucket, uint32_t expected) :
+        LocAdapterBase(mask, context), mTask(new MsgTask(name, false)),
+        mBucket(bucket), mReceived(0), mName(name) {
+        pthread_mutex_init(&mMutex, nullptr);
+        pthread_cond_init(&mCond, nullptr);
+        // no allocation on the client task while counting
+        mLatencyNs.reserve(expected);
+    }
+    virtual ~BenchClient() {
+        mTask->destroy();
+        pthread_cond_destroy(&mCond);
+        pthread_mutex_destroy(&mMutex);
+    }
+
+    bool waitFor(uint32_t expected) {
+        struct timespec ts;
+        bool ok = true;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += BENCH_TIMEOUT_S;
+        pthread_mutex_lock(&mMutex);
+        while (ok && mReceived < expected) {
+            ok = (0 == pthread_cond_timedwait(&mCond, &mMutex, &ts));
+        }
+        pthread_mutex_unlock(&mMutex);
+        return ok;
+    }
+    uint32_t received() {
+        pthread_mutex_lock(&mMutex);
+        uint32_t received = mReceived;
+        pthread_mutex_unlock(&mMutex);
+        return received;
+    }
+    void printLatency() {
+        pthread_mutex_lock(&mMutex);
+        std::vector<uint32_t> ns(mLatencyNs);
+        pthread_mutex_unlock(&mMutex);
+        if (ns.empty()) {
+            return;
+        }
+        std::sort(ns.begin(), ns.end());
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ns.size(); i++) {
+            sum += ns[i];
+        }
+        printf("%-10s %9zu %10.1f %10.1f %10.1f %10.1f\n", mName, ns.size(),
+               sum / 1e3 / ns.size(), ns[ns.size() / 2] / 1e3,
+               ns[ns.size() * 99 / 100] / 1e3, ns.back() / 1e3);
+    }
+
+    using LocAdapterBase::reportPositionEvent;
+    virtual void reportPositionEvent(const UlpLocation& location,
+                                     const GpsLocationExtended& /*locationExtended*/,
+                                     enum loc_sess_status /*status*/,
+                                     LocPosTechMask /*loc_technology_mask*/,
+                                     GnssDataNotification* /*pDataNotify*/,
+                                     int /*msInWeek*/) {
+        if (checkMask(LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT)) {
+            hop<UlpLocation>(location);
+        }
+    }
+    virtual void reportSvEvent(const GnssSvNotification& svNotify, bool /*fromEngineHub*/) {
+        if (checkMask(LOC_API_ADAPTER_BIT_SATELLITE_REPORT)) {
+            hop<GnssSvNotification>(svNotify);
+        }
+    }
+    virtual void reportNmeaEvent(const char* nmea, size_t length) {
+        if (checkMask(LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT)) {
+            hop<std::string>(nmea, length);
+        }
+    }
+    virtual void reportGnssMeasurementsEvent(const GnssMeasurements& gnssMeasurements,
+                                             int /*msInWeek*/) {
+        if (checkMask(LOC_API_ADAPTER_BIT_GNSS_MEASUREMENT)) {
+            hop<GnssMeasurementsNotification>(
+                    gnssMeasurements.gnssMeasNotification);
+        }
+    }
+    virtual void reportLocationsEvent(const Location* locations, size_t count,
+                                      BatchingMode /*batchingMode*/) {
+        if (checkMask(LOC_API_ADAPTER_BIT_BATCH_FULL) && count > 0) {
+            hop<std::vector<Location>>(locations, locations + count);
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    int epochs = (argc > 1) ? atoi(argv[1]) : 1000;
+    int svs = (argc > 2) ? atoi(argv[2]) : 32;
+    if (epochs <= 0 || svs <= 0 || svs > GNSS_SV_MAX) {
+        fprintf(stderr, "usage: %s [epochs] [svs <= %d]\n", argv[0], GNSS_SV_MAX);
+        return 2;
+    }
+
+    Epoch* epoch = new Epoch((uint32_t)svs);
+    const char* tmp = getenv("TMPDIR");
+    std::string path = std::string(tmp ? tmp : "/data/local/tmp") +
+            "/loc_api_replay_bench.bin";
+    unlink(path.c_str());
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (0 == pid) {
+        recordLog(path.c_str(), *epoch, (uint32_t)epochs);
+    }
+    int status = -1;
+    if (pid != waitpid(pid, &status, 0) || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+        fprintf(stderr, "recording %s failed\n", path.c_str());
+        return 1;
+    }
+
+    uint32_t sentences = (uint32_t)epoch->mNmea.size();
+    uint32_t batches = (uint32_t)epochs / BENCH_BATCH_EVERY;
+    uint32_t expected[BENCH_CLIENTS] = {
+        (uint32_t)epochs * (3 + sentences), (uint32_t)epochs, batches
+    };
+    BenchContext* context = new BenchContext(path.c_str());
+    BenchClient* clients[BENCH_CLIENTS] = {
+        new BenchClient(context, LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                                 LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                                 LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+                                 LOC_API_ADAPTER_BIT_GNSS_MEASUREMENT,
+                        "gnss", 1, expected[0]),
+        new BenchClient(context, LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT,
+                        "tracking", 2, expected[1]),
+        new BenchClient(context, LOC_API_ADAPTER_BIT_BATCH_FULL,
+                        "batching", 3, expected[2]),
+    };
+
+    printf("%d epochs, %d SVs, %u NMEA sentences, a batch of %d every %d epochs\n",
+           epochs, svs, sentences, BENCH_BATCH_EVERY, BENCH_BATCH_EVERY);
+    sCounting = true;
+    uint64_t startNs = LocApiRecorder::now();
+    uint64_t startCpuNs = processCpuNs();
+    context->mReplay->release();
+    int rc = 0;
+    for (int i = 0; i < BENCH_CLIENTS; i++) {
+        if (!clients[i]->waitFor(expected[i])) {
+            fprintf(stderr, "FAIL: %s got %u reports, %u expected\n", clients[i]->mName,
+                    clients[i]->received(), expected[i]);
+            rc = 1;
+        }
+    }
+    uint64_t cpuNs = processCpuNs() - startCpuNs;
+    uint64_t elapsedNs = LocApiRecorder::now() - startNs;
+    sCounting = false;
+
+    printf("replay %" PRIu64 " ms, %.1f us cpu per epoch\n",
+           elapsedNs / 1000000, cpuNs / 1e3 / epochs);
+    printf("%-10s %9s %10s\n", "per epoch", "allocs", "bytes");
+    static const char* const kBuckets[BENCH_CLIENTS + 1] = {
+        "replay", "gnss", "tracking", "batching"
+    };
+    for (int i = 0; i <= BENCH_CLIENTS; i++) {
+        printf("%-10s %9.2f %10.1f\n", kBuckets[i],
+               (double)sAllocs[i] / epochs, (double)sAllocBytes[i] / epochs);
+    }
+    printf("%-10s %9s %10s %10s %10s %10s\n", "latency", "callbacks", "mean us",
+           "p50 us", "p99 us", "max us");
+    for (int i = 0; i < BENCH_CLIENTS; i++) {
+        clients[i]->printLatency();
+    }
+
+    for (int i = 0; i < BENCH_CLIENTS; i++) {
+        delete clients[i];
+    }
+    delete context;
+    delete epoch;
+    unlink(path.c_str());
+    return rc;
+}
@@ -0,0 +1,346 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Round trip of LocApiRecorder and LocApiReplay.
+
+   A fixture log is recorded in a child process, since a recorder lives
+   until its process exits, then replayed into a test adapter. The
+   reports must come out byte for byte as they went in: positions, SV
+   reports, batched locations and the NMEA sentences, in recorded order.
+   The downward requests of the adapters must all be acked. */
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <ContextBase.h>
+#include <LocAdapterBase.h>
+#include <LocApiRecorder.h>
+#include <LocApiReplay.h>
+
+using namespace loc_core;
+
+#define REPLAY_TEST_TIMEOUT_S 5
+
+static const char* const kNmea[] = {
+    "$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76",
+    "$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,0.02,31.66,280511,,,A*43",
+};
+
+typedef struct {
+    UlpLocation location;
+    GpsLocationExtended locationExtended;
+    GnssSvNotification svNotify;
+    Location batch[3];
+} ReplayFixture;
+
+static void makeFixture(ReplayFixture& f)
+{
+    memset(&f, 0, sizeof(f));
+    f.location.size = sizeof(f.location);
+    f.location.gpsLocation.flags = LOC_GPS_LOCATION_HAS_LAT_LONG |
+                                   LOC_GPS_LOCATION_HAS_ACCURACY;
+    f.location.gpsLocation.latitude = 53.361336;
+    f.location.gpsLocation.longitude = -6.505620;
+    f.location.gpsLocation.accuracy = 3.5f;
+    f.location.gpsLocation.timestamp = 1306575470000LL;
+    f.locationExtended.size = sizeof(f.locationExtended);
+    f.locationExtended.gnss_sv_used_ids.gps_sv_used_ids_mask = 0x1234;
+
+    f.svNotify.size = sizeof(f.svNotify);
+    f.svNotify.count = 2;
+    f.svNotify.gnssSvs[0].type = GNSS_SV_TYPE_GPS;
+    f.svNotify.gnssSvs[0].svId = 7;
+    f.svNotify.gnssSvs[0].cN0Dbhz = 41.0f;
+    f.svNotify.gnssSvs[1].type = GNSS_SV_TYPE_GLONASS;
+    f.svNotify.gnssSvs[1].svId = 68;
+    f.svNotify.gnssSvs[1].cN0Dbhz = 33.5f;
+
+    for (size_t i = 0; i < sizeof(f.batch) / sizeof(f.batch[0]); i++) {
+        f.batch[i].size = sizeof(Location);
+        f.batch[i].flags = LOCATION_HAS_LAT_LONG_BIT;
+        f.batch[i].timestamp = 1306575470000ULL + i * 1000;
+        f.batch[i].latitude = 53.36 + i * 0.001;
+        f.batch[i].longitude = -6.50 - i * 0.001;
+    }
+}
+
+// records the fixture in the order it is expected back
+static void recordFixture(const char* path)
+{
+    ReplayFixture f;
+    makeFixture(f);
+    if (!LocApiRecorder::start(path)) {
+        _exit(1);
+    }
+    LocApiRecorder::recordSv(f.svNotify);
+    for (size_t i = 0; i < sizeof(kNmea) / sizeof(kNmea[0]); i++) {
+        LocApiRecorder::recordNmea(kNmea[i], (int)strlen(kNmea[i]));
+    }
+    LocApiRecorder::recordPosition(f.location, f.locationExtended, LOC_SESS_SUCCESS,
+                                   LOC_POS_TECH_MASK_SATELLITE, nullptr, 1234);
+    // flushes the log, the child exits without running stdio cleanup
+    LocApiRecorder::recordLocations(f.batch, sizeof(f.batch) / sizeof(f.batch[0]),
+                                    BATCHING_MODE_ROUTINE);
+    _exit(0);
+}
+
+// holds playback back until the test adapter is fully constructed
+class GatedReplay : public LocApiReplay {
+    sem_t mGate;
+protected:
+    virtual enum loc_api_adapter_err open(LOC_API_ADAPTER_EVENT_MASK_T mask) {
+        sem_wait(&mGate);
+        sem_post(&mGate);
+        return LocApiReplay::open(mask);
+    }
+public:
+    GatedReplay(ContextBase* context, const char* path) :
+        LocApiReplay(0, context, path, LOC_API_REPLAY_FAST) {
+        sem_init(&mGate, 0, 0);
+    }
+    virtual ~GatedReplay() { sem_destroy(&mGate); }
+    void release() { sem_post(&mGate); }
+};
+
+class ReplayContext : public ContextBase {
+public:
+    GatedReplay* mReplay;
+    ReplayContext(const char* path) :
+        ContextBase(new MsgTask("LocApiReplayTest", false)) {
+        mReplay = new GatedReplay(this, path);
+        mLocApi = mReplay;
+    }
+    virtual ~ReplayContext() {
+        // acks are all in by now, the LocApi is destroyed on its own task
+        ((MsgTask*)mMsgTask)->destroy();
+    }
+};
+
+class ReplayAdapter : public LocAdapterBase {
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+public:
+    std::vector<std::string> mEvents;
+    std::vector<std::string> mNmea;
+    UlpLocation mLocation;
+    GpsLocationExtended mLocationExtended;
+    GnssSvNotification mSvNotify;
+    std::vector<Location> mBatch;
+    int mMsInWeek;
+    bool mEngineUp;
+    uint32_t mAcks;
+    std::vector<uint32_t> mGeofenceIds;
+
+    ReplayAdapter(ContextBase* context) :
+        LocAdapterBase(LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                       LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                       LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+                       LOC_API_ADAPTER_BIT_BATCH_FULL, context),
+        mMsInWeek(-1), mEngineUp(false), mAcks(0) {
+        pthread_mutex_init(&mMutex, nullptr);
+        pthread_cond_init(&mCond, nullptr);
+        memset(&mLocation, 0, sizeof(mLocation));
+        memset(&mLocationExtended, 0, sizeof(mLocationExtended));
+        memset(&mSvNotify, 0, sizeof(mSvNotify));
+    }
+    virtual ~ReplayAdapter() {
+        pthread_cond_destroy(&mCond);
+        pthread_mutex_destroy(&mMutex);
+    }
+
+    void event(const char* name) {
+        pthread_mutex_lock(&mMutex);
+        mEvents.push_back(name);
+        pthread_cond_broadcast(&mCond);
+        pthread_mutex_unlock(&mMutex);
+    }
+    // the engine up event comes from the LocApi task once open() is done
+    bool waitFor(size_t events, uint32_t acks) {
+        struct timespec ts;
+        bool ok = true;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += REPLAY_TEST_TIMEOUT_S;
+        pthread_mutex_lock(&mMutex);
+        while (ok && (!mEngineUp || mEvents.size() < events || mAcks < acks)) {
+            ok = (0 == pthread_cond_timedwait(&mCond, &mMutex, &ts));
+        }
+        pthread_mutex_unlock(&mMutex);
+        return ok;
+    }
+    std::function<void (LocationError err)> ackFn() {
+        return [this](LocationError err) {
+            pthread_mutex_lock(&mMutex);
+            if (LOCATION_ERROR_SUCCESS == err) {
+                mAcks++;
+            }
+            pthread_cond_broadcast(&mCond);
+            pthread_mutex_unlock(&mMutex);
+        };
+    }
+    void geofenceAdded(LocationError err, LocApiGeofenceData data) {
+        pthread_mutex_lock(&mMutex);
+        if (LOCATION_ERROR_SUCCESS == err) {
+            mAcks++;
+            mGeofenceIds.push_back(data.hwId);
+        }
+        pthread_cond_broadcast(&mCond);
+        pthread_mutex_unlock(&mMutex);
+    }
+
+    virtual void handleEngineUpEvent() {
+        pthread_mutex_lock(&mMutex);
+        mEngineUp = true;
+        pthread_cond_broadcast(&mCond);
+        pthread_mutex_unlock(&mMutex);
+    }
+
+    using LocAdapterBase::reportPositionEvent;
+    virtual void reportPositionEvent(const UlpLocation& location,
+                                     const GpsLocationExtended& locationExtended,
+                                     enum loc_sess_status /*status*/,
+                                     LocPosTechMask /*loc_technology_mask*/,
+                                     GnssDataNotification* /*pDataNotify*/,
+                                     int msInWeek) {
+        mLocation = location;
+        mLocationExtended = locationExtended;
+        mMsInWeek = msInWeek;
+        event("position");
+    }
+    virtual void reportSvEvent(const GnssSvNotification& svNotify, bool /*fromEngineHub*/) {
+        mSvNotify = svNotify;
+        event("sv");
+    }
+    virtual void reportNmeaEvent(const char* nmea, size_t length) {
+        mNmea.push_back(std::string(nmea, length));
+        event("nmea");
+    }
+    virtual void reportLocationsEvent(const Location* locations, size_t count,
+                                      BatchingMode /*batchingMode*/) {
+        mBatch.assign(locations, locations + count);
+        event("locations");
+    }
+};
+
+class LocApiReplayTest : public ::testing::Test {
+protected:
+    std::string mPath;
+    ReplayContext* mContext;
+    ReplayAdapter* mAdapter;
+
+    virtual void SetUp() {
+        mPath = ::testing::TempDir() + "loc_api_replay_test.bin";
+        unlink(mPath.c_str());
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (0 == pid) {
+            recordFixture(mPath.c_str());
+        }
+        int status = -1;
+        ASSERT_EQ(pid, waitpid(pid, &status, 0));
+        ASSERT_TRUE(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+
+        mContext = new ReplayContext(mPath.c_str());
+        mAdapter = new ReplayAdapter(mContext);
+        mContext->mReplay->release();
+    }
+    virtual void TearDown() {
+        // the replay thread and the LocApi task must be done with the adapter
+        EXPECT_TRUE(mAdapter->waitFor(5, 0));
+        delete mAdapter;
+        delete mContext;
+        unlink(mPath.c_str());
+    }
+};
+
+TEST_F(LocApiReplayTest, ReportsComeBackAsRecorded)
+{
+    ReplayFixture f;
+    makeFixture(f);
+
+    ASSERT_TRUE(mAdapter->waitFor(5, 0));
+    std::vector<std::string> order = { "sv", "nmea", "nmea", "position", "locations" };
+    EXPECT_EQ(order, mAdapter->mEvents);
+
+    EXPECT_EQ(0, memcmp(&f.svNotify, &mAdapter->mSvNotify, sizeof(f.svNotify)));
+    EXPECT_EQ(0, memcmp(&f.location, &mAdapter->mLocation, sizeof(f.location)));
+    EXPECT_EQ(0, memcmp(&f.locationExtended, &mAdapter->mLocationExtended,
+                        sizeof(f.locationExtended)));
+    EXPECT_EQ(1234, mAdapter->mMsInWeek);
+
+    // golden values, independent of the fixture struct layout
+    EXPECT_DOUBLE_EQ(53.361336, mAdapter->mLocation.gpsLocation.latitude);
+    EXPECT_DOUBLE_EQ(-6.505620, mAdapter->mLocation.gpsLocation.longitude);
+    ASSERT_EQ(2u, mAdapter->mNmea.size());
+    EXPECT_EQ(kNmea[0], mAdapter->mNmea[0]);
+    EXPECT_EQ(kNmea[1], mAdapter->mNmea[1]);
+
+    ASSERT_EQ(3u, mAdapter->mBatch.size());
+    EXPECT_EQ(0, memcmp(f.batch, mAdapter->mBatch.data(), sizeof(f.batch)));
+}
+
+TEST_F(LocApiReplayTest, RequestsAreAcked)
+{
+    LocApiBase* api = mContext->getLocApi();
+    ReplayAdapter* adapter = mAdapter;
+    ContextBase& ctx = *mContext;
+    TrackingOptions tracking;
+    LocationOptions options;
+    GeofenceOption geofenceOption;
+    GeofenceInfo geofenceInfo;
+    memset(&geofenceOption, 0, sizeof(geofenceOption));
+    memset(&geofenceInfo, 0, sizeof(geofenceInfo));
+
+    api->startTimeBasedTracking(tracking, new LocApiResponse(ctx, adapter->ackFn()));
+    api->stopTimeBasedTracking(new LocApiResponse(ctx, adapter->ackFn()));
+    api->startDistanceBasedTracking(1, options, new LocApiResponse(ctx, adapter->ackFn()));
+    api->stopDistanceBasedTracking(1, new LocApiResponse(ctx, adapter->ackFn()));
+    api->startBatching(2, options, 0, 0, new LocApiResponse(ctx, adapter->ackFn()));
+    api->getBatchedLocations(10, new LocApiResponse(ctx, adapter->ackFn()));
+    api->stopBatching(2, new LocApiResponse(ctx, adapter->ackFn()));
+    for (int i = 0; i < 2; i++) {
+        api->addGeofence(1, geofenceOption, geofenceInfo,
+                new LocApiResponseData<LocApiGeofenceData>(ctx,
+                [adapter](LocationError err, LocApiGeofenceData data) {
+                    adapter->geofenceAdded(err, data);
+                }));
+    }
+    api->pauseGeofence(1, 1, new LocApiResponse(ctx, adapter->ackFn()));
+    api->resumeGeofence(1, 1, new LocApiResponse(ctx, adapter->ackFn()));
+    api->removeGeofence(1, 1, new LocApiResponse(ctx, adapter->ackFn()));
+    api->addToCallQueue(new LocApiResponse(ctx, adapter->ackFn()));
+
+    ASSERT_TRUE(adapter->waitFor(0, 13));
+    ASSERT_EQ(2u, adapter->mGeofenceIds.size());
+    EXPECT_NE(adapter->mGeofenceIds[0], adapter->mGeofenceIds[1]);
+}
@@ -40,5 +40,106 @@ LOCAL_MODULE := liblocation_api_headers
 LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
 include $(BUILD_HEADER_LIBRARY)
 
+# stub plugins of the load test and bench, see test/LocationPluginStub.h
+include $(CLEAR_VARS)
+LOCAL_MODULE := liblocation_api_stub_gnss
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := test/LocationPluginStub.cpp
+LOCAL_HEADER_LIBRARIES := \
+    libloc_pla_headers \
+    libgps.utils_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -DLOCATION_STUB_GNSS \
+     $(GNSS_CFLAGS)
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := liblocation_api_stub_batching
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := test/LocationPluginStub.cpp
+LOCAL_HEADER_LIBRARIES := \
+    libloc_pla_headers \
+    libgps.utils_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -DLOCATION_STUB_BATCHING \
+     $(GNSS_CFLAGS)
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := liblocation_api_stub_geofence
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := test/LocationPluginStub.cpp
+LOCAL_HEADER_LIBRARIES := \
+    libloc_pla_headers \
+    libgps.utils_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -DLOCATION_STUB_GEOFENCE \
+     $(GNSS_CFLAGS)
+include $(BUILD_SHARED_LIBRARY)
+
+LOCATION_API_STUB_MODULES := \
+    liblocation_api_stub_gnss \
+    liblocation_api_stub_batching \
+    liblocation_api_stub_geofence
+
+# LocationAPI.cpp built against the stub plugins
+LOCATION_API_STUB_CFLAGS := \
+    -DLOCATION_GNSS_LIBRARY=\"liblocation_api_stub_gnss.so\" \
+    -DLOCATION_BATCHING_LIBRARY=\"liblocation_api_stub_batching.so\" \
+    -DLOCATION_GEOFENCE_LIBRARY=\"liblocation_api_stub_geofence.so\"
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := location_api_load_test
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := \
+    test/LocationAPILoadTest.cpp \
+    LocationAPI.cpp
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libgps.utils \
+    libdl \
+    liblog
+LOCAL_REQUIRED_MODULES := $(LOCATION_API_STUB_MODULES)
+LOCAL_HEADER_LIBRARIES := \
+    libloc_pla_headers \
+    libgps.utils_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     $(LOCATION_API_STUB_CFLAGS) \
+     $(GNSS_CFLAGS)
+include $(BUILD_NATIVE_TEST)
+
+# startup cost of the plugin loads, see test/LocationAPILoadBench.cpp
+include $(CLEAR_VARS)
+LOCAL_MODULE := location_api_load_bench
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := \
+    test/LocationAPILoadBench.cpp \
+    LocationAPI.cpp
+LOCAL_SHARED_LIBRARIES := \
+    libutils \
+    libcutils \
+    libgps.utils \
+    libdl \
+    liblog
+LOCAL_REQUIRED_MODULES := $(LOCATION_API_STUB_MODULES)
+LOCAL_HEADER_LIBRARIES := \
+    libloc_pla_headers \
+    libgps.utils_headers
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     $(LOCATION_API_STUB_CFLAGS) \
+     $(GNSS_CFLAGS)
+include $(BUILD_EXECUTABLE)
+
 endif # not BUILD_TINY_ANDROID
 endif # BOARD_VENDOR_QCOM_GPS_LOC_API_HARDWARE
@@ -34,8 +34,20 @@
 #include <log_util.h>
 #include <pthread.h>
 #include <map>
+#include <set>
 #include <loc_misc_utils.h>
 
+// plugin libraries, the tests build this file with stub plugins instead
+#ifndef LOCATION_GNSS_LIBRARY
+#define LOCATION_GNSS_LIBRARY "libgnss.so"
+#endif
+#ifndef LOCATION_BATCHING_LIBRARY
+#define LOCATION_BATCHING_LIBRARY "libbatching.so"
+#endif
+#ifndef LOCATION_GEOFENCE_LIBRARY
+#define LOCATION_GEOFENCE_LIBRARY "libgeofencing.so"
+#endif
+
 typedef const GnssInterface* (getGnssInterface)();
 typedef const GeofenceInterface* (getGeofenceInterface)();
 typedef const BatchingInterface* (getBatchingInterface)();
@@ -56,6 +68,8 @@ typedef std::map<LocationAPI*, LocationCallbacks> LocationClientMap;
 typedef struct {
     LocationClientMap clientData;
     LocationClientDestroyCbMap destroyClientData;
+    // clients still waiting for their capabilities request, see requestCapabilities()
+    std::set<LocationAPI*> capabilitiesPending;
     LocationControlAPI* controlAPI;
     LocationControlCallbacks controlCallbacks;
     GnssInterface* gnssInterface;
@@ -63,11 +77,40 @@ typedef struct {
     BatchingInterface* batchingInterface;
 } LocationAPIData;
 
+typedef enum {
+    LOCATION_INTERFACE_IDLE = 0,
+    LOCATION_INTERFACE_LOADING,
+    LOCATION_INTERFACE_LOADED,
+    LOCATION_INTERFACE_FAILED
+} LocationInterfaceLoadState;
+
+// The plugin libraries are dlopen'ed and initialized on their own thread each,
+// all three kicked off on first use. Only the state change is done under
+// gDataMutex, so client creation never waits for a library that it does not
+// need, and never for one that is still loading: clients registered meanwhile
+// are added by the loader thread once the interface is ready.
+typedef struct {
+    const char* name;
+    const char* library;
+    const char* getter;
+    LocationInterfaceLoadState state;   // protected by gDataMutex
+    pthread_cond_t loadCond;            // signaled once state leaves LOADING
+} LocationInterfaceLoader;
+
 static LocationAPIData gData = {};
 static pthread_mutex_t gDataMutex = PTHREAD_MUTEX_INITIALIZER;
-static bool gGnssLoadFailed = false;
-static bool gBatchingLoadFailed = false;
-static bool gGeofenceLoadFailed = false;
+static pthread_once_t gLoadOnce = PTHREAD_ONCE_INIT;
+static LocationInterfaceLoader gGnssLoader = {
+    "gnss", LOCATION_GNSS_LIBRARY, "getGnssInterface",
+    LOCATION_INTERFACE_IDLE, PTHREAD_COND_INITIALIZER };
+static LocationInterfaceLoader gBatchingLoader = {
+    "batching", LOCATION_BATCHING_LIBRARY, "getBatchingInterface",
+    LOCATION_INTERFACE_IDLE, PTHREAD_COND_INITIALIZER };
+static LocationInterfaceLoader gGeofenceLoader = {
+    "geofence", LOCATION_GEOFENCE_LIBRARY, "getGeofenceInterface",
+    LOCATION_INTERFACE_IDLE, PTHREAD_COND_INITIALIZER };
+
+static void replayClients(LocationAdapterTypeMask adapterType);
 
 template <typename T1, typename T2>
 static const T1* loadLocationInterface(const char* library, const char* name) {
@@ -80,6 +123,79 @@ static const T1* loadLocationInterface(const char* library, const char* name) {
     }
 }
 
+// runs on the loader thread, gDataMutex is only taken to publish the result
+template <typename T1, typename T2>
+static void loadInterface(LocationInterfaceLoader& loader, T1*& locationInterface,
+                          LocationAdapterTypeMask adapterType) {
+    T1* loaded = (T1*)loadLocationInterface<T1, T2>(loader.library, loader.getter);
+    if (NULL == loaded) {
+        LOC_LOGW("%s:%d]: No %s interface available", __func__, __LINE__, loader.name);
+    } else {
+        loaded->initialize();
+    }
+
+    pthread_mutex_lock(&gDataMutex);
+    locationInterface = loaded;
+    loader.state = (NULL != loaded) ? LOCATION_INTERFACE_LOADED : LOCATION_INTERFACE_FAILED;
+    replayClients(adapterType);
+    pthread_cond_broadcast(&loader.loadCond);
+    pthread_mutex_unlock(&gDataMutex);
+}
+
+static void* gnssLoadRoutine(void* /*arg*/) {
+    loadInterface<GnssInterface, getGnssInterface>(
+            gGnssLoader, gData.gnssInterface, LOCATION_ADAPTER_GNSS_TYPE_BIT);
+    return NULL;
+}
+
+static void* batchingLoadRoutine(void* /*arg*/) {
+    loadInterface<BatchingInterface, getBatchingInterface>(
+            gBatchingLoader, gData.batchingInterface, LOCATION_ADAPTER_BATCHING_TYPE_BIT);
+    return NULL;
+}
+
+static void* geofenceLoadRoutine(void* /*arg*/) {
+    loadInterface<GeofenceInterface, getGeofenceInterface>(
+            gGeofenceLoader, gData.geofenceInterface, LOCATION_ADAPTER_GEOFENCE_TYPE_BIT);
+    return NULL;
+}
+
+static void launchInterfaceLoads() {
+    LocationInterfaceLoader* loaders[] = { &gGnssLoader, &gBatchingLoader, &gGeofenceLoader };
+    void* (*routines[])(void*) = { gnssLoadRoutine, batchingLoadRoutine, geofenceLoadRoutine };
+    pthread_attr_t attr;
+
+    pthread_mutex_lock(&gDataMutex);
+    for (size_t i = 0; i < sizeof(loaders) / sizeof(loaders[0]); i++) {
+        loaders[i]->state = LOCATION_INTERFACE_LOADING;
+    }
+    pthread_mutex_unlock(&gDataMutex);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (size_t i = 0; i < sizeof(loaders) / sizeof(loaders[0]); i++) {
+        pthread_t thread;
+        if (0 != pthread_create(&thread, &attr, routines[i], NULL)) {
+            LOC_LOGW("%s:%d]: failed to start %s loader, loading inline",
+                     __func__, __LINE__, loaders[i]->name);
+            (routines[i])(NULL);
+        }
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// must be called without gDataMutex held
+static inline void startInterfaceLoads() {
+    pthread_once(&gLoadOnce, launchInterfaceLoads);
+}
+
+// called with gDataMutex held, returns once the load of the interface settled
+static void waitForInterface(LocationInterfaceLoader& loader) {
+    while (LOCATION_INTERFACE_LOADING == loader.state) {
+        pthread_cond_wait(&loader.loadCond, &gDataMutex);
+    }
+}
+
 static bool isGnssClient(LocationCallbacks& locationCallbacks)
 {
     return (locationCallbacks.gnssNiCb != nullptr ||
@@ -100,6 +216,72 @@ static bool isGeofenceClient(LocationCallbacks& locationCallbacks)
             locationCallbacks.geofenceStatusCb != nullptr);
 }
 
+// Called with gDataMutex held. Adds the client to the loaded interfaces of adapterType
+// it uses; the ones still loading add it from replayClients() later.
+static void addClient(LocationAPI* client, LocationCallbacks& locationCallbacks,
+                      LocationAdapterTypeMask adapterType)
+{
+    if ((adapterType & LOCATION_ADAPTER_GNSS_TYPE_BIT) &&
+        isGnssClient(locationCallbacks) && NULL != gData.gnssInterface) {
+        // either adds new Client or updates existing Client
+        gData.gnssInterface->addClient(client, locationCallbacks);
+    }
+    if ((adapterType & LOCATION_ADAPTER_BATCHING_TYPE_BIT) &&
+        isBatchingClient(locationCallbacks) && NULL != gData.batchingInterface) {
+        gData.batchingInterface->addClient(client, locationCallbacks);
+    }
+    if ((adapterType & LOCATION_ADAPTER_GEOFENCE_TYPE_BIT) &&
+        isGeofenceClient(locationCallbacks) && NULL != gData.geofenceInterface) {
+        gData.geofenceInterface->addClient(client, locationCallbacks);
+    }
+}
+
+// Called with gDataMutex held. Capabilities are requested from the first interface
+// of the client, in gnss, batching, geofence order, that did not fail to load. If
+// that one is still loading, the request is left pending for replayClients().
+static void requestCapabilities(LocationAPI* client, LocationCallbacks& locationCallbacks)
+{
+    struct {
+        bool used;
+        LocationInterfaceLoader& loader;
+    } order[] = {
+        { isGnssClient(locationCallbacks), gGnssLoader },
+        { isBatchingClient(locationCallbacks), gBatchingLoader },
+        { isGeofenceClient(locationCallbacks), gGeofenceLoader }
+    };
+
+    for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+        if (!order[i].used || LOCATION_INTERFACE_FAILED == order[i].loader.state) {
+            continue;
+        }
+        if (LOCATION_INTERFACE_LOADED != order[i].loader.state) {
+            gData.capabilitiesPending.insert(client);
+            return;
+        }
+        if (&gGnssLoader == &order[i].loader) {
+            gData.gnssInterface->requestCapabilities(client);
+        } else if (&gBatchingLoader == &order[i].loader) {
+            gData.batchingInterface->requestCapabilities(client);
+        } else {
+            gData.geofenceInterface->requestCapabilities(client);
+        }
+        break;
+    }
+    gData.capabilitiesPending.erase(client);
+}
+
+// Called with gDataMutex held by the loader thread of adapterType, right after it
+// published its interface, loaded or not.
+static void replayClients(LocationAdapterTypeMask adapterType)
+{
+    for (auto it = gData.clientData.begin(); it != gData.clientData.end(); ++it) {
+        addClient(it->first, it->second, adapterType);
+        if (gData.capabilitiesPending.find(it->first) != gData.capabilitiesPending.end()) {
+            requestCapabilities(it->first, it->second);
+        }
+    }
+}
+
 
 void LocationAPI::onRemoveClientCompleteCb (LocationAdapterTypeMask adapterType)
 {
@@ -152,74 +334,15 @@ LocationAPI::createInstance(LocationCallbacks& locationCallbacks)
     }
 
     LocationAPI* newLocationAPI = new LocationAPI();
-    bool requestedCapabilities = false;
 
+    startInterfaceLoads();
     pthread_mutex_lock(&gDataMutex);
 
-    if (isGnssClient(locationCallbacks)) {
-        if (NULL == gData.gnssInterface && !gGnssLoadFailed) {
-            gData.gnssInterface =
-                (GnssInterface*)loadLocationInterface<GnssInterface,
-                    getGnssInterface>("libgnss.so", "getGnssInterface");
-            if (NULL == gData.gnssInterface) {
-                gGnssLoadFailed = true;
-                LOC_LOGW("%s:%d]: No gnss interface available", __func__, __LINE__);
-            } else {
-                gData.gnssInterface->initialize();
-            }
-        }
-        if (NULL != gData.gnssInterface) {
-            gData.gnssInterface->addClient(newLocationAPI, locationCallbacks);
-            if (!requestedCapabilities) {
-                gData.gnssInterface->requestCapabilities(newLocationAPI);
-                requestedCapabilities = true;
-            }
-        }
-    }
-
-    if (isBatchingClient(locationCallbacks)) {
-        if (NULL == gData.batchingInterface && !gBatchingLoadFailed) {
-            gData.batchingInterface =
-                (BatchingInterface*)loadLocationInterface<BatchingInterface,
-                 getBatchingInterface>("libbatching.so", "getBatchingInterface");
-            if (NULL == gData.batchingInterface) {
-                gBatchingLoadFailed = true;
-                LOC_LOGW("%s:%d]: No batching interface available", __func__, __LINE__);
-            } else {
-                gData.batchingInterface->initialize();
-            }
-        }
-        if (NULL != gData.batchingInterface) {
-            gData.batchingInterface->addClient(newLocationAPI, locationCallbacks);
-            if (!requestedCapabilities) {
-                gData.batchingInterface->requestCapabilities(newLocationAPI);
-                requestedCapabilities = true;
-            }
-        }
-    }
-
-    if (isGeofenceClient(locationCallbacks)) {
-        if (NULL == gData.geofenceInterface && !gGeofenceLoadFailed) {
-            gData.geofenceInterface =
-               (GeofenceInterface*)loadLocationInterface<GeofenceInterface,
-               getGeofenceInterface>("libgeofencing.so", "getGeofenceInterface");
-            if (NULL == gData.geofenceInterface) {
-                gGeofenceLoadFailed = true;
-                LOC_LOGW("%s:%d]: No geofence interface available", __func__, __LINE__);
-            } else {
-                gData.geofenceInterface->initialize();
-            }
-        }
-        if (NULL != gData.geofenceInterface) {
-            gData.geofenceInterface->addClient(newLocationAPI, locationCallbacks);
-            if (!requestedCapabilities) {
-                gData.geofenceInterface->requestCapabilities(newLocationAPI);
-                requestedCapabilities = true;
-            }
-        }
-    }
-
     gData.clientData[newLocationAPI] = locationCallbacks;
+    addClient(newLocationAPI, gData.clientData[newLocationAPI],
+              LOCATION_ADAPTER_GNSS_TYPE_BIT | LOCATION_ADAPTER_BATCHING_TYPE_BIT |
+              LOCATION_ADAPTER_GEOFENCE_TYPE_BIT);
+    requestCapabilities(newLocationAPI, gData.clientData[newLocationAPI]);
 
     pthread_mutex_unlock(&gDataMutex);
 
@@ -275,6 +398,7 @@ LocationAPI::destroy(locationApiDestroyCompleteCallback destroyCompleteCb)
         }
 
         gData.clientData.erase(it);
+        gData.capabilitiesPending.erase(this);
 
         if ((NULL != destroyCompleteCb) && (false == needToWait)) {
             invokeDestroyCb = true;
@@ -311,63 +435,13 @@ LocationAPI::updateCallbacks(LocationCallbacks& locationCallbacks)
         return;
     }
 
+    startInterfaceLoads();
     pthread_mutex_lock(&gDataMutex);
 
-    if (isGnssClient(locationCallbacks)) {
-        if (NULL == gData.gnssInterface && !gGnssLoadFailed) {
-            gData.gnssInterface =
-                (GnssInterface*)loadLocationInterface<GnssInterface,
-                    getGnssInterface>("libgnss.so", "getGnssInterface");
-            if (NULL == gData.gnssInterface) {
-                gGnssLoadFailed = true;
-                LOC_LOGW("%s:%d]: No gnss interface available", __func__, __LINE__);
-            } else {
-                gData.gnssInterface->initialize();
-            }
-        }
-        if (NULL != gData.gnssInterface) {
-            // either adds new Client or updates existing Client
-            gData.gnssInterface->addClient(this, locationCallbacks);
-        }
-    }
-
-    if (isBatchingClient(locationCallbacks)) {
-        if (NULL == gData.batchingInterface && !gBatchingLoadFailed) {
-            gData.batchingInterface =
-                (BatchingInterface*)loadLocationInterface<BatchingInterface,
-                 getBatchingInterface>("libbatching.so", "getBatchingInterface");
-            if (NULL == gData.batchingInterface) {
-                gBatchingLoadFailed = true;
-                LOC_LOGW("%s:%d]: No batching interface available", __func__, __LINE__);
-            } else {
-                gData.batchingInterface->initialize();
-            }
-        }
-        if (NULL != gData.batchingInterface) {
-            // either adds new Client or updates existing Client
-            gData.batchingInterface->addClient(this, locationCallbacks);
-        }
-    }
-
-    if (isGeofenceClient(locationCallbacks)) {
-        if (NULL == gData.geofenceInterface && !gGeofenceLoadFailed) {
-            gData.geofenceInterface =
-                (GeofenceInterface*)loadLocationInterface<GeofenceInterface,
-                 getGeofenceInterface>("libgeofencing.so", "getGeofenceInterface");
-            if (NULL == gData.geofenceInterface) {
-                gGeofenceLoadFailed = true;
-                LOC_LOGW("%s:%d]: No geofence interface available", __func__, __LINE__);
-            } else {
-                gData.geofenceInterface->initialize();
-            }
-        }
-        if (NULL != gData.geofenceInterface) {
-            // either adds new Client or updates existing Client
-            gData.geofenceInterface->addClient(this, locationCallbacks);
-        }
-    }
-
     gData.clientData[this] = locationCallbacks;
+    addClient(this, gData.clientData[this],
+              LOCATION_ADAPTER_GNSS_TYPE_BIT | LOCATION_ADAPTER_BATCHING_TYPE_BIT |
+              LOCATION_ADAPTER_GEOFENCE_TYPE_BIT);
 
     pthread_mutex_unlock(&gDataMutex);
 }
@@ -377,6 +451,7 @@ LocationAPI::startTracking(TrackingOptions& trackingOptions)
 {
     uint32_t id = 0;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     auto it = gData.clientData.find(this);
     if (it != gData.clientData.end()) {
@@ -399,6 +474,7 @@ void
 LocationAPI::stopTracking(uint32_t id)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     auto it = gData.clientData.find(this);
     if (it != gData.clientData.end()) {
@@ -421,6 +497,7 @@ LocationAPI::updateTrackingOptions(
         uint32_t id, TrackingOptions& trackingOptions)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     auto it = gData.clientData.find(this);
     if (it != gData.clientData.end()) {
@@ -443,6 +520,7 @@ LocationAPI::startBatching(BatchingOptions &batchingOptions)
 {
     uint32_t id = 0;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gBatchingLoader);
 
     if (NULL != gData.batchingInterface) {
         id = gData.batchingInterface->startBatching(this, batchingOptions);
@@ -459,6 +537,7 @@ void
 LocationAPI::stopBatching(uint32_t id)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gBatchingLoader);
 
     if (NULL != gData.batchingInterface) {
         gData.batchingInterface->stopBatching(this, id);
@@ -474,6 +553,7 @@ void
 LocationAPI::updateBatchingOptions(uint32_t id, BatchingOptions& batchOptions)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gBatchingLoader);
 
     if (NULL != gData.batchingInterface) {
         gData.batchingInterface->updateBatchingOptions(this, id, batchOptions);
@@ -489,6 +569,7 @@ void
 LocationAPI::getBatchedLocations(uint32_t id, size_t count)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gBatchingLoader);
 
     if (gData.batchingInterface != NULL) {
         gData.batchingInterface->getBatchedLocations(this, id, count);
@@ -505,6 +586,7 @@ LocationAPI::addGeofences(size_t count, GeofenceOption* options, GeofenceInfo* i
 {
     uint32_t* ids = NULL;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGeofenceLoader);
 
     if (gData.geofenceInterface != NULL) {
         ids = gData.geofenceInterface->addGeofences(this, count, options, info);
@@ -521,6 +603,7 @@ void
 LocationAPI::removeGeofences(size_t count, uint32_t* ids)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGeofenceLoader);
 
     if (gData.geofenceInterface != NULL) {
         gData.geofenceInterface->removeGeofences(this, count, ids);
@@ -536,6 +619,7 @@ void
 LocationAPI::modifyGeofences(size_t count, uint32_t* ids, GeofenceOption* options)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGeofenceLoader);
 
     if (gData.geofenceInterface != NULL) {
         gData.geofenceInterface->modifyGeofences(this, count, ids, options);
@@ -551,6 +635,7 @@ void
 LocationAPI::pauseGeofences(size_t count, uint32_t* ids)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGeofenceLoader);
 
     if (gData.geofenceInterface != NULL) {
         gData.geofenceInterface->pauseGeofences(this, count, ids);
@@ -566,6 +651,7 @@ void
 LocationAPI::resumeGeofences(size_t count, uint32_t* ids)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGeofenceLoader);
 
     if (gData.geofenceInterface != NULL) {
         gData.geofenceInterface->resumeGeofences(this, count, ids);
@@ -581,6 +667,7 @@ void
 LocationAPI::gnssNiResponse(uint32_t id, GnssNiResponse response)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     if (gData.gnssInterface != NULL) {
         gData.gnssInterface->gnssNiResponse(this, id, response);
@@ -596,20 +683,11 @@ LocationControlAPI*
 LocationControlAPI::createInstance(LocationControlCallbacks& locationControlCallbacks)
 {
     LocationControlAPI* controlAPI = NULL;
+    startInterfaceLoads();
     pthread_mutex_lock(&gDataMutex);
 
     if (nullptr != locationControlCallbacks.responseCb && NULL == gData.controlAPI) {
-        if (NULL == gData.gnssInterface && !gGnssLoadFailed) {
-            gData.gnssInterface =
-                (GnssInterface*)loadLocationInterface<GnssInterface,
-                    getGnssInterface>("libgnss.so", "getGnssInterface");
-            if (NULL == gData.gnssInterface) {
-                gGnssLoadFailed = true;
-                LOC_LOGW("%s:%d]: No gnss interface available", __func__, __LINE__);
-            } else {
-                gData.gnssInterface->initialize();
-            }
-        }
+        waitForInterface(gGnssLoader);
         if (NULL != gData.gnssInterface) {
             gData.controlAPI = new LocationControlAPI();
             gData.controlCallbacks = locationControlCallbacks;
@@ -648,6 +726,7 @@ LocationControlAPI::enable(LocationTechnologyType techType)
 {
     uint32_t id = 0;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     if (gData.gnssInterface != NULL) {
         id = gData.gnssInterface->enable(techType);
@@ -664,6 +743,7 @@ void
 LocationControlAPI::disable(uint32_t id)
 {
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     if (gData.gnssInterface != NULL) {
         gData.gnssInterface->disable(id);
@@ -680,6 +760,7 @@ LocationControlAPI::gnssUpdateConfig(GnssConfig config)
 {
     uint32_t* ids = NULL;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     if (gData.gnssInterface != NULL) {
         ids = gData.gnssInterface->gnssUpdateConfig(config);
@@ -696,6 +777,7 @@ uint32_t* LocationControlAPI::gnssGetConfig(GnssConfigFlagsMask mask) {
 
     uint32_t* ids = NULL;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     if (NULL != gData.gnssInterface) {
         ids = gData.gnssInterface->gnssGetConfig(mask);
@@ -712,6 +794,7 @@ LocationControlAPI::gnssDeleteAidingData(GnssAidingData& data)
 {
     uint32_t id = 0;
     pthread_mutex_lock(&gDataMutex);
+    waitForInterface(gGnssLoader);
 
     if (gData.gnssInterface != NULL) {
         id = gData.gnssInterface->gnssDeleteAidingData(data);
@@ -1396,14 +1396,14 @@ typedef std::function<void(
     gnssSvCallback is called only during a tracking session
     broadcasted to all clients, no matter if a session has started by client */
 typedef std::function<void(
-    GnssSvNotification gnssSvNotification
+    const GnssSvNotification& gnssSvNotification
 )> gnssSvCallback;
 
 /* Gives GNSS NMEA data, optional can be NULL
     gnssNmeaCallback is called only during a tracking session
     broadcasted to all clients, no matter if a session has started by client */
 typedef std::function<void(
-    GnssNmeaNotification gnssNmeaNotification
+    const GnssNmeaNotification& gnssNmeaNotification
 )> gnssNmeaCallback;
 
 /* Gives GNSS data, optional can be NULL
@@ -1417,7 +1417,7 @@ typedef std::function<void(
     gnssMeasurementsCallback is called only during a tracking session
     broadcasted to all clients, no matter if a session has started by client */
 typedef std::function<void(
-    GnssMeasurementsNotification gnssMeasurementsNotification
+    const GnssMeasurementsNotification& gnssMeasurementsNotification
 )> gnssMeasurementsCallback;
 
 /* Provides the current GNSS configuration to the client */
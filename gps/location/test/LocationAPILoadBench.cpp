@@ -0,0 +1,231 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Startup cost of LocationAPI with stub plugins that take a set time to
+   initialize, see LocationPluginStub.h.
+
+   Every cycle runs in a child process of its own, as the plugins load
+   once per process, creates a gnss/batching/geofence client and a second
+   gnss client right after it, and prints per cycle mean and max:
+     - createInstance of the first client, which starts the loads
+     - createInstance of the second client, while the plugins load
+     - time until the first client gets its capabilities
+     - time until all three plugins are initialized
+   The last row is the sum of the init times, what the startup took when
+   the plugins were loaded one after the other inside createInstance.
+
+   usage: location_api_load_bench [cycles] [gnss_ms] [batching_ms] [geofence_ms] */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <LocationAPI.h>
+#include "LocationPluginStub.h"
+
+#define BENCH_TIMEOUT_MS 10000
+
+typedef struct {
+    int64_t createNs;
+    int64_t secondCreateNs;
+    int64_t capabilitiesNs;
+    int64_t readyNs;
+} LoadCycle;
+
+static pthread_mutex_t sLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sCond = PTHREAD_COND_INITIALIZER;
+static int64_t sCapabilitiesNs = 0;
+
+static LocationCallbacks benchCallbacks(bool first)
+{
+    LocationCallbacks cb = {};
+    cb.size = sizeof(cb);
+    cb.capabilitiesCb = [first](LocationCapabilitiesMask) {
+        if (first) {
+            pthread_mutex_lock(&sLock);
+            sCapabilitiesNs = locationStubNowNs();
+            pthread_cond_broadcast(&sCond);
+            pthread_mutex_unlock(&sLock);
+        }
+    };
+    cb.responseCb = [](LocationError, uint32_t) {};
+    cb.collectiveResponseCb = [](uint32_t, LocationError*, uint32_t*) {};
+    cb.trackingCb = [](Location) {};
+    if (first) {
+        cb.batchingCb = [](uint32_t, Location*, BatchingOptions) {};
+        cb.geofenceBreachCb = [](GeofenceBreachNotification) {};
+    }
+    return cb;
+}
+
+static bool initialized(LocationStubControl* control)
+{
+    pthread_mutex_lock(&control->lock);
+    bool done = (control->inits > 0);
+    pthread_mutex_unlock(&control->lock);
+    return done;
+}
+
+// runs in the child, returns false if the plugins did not come up
+static bool runCycle(const uint32_t initMs[3], LoadCycle& cycle)
+{
+    LocationStubControl* controls[] = {
+        openLocationStub(LOCATION_GNSS_LIBRARY),
+        openLocationStub(LOCATION_BATCHING_LIBRARY),
+        openLocationStub(LOCATION_GEOFENCE_LIBRARY)
+    };
+    for (int i = 0; i < 3; i++) {
+        if (nullptr == controls[i]) {
+            return false;
+        }
+        controls[i]->initDelayUs = initMs[i] * 1000;
+    }
+
+    LocationCallbacks firstCb = benchCallbacks(true);
+    LocationCallbacks secondCb = benchCallbacks(false);
+    int64_t start = locationStubNowNs();
+    LocationAPI* first = LocationAPI::createInstance(firstCb);
+    int64_t created = locationStubNowNs();
+    LocationAPI* second = LocationAPI::createInstance(secondCb);
+    cycle.createNs = created - start;
+    cycle.secondCreateNs = locationStubNowNs() - created;
+    if (nullptr == first || nullptr == second) {
+        return false;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += BENCH_TIMEOUT_MS / 1000;
+    pthread_mutex_lock(&sLock);
+    while (0 == sCapabilitiesNs &&
+           0 == pthread_cond_timedwait(&sCond, &sLock, &deadline)) {
+    }
+    cycle.capabilitiesNs = sCapabilitiesNs - start;
+    pthread_mutex_unlock(&sLock);
+
+    int64_t readyNs = 0;
+    for (int i = 0; i < 3; i++) {
+        for (int ms = 0; !initialized(controls[i]); ms++) {
+            if (ms >= BENCH_TIMEOUT_MS) {
+                return false;
+            }
+            usleep(1000);
+        }
+        readyNs = std::max(readyNs, controls[i]->initEndNs);
+    }
+    cycle.readyNs = readyNs - start;
+    return cycle.capabilitiesNs > 0;
+}
+
+static void print(const char* name, const int64_t* ns, int cycles)
+{
+    int64_t sum = 0;
+    int64_t max = 0;
+    for (int i = 0; i < cycles; i++) {
+        sum += ns[i];
+        max = std::max(max, ns[i]);
+    }
+    printf("%-24s %10.3f %10.3f\n", name, sum / 1e6 / cycles, max / 1e6);
+}
+
+int main(int argc, char* argv[])
+{
+    int cycles = (argc > 1) ? atoi(argv[1]) : 20;
+    uint32_t initMs[3] = { 120, 40, 60 };
+    for (int i = 0; i < 3 && i + 2 < argc; i++) {
+        initMs[i] = (uint32_t)atoi(argv[i + 2]);
+    }
+    if (cycles <= 0) {
+        fprintf(stderr, "usage: %s [cycles] [gnss_ms] [batching_ms] [geofence_ms]\n",
+                argv[0]);
+        return 2;
+    }
+
+    LoadCycle* results = new LoadCycle[cycles];
+    for (int i = 0; i < cycles; i++) {
+        int fds[2];
+        if (0 != pipe(fds)) {
+            perror("pipe");
+            return 1;
+        }
+        pid_t pid = fork();
+        if (0 == pid) {
+            LoadCycle cycle = {};
+            close(fds[0]);
+            bool ok = runCycle(initMs, cycle);
+            ok = ok && (sizeof(cycle) == write(fds[1], &cycle, sizeof(cycle)));
+            _exit(ok ? 0 : 1);
+        }
+        close(fds[1]);
+        ssize_t got = (pid > 0) ? read(fds[0], &results[i], sizeof(results[i])) : -1;
+        close(fds[0]);
+        int status = 0;
+        if (pid > 0) {
+            waitpid(pid, &status, 0);
+        }
+        if (sizeof(results[i]) != got || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+            fprintf(stderr, "FAIL: cycle %d did not complete\n", i);
+            delete[] results;
+            return 1;
+        }
+    }
+
+    int64_t* column = new int64_t[cycles];
+    printf("%d cycles, plugin init gnss %u ms, batching %u ms, geofence %u ms\n",
+            cycles, initMs[0], initMs[1], initMs[2]);
+    printf("%-24s %10s %10s\n", "ms", "mean", "max");
+    for (int i = 0; i < cycles; i++) column[i] = results[i].createNs;
+    print("createInstance", column, cycles);
+    for (int i = 0; i < cycles; i++) column[i] = results[i].secondCreateNs;
+    print("createInstance, loading", column, cycles);
+    for (int i = 0; i < cycles; i++) column[i] = results[i].capabilitiesNs;
+    print("capabilities", column, cycles);
+    int64_t readyMax = 0;
+    for (int i = 0; i < cycles; i++) {
+        column[i] = results[i].readyNs;
+        readyMax = std::max(readyMax, column[i]);
+    }
+    print("all plugins ready", column, cycles);
+    int64_t serialNs = (int64_t)(initMs[0] + initMs[1] + initMs[2]) * 1000000;
+    printf("%-24s %10.3f\n", "serial init sum", serialNs / 1e6);
+
+    // with two or more slow plugins the loads must have overlapped
+    int slow = (initMs[0] > 0) + (initMs[1] > 0) + (initMs[2] > 0);
+    int rc = 0;
+    if (slow > 1 && readyMax >= serialNs) {
+        fprintf(stderr, "FAIL: plugins took %.3f ms to come up, %.3f ms serially\n",
+                readyMax / 1e6, serialNs / 1e6);
+        rc = 1;
+    }
+    delete[] column;
+    delete[] results;
+    return rc;
+}
@@ -0,0 +1,353 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Plugin loading of LocationAPI against stub plugins.
+
+   The interfaces load once per process, so every scenario runs in a
+   child process of its own (EXPECT_EXIT) and reports a failed check by
+   its exit code. The stubs, see LocationPluginStub.h, take a set time to
+   initialize and can fail to load. Covered:
+     - the three plugins initialize concurrently and createInstance does
+       not wait for them
+     - clients registered before the load are added by the loader threads
+       (replayClients), once, to the interfaces they use only, and get
+       their capabilities from their first interface
+     - a plugin that fails to load hands the capabilities request on
+     - clients registered after the load are added at once
+     - updateCallbacks during the load is replayed with the new callbacks
+     - a client destroyed while loading is never added, and its destroy
+       completes at once
+     - a client destroyed after the load completes once removed
+     - calls that need an interface wait for its load */
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <LocationAPI.h>
+#include "LocationPluginStub.h"
+
+#define LOAD_TEST_MAX_CLIENTS 4
+#define LOAD_TEST_TIMEOUT_MS 5000
+
+#define LOAD_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            _exit(1); \
+        } \
+    } while (0)
+
+enum {
+    USES_GNSS = 1 << 0,
+    USES_BATCHING = 1 << 1,
+    USES_GEOFENCE = 1 << 2
+};
+
+/* State of the child process running one scenario */
+class LoadScenario {
+public:
+    LocationStubControl* mGnss;
+    LocationStubControl* mBatching;
+    LocationStubControl* mGeofence;
+
+    LoadScenario(uint32_t gnssInitMs, uint32_t batchingInitMs, uint32_t geofenceInitMs) {
+        pthread_mutex_init(&mLock, NULL);
+        pthread_cond_init(&mCond, NULL);
+        memset(mCapabilities, 0, sizeof(mCapabilities));
+        memset(mDestroyed, 0, sizeof(mDestroyed));
+        mGnss = openLocationStub(LOCATION_GNSS_LIBRARY);
+        mBatching = openLocationStub(LOCATION_BATCHING_LIBRARY);
+        mGeofence = openLocationStub(LOCATION_GEOFENCE_LIBRARY);
+        LOAD_CHECK(nullptr != mGnss && nullptr != mBatching && nullptr != mGeofence);
+        mGnss->initDelayUs = gnssInitMs * 1000;
+        mBatching->initDelayUs = batchingInitMs * 1000;
+        mGeofence->initDelayUs = geofenceInitMs * 1000;
+    }
+
+    LocationCallbacks callbacks(int index, uint32_t uses) {
+        LocationCallbacks cb = {};
+        cb.size = sizeof(cb);
+        cb.capabilitiesCb = [this, index](LocationCapabilitiesMask) {
+            pthread_mutex_lock(&mLock);
+            mCapabilities[index]++;
+            pthread_cond_broadcast(&mCond);
+            pthread_mutex_unlock(&mLock);
+        };
+        cb.responseCb = [](LocationError, uint32_t) {};
+        cb.collectiveResponseCb = [](uint32_t, LocationError*, uint32_t*) {};
+        if (uses & USES_GNSS) {
+            cb.trackingCb = [](Location) {};
+        }
+        if (uses & USES_BATCHING) {
+            cb.batchingCb = [](uint32_t, Location*, BatchingOptions) {};
+        }
+        if (uses & USES_GEOFENCE) {
+            cb.geofenceBreachCb = [](GeofenceBreachNotification) {};
+        }
+        return cb;
+    }
+
+    LocationAPI* create(int index, uint32_t uses) {
+        LocationCallbacks cb = callbacks(index, uses);
+        LocationAPI* client = LocationAPI::createInstance(cb);
+        LOAD_CHECK(nullptr != client);
+        return client;
+    }
+
+    void destroy(LocationAPI* client, int index) {
+        client->destroy([this, index]() {
+            pthread_mutex_lock(&mLock);
+            mDestroyed[index]++;
+            pthread_cond_broadcast(&mCond);
+            pthread_mutex_unlock(&mLock);
+        });
+    }
+
+    uint32_t capabilities(int index) {
+        pthread_mutex_lock(&mLock);
+        uint32_t count = mCapabilities[index];
+        pthread_mutex_unlock(&mLock);
+        return count;
+    }
+
+    uint32_t destroyed(int index) {
+        pthread_mutex_lock(&mLock);
+        uint32_t count = mDestroyed[index];
+        pthread_mutex_unlock(&mLock);
+        return count;
+    }
+
+    bool waitCapabilities(int index) { return waitFor(mCapabilities, index); }
+    bool waitDestroyed(int index) { return waitFor(mDestroyed, index); }
+
+    /* Waits until the load of the stub settled */
+    bool waitLoaded(LocationStubControl* control) {
+        for (int ms = 0; ms < LOAD_TEST_TIMEOUT_MS; ms++) {
+            pthread_mutex_lock(&control->lock);
+            bool done = control->failLoad ? (control->loads > 0) : (control->inits > 0);
+            pthread_mutex_unlock(&control->lock);
+            if (done) {
+                // the loader thread replays the clients right after
+                usleep(20000);
+                return true;
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+
+private:
+    bool waitFor(uint32_t* counts, int index) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += LOAD_TEST_TIMEOUT_MS / 1000;
+        bool ok = true;
+        pthread_mutex_lock(&mLock);
+        while (ok && 0 == counts[index]) {
+            ok = (0 == pthread_cond_timedwait(&mCond, &mLock, &deadline));
+        }
+        pthread_mutex_unlock(&mLock);
+        return ok;
+    }
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    uint32_t mCapabilities[LOAD_TEST_MAX_CLIENTS];
+    uint32_t mDestroyed[LOAD_TEST_MAX_CLIENTS];
+};
+
+static void parallelStartup()
+{
+    LoadScenario s(200, 200, 200);
+    int64_t start = locationStubNowNs();
+    LocationAPI* client = s.create(0, USES_GNSS | USES_BATCHING | USES_GEOFENCE);
+    LOAD_CHECK(locationStubNowNs() - start < 50000000LL);
+    LOAD_CHECK(0 == s.capabilities(0));
+
+    LOAD_CHECK(s.waitCapabilities(0));
+    LOAD_CHECK(s.waitLoaded(s.mBatching) && s.waitLoaded(s.mGeofence));
+    // every initialize() started before any one ended
+    int64_t lastStart = std::max(s.mGnss->initStartNs,
+            std::max(s.mBatching->initStartNs, s.mGeofence->initStartNs));
+    int64_t firstEnd = std::min(s.mGnss->initEndNs,
+            std::min(s.mBatching->initEndNs, s.mGeofence->initEndNs));
+    LOAD_CHECK(lastStart < firstEnd);
+    LOAD_CHECK(1 == s.mGnss->inits && 1 == s.mBatching->inits && 1 == s.mGeofence->inits);
+    // capabilities come from the first interface of the client
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, client).capabilityRequests);
+    LOAD_CHECK(0 == locationStubClient(s.mBatching, client).capabilityRequests);
+    LOAD_CHECK(0 == locationStubClient(s.mGeofence, client).capabilityRequests);
+    LOAD_CHECK(1 == s.capabilities(0));
+}
+
+static void registerBeforeLoad()
+{
+    LoadScenario s(100, 100, 100);
+    LocationAPI* gnss = s.create(0, USES_GNSS);
+    LocationAPI* batching = s.create(1, USES_BATCHING);
+    LocationAPI* geofence = s.create(2, USES_GEOFENCE);
+    LocationAPI* both = s.create(3, USES_BATCHING | USES_GEOFENCE);
+    LOAD_CHECK(0 == locationStubClient(s.mGnss, gnss).adds);
+
+    for (int i = 0; i < 4; i++) {
+        LOAD_CHECK(s.waitCapabilities(i));
+    }
+    LOAD_CHECK(s.waitLoaded(s.mGnss) && s.waitLoaded(s.mBatching) &&
+            s.waitLoaded(s.mGeofence));
+
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, gnss).adds);
+    LOAD_CHECK(0 == locationStubClient(s.mGnss, batching).adds);
+    LOAD_CHECK(0 == locationStubClient(s.mGnss, geofence).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, batching).adds);
+    LOAD_CHECK(0 == locationStubClient(s.mBatching, gnss).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mGeofence, geofence).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, both).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mGeofence, both).adds);
+
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, gnss).capabilityRequests);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, batching).capabilityRequests);
+    LOAD_CHECK(1 == locationStubClient(s.mGeofence, geofence).capabilityRequests);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, both).capabilityRequests);
+    LOAD_CHECK(0 == locationStubClient(s.mGeofence, both).capabilityRequests);
+    for (int i = 0; i < 4; i++) {
+        LOAD_CHECK(1 == s.capabilities(i));
+    }
+}
+
+static void failedLoadHandsCapabilitiesOn()
+{
+    LoadScenario s(100, 150, 0);
+    s.mGnss->failLoad = true;
+    LocationAPI* client = s.create(0, USES_GNSS | USES_BATCHING);
+
+    LOAD_CHECK(s.waitCapabilities(0));
+    LOAD_CHECK(s.waitLoaded(s.mGnss) && s.waitLoaded(s.mBatching));
+    LOAD_CHECK(0 == s.mGnss->inits);
+    LOAD_CHECK(0 == locationStubClient(s.mGnss, client).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, client).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, client).capabilityRequests);
+    LOAD_CHECK(1 == s.capabilities(0));
+
+    TrackingOptions options = {};
+    options.size = sizeof(options);
+    LOAD_CHECK(0 == client->startTracking(options));
+}
+
+static void registerAfterLoad()
+{
+    LoadScenario s(50, 50, 50);
+    LocationAPI* early = s.create(0, USES_GNSS);
+    LOAD_CHECK(s.waitCapabilities(0));
+    LOAD_CHECK(s.waitLoaded(s.mGnss) && s.waitLoaded(s.mBatching) &&
+            s.waitLoaded(s.mGeofence));
+
+    // added and answered before createInstance returns
+    LocationAPI* late = s.create(1, USES_GNSS);
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, late).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, late).capabilityRequests);
+    LOAD_CHECK(1 == s.capabilities(1));
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, early).adds);
+    LOAD_CHECK(1 == s.capabilities(0));
+}
+
+static void updateCallbacksWhileLoading()
+{
+    LoadScenario s(100, 100, 100);
+    LocationAPI* client = s.create(0, USES_GNSS);
+    LocationCallbacks cb = s.callbacks(0, USES_GNSS | USES_GEOFENCE);
+    client->updateCallbacks(cb);
+
+    LOAD_CHECK(s.waitCapabilities(0));
+    LOAD_CHECK(s.waitLoaded(s.mGnss) && s.waitLoaded(s.mGeofence));
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, client).adds);
+    LOAD_CHECK(1 == locationStubClient(s.mGeofence, client).adds);
+    LOAD_CHECK(0 == locationStubClient(s.mBatching, client).adds);
+}
+
+static void destroyWhileLoading()
+{
+    LoadScenario s(150, 150, 150);
+    LocationAPI* kept = s.create(1, USES_GNSS);
+    LocationAPI* gone = s.create(0, USES_GNSS | USES_BATCHING);
+    s.destroy(gone, 0);
+    // nothing to remove from, the destroy completes at once
+    LOAD_CHECK(1 == s.destroyed(0));
+
+    LOAD_CHECK(s.waitCapabilities(1));
+    LOAD_CHECK(s.waitLoaded(s.mGnss) && s.waitLoaded(s.mBatching));
+    LOAD_CHECK(0 == locationStubClient(s.mGnss, gone).adds);
+    LOAD_CHECK(0 == locationStubClient(s.mBatching, gone).adds);
+    LOAD_CHECK(0 == locationStubClient(s.mGnss, gone).capabilityRequests);
+    LOAD_CHECK(0 == s.capabilities(0));
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, kept).adds);
+}
+
+static void destroyAfterLoad()
+{
+    LoadScenario s(20, 20, 20);
+    LocationAPI* client = s.create(0, USES_GNSS | USES_BATCHING);
+    LOAD_CHECK(s.waitCapabilities(0));
+    LOAD_CHECK(s.waitLoaded(s.mGnss) && s.waitLoaded(s.mBatching));
+
+    s.destroy(client, 0);
+    LOAD_CHECK(s.waitDestroyed(0));
+    LOAD_CHECK(1 == locationStubClient(s.mGnss, client).removes);
+    LOAD_CHECK(1 == locationStubClient(s.mBatching, client).removes);
+    LOAD_CHECK(0 == locationStubClient(s.mGeofence, client).removes);
+    LOAD_CHECK(1 == s.destroyed(0));
+}
+
+static void callsWaitForTheirInterface()
+{
+    LoadScenario s(150, 0, 0);
+    LocationAPI* client = s.create(0, USES_GNSS);
+    TrackingOptions options = {};
+    options.size = sizeof(options);
+    LOAD_CHECK(LOCATION_STUB_TRACKING_ID == client->startTracking(options));
+    LOAD_CHECK(1 == s.mGnss->inits);
+    LOAD_CHECK(locationStubNowNs() >= s.mGnss->initEndNs);
+}
+
+#define LOAD_TEST(name, scenario) \
+    TEST(LocationAPILoadTest, name) { \
+        EXPECT_EXIT({ scenario(); _exit(0); }, ::testing::ExitedWithCode(0), ""); \
+    }
+
+LOAD_TEST(PluginsInitializeConcurrently, parallelStartup)
+LOAD_TEST(ClientsRegisteredBeforeLoadAreReplayed, registerBeforeLoad)
+LOAD_TEST(FailedLoadHandsCapabilitiesOn, failedLoadHandsCapabilitiesOn)
+LOAD_TEST(ClientsRegisteredAfterLoadAreAddedAtOnce, registerAfterLoad)
+LOAD_TEST(UpdateCallbacksWhileLoadingIsReplayed, updateCallbacksWhileLoading)
+LOAD_TEST(DestroyWhileLoading, destroyWhileLoading)
+LOAD_TEST(DestroyAfterLoadWaitsForRemoval, destroyAfterLoad)
+LOAD_TEST(CallsWaitForTheirInterface, callsWaitForTheirInterface)
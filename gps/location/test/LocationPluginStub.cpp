@@ -0,0 +1,219 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stub plugin library of LocationAPI, see LocationPluginStub.h.
+
+   Built once per interface with LOCATION_STUB_GNSS, LOCATION_STUB_BATCHING
+   or LOCATION_STUB_GEOFENCE. Capabilities are answered on the calling
+   thread; client removal completes on a thread of its own, as the
+   adapters complete it on their message task. */
+
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <location_interface.h>
+#include "LocationPluginStub.h"
+
+static LocationStubControl sControl = {
+    0, false, PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0, 0, {}
+};
+// callbacks of the added clients, under sControl.lock
+static std::map<LocationAPI*, LocationCallbacks> sCallbacks;
+
+extern "C" LocationStubControl* getLocationStubControl()
+{
+    return &sControl;
+}
+
+// called with sControl.lock held
+static LocationStubClient* findClient(LocationAPI* client)
+{
+    for (uint32_t i = 0; i < sControl.clientCount; i++) {
+        if (sControl.clients[i].client == client) {
+            return &sControl.clients[i];
+        }
+    }
+    if (sControl.clientCount < LOCATION_STUB_MAX_CLIENTS) {
+        LocationStubClient* entry = &sControl.clients[sControl.clientCount++];
+        memset(entry, 0, sizeof(*entry));
+        entry->client = client;
+        return entry;
+    }
+    return nullptr;
+}
+
+static void initialize()
+{
+    int64_t start = locationStubNowNs();
+    usleep(sControl.initDelayUs);
+    pthread_mutex_lock(&sControl.lock);
+    sControl.inits++;
+    sControl.initStartNs = start;
+    sControl.initEndNs = locationStubNowNs();
+    pthread_mutex_unlock(&sControl.lock);
+}
+
+static void deinitialize()
+{
+}
+
+static void addClient(LocationAPI* client, const LocationCallbacks& callbacks)
+{
+    pthread_mutex_lock(&sControl.lock);
+    LocationStubClient* entry = findClient(client);
+    if (nullptr != entry) {
+        entry->adds++;
+    }
+    sCallbacks[client] = callbacks;
+    pthread_mutex_unlock(&sControl.lock);
+}
+
+typedef struct {
+    LocationAPI* client;
+    removeClientCompleteCallback rmClientCb;
+} RemoveRequest;
+
+static void* removeRoutine(void* arg)
+{
+    RemoveRequest* request = (RemoveRequest*)arg;
+    if (nullptr != request->rmClientCb) {
+        request->rmClientCb(request->client);
+    }
+    delete request;
+    return nullptr;
+}
+
+static void removeClient(LocationAPI* client, removeClientCompleteCallback rmClientCb)
+{
+    pthread_mutex_lock(&sControl.lock);
+    LocationStubClient* entry = findClient(client);
+    if (nullptr != entry) {
+        entry->removes++;
+    }
+    sCallbacks.erase(client);
+    pthread_mutex_unlock(&sControl.lock);
+
+    // LocationAPI holds its lock here, the completion takes it
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    RemoveRequest* request = new RemoveRequest{client, rmClientCb};
+    if (0 != pthread_create(&thread, &attr, removeRoutine, request)) {
+        delete request;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+static void requestCapabilities(LocationAPI* client)
+{
+    capabilitiesCallback capabilitiesCb;
+    pthread_mutex_lock(&sControl.lock);
+    LocationStubClient* entry = findClient(client);
+    if (nullptr != entry) {
+        entry->capabilityRequests++;
+    }
+    auto it = sCallbacks.find(client);
+    if (it != sCallbacks.end()) {
+        capabilitiesCb = it->second.capabilitiesCb;
+    }
+    pthread_mutex_unlock(&sControl.lock);
+
+    if (nullptr != capabilitiesCb) {
+        capabilitiesCb(LOCATION_CAPABILITIES_TIME_BASED_TRACKING_BIT);
+    }
+}
+
+// counts the load and tells whether the interface is available
+static bool load()
+{
+    pthread_mutex_lock(&sControl.lock);
+    sControl.loads++;
+    bool fail = sControl.failLoad;
+    pthread_mutex_unlock(&sControl.lock);
+    return !fail;
+}
+
+#if defined(LOCATION_STUB_GNSS)
+
+static uint32_t startTracking(LocationAPI* /*client*/, TrackingOptions& /*options*/)
+{
+    return LOCATION_STUB_TRACKING_ID;
+}
+
+static GnssInterface sInterface;
+
+extern "C" const GnssInterface* getGnssInterface()
+{
+    memset(&sInterface, 0, sizeof(sInterface));
+    sInterface.size = sizeof(sInterface);
+    sInterface.initialize = initialize;
+    sInterface.deinitialize = deinitialize;
+    sInterface.addClient = addClient;
+    sInterface.removeClient = removeClient;
+    sInterface.requestCapabilities = requestCapabilities;
+    sInterface.startTracking = startTracking;
+    return load() ? &sInterface : nullptr;
+}
+
+#elif defined(LOCATION_STUB_BATCHING)
+
+static BatchingInterface sInterface;
+
+extern "C" const BatchingInterface* getBatchingInterface()
+{
+    memset(&sInterface, 0, sizeof(sInterface));
+    sInterface.size = sizeof(sInterface);
+    sInterface.initialize = initialize;
+    sInterface.deinitialize = deinitialize;
+    sInterface.addClient = addClient;
+    sInterface.removeClient = removeClient;
+    sInterface.requestCapabilities = requestCapabilities;
+    return load() ? &sInterface : nullptr;
+}
+
+#elif defined(LOCATION_STUB_GEOFENCE)
+
+static GeofenceInterface sInterface;
+
+extern "C" const GeofenceInterface* getGeofenceInterface()
+{
+    memset(&sInterface, 0, sizeof(sInterface));
+    sInterface.size = sizeof(sInterface);
+    sInterface.initialize = initialize;
+    sInterface.deinitialize = deinitialize;
+    sInterface.addClient = addClient;
+    sInterface.removeClient = removeClient;
+    sInterface.requestCapabilities = requestCapabilities;
+    return load() ? &sInterface : nullptr;
+}
+
+#else
+#error "define LOCATION_STUB_GNSS, LOCATION_STUB_BATCHING or LOCATION_STUB_GEOFENCE"
+#endif
@@ -0,0 +1,108 @@
+/* Copyright (c) 2019 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOCATION_PLUGIN_STUB_H
+#define LOCATION_PLUGIN_STUB_H
+
+/* Stub of the gnss, batching and geofence plugins of LocationAPI.
+
+   The same source builds one stub library per interface, named by
+   LOCATION_GNSS_LIBRARY, LOCATION_BATCHING_LIBRARY and
+   LOCATION_GEOFENCE_LIBRARY. A test opens a stub before LocationAPI
+   loads it to set how long initialize() takes and whether the interface
+   fails to load, then reads back what LocationAPI asked of it. */
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <LocationAPI.h>
+
+#define LOCATION_STUB_MAX_CLIENTS 8
+#define LOCATION_STUB_TRACKING_ID 7
+
+typedef struct {
+    LocationAPI* client;
+    uint32_t adds;                  // addClient, including updates
+    uint32_t capabilityRequests;
+    uint32_t removes;
+} LocationStubClient;
+
+typedef struct {
+    // set before the plugin loads
+    uint32_t initDelayUs;           // time initialize() takes
+    bool failLoad;                  // the interface getter returns NULL
+
+    // filled in by the plugin, under lock
+    pthread_mutex_t lock;
+    uint32_t loads;                 // calls of the interface getter
+    uint32_t inits;
+    int64_t initStartNs;            // CLOCK_MONOTONIC
+    int64_t initEndNs;
+    uint32_t clientCount;
+    LocationStubClient clients[LOCATION_STUB_MAX_CLIENTS];
+} LocationStubControl;
+
+extern "C" LocationStubControl* getLocationStubControl();
+
+static inline int64_t locationStubNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Loads the stub library, LocationAPI gets the same instance later */
+static inline LocationStubControl* openLocationStub(const char* library)
+{
+    void* handle = dlopen(library, RTLD_NOW);
+    if (nullptr == handle) {
+        return nullptr;
+    }
+    LocationStubControl* (*getter)() =
+            (LocationStubControl* (*)())dlsym(handle, "getLocationStubControl");
+    return (nullptr != getter) ? getter() : nullptr;
+}
+
+/* Snapshot of what the stub saw of client, zeroes if nothing */
+static inline LocationStubClient locationStubClient(LocationStubControl* control,
+                                                    LocationAPI* client)
+{
+    LocationStubClient result = {};
+    pthread_mutex_lock(&control->lock);
+    for (uint32_t i = 0; i < control->clientCount; i++) {
+        if (control->clients[i].client == client) {
+            result = control->clients[i];
+        }
+    }
+    pthread_mutex_unlock(&control->lock);
+    return result;
+}
+
+#endif /* LOCATION_PLUGIN_STUB_H */
@@ -38,6 +38,8 @@ ifeq ($(TARGET_BUILD_VARIANT),user)
    LOCAL_CFLAGS += -DTARGET_BUILD_VARIANT_USER
 endif
 
+LOCAL_WHOLE_STATIC_LIBRARIES := libloc_binlog
+
 LOCAL_LDFLAGS += -Wl,--export-dynamic
 
 ## Includes
@@ -59,10 +61,48 @@ LOCAL_CFLAGS += $(GNSS_CFLAGS)
 
 include $(BUILD_SHARED_LIBRARY)
 
+# Binary deferred-format logging engine, shared with the camera HAL
+include $(CLEAR_VARS)
+LOCAL_MODULE := libloc_binlog
+LOCAL_SRC_FILES := \
+    loc_binlog.c \
+    loc_binlog_fmt.c
+LOCAL_CFLAGS += \
+     -fno-short-enums \
+     -D_ANDROID_
+LOCAL_HEADER_LIBRARIES := \
+    libutils_headers \
+    libloc_pla_headers \
+    liblocation_api_headers
+LOCAL_SHARED_LIBRARIES := liblog
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS += $(GNSS_CFLAGS)
+include $(BUILD_STATIC_LIBRARY)
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := libgps.utils_headers
 LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
 include $(BUILD_HEADER_LIBRARY)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_binlog_decode
+LOCAL_SRC_FILES := \
+    loc_binlog_decode.c \
+    loc_binlog_fmt.c
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_binlog_bench
+LOCAL_SRC_FILES := loc_binlog_bench.c
+LOCAL_STATIC_LIBRARIES := libloc_binlog
+LOCAL_SHARED_LIBRARIES := liblog
+LOCAL_CFLAGS += -O2
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_EXECUTABLE)
+
 endif # not BUILD_TINY_ANDROID
 endif # BOARD_VENDOR_QCOM_GPS_LOC_API_HARDWARE
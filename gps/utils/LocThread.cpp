@@ -115,7 +115,9 @@ LocThreadDelegate* LocThreadDelegate::create(LocThread::tCreate creator,
     LocThreadDelegate* thread = NULL;
     if (runnable) {
         thread = new LocThreadDelegate(creator, threadName, runnable, joinable);
-        if (thread && !thread->isRunning()) {
+        // a short runnable may be done already, only the handle tells
+        // whether the thread was created
+        if (thread && !thread->mThandle) {
             thread->destroy();
             thread = NULL;
         }
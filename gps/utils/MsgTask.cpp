@@ -64,9 +64,10 @@ MsgTask::~MsgTask() {
 
 void MsgTask::destroy() {
     LocThread* thread = mThread;
+    // a detached thread deletes this task as soon as the queue unblocks
+    mThread = NULL;
     msg_q_unblock((void*)mQ);
     if (thread) {
-        mThread = NULL;
         delete thread;
     } else {
         delete this;
@@ -0,0 +1,836 @@
+/* Copyright (c) 2011-2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Binary deferred-format logging.
+
+   With BINARY_LOG set in gps.conf the LOC_LOGx macros no longer format on
+   the calling thread. Each call site owns a static loc_binlog_site_s_type;
+   on its first call the site is given an id and its format is parsed once
+   into argument classes. Every call after that only copies the raw
+   arguments into a ring owned by the calling thread. The rings are single
+   producer / single consumer, so the writer never takes a lock; a full ring
+   drops the record and counts it.
+
+   The loc_binlog thread drains all rings in timestamp order every
+   LOC_BINLOG_FLUSH_MS. In LOC_BINLOG_MODE_DEFERRED it formats each record
+   and writes it to logcat; in LOC_BINLOG_MODE_FILE it appends the raw
+   records to LOC_BINLOG_FILE_PATH, which loc_binlog_decode turns back into
+   text on the host.
+
+   The engine is built as the libloc_binlog static library. The camera HAL
+   links it too and registers its CLOGx sites through loc_binlog_register
+   with a prefix of its own. */
+
+#define LOG_TAG "LocSvc_binlog"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <loc_pla.h>
+#include "log_util.h"
+#include "loc_binlog.h"
+
+#define LOC_BINLOG_RING_SIZE    (16 * 1024)
+#define LOC_BINLOG_RING_MASK    (LOC_BINLOG_RING_SIZE - 1)
+#define LOC_BINLOG_FLUSH_MS     50
+#define LOC_BINLOG_FILE_MAX     (32 * 1024 * 1024)
+#define LOC_BINLOG_TEXT_MAX     1024
+#define LOC_BINLOG_ALIGN(x)     (((x) + 7) & ~7u)
+#define LOC_BINLOG_ID_NONE      LOC_BINLOG_MAX_SITES
+
+/* Registered site, indexed by id */
+typedef struct loc_binlog_site_info_s
+{
+    const char *raw_fmt;        /* format pointer the site registered with */
+    char       *fmt;            /* private copy used for formatting */
+    const char *tag;
+    char       *prefix;         /* printed before the formatted text */
+    uint8_t     level;
+    int8_t      num_args;       /* -1 if the format cannot be captured */
+    uint8_t     types[LOC_BINLOG_MAX_ARGS];
+    uint8_t     dumped;         /* definition written to the current file */
+} loc_binlog_site_info_s_type;
+
+/* Per thread ring. head is only written by the owning thread, tail only by
+   the loc_binlog thread. */
+typedef struct loc_binlog_ring_s
+{
+    struct loc_binlog_ring_s *next;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+    uint32_t reported;
+    uint32_t tid;
+    int      alive;
+    uint8_t  buf[LOC_BINLOG_RING_SIZE];
+} loc_binlog_ring_s_type;
+
+int loc_binlog_mode = LOC_BINLOG_MODE_OFF;
+
+static loc_binlog_site_info_s_type *loc_binlog_sites[LOC_BINLOG_MAX_SITES];
+static uint32_t loc_binlog_num_sites = 0;
+static pthread_mutex_t loc_binlog_site_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static loc_binlog_ring_s_type *loc_binlog_rings = NULL;
+static pthread_mutex_t loc_binlog_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t loc_binlog_ring_key;
+static __thread loc_binlog_ring_s_type *loc_binlog_thread_ring = NULL;
+
+static pthread_mutex_t loc_binlog_flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loc_binlog_flush_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t loc_binlog_thread;
+static int loc_binlog_started = 0;
+
+static const char *loc_binlog_file_path = LOC_BINLOG_FILE_PATH;
+static const char *loc_binlog_thread_name = "loc_binlog";
+static FILE *loc_binlog_fp = NULL;
+static long loc_binlog_file_size = 0;
+static int loc_binlog_file_failed = 0;
+
+/*===========================================================================
+FUNCTION    loc_binlog_now_ns
+
+DESCRIPTION
+   Wall clock time of a call, kept in the record so that deferred output
+   carries the time of the call rather than the time of the flush.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   CLOCK_REALTIME in nanoseconds
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static uint64_t loc_binlog_now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_REALTIME, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_ring_release
+
+DESCRIPTION
+   Thread exit hook. The ring is left on the list until the loc_binlog
+   thread has drained it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_binlog_ring_release(void *data)
+{
+   loc_binlog_ring_s_type *ring = (loc_binlog_ring_s_type *)data;
+   if (NULL != ring) {
+      __atomic_store_n(&ring->alive, 0, __ATOMIC_RELEASE);
+   }
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_get_ring
+
+DESCRIPTION
+   Returns the calling thread's ring, allocating it on first use.
+
+DEPENDENCIES
+   loc_binlog_init
+
+RETURN VALUE
+   Ring, or NULL if it could not be allocated
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static loc_binlog_ring_s_type *loc_binlog_get_ring(void)
+{
+   loc_binlog_ring_s_type *ring = loc_binlog_thread_ring;
+
+   if (NULL != ring) {
+      return ring;
+   }
+   ring = (loc_binlog_ring_s_type *)calloc(1, sizeof(*ring));
+   if (NULL == ring) {
+      return NULL;
+   }
+   ring->tid = (uint32_t)syscall(SYS_gettid);
+   ring->alive = 1;
+   pthread_setspecific(loc_binlog_ring_key, ring);
+
+   pthread_mutex_lock(&loc_binlog_ring_lock);
+   ring->next = loc_binlog_rings;
+   loc_binlog_rings = ring;
+   pthread_mutex_unlock(&loc_binlog_ring_lock);
+
+   loc_binlog_thread_ring = ring;
+   return ring;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_register
+
+DESCRIPTION
+   Gives a call site its id and parses its format. Sites whose format
+   cannot be captured are still registered so that the parse happens once;
+   their calls keep going straight to the caller's direct logging path.
+
+   site_id: id word of the static call site, 0 until registered
+   tag:     log tag of the site
+   level:   android_LogPriority of the site
+   prefix:  text put before the formatted message, may be NULL
+   fmt:     format of the site
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Site id, LOC_BINLOG_ID_NONE if the site table is full
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+uint32_t loc_binlog_register(uint32_t *site_id, const char *tag, uint8_t level,
+                             const char *prefix, const char *fmt)
+{
+   loc_binlog_site_info_s_type *info;
+   uint32_t id;
+
+   pthread_mutex_lock(&loc_binlog_site_lock);
+   id = *site_id;
+   if (0 != id) {
+      pthread_mutex_unlock(&loc_binlog_site_lock);
+      return id;
+   }
+
+   info = NULL;
+   if (loc_binlog_num_sites + 1 < LOC_BINLOG_ID_NONE) {
+      info = (loc_binlog_site_info_s_type *)calloc(1, sizeof(*info));
+   }
+   if (NULL != info && NULL != fmt) {
+      info->fmt = strdup(fmt);
+      info->prefix = strdup((NULL != prefix) ? prefix : "");
+   }
+   if (NULL == info || NULL == info->fmt || NULL == info->prefix) {
+      if (NULL != info) {
+         free(info->fmt);
+         free(info->prefix);
+      }
+      free(info);
+      id = LOC_BINLOG_ID_NONE;
+   } else {
+      info->raw_fmt = fmt;
+      info->tag = (NULL != tag) ? tag : "";
+      info->level = level;
+      info->num_args = (int8_t)loc_binlog_parse_fmt(fmt, info->types, LOC_BINLOG_MAX_ARGS);
+      id = ++loc_binlog_num_sites;
+      loc_binlog_sites[id] = info;
+   }
+   __atomic_store_n(site_id, id, __ATOMIC_RELEASE);
+   pthread_mutex_unlock(&loc_binlog_site_lock);
+   return id;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_ring_push
+
+DESCRIPTION
+   Copies one record into the ring. A record never wraps; if it does not
+   fit before the end of the buffer the tail end is filled with a
+   LOC_BINLOG_SITE_PAD record.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   Counts the record as dropped if the ring is full
+===========================================================================*/
+static void loc_binlog_ring_push(loc_binlog_ring_s_type *ring, const uint8_t *rec, uint32_t len)
+{
+   uint32_t head = ring->head;
+   uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+   uint32_t off = head & LOC_BINLOG_RING_MASK;
+   uint32_t pad = (off + len > LOC_BINLOG_RING_SIZE) ? LOC_BINLOG_RING_SIZE - off : 0;
+
+   if (LOC_BINLOG_RING_SIZE - (head - tail) < pad + len) {
+      __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+      return;
+   }
+   if (pad) {
+      uint16_t hdr[2] = {LOC_BINLOG_SITE_PAD, (uint16_t)pad};
+      memcpy(ring->buf + off, hdr, sizeof(hdr));
+      head += pad;
+      off = 0;
+   }
+   memcpy(ring->buf + off, rec, len);
+   __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_vwrite
+
+DESCRIPTION
+   Captures one call of a registered site into the calling thread's ring.
+
+   id:    id returned by loc_binlog_register
+   fmt:   format of the call
+   ap:    arguments of the call
+
+DEPENDENCIES
+   loc_binlog_init
+
+RETURN VALUE
+   0 if the call was captured (or dropped because the ring was full),
+   -1 if the caller has to log it directly
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int loc_binlog_vwrite(uint32_t id, const char *fmt, va_list ap)
+{
+   uint8_t rec[LOC_BINLOG_REC_MAX];
+   loc_binlog_rec_hdr_s_type hdr;
+   loc_binlog_site_info_s_type *info;
+   loc_binlog_ring_s_type *ring;
+   uint32_t pos = sizeof(hdr);
+   int i;
+
+   if (0 == id || id >= LOC_BINLOG_ID_NONE) {
+      return -1;
+   }
+   info = loc_binlog_sites[id];
+   if (info->num_args < 0 || info->raw_fmt != fmt) {
+      return -1;
+   }
+   ring = loc_binlog_get_ring();
+   if (NULL == ring) {
+      return -1;
+   }
+
+   for (i = 0; i < info->num_args; i++) {
+      uint8_t type = info->types[i];
+      int is_unsigned = (type & LOC_BINLOG_ARG_UNSIGNED) != 0;
+      int64_t v64;
+
+      switch (type & ~LOC_BINLOG_ARG_UNSIGNED) {
+      case LOC_BINLOG_ARG_INT:
+      {
+         int32_t v32 = (int32_t)va_arg(ap, int);
+         memcpy(rec + pos, &v32, sizeof(v32));
+         pos += sizeof(v32);
+         continue;
+      }
+      case LOC_BINLOG_ARG_LONG:
+         v64 = is_unsigned ? (int64_t)va_arg(ap, unsigned long) : (int64_t)va_arg(ap, long);
+         break;
+      case LOC_BINLOG_ARG_LLONG:
+         v64 = (int64_t)va_arg(ap, long long);
+         break;
+      case LOC_BINLOG_ARG_SIZE:
+         v64 = is_unsigned ? (int64_t)va_arg(ap, size_t) : (int64_t)va_arg(ap, ssize_t);
+         break;
+      case LOC_BINLOG_ARG_INTMAX:
+         v64 = (int64_t)va_arg(ap, intmax_t);
+         break;
+      case LOC_BINLOG_ARG_PTRDIFF:
+         v64 = (int64_t)va_arg(ap, ptrdiff_t);
+         break;
+      case LOC_BINLOG_ARG_DOUBLE:
+      {
+         double d = va_arg(ap, double);
+         memcpy(&v64, &d, sizeof(d));
+         break;
+      }
+      case LOC_BINLOG_ARG_LDOUBLE:
+      {
+         double d = (double)va_arg(ap, long double);
+         memcpy(&v64, &d, sizeof(d));
+         break;
+      }
+      case LOC_BINLOG_ARG_PTR:
+         v64 = (int64_t)(uintptr_t)va_arg(ap, void *);
+         break;
+      case LOC_BINLOG_ARG_STR:
+      {
+         const char *str = va_arg(ap, const char *);
+         /* leave room for the fixed size arguments that follow */
+         int room = LOC_BINLOG_REC_MAX - (int)pos - (int)sizeof(uint16_t) -
+                    8 * (info->num_args - i - 1);
+         uint16_t len;
+
+         if (NULL == str) {
+            len = LOC_BINLOG_STR_NULL;
+            memcpy(rec + pos, &len, sizeof(len));
+            pos += sizeof(len);
+            continue;
+         }
+         if (room < 0) {
+            room = 0;
+         }
+         if (room > LOC_BINLOG_MAX_STR) {
+            room = LOC_BINLOG_MAX_STR;
+         }
+         len = (uint16_t)strnlen(str, (size_t)room);
+         memcpy(rec + pos, &len, sizeof(len));
+         pos += sizeof(len);
+         memcpy(rec + pos, str, len);
+         pos += len;
+         continue;
+      }
+      default:
+         return -1;
+      }
+      memcpy(rec + pos, &v64, sizeof(v64));
+      pos += sizeof(v64);
+   }
+
+   hdr.site = (uint16_t)id;
+   hdr.len = (uint16_t)LOC_BINLOG_ALIGN(pos);
+   hdr.tid = ring->tid;
+   hdr.ts_ns = loc_binlog_now_ns();
+   memcpy(rec, &hdr, sizeof(hdr));
+   loc_binlog_ring_push(ring, rec, hdr.len);
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_write
+
+DESCRIPTION
+   Captures one LOC_LOGx call into the calling thread's ring, registering
+   the site on its first call.
+
+   site:  static site of the call
+   fmt:   format of the call, followed by its arguments
+
+DEPENDENCIES
+   loc_binlog_init
+
+RETURN VALUE
+   0 if the call was captured (or dropped because the ring was full),
+   -1 if the caller has to log it directly
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int loc_binlog_write(loc_binlog_site_s_type *site, const char *fmt, ...)
+{
+   uint32_t id;
+   va_list ap;
+   int ret;
+
+   id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+   if (0 == id) {
+      id = loc_binlog_register(&site->id, site->tag, site->level, NULL, fmt);
+   }
+   va_start(ap, fmt);
+   ret = loc_binlog_vwrite(id, fmt, ap);
+   va_end(ap);
+   return ret;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_emit_text
+
+DESCRIPTION
+   Writes one formatted line to logcat under the tag and priority of the
+   original call site. The capture time and thread are prepended since the
+   logcat metadata now belongs to the loc_binlog thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_binlog_emit_text(const loc_binlog_site_info_s_type *info,
+                                 const loc_binlog_rec_hdr_s_type *hdr,
+                                 const uint8_t *payload)
+{
+   char text[LOC_BINLOG_TEXT_MAX];
+   char ts[32];
+   struct tm now_tm;
+   time_t sec = (time_t)(hdr->ts_ns / 1000000000ULL);
+   int n;
+
+   localtime_r(&sec, &now_tm);
+   strftime(ts, sizeof(ts), "%H:%M:%S", &now_tm);
+   n = snprintf(text, sizeof(text), "[%s.%06u %u] %s", ts,
+                (unsigned)((hdr->ts_ns % 1000000000ULL) / 1000), hdr->tid,
+                info->prefix);
+   if (n < 0 || n >= (int)sizeof(text)) {
+      n = 0;
+   }
+   loc_binlog_format(text + n, sizeof(text) - n, info->fmt, payload,
+                     hdr->len - sizeof(*hdr));
+#if defined (USE_ANDROID_LOGGING) || defined (ANDROID)
+   __android_log_write(info->level, info->tag, text);
+#else
+   fprintf(stdout, "%c/%s: %s\n", "??VDIWE"[info->level < 7 ? info->level : 0],
+           info->tag, text);
+#endif
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_file_open
+
+DESCRIPTION
+   (Re)creates the dump file and writes its header. All sites have to be
+   defined again in the new file.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 on failure
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_binlog_file_open(void)
+{
+   loc_binlog_file_hdr_s_type fhdr;
+   uint32_t id;
+
+   if (NULL != loc_binlog_fp) {
+      fclose(loc_binlog_fp);
+   }
+   loc_binlog_fp = fopen(loc_binlog_file_path, "wb");
+   if (NULL == loc_binlog_fp) {
+      if (!loc_binlog_file_failed) {
+         ALOGE("%s: cannot open %s: %s, formatting to logcat instead", __func__,
+               loc_binlog_file_path, strerror(errno));
+         loc_binlog_file_failed = 1;
+      }
+      return -1;
+   }
+
+   memcpy(fhdr.magic, LOC_BINLOG_MAGIC, sizeof(fhdr.magic));
+   fhdr.version = LOC_BINLOG_VERSION;
+   fhdr.rec_hdr_size = sizeof(loc_binlog_rec_hdr_s_type);
+   fwrite(&fhdr, sizeof(fhdr), 1, loc_binlog_fp);
+   loc_binlog_file_size = sizeof(fhdr);
+
+   pthread_mutex_lock(&loc_binlog_site_lock);
+   for (id = 1; id <= loc_binlog_num_sites; id++) {
+      loc_binlog_sites[id]->dumped = 0;
+   }
+   pthread_mutex_unlock(&loc_binlog_site_lock);
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_emit_file
+
+DESCRIPTION
+   Appends one raw record to the dump file, preceded by the definition of
+   its site the first time the site shows up in the file.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the file is not available
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_binlog_emit_file(uint32_t id, loc_binlog_site_info_s_type *info,
+                                const uint8_t *rec, uint32_t len)
+{
+   if ((NULL == loc_binlog_fp || loc_binlog_file_size > LOC_BINLOG_FILE_MAX) &&
+       loc_binlog_file_open() != 0) {
+      return -1;
+   }
+
+   if (!info->dumped) {
+      static const uint8_t zeros[8] = {0};
+      loc_binlog_rec_hdr_s_type def;
+      size_t tag_len = strlen(info->tag) + 1;
+      size_t prefix_len = strlen(info->prefix) + 1;
+      size_t fmt_len = strlen(info->fmt) + 1;
+      size_t def_len = sizeof(def) + 1 + tag_len + prefix_len + fmt_len;
+
+      if (def_len > 0xFFFF - 8) {
+         return -1;
+      }
+      memset(&def, 0, sizeof(def));
+      def.site = LOC_BINLOG_SITE_DEF;
+      def.len = (uint16_t)LOC_BINLOG_ALIGN(def_len);
+      def.tid = id;
+      fwrite(&def, sizeof(def), 1, loc_binlog_fp);
+      fwrite(&info->level, 1, 1, loc_binlog_fp);
+      fwrite(info->tag, tag_len, 1, loc_binlog_fp);
+      fwrite(info->prefix, prefix_len, 1, loc_binlog_fp);
+      fwrite(info->fmt, fmt_len, 1, loc_binlog_fp);
+      fwrite(zeros, def.len - def_len, 1, loc_binlog_fp);
+      loc_binlog_file_size += def.len;
+      info->dumped = 1;
+   }
+   fwrite(rec, len, 1, loc_binlog_fp);
+   loc_binlog_file_size += len;
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_drain
+
+DESCRIPTION
+   Consumes everything visible in all rings, oldest record first across
+   threads. Rings of exited threads are freed once empty.
+
+DEPENDENCIES
+   Caller holds loc_binlog_flush_lock
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_binlog_drain(void)
+{
+   loc_binlog_ring_s_type *ring;
+   loc_binlog_ring_s_type **link;
+   int file_mode = (LOC_BINLOG_MODE_FILE == loc_binlog_mode);
+
+   pthread_mutex_lock(&loc_binlog_ring_lock);
+   for (;;) {
+      loc_binlog_ring_s_type *oldest = NULL;
+      loc_binlog_rec_hdr_s_type hdr;
+      loc_binlog_rec_hdr_s_type oldest_hdr;
+      loc_binlog_site_info_s_type *info;
+      const uint8_t *rec;
+
+      memset(&oldest_hdr, 0, sizeof(oldest_hdr));
+      for (ring = loc_binlog_rings; NULL != ring; ring = ring->next) {
+         uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+         uint16_t site_len[2];
+
+         while (ring->tail != head) {
+            memcpy(site_len, ring->buf + (ring->tail & LOC_BINLOG_RING_MASK),
+                   sizeof(site_len));
+            if (LOC_BINLOG_SITE_PAD != site_len[0]) {
+               break;
+            }
+            __atomic_store_n(&ring->tail, ring->tail + site_len[1], __ATOMIC_RELEASE);
+         }
+         if (ring->tail == head) {
+            continue;
+         }
+         memcpy(&hdr, ring->buf + (ring->tail & LOC_BINLOG_RING_MASK), sizeof(hdr));
+         if (NULL == oldest || hdr.ts_ns < oldest_hdr.ts_ns) {
+            oldest = ring;
+            oldest_hdr = hdr;
+         }
+      }
+      if (NULL == oldest) {
+         break;
+      }
+
+      rec = oldest->buf + (oldest->tail & LOC_BINLOG_RING_MASK);
+      info = loc_binlog_sites[oldest_hdr.site];
+      if (!file_mode ||
+          loc_binlog_emit_file(oldest_hdr.site, info, rec, oldest_hdr.len) != 0) {
+         loc_binlog_emit_text(info, &oldest_hdr, rec + sizeof(oldest_hdr));
+      }
+      __atomic_store_n(&oldest->tail, oldest->tail + oldest_hdr.len, __ATOMIC_RELEASE);
+   }
+
+   link = &loc_binlog_rings;
+   while (NULL != (ring = *link)) {
+      uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+      if (dropped != ring->reported) {
+         ALOGW("%s: dropped %u records from tid %u, ring full", __func__,
+               dropped - ring->reported, ring->tid);
+         ring->reported = dropped;
+      }
+      if (!__atomic_load_n(&ring->alive, __ATOMIC_ACQUIRE) &&
+          ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+         *link = ring->next;
+         free(ring);
+      } else {
+         link = &ring->next;
+      }
+   }
+   pthread_mutex_unlock(&loc_binlog_ring_lock);
+
+   if (NULL != loc_binlog_fp) {
+      fflush(loc_binlog_fp);
+   }
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_thread_proc
+
+DESCRIPTION
+   Body of the loc_binlog thread.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void *loc_binlog_thread_proc(void *arg)
+{
+   struct timespec ts;
+   (void)arg;
+
+   pthread_mutex_lock(&loc_binlog_flush_lock);
+   for (;;) {
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += LOC_BINLOG_FLUSH_MS * 1000000L;
+      if (ts.tv_nsec >= 1000000000L) {
+         ts.tv_sec += 1;
+         ts.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&loc_binlog_flush_cond, &loc_binlog_flush_lock, &ts);
+      loc_binlog_drain();
+   }
+   pthread_mutex_unlock(&loc_binlog_flush_lock);
+   return NULL;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_flush
+
+DESCRIPTION
+   Drains all rings synchronously. Registered with atexit so that the tail
+   of the log survives a normal exit.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_binlog_flush(void)
+{
+   if (!loc_binlog_started) {
+      return;
+   }
+   pthread_mutex_lock(&loc_binlog_flush_lock);
+   loc_binlog_drain();
+   pthread_mutex_unlock(&loc_binlog_flush_lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_init_ext
+
+DESCRIPTION
+   Applies a binary log mode. The drain thread is started the first time a
+   binary mode is selected and stays up afterwards, so that records
+   captured before a switch back to LOC_BINLOG_MODE_OFF still get written.
+   The dump file and thread name are taken from the call that starts the
+   thread.
+
+   mode:        LOC_BINLOG_MODE_*
+   file_path:   dump file of LOC_BINLOG_MODE_FILE
+   thread_name: name of the drain thread
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_binlog_init_ext(unsigned long mode, const char *file_path,
+                         const char *thread_name)
+{
+   if (mode > LOC_BINLOG_MODE_FILE) {
+      ALOGE("%s: invalid binary log mode %lu, ignored", __func__, mode);
+      mode = LOC_BINLOG_MODE_OFF;
+   }
+
+   pthread_mutex_lock(&loc_binlog_flush_lock);
+   if (LOC_BINLOG_MODE_OFF != mode && !loc_binlog_started) {
+      loc_binlog_file_path = file_path;
+      loc_binlog_thread_name = thread_name;
+      if (pthread_key_create(&loc_binlog_ring_key, loc_binlog_ring_release) != 0 ||
+          pthread_create(&loc_binlog_thread, NULL, loc_binlog_thread_proc, NULL) != 0) {
+         ALOGE("%s: cannot start %s thread", __func__, loc_binlog_thread_name);
+         mode = LOC_BINLOG_MODE_OFF;
+      } else {
+         pthread_setname_np(loc_binlog_thread, loc_binlog_thread_name);
+         pthread_detach(loc_binlog_thread);
+         atexit(loc_binlog_flush);
+         loc_binlog_started = 1;
+      }
+   }
+   loc_binlog_mode = (int)mode;
+   pthread_mutex_unlock(&loc_binlog_flush_lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_init
+
+DESCRIPTION
+   Applies the BINARY_LOG setting of gps.conf.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_binlog_init(unsigned long mode)
+{
+   loc_binlog_init_ext(mode, LOC_BINLOG_FILE_PATH, "loc_binlog");
+}
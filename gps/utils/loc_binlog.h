@@ -0,0 +1,162 @@
+/* Copyright (c) 2011-2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef __LOC_BINLOG_H__
+#define __LOC_BINLOG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*=============================================================================
+ *
+ *                         BINARY LOG MODES (BINARY_LOG)
+ *
+ *============================================================================*/
+/* Format on the calling thread, as before */
+#define LOC_BINLOG_MODE_OFF         0
+/* Capture arguments, a background thread formats them into logcat */
+#define LOC_BINLOG_MODE_DEFERRED    1
+/* Capture arguments, a background thread appends raw records to
+   LOC_BINLOG_FILE_PATH for offline decoding with loc_binlog_decode */
+#define LOC_BINLOG_MODE_FILE        2
+
+#define LOC_BINLOG_FILE_PATH        "/data/vendor/location/loc_binlog.bin"
+
+/* Priorities stored in a site, same values as android_LogPriority */
+#define LOC_BINLOG_LEVEL_V          2
+#define LOC_BINLOG_LEVEL_D          3
+#define LOC_BINLOG_LEVEL_I          4
+#define LOC_BINLOG_LEVEL_W          5
+#define LOC_BINLOG_LEVEL_E          6
+
+/* Limits of a captured call; calls beyond them fall back to ALOGx */
+#define LOC_BINLOG_MAX_ARGS         16
+#define LOC_BINLOG_MAX_STR          128
+#define LOC_BINLOG_REC_MAX          512
+
+/*=============================================================================
+ *
+ *                         RECORD LAYOUT
+ *
+ * A dump file is a loc_binlog_file_hdr_s_type followed by records. Every
+ * record starts with a loc_binlog_rec_hdr_s_type and is padded to 8 bytes.
+ * A site definition (site == LOC_BINLOG_SITE_DEF, tid == site id) carries
+ * the level byte followed by the NUL terminated tag, prefix and format, and
+ * precedes the first record of that site. Record payloads hold the call
+ * arguments packed in format order, see loc_binlog_format().
+ *
+ *============================================================================*/
+#define LOC_BINLOG_MAGIC            "LBIN"
+#define LOC_BINLOG_VERSION          1
+#define LOC_BINLOG_SITE_DEF         0xFFFF
+#define LOC_BINLOG_SITE_PAD         0xFFFE
+#define LOC_BINLOG_MAX_SITES        4096
+
+typedef struct loc_binlog_file_hdr_s
+{
+    char     magic[4];
+    uint16_t version;
+    uint16_t rec_hdr_size;
+} loc_binlog_file_hdr_s_type;
+
+typedef struct loc_binlog_rec_hdr_s
+{
+    uint16_t site;      /* site id, LOC_BINLOG_SITE_DEF or LOC_BINLOG_SITE_PAD */
+    uint16_t len;       /* record length including this header */
+    uint32_t tid;       /* writer thread id */
+    uint64_t ts_ns;     /* CLOCK_REALTIME at the call */
+} loc_binlog_rec_hdr_s_type;
+
+/* Argument classes of a conversion, ORed with LOC_BINLOG_ARG_UNSIGNED */
+typedef enum
+{
+    LOC_BINLOG_ARG_INT = 1,     /* int, char, short and '*' - 4 bytes */
+    LOC_BINLOG_ARG_LONG,        /* long - 8 bytes */
+    LOC_BINLOG_ARG_LLONG,       /* long long - 8 bytes */
+    LOC_BINLOG_ARG_SIZE,        /* size_t - 8 bytes */
+    LOC_BINLOG_ARG_INTMAX,      /* intmax_t - 8 bytes */
+    LOC_BINLOG_ARG_PTRDIFF,     /* ptrdiff_t - 8 bytes */
+    LOC_BINLOG_ARG_DOUBLE,      /* double - 8 bytes */
+    LOC_BINLOG_ARG_LDOUBLE,     /* long double, stored as double */
+    LOC_BINLOG_ARG_STR,         /* u16 length (0xFFFF for NULL) + bytes */
+    LOC_BINLOG_ARG_PTR          /* pointer - 8 bytes */
+} loc_binlog_arg_e_type;
+
+#define LOC_BINLOG_ARG_UNSIGNED     0x80
+#define LOC_BINLOG_STR_NULL         0xFFFF
+
+/* One per call site, a function-local static emitted by LOC_LOGx */
+typedef struct loc_binlog_site_s
+{
+    const char *tag;
+    uint32_t    id;     /* 0 until the first call registers the site */
+    uint8_t     level;
+} loc_binlog_site_s_type;
+
+/*=============================================================================
+ *
+ *                               EXTERNAL DATA
+ *
+ *============================================================================*/
+extern int loc_binlog_mode;
+
+/*=============================================================================
+ *
+ *                        MODULE EXPORTED FUNCTIONS
+ *
+ *============================================================================*/
+extern void loc_binlog_init(unsigned long mode);
+extern int loc_binlog_write(loc_binlog_site_s_type *site, const char *fmt, ...);
+extern void loc_binlog_flush(void);
+
+/* Engine entry points for loggers with their own call site macros, such as
+   the camera HAL. Registration assigns *site_id; a prefix, if given, is
+   stored once and printed before every formatted message of the site. */
+extern void loc_binlog_init_ext(unsigned long mode, const char *file_path,
+                                const char *thread_name);
+extern uint32_t loc_binlog_register(uint32_t *site_id, const char *tag, uint8_t level,
+                                    const char *prefix, const char *fmt);
+extern int loc_binlog_vwrite(uint32_t id, const char *fmt, va_list ap);
+
+/* Format helpers, shared with the loc_binlog_decode tool */
+extern int loc_binlog_parse_fmt(const char *fmt, uint8_t *types, int max_types);
+extern int loc_binlog_format(char *out, size_t out_size, const char *fmt,
+                             const uint8_t *args, size_t args_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOC_BINLOG_H__ */
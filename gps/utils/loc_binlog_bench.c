@@ -0,0 +1,176 @@
+/* Copyright (c) 2011-2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Calling thread cost of one log call, in ns/call.
+
+   usage: loc_binlog_bench [calls] [dump file]
+
+   Runs the same call with formatting only (vsnprintf into a local
+   buffer), with __android_log_print as LOC_BINARY_LOG 0 does, and
+   captured by loc_binlog in LOC_BINLOG_MODE_DEFERRED and
+   LOC_BINLOG_MODE_FILE. The rings are flushed every LOC_BINLOG_BENCH_BURST
+   calls outside of the timed sections, so no record is dropped and only
+   the capture is measured. Records end up in logcat under the
+   loc_binlog_bench tag and in the dump file, which loc_binlog_decode
+   reads back. */
+
+#define LOG_TAG "loc_binlog_bench"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include <log/log.h>
+#include "loc_binlog.h"
+
+#define LOC_BINLOG_BENCH_BURST      256
+#define LOC_BINLOG_BENCH_FMT        "%s: frame %d ts %lld fps %f status %s"
+#define LOC_BINLOG_BENCH_LOGCAT_MAX 20000
+
+typedef enum
+{
+   LOC_BINLOG_BENCH_FORMAT,
+   LOC_BINLOG_BENCH_LOGCAT,
+   LOC_BINLOG_BENCH_CAPTURE
+} loc_binlog_bench_e_type;
+
+static loc_binlog_site_s_type bench_site = {LOG_TAG, 0, LOC_BINLOG_LEVEL_D};
+
+static uint64_t bench_now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_format(const char *fmt, ...)
+{
+   char text[1024];
+   va_list ap;
+   int n;
+
+   va_start(ap, fmt);
+   n = vsnprintf(text, sizeof(text), fmt, ap);
+   va_end(ap);
+   return n;
+}
+
+/*===========================================================================
+FUNCTION    bench_run
+
+DESCRIPTION
+   Times calls of one kind in bursts of LOC_BINLOG_BENCH_BURST.
+
+DEPENDENCIES
+   loc_binlog_init_ext for LOC_BINLOG_BENCH_CAPTURE
+
+RETURN VALUE
+   Average ns/call, negative if a capture fell back to direct logging
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static double bench_run(loc_binlog_bench_e_type kind, uint32_t calls)
+{
+   uint64_t total_ns = 0;
+   uint32_t done = 0;
+   int fallback = 0;
+
+   while (done < calls) {
+      uint32_t burst = calls - done;
+      uint64_t start;
+      uint32_t i;
+
+      if (burst > LOC_BINLOG_BENCH_BURST) {
+         burst = LOC_BINLOG_BENCH_BURST;
+      }
+      start = bench_now_ns();
+      for (i = done; i < done + burst; i++) {
+         switch (kind) {
+         case LOC_BINLOG_BENCH_FORMAT:
+            bench_format(LOC_BINLOG_BENCH_FMT, __func__, (int)i,
+                         (long long)i * 33333333LL, 29.97, "ok");
+            break;
+         case LOC_BINLOG_BENCH_LOGCAT:
+            ALOGD(LOC_BINLOG_BENCH_FMT, __func__, (int)i,
+                  (long long)i * 33333333LL, 29.97, "ok");
+            break;
+         default:
+            fallback |= loc_binlog_write(&bench_site, LOC_BINLOG_BENCH_FMT,
+                                         __func__, (int)i,
+                                         (long long)i * 33333333LL, 29.97, "ok");
+            break;
+         }
+      }
+      total_ns += bench_now_ns() - start;
+      done += burst;
+      if (LOC_BINLOG_BENCH_CAPTURE == kind) {
+         loc_binlog_flush();
+      }
+   }
+   return fallback ? -1.0 : (double)total_ns / (double)calls;
+}
+
+int main(int argc, char *argv[])
+{
+   uint32_t calls = (argc > 1) ? (uint32_t)atoi(argv[1]) : 200000;
+   const char *path = (argc > 2) ? argv[2] : "/data/local/tmp/loc_binlog_bench.bin";
+   uint32_t logcat_calls;
+   double deferred_ns, file_ns;
+
+   if (0 == calls) {
+      fprintf(stderr, "usage: %s [calls] [dump file]\n", argv[0]);
+      return 2;
+   }
+   logcat_calls = (calls > LOC_BINLOG_BENCH_LOGCAT_MAX) ?
+                  LOC_BINLOG_BENCH_LOGCAT_MAX : calls;
+
+   printf("format only:        %8.1f ns/call\n",
+          bench_run(LOC_BINLOG_BENCH_FORMAT, calls));
+   printf("__android_log_print: %7.1f ns/call (%u calls)\n",
+          bench_run(LOC_BINLOG_BENCH_LOGCAT, logcat_calls), logcat_calls);
+
+   loc_binlog_init_ext(LOC_BINLOG_MODE_DEFERRED, path, "loc_binlog_bench");
+   if (LOC_BINLOG_MODE_DEFERRED != loc_binlog_mode) {
+      fprintf(stderr, "FAIL: cannot start the binary log thread\n");
+      return 1;
+   }
+   deferred_ns = bench_run(LOC_BINLOG_BENCH_CAPTURE, calls);
+   loc_binlog_init_ext(LOC_BINLOG_MODE_FILE, path, "loc_binlog_bench");
+   file_ns = bench_run(LOC_BINLOG_BENCH_CAPTURE, calls);
+   loc_binlog_flush();
+
+   if (deferred_ns < 0 || file_ns < 0) {
+      fprintf(stderr, "FAIL: calls were not captured\n");
+      return 1;
+   }
+   printf("binlog deferred:    %8.1f ns/call\n", deferred_ns);
+   printf("binlog file:        %8.1f ns/call (%s)\n", file_ns, path);
+   return 0;
+}
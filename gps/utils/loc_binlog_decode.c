@@ -0,0 +1,193 @@
+/* Copyright (c) 2011-2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Host tool turning a binary log dump back into text.
+
+   usage: loc_binlog_decode <dump file>
+
+   Output has one line per record, in logcat "threadtime" like layout:
+   date time tid level tag: message */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "loc_binlog.h"
+
+typedef struct loc_binlog_decode_site_s
+{
+    uint8_t level;
+    char   *tag;
+    char   *prefix;
+    char   *fmt;
+} loc_binlog_decode_site_s_type;
+
+static loc_binlog_decode_site_s_type sites[LOC_BINLOG_MAX_SITES];
+
+/*===========================================================================
+FUNCTION    loc_binlog_decode_def
+
+DESCRIPTION
+   Stores the site carried by a LOC_BINLOG_SITE_DEF record.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the record is malformed
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_binlog_decode_def(const loc_binlog_rec_hdr_s_type *hdr,
+                                 const uint8_t *body, size_t len)
+{
+   loc_binlog_decode_site_s_type *site;
+   const char *strs[3];
+   const char *s;
+   const char *end = (const char *)body + len;
+   int i;
+
+   if (hdr->tid == 0 || hdr->tid >= LOC_BINLOG_MAX_SITES || len < 1) {
+      return -1;
+   }
+   s = (const char *)body + 1;
+   for (i = 0; i < 3; i++) {
+      const char *nul = memchr(s, '\0', (size_t)(end - s));
+      if (NULL == nul) {
+         return -1;
+      }
+      strs[i] = s;
+      s = nul + 1;
+   }
+
+   site = &sites[hdr->tid];
+   free(site->tag);
+   free(site->prefix);
+   free(site->fmt);
+   site->level = body[0];
+   site->tag = strdup(strs[0]);
+   site->prefix = strdup(strs[1]);
+   site->fmt = strdup(strs[2]);
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_decode_rec
+
+DESCRIPTION
+   Prints one captured call.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_binlog_decode_rec(const loc_binlog_rec_hdr_s_type *hdr,
+                                  const uint8_t *body, size_t len)
+{
+   static const char levels[] = "??VDIWE";
+   const loc_binlog_decode_site_s_type *site = NULL;
+   char text[4096];
+   char ts[32];
+   struct tm tm;
+   time_t sec = (time_t)(hdr->ts_ns / 1000000000ULL);
+
+   if (hdr->site < LOC_BINLOG_MAX_SITES && NULL != sites[hdr->site].fmt) {
+      site = &sites[hdr->site];
+   }
+   localtime_r(&sec, &tm);
+   strftime(ts, sizeof(ts), "%m-%d %H:%M:%S", &tm);
+
+   if (NULL == site) {
+      printf("%s.%06u %5u ? <site %u undefined>\n", ts,
+             (unsigned)((hdr->ts_ns % 1000000000ULL) / 1000), hdr->tid, hdr->site);
+      return;
+   }
+   loc_binlog_format(text, sizeof(text), site->fmt, body, len);
+   printf("%s.%06u %5u %c %s: %s%s\n", ts,
+          (unsigned)((hdr->ts_ns % 1000000000ULL) / 1000), hdr->tid,
+          levels[site->level < sizeof(levels) - 1 ? site->level : 0],
+          site->tag, site->prefix, text);
+}
+
+int main(int argc, char *argv[])
+{
+   loc_binlog_file_hdr_s_type fhdr;
+   loc_binlog_rec_hdr_s_type hdr;
+   uint8_t body[0x10000];
+   FILE *fp;
+   int ret = 0;
+
+   if (argc != 2) {
+      fprintf(stderr, "usage: %s <dump file>\n", argv[0]);
+      return 1;
+   }
+   fp = fopen(argv[1], "rb");
+   if (NULL == fp) {
+      perror(argv[1]);
+      return 1;
+   }
+   if (fread(&fhdr, sizeof(fhdr), 1, fp) != 1 ||
+       memcmp(fhdr.magic, LOC_BINLOG_MAGIC, sizeof(fhdr.magic)) != 0 ||
+       fhdr.version != LOC_BINLOG_VERSION ||
+       fhdr.rec_hdr_size != sizeof(hdr)) {
+      fprintf(stderr, "%s: not a binary log dump\n", argv[1]);
+      fclose(fp);
+      return 1;
+   }
+
+   while (fread(&hdr, sizeof(hdr), 1, fp) == 1) {
+      size_t len;
+      if (hdr.len < sizeof(hdr)) {
+         fprintf(stderr, "%s: corrupt record at %ld\n", argv[1],
+                 ftell(fp) - (long)sizeof(hdr));
+         ret = 1;
+         break;
+      }
+      len = hdr.len - sizeof(hdr);
+      if (len > 0 && fread(body, len, 1, fp) != 1) {
+         /* the writer was cut short, the tail record is incomplete */
+         break;
+      }
+      if (LOC_BINLOG_SITE_DEF == hdr.site) {
+         if (loc_binlog_decode_def(&hdr, body, len) != 0) {
+            fprintf(stderr, "%s: bad site definition\n", argv[1]);
+         }
+      } else if (LOC_BINLOG_SITE_PAD != hdr.site) {
+         loc_binlog_decode_rec(&hdr, body, len);
+      }
+   }
+   fclose(fp);
+   return ret;
+}
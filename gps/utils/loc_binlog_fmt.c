@@ -0,0 +1,525 @@
+/* Copyright (c) 2011-2014 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Format string handling for the binary log. This file has no platform
+   dependencies so that the host side loc_binlog_decode tool can share it. */
+
+#include <stdio.h>
+#include <string.h>
+#include "loc_binlog.h"
+
+#define LOC_BINLOG_SPEC_MAX 32
+
+typedef enum
+{
+    LOC_BINLOG_LEN_NONE,
+    LOC_BINLOG_LEN_HH,
+    LOC_BINLOG_LEN_H,
+    LOC_BINLOG_LEN_L,
+    LOC_BINLOG_LEN_LL,
+    LOC_BINLOG_LEN_LD,
+    LOC_BINLOG_LEN_J,
+    LOC_BINLOG_LEN_Z,
+    LOC_BINLOG_LEN_T
+} loc_binlog_len_e_type;
+
+typedef struct loc_binlog_spec_s
+{
+    char    text[LOC_BINLOG_SPEC_MAX];  /* spec rewritten for the stored type */
+    size_t  text_len;
+    uint8_t num_star;                   /* '*' width/precision arguments */
+    uint8_t type;                       /* 0 for "%%" */
+} loc_binlog_spec_s_type;
+
+/*===========================================================================
+FUNCTION    loc_binlog_spec_append
+
+DESCRIPTION
+   Appends characters to the rewritten conversion spec.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the spec is too long
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_binlog_spec_append(loc_binlog_spec_s_type *spec, const char *s, size_t n)
+{
+   if (spec->text_len + n >= LOC_BINLOG_SPEC_MAX) {
+      return -1;
+   }
+   memcpy(spec->text + spec->text_len, s, n);
+   spec->text_len += n;
+   spec->text[spec->text_len] = '\0';
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_parse_spec
+
+DESCRIPTION
+   Parses one printf conversion. *cursor points just past the '%' and is
+   advanced past the conversion character. Integer conversions wider than
+   int are rewritten to "ll" and long double to double, matching what the
+   writer stores.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 for conversions the binary log does not capture
+   (%n, %ls, %m, malformed specs)
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_binlog_parse_spec(const char **cursor, loc_binlog_spec_s_type *spec)
+{
+   const char *s = *cursor;
+   const char *start = s;
+   loc_binlog_len_e_type len = LOC_BINLOG_LEN_NONE;
+   uint8_t type = 0;
+   char conv;
+
+   spec->text[0] = '%';
+   spec->text[1] = '\0';
+   spec->text_len = 1;
+   spec->num_star = 0;
+   spec->type = 0;
+
+   /* flags, width and precision are copied through unchanged */
+   while (*s != '\0' && strchr("-+ #0'", *s) != NULL) {
+      s++;
+   }
+   if (*s == '*') {
+      spec->num_star++;
+      s++;
+   } else {
+      while (*s >= '0' && *s <= '9') {
+         s++;
+      }
+   }
+   if (*s == '.') {
+      s++;
+      if (*s == '*') {
+         spec->num_star++;
+         s++;
+      } else {
+         while (*s >= '0' && *s <= '9') {
+            s++;
+         }
+      }
+   }
+   if (loc_binlog_spec_append(spec, start, (size_t)(s - start)) != 0) {
+      return -1;
+   }
+
+   switch (*s) {
+   case 'h':
+      s++;
+      len = LOC_BINLOG_LEN_H;
+      if (*s == 'h') {
+         s++;
+         len = LOC_BINLOG_LEN_HH;
+      }
+      break;
+   case 'l':
+      s++;
+      len = LOC_BINLOG_LEN_L;
+      if (*s == 'l') {
+         s++;
+         len = LOC_BINLOG_LEN_LL;
+      }
+      break;
+   case 'q':
+      s++;
+      len = LOC_BINLOG_LEN_LL;
+      break;
+   case 'L':
+      s++;
+      len = LOC_BINLOG_LEN_LD;
+      break;
+   case 'j':
+      s++;
+      len = LOC_BINLOG_LEN_J;
+      break;
+   case 'z':
+      s++;
+      len = LOC_BINLOG_LEN_Z;
+      break;
+   case 't':
+      s++;
+      len = LOC_BINLOG_LEN_T;
+      break;
+   default:
+      break;
+   }
+
+   conv = *s;
+   if (conv == '\0') {
+      return -1;
+   }
+   s++;
+
+   switch (conv) {
+   case '%':
+      if (s - start != 1) {
+         return -1;
+      }
+      spec->type = 0;
+      *cursor = s;
+      return loc_binlog_spec_append(spec, "%", 1);
+   case 'd':
+   case 'i':
+   case 'o':
+   case 'u':
+   case 'x':
+   case 'X':
+      switch (len) {
+      case LOC_BINLOG_LEN_NONE:
+         type = LOC_BINLOG_ARG_INT;
+         break;
+      case LOC_BINLOG_LEN_HH:
+         type = LOC_BINLOG_ARG_INT;
+         if (loc_binlog_spec_append(spec, "hh", 2) != 0) {
+            return -1;
+         }
+         break;
+      case LOC_BINLOG_LEN_H:
+         type = LOC_BINLOG_ARG_INT;
+         if (loc_binlog_spec_append(spec, "h", 1) != 0) {
+            return -1;
+         }
+         break;
+      case LOC_BINLOG_LEN_L:
+         type = LOC_BINLOG_ARG_LONG;
+         break;
+      case LOC_BINLOG_LEN_LL:
+         type = LOC_BINLOG_ARG_LLONG;
+         break;
+      case LOC_BINLOG_LEN_J:
+         type = LOC_BINLOG_ARG_INTMAX;
+         break;
+      case LOC_BINLOG_LEN_Z:
+         type = LOC_BINLOG_ARG_SIZE;
+         break;
+      case LOC_BINLOG_LEN_T:
+         type = LOC_BINLOG_ARG_PTRDIFF;
+         break;
+      default:
+         return -1;
+      }
+      if (type != LOC_BINLOG_ARG_INT &&
+          loc_binlog_spec_append(spec, "ll", 2) != 0) {
+         return -1;
+      }
+      if (conv != 'd' && conv != 'i') {
+         type |= LOC_BINLOG_ARG_UNSIGNED;
+      }
+      break;
+   case 'c':
+      if (len != LOC_BINLOG_LEN_NONE && len != LOC_BINLOG_LEN_L) {
+         return -1;
+      }
+      type = LOC_BINLOG_ARG_INT;
+      if (len == LOC_BINLOG_LEN_L && loc_binlog_spec_append(spec, "l", 1) != 0) {
+         return -1;
+      }
+      break;
+   case 'f':
+   case 'F':
+   case 'e':
+   case 'E':
+   case 'g':
+   case 'G':
+   case 'a':
+   case 'A':
+      if (len == LOC_BINLOG_LEN_LD) {
+         type = LOC_BINLOG_ARG_LDOUBLE;
+      } else if (len == LOC_BINLOG_LEN_NONE || len == LOC_BINLOG_LEN_L) {
+         type = LOC_BINLOG_ARG_DOUBLE;
+      } else {
+         return -1;
+      }
+      break;
+   case 's':
+      if (len != LOC_BINLOG_LEN_NONE) {
+         return -1;
+      }
+      type = LOC_BINLOG_ARG_STR;
+      break;
+   case 'p':
+      if (len != LOC_BINLOG_LEN_NONE) {
+         return -1;
+      }
+      type = LOC_BINLOG_ARG_PTR;
+      break;
+   default:
+      return -1;
+   }
+
+   spec->type = type;
+   *cursor = s;
+   return loc_binlog_spec_append(spec, &conv, 1);
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_parse_fmt
+
+DESCRIPTION
+   Lists the argument classes a format consumes, in call order. '*' width
+   and precision arguments appear as LOC_BINLOG_ARG_INT ahead of their value.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Number of entries written to types, or -1 if the format cannot be
+   captured or needs more than max_types arguments
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int loc_binlog_parse_fmt(const char *fmt, uint8_t *types, int max_types)
+{
+   loc_binlog_spec_s_type spec;
+   const char *s = fmt;
+   int num = 0;
+   uint8_t i;
+
+   if (NULL == fmt) {
+      return -1;
+   }
+   while (*s != '\0') {
+      if (*s++ != '%') {
+         continue;
+      }
+      if (loc_binlog_parse_spec(&s, &spec) != 0) {
+         return -1;
+      }
+      if (0 == spec.type) {
+         continue;
+      }
+      if (num + spec.num_star + 1 > max_types) {
+         return -1;
+      }
+      for (i = 0; i < spec.num_star; i++) {
+         types[num++] = LOC_BINLOG_ARG_INT;
+      }
+      types[num++] = spec.type;
+   }
+   return num;
+}
+
+/*===========================================================================
+FUNCTION    loc_binlog_get
+
+DESCRIPTION
+   Copies n bytes from the record payload and advances the cursor.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the payload is exhausted
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_binlog_get(const uint8_t **cursor, const uint8_t *end, void *dst, size_t n)
+{
+   if ((size_t)(end - *cursor) < n) {
+      return -1;
+   }
+   memcpy(dst, *cursor, n);
+   *cursor += n;
+   return 0;
+}
+
+#define LOC_BINLOG_SNPRINTF(n, dst, rem, spec, star, ...)                    \
+    do {                                                                     \
+        switch ((spec).num_star) {                                           \
+        case 0:                                                              \
+            n = snprintf(dst, rem, (spec).text, __VA_ARGS__);                \
+            break;                                                           \
+        case 1:                                                              \
+            n = snprintf(dst, rem, (spec).text, star[0], __VA_ARGS__);       \
+            break;                                                           \
+        default:                                                             \
+            n = snprintf(dst, rem, (spec).text, star[0], star[1], __VA_ARGS__); \
+            break;                                                           \
+        }                                                                    \
+    } while (0)
+
+/*===========================================================================
+FUNCTION    loc_binlog_format
+
+DESCRIPTION
+   Renders a captured call. Literal text is copied and every conversion is
+   printed with its own snprintf from the packed argument bytes, so the
+   result matches what ALOGx would have produced for the same call.
+
+   out:       output buffer, always NUL terminated
+   fmt:       format registered for the site
+   args:      record payload
+   args_len:  payload length
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Length of the text in out
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int loc_binlog_format(char *out, size_t out_size, const char *fmt,
+                      const uint8_t *args, size_t args_len)
+{
+   loc_binlog_spec_s_type spec;
+   const uint8_t *cursor = args;
+   const uint8_t *end = args + args_len;
+   const char *s = fmt;
+   size_t pos = 0;
+   int star[2] = {0, 0};
+   int n = 0;
+   uint8_t i;
+
+   if (NULL == out || 0 == out_size) {
+      return 0;
+   }
+   out[0] = '\0';
+   if (NULL == fmt) {
+      return 0;
+   }
+
+   while (*s != '\0' && pos + 1 < out_size) {
+      if (*s != '%') {
+         out[pos++] = *s++;
+         continue;
+      }
+      s++;
+      if (loc_binlog_parse_spec(&s, &spec) != 0) {
+         break;
+      }
+      if (0 == spec.type) {
+         out[pos++] = '%';
+         continue;
+      }
+      for (i = 0; i < spec.num_star; i++) {
+         int32_t v;
+         if (loc_binlog_get(&cursor, end, &v, sizeof(v)) != 0) {
+            goto truncated;
+         }
+         star[i] = v;
+      }
+
+      switch (spec.type & ~LOC_BINLOG_ARG_UNSIGNED) {
+      case LOC_BINLOG_ARG_INT:
+      {
+         int32_t v;
+         if (loc_binlog_get(&cursor, end, &v, sizeof(v)) != 0) {
+            goto truncated;
+         }
+         LOC_BINLOG_SNPRINTF(n, out + pos, out_size - pos, spec, star, (int)v);
+         break;
+      }
+      case LOC_BINLOG_ARG_LONG:
+      case LOC_BINLOG_ARG_LLONG:
+      case LOC_BINLOG_ARG_SIZE:
+      case LOC_BINLOG_ARG_INTMAX:
+      case LOC_BINLOG_ARG_PTRDIFF:
+      {
+         int64_t v;
+         if (loc_binlog_get(&cursor, end, &v, sizeof(v)) != 0) {
+            goto truncated;
+         }
+         LOC_BINLOG_SNPRINTF(n, out + pos, out_size - pos, spec, star, (long long)v);
+         break;
+      }
+      case LOC_BINLOG_ARG_DOUBLE:
+      case LOC_BINLOG_ARG_LDOUBLE:
+      {
+         double v;
+         if (loc_binlog_get(&cursor, end, &v, sizeof(v)) != 0) {
+            goto truncated;
+         }
+         LOC_BINLOG_SNPRINTF(n, out + pos, out_size - pos, spec, star, v);
+         break;
+      }
+      case LOC_BINLOG_ARG_STR:
+      {
+         char str[LOC_BINLOG_MAX_STR + 1];
+         uint16_t len;
+         if (loc_binlog_get(&cursor, end, &len, sizeof(len)) != 0) {
+            goto truncated;
+         }
+         if (LOC_BINLOG_STR_NULL == len) {
+            snprintf(str, sizeof(str), "(null)");
+         } else {
+            if (len > LOC_BINLOG_MAX_STR ||
+                loc_binlog_get(&cursor, end, str, len) != 0) {
+               goto truncated;
+            }
+            str[len] = '\0';
+         }
+         LOC_BINLOG_SNPRINTF(n, out + pos, out_size - pos, spec, star, str);
+         break;
+      }
+      case LOC_BINLOG_ARG_PTR:
+      {
+         uint64_t v;
+         if (loc_binlog_get(&cursor, end, &v, sizeof(v)) != 0) {
+            goto truncated;
+         }
+         LOC_BINLOG_SNPRINTF(n, out + pos, out_size - pos, spec, star,
+                             (void *)(uintptr_t)v);
+         break;
+      }
+      default:
+         goto truncated;
+      }
+
+      if (n > 0) {
+         pos += (size_t)n;
+         if (pos >= out_size) {
+            pos = out_size - 1;
+         }
+      }
+   }
+   out[pos] = '\0';
+   return (int)pos;
+
+truncated:
+   snprintf(out + pos, out_size - pos, "<truncated>");
+   return (int)strlen(out);
+}
@@ -58,6 +58,7 @@
 static uint32_t DEBUG_LEVEL = 0xff;
 static uint32_t TIMESTAMP = 0;
 static uint32_t DATUM_TYPE = 0;
+static uint32_t BINARY_LOG = 0;
 static bool sVendorEnhanced = true;
 
 /* Parameter spec table */
@@ -66,6 +67,7 @@ static const loc_param_s_type loc_param_table[] =
     {"DEBUG_LEVEL",        &DEBUG_LEVEL,        NULL,    'n'},
     {"TIMESTAMP",          &TIMESTAMP,          NULL,    'n'},
     {"DATUM_TYPE",         &DATUM_TYPE,         NULL,    'n'},
+    {"BINARY_LOG",         &BINARY_LOG,         NULL,    'n'},
 };
 static const int loc_param_num = sizeof(loc_param_table) / sizeof(loc_param_s_type);
 
@@ -441,6 +443,7 @@ void loc_read_conf(const char* conf_file_name, const loc_param_s_type* config_ta
     }
     /* Initialize logging mechanism with parsed data */
     loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+    loc_binlog_init(BINARY_LOG);
 }
 
 /*=============================================================================
@@ -76,6 +76,8 @@
 
 #endif /* #if defined (USE_ANDROID_LOGGING) || defined (ANDROID) */
 
+#include "loc_binlog.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -133,11 +135,23 @@ extern char* get_timestamp(char* str, unsigned long buf_size);
 #define IF_LOC_LOGD if((loc_logger.DEBUG_LEVEL >= 4) && (loc_logger.DEBUG_LEVEL <= 5))
 #define IF_LOC_LOGV if((loc_logger.DEBUG_LEVEL >= 5) && (loc_logger.DEBUG_LEVEL <= 5))
 
-#define LOC_LOGE(...) IF_LOC_LOGE { ALOGE(__VA_ARGS__); }
-#define LOC_LOGW(...) IF_LOC_LOGW { ALOGW(__VA_ARGS__); }
-#define LOC_LOGI(...) IF_LOC_LOGI { ALOGI(__VA_ARGS__); }
-#define LOC_LOGD(...) IF_LOC_LOGD { ALOGD(__VA_ARGS__); }
-#define LOC_LOGV(...) IF_LOC_LOGV { ALOGV(__VA_ARGS__); }
+/* With BINARY_LOG set the call is captured by loc_binlog_write and
+   formatted later; ALOGx is used when it is off or the call cannot be
+   captured. The ALOGx expansion also keeps format checking intact. */
+#define LOC_BINLOG_OR(ALOGX, LEVEL, fmt, ...)                                 \
+    do {                                                                      \
+        static loc_binlog_site_s_type loc_binlog_site_ = {LOG_TAG, 0, LEVEL}; \
+        if (!loc_binlog_mode ||                                               \
+            loc_binlog_write(&loc_binlog_site_, fmt, ##__VA_ARGS__) != 0) {   \
+            ALOGX(fmt, ##__VA_ARGS__);                                        \
+        }                                                                     \
+    } while(0)
+
+#define LOC_LOGE(...) IF_LOC_LOGE { LOC_BINLOG_OR(ALOGE, LOC_BINLOG_LEVEL_E, __VA_ARGS__); }
+#define LOC_LOGW(...) IF_LOC_LOGW { LOC_BINLOG_OR(ALOGW, LOC_BINLOG_LEVEL_W, __VA_ARGS__); }
+#define LOC_LOGI(...) IF_LOC_LOGI { LOC_BINLOG_OR(ALOGI, LOC_BINLOG_LEVEL_I, __VA_ARGS__); }
+#define LOC_LOGD(...) IF_LOC_LOGD { LOC_BINLOG_OR(ALOGD, LOC_BINLOG_LEVEL_D, __VA_ARGS__); }
+#define LOC_LOGV(...) IF_LOC_LOGV { LOC_BINLOG_OR(ALOGV, LOC_BINLOG_LEVEL_V, __VA_ARGS__); }
 
 #else /* DEBUG_DMN_LOC_API */
 
@@ -156,7 +170,7 @@ extern char* get_timestamp(char* str, unsigned long buf_size);
  *============================================================================*/
 #define LOG_(LOC_LOG, ID, WHAT, SPEC, VAL)                                    \
     do {                                                                      \
-        if (loc_logger.TIMESTAMP) {                                           \
+        if (loc_logger.TIMESTAMP && !loc_binlog_mode) {                       \
             char ts[32];                                                      \
             LOC_LOG("[%s] %s %s line %d " #SPEC,                              \
                      get_timestamp(ts, sizeof(ts)), ID, WHAT, __LINE__, VAL); \
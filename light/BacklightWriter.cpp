@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2018 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "LightService"
+
+#include "BacklightWriter.h"
+
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+
+namespace {
+
+static constexpr uint32_t DEFAULT_PERIOD_MS = 16;
+static constexpr uint32_t MAX_PERIOD_MS = 1000;
+static constexpr uint32_t MAX_RAMP_MS = 5000;
+
+static constexpr int64_t UNKNOWN = -1;
+
+}  // anonymous namespace
+
+namespace android {
+namespace hardware {
+namespace light {
+namespace V2_0 {
+namespace implementation {
+
+static const std::string kPeriodProp = "persist.vendor.light.backlight.period_ms";
+static const std::string kRampProp = "persist.vendor.light.backlight.ramp_ms";
+
+BacklightWriter::BacklightWriter(std::ofstream&& lcd, std::vector<std::ofstream>&& buttons)
+    : BacklightWriter(std::move(lcd), std::move(buttons),
+                      std::chrono::milliseconds(android::base::GetUintProperty<uint32_t>(
+                              kPeriodProp, DEFAULT_PERIOD_MS, MAX_PERIOD_MS)),
+                      std::chrono::milliseconds(android::base::GetUintProperty<uint32_t>(
+                              kRampProp, 0, MAX_RAMP_MS))) {}
+
+BacklightWriter::BacklightWriter(std::ofstream&& lcd, std::vector<std::ofstream>&& buttons,
+                                 std::chrono::milliseconds period, std::chrono::milliseconds ramp)
+    : mLcd(std::move(lcd)),
+      mButtons(std::move(buttons)),
+      mPeriod(period),
+      mRamp(ramp),
+      mLcdTarget(0),
+      mButtonsTarget(0),
+      mLcdPending(false),
+      mButtonsPending(false),
+      mExit(false),
+      mLcdCurrent(UNKNOWN),
+      mButtonsCurrent(UNKNOWN),
+      mRamping(false),
+      mRampFrom(0),
+      mRampTo(0),
+      mRequests(0),
+      mCoalesced(0),
+      mDeduped(0),
+      mLcdWrites(0),
+      mButtonWrites(0) {
+    LOG(INFO) << "Backlight writer: period=" << mPeriod.count() << "ms ramp=" << mRamp.count()
+              << "ms";
+    mThread = std::thread(&BacklightWriter::threadLoop, this);
+}
+
+BacklightWriter::~BacklightWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCond.notify_one();
+    mThread.join();
+}
+
+void BacklightWriter::setLcd(uint32_t brightness) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mLcdPending) {
+            mCoalesced++;
+        }
+        mLcdTarget = brightness;
+        mLcdPending = true;
+    }
+    mRequests++;
+    mCond.notify_one();
+}
+
+void BacklightWriter::setButtons(uint32_t brightness) {
+    if (mButtons.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mButtonsPending) {
+            mCoalesced++;
+        }
+        mButtonsTarget = brightness;
+        mButtonsPending = true;
+    }
+    mRequests++;
+    mCond.notify_one();
+}
+
+void BacklightWriter::dump(std::ostream& os) const {
+    os << "Backlight writer: period=" << mPeriod.count() << "ms ramp=" << mRamp.count() << "ms"
+       << std::endl;
+    os << "  requests=" << mRequests << " coalesced=" << mCoalesced << " deduped=" << mDeduped
+       << std::endl;
+    os << "  lcd writes=" << mLcdWrites << " button writes=" << mButtonWrites << std::endl;
+}
+
+void BacklightWriter::writeLcd(uint32_t brightness) {
+    mLcd << brightness << std::endl;
+    mLcdCurrent = brightness;
+    mLcdWrites++;
+}
+
+void BacklightWriter::writeButtons(uint32_t brightness) {
+    for (auto& button : mButtons) {
+        button << brightness << std::endl;
+    }
+    mButtonsCurrent = brightness;
+    mButtonWrites++;
+}
+
+void BacklightWriter::threadLoop() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (!mExit) {
+        if (!mLcdPending && !mButtonsPending && !mRamping) {
+            mCond.wait(lock);
+            continue;
+        }
+
+        // Targets posted while we wait here replace the pending ones.
+        Clock::time_point now = Clock::now();
+        if (now < mNextWrite) {
+            mCond.wait_until(lock, mNextWrite);
+            continue;
+        }
+
+        bool lcdPending = mLcdPending;
+        bool buttonsPending = mButtonsPending;
+        uint32_t lcdTarget = mLcdTarget;
+        uint32_t buttonsTarget = mButtonsTarget;
+        mLcdPending = false;
+        mButtonsPending = false;
+        lock.unlock();
+
+        bool wrote = false;
+
+        if (lcdPending) {
+            // Never ramp the panel on or off, only between two lit levels.
+            if (mRamp.count() > 0 && mLcdCurrent > 0 && lcdTarget > 0 &&
+                lcdTarget != mLcdCurrent) {
+                mRamping = true;
+                mRampFrom = mLcdCurrent;
+                mRampTo = lcdTarget;
+                // The first step lands one period into the ramp.
+                mRampStart = now - mPeriod;
+            } else {
+                mRamping = false;
+                if (lcdTarget != mLcdCurrent) {
+                    writeLcd(lcdTarget);
+                    wrote = true;
+                } else {
+                    mDeduped++;
+                }
+            }
+        }
+
+        if (mRamping) {
+            int64_t elapsedMs =
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - mRampStart).count();
+            int64_t value = mRampTo;
+            if (elapsedMs < mRamp.count()) {
+                value = mRampFrom + (mRampTo - mRampFrom) * elapsedMs / mRamp.count();
+            } else {
+                mRamping = false;
+            }
+            if (value != mLcdCurrent) {
+                writeLcd(value);
+            }
+            // Keep pacing even if this step rounded to the current level.
+            wrote = true;
+        }
+
+        if (buttonsPending) {
+            if (buttonsTarget != mButtonsCurrent) {
+                writeButtons(buttonsTarget);
+                wrote = true;
+            } else {
+                mDeduped++;
+            }
+        }
+
+        lock.lock();
+        if (wrote) {
+            mNextWrite = now + mPeriod;
+        }
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace light {
+namespace V2_0 {
+namespace implementation {
+
+/*
+ * Owns the LCD and button backlight nodes and writes them from its own
+ * thread, so binder calls only publish a target and return.
+ *
+ * Only the latest target of each node is kept; a value equal to what the
+ * node already holds is not written again. Writes are spaced at least
+ * persist.vendor.light.backlight.period_ms apart (default 16). If
+ * persist.vendor.light.backlight.ramp_ms is non-zero, LCD brightness
+ * changes are ramped linearly over that time at the same pacing. Turning
+ * the panel on or off is never ramped.
+ */
+class BacklightWriter {
+  private:
+    BacklightWriter(const BacklightWriter&) = delete;
+    BacklightWriter& operator=(const BacklightWriter&) = delete;
+
+  public:
+    BacklightWriter(std::ofstream&& lcd, std::vector<std::ofstream>&& buttons);
+    // Pacing and ramp given directly instead of read from the properties.
+    BacklightWriter(std::ofstream&& lcd, std::vector<std::ofstream>&& buttons,
+                    std::chrono::milliseconds period, std::chrono::milliseconds ramp);
+    ~BacklightWriter();
+
+    void setLcd(uint32_t brightness);
+    void setButtons(uint32_t brightness);
+
+    void dump(std::ostream& os) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void threadLoop();
+    void writeLcd(uint32_t brightness);
+    void writeButtons(uint32_t brightness);
+
+    std::ofstream mLcd;
+    std::vector<std::ofstream> mButtons;
+    std::chrono::milliseconds mPeriod;
+    std::chrono::milliseconds mRamp;
+
+    // Protected by mLock
+    uint32_t mLcdTarget;
+    uint32_t mButtonsTarget;
+    bool mLcdPending;
+    bool mButtonsPending;
+    bool mExit;
+
+    // Writer thread only
+    int64_t mLcdCurrent;
+    int64_t mButtonsCurrent;
+    bool mRamping;
+    int64_t mRampFrom;
+    int64_t mRampTo;
+    Clock::time_point mRampStart;
+    Clock::time_point mNextWrite;
+
+    std::atomic<uint64_t> mRequests;
+    std::atomic<uint64_t> mCoalesced;
+    std::atomic<uint64_t> mDeduped;
+    std::atomic<uint64_t> mLcdWrites;
+    std::atomic<uint64_t> mButtonWrites;
+
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::thread mThread;
+};
+
+}  // namespace implementation
+}  // namespace V2_0
+}  // namespace light
+}  // namespace hardware
+}  // namespace android
@@ -18,8 +18,12 @@
 
 #include "Light.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 
+#include <chrono>
+#include <sstream>
+
 namespace {
 
 using android::hardware::light::V2_0::LightState;
@@ -118,12 +122,15 @@ Light::Light(std::pair<std::ofstream, uint32_t>&& lcd_backlight,
              std::vector<std::ofstream>&& button_backlight,
              Led&& red_led, Led&& green_led, Led&& blue_led,
              std::ofstream&& rgb_blink)
-    : mLcdBacklight(std::move(lcd_backlight)),
-      mButtonBacklight(std::move(button_backlight)),
+    : mLcdMaxBrightness(lcd_backlight.second),
+      mBacklightWriter(std::move(lcd_backlight.first), std::move(button_backlight)),
       mRedLed(std::move(red_led)),
       mGreenLed(std::move(green_led)),
       mBlueLed(std::move(blue_led)),
-      mRgbBlink(std::move(rgb_blink)) {
+      mRgbBlink(std::move(rgb_blink)),
+      mCalls(0),
+      mCallNsTotal(0),
+      mCallNsMax(0) {
     auto attnFn(std::bind(&Light::setAttentionLight, this, std::placeholders::_1));
     auto backlightFn(std::bind(&Light::setLcdBacklight, this, std::placeholders::_1));
     auto batteryFn(std::bind(&Light::setBatteryLight, this, std::placeholders::_1));
@@ -144,7 +151,16 @@ Return<Status> Light::setLight(Type type, const LightState& state) {
         return Status::LIGHT_NOT_SUPPORTED;
     }
 
+    auto start = std::chrono::steady_clock::now();
     it->second(state);
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    mCalls++;
+    mCallNsTotal += ns;
+    uint64_t max = mCallNsMax;
+    while (ns > max && !mCallNsMax.compare_exchange_weak(max, ns)) {
+    }
 
     return Status::SUCCESS;
 }
@@ -161,6 +177,27 @@ Return<void> Light::getSupportedTypes(getSupportedTypes_cb _hidl_cb) {
     return Void();
 }
 
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+Return<void> Light::debug(const hidl_handle& handle, const hidl_vec<hidl_string>& /* args */) {
+    if (handle == nullptr || handle->numFds < 1) {
+        LOG(ERROR) << "debug: invalid handle";
+        return Void();
+    }
+
+    std::ostringstream os;
+    uint64_t calls = mCalls;
+    os << "setLight: calls=" << calls;
+    if (calls > 0) {
+        os << " avg=" << mCallNsTotal / calls / 1000 << "us max=" << mCallNsMax / 1000 << "us";
+    }
+    os << std::endl;
+    mBacklightWriter.dump(os);
+
+    android::base::WriteStringToFd(os.str(), handle->data[0]);
+
+    return Void();
+}
+
 void Light::setAttentionLight(const LightState& state) {
     std::lock_guard<std::mutex> lock(mLock);
     mAttentionState = state;
@@ -168,29 +205,21 @@ void Light::setAttentionLight(const LightState& state) {
 }
 
 void Light::setLcdBacklight(const LightState& state) {
-    std::lock_guard<std::mutex> lock(mLock);
-
     uint32_t brightness = rgbToBrightness(state);
 
     // If max panel brightness is not the default (255),
     // apply linear scaling across the accepted range.
-    if (mLcdBacklight.second != MAX_BRIGHTNESS) {
+    if (mLcdMaxBrightness != MAX_BRIGHTNESS) {
         int old_brightness = brightness;
-        brightness = brightness * mLcdBacklight.second / MAX_BRIGHTNESS;
+        brightness = brightness * mLcdMaxBrightness / MAX_BRIGHTNESS;
         LOG(VERBOSE) << "scaling brightness " << old_brightness << " => " << brightness;
     }
 
-    mLcdBacklight.first << brightness << std::endl;
+    mBacklightWriter.setLcd(brightness);
 }
 
 void Light::setButtonsBacklight(const LightState& state) {
-    std::lock_guard<std::mutex> lock(mLock);
-
-    uint32_t brightness = rgbToBrightness(state);
-
-    for (auto& button : mButtonBacklight) {
-        button << brightness << std::endl;
-    }
+    mBacklightWriter.setButtons(rgbToBrightness(state));
 }
 
 void Light::setBatteryLight(const LightState& state) {
@@ -19,10 +19,13 @@
 #include <android/hardware/light/2.0/ILight.h>
 #include <hidl/Status.h>
 
+#include <atomic>
 #include <fstream>
 #include <mutex>
 #include <unordered_map>
 
+#include "BacklightWriter.h"
+
 namespace android {
 namespace hardware {
 namespace light {
@@ -71,6 +74,9 @@ struct Light : public ILight {
     Return<Status> setLight(Type type, const LightState& state) override;
     Return<void> getSupportedTypes(getSupportedTypes_cb _hidl_cb) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& args) override;
+
   private:
     void setAttentionLight(const LightState& state);
     void setBatteryLight(const LightState& state);
@@ -80,8 +86,8 @@ struct Light : public ILight {
     void setSpeakerBatteryLightLocked();
     void setSpeakerLightLocked(const LightState& state);
 
-    std::pair<std::ofstream, uint32_t> mLcdBacklight;
-    std::vector<std::ofstream> mButtonBacklight;
+    uint32_t mLcdMaxBrightness;
+    BacklightWriter mBacklightWriter;
     Led mRedLed;
     Led mGreenLed;
     Led mBlueLed;
@@ -93,6 +99,10 @@ struct Light : public ILight {
 
     std::unordered_map<Type, std::function<void(const LightState&)>> mLights;
     std::mutex mLock;
+
+    std::atomic<uint64_t> mCalls;
+    std::atomic<uint64_t> mCallNsTotal;
+    std::atomic<uint64_t> mCallNsMax;
 };
 
 }  // namespace implementation
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2020 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BacklightWriter.h"
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using android::hardware::light::V2_0::implementation::BacklightWriter;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Writes land in temporary files, one line per sysfs write.
+class BacklightWriterTest : public ::testing::Test {
+  protected:
+    TemporaryDir mDir;
+
+    std::string path(const std::string& name) { return std::string(mDir.path) + "/" + name; }
+
+    std::unique_ptr<BacklightWriter> make(std::chrono::milliseconds period,
+                                          std::chrono::milliseconds ramp, size_t buttons = 0) {
+        std::vector<std::ofstream> buttonStreams;
+        for (size_t i = 0; i < buttons; i++) {
+            buttonStreams.emplace_back(path("button" + std::to_string(i)));
+        }
+        return std::make_unique<BacklightWriter>(std::ofstream(path("lcd")),
+                                                 std::move(buttonStreams), period, ramp);
+    }
+
+    std::vector<int> writes(const std::string& name) {
+        std::string content;
+        std::vector<int> values;
+        android::base::ReadFileToString(path(name), &content);
+        for (const auto& line : android::base::Split(content, "\n")) {
+            if (!line.empty()) {
+                values.push_back(std::stoi(line));
+            }
+        }
+        return values;
+    }
+
+    // Waits until the last write of the node is value.
+    bool waitFor(const std::string& name, int value, std::chrono::milliseconds timeout = 2s) {
+        auto end = std::chrono::steady_clock::now() + timeout;
+        do {
+            auto values = writes(name);
+            if (!values.empty() && values.back() == value) {
+                return true;
+            }
+            std::this_thread::sleep_for(1ms);
+        } while (std::chrono::steady_clock::now() < end);
+        return false;
+    }
+
+    static uint64_t counter(const BacklightWriter& writer, const std::string& name) {
+        std::ostringstream os;
+        writer.dump(os);
+        std::string dump = os.str();
+        size_t pos = dump.find(name + "=");
+        return pos == std::string::npos ? UINT64_MAX
+                                        : std::stoull(dump.substr(pos + name.size() + 1));
+    }
+};
+
+TEST_F(BacklightWriterTest, CoalescesBurstToLatestTarget) {
+    auto writer = make(100ms, 0ms);
+
+    for (uint32_t i = 1; i <= 255; i++) {
+        writer->setLcd(i);
+    }
+    ASSERT_TRUE(waitFor("lcd", 255));
+    std::this_thread::sleep_for(250ms);
+
+    auto values = writes("lcd");
+    EXPECT_EQ(255, values.back());
+    EXPECT_LE(values.size(), 3u);
+    EXPECT_EQ(255u, counter(*writer, "requests"));
+    EXPECT_GE(counter(*writer, "coalesced"), 255u - 3u);
+    EXPECT_EQ(values.size(), counter(*writer, "lcd writes"));
+}
+
+TEST_F(BacklightWriterTest, SkipsValuesTheNodeHolds) {
+    auto writer = make(1ms, 0ms, 2);
+
+    writer->setLcd(100);
+    writer->setButtons(5);
+    ASSERT_TRUE(waitFor("lcd", 100));
+    ASSERT_TRUE(waitFor("button1", 5));
+
+    writer->setLcd(100);
+    writer->setButtons(5);
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(std::vector<int>{100}, writes("lcd"));
+    EXPECT_EQ(std::vector<int>{5}, writes("button0"));
+    EXPECT_EQ(std::vector<int>{5}, writes("button1"));
+    EXPECT_EQ(2u, counter(*writer, "deduped"));
+    EXPECT_EQ(1u, counter(*writer, "lcd writes"));
+    EXPECT_EQ(1u, counter(*writer, "button writes"));
+}
+
+TEST_F(BacklightWriterTest, PacesWrites) {
+    auto writer = make(50ms, 0ms);
+    auto start = std::chrono::steady_clock::now();
+
+    // A framework animation step every 4 ms for 400 ms
+    for (uint32_t i = 1; i <= 100; i++) {
+        writer->setLcd(i);
+        std::this_thread::sleep_for(4ms);
+    }
+    ASSERT_TRUE(waitFor("lcd", 100));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto values = writes("lcd");
+    size_t maxWrites = elapsed / 50ms + 2;
+    EXPECT_LE(values.size(), maxWrites);
+    EXPECT_GE(values.size(), 4u);
+    for (size_t i = 1; i < values.size(); i++) {
+        EXPECT_LT(values[i - 1], values[i]);
+    }
+}
+
+TEST_F(BacklightWriterTest, RampRetargetsFromCurrentLevel) {
+    auto writer = make(10ms, 300ms);
+
+    // From an unknown level the first value is written as is
+    writer->setLcd(10);
+    ASSERT_TRUE(waitFor("lcd", 10));
+    writer->setLcd(250);
+    std::this_thread::sleep_for(120ms);
+    writer->setLcd(50);
+    ASSERT_TRUE(waitFor("lcd", 50));
+
+    auto values = writes("lcd");
+    ASSERT_GE(values.size(), 6u);
+    EXPECT_EQ(10, values[0]);
+    size_t peak = 1;
+    while (peak + 1 < values.size() && values[peak + 1] > values[peak]) {
+        peak++;
+    }
+    // Up part of the way, then down from there, in paced steps
+    EXPECT_GE(peak, 3u);
+    EXPECT_GT(values[peak], 50);
+    EXPECT_LT(values[peak], 250);
+    EXPECT_GE(values.size() - peak, 4u);
+    for (size_t i = peak + 1; i < values.size(); i++) {
+        EXPECT_LT(values[i], values[i - 1]);
+        EXPECT_GE(values[i], 50);
+    }
+}
+
+TEST_F(BacklightWriterTest, PanelOffAndOnAreImmediate) {
+    auto writer = make(10ms, 1000ms);
+
+    writer->setLcd(200);
+    ASSERT_TRUE(waitFor("lcd", 200));
+    writer->setLcd(100);
+    std::this_thread::sleep_for(50ms);
+
+    // Off cuts the ramp short
+    auto start = std::chrono::steady_clock::now();
+    writer->setLcd(0);
+    ASSERT_TRUE(waitFor("lcd", 0, 500ms));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 200ms);
+    size_t offWrites = writes("lcd").size();
+    std::this_thread::sleep_for(100ms);
+    EXPECT_EQ(offWrites, writes("lcd").size());
+
+    // On goes straight to the level
+    writer->setLcd(150);
+    ASSERT_TRUE(waitFor("lcd", 150, 500ms));
+    std::this_thread::sleep_for(100ms);
+    auto values = writes("lcd");
+    ASSERT_EQ(offWrites + 1, values.size());
+    EXPECT_EQ(0, values[offWrites - 1]);
+}
+
+}  // anonymous namespace